@@ -0,0 +1,147 @@
+// 建立连接的速率：阻塞connect()逐个建立 vs TcpClient在EventLoop上同时发起多个非阻塞connect
+// 用法：./bench_connect_rate [连接次数] [同时进行的连接数]
+//
+// 服务器是同一个进程里的TcpServer（主线程），客户端在另一个线程
+// 每个连接都由服务器先关闭，TIME_WAIT留在服务器一侧，客户端的本地端口不会耗尽
+// （客户端先关闭时，本地端口很快被复用，偶尔会碰上1秒的SYN重传）
+
+#include "TcpClient.h"
+#include "TcpConnection.h"
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "InetAddress.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const int kPort = 18183;
+
+double runBlocking(int total) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    
+    Timestamp start = Timestamp::now();
+    for (int i = 0; i < total; ++i) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+            perror("connect");
+            exit(1);
+        }
+        // 等服务器先关闭
+        char c;
+        while (::read(fd, &c, 1) > 0) {
+        }
+        ::close(fd);
+    }
+    return timeDifference(Timestamp::now(), start);
+}
+
+double runNonBlocking(int total, int concurrency) {
+    EventLoopThread loopThread;
+    EventLoop* loop = loopThread.startLoop();
+    
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done = false;
+    int connected = 0;
+    std::vector<std::unique_ptr<TcpClient>> clients;
+    Timestamp start = Timestamp::now();
+    
+    // 每个客户端都开启断线重连：服务器关闭连接之后马上再连（都在loop线程）
+    loop->runInLoop([&]() {
+        for (int i = 0; i < concurrency; ++i) {
+            TcpClient* client = new TcpClient(loop, InetAddress("127.0.0.1", kPort),
+                                              "Client" + std::to_string(i));
+            client->enableRetry();
+            client->setConnectionCallback([&](const TcpClient::ConnectionPtr& conn) {
+                if (!conn->connected() || ++connected != total) {
+                    return;
+                }
+                for (auto& c : clients) {
+                    c->disconnect();
+                    c->stop();
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                done = true;
+                cond.notify_one();
+            });
+            clients.emplace_back(client);
+            client->connect();
+        }
+    });
+    
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return done; });
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    
+    // TcpClient要在loop线程销毁
+    std::mutex destroyMutex;
+    std::condition_variable destroyed;
+    bool cleared = false;
+    loop->runInLoop([&]() {
+        clients.clear();
+        std::lock_guard<std::mutex> lock(destroyMutex);
+        cleared = true;
+        destroyed.notify_one();
+    });
+    std::unique_lock<std::mutex> lock(destroyMutex);
+    destroyed.wait(lock, [&]() { return cleared; });
+    return seconds;
+}
+
+int main(int argc, char* argv[]) {
+    int total = argc > 1 ? atoi(argv[1]) : 20000;
+    int concurrency = argc > 2 ? atoi(argv[2]) : 64;
+    
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    TcpServer server(&loop, "ConnectRateServer", kPort);
+    // 服务器一连上就关闭，客户端收到FIN之后再关闭
+    server.setConnectionCallback([](const std::shared_ptr<TcpConnection>& conn) {
+        if (conn->connected()) {
+            conn->shutdown();
+        }
+    });
+    server.start();
+    
+    std::thread client([&]() {
+        ::usleep(100 * 1000);
+        printf("%d connections to 127.0.0.1:%d\n", total, kPort);
+        printf("%-28s %12s %12s\n", "mode", "conn/s", "avg(us)");
+        
+        double blocking = runBlocking(total);
+        printf("%-28s %12.0f %12.1f\n", "blocking connect()", total / blocking,
+               blocking / total * 1e6);
+        
+        double nonBlocking = runNonBlocking(total, concurrency);
+        char name[64];
+        snprintf(name, sizeof name, "TcpClient (%d in flight)", concurrency);
+        printf("%-28s %12.0f %12.1f\n", name, total / nonBlocking,
+               nonBlocking / total * 1e6);
+        
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    return 0;
+}
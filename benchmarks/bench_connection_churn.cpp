@@ -0,0 +1,106 @@
+// TcpServer处理连接建立和关闭的速率（connects/s）
+// 用法：./bench_connection_churn [每种配置的连接次数] [客户端线程数]
+//
+// 服务器一连上就shutdown()，客户端读到EOF之后关闭，服务器读到0之后移除连接；
+// 每个客户端线程用阻塞socket一个接一个地连接，所有线程一起计时
+// 分别测试服务器没有IO线程（accept和连接都在主线程）和有2个IO线程的情况，
+// 后者每个连接的建立和移除都要在主线程和IO线程之间传递
+// 同时统计服务器主线程（Acceptor所在）的CPU时间，换算成每个连接的微秒数
+
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "Timestamp.h"
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const int kPort = 18233;
+
+double threadCpuSeconds() {
+    struct rusage usage;
+    ::getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+         + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// 连接total次（分给clients个线程），返回秒数
+double churn(int total, int clients) {
+    InetAddress addr("127.0.0.1", kPort);
+    std::atomic<int> remaining(total);
+    Timestamp start = Timestamp::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; ++i) {
+        threads.emplace_back([&]() {
+            while (remaining.fetch_sub(1) > 0) {
+                int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+                if (::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0) {
+                    perror("connect");
+                    exit(1);
+                }
+                char c;
+                while (::read(fd, &c, 1) > 0) {
+                }
+                ::close(fd);
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    return timeDifference(Timestamp::now(), start);
+}
+
+void run(int ioThreads, int total, int clients) {
+    std::promise<EventLoop*> started;
+    std::thread serverThread([&]() {
+        EventLoop loop;
+        TcpServer server(&loop, "ChurnServer", InetAddress(kPort));
+        server.setThreadNum(ioThreads);
+        server.setConnectionCallback([](const std::shared_ptr<TcpConnection>& conn) {
+            if (conn->connected()) {
+                conn->shutdown();
+            }
+        });
+        server.start();
+        started.set_value(&loop);
+        loop.loop();
+    });
+    EventLoop* loop = started.get_future().get();
+    
+    // 先预热一轮
+    churn(1000, clients);
+    
+    // 在主线程取CPU时间
+    auto serverCpu = [loop]() {
+        std::promise<double> cpu;
+        loop->runInLoop([&cpu]() { cpu.set_value(threadCpuSeconds()); });
+        return cpu.get_future().get();
+    };
+    double cpuStart = serverCpu();
+    double seconds = churn(total, clients);
+    double cpu = serverCpu() - cpuStart;
+    printf("%-12d %12.0f %16.2f\n", ioThreads, total / seconds, cpu / total * 1e6);
+    
+    loop->quit();
+    serverThread.join();
+}
+
+int main(int argc, char* argv[]) {
+    int total = argc > 1 ? atoi(argv[1]) : 50000;
+    int clients = argc > 2 ? atoi(argv[2]) : 4;
+    
+    printf("%d connections from %d client threads to 127.0.0.1:%d\n", total, clients, kPort);
+    printf("%-12s %12s %16s\n", "io threads", "conn/s", "main us/conn");
+    run(0, total, clients);
+    run(2, total, clients);
+    return 0;
+}
@@ -0,0 +1,70 @@
+// 每条消息取一次连接上下文的开销：按字符串key vs 按类型
+// 用法：./bench_connection_context [次数]
+//
+// 不涉及网络，只在一个连接上反复做HttpServer::onMessage开头的那一步：
+// - string key：getContext(kKey)查unordered_map（哈希一次），再static_pointer_cast，
+//   拷贝shared_ptr要增减一次引用计数（多线程程序里是原子操作）
+// - string literal：同上，但key是字符串字面量，每次还要构造一个std::string
+// - typed：context<T>()，数组下标取出裸指针
+
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct Session {
+    size_t messages = 0;
+};
+
+const std::string kKey = "HttpContext";
+
+template <typename F>
+void run(const char* name, int rounds, F access) {
+    Timestamp start = Timestamp::now();
+    size_t checksum = 0;
+    for (int i = 0; i < rounds; ++i) {
+        checksum += access();
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    printf("%-16s %10.2f %14.0f   (checksum %zu)\n", name, seconds * 1e9 / rounds, rounds / seconds, checksum);
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 20000000;
+    Logger::setLogLevel(Logger::WARN);
+    
+    // 有别的线程存在时libstdc++的shared_ptr才用原子操作，和服务器里的情况一样
+    std::thread([]() {}).join();
+    
+    EventLoop loop;
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    ::close(fds[1]);
+    std::shared_ptr<TcpConnection> conn = std::make_shared<TcpConnection>(&loop, "bench", fds[0]);
+    std::shared_ptr<Session> session = std::make_shared<Session>();
+    conn->setContext(kKey, session);
+    conn->setContext(session);
+    
+    printf("%d lookups on one connection\n", rounds);
+    printf("%-16s %10s %14s\n", "lookup", "ns/op", "ops/s");
+    run("string key", rounds, [&]() {
+        auto context = std::static_pointer_cast<Session>(conn->getContext(kKey));
+        return ++context->messages;
+    });
+    run("string literal", rounds, [&]() {
+        auto context = std::static_pointer_cast<Session>(conn->getContext("HttpContext"));
+        return ++context->messages;
+    });
+    run("typed", rounds, [&]() {
+        Session* context = conn->context<Session>();
+        return ++context->messages;
+    });
+    return 0;
+}
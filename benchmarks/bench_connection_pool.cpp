@@ -0,0 +1,153 @@
+// 短请求的延迟：ConnectionPool复用连接 vs 每个请求新建连接
+// 用法：./bench_connection_pool [请求次数] [并发数]
+//
+// 服务器是同一个进程里的回显TcpServer（一个IO线程），客户端在另一个EventLoop线程上，
+// 每个请求acquire()一个连接，发64字节、等回显，然后release()
+// 不复用时release(conn, false)：连接直接关闭，下一个请求重新握手
+
+#include "ConnectionPool.h"
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Buffer.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+const int kPort = 18184;
+const size_t kMessageSize = 64;
+
+struct Result {
+    double seconds;
+    std::vector<double> latencies;    // 微秒
+    ConnectionPool::Stats stats;
+};
+
+// concurrency个请求链，每条链上一个请求结束才开始下一个
+Result run(int total, int concurrency, bool pooled) {
+    EventLoopThread loopThread;
+    EventLoop* loop = loopThread.startLoop();
+    InetAddress addr("127.0.0.1", kPort);
+    const std::string message(kMessageSize, 'x');
+    
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done = false;
+    Result result;
+    result.latencies.reserve(total);
+    int started = 0;
+    std::unique_ptr<ConnectionPool> pool;
+    std::function<void()> next;
+    
+    loop->runInLoop([&]() {
+        pool.reset(new ConnectionPool(loop, "BenchPool"));
+        next = [&]() {
+            if (started == total) {
+                return;
+            }
+            ++started;
+            Timestamp start = Timestamp::now();
+            pool->acquire(addr, [&, start](const ConnectionPool::ConnectionPtr& conn, int savedErrno) {
+                if (!conn) {
+                    fprintf(stderr, "acquire failed: %s\n", strerror(savedErrno));
+                    exit(1);
+                }
+                conn->setMessageCallback([&, start](const ConnectionPool::ConnectionPtr& conn, Buffer* buf) {
+                    if (buf->readableBytes() < kMessageSize) {
+                        return;
+                    }
+                    buf->retrieveAll();
+                    pool->release(conn, pooled);
+                    result.latencies.push_back(timeDifference(Timestamp::now(), start) * 1e6);
+                    if (static_cast<int>(result.latencies.size()) == total) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        done = true;
+                        cond.notify_one();
+                        return;
+                    }
+                    next();
+                });
+                conn->send(message);
+            });
+        };
+        for (int i = 0; i < concurrency; ++i) {
+            next();
+        }
+    });
+    
+    Timestamp begin = Timestamp::now();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return done; });
+    }
+    result.seconds = timeDifference(Timestamp::now(), begin);
+    
+    // ConnectionPool要在loop线程销毁
+    std::mutex destroyMutex;
+    std::condition_variable destroyed;
+    bool cleared = false;
+    loop->runInLoop([&]() {
+        result.stats = pool->stats(addr);
+        pool.reset();
+        std::lock_guard<std::mutex> lock(destroyMutex);
+        cleared = true;
+        destroyed.notify_one();
+    });
+    std::unique_lock<std::mutex> lock(destroyMutex);
+    destroyed.wait(lock, [&]() { return cleared; });
+    return result;
+}
+
+void print(const char* name, int total, Result& r) {
+    std::sort(r.latencies.begin(), r.latencies.end());
+    double sum = 0;
+    for (double latency : r.latencies) {
+        sum += latency;
+    }
+    printf("%-18s %10.0f %10.1f %10.1f %10.1f %10llu\n", name, total / r.seconds,
+           sum / r.latencies.size(), r.latencies[r.latencies.size() / 2],
+           r.latencies[r.latencies.size() * 99 / 100],
+           static_cast<unsigned long long>(r.stats.connects));
+}
+
+int main(int argc, char* argv[]) {
+    int total = argc > 1 ? atoi(argv[1]) : 20000;
+    int concurrency = argc > 2 ? atoi(argv[2]) : 8;
+    
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    TcpServer server(&loop, "EchoServer", kPort);
+    server.setThreadNum(1);
+    server.setMessageCallback([](const std::shared_ptr<TcpConnection>& conn, Buffer* buf) {
+        conn->send(buf);
+    });
+    server.start();
+    
+    std::thread client([&]() {
+        ::usleep(100 * 1000);
+        printf("%d requests of %zu bytes, %d in flight\n", total, kMessageSize, concurrency);
+        printf("%-18s %10s %10s %10s %10s %10s\n", "mode", "req/s", "avg(us)", "p50(us)", "p99(us)", "connects");
+        Result pooled = run(total, concurrency, true);
+        print("pooled", total, pooled);
+        Result unpooled = run(total, concurrency, false);
+        print("connect/request", total, unpooled);
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    return 0;
+}
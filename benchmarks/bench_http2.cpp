@@ -0,0 +1,328 @@
+// HTTP/2（h2c）与HTTP/1.1吞吐量对比（类似h2load）
+// 用法：./bench_http2 [并发请求数] [每种场景的秒数]
+//
+// 服务器运行在主线程的EventLoop里，客户端是另一个线程里的epoll循环
+// 所有场景保持相同数量的在途请求（默认64），区别在于用多少个连接：
+//   http/1.1  —— 每个连接同时只有一个请求（浏览器的方式，不用pipelining），需要64个连接
+//   h2        —— 每个连接上同时有多个stream，1个或4个连接就够了
+// 输出每秒请求数和每个响应在线路上的字节数（HPACK压缩掉了重复的响应头）
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "Hpack.h"
+#include "Http2Codec.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const int kPort = 18089;
+
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    return fd;
+}
+
+void writeAll(int fd, const std::string& data) {
+    size_t n = 0;
+    while (n < data.size()) {
+        ssize_t w = ::write(fd, data.data() + n, data.size() - n);
+        if (w <= 0) {
+            perror("write");
+            exit(1);
+        }
+        n += w;
+    }
+}
+
+// 一个客户端连接：收到数据时处理所有完整的响应，并补发新的请求
+class ClientConn {
+public:
+    virtual ~ClientConn() {
+        ::close(fd_);
+    }
+    
+    int fd() const { return fd_; }
+    long completed() const { return completed_; }
+    
+    virtual void start() = 0;
+    
+    // 读到的数据追加到pending_后调用；返回false表示出错
+    bool onReadable(long* bytes) {
+        char buf[65536];
+        ssize_t n = ::read(fd_, buf, sizeof buf);
+        if (n <= 0) {
+            return false;
+        }
+        *bytes += n;
+        pending_.append(buf, n);
+        return process();
+    }
+    
+    void stop() {
+        stopping_ = true;
+    }
+
+protected:
+    ClientConn() : fd_(connectServer()), completed_(0), stopping_(false) {}
+    
+    virtual bool process() = 0;
+    
+    int fd_;
+    long completed_;
+    bool stopping_;
+    std::string pending_;
+};
+
+// HTTP/1.1 keep-alive：收到一个完整响应后发下一个请求
+class Http1Conn : public ClientConn {
+public:
+    void start() override {
+        writeAll(fd_, request());
+    }
+
+private:
+    static const std::string& request() {
+        static const std::string req = "GET /plaintext HTTP/1.1\r\nHost: localhost\r\n"
+                                       "User-Agent: bench_http2\r\nAccept: */*\r\n\r\n";
+        return req;
+    }
+    
+    bool process() override {
+        while (true) {
+            size_t headerEnd = pending_.find("\r\n\r\n");
+            if (headerEnd == std::string::npos) {
+                return true;
+            }
+            size_t pos = pending_.find("Content-Length: ");
+            size_t length = pos < headerEnd ? atoi(pending_.c_str() + pos + 16) : 0;
+            if (pending_.size() < headerEnd + 4 + length) {
+                return true;
+            }
+            pending_.erase(0, headerEnd + 4 + length);
+            ++completed_;
+            if (!stopping_) {
+                writeAll(fd_, request());
+            }
+        }
+    }
+};
+
+// HTTP/2：同时保持streams个请求在途，一个stream结束就开一个新的
+class Http2Conn : public ClientConn {
+public:
+    explicit Http2Conn(int streams) : streams_(streams), nextStreamId_(1), unacked_(0) {}
+    
+    void start() override {
+        // 连接前言 + SETTINGS（stream窗口开到最大），连接窗口也开到最大
+        std::string out(Http2Codec::kClientPreface, Http2Codec::kClientPrefaceSize);
+        char settings[6];
+        Http2Codec::appendSetting(settings, Http2Codec::kSettingsInitialWindowSize, Http2Codec::kMaxWindowSize);
+        Buffer buf;
+        Http2Codec::appendFrame(&buf, Http2Codec::kSettings, 0, 0, StringPiece(settings, 6));
+        Http2Codec::appendWindowUpdate(&buf, 0, Http2Codec::kMaxWindowSize - Http2Codec::kDefaultWindowSize);
+        for (int i = 0; i < streams_; ++i) {
+            appendRequest(&buf);
+        }
+        out += buf.retrieveAsString();
+        writeAll(fd_, out);
+    }
+
+private:
+    void appendRequest(Buffer* buf) {
+        block_.clear();
+        encoder_.encode(":method", "GET", &block_);
+        encoder_.encode(":scheme", "http", &block_);
+        encoder_.encode(":path", "/plaintext", &block_);
+        encoder_.encode(":authority", "localhost", &block_);
+        encoder_.encode("user-agent", "bench_http2", &block_);
+        encoder_.encode("accept", "*/*", &block_);
+        Http2Codec::appendFrame(buf, Http2Codec::kHeaders, Http2Codec::kFlagEndHeaders | Http2Codec::kFlagEndStream,
+                                nextStreamId_, block_);
+        nextStreamId_ += 2;
+    }
+    
+    bool process() override {
+        Buffer out;
+        Http2Codec::FrameHeader header;
+        size_t offset = 0;
+        while (Http2Codec::parseHeader(pending_.data() + offset, pending_.size() - offset, &header)
+               && pending_.size() - offset >= Http2Codec::kFrameHeaderSize + header.length) {
+            const char* payload = pending_.data() + offset + Http2Codec::kFrameHeaderSize;
+            offset += Http2Codec::kFrameHeaderSize + header.length;
+            bool endStream = false;
+            if (header.type == Http2Codec::kHeaders) {
+                // 动态表必须同步，所以每个响应头都要解码
+                if (!decoder_.decode(StringPiece(payload, header.length), [](StringPiece, StringPiece) {})) {
+                    fprintf(stderr, "HPACK decoding failed\n");
+                    return false;
+                }
+                endStream = (header.flags & Http2Codec::kFlagEndStream) != 0;
+            } else if (header.type == Http2Codec::kData) {
+                endStream = (header.flags & Http2Codec::kFlagEndStream) != 0;
+                unacked_ += header.length;
+            } else if (header.type == Http2Codec::kGoAway || header.type == Http2Codec::kRstStream) {
+                fprintf(stderr, "stream error\n");
+                return false;
+            }
+            if (endStream) {
+                ++completed_;
+                if (!stopping_) {
+                    appendRequest(&out);
+                }
+            }
+        }
+        pending_.erase(0, offset);
+        
+        // 连接窗口用掉1GB时补回来
+        if (unacked_ > (1u << 30)) {
+            Http2Codec::appendWindowUpdate(&out, 0, static_cast<uint32_t>(unacked_));
+            unacked_ = 0;
+        }
+        if (out.readableBytes() > 0) {
+            writeAll(fd_, out.retrieveAsString());
+        }
+        return true;
+    }
+    
+    int streams_;
+    uint32_t nextStreamId_;
+    uint64_t unacked_;
+    HpackEncoder encoder_;
+    HpackDecoder decoder_;
+    std::string block_;
+};
+
+struct Result {
+    double reqPerSec;
+    double bytesPerResponse;
+};
+
+// 跑一个场景：connections个连接，每个连接streams个在途请求（HTTP/1.1时streams为1）
+Result run(bool http2, int connections, int streams, double seconds) {
+    std::vector<std::unique_ptr<ClientConn>> conns;
+    int epfd = ::epoll_create1(0);
+    for (int i = 0; i < connections; ++i) {
+        ClientConn* conn = http2 ? static_cast<ClientConn*>(new Http2Conn(streams)) : new Http1Conn;
+        conns.emplace_back(conn);
+        struct epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = conn;
+        ::epoll_ctl(epfd, EPOLL_CTL_ADD, conn->fd(), &ev);
+    }
+    
+    Timestamp start = Timestamp::now();
+    for (auto& conn : conns) {
+        conn->start();
+    }
+    
+    long bytes = 0;
+    bool stopping = false;
+    long completed = 0;
+    long completedBytes = 0;
+    double elapsed = 0;
+    std::vector<struct epoll_event> events(connections);
+    while (true) {
+        if (!stopping && timeDifference(Timestamp::now(), start) >= seconds) {
+            // 统计到这一刻为止；之后不再发新请求，等在途的请求都完成再关闭连接
+            elapsed = timeDifference(Timestamp::now(), start);
+            for (auto& conn : conns) {
+                completed += conn->completed();
+                conn->stop();
+            }
+            completedBytes = bytes;
+            stopping = true;
+        }
+        int n = ::epoll_wait(epfd, events.data(), connections, 100);
+        if (n == 0 && stopping) {
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            ClientConn* conn = static_cast<ClientConn*>(events[i].data.ptr);
+            if (!conn->onReadable(&bytes)) {
+                fprintf(stderr, "connection closed unexpectedly\n");
+                exit(1);
+            }
+        }
+    }
+    ::close(epfd);
+    
+    Result result;
+    result.reqPerSec = completed / elapsed;
+    result.bytesPerResponse = completed > 0 ? static_cast<double>(completedBytes) / completed : 0;
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    int concurrency = argc > 1 ? atoi(argv[1]) : 64;
+    double seconds = argc > 2 ? atof(argv[2]) : 2.0;
+    
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    HttpServer server(&loop, "BenchHttp2", kPort);
+    server.enableHttp2();
+    server.router().GET("/plaintext", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/plain");
+        resp->addHeader("Server", "TinyNetwork");
+        resp->setBody("hello world");
+    });
+    server.start();
+    
+    std::thread driver([&]() {
+        printf("in-flight requests: %d, %.1fs per scenario\n", concurrency, seconds);
+        printf("%-10s %12s %16s %12s %16s\n", "protocol", "connections", "streams/conn", "req/s", "bytes/response");
+        
+        struct Scenario {
+            bool http2;
+            int connections;
+        };
+        const Scenario scenarios[] = {
+            { false, concurrency },
+            { true, concurrency },
+            { true, 4 },
+            { true, 1 },
+        };
+        for (const Scenario& s : scenarios) {
+            if (s.connections > concurrency) {
+                continue;
+            }
+            int streams = concurrency / s.connections;
+            Result r = run(s.http2, s.connections, streams, seconds);
+            printf("%-10s %12d %16d %12.0f %16.1f\n", s.http2 ? "h2" : "http/1.1",
+                   s.connections, streams, r.reqPerSec, r.bytesPerResponse);
+        }
+        loop.quit();
+    });
+    
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,176 @@
+// 每个HTTP请求在服务器IO线程上的堆分配次数
+// 用法：./bench_http_alloc [每种请求的次数]
+//
+// 替换全局operator new，只统计服务器EventLoop所在线程的分配
+// 客户端在另一个线程里用一个keep-alive连接逐个发送请求，每种请求先预热再统计：
+//   plaintext —— 短响应头、短响应体（SSO能放下）
+//   json      —— 长Content-Type、几百字节的响应体
+//   route     —— 带路由参数、查询参数和十几个请求头，响应头较多
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include <atomic>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const int kPort = 18091;
+
+std::atomic<long> g_allocations(0);
+thread_local bool t_counting = false;
+
+void* operator new(size_t size) {
+    if (t_counting) {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    void* p = malloc(size == 0 ? 1 : size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    return fd;
+}
+
+// 发一个请求，读完整个响应
+void roundTrip(int fd, const std::string& request, std::string* pending) {
+    if (::write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size())) {
+        perror("write");
+        exit(1);
+    }
+    while (true) {
+        size_t end = pending->find("\r\n\r\n");
+        if (end != std::string::npos) {
+            size_t pos = pending->find("Content-Length: ");
+            size_t length = pos < end ? atoi(pending->c_str() + pos + 16) : 0;
+            if (pending->size() >= end + 4 + length) {
+                pending->erase(0, end + 4 + length);
+                return;
+            }
+        }
+        char buf[65536];
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n <= 0) {
+            fprintf(stderr, "connection closed\n");
+            exit(1);
+        }
+        pending->append(buf, n);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 10000;
+    
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    HttpServer server(&loop, "BenchHttpAlloc", kPort);
+    const std::string json = "{\"id\":42,\"name\":\"tiny_network\",\"tags\":[\"reactor\",\"http\",\"epoll\"],"
+                             "\"description\":\"" + std::string(200, 'x') + "\"}";
+    server.router().GET("/plaintext", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/plain");
+        resp->addHeader("Server", "TinyNetwork");
+        resp->setBody("hello world");
+    });
+    server.router().GET("/json", [&json](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("application/json; charset=utf-8");
+        resp->addHeader("Server", "TinyNetwork");
+        resp->setBody(json);
+    });
+    server.router().GET("/users/:id/posts/:post", [](const HttpRequest& req, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/html; charset=utf-8");
+        resp->addHeader("Server", "TinyNetwork");
+        resp->addHeader("Cache-Control", "private, max-age=0, must-revalidate");
+        resp->addHeader("X-Request-Id", req.getHeader("X-Request-Id"));
+        resp->addHeader("X-User", req.param("id"));
+        resp->addHeader("X-Post", req.param("post"));
+        resp->setBody("<html><body><h1>post</h1><p>some content that is longer than the SSO buffer</p></body></html>");
+    });
+    server.start();
+    
+    // 从这里开始统计IO线程（也就是当前线程）的分配
+    loop.runInLoop([]() {
+        t_counting = true;
+    });
+    
+    std::thread client([&]() {
+        struct Scenario {
+            const char* name;
+            std::string request;
+        };
+        const Scenario scenarios[] = {
+            { "plaintext", "GET /plaintext HTTP/1.1\r\nHost: localhost\r\n\r\n" },
+            { "json", "GET /json HTTP/1.1\r\nHost: localhost\r\nAccept: application/json\r\n\r\n" },
+            { "route", "GET /users/12345/posts/678?sort=desc&page=2 HTTP/1.1\r\n"
+                       "Host: www.example.com\r\n"
+                       "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36\r\n"
+                       "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+                       "Accept-Language: en-US,en;q=0.5\r\n"
+                       "Accept-Encoding: identity\r\n"
+                       "Referer: http://www.example.com/users/12345\r\n"
+                       "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark\r\n"
+                       "X-Request-Id: 7f3a9c2e-4b1d-4e8a-9f6c-2d5e8b1a3c7f\r\n"
+                       "Cache-Control: no-cache\r\n"
+                       "Connection: keep-alive\r\n\r\n" },
+        };
+        
+        printf("%-10s %12s %16s\n", "request", "requests", "allocs/request");
+        for (const Scenario& s : scenarios) {
+            int fd = connectServer();
+            std::string pending;
+            // 预热：连接建立、缓冲区和复用的存储第一次分配
+            for (int i = 0; i < 100; ++i) {
+                roundTrip(fd, s.request, &pending);
+            }
+            long before = g_allocations.load();
+            for (int i = 0; i < rounds; ++i) {
+                roundTrip(fd, s.request, &pending);
+            }
+            long allocations = g_allocations.load() - before;
+            printf("%-10s %12d %16.2f\n", s.name, rounds, static_cast<double>(allocations) / rounds);
+            ::close(fd);
+        }
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    return 0;
+}
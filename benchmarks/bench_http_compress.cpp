@@ -0,0 +1,113 @@
+// HTTP响应压缩基准测试
+// 用法：./bench_http_compress [每种组合的响应数]
+//
+// 对1KB/16KB/256KB的JSON响应体，分别测identity/gzip/deflate：
+//   wire  —— 序列化后的响应（头部 + 响应体）字节数，即实际发送到网络上的大小
+//   cpu   —— 每个响应的CPU时间（压缩 + 序列化），用CLOCK_PROCESS_CPUTIME_ID测量
+// 最后一列是压缩结果缓存命中时的CPU时间（adler32 + memcmp + 序列化）
+
+#include "HttpCompressor.h"
+#include "HttpResponse.h"
+#include "Buffer.h"
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <string>
+#include <time.h>
+
+namespace {
+
+double cpuMicros() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+std::string makeJson(size_t n) {
+    std::string json = "[";
+    for (int i = 0; json.size() < n; ++i) {
+        if (i > 0) {
+            json += ",";
+        }
+        json += "{\"id\":" + std::to_string(i) + ",\"name\":\"user" + std::to_string(i * 7919 % 10007)
+              + "\",\"email\":\"user" + std::to_string(i) + "@example.com\",\"active\":"
+              + (i % 3 ? "true" : "false") + ",\"score\":" + std::to_string(i * 37 % 1000) + "}";
+    }
+    json += "]";
+    return json;
+}
+
+struct Result {
+    size_t wire;
+    double cpu;
+};
+
+// 每个响应的完整路径：构造响应、（查缓存/）压缩、序列化
+Result run(HttpCompressor* compressor, HttpCompressor::Encoding encoding,
+           const std::string& body, int rounds, bool cached) {
+    Buffer buf;
+    size_t wire = 0;
+    double start = cpuMicros();
+    for (int i = 0; i < rounds; ++i) {
+        HttpResponse resp(false);
+        resp.setStatusCode(HttpResponse::k200Ok);
+        resp.setContentType("application/json");
+        resp.setBody(body);
+        if (encoding != HttpCompressor::kIdentity) {
+            if (!cached || !compressor->applyCached(encoding, &resp)) {
+                compressor->compressResponse(encoding, &resp);
+            }
+        }
+        resp.appendToBuffer(&buf);
+        wire += buf.readableBytes();
+        buf.retrieveAll();
+    }
+    Result r;
+    r.wire = wire / rounds;
+    r.cpu = (cpuMicros() - start) / rounds;
+    return r;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 2000;
+    
+    const size_t sizes[] = { 1024, 16 * 1024, 256 * 1024 };
+    const HttpCompressor::Encoding encodings[] = {
+        HttpCompressor::kIdentity, HttpCompressor::kGzip, HttpCompressor::kDeflate
+    };
+    
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::left << std::setw(8) << "body" << std::setw(10) << "encoding"
+              << std::right << std::setw(10) << "wire(B)" << std::setw(8) << "ratio"
+              << std::setw(12) << "cpu(us)" << std::setw(14) << "cached(us)" << std::endl;
+    
+    for (size_t size : sizes) {
+        std::string body = makeJson(size);
+        int n = size >= 256 * 1024 ? rounds / 10 : rounds;
+        size_t identity = 0;
+        for (HttpCompressor::Encoding encoding : encodings) {
+            // 不缓存：每个响应都重新压缩
+            HttpCompressor uncached;
+            uncached.setCacheCapacity(0);
+            Result r = run(&uncached, encoding, body, n, false);
+            if (encoding == HttpCompressor::kIdentity) {
+                identity = r.wire;
+            }
+            
+            // 缓存：先让响应体出现两次进入缓存，之后都是命中
+            HttpCompressor cached;
+            cached.setCacheCapacity(64 * 1024 * 1024);
+            run(&cached, encoding, body, 2, true);
+            Result c = run(&cached, encoding, body, n, true);
+            
+            std::cout << std::left << std::setw(8) << (std::to_string(size / 1024) + "KB")
+                      << std::setw(10) << HttpCompressor::encodingName(encoding)
+                      << std::right << std::setw(10) << r.wire
+                      << std::setw(7) << 100.0 * r.wire / identity << "%"
+                      << std::setw(12) << r.cpu << std::setw(14) << c.cpu << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+// 快慢混合的HTTP请求：业务回调在IO线程执行 vs 交给工作线程（setHandlerOffload）
+// 用法：./bench_http_offload [测试秒数] [慢请求耗时ms]
+//
+// 服务器只有一个IO线程，/slow在回调里usleep（模拟查数据库、读磁盘），/fast立即返回
+// 客户端：kSlowClients个连接不停发/slow，kFastClients个连接不停发/fast，
+// 统计/fast的延迟分布（p50/p99/max）和两种请求的吞吐量
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "EventLoop.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const int kPort = 18093;
+const int kFastClients = 4;
+const int kSlowClients = 4;
+const int kWorkers = 8;
+
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    return fd;
+}
+
+// 发一个请求，读完整个响应，返回状态码
+int roundTrip(int fd, const std::string& request, std::string* pending) {
+    if (::write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size())) {
+        perror("write");
+        exit(1);
+    }
+    while (true) {
+        size_t end = pending->find("\r\n\r\n");
+        if (end != std::string::npos) {
+            size_t pos = pending->find("Content-Length: ");
+            size_t length = pos < end ? atoi(pending->c_str() + pos + 16) : 0;
+            if (pending->size() >= end + 4 + length) {
+                int status = atoi(pending->c_str() + 9);
+                pending->erase(0, end + 4 + length);
+                return status;
+            }
+        }
+        char buf[65536];
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n <= 0) {
+            fprintf(stderr, "connection closed\n");
+            exit(1);
+        }
+        pending->append(buf, n);
+    }
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t i = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[i];
+}
+
+void runOnce(bool offload, double seconds, int slowMs) {
+    EventLoop loop;
+    HttpServer server(&loop, "BenchHttpOffload", kPort);
+    server.setWorkerThreadNum(kWorkers);
+    server.setHandlerOffload(offload);
+    server.router().GET("/fast", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody("fast");
+    });
+    server.router().GET("/slow", [slowMs](const HttpRequest&, HttpResponse* resp) {
+        ::usleep(slowMs * 1000);
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody("slow");
+    });
+    server.start();
+    
+    std::atomic<bool> stop(false);
+    std::atomic<long> slowRequests(0);
+    std::atomic<long> shed(0);
+    std::mutex mutex;
+    std::vector<double> fastLatency;  // 毫秒
+    
+    std::thread driver([&]() {
+        std::vector<std::thread> clients;
+        for (int i = 0; i < kSlowClients; ++i) {
+            clients.emplace_back([&]() {
+                int fd = connectServer();
+                std::string pending;
+                while (!stop) {
+                    if (roundTrip(fd, "GET /slow HTTP/1.1\r\nHost: localhost\r\n\r\n", &pending) == 503) {
+                        ++shed;
+                    }
+                    ++slowRequests;
+                }
+                ::close(fd);
+            });
+        }
+        for (int i = 0; i < kFastClients; ++i) {
+            clients.emplace_back([&]() {
+                int fd = connectServer();
+                std::string pending;
+                std::vector<double> local;
+                while (!stop) {
+                    Timestamp start = Timestamp::now();
+                    if (roundTrip(fd, "GET /fast HTTP/1.1\r\nHost: localhost\r\n\r\n", &pending) == 503) {
+                        ++shed;
+                    }
+                    local.push_back(timeDifference(Timestamp::now(), start) * 1000);
+                }
+                ::close(fd);
+                std::lock_guard<std::mutex> lock(mutex);
+                fastLatency.insert(fastLatency.end(), local.begin(), local.end());
+            });
+        }
+        ::usleep(static_cast<useconds_t>(seconds * 1000 * 1000));
+        stop = true;
+        for (std::thread& t : clients) {
+            t.join();
+        }
+        loop.quit();
+    });
+    
+    loop.loop();
+    driver.join();
+    
+    std::sort(fastLatency.begin(), fastLatency.end());
+    printf("%-8s %10.0f %10.0f %10.3f %10.3f %10.3f %8ld\n",
+           offload ? "offload" : "inline",
+           fastLatency.size() / seconds, slowRequests / seconds,
+           percentile(fastLatency, 0.5), percentile(fastLatency, 0.99),
+           fastLatency.empty() ? 0 : fastLatency.back(), shed.load());
+}
+
+int main(int argc, char* argv[]) {
+    double seconds = argc > 1 ? atof(argv[1]) : 3;
+    int slowMs = argc > 2 ? atoi(argv[2]) : 5;
+    
+    Logger::setLogLevel(Logger::WARN);
+    
+    printf("%d fast + %d slow connections, slow handler %dms, %d workers, %.1fs each\n",
+           kFastClients, kSlowClients, slowMs, kWorkers, seconds);
+    printf("%-8s %10s %10s %10s %10s %10s %8s\n",
+           "mode", "fast req/s", "slow req/s", "fast p50", "fast p99", "fast max", "503");
+    runOnce(false, seconds, slowMs);
+    runOnce(true, seconds, slowMs);
+    return 0;
+}
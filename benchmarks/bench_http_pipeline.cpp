@@ -0,0 +1,140 @@
+// HTTP pipelining吞吐量基准测试
+// 用法：./bench_http_pipeline [连接数] [每个深度测试的秒数]
+//
+// 服务器运行在主线程的EventLoop里，每个客户端线程持有一个keep-alive连接，
+// 一次write发出depth个请求，再读回depth个响应，分别测试depth = 1/8/32
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "EventLoop.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const int kPort = 18082;
+
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+// 读满len字节
+bool readFully(int fd, char* buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = ::read(fd, buf + got, len - got);
+        if (n <= 0) {
+            return false;
+        }
+        got += n;
+    }
+    return true;
+}
+
+// 发一个请求，算出单个响应的长度（响应长度固定）
+size_t probeResponseSize(const std::string& request) {
+    int fd = connectServer();
+    ::write(fd, request.data(), request.size());
+    std::string data;
+    char buf[4096];
+    size_t headerEnd = std::string::npos;
+    size_t contentLength = 0;
+    while (headerEnd == std::string::npos || data.size() < headerEnd + 4 + contentLength) {
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n <= 0) {
+            break;
+        }
+        data.append(buf, n);
+        if (headerEnd == std::string::npos) {
+            headerEnd = data.find("\r\n\r\n");
+            size_t pos = data.find("Content-Length: ");
+            if (pos != std::string::npos) {
+                contentLength = atoi(data.c_str() + pos + 16);
+            }
+        }
+    }
+    ::close(fd);
+    return headerEnd + 4 + contentLength;
+}
+
+int main(int argc, char* argv[]) {
+    int numConnections = argc > 1 ? atoi(argv[1]) : 4;
+    double seconds = argc > 2 ? atof(argv[2]) : 2.0;
+    
+    EventLoop loop;
+    HttpServer server(&loop, "BenchHttpServer", kPort);
+    server.setHttpCallback([](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setContentType("text/plain");
+        resp->setBody("hello world");
+    });
+    server.start();
+    
+    std::thread driver([&]() {
+        const std::string request =
+            "GET /plaintext HTTP/1.1\r\nHost: localhost\r\nAccept: */*\r\n\r\n";
+        const size_t responseSize = probeResponseSize(request);
+        printf("connections: %d, response size: %zu bytes\n", numConnections, responseSize);
+        
+        for (int depth : {1, 8, 32}) {
+            std::string batch;
+            for (int i = 0; i < depth; ++i) {
+                batch += request;
+            }
+            
+            std::atomic<bool> stop(false);
+            std::atomic<long> completed(0);
+            std::vector<std::thread> clients;
+            Timestamp start = Timestamp::now();
+            for (int c = 0; c < numConnections; ++c) {
+                clients.emplace_back([&]() {
+                    int fd = connectServer();
+                    std::vector<char> buf(responseSize * depth);
+                    long done = 0;
+                    while (!stop) {
+                        ::write(fd, batch.data(), batch.size());
+                        if (!readFully(fd, buf.data(), buf.size())) {
+                            fprintf(stderr, "connection closed unexpectedly\n");
+                            break;
+                        }
+                        done += depth;
+                    }
+                    completed += done;
+                    ::close(fd);
+                });
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(seconds * 1000)));
+            stop = true;
+            for (std::thread& t : clients) {
+                t.join();
+            }
+            double elapsed = timeDifference(Timestamp::now(), start);
+            printf("depth %2d: %10.0f req/s\n", depth, completed / elapsed);
+        }
+        loop.quit();
+    });
+    
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,165 @@
+// 反向代理的开销：直接访问上游 vs 经过HttpProxy（复用上游连接 / 每个请求新建上游连接）
+// 用法：./bench_http_proxy [请求次数] [大响应体MB]
+//
+// 客户端用一个keep-alive连接顺序发送小请求，统计平均延迟和p99，
+// 然后下载一个大响应体比较吞吐量（代理边收边转发，不攒整个响应体）
+// 上游和代理都在同一个进程里，代理使用一个IO线程
+
+#include "HttpProxy.h"
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "EventLoop.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const int kUpstreamPort = 18097;
+const int kPooledProxyPort = 18098;     // 复用上游连接
+const int kUnpooledProxyPort = 18099;   // 不保留空闲连接
+
+size_t g_largeSize = 0;
+
+int connectTo(int port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+// 读一个Content-Length响应，只数字节不保存，返回响应体长度
+size_t readResponse(int fd, std::string* pending) {
+    char buf[65536];
+    size_t end;
+    while ((end = pending->find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n <= 0) {
+            exit(1);
+        }
+        pending->append(buf, n);
+    }
+    size_t pos = pending->find("Content-Length: ");
+    if (pos == std::string::npos || pos > end) {
+        fprintf(stderr, "response without Content-Length\n");
+        exit(1);
+    }
+    size_t length = strtoul(pending->c_str() + pos + 16, nullptr, 10);
+    pending->erase(0, end + 4);
+    size_t have = std::min(length, pending->size());
+    pending->erase(0, have);
+    while (have < length) {
+        ssize_t n = ::read(fd, buf, std::min(sizeof buf, length - have));
+        if (n <= 0) {
+            exit(1);
+        }
+        have += n;
+    }
+    return length;
+}
+
+void sendRequest(int fd, const std::string& request) {
+    if (::write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size())) {
+        exit(1);
+    }
+}
+
+void run(const char* name, int port, int requests) {
+    int fd = connectTo(port);
+    std::string pending;
+    const std::string small = "GET /small HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    
+    // 预热
+    for (int i = 0; i < 100; ++i) {
+        sendRequest(fd, small);
+        readResponse(fd, &pending);
+    }
+    
+    std::vector<double> latencies;
+    latencies.reserve(requests);
+    Timestamp begin = Timestamp::now();
+    for (int i = 0; i < requests; ++i) {
+        Timestamp start = Timestamp::now();
+        sendRequest(fd, small);
+        readResponse(fd, &pending);
+        latencies.push_back(timeDifference(Timestamp::now(), start) * 1e6);
+    }
+    double seconds = timeDifference(Timestamp::now(), begin);
+    std::sort(latencies.begin(), latencies.end());
+    
+    Timestamp start = Timestamp::now();
+    sendRequest(fd, "GET /large HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    size_t bytes = readResponse(fd, &pending);
+    double largeSeconds = timeDifference(Timestamp::now(), start);
+    
+    printf("%-16s %10.0f %10.1f %10.1f %12.1f\n", name, requests / seconds,
+           seconds / requests * 1e6, latencies[latencies.size() * 99 / 100],
+           bytes / 1048576.0 / largeSeconds);
+    ::close(fd);
+}
+
+int main(int argc, char* argv[]) {
+    int requests = argc > 1 ? atoi(argv[1]) : 20000;
+    g_largeSize = static_cast<size_t>(argc > 2 ? atoi(argv[2]) : 256) * 1024 * 1024;
+    
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    HttpServer upstream(&loop, "BenchUpstream", kUpstreamPort);
+    upstream.router().GET("/small", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/plain");
+        resp->setBody("hello, world\n");
+    });
+    std::shared_ptr<const std::string> large = std::make_shared<const std::string>(g_largeSize, 'x');
+    upstream.router().GET("/large", [large](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody(large, 0, large->size());
+    });
+    upstream.start();
+    
+    HttpProxy pooled(&loop, "PooledProxy", kPooledProxyPort);
+    pooled.server().setThreadNum(1);
+    pooled.addUpstream("127.0.0.1", kUpstreamPort);
+    pooled.start();
+    
+    HttpProxy unpooled(&loop, "UnpooledProxy", kUnpooledProxyPort);
+    unpooled.server().setThreadNum(1);
+    unpooled.addUpstream("127.0.0.1", kUpstreamPort);
+    unpooled.setMaxIdlePerUpstream(0);
+    unpooled.start();
+    
+    std::thread client([&]() {
+        printf("%d small requests on one keep-alive connection, then one %zuMB download\n",
+               requests, g_largeSize / 1048576);
+        printf("%-16s %10s %10s %10s %12s\n", "path", "req/s", "avg(us)", "p99(us)", "large MB/s");
+        run("direct", kUpstreamPort, requests);
+        run("proxy (pooled)", kPooledProxyPort, requests);
+        run("proxy (no pool)", kUnpooledProxyPort, requests);
+        printf("upstream connects: pooled %llu, no pool %llu\n",
+               static_cast<unsigned long long>(pooled.upstreamStats(0).connects),
+               static_cast<unsigned long long>(unpooled.upstreamStats(0).connects));
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -0,0 +1,38 @@
+// HTTP响应序列化基准测试
+// 用法：./bench_http_response [响应数]
+//
+// 反复构造"hello world"响应并序列化到Buffer，不涉及网络，
+// 衡量HttpResponse本身（设置头部 + appendToBuffer）的开销
+
+#include "HttpResponse.h"
+#include "Buffer.h"
+#include "Timestamp.h"
+#include <iostream>
+#include <cstdlib>
+
+int main(int argc, char* argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 2000000;
+    
+    Buffer buf;
+    size_t bytes = 0;
+    
+    Timestamp start = Timestamp::now();
+    for (int i = 0; i < rounds; ++i) {
+        HttpResponse resp(false);
+        resp.setStatusCode(HttpResponse::k200Ok);
+        resp.setStatusMessage("OK");
+        resp.setContentType("text/plain");
+        resp.addHeader("Server", "TinyNetwork");
+        resp.setBody("hello world");
+        resp.appendToBuffer(&buf);
+        bytes += buf.readableBytes();
+        buf.retrieveAll();
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    
+    std::cout << "responses:  " << rounds << " (" << bytes / rounds << " bytes each)" << std::endl;
+    std::cout << "elapsed:    " << seconds << " s" << std::endl;
+    std::cout << "throughput: " << rounds / seconds << " responses/s" << std::endl;
+    std::cout << "per response " << seconds * 1e9 / rounds << " ns" << std::endl;
+    return 0;
+}
@@ -0,0 +1,162 @@
+// HTTP路由匹配基准测试
+// 用法：./bench_http_route [匹配次数]
+//
+// 注册1000条路由（静态/参数/通配混合），用一组请求路径反复匹配，
+// 和逐条比较的线性匹配（相当于应用里手写的if/else链）做对比
+
+#include "HttpRouter.h"
+#include "HttpRequest.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+const int kNumResources = 100;
+
+// 线性匹配：逐条路由、逐段比较
+struct LinearRoute {
+    HttpRequest::Method method;
+    std::vector<std::string> segments;
+};
+
+std::vector<std::string> split(StringPiece path) {
+    std::vector<std::string> segments;
+    const char* p = path.begin();
+    while (p < path.end()) {
+        ++p;  // 跳过'/'
+        const char* q = p;
+        while (q < path.end() && *q != '/') {
+            ++q;
+        }
+        segments.emplace_back(p, q);
+        p = q;
+    }
+    return segments;
+}
+
+int linearMatch(const std::vector<LinearRoute>& routes, HttpRequest* req) {
+    StringPiece path = req->path();
+    for (size_t r = 0; r < routes.size(); ++r) {
+        const LinearRoute& route = routes[r];
+        if (route.method != req->method()) {
+            continue;
+        }
+        req->clearParams();
+        const char* p = path.begin();
+        bool ok = true;
+        for (size_t i = 0; ok && i < route.segments.size(); ++i) {
+            const std::string& seg = route.segments[i];
+            if (p >= path.end() || *p != '/') {
+                ok = false;
+                break;
+            }
+            ++p;
+            if (seg[0] == '*') {
+                req->addParam(StringPiece(seg.data() + 1, seg.size() - 1), StringPiece(p, path.end()));
+                p = path.end();
+                break;
+            }
+            const char* q = p;
+            while (q < path.end() && *q != '/') {
+                ++q;
+            }
+            StringPiece value(p, q);
+            if (seg[0] == ':') {
+                ok = !value.empty() &&
+                     req->addParam(StringPiece(seg.data() + 1, seg.size() - 1), value);
+            } else {
+                ok = value == seg;
+            }
+            p = q;
+        }
+        if (ok && p == path.end()) {
+            return static_cast<int>(r);
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 2000000;
+    
+    // 1. 生成1000条路由：每个资源10条
+    std::vector<std::pair<HttpRequest::Method, std::string>> patterns;
+    for (int i = 0; i < kNumResources; ++i) {
+        std::string base = "/api/v1/resource" + std::to_string(i);
+        patterns.emplace_back(HttpRequest::kGet, base);
+        patterns.emplace_back(HttpRequest::kPost, base);
+        patterns.emplace_back(HttpRequest::kGet, base + "/search");
+        patterns.emplace_back(HttpRequest::kGet, base + "/:id");
+        patterns.emplace_back(HttpRequest::kPut, base + "/:id");
+        patterns.emplace_back(HttpRequest::kDelete, base + "/:id");
+        patterns.emplace_back(HttpRequest::kGet, base + "/:id/items");
+        patterns.emplace_back(HttpRequest::kGet, base + "/:id/items/:item");
+        patterns.emplace_back(HttpRequest::kGet, base + "/:id/history/stats");
+        patterns.emplace_back(HttpRequest::kGet, "/assets/r" + std::to_string(i) + "/*file");
+    }
+    
+    HttpRouter router;
+    std::vector<LinearRoute> linear;
+    size_t hits = 0;
+    for (const auto& p : patterns) {
+        router.addRoute(p.first, p.second, [&hits](const HttpRequest&, HttpResponse*) {
+            ++hits;
+        });
+        linear.push_back(LinearRoute{p.first, split(p.second)});
+    }
+    std::cout << "routes: " << router.size() << std::endl;
+    
+    // 2. 请求路径：均匀分布在所有资源上，包括一部分404
+    std::vector<std::pair<std::string, std::string>> requests;  // (method, path)
+    for (int i = 0; i < kNumResources; i += 7) {
+        std::string base = "/api/v1/resource" + std::to_string(i);
+        requests.emplace_back("GET", base);
+        requests.emplace_back("GET", base + "/12345");
+        requests.emplace_back("PUT", base + "/12345");
+        requests.emplace_back("GET", base + "/12345/items/678");
+        requests.emplace_back("GET", base + "/search");
+        requests.emplace_back("GET", base + "/12345/history/stats");
+        requests.emplace_back("GET", "/assets/r" + std::to_string(i) + "/js/app.min.js");
+        requests.emplace_back("GET", base + "/12345/unknown");
+    }
+    std::vector<HttpRequest> reqs(requests.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const std::string& method = requests[i].first;
+        const std::string& path = requests[i].second;
+        reqs[i].setBase(path.data());
+        reqs[i].setMethod(method.data(), method.data() + method.size());
+        reqs[i].setPath(path.data(), path.data() + path.size());
+    }
+    
+    // 3. radix tree
+    size_t matched = 0;
+    Timestamp start = Timestamp::now();
+    for (int i = 0; i < rounds; ++i) {
+        HttpRequest& req = reqs[i % reqs.size()];
+        if (router.match(&req)) {
+            ++matched;
+        }
+    }
+    double treeSeconds = timeDifference(Timestamp::now(), start);
+    
+    // 4. 线性匹配
+    size_t linearMatched = 0;
+    start = Timestamp::now();
+    for (int i = 0; i < rounds; ++i) {
+        HttpRequest& req = reqs[i % reqs.size()];
+        if (linearMatch(linear, &req) >= 0) {
+            ++linearMatched;
+        }
+    }
+    double linearSeconds = timeDifference(Timestamp::now(), start);
+    
+    if (matched != linearMatched) {
+        std::cerr << "mismatch: " << matched << " vs " << linearMatched << std::endl;
+        return 1;
+    }
+    std::cout << "matches:    " << rounds << " (" << matched << " hit)" << std::endl;
+    std::cout << "radix tree: " << treeSeconds * 1e9 / rounds << " ns/match" << std::endl;
+    std::cout << "linear:     " << linearSeconds * 1e9 / rounds << " ns/match" << std::endl;
+    return 0;
+}
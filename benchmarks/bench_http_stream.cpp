@@ -0,0 +1,176 @@
+// 大响应体（导出）：先在内存里拼好整个响应体（setBody）vs 流式生成（setStream + pull）
+// 用法：./bench_http_stream [响应体MB] [请求次数]
+//
+// 响应体是一行一行生成的CSV。客户端用一个keep-alive连接反复下载，统计吞吐量，
+// 以及服务器进程的峰值RSS（ru_maxrss只增不减，所以先测流式，再测一次性生成）
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "HttpResponseStream.h"
+#include "EventLoop.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const int kPort = 18095;
+
+size_t g_rows = 0;
+
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+// 一行CSV，大约100字节
+void appendRow(std::string* out, size_t i) {
+    char buf[128];
+    int n = snprintf(buf, sizeof buf, "%zu,user%zu,user%zu@example.com,%zu,2026-10-19T08:00:00Z,%s\n",
+                     i, i, i, i * 37 % 100000, "the quick brown fox jumps");
+    out->append(buf, n);
+}
+
+long maxRssKB() {
+    struct rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// 下载一个响应（Content-Length或者分块编码），只数字节不保存，返回响应体长度
+size_t download(int fd, std::string* pending) {
+    char buf[65536];
+    size_t end;
+    while ((end = pending->find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n <= 0) {
+            exit(1);
+        }
+        pending->append(buf, n);
+    }
+    std::string headers = pending->substr(0, end + 4);
+    pending->erase(0, end + 4);
+    
+    size_t body = 0;
+    size_t pos = headers.find("Content-Length: ");
+    if (pos != std::string::npos) {
+        size_t length = strtoul(headers.c_str() + pos + 16, nullptr, 10);
+        size_t have = std::min(length, pending->size());
+        pending->erase(0, have);
+        while (have < length) {
+            ssize_t n = ::read(fd, buf, std::min(sizeof buf, length - have));
+            if (n <= 0) {
+                exit(1);
+            }
+            have += n;
+        }
+        return length;
+    }
+    
+    // 分块编码
+    while (true) {
+        size_t lineEnd;
+        while ((lineEnd = pending->find("\r\n")) == std::string::npos) {
+            ssize_t n = ::read(fd, buf, sizeof buf);
+            if (n <= 0) {
+                exit(1);
+            }
+            pending->append(buf, n);
+        }
+        size_t size = strtoul(pending->c_str(), nullptr, 16);
+        pending->erase(0, lineEnd + 2);
+        size_t need = size + 2;
+        size_t have = std::min(need, pending->size());
+        pending->erase(0, have);
+        while (have < need) {
+            ssize_t n = ::read(fd, buf, std::min(sizeof buf, need - have));
+            if (n <= 0) {
+                exit(1);
+            }
+            have += n;
+        }
+        body += size;
+        if (size == 0) {
+            return body;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = argc > 1 ? atoi(argv[1]) : 256;
+    int rounds = argc > 2 ? atoi(argv[2]) : 4;
+    g_rows = megabytes * 1024 * 1024 / 100;
+    
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    HttpServer server(&loop, "BenchHttpStream", kPort);
+    server.router().GET("/export/buffered", [](const HttpRequest&, HttpResponse* resp) {
+        std::string body;
+        for (size_t i = 0; i < g_rows; ++i) {
+            appendRow(&body, i);
+        }
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/csv");
+        resp->setBody(std::move(body));
+    });
+    server.router().GET("/export/stream", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/csv");
+        resp->setStream([](const HttpResponseStreamPtr& stream) {
+            std::shared_ptr<size_t> row = std::make_shared<size_t>(0);
+            stream->pull([row](std::string* chunk) {
+                appendRow(chunk, (*row)++);
+                return *row < g_rows;
+            });
+        });
+    });
+    server.start();
+    
+    std::thread client([&]() {
+        printf("%zuMB export, %d downloads each\n", megabytes, rounds);
+        printf("%-10s %12s %12s %14s\n", "mode", "MB", "MB/s", "max RSS (MB)");
+        const char* modes[] = { "stream", "buffered" };
+        for (const char* mode : modes) {
+            int fd = connectServer();
+            std::string request = std::string("GET /export/") + mode + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+            std::string pending;
+            size_t total = 0;
+            Timestamp start = Timestamp::now();
+            for (int i = 0; i < rounds; ++i) {
+                if (::write(fd, request.data(), request.size()) != static_cast<ssize_t>(request.size())) {
+                    exit(1);
+                }
+                total += download(fd, &pending);
+            }
+            double seconds = timeDifference(Timestamp::now(), start);
+            printf("%-10s %12.1f %12.1f %14.1f\n", mode, total / 1048576.0,
+                   total / 1048576.0 / seconds, maxRssKB() / 1024.0);
+            ::close(fd);
+        }
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    return 0;
+}
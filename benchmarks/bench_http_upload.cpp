@@ -0,0 +1,83 @@
+// HTTP请求体（上传）解析吞吐量基准测试
+// 用法：./bench_http_upload [请求体MB数]
+//
+// 模拟从socket每次读到64KB数据，分别测试：
+// Content-Length / chunked 两种编码 × 缓存 / 流式 两种接收方式
+
+#include "HttpContext.h"
+#include "Buffer.h"
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstdio>
+
+// 构造一个完整的上传请求
+std::string makeRequest(size_t bodySize, bool chunked) {
+    std::string body(bodySize, 'x');
+    std::string request = "POST /upload HTTP/1.1\r\nHost: localhost\r\n";
+    if (chunked) {
+        request += "Transfer-Encoding: chunked\r\n\r\n";
+        const size_t kChunk = 16 * 1024;
+        char line[32];
+        for (size_t i = 0; i < body.size(); i += kChunk) {
+            size_t n = std::min(kChunk, body.size() - i);
+            snprintf(line, sizeof line, "%zx\r\n", n);
+            request += line;
+            request.append(body, i, n);
+            request += "\r\n";
+        }
+        request += "0\r\n\r\n";
+    } else {
+        request += "Content-Length: " + std::to_string(bodySize) + "\r\n\r\n";
+        request += body;
+    }
+    return request;
+}
+
+void run(const char* name, size_t bodySize, bool chunked, bool streaming) {
+    std::string request = makeRequest(bodySize, chunked);
+    const size_t kReadSize = 64 * 1024;
+    const int kRounds = 5;
+    
+    size_t received = 0;
+    Timestamp start = Timestamp::now();
+    for (int round = 0; round < kRounds; ++round) {
+        Buffer buf;
+        HttpContext context;
+        context.setMaxBodySize(bodySize);
+        if (streaming) {
+            context.setBodyCallback([&received](const HttpRequest&, StringPiece chunk) {
+                received += chunk.size();
+            });
+        }
+        for (size_t i = 0; i < request.size(); i += kReadSize) {
+            buf.append(request.data() + i, std::min(kReadSize, request.size() - i));
+            if (!context.parseRequest(&buf, start)) {
+                std::cerr << "parse error" << std::endl;
+                exit(1);
+            }
+        }
+        if (!context.gotAll()) {
+            std::cerr << "incomplete request" << std::endl;
+            exit(1);
+        }
+        received += context.request().body().size();
+        context.finishRequest(&buf);
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    
+    double mb = static_cast<double>(bodySize) * kRounds / (1024 * 1024);
+    printf("%-28s %8.1f MB/s  (%zu bytes received)\n", name, mb / seconds, received);
+}
+
+int main(int argc, char* argv[]) {
+    size_t mb = argc > 1 ? atoi(argv[1]) : 64;
+    size_t bodySize = mb * 1024 * 1024;
+    std::cout << "body size: " << mb << " MB, read size: 64 KB" << std::endl;
+    
+    run("content-length buffered", bodySize, false, false);
+    run("content-length streaming", bodySize, false, true);
+    run("chunked buffered", bodySize, true, false);
+    run("chunked streaming", bodySize, true, true);
+    return 0;
+}
@@ -0,0 +1,123 @@
+// accept路径上格式化对端地址的开销：每次toIpPort()的纳秒数
+// 用法：./bench_inetaddress_format [每种地址的调用次数]
+//
+// - legacy：原来的toIpPort()，inet_ntop + std::to_string + 字符串拼接（三次分配）
+// - snprintf：inet_ntop + snprintf写到栈上
+// - toIpPort()：现在返回std::string的版本（一次分配）
+// - toIpPort(buf)：写到调用方的缓冲区，不分配内存（Acceptor用这个）
+// 最后测一次本机回环上accept4()的开销作为对照
+
+#include "InetAddress.h"
+#include "Timestamp.h"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const int kPort = 18188;
+
+// 防止编译器把结果优化掉
+volatile size_t g_sink = 0;
+
+std::string legacyIpPort(const InetAddress& addr) {
+    char buf[64] = {0};
+    const struct sockaddr* sa = addr.getSockAddr();
+    if (addr.isIpv6()) {
+        inet_ntop(AF_INET6, &reinterpret_cast<const struct sockaddr_in6*>(sa)->sin6_addr, buf, sizeof buf);
+        return "[" + std::string(buf) + "]:" + std::to_string(addr.toPort());
+    }
+    inet_ntop(AF_INET, &reinterpret_cast<const struct sockaddr_in*>(sa)->sin_addr, buf, sizeof buf);
+    return std::string(buf) + ":" + std::to_string(addr.toPort());
+}
+
+size_t snprintfIpPort(const InetAddress& addr, char* out, size_t size) {
+    char ip[INET6_ADDRSTRLEN];
+    const struct sockaddr* sa = addr.getSockAddr();
+    if (addr.isIpv6()) {
+        inet_ntop(AF_INET6, &reinterpret_cast<const struct sockaddr_in6*>(sa)->sin6_addr, ip, sizeof ip);
+        return snprintf(out, size, "[%s]:%u", ip, addr.toPort());
+    }
+    inet_ntop(AF_INET, &reinterpret_cast<const struct sockaddr_in*>(sa)->sin_addr, ip, sizeof ip);
+    return snprintf(out, size, "%s:%u", ip, addr.toPort());
+}
+
+// 一组不同的对端地址，轮流格式化
+std::vector<InetAddress> makeAddresses(bool ipv6) {
+    std::vector<InetAddress> addrs;
+    char ip[64];
+    for (int i = 0; i < 256; ++i) {
+        if (ipv6) {
+            snprintf(ip, sizeof ip, "2001:db8:%x::%x:%x", i * 7, i, 255 - i);
+        } else {
+            snprintf(ip, sizeof ip, "10.%d.%d.%d", i, (i * 7) % 256, 255 - i);
+        }
+        addrs.push_back(InetAddress(ip, static_cast<uint16_t>(30000 + i * 100)));
+    }
+    return addrs;
+}
+
+template <typename F>
+double nsPerCall(const std::vector<InetAddress>& addrs, int calls, F format) {
+    Timestamp start = Timestamp::now();
+    for (int i = 0; i < calls; ++i) {
+        g_sink += format(addrs[i & 255]);
+    }
+    return timeDifference(Timestamp::now(), start) * 1e9 / calls;
+}
+
+void run(const char* family, bool ipv6, int calls) {
+    std::vector<InetAddress> addrs = makeAddresses(ipv6);
+    char buf[InetAddress::kMaxIpPortLength];
+    printf("%-6s %-16s %10.1f\n", family, "legacy",
+           nsPerCall(addrs, calls, [](const InetAddress& a) { return legacyIpPort(a).size(); }));
+    printf("%-6s %-16s %10.1f\n", family, "snprintf",
+           nsPerCall(addrs, calls, [&](const InetAddress& a) { return snprintfIpPort(a, buf, sizeof buf); }));
+    printf("%-6s %-16s %10.1f\n", family, "toIpPort()",
+           nsPerCall(addrs, calls, [](const InetAddress& a) { return a.toIpPort().size(); }));
+    printf("%-6s %-16s %10.1f\n", family, "toIpPort(buf)",
+           nsPerCall(addrs, calls, [&](const InetAddress& a) { return a.toIpPort(buf, sizeof buf); }));
+}
+
+// 本机回环上一次accept4()的开销（不含connect和close）
+double acceptCost(int rounds) {
+    InetAddress listenAddr("127.0.0.1", kPort);
+    int listenfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    ::setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+    if (::bind(listenfd, listenAddr.getSockAddr(), listenAddr.getSockLen()) < 0
+        || ::listen(listenfd, 128) < 0) {
+        perror("listen");
+        exit(1);
+    }
+    double total = 0;
+    for (int i = 0; i < rounds; ++i) {
+        int clientfd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(clientfd, listenAddr.getSockAddr(), listenAddr.getSockLen()) < 0) {
+            perror("connect");
+            exit(1);
+        }
+        struct sockaddr_in6 peer;
+        socklen_t len = sizeof peer;
+        Timestamp start = Timestamp::now();
+        int connfd = ::accept4(listenfd, reinterpret_cast<struct sockaddr*>(&peer), &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        total += timeDifference(Timestamp::now(), start);
+        ::close(connfd);
+        ::close(clientfd);
+    }
+    ::close(listenfd);
+    return total * 1e9 / rounds;
+}
+
+int main(int argc, char* argv[]) {
+    int calls = argc > 1 ? atoi(argv[1]) : 2000000;
+    
+    printf("%d calls per row\n", calls);
+    printf("%-6s %-16s %10s\n", "family", "method", "ns/call");
+    run("ipv4", false, calls);
+    run("ipv6", true, calls);
+    printf("\naccept4() on loopback: %.0f ns/call\n", acceptCost(2000));
+    return 0;
+}
@@ -0,0 +1,157 @@
+// 本机TCP中继的吞吐量和CPU开销：splice转发 vs 经过Buffer转发
+// 用法：./bench_relay [每种方式转发的MB数]
+//
+// 客户端 -> 中继 -> 接收端，都在本机回环上
+// 中继是一个EventLoop线程：TcpServer接受客户端，再用TcpClient连接收端，两个连接互相forwardTo()
+// 客户端用阻塞socket以64KB为单位一直写，接收端用阻塞socket一直读，从开始写到接收端读完计时
+// 中继线程的CPU（用户态+内核态）用RUSAGE_THREAD统计，换算成每GB的CPU秒数
+
+#include "TcpClient.h"
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "InetAddress.h"
+#include "EventLoop.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const int kSinkPort = 18231;
+const int kRelayPort = 18232;
+const size_t kChunkSize = 64 * 1024;
+
+double threadCpuSeconds() {
+    struct rusage usage;
+    ::getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+         + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+struct Result {
+    double seconds;
+    double relayCpu;
+    size_t spliced;
+};
+
+Result run(bool useSplice, size_t totalBytes) {
+    // 接收端：阻塞socket读完totalBytes
+    int listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    ::setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+    InetAddress sinkAddr("127.0.0.1", kSinkPort);
+    if (::bind(listenFd, sinkAddr.getSockAddr(), sinkAddr.getSockLen()) < 0 || ::listen(listenFd, 16) < 0) {
+        perror("sink");
+        exit(1);
+    }
+    std::promise<Timestamp> sinkDone;
+    std::thread sink([&]() {
+        int fd = ::accept(listenFd, nullptr, nullptr);
+        std::vector<char> buf(256 * 1024);
+        size_t received = 0;
+        while (received < totalBytes) {
+            ssize_t n = ::read(fd, buf.data(), buf.size());
+            if (n <= 0) {
+                break;
+            }
+            received += n;
+        }
+        sinkDone.set_value(Timestamp::now());
+        ::close(fd);
+    });
+    
+    // 中继
+    std::atomic<EventLoop*> loop(nullptr);
+    std::promise<double> relayStartCpu;
+    TcpServer::ConnectionPtr inbound;  // 只在loop线程访问
+    std::thread relayThread([&]() {
+        EventLoop relayLoop;
+        TcpServer server(&relayLoop, "Relay", InetAddress(kRelayPort));
+        std::unique_ptr<TcpClient> client;
+        server.setConnectionCallback([&](const TcpServer::ConnectionPtr& conn) {
+            if (!conn->connected()) {
+                return;
+            }
+            inbound = conn;
+            relayStartCpu.set_value(threadCpuSeconds());
+            client.reset(new TcpClient(&relayLoop, sinkAddr, "RelayClient"));
+            client->setConnectionCallback([&](const TcpClient::ConnectionPtr& outbound) {
+                if (outbound->connected()) {
+                    inbound->forwardTo(outbound, useSplice);
+                    outbound->forwardTo(inbound, useSplice);
+                }
+            });
+            client->connect();
+        });
+        server.start();
+        loop = &relayLoop;
+        relayLoop.loop();
+        client.reset();
+    });
+    while (loop == nullptr) {
+        ::usleep(1000);
+    }
+    
+    // 客户端
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    InetAddress relayAddr("127.0.0.1", kRelayPort);
+    if (::connect(fd, relayAddr.getSockAddr(), relayAddr.getSockLen()) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    Timestamp start = Timestamp::now();
+    std::string chunk(kChunkSize, 'r');
+    size_t sent = 0;
+    while (sent < totalBytes) {
+        ssize_t n = ::write(fd, chunk.data(), std::min(kChunkSize, totalBytes - sent));
+        if (n <= 0) {
+            break;
+        }
+        sent += n;
+    }
+    Result result;
+    result.seconds = timeDifference(sinkDone.get_future().get(), start);
+    
+    // 在中继线程里取它的CPU时间
+    double relayStart = relayStartCpu.get_future().get();
+    std::promise<void> done;
+    loop.load()->runInLoop([&]() {
+        result.relayCpu = threadCpuSeconds() - relayStart;
+        result.spliced = inbound->splicedBytes();
+        inbound.reset();
+        done.set_value();
+    });
+    done.get_future().wait();
+    ::close(fd);
+    loop.load()->quit();
+    relayThread.join();
+    sink.join();
+    ::close(listenFd);
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 4096;
+    size_t totalBytes = megabytes * 1024 * 1024;
+    double gigabytes = totalBytes / (1024.0 * 1024 * 1024);
+    
+    Logger::setLogLevel(Logger::WARN);
+    
+    printf("%zu MB through a loopback relay\n", megabytes);
+    printf("%-10s %10s %16s %14s\n", "mode", "MB/s", "relay CPU s/GB", "spliced MB");
+    for (int useSplice = 0; useSplice <= 1; ++useSplice) {
+        Result r = run(useSplice != 0, totalBytes);
+        printf("%-10s %10.0f %16.3f %14zu\n", useSplice ? "splice" : "buffered",
+               megabytes / r.seconds, r.relayCpu / gigabytes, r.spliced / (1024 * 1024));
+    }
+    return 0;
+}
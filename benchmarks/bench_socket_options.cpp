@@ -0,0 +1,116 @@
+// 每个SocketOptions预设下，新连接从connect()到收到第一个字节的延迟
+// 用法：./bench_socket_options [每个预设的连接数]
+//
+// 服务器是一个IO线程的TcpServer，收到请求就回显；客户端用阻塞socket，每次新建连接：
+// connect() -> 发64字节请求 -> 读到回显，计时到读到第一个字节为止，然后关闭
+// requestResponse预设开启了TCP_FASTOPEN，客户端用sendto(MSG_FASTOPEN)把请求放在SYN里
+// （服务端要net.ipv4.tcp_fastopen包含2才生效，否则退化成普通的三次握手，最后一列是带数据SYN的次数）
+
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "SocketOptions.h"
+#include "InetAddress.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+const int kPort = 18189;
+const size_t kRequestSize = 64;
+
+// 一次连接的延迟（微秒），synData：请求是不是跟着SYN发出去的
+double firstByte(const InetAddress& addr, bool fastOpen, bool* synData) {
+    std::string request(kRequestSize, 'r');
+    char buf[kRequestSize];
+    Timestamp start = Timestamp::now();
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    ssize_t n;
+    if (fastOpen) {
+        n = ::sendto(fd, request.data(), request.size(), MSG_FASTOPEN, addr.getSockAddr(), addr.getSockLen());
+    } else {
+        if (::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0) {
+            perror("connect");
+            exit(1);
+        }
+        n = ::write(fd, request.data(), request.size());
+    }
+    if (n != static_cast<ssize_t>(request.size()) || ::read(fd, buf, sizeof buf) <= 0) {
+        perror("request");
+        exit(1);
+    }
+    double micros = timeDifference(Timestamp::now(), start) * 1e6;
+    
+    struct tcp_info info;
+    socklen_t len = sizeof info;
+    *synData = ::getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0
+        && (info.tcpi_options & TCPI_OPT_SYN_DATA);
+    ::close(fd);
+    return micros;
+}
+
+void run(const char* name, const SocketOptions& options, int connections) {
+    std::atomic<EventLoop*> loop(nullptr);
+    std::thread serverThread([&]() {
+        EventLoop serverLoop;
+        TcpServer tcpServer(&serverLoop, "Bench", InetAddress(kPort));
+        tcpServer.setSocketOptions(options);
+        tcpServer.setMessageCallback([](const std::shared_ptr<TcpConnection>& conn, Buffer* buf) {
+            conn->send(buf);
+        });
+        tcpServer.start();
+        loop = &serverLoop;
+        serverLoop.loop();
+    });
+    while (loop == nullptr) {
+        ::usleep(1000);
+    }
+    ::usleep(50 * 1000);
+    
+    InetAddress addr("127.0.0.1", kPort);
+    bool fastOpen = options.fastOpenQueue > 0;
+    std::vector<double> samples;
+    samples.reserve(connections);
+    int synData = 0;
+    for (int i = 0; i < connections; ++i) {
+        bool withSyn = false;
+        samples.push_back(firstByte(addr, fastOpen, &withSyn));
+        synData += withSyn ? 1 : 0;
+    }
+    loop.load()->quit();
+    serverThread.join();
+    
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double s : samples) {
+        sum += s;
+    }
+    printf("%-16s %10.1f %10.1f %10.1f %10d\n", name, sum / connections, samples[connections / 2],
+           samples[connections * 99 / 100], synData);
+}
+
+int main(int argc, char* argv[]) {
+    int connections = argc > 1 ? atoi(argv[1]) : 2000;
+    
+    Logger::setLogLevel(Logger::WARN);
+    
+    printf("connect-to-first-byte: %d new connections per preset, %zu byte request echoed\n",
+           connections, kRequestSize);
+    printf("%-16s %10s %10s %10s %10s\n", "preset", "avg(us)", "p50(us)", "p99(us)", "SYN data");
+    run("default", SocketOptions(), connections);
+    run("lowLatency", SocketOptions::lowLatency(), connections);
+    run("requestResponse", SocketOptions::requestResponse(), connections);
+    run("bulk", SocketOptions::bulk(), connections);
+    return 0;
+}
@@ -0,0 +1,167 @@
+// 静态文件服务基准测试
+// 用法：./bench_static_files [连接数] [每轮秒数]
+//
+// 目录里有200个小文件（1KB~32KB）和4个大文件（4MB），
+// 混合负载：90%的请求访问小文件、10%访问大文件；另外单独测只访问小文件的情况。
+// 分别在"小文件缓存+大文件sendfile"和"关闭缓存（全部sendfile）"两种配置下运行
+
+#include "HttpServer.h"
+#include "StaticFileHandler.h"
+#include "EventLoop.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const int kPort = 18084;
+const int kSmallFiles = 200;
+const int kLargeFiles = 4;
+const size_t kLargeSize = 4 * 1024 * 1024;
+
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+// 读一个响应，返回响应体长度（-1表示出错）
+long readResponse(int fd, std::vector<char>* buf) {
+    size_t got = 0;
+    size_t headerEnd = 0;
+    while (true) {
+        ssize_t n = ::read(fd, buf->data() + got, buf->size() - got);
+        if (n <= 0) {
+            return -1;
+        }
+        got += n;
+        char* end = static_cast<char*>(memmem(buf->data(), got, "\r\n\r\n", 4));
+        if (end) {
+            headerEnd = end - buf->data() + 4;
+            break;
+        }
+    }
+    char* cl = static_cast<char*>(memmem(buf->data(), headerEnd, "Content-Length: ", 16));
+    size_t length = cl ? strtoul(cl + 16, nullptr, 10) : 0;
+    size_t remaining = headerEnd + length - got;
+    while (remaining > 0) {
+        ssize_t n = ::read(fd, buf->data(), std::min(remaining, buf->size()));
+        if (n <= 0) {
+            return -1;
+        }
+        remaining -= n;
+    }
+    return static_cast<long>(length);
+}
+
+// largePercent：访问大文件的请求占多少百分比
+void runClients(int numConnections, double seconds, int largePercent, const char* label) {
+    std::atomic<bool> stop(false);
+    std::atomic<long> requests(0);
+    std::atomic<long> bytes(0);
+    std::vector<std::thread> clients;
+    Timestamp start = Timestamp::now();
+    for (int c = 0; c < numConnections; ++c) {
+        clients.emplace_back([&, c]() {
+            int fd = connectServer();
+            std::vector<char> buf(256 * 1024);
+            unsigned seed = 12345 + c;
+            long done = 0;
+            long received = 0;
+            while (!stop) {
+                std::string path;
+                if (static_cast<int>(rand_r(&seed) % 100) < largePercent) {
+                    path = "/files/large" + std::to_string(rand_r(&seed) % kLargeFiles) + ".bin";
+                } else {
+                    path = "/files/small" + std::to_string(rand_r(&seed) % kSmallFiles) + ".js";
+                }
+                std::string req = "GET " + path + " HTTP/1.1\r\nHost: bench\r\n\r\n";
+                ::write(fd, req.data(), req.size());
+                long n = readResponse(fd, &buf);
+                if (n < 0) {
+                    fprintf(stderr, "connection closed unexpectedly\n");
+                    break;
+                }
+                ++done;
+                received += n;
+            }
+            requests += done;
+            bytes += received;
+            ::close(fd);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(seconds * 1000)));
+    stop = true;
+    for (std::thread& t : clients) {
+        t.join();
+    }
+    double elapsed = timeDifference(Timestamp::now(), start);
+    printf("%-28s %9.0f req/s %9.1f MB/s\n", label,
+           requests / elapsed, bytes / elapsed / (1024 * 1024));
+}
+
+int main(int argc, char* argv[]) {
+    int numConnections = argc > 1 ? atoi(argv[1]) : 8;
+    double seconds = argc > 2 ? atof(argv[2]) : 3.0;
+    
+    // 1. 准备文件
+    char dir[] = "/tmp/bench_static.XXXXXX";
+    if (!::mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string root = dir;
+    for (int i = 0; i < kSmallFiles; ++i) {
+        std::ofstream out(root + "/small" + std::to_string(i) + ".js");
+        out << std::string(1024 * (1 + i % 32), 'a' + i % 26);
+    }
+    for (int i = 0; i < kLargeFiles; ++i) {
+        std::ofstream out(root + "/large" + std::to_string(i) + ".bin");
+        out << std::string(kLargeSize, 'x');
+    }
+    
+    EventLoop loop;
+    HttpServer server(&loop, "BenchStaticFiles", kPort);
+    StaticFileHandler files(root);
+    server.router().GET("/files/*path", files.handler("path"));
+    server.start();
+    
+    std::thread driver([&]() {
+        printf("connections: %d, %d small files, %d x %zuMB large files\n",
+               numConnections, kSmallFiles, kLargeFiles, kLargeSize >> 20);
+        runClients(numConnections, seconds, 10, "mixed, cache + sendfile:");
+        runClients(numConnections, seconds, 0, "small only, cache:");
+        printf("  cache hits %zu, misses %zu, %zu KB cached\n",
+               files.cacheHits(), files.cacheMisses(), files.cachedBytes() >> 10);
+        files.setMaxCachedFileSize(0);
+        runClients(numConnections, seconds, 10, "mixed, all sendfile:");
+        runClients(numConnections, seconds, 0, "small only, all sendfile:");
+        loop.quit();
+    });
+    
+    loop.loop();
+    driver.join();
+    
+    std::string cleanup = "rm -rf '" + root + "'";
+    if (::system(cleanup.c_str()) != 0) {
+        fprintf(stderr, "failed to remove %s\n", root.c_str());
+    }
+    return 0;
+}
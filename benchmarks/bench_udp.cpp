@@ -0,0 +1,167 @@
+// UDP回显的包速率：recvmmsg/sendmmsg每次处理1/16/64个数据报
+// 用法：./bench_udp [数据报个数] [数据报大小]
+//
+// 服务器和客户端是两个EventLoop线程上的UdpSocket，服务器把收到的数据报原样发回，
+// 两边用同样的批大小。客户端保持kWindow个数据报在路上，每收回batch个就再发出一批（sendBatch()）
+// 回环上的数据报可能因为接收缓冲区满而丢掉，半秒没有进展时补发一个窗口
+
+#include "UdpSocket.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+
+const int kPort = 18185;
+const size_t kWindow = 128;
+
+struct Result {
+    double seconds;
+    uint64_t serverReceiveCalls;
+    uint64_t serverSendCalls;
+    uint64_t resends;
+};
+
+Result run(EventLoop* serverLoop, size_t batch, uint64_t total, size_t messageSize) {
+    // 服务器：收到一批就用一次sendmmsg()发回去
+    std::unique_ptr<UdpSocket> server;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool ready = false;
+    serverLoop->runInLoop([&]() {
+        server.reset(new UdpSocket(serverLoop, InetAddress("127.0.0.1", kPort)));
+        server->setBatchSize(batch);
+        server->setReceiveBufferSize(4 * 1024 * 1024);
+        server->setMessageCallback([](UdpSocket* s, const UdpDatagram* d, size_t n) {
+            s->sendBatch(d, n);
+        });
+        server->start();
+        std::lock_guard<std::mutex> lock(mutex);
+        ready = true;
+        cond.notify_one();
+    });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return ready; });
+    }
+    
+    EventLoopThread loopThread;
+    EventLoop* loop = loopThread.startLoop();
+    const InetAddress serverAddr("127.0.0.1", kPort);
+    const std::string message(messageSize, 'x');
+    std::vector<UdpDatagram> outgoing(kWindow, UdpDatagram(message.data(), message.size(), serverAddr));
+    
+    std::unique_ptr<UdpSocket> client;
+    uint64_t received = 0;
+    uint64_t sent = 0;
+    size_t credits = 0;
+    uint64_t lastReceived = 0;
+    Result result;
+    result.resends = 0;
+    bool done = false;
+    Timestamp begin;
+    TimerId resendTimer;
+    
+    // 有足够的额度就发一批
+    auto fill = [&](bool force) {
+        while (sent < total && (credits >= batch || (force && credits > 0))) {
+            size_t n = std::min<uint64_t>(std::min(credits, batch), total - sent);
+            client->sendBatch(outgoing.data(), n);
+            credits -= n;
+            sent += n;
+        }
+    };
+    
+    loop->runInLoop([&]() {
+        client.reset(new UdpSocket(loop, InetAddress("127.0.0.1", 0)));
+        client->setBatchSize(batch);
+        client->setReceiveBufferSize(4 * 1024 * 1024);
+        client->setMessageCallback([&](UdpSocket*, const UdpDatagram*, size_t n) {
+            received += n;
+            credits += n;
+            if (received >= total) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done = true;
+                cond.notify_one();
+                return;
+            }
+            fill(false);
+        });
+        client->start();
+        resendTimer = loop->runEvery(0.5, [&]() {
+            if (received == lastReceived && received < total) {
+                // 丢包了：在路上的都当作丢了，补发一个窗口
+                ++result.resends;
+                sent = received;
+                credits = kWindow;
+                fill(true);
+            }
+            lastReceived = received;
+        });
+        begin = Timestamp::now();
+        credits = kWindow;
+        fill(true);
+    });
+    
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return done; });
+    }
+    result.seconds = timeDifference(Timestamp::now(), begin);
+    
+    ready = false;
+    loop->runInLoop([&]() {
+        loop->cancel(resendTimer);
+        client.reset();
+        std::lock_guard<std::mutex> lock(mutex);
+        ready = true;
+        cond.notify_one();
+    });
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return ready; });
+    }
+    
+    ready = false;
+    serverLoop->runInLoop([&]() {
+        result.serverReceiveCalls = server->receiveCalls();
+        result.serverSendCalls = server->sendCalls();
+        server.reset();
+        std::lock_guard<std::mutex> lock(mutex);
+        ready = true;
+        cond.notify_one();
+    });
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [&]() { return ready; });
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t total = argc > 1 ? strtoull(argv[1], nullptr, 10) : 500000;
+    size_t messageSize = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 64;
+    
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoopThread serverThread;
+    EventLoop* serverLoop = serverThread.startLoop();
+    
+    printf("%llu datagrams of %zu bytes echoed on loopback, %zu in flight\n",
+           static_cast<unsigned long long>(total), messageSize, kWindow);
+    printf("%-8s %12s %16s %16s %8s\n", "batch", "packets/s", "recv calls/pkt", "send calls/pkt", "resends");
+    const size_t batches[] = {1, 16, 64};
+    for (size_t batch : batches) {
+        Result r = run(serverLoop, batch, total, messageSize);
+        printf("%-8zu %12.0f %16.3f %16.3f %8llu\n", batch, total / r.seconds,
+               static_cast<double>(r.serverReceiveCalls) / total,
+               static_cast<double>(r.serverSendCalls) / total,
+               static_cast<unsigned long long>(r.resends));
+    }
+    return 0;
+}
@@ -0,0 +1,184 @@
+// 回显服务器的延迟和吞吐量：Unix域socket vs 本机TCP
+// 用法：./bench_unix_echo [往返次数] [吞吐量测试的MB数]
+//
+// 服务器就是examples/echo_server的TcpServer（一个IO线程），分别监听TCP端口和Unix域socket，
+// 客户端用阻塞socket：
+// - 延迟：一个连接上64字节一问一答
+// - 吞吐量：一个连接，一个线程以64KB为单位一直写，另一个线程把回显读完
+//
+// Unix域socket没有接收缓冲区，在路上的数据只受发送端SO_SNDBUF（默认约208KB）限制，
+// 而本机TCP的窗口会自动增长到几MB，所以大块传输时要把两端的SO_SNDBUF调大（"unix 4MB"一行）
+
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "UnixAddress.h"
+#include "InetAddress.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+const int kPort = 18187;
+const size_t kMessageSize = 64;
+const size_t kChunkSize = 64 * 1024;
+const int kLargeSendBuffer = 4 * 1024 * 1024;
+
+void setSendBuffer(int fd, int bytes) {
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof bytes);
+}
+
+// 建立一个阻塞的连接
+int connectTo(bool unixDomain, const UnixAddress& unixAddr, int sendBuffer = 0) {
+    int fd;
+    int ret;
+    if (unixDomain) {
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sendBuffer > 0) {
+            setSendBuffer(fd, sendBuffer);
+        }
+        ret = ::connect(fd, unixAddr.getSockAddr(), unixAddr.getSockLen());
+    } else {
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        InetAddress addr("127.0.0.1", kPort);
+        ret = ::connect(fd, addr.getSockAddr(), addr.getSockLen());
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    }
+    if (ret < 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+bool readFully(int fd, char* buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = ::read(fd, buf + got, len - got);
+        if (n <= 0) {
+            return false;
+        }
+        got += n;
+    }
+    return true;
+}
+
+void latency(const char* name, bool unixDomain, const UnixAddress& unixAddr, int rounds) {
+    int fd = connectTo(unixDomain, unixAddr);
+    std::string message(kMessageSize, 'x');
+    char buf[kMessageSize];
+    std::vector<double> samples;
+    samples.reserve(rounds);
+    for (int i = 0; i < rounds; ++i) {
+        Timestamp start = Timestamp::now();
+        if (::write(fd, message.data(), message.size()) != static_cast<ssize_t>(message.size())
+            || !readFully(fd, buf, sizeof buf)) {
+            fprintf(stderr, "echo failed\n");
+            exit(1);
+        }
+        samples.push_back(timeDifference(Timestamp::now(), start) * 1e6);
+    }
+    ::close(fd);
+    
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (double s : samples) {
+        sum += s;
+    }
+    printf("%-10s %10.1f %10.1f %10.1f %12.0f\n", name, sum / rounds, samples[rounds / 2],
+           samples[rounds * 99 / 100], rounds / (sum / 1e6));
+}
+
+double throughput(bool unixDomain, const UnixAddress& unixAddr, size_t totalBytes, int sendBuffer = 0) {
+    int fd = connectTo(unixDomain, unixAddr, sendBuffer);
+    Timestamp start = Timestamp::now();
+    std::thread writer([fd, totalBytes]() {
+        std::string chunk(kChunkSize, 'y');
+        size_t sent = 0;
+        while (sent < totalBytes) {
+            ssize_t n = ::write(fd, chunk.data(), std::min(kChunkSize, totalBytes - sent));
+            if (n <= 0) {
+                return;
+            }
+            sent += n;
+        }
+    });
+    std::vector<char> buf(kChunkSize);
+    size_t received = 0;
+    while (received < totalBytes) {
+        ssize_t n = ::read(fd, buf.data(), buf.size());
+        if (n <= 0) {
+            break;
+        }
+        received += n;
+    }
+    double seconds = timeDifference(Timestamp::now(), start);
+    writer.join();
+    ::close(fd);
+    return totalBytes / seconds / (1024 * 1024);
+}
+
+int main(int argc, char* argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+    size_t megabytes = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 512;
+    
+    Logger::setLogLevel(Logger::WARN);
+    
+    std::string path = "/tmp/bench_unix_echo_" + std::to_string(::getpid()) + ".sock";
+    UnixAddress unixAddr(path);
+    std::string largePath = "/tmp/bench_unix_echo_large_" + std::to_string(::getpid()) + ".sock";
+    UnixAddress largeAddr(largePath);
+    
+    EventLoop loop;
+    TcpServer::MessageCallback echo = [](const std::shared_ptr<TcpConnection>& conn, Buffer* buf) {
+        conn->send(buf);
+    };
+    TcpServer tcpServer(&loop, "TcpEcho", kPort);
+    tcpServer.setThreadNum(1);
+    tcpServer.setMessageCallback(echo);
+    tcpServer.start();
+    TcpServer unixServer(&loop, "UnixEcho", unixAddr);
+    unixServer.setThreadNum(1);
+    unixServer.setMessageCallback(echo);
+    unixServer.start();
+    TcpServer largeServer(&loop, "UnixEchoLarge", largeAddr);
+    largeServer.setThreadNum(1);
+    largeServer.setMessageCallback(echo);
+    largeServer.setConnectionCallback([](const std::shared_ptr<TcpConnection>& conn) {
+        if (conn->connected()) {
+            setSendBuffer(conn->fd(), kLargeSendBuffer);
+        }
+    });
+    largeServer.start();
+    
+    std::thread client([&]() {
+        ::usleep(100 * 1000);
+        printf("latency: %d round trips of %zu bytes on one connection\n", rounds, kMessageSize);
+        printf("%-10s %10s %10s %10s %12s\n", "transport", "avg(us)", "p50(us)", "p99(us)", "round trips/s");
+        latency("tcp", false, unixAddr, rounds);
+        latency("unix", true, unixAddr, rounds);
+        
+        printf("\nthroughput: %zu MB echoed on one connection\n", megabytes);
+        printf("%-10s %10s\n", "transport", "MB/s");
+        printf("%-10s %10.0f\n", "tcp", throughput(false, unixAddr, megabytes * 1024 * 1024));
+        printf("%-10s %10.0f\n", "unix", throughput(true, unixAddr, megabytes * 1024 * 1024));
+        printf("%-10s %10.0f\n", "unix 4MB",
+               throughput(true, largeAddr, megabytes * 1024 * 1024, kLargeSendBuffer));
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    return 0;
+}
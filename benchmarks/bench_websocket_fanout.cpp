@@ -0,0 +1,232 @@
+// WebSocket广播（fan-out）基准测试
+// 用法：./bench_websocket_fanout [客户端数] [每种消息的广播次数] [IO线程数]
+//
+// 建立N个本地WebSocket连接（默认10000，受文件描述符上限限制），全部加入一个WebSocketGroup，
+// 然后由另一个线程广播消息，客户端线程用epoll收数据，直到每个客户端都收齐为止
+//
+// 除了总时间，还统计服务器IO线程（单线程模式）在用户态花的CPU时间，
+// 这部分是拼帧、拷贝、遍历连接的开销，剩下的主要是内核里的send
+//
+// 对比两种发送方式：
+//   group     —— WebSocketGroup::broadcast：帧只序列化一次，每个loop一个任务，共享同一块内存
+//   per-conn  —— 每个连接各自调用sendText：每个连接都重新拼一次帧
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "WebSocketCodec.h"
+#include "WebSocketConnection.h"
+#include "EventLoop.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const int kPort = 18087;
+
+WebSocketGroup g_group;
+std::mutex g_mutex;
+std::vector<WebSocketConnectionPtr> g_conns;   // per-conn模式用
+
+// 调用线程的用户态CPU时间（微秒）
+double threadUserMicros() {
+    struct rusage usage;
+    ::getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_utime.tv_sec * 1e6 + usage.ru_utime.tv_usec;
+}
+
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+// 每批先发出所有握手，再逐个读101，避免一万次串行的往返
+void handshakeAll(std::vector<int>* fds, int numClients) {
+    const std::string request = "GET /fanout HTTP/1.1\r\nHost: bench\r\nUpgrade: websocket\r\n"
+                                "Connection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+                                "Sec-WebSocket-Version: 13\r\n\r\n";
+    const int kBatch = 500;
+    for (int start = 0; start < numClients; start += kBatch) {
+        int end = std::min(numClients, start + kBatch);
+        for (int i = start; i < end; ++i) {
+            int fd = connectServer();
+            ::write(fd, request.data(), request.size());
+            fds->push_back(fd);
+        }
+        for (int i = start; i < end; ++i) {
+            std::string response;
+            char buf[1024];
+            while (response.find("\r\n\r\n") == std::string::npos) {
+                ssize_t n = ::read((*fds)[i], buf, sizeof buf);
+                if (n <= 0) {
+                    perror("handshake");
+                    exit(1);
+                }
+                response.append(buf, n);
+            }
+            if (response.compare(0, 12, "HTTP/1.1 101") != 0) {
+                std::cerr << "handshake failed: " << response << std::endl;
+                exit(1);
+            }
+        }
+    }
+}
+
+// 读到所有客户端都收到expected字节
+void drain(int epfd, const std::vector<int>& fds, size_t expected, std::vector<size_t>* received) {
+    size_t done = 0;
+    for (size_t r : *received) {
+        if (r >= expected) {
+            ++done;
+        }
+    }
+    struct epoll_event events[1024];
+    char buf[65536];
+    while (done < fds.size()) {
+        int n = ::epoll_wait(epfd, events, 1024, 5000);
+        if (n <= 0) {
+            std::cerr << "timeout: " << done << "/" << fds.size() << " clients done" << std::endl;
+            exit(1);
+        }
+        for (int i = 0; i < n; ++i) {
+            size_t idx = events[i].data.u32;
+            ssize_t got;
+            while ((got = ::read(fds[idx], buf, sizeof buf)) > 0) {
+                size_t before = (*received)[idx];
+                (*received)[idx] += got;
+                if (before < expected && (*received)[idx] >= expected) {
+                    ++done;
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int numClients = argc > 1 ? atoi(argv[1]) : 10000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    int ioThreads = argc > 3 ? atoi(argv[3]) : 0;
+    
+    // 每个客户端在这个进程里占两个fd（客户端 + 服务器端）
+    struct rlimit rl;
+    ::getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &rl);
+    int maxClients = static_cast<int>((rl.rlim_cur - 64) / 2);
+    if (numClients > maxClients) {
+        std::cout << "RLIMIT_NOFILE=" << rl.rlim_cur << ", clients limited to " << maxClients << std::endl;
+        numClients = maxClients;
+    }
+    
+    Logger::setLogLevel(Logger::WARN);
+    EventLoop loop;
+    HttpServer server(&loop, "BenchFanout", kPort);
+    server.setThreadNum(ioThreads);
+    WebSocketHandler handler;
+    handler.onOpen = [](const WebSocketConnectionPtr& ws, const HttpRequest&) {
+        g_group.add(ws);
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_conns.push_back(ws);
+    };
+    server.websocket("/fanout", handler);
+    server.start();
+    
+    std::thread client([&]() {
+        std::vector<int> fds;
+        Timestamp start = Timestamp::now();
+        handshakeAll(&fds, numClients);
+        while (g_group.size() < static_cast<size_t>(numClients)) {
+            usleep(1000);
+        }
+        std::cout << numClients << " clients connected in "
+                  << timeDifference(Timestamp::now(), start) << " s" << std::endl;
+        
+        int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+        for (int i = 0; i < numClients; ++i) {
+            ::fcntl(fds[i], F_SETFL, ::fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+            struct epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.u32 = i;
+            ::epoll_ctl(epfd, EPOLL_CTL_ADD, fds[i], &ev);
+        }
+        std::vector<size_t> received(numClients, 0);
+        size_t total = 0;
+        
+        std::cout << std::left << std::setw(10) << "payload" << std::setw(10) << "mode"
+                  << std::right << std::setw(12) << "time(ms)" << std::setw(16) << "deliveries/s"
+                  << std::setw(10) << "MB/s" << std::setw(16) << "user ns/msg" << std::endl;
+        const size_t payloadSizes[] = { 64, 4096 };
+        for (size_t payloadSize : payloadSizes) {
+            std::string payload(payloadSize, 'm');
+            size_t frameSize = WebSocketCodec::headerSize(payloadSize, false) + payloadSize;
+            
+            for (int mode = 0; mode < 2; ++mode) {
+                // 前后各放一个标记任务，在IO线程里读CPU时间
+                std::atomic<double> userStart(0), userEnd(-1);
+                loop.runInLoop([&userStart] { userStart = threadUserMicros(); });
+                Timestamp t0 = Timestamp::now();
+                for (int r = 0; r < rounds; ++r) {
+                    if (mode == 0) {
+                        g_group.broadcast(WebSocketMessage::text(payload));
+                    } else {
+                        // 同样是每个loop一个任务，但每个连接各自拼帧
+                        loop.runInLoop([payload] {
+                            for (const WebSocketConnectionPtr& ws : g_conns) {
+                                ws->sendText(payload);
+                            }
+                        });
+                    }
+                }
+                loop.runInLoop([&userEnd] { userEnd = threadUserMicros(); });
+                total += frameSize * rounds;
+                drain(epfd, fds, total, &received);
+                double seconds = timeDifference(Timestamp::now(), t0);
+                while (userEnd < 0) {
+                    usleep(1000);
+                }
+                double deliveries = static_cast<double>(numClients) * rounds;
+                std::cout << std::left << std::setw(10) << (std::to_string(payloadSize) + "B")
+                          << std::setw(10) << (mode == 0 ? "group" : "per-conn")
+                          << std::right << std::fixed << std::setprecision(1)
+                          << std::setw(12) << seconds * 1000
+                          << std::setw(16) << std::setprecision(0) << deliveries / seconds
+                          << std::setw(10) << deliveries * frameSize / seconds / 1e6
+                          << std::setw(16) << (userEnd - userStart) * 1000 / deliveries << std::endl;
+            }
+        }
+        
+        for (int fd : fds) {
+            ::close(fd);
+        }
+        ::close(epfd);
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    return 0;
+}
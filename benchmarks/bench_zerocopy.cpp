@@ -0,0 +1,140 @@
+// 大块发送的CPU开销：普通send() vs MSG_ZEROCOPY，每GB数据消耗的CPU秒数
+// 用法：./bench_zerocopy [每种方式发送的MB数] [每次发送的KB数]
+//
+// 服务器（一个EventLoop线程）把同一块只读数据反复发给客户端，输出积压不超过8MB，
+// 在WriteCompleteCallback里继续发送；客户端用阻塞socket一直读
+// copy用send(data, len)，每次都把数据拷贝进内核；zerocopy用sendZeroCopy(shared_ptr)
+// 发送线程的CPU（用户态+内核态）用RUSAGE_THREAD统计，接收线程单独列出
+//
+// 注意：本机回环上内核在投递时仍然要拷贝一次（完成通知带SO_EE_CODE_ZEROCOPY_COPIED，最后一列），
+// 拷贝从发送线程挪到了接收一侧，要看两边的总和；真正省掉拷贝要在支持scatter-gather的网卡上测
+
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "InetAddress.h"
+#include "EventLoop.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const int kPort = 18228;
+const size_t kMaxPending = 8 * 1024 * 1024;
+
+double threadCpuSeconds() {
+    struct rusage usage;
+    ::getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+         + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+struct Result {
+    double seconds;
+    double senderCpu;
+    double receiverCpu;
+    uint64_t copied;
+};
+
+Result run(bool zeroCopy, size_t totalBytes, size_t chunkSize) {
+    std::shared_ptr<const std::string> chunk = std::make_shared<const std::string>(chunkSize, 'z');
+    std::atomic<EventLoop*> loop(nullptr);
+    std::promise<double> senderStartCpu;
+    TcpServer::ConnectionPtr current;  // 只在loop线程访问
+    std::thread serverThread([&]() {
+        EventLoop serverLoop;
+        TcpServer server(&serverLoop, "Bench", InetAddress(kPort));
+        size_t sent = 0;
+        
+        // 积压不多时继续发送
+        auto fill = [&](const TcpServer::ConnectionPtr& conn) {
+            while (sent < totalBytes && conn->pendingOutputBytes() < kMaxPending) {
+                if (zeroCopy) {
+                    conn->sendZeroCopy(chunk);
+                } else {
+                    conn->send(chunk->data(), chunk->size());
+                }
+                sent += chunk->size();
+            }
+        };
+        server.setConnectionCallback([&](const TcpServer::ConnectionPtr& conn) {
+            if (conn->connected()) {
+                current = conn;
+                conn->setZeroCopy(zeroCopy);
+                conn->setWriteCompleteCallback(fill);
+                senderStartCpu.set_value(threadCpuSeconds());
+                fill(conn);
+            }
+        });
+        server.start();
+        loop = &serverLoop;
+        serverLoop.loop();
+    });
+    while (loop == nullptr) {
+        ::usleep(1000);
+    }
+    
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    InetAddress addr("127.0.0.1", kPort);
+    if (::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0) {
+        perror("connect");
+        exit(1);
+    }
+    double receiverStart = threadCpuSeconds();
+    Timestamp start = Timestamp::now();
+    std::vector<char> buf(256 * 1024);
+    size_t received = 0;
+    while (received < totalBytes) {
+        ssize_t n = ::read(fd, buf.data(), buf.size());
+        if (n <= 0) {
+            break;
+        }
+        received += n;
+    }
+    Result result;
+    result.seconds = timeDifference(Timestamp::now(), start);
+    result.receiverCpu = threadCpuSeconds() - receiverStart;
+    
+    // 在发送线程里取它的CPU时间和拷贝计数（等完成通知都到达）
+    double senderStart = senderStartCpu.get_future().get();
+    std::promise<void> done;
+    loop.load()->runInLoop([&]() {
+        result.senderCpu = threadCpuSeconds() - senderStart;
+        result.copied = current->zeroCopyCopied();
+        current.reset();
+        done.set_value();
+    });
+    done.get_future().wait();
+    ::close(fd);
+    loop.load()->quit();
+    serverThread.join();
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    size_t megabytes = argc > 1 ? static_cast<size_t>(atoi(argv[1])) : 4096;
+    size_t chunkKb = argc > 2 ? static_cast<size_t>(atoi(argv[2])) : 1024;
+    size_t totalBytes = megabytes * 1024 * 1024;
+    double gigabytes = totalBytes / (1024.0 * 1024 * 1024);
+    
+    Logger::setLogLevel(Logger::WARN);
+    
+    printf("%zu MB over loopback, %zu KB per send\n", megabytes, chunkKb);
+    printf("%-10s %10s %16s %18s %8s %8s\n", "mode", "MB/s", "sender CPU s/GB", "receiver CPU s/GB", "total", "copied");
+    for (int zeroCopy = 0; zeroCopy <= 1; ++zeroCopy) {
+        Result r = run(zeroCopy != 0, totalBytes, chunkKb * 1024);
+        printf("%-10s %10.0f %16.3f %18.3f %8.3f %8llu\n", zeroCopy ? "zerocopy" : "copy",
+               megabytes / r.seconds, r.senderCpu / gigabytes, r.receiverCpu / gigabytes,
+               (r.senderCpu + r.receiverCpu) / gigabytes,
+               static_cast<unsigned long long>(r.copied));
+    }
+    return 0;
+}
@@ -12,9 +12,8 @@ void onRequest(const HttpRequest& req, HttpResponse* resp) {
     std::cout << "Query: " << req.query() << std::endl;
     
     // 打印请求头
-    const auto& headers = req.headers();
-    for (const auto& header : headers) {
-        std::cout << header.first << ": " << header.second << std::endl;
+    for (int i = 0; i < req.headerCount(); ++i) {
+        std::cout << req.headerField(i) << ": " << req.headerValue(i) << std::endl;
     }
     std::cout << std::endl;
 
@@ -64,9 +63,24 @@ int main() {
     // 创建HTTP服务器，监听8080端口
     HttpServer server(&loop, "TinyHttpServer", 8080);
     
-    // 设置HTTP请求处理回调
+    // 注册路由：参数通过req.param()获取
+    server.router().GET("/users/:id", [](const HttpRequest& req, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setContentType("application/json");
+        resp->setBody("{\"id\":\"" + req.param("id").as_string() + "\"}");
+    });
+    
+    // 没有路由匹配的请求交给这个回调处理
     server.setHttpCallback(onRequest);
     
+    // 1KB以上的文本响应按Accept-Encoding压缩，大响应体在工作线程里压缩
+    server.enableCompression();
+    server.setWorkerThreadNum(2);
+    
+    // 同一个端口支持明文HTTP/2：curl --http2-prior-knowledge或curl --http2（Upgrade: h2c）
+    server.enableHttp2();
+    
     // 启动服务器
     server.start();
     
@@ -75,6 +89,7 @@ int main() {
     std::cout << "  http://localhost:8080/        - Homepage" << std::endl;
     std::cout << "  http://localhost:8080/hello   - Hello page" << std::endl;
     std::cout << "  http://localhost:8080/api/json - JSON API" << std::endl;
+    std::cout << "  http://localhost:8080/users/42 - Route with parameter" << std::endl;
     std::cout << std::endl;
     std::cout << "Press Ctrl+C to stop the server." << std::endl;
     
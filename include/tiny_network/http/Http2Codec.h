@@ -0,0 +1,115 @@
+#ifndef TINY_NETWORK_HTTP_HTTP2CODEC_H
+#define TINY_NETWORK_HTTP_HTTP2CODEC_H
+
+#include "../base/StringPiece.h"
+#include <cstddef>
+#include <cstdint>
+
+class Buffer;
+
+// Http2Codec：HTTP/2（RFC 7540）的帧格式
+//
+// 每一帧是9字节的帧头 + payload：
+//   +-----------------------------------------------+
+//   |                 Length (24)                   |
+//   +---------------+---------------+---------------+
+//   |   Type (8)    |   Flags (8)   |
+//   +-+-------------+---------------+-------------------------------+
+//   |R|                 Stream Identifier (31)                      |
+//   +=+=============================================================+
+//   |                   Frame Payload (0...)                      ...
+//   +---------------------------------------------------------------+
+//
+// 和WebSocketCodec一样直接在Buffer上解析和写入
+class Http2Codec {
+public:
+    enum FrameType {
+        kData = 0x0,
+        kHeaders = 0x1,
+        kPriority = 0x2,
+        kRstStream = 0x3,
+        kSettings = 0x4,
+        kPushPromise = 0x5,
+        kPing = 0x6,
+        kGoAway = 0x7,
+        kWindowUpdate = 0x8,
+        kContinuation = 0x9
+    };
+    
+    enum Flags {
+        kFlagEndStream = 0x1,
+        kFlagAck = 0x1,
+        kFlagEndHeaders = 0x4,
+        kFlagPadded = 0x8,
+        kFlagPriority = 0x20
+    };
+    
+    enum ErrorCode {
+        kNoError = 0x0,
+        kProtocolError = 0x1,
+        kInternalError = 0x2,
+        kFlowControlError = 0x3,
+        kSettingsTimeout = 0x4,
+        kStreamClosed = 0x5,
+        kFrameSizeError = 0x6,
+        kRefusedStream = 0x7,
+        kCancel = 0x8,
+        kCompressionError = 0x9,
+        kEnhanceYourCalm = 0xB
+    };
+    
+    enum SettingId {
+        kSettingsHeaderTableSize = 0x1,
+        kSettingsEnablePush = 0x2,
+        kSettingsMaxConcurrentStreams = 0x3,
+        kSettingsInitialWindowSize = 0x4,
+        kSettingsMaxFrameSize = 0x5,
+        kSettingsMaxHeaderListSize = 0x6
+    };
+    
+    struct FrameHeader {
+        uint32_t length;
+        uint8_t type;
+        uint8_t flags;
+        uint32_t streamId;
+    };
+    
+    static const size_t kFrameHeaderSize = 9;
+    static const uint32_t kDefaultWindowSize = 65535;
+    static const uint32_t kDefaultMaxFrameSize = 16384;
+    static const uint32_t kMaxWindowSize = 0x7FFFFFFF;
+    
+    // 客户端连接前言："PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+    static const char kClientPreface[];
+    static const size_t kClientPrefaceSize = 24;
+    
+    // 数据不足9字节返回false
+    static bool parseHeader(const char* data, size_t len, FrameHeader* header);
+    
+    static void appendFrameHeader(Buffer* out, uint32_t length, int type, int flags, uint32_t streamId);
+    static void appendFrame(Buffer* out, int type, int flags, uint32_t streamId, StringPiece payload);
+    
+    static void appendSetting(char* p, int id, uint32_t value);  // 写6字节
+    static void appendWindowUpdate(Buffer* out, uint32_t streamId, uint32_t increment);
+    static void appendRstStream(Buffer* out, uint32_t streamId, uint32_t errorCode);
+    static void appendGoAway(Buffer* out, uint32_t lastStreamId, uint32_t errorCode);
+    
+    static uint32_t readUint32(const char* p) {
+        const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+        return (static_cast<uint32_t>(u[0]) << 24) | (u[1] << 16) | (u[2] << 8) | u[3];
+    }
+    
+    static uint16_t readUint16(const char* p) {
+        const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+        return static_cast<uint16_t>((u[0] << 8) | u[1]);
+    }
+    
+    static void writeUint32(char* p, uint32_t v) {
+        p[0] = static_cast<char>(v >> 24);
+        p[1] = static_cast<char>(v >> 16);
+        p[2] = static_cast<char>(v >> 8);
+        p[3] = static_cast<char>(v);
+    }
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef TINY_NETWORK_HTTP_HTTPCOMPRESSOR_H
+#define TINY_NETWORK_HTTP_HTTPCOMPRESSOR_H
+
+#include "../base/noncopyable.h"
+#include "../base/StringPiece.h"
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+class HttpRequest;
+class HttpResponse;
+
+// HttpCompressor：响应体的gzip/deflate压缩（zlib）
+//
+// 1. 根据Accept-Encoding协商编码（支持q值，gzip优先）
+// 2. 只压缩200、文本类（text/*、JSON、JavaScript、XML、SVG）、不小于minSize的响应体
+//    文件响应体（sendfile）和Range响应不压缩
+// 3. 压缩结果放在LRU缓存里，以(编码, 长度, adler32)为key，命中后再memcmp原文确认
+//    准入策略：共享响应体（静态文件缓存）第一次就缓存；普通响应体第二次出现才缓存，
+//    每次都不一样的动态JSON不会把缓存冲掉
+//
+// 压缩是纯计算，可以在任意线程调用；缓存和统计都是线程安全的
+// 大响应体的压缩由HttpServer交给工作线程（见HttpServer::setWorkerThreadNum）
+class HttpCompressor : noncopyable {
+public:
+    enum Encoding {
+        kIdentity,   // 不压缩
+        kGzip,       // gzip（RFC 1952）
+        kDeflate     // HTTP的deflate实际是zlib格式（RFC 1950）
+    };
+    
+    // 默认：1KB以下不压缩（压缩后省下的字节还不够头部和CPU开销），zlib默认级别6
+    static const size_t kDefaultMinSize = 1024;
+    static const int kDefaultLevel = 6;
+    static const size_t kDefaultCacheCapacity = 16 * 1024 * 1024;
+    
+    HttpCompressor();
+    ~HttpCompressor();
+    
+    // 小于这个大小的响应体不压缩
+    void setMinSize(size_t size) { minSize_ = size; }
+    size_t minSize() const { return minSize_; }
+    
+    // 压缩级别1~9
+    void setLevel(int level) { level_ = level; }
+    int level() const { return level_; }
+    
+    // 缓存的总字节数上限（原文 + 压缩结果），0表示不缓存
+    void setCacheCapacity(size_t capacity);
+    
+    // 判断响应是否需要压缩，返回使用的编码（kIdentity表示不压缩）
+    // 响应体可能被压缩时会添加Vary: Accept-Encoding（即使这个客户端不支持压缩）
+    Encoding select(const HttpRequest& req, HttpResponse* resp) const;
+    
+    // 压缩resp的响应体并替换，设置Content-Encoding、把ETag变成弱ETag
+    // 先查缓存；压缩失败时响应保持原样，返回false
+    bool compressResponse(Encoding encoding, HttpResponse* resp);
+    
+    // 只查缓存，命中时替换响应体（IO线程先试一下，没命中再决定是否交给工作线程）
+    bool applyCached(Encoding encoding, HttpResponse* resp);
+    
+    // === 工具函数 ===
+    
+    // 解析Accept-Encoding，返回客户端接受的最优编码
+    static Encoding negotiate(StringPiece acceptEncoding);
+    
+    // Content-Encoding中的名字，kIdentity返回"identity"
+    static const char* encodingName(Encoding encoding);
+    
+    // Content-Type是否值得压缩（图片、视频、压缩包本身已经压缩过）
+    static bool isCompressibleType(StringPiece contentType);
+    
+    // 压缩in，结果追加到out
+    static bool compress(Encoding encoding, StringPiece in, std::string* out, int level = kDefaultLevel);
+    
+    // === 统计 ===
+    size_t cacheHits() const { return hits_; }
+    size_t cacheMisses() const { return misses_; }
+    size_t cachedBytes() const;
+    size_t bytesIn() const { return bytesIn_; }    // 被压缩的原文总字节数
+    size_t bytesOut() const { return bytesOut_; }  // 压缩后的总字节数
+
+private:
+    struct Key {
+        Encoding encoding;
+        size_t size;
+        unsigned long checksum;
+        
+        bool operator==(const Key& rhs) const {
+            return encoding == rhs.encoding && size == rhs.size && checksum == rhs.checksum;
+        }
+    };
+    
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return (key.checksum * 31 + key.size) * 4 + key.encoding;
+        }
+    };
+    
+    struct Entry {
+        std::string original;                          // 原文，命中时逐字节确认
+        std::shared_ptr<const std::string> compressed;
+    };
+    
+    static Key makeKey(Encoding encoding, StringPiece body);
+    
+    std::shared_ptr<const std::string> lookup(const Key& key, StringPiece body);
+    void insert(const Key& key, StringPiece body, const std::shared_ptr<const std::string>& compressed,
+                bool admitNow);
+    void evict();
+    
+    // 用压缩结果替换响应体
+    static void apply(Encoding encoding, const std::shared_ptr<const std::string>& compressed,
+                      HttpResponse* resp);
+    
+    size_t minSize_;
+    int level_;
+    size_t cacheCapacity_;
+    
+    mutable std::mutex mutex_;
+    std::list<Key> lru_;                            // 最近使用的在前面
+    struct Slot {
+        Entry entry;
+        std::list<Key>::iterator pos;
+    };
+    std::unordered_map<Key, Slot, KeyHash> cache_;
+    std::unordered_set<Key, KeyHash> seen_;         // 只出现过一次的响应体
+    size_t cachedBytes_;
+    
+    std::atomic<size_t> hits_;
+    std::atomic<size_t> misses_;
+    std::atomic<size_t> bytesIn_;
+    std::atomic<size_t> bytesOut_;
+};
+
+#endif
@@ -2,56 +2,310 @@
 #define TINY_NETWORK_HTTP_HTTPCONTEXT_H
 
 #include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "../net/Buffer.h"
+#include <cstddef>
+#include <string>
+#include <functional>
+#include <memory>
 
-class Buffer;  // 前向声明
+class HttpResponseStream;
+class HttpResponseWriter;
 
+// HttpContext：每个连接一个，保存HTTP请求的解析状态
+//
+// 解析时不从Buffer中取走数据，parsed_记录已经解析到请求的第几个字节，
+// 解析结果（HttpRequest）直接引用Buffer里的数据。
+// 请求处理完之后调用finishRequest()，这时才真正retrieve
+//
+// 请求体支持两种方式：
+// 1. Content-Length：请求体留在Buffer里，body()直接指向它
+// 2. Transfer-Encoding: chunked：解码到body_中（容量复用）
+//
+// 流式接收模式（设置了BodyCallback）：
+// 头部解析完后把头部拷贝到headerStore_，之后请求体每收到一段就通过回调交给用户
+// 并立即从Buffer中取走，大文件上传不会在内存里攒成一整块
+//
+// 头部（请求行 + 头部行）的总大小和头部数量有上限，防止客户端用超大的头部占满内存
+// 超时状态也保存在这里，由HttpServer维护（一般每个连接只有一个定时器）
+//
+// 每个请求用到的临时存储都属于连接，请求之间只清空不释放（保留容量）：
+// 请求的头部、路径、参数是Buffer里的偏移，响应（response()）和输出缓冲区（output()）复用，
+// keep-alive连接上稳定之后处理一个普通请求不需要堆分配
 class HttpContext {
 public:
     // HTTP请求解析状态
     enum HttpRequestParseState {
         kExpectRequestLine,  // 等待解析请求行
-        kExpectHeaders,      // 等待解析请求头部  
-        kExpectBody,         // 等待解析请求体
+        kExpectHeaders,      // 等待解析请求头部
+        kExpectBody,         // 等待解析请求体（Content-Length）
+        kExpectChunkSize,    // 等待chunk大小行
+        kExpectChunkData,    // 等待chunk数据
+        kExpectChunkEnd,     // 等待chunk数据后的\r\n
+        kExpectTrailers,     // 等待最后一个chunk之后的trailer
         kGotAll             // 解析完成
     };
-
+    
+    // 连接当前所处的超时阶段
+    enum TimeoutPhase {
+        kNoTimeout,          // 不计时（升级后、等待工作线程、超时关闭了）
+        kHeaderTimeout,      // 等待请求头部收完（从请求的第一个字节开始计算总时间）
+        kBodyTimeout,        // 等待请求体（两次读之间的间隔）
+        kIdleTimeout,        // keep-alive连接空闲，等待下一个请求
+        kLingerTimeout       // 已经发出错误响应并关闭了写端，等待对方关闭
+    };
+    
+    // 流式接收请求体的回调：每收到一段解码后的数据调用一次
+    using BodyCallback = std::function<void(const HttpRequest&, StringPiece chunk)>;
+    
+    // 默认请求体上限：8MB
+    static const size_t kDefaultMaxBodySize = 8 * 1024 * 1024;
+    // 默认头部大小上限：32KB
+    static const size_t kDefaultMaxHeaderSize = 32 * 1024;
+    // chunk大小行（包括扩展）的长度上限
+    static const size_t kMaxChunkSizeLine = 1024;
+    
     HttpContext()
-        : state_(kExpectRequestLine)
+        : state_(kExpectRequestLine),
+          parsed_(0),
+          headerSize_(0),
+          bodyRemaining_(0),
+          bodyReceived_(0),
+          bodyOffset_(0),
+          trailerSize_(0),
+          trailerCount_(0),
+          maxBodySize_(kDefaultMaxBodySize),
+          maxHeaderSize_(kDefaultMaxHeaderSize),
+          maxHeaderCount_(HttpRequest::kMaxHeaders),
+          headersDetached_(false),
+          expectContinue_(false),
+          paused_(false),
+          requestCount_(0),
+          errorStatus_(0),
+          timeoutPhase_(kNoTimeout),
+          response_(false)
     {
     }
-
+    
     // 核心解析函数：从Buffer中解析HTTP请求
-    // 返回true表示解析成功，false表示需要更多数据
+    // 返回true表示目前为止没有错误（是否完整看gotAll()），false表示请求格式错误
     bool parseRequest(Buffer* buf, Timestamp receiveTime);
-
+    
     // 判断是否解析完成
-    bool gotAll() const { 
-        return state_ == kGotAll; 
+    bool gotAll() const {
+        return state_ == kGotAll;
     }
-
+    
+    // 头部已经解析完，正在等待请求体
+    bool expectingBody() const {
+        return state_ > kExpectHeaders && state_ < kGotAll;
+    }
+    
+    // 客户端发送了Expect: 100-continue，需要先回复100再等请求体
+    // 只返回一次true
+    bool takeExpectContinue() {
+        bool expect = expectContinue_;
+        expectContinue_ = false;
+        return expect;
+    }
+    
+    // 解析失败时应该返回的HTTP状态码（400、413、414或431）
+    int errorStatus() const {
+        return errorStatus_;
+    }
+    
+    // 当前请求在Buffer中已经解析的字节数
+    size_t parsedBytes() const {
+        return parsed_;
+    }
+    
+    // 请求体大小上限（流式接收模式不受限制）
+    void setMaxBodySize(size_t size) {
+        maxBodySize_ = size;
+    }
+    
+    // 头部大小上限：请求行超过时返回414，整个头部超过时返回431
+    void setMaxHeaderSize(size_t size) {
+        maxHeaderSize_ = size;
+    }
+    
+    // 头部数量上限（不超过HttpRequest::kMaxHeaders），超过返回431
+    void setMaxHeaderCount(int count) {
+        maxHeaderCount_ = count < HttpRequest::kMaxHeaders ? count : HttpRequest::kMaxHeaders;
+    }
+    
+    // 设置流式接收回调（设置后请求体不再缓存）
+    void setBodyCallback(const BodyCallback& cb) {
+        bodyCallback_ = cb;
+    }
+    
+    // 响应交给了工作线程，完成之前暂停解析后面的请求（pipelining下响应必须按请求顺序发送）
+    // 这是连接级别的状态，reset()不清除
+    void setPaused(bool on) {
+        paused_ = on;
+    }
+    
+    bool paused() const {
+        return paused_;
+    }
+    
+    // 正在发送的流式响应体（连接级别）：发完之前连接是暂停的，连接断开时要通知它
+    // 只保存weak_ptr，stream由业务方持有
+    void setStream(const std::shared_ptr<HttpResponseStream>& stream) {
+        stream_ = stream;
+    }
+    
+    std::shared_ptr<HttpResponseStream> stream() const {
+        return stream_.lock();
+    }
+    
+    // 流式业务回调正在接收请求体的请求（头部收完时设置，请求体收完或者连接断开时清除）
+    // 期间即使暂停了（响应还没有完成），也要继续解析这个请求的请求体
+    void setBodyWriter(std::shared_ptr<HttpResponseWriter> writer) {
+        bodyWriter_ = std::move(writer);
+    }
+    
+    const std::shared_ptr<HttpResponseWriter>& bodyWriter() const {
+        return bodyWriter_;
+    }
+    
+    // 这个连接上已经处理完的请求数（连接级别，reset()不清除）
+    size_t requestCount() const {
+        return requestCount_;
+    }
+    
+    // 连接升级成了其他协议（WebSocket等），之后的数据交给upgrade.onMessage
+    void setUpgrade(HttpResponse::Upgrade upgrade) {
+        upgrade_ = std::move(upgrade);
+    }
+    
+    bool upgraded() const {
+        return static_cast<bool>(upgrade_.onMessage);
+    }
+    
+    const HttpResponse::Upgrade& upgrade() const {
+        return upgrade_;
+    }
+    
+    // === 超时（连接级别，reset()不清除） ===
+    // 阶段和到期时间由HttpServer在每次读之后更新，定时器到期时再和deadline比较
+    // 这样每次读只是更新两个字段，不需要取消和重新添加定时器
+    void setTimeout(TimeoutPhase phase, Timestamp deadline) {
+        timeoutPhase_ = phase;
+        deadline_ = deadline;
+    }
+    
+    TimeoutPhase timeoutPhase() const {
+        return timeoutPhase_;
+    }
+    
+    Timestamp deadline() const {
+        return deadline_;
+    }
+    
+    // 已经启动的定时器的到期时间（无效表示没有定时器）
+    // 到期时间不比它早的deadline不需要新的定时器，到期时发现还没超时再重新启动
+    void setTimerExpiry(Timestamp expiry) {
+        timerExpiry_ = expiry;
+    }
+    
+    Timestamp timerExpiry() const {
+        return timerExpiry_;
+    }
+    
+    // 把解析完的请求（头部和请求体）拷贝到store，out引用store里的数据
+    // 请求要交给其他线程处理时使用：之后IO线程继续往Buffer里读数据，原来的请求可能搬家
+    void copyRequest(std::string* store, HttpRequest* out) const;
+    
+    // 请求处理完毕：从Buffer中取走这个请求，并重置状态准备解析下一个
+    // 超时阶段回到kNoTimeout，下一个请求（或空闲）重新计时
+    void finishRequest(Buffer* buf);
+    
     // 重置解析状态（用于复用Context对象）
     void reset() {
         state_ = kExpectRequestLine;
-        // 使用swap技术安全地清空request_
-        HttpRequest dummy;
-        request_.swap(dummy);
+        parsed_ = 0;
+        headerSize_ = 0;
+        bodyRemaining_ = 0;
+        bodyReceived_ = 0;
+        bodyOffset_ = 0;
+        trailerSize_ = 0;
+        trailerCount_ = 0;
+        headersDetached_ = false;
+        expectContinue_ = false;
+        errorStatus_ = 0;
+        body_.clear();  // 只清空内容，保留容量
+        request_.reset();
     }
-
+    
+    // 这个连接复用的响应对象，每个请求开始时reset
+    HttpResponse& response() {
+        return response_;
+    }
+    
+    // 这个连接复用的输出缓冲区，一次onMessage的所有响应攒在这里一起发送
+    Buffer* output() {
+        return &output_;
+    }
+    
     // 获取解析结果
-    const HttpRequest& request() const { 
-        return request_; 
+    const HttpRequest& request() const {
+        return request_;
     }
     
-    HttpRequest& request() { 
-        return request_; 
+    HttpRequest& request() {
+        return request_;
     }
 
 private:
     // 解析请求行：GET /path?query HTTP/1.1
     bool processRequestLine(const char* begin, const char* end);
-
+    
+    // 头部结束后，根据Content-Length/Transfer-Encoding决定下一个状态
+    bool processHeadersEnd(Buffer* buf);
+    
+    // 解析chunk大小行
+    bool processChunkSize(const char* begin, const char* end);
+    
+    // 收到一段chunked请求体数据
+    void onChunkData(const char* data, size_t len);
+    
+    // 流式模式：把头部拷贝出来，Buffer里的数据可以边收边取走
+    void detachHeaders(Buffer* buf);
+    
+    bool fail(int status) {
+        errorStatus_ = status;
+        return false;
+    }
+    
     HttpRequestParseState state_;  // 当前解析状态
+    size_t parsed_;                // 已解析的字节数（相对于Buffer的peek()）
+    size_t headerSize_;            // 请求行加头部的字节数（包括最后的空行）
+    size_t bodyRemaining_;         // 当前Content-Length请求体/chunk还差多少字节
+    size_t bodyReceived_;          // chunked请求体目前的总长度（检查上限用）
+    size_t bodyOffset_;            // Content-Length请求体在Buffer中的偏移
+    size_t trailerSize_;           // chunked请求体后面trailer部分已经解析的字节数
+    int trailerCount_;             // trailer行数
+    size_t maxBodySize_;           // 请求体大小上限
+    size_t maxHeaderSize_;         // 头部大小上限
+    int maxHeaderCount_;           // 头部数量上限
+    bool headersDetached_;         // 头部是否已经拷贝到headerStore_
+    bool expectContinue_;          // 是否需要回复100 Continue
+    bool paused_;                  // 等待工作线程生成响应
+    size_t requestCount_;          // 已经处理完的请求数
+    int errorStatus_;              // 解析失败的状态码
+    TimeoutPhase timeoutPhase_;    // 当前的超时阶段
+    Timestamp deadline_;           // 当前阶段的到期时间
+    Timestamp timerExpiry_;        // 定时器的到期时间
+    std::string body_;             // chunked解码后的请求体
+    std::string headerStore_;      // 流式模式下保存头部
+    BodyCallback bodyCallback_;    // 流式接收回调
     HttpRequest request_;          // 解析结果存储
+    HttpResponse response_;        // 复用的响应
+    Buffer output_;                // 复用的输出缓冲区
+    HttpResponse::Upgrade upgrade_;  // 升级后的协议
+    std::weak_ptr<HttpResponseStream> stream_;  // 正在发送的流式响应体
+    std::shared_ptr<HttpResponseWriter> bodyWriter_;  // 正在流式接收请求体的请求
 };
 
-#endif
\ No newline at end of file
+#endif
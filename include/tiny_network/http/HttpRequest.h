@@ -2,13 +2,24 @@
 #define TINY_NETWORK_HTTP_HTTPREQUEST_H
 
 #include "../base/Timestamp.h"
-#include <string>
-#include <unordered_map>
+#include "../base/StringPiece.h"
+#include <cstdint>
 
+// HttpRequest：解析后的HTTP请求
+//
+// 零拷贝设计：
+// 请求行和头部都不拷贝，只记录它们相对于请求起始位置（base_）的偏移和长度
+// base_指向输入Buffer中这个请求的第一个字节，请求处理完之前Buffer不会retrieve，
+// 所以path()/getHeader()返回的StringPiece直接指向Buffer里的数据
+//
+// 为什么记录偏移而不是指针？
+// 请求没收完时Buffer可能扩容（数据搬家），偏移不受影响，只需要重新设置base_
+//
+// 注意：返回的StringPiece只在请求处理期间有效，需要保存请使用as_string()
 class HttpRequest {
 public:
     // HTTP方法枚举 - 用枚举比字符串更高效和类型安全
-    enum Method { 
+    enum Method {
         kInvalid,   // 无效方法
         kGet,       // GET请求
         kPost,      // POST请求
@@ -18,37 +29,55 @@ public:
     };
     
     // HTTP版本枚举
-    enum Version { 
+    enum Version {
         kUnknown,   // 未知版本
         kHttp10,    // HTTP/1.0
-        kHttp11     // HTTP/1.1
+        kHttp11,    // HTTP/1.1
+        kHttp20     // HTTP/2（由Http2Connection从HEADERS帧构造）
     };
-
+    
+    // 头部数量上限（固定数组，不做堆分配）
+    static const int kMaxHeaders = 64;
+    // 路由参数数量上限
+    static const int kMaxParams = 8;
+    
     // 构造函数 - 初始化为无效状态
     HttpRequest()
-        : method_(kInvalid),
-          version_(kUnknown)
-    {        
+        : base_(nullptr),
+          method_(kInvalid),
+          version_(kUnknown),
+          numHeaders_(0),
+          numParams_(0)
+    {
     }
-
+    
     // === 设置方法（解析器会用到） ===
     
+    // 设置请求起始位置，之后所有的偏移都相对于它
+    void setBase(const char* base) {
+        base_ = base;
+    }
+    
+    const char* base() const {
+        return base_;
+    }
+    
     // 设置HTTP版本
     void setVersion(Version v) {
         version_ = v;
     }
     
-    // 设置HTTP方法（从字符串解析）
+    // 设置HTTP方法（从字符串解析，不构造临时string）
     bool setMethod(const char* start, const char* end);
     
     // 设置请求路径
     void setPath(const char* start, const char* end) {
-        path_.assign(start, end);
+        path_ = makeSlice(start, end);
     }
     
     // 设置查询参数 (?name=value&key=data)
     void setQuery(const char* start, const char* end) {
-        query_.assign(start, end);
+        query_ = makeSlice(start, end);
     }
     
     // 设置接收时间
@@ -56,45 +85,116 @@ public:
         receiveTime_ = t;
     }
     
-    // 添加请求头
-    void addHeader(const char* start, const char* colon, const char* end);
-
+    // 添加请求头，头部太多时返回false
+    bool addHeader(const char* start, const char* colon, const char* end);
+    
+    // 设置请求体（请求完整后由解析器设置，可能指向Buffer或解码后的数据）
+    void setBody(StringPiece body) {
+        body_ = body;
+    }
+    
     // === 获取方法（用户业务逻辑会用到） ===
     
     Method method() const { return method_; }
     Version version() const { return version_; }
-    const std::string& path() const { return path_; }
-    const std::string& query() const { return query_; }
+    StringPiece path() const { return toPiece(path_); }
+    StringPiece query() const { return toPiece(query_); }
     Timestamp receiveTime() const { return receiveTime_; }
     
+    // 请求体（流式接收模式下为空，数据已经通过回调交给用户）
+    StringPiece body() const { return body_; }
+    
     // 获取方法字符串表示
-    const char* methodString() const;
+    const char* methodString() const {
+        return methodName(method_);
+    }
+    static const char* methodName(Method method);
     
-    // 获取指定请求头的值
-    std::string getHeader(const std::string& field) const;
+    // 获取指定请求头的值（名称不区分大小写），找不到返回空
+    StringPiece getHeader(StringPiece field) const;
     
-    // 获取所有请求头
-    const std::unordered_map<std::string, std::string>& headers() const {
-        return headers_;
+    // 遍历所有请求头
+    int headerCount() const { return numHeaders_; }
+    StringPiece headerField(int i) const { return toPiece(headers_[i].field); }
+    StringPiece headerValue(int i) const { return toPiece(headers_[i].value); }
+    
+    // === 路由参数（由HttpRouter在匹配时设置） ===
+    
+    // 获取路由参数，如/users/:id中的id，找不到返回空
+    // 返回值指向请求路径，没有做百分号解码
+    StringPiece param(StringPiece name) const;
+    
+    int paramCount() const { return numParams_; }
+    StringPiece paramName(int i) const { return params_[i].name; }
+    StringPiece paramValue(int i) const { return params_[i].value; }
+    
+    // 参数太多时返回false
+    bool addParam(StringPiece name, StringPiece value) {
+        if (numParams_ >= kMaxParams) {
+            return false;
+        }
+        params_[numParams_].name = name;
+        params_[numParams_].value = value;
+        ++numParams_;
+        return true;
     }
+    void popParam() { --numParams_; }
+    void clearParams() { numParams_ = 0; }
     
-    // 交换两个HttpRequest对象（异常安全）
-    void swap(HttpRequest& rhs) {
-        std::swap(method_, rhs.method_);
-        std::swap(version_, rhs.version_);
-        path_.swap(rhs.path_);
-        query_.swap(rhs.query_);
-        std::swap(receiveTime_, rhs.receiveTime_);
-        headers_.swap(rhs.headers_);
+    // 清空，准备解析下一个请求（O(1)，不释放任何内存）
+    void reset() {
+        base_ = nullptr;
+        method_ = kInvalid;
+        version_ = kUnknown;
+        path_ = Slice();
+        query_ = Slice();
+        receiveTime_ = Timestamp();
+        body_ = StringPiece();
+        numHeaders_ = 0;
+        numParams_ = 0;
     }
 
 private:
+    // 一段数据相对于base_的位置
+    struct Slice {
+        Slice() : offset(0), length(0) {}
+        uint32_t offset;
+        uint32_t length;
+    };
+    
+    struct Header {
+        Slice field;
+        Slice value;
+    };
+    
+    // 路由参数：名称指向路由树，值指向请求路径
+    struct Param {
+        StringPiece name;
+        StringPiece value;
+    };
+    
+    Slice makeSlice(const char* start, const char* end) const {
+        Slice s;
+        s.offset = static_cast<uint32_t>(start - base_);
+        s.length = static_cast<uint32_t>(end - start);
+        return s;
+    }
+    
+    StringPiece toPiece(Slice s) const {
+        return StringPiece(base_ + s.offset, s.length);
+    }
+    
+    const char* base_;                 // 请求起始位置（指向输入Buffer）
     Method method_;                    // HTTP方法
     Version version_;                  // HTTP版本
-    std::string path_;                 // 请求路径 /api/hello
-    std::string query_;                // 查询参数 name=world&key=value
+    Slice path_;                       // 请求路径 /api/hello
+    Slice query_;                      // 查询参数 name=world&key=value
     Timestamp receiveTime_;            // 请求接收时间
-    std::unordered_map<std::string, std::string> headers_;  // 请求头键值对
+    StringPiece body_;                 // 请求体
+    int numHeaders_;                   // 已解析的头部数量
+    Header headers_[kMaxHeaders];      // 请求头（按出现顺序保存）
+    int numParams_;                    // 路由参数数量
+    Param params_[kMaxParams];         // 路由参数
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,133 @@
+#ifndef TINY_NETWORK_HTTP_HTTPRESPONSESTREAM_H
+#define TINY_NETWORK_HTTP_HTTPRESPONSESTREAM_H
+
+#include "../base/noncopyable.h"
+#include "../base/StringPiece.h"
+#include "../net/Buffer.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+class EventLoop;
+class TcpConnection;
+class HttpResponseStream;
+
+using HttpResponseStreamPtr = std::shared_ptr<HttpResponseStream>;
+
+// HttpResponseStream：分块发送一个HTTP/1.x响应体
+//
+// 业务回调用HttpResponse::setStream()代替setBody()，头部发出后HttpServer创建stream交给它
+// 响应体一块一块写进连接，不需要先在内存里拼出整个响应体：
+//   write()    —— 一块内存数据（分块编码时就是一个chunk）
+//   sendFile() —— 文件的一段，用sendfile发送，不经过用户态
+//   pull()     —— 生成器，连接可写时由stream反复调用，直到生成器返回false
+//
+// 流量控制：连接积压的数据超过高水位时writable()变为false，
+// 积压的数据全部写到socket之后调用WritableCallback（pull()自动暂停和继续）
+// 对端读得慢时服务器只缓存一个高水位左右的数据，而不是整个响应体
+//
+// write()/sendFile()/finish()可以在任意线程调用，不在IO线程时数据先拷贝一份再转到IO线程
+// 生成器和WritableCallback都在IO线程调用
+// 结束时必须调用finish()（pull()的生成器返回false时自动调用），之后连接才继续处理下一个请求
+// HttpServer只持有weak_ptr：业务方持有stream直到finish()，没有finish()就销毁时连接被断开
+class HttpResponseStream : noncopyable,
+                           public std::enable_shared_from_this<HttpResponseStream> {
+public:
+    // 积压的数据写完了（或者连接断开了，closed()为true），可以继续写
+    using WritableCallback = std::function<void(const HttpResponseStreamPtr&)>;
+    
+    // 生成器：把下一段数据追加到chunk，返回false表示这是最后一段
+    using Generator = std::function<bool(std::string* chunk)>;
+    
+    // 流结束后在IO线程调用，ok为false表示连接断开了或者写的长度和Content-Length不符
+    using FinishCallback = std::function<void(const std::shared_ptr<TcpConnection>&, bool ok)>;
+    
+    // 默认高水位：连接积压超过64KB就停下来等
+    static const size_t kDefaultHighWaterMark = 64 * 1024;
+    
+    // pull()每次攒够这么多数据再作为一个chunk发送，生成器一次只返回一行也不会变成很多小包
+    static const size_t kPullChunkSize = 16 * 1024;
+    
+    // chunked为true时每一块加上分块编码；length >= 0时写的总长度必须等于length
+    HttpResponseStream(const std::shared_ptr<TcpConnection>& conn, bool chunked, int64_t length,
+                       const FinishCallback& cb);
+    ~HttpResponseStream();
+    
+    EventLoop* getLoop() const { return loop_; }
+    
+    // 写一块响应体，连接断开、已经finish或者超过Content-Length时返回false
+    // 返回true也可能已经超过高水位，需要检查writable()
+    bool write(StringPiece data);
+    
+    // 发送文件的[offset, offset + length)，stream接管fd（失败时也会close）
+    bool sendFile(int fd, off_t offset, size_t length);
+    
+    // 响应体结束：分块编码时发送最后的0长度chunk，只有第一次调用有效
+    void finish();
+    
+    // 由stream驱动生成器：连接可写时调用gen，积压超过高水位时暂停，写完后继续，gen返回false时finish()
+    void pull(Generator gen);
+    
+    // 积压的数据在高水位以下，并且连接没有断开
+    bool writable() const { return !blocked_ && !closed_; }
+    
+    // 连接已经断开，之后写的数据都会被丢弃
+    bool closed() const { return closed_; }
+    
+    // 超过高水位之后，积压的数据写完时在IO线程调用
+    void setWritableCallback(const WritableCallback& cb) { writableCallback_ = cb; }
+    
+    void setHighWaterMark(size_t bytes) { highWaterMark_ = bytes; }
+    
+    // 已经写入的响应体字节数（不含分块编码）
+    uint64_t bytesWritten() const { return written_; }
+
+private:
+    friend class HttpServer;
+    
+    // 开始接收连接的写完成通知（HttpServer在调用业务的StreamCallback之前调用）
+    void start();
+    
+    // 连接断开（HttpServer在连接关闭时调用）：丢掉生成器，通知WritableCallback
+    void abort();
+    
+    // 连接的数据全部写出了
+    void onWriteComplete();
+    
+    // 以下在IO线程执行
+    bool writeInLoop(const char* data, size_t len);
+    bool sendFileInLoop(int fd, off_t offset, size_t length);
+    void finishInLoop();
+    void pullInLoop();
+    
+    // 分块编码的chunk头："<十六进制长度>\r\n"
+    void appendChunkSize(size_t len);
+    
+    // 写入之后检查积压的数据有没有超过高水位
+    void updateBlocked(TcpConnection* conn);
+    
+    // 写之前检查连接和长度，返回连接（失败时为空）
+    std::shared_ptr<TcpConnection> prepareWrite(size_t len);
+    
+    std::weak_ptr<TcpConnection> conn_;
+    EventLoop* loop_;
+    bool chunked_;                  // 是否使用分块编码
+    int64_t length_;                // Content-Length，-1表示未知
+    uint64_t written_;              // 已经写入的字节数（IO线程）
+    size_t highWaterMark_;          // 高水位
+    std::atomic<bool> blocked_;     // 积压超过高水位，等待写完
+    std::atomic<bool> closed_;      // 连接已经断开
+    std::atomic<bool> finished_;    // 已经调用finish()
+    bool failed_;                   // 长度不符，连接不能复用
+    WritableCallback writableCallback_;
+    Generator generator_;           // pull()的生成器
+    HttpResponseStreamPtr self_;    // pull()期间由stream自己保证存活，finish/abort时释放
+    std::string pullBuffer_;        // 生成器的输出（复用容量）
+    Buffer chunk_;                  // 拼chunk头和小块数据（复用容量）
+    FinishCallback finishCallback_;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef TINY_NETWORK_HTTP_HTTPRESPONSEWRITER_H
+#define TINY_NETWORK_HTTP_HTTPRESPONSEWRITER_H
+
+#include "../base/noncopyable.h"
+#include "../base/StringPiece.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+
+class EventLoop;
+class HttpContext;
+class TcpConnection;
+class HttpResponseWriter;
+
+using HttpResponseWriterPtr = std::shared_ptr<HttpResponseWriter>;
+
+// HttpResponseWriter：异步完成一个HTTP/1.x请求
+//
+// 业务回调交给工作线程（HttpServer::setHandlerOffload）或者异步回调（setAsyncHttpCallback）时，
+// 请求被拷贝一份放在writer里，之后IO线程可以继续往连接的Buffer里读数据
+// 处理函数填好response()之后调用send()，可以在任意线程调用，响应回到连接所在的IO线程发送
+//
+// 同一个连接上的下一个请求要等这个响应发出去才开始处理（pipelining的响应顺序不变）
+// 没有调用send()就销毁了writer时自动回复500，连接不会一直等下去
+//
+// 流式业务回调（HttpServer::setStreamingHttpCallback）在头部收完时就拿到writer，
+// 请求体随后通过BodyCallback一段一段交给业务，响应可以在请求体收完之前发送
+class HttpResponseWriter : noncopyable,
+                           public std::enable_shared_from_this<HttpResponseWriter> {
+public:
+    // 回到IO线程之后调用，writer为空表示没有调用send()（要回复500）
+    using CompleteCallback = std::function<void(const std::shared_ptr<TcpConnection>&, HttpResponseWriter*)>;
+    
+    // 流式接收的请求体：chunk是解码后的一段数据，end为true表示请求体结束（这时chunk为空）
+    // 连接在请求体收完之前断开时也以end为true调用，这时aborted()为true
+    using BodyCallback = std::function<void(StringPiece chunk, bool end)>;
+    
+    // 拷贝context当前解析完的请求
+    HttpResponseWriter(const std::shared_ptr<TcpConnection>& conn, const HttpContext& context,
+                       bool close, const CompleteCallback& cb);
+    ~HttpResponseWriter();
+    
+    // 连接所在的IO线程
+    EventLoop* getLoop() const { return loop_; }
+    
+    // 请求（writer自己的拷贝，在writer销毁之前一直有效）
+    const HttpRequest& request() const { return request_; }
+    HttpRequest& request() { return request_; }
+    
+    // 要发送的响应，send()之后不能再修改
+    HttpResponse* response() { return &response_; }
+    
+    // 完成响应，只有第一次调用有效
+    void send();
+    
+    bool sent() const { return sent_; }
+    
+    // === 流式接收请求体（只用于流式业务回调，都在IO线程调用） ===
+    // 设置之前到达的数据先攒在writer里，设置时立即交给cb；请求体已经结束时直接以end调用
+    void setBodyCallback(const BodyCallback& cb);
+    
+    // 请求体的流量控制：下游消费不过来时暂停读连接，消费完后恢复（请求体结束后无效）
+    void pauseBody();
+    void resumeBody();
+    
+    // 请求体已经收完（或者连接断开了）
+    bool bodyComplete() const { return bodyDone_; }
+    
+    // 请求体收完之前连接断开了
+    bool aborted() const { return aborted_; }
+
+private:
+    friend class HttpServer;
+    
+    // 请求没有交给处理函数（如工作线程队列满了），HttpServer自己回复，writer直接丢弃
+    void discard() { sent_ = true; }
+    
+    // HttpServer交来一段请求体 / 请求体结束
+    void deliverBody(StringPiece chunk);
+    void endBody(bool aborted);
+    
+    std::weak_ptr<TcpConnection> conn_;
+    EventLoop* loop_;
+    CompleteCallback completeCallback_;
+    std::string requestData_;       // 请求的头部和请求体
+    HttpRequest request_;           // 引用requestData_
+    HttpResponse response_;
+    std::atomic<bool> sent_;
+    BodyCallback bodyCallback_;     // 流式接收请求体
+    std::string pendingBody_;       // 设置BodyCallback之前到达的请求体
+    bool bodyDone_;                 // 请求体已经结束
+    bool aborted_;                  // 请求体收完之前连接断开了
+};
+
+#endif
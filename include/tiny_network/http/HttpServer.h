@@ -3,37 +3,166 @@
 
 #include "../base/noncopyable.h"
 #include "../base/Timestamp.h"
+#include "../base/StringPiece.h"
+#include "../base/ThreadPool.h"
 #include "../net/TcpServer.h"
+#include "HttpRouter.h"
+#include "HttpCompressor.h"
+#include "WebSocketConnection.h"
+#include "HttpResponseWriter.h"
+#include "HttpResponseStream.h"
 #include <functional>
+#include <memory>
 #include <string>
 
 class HttpRequest;
 class HttpResponse;
 class Buffer;
 class TcpConnection;
+class HttpContext;
+class Http2Connection;
 
 class HttpServer : noncopyable {
 public:
     // HTTP业务回调函数类型
     using HttpCallback = std::function<void(const HttpRequest&, HttpResponse*)>;
-
+    // 流式接收请求体的回调：请求体每到达一段调用一次，全部收完后再调用HttpCallback
+    using BodyCallback = std::function<void(const HttpRequest&, StringPiece chunk)>;
+    // 异步业务回调：填好writer->response()之后调用writer->send()，可以在任意线程、任意时刻完成
+    using AsyncHttpCallback = std::function<void(const HttpRequest&, const HttpResponseWriterPtr&)>;
+    
     // 构造函数（适配TcpServer接口）
     HttpServer(EventLoop* loop, 
               const std::string& name,
               int port);
     
     ~HttpServer();
-
+    
     // 获取事件循环
     EventLoop* getLoop() const { 
         return server_.getLoop(); 
     }
-
+    
+    // IO线程数，0表示所有连接都在getLoop()上处理（start()之前设置）
+    void setThreadNum(int numThreads) {
+        server_.setThreadNum(numThreads);
+    }
+    
     // 设置HTTP业务回调（用户提供）
+    // 配置了路由时，只有没有路由匹配的请求才会交给这个回调
     void setHttpCallback(const HttpCallback& cb) {
         httpCallback_ = cb;
     }
     
+    // 设置异步业务回调（HTTP/1.x）：路由没有匹配的请求交给它，代替HttpCallback
+    // 回调本身在IO线程调用（开启setHandlerOffload时在工作线程），响应由writer在之后发送
+    void setAsyncHttpCallback(const AsyncHttpCallback& cb) {
+        asyncHttpCallback_ = cb;
+    }
+    
+    // 流式业务回调（HTTP/1.x）：请求头部收完就调用，不等请求体，回调在IO线程执行
+    // 请求体之后通过writer->setBodyCallback()一段一段交给业务，不在内存里攒成一整块，
+    // 也不受setMaxBodySize限制（反向代理转发上传这类场景）。响应仍然通过writer->send()完成
+    // 设置后所有HTTP/1.x请求都交给它，路由、HttpCallback和异步回调不再使用
+    void setStreamingHttpCallback(const AsyncHttpCallback& cb) {
+        streamingHttpCallback_ = cb;
+    }
+    
+    // 每个IO线程开始循环之前在该线程调用（见TcpServer::setThreadInitCallback），start()之前设置
+    void setThreadInitCallback(const TcpServer::ThreadInitCallback& cb) {
+        server_.setThreadInitCallback(cb);
+    }
+    
+    // 路由表，在start()之前注册：server.router().GET("/users/:id", handler)
+    HttpRouter& router() {
+        return router_;
+    }
+    
+    // 注册WebSocket路由（路径规则和router()相同），握手成功后连接交给handler
+    // 用法：server.websocket("/chat/:room", handler)
+    void websocket(StringPiece pattern, const WebSocketHandler& handler,
+                   size_t maxMessageSize = WebSocketConnection::kDefaultMaxMessageSize);
+    
+    // 设置流式接收回调（设置后请求体不再缓存，HttpCallback中body()为空）
+    void setBodyCallback(const BodyCallback& cb) {
+        bodyCallback_ = cb;
+    }
+    
+    // 设置请求体大小上限，超过返回413（流式接收模式不受限制）
+    void setMaxBodySize(size_t size) {
+        maxBodySize_ = size;
+    }
+    
+    // === 超时（秒，0表示不限制），只作用于HTTP/1.x，升级后的连接（WebSocket、h2c）不受影响 ===
+    // 头部超时：从请求的第一个字节（新连接从建立时）开始计算，期间必须收完整个头部
+    // 一个字节一个字节慢慢发的客户端（slowloris）也不能延长。超时返回408并关闭，默认30秒
+    void setHeaderTimeout(double seconds) {
+        headerTimeout_ = seconds;
+    }
+    
+    // 请求体超时：两次收到请求体数据的最大间隔，超时返回408并关闭，默认30秒
+    void setBodyTimeout(double seconds) {
+        bodyTimeout_ = seconds;
+    }
+    
+    // keep-alive空闲超时：处理完一个请求后等待下一个请求的时间，超时直接关闭，默认60秒
+    void setIdleTimeout(double seconds) {
+        idleTimeout_ = seconds;
+    }
+    
+    // 头部大小上限（请求行加所有头部行），请求行超过返回414，否则返回431，默认32KB
+    void setMaxHeaderSize(size_t size) {
+        maxHeaderSize_ = size;
+    }
+    
+    // 头部数量上限（不超过HttpRequest::kMaxHeaders），超过返回431
+    void setMaxHeaderCount(int count) {
+        maxHeaderCount_ = count;
+    }
+    
+    // 开启响应压缩（Accept-Encoding协商gzip/deflate），在start()之前调用
+    void enableCompression(size_t minSize = HttpCompressor::kDefaultMinSize);
+    
+    // 压缩器（调整级别、缓存大小，查看统计），没有开启压缩时为nullptr
+    HttpCompressor* compressor() {
+        return compressor_.get();
+    }
+    
+    // 工作线程数，默认0（所有工作都在IO线程完成），在start()之前设置
+    void setWorkerThreadNum(int numThreads) {
+        workerThreads_ = numThreads;
+    }
+    
+    // HTTP/1.x的业务回调（路由、异步回调、HttpCallback）都交给工作线程执行，
+    // 读磁盘、慢计算不会卡住同一个loop上的其他连接。需要setWorkerThreadNum() > 0
+    // 请求被拷贝给工作线程；同一个连接的下一个请求等前一个响应发出后才处理，响应顺序不变
+    // HTTP/2的stream仍然在IO线程处理
+    void setHandlerOffload(bool on) {
+        handlerOffload_ = on;
+    }
+    
+    // 工作线程的队列上限（业务回调和压缩共用），在start()之前设置，默认1024
+    // 队列满时新的请求直接回复503（带Retry-After），压缩则改为在IO线程完成
+    void setMaxWorkerQueueSize(size_t size) {
+        workerPool_.setMaxQueueSize(size);
+    }
+    
+    // 缓存没有命中、且不小于这个大小的响应体交给工作线程压缩，IO线程不被卡住
+    // 工作线程的队列满了就在IO线程直接压缩
+    void setCompressionOffloadSize(size_t size) {
+        offloadSize_ = size;
+    }
+    
+    // 默认：64KB以上的响应体在工作线程压缩（级别6大约要1ms）
+    static const size_t kDefaultCompressionOffloadSize = 64 * 1024;
+    
+    // 开启明文HTTP/2（h2c）：新连接以HTTP/2连接前言开头时直接按HTTP/2处理（prior knowledge），
+    // 带Upgrade: h2c的HTTP/1.1请求回复101后切换。HTTP/2的请求只走路由和同步的HttpCallback：
+    // 设置了异步或者流式业务回调时start()不开启HTTP/2（记一条警告），客户端继续用HTTP/1.1
+    void enableHttp2(bool on = true) {
+        http2_ = on;
+    }
+    
     // 启动服务器
     void start();
 
@@ -44,12 +173,93 @@ private:
                    Buffer* buf,
                    Timestamp receiveTime);
     
-    // 处理完整的HTTP请求
-    void onRequest(const std::shared_ptr<TcpConnection>& conn, 
-                   const HttpRequest& req);
-
+    // 处理context中完整的HTTP请求：响应追加到output，返回是否需要关闭连接
+    // 请求不是const：路由匹配时要写入捕获的参数
+    // 文件响应体需要先把output里排队的响应发出去，再交给连接用sendfile发送
+    // 响应交给工作线程压缩时暂停context，返回false
+    bool onRequest(const std::shared_ptr<TcpConnection>& conn, HttpContext* context, Buffer* output);
+    
+    // 协议升级、压缩、序列化响应，文件响应体用sendfile发送；返回是否需要关闭连接
+    bool sendResponse(const std::shared_ptr<TcpConnection>& conn, HttpContext* context,
+                      const HttpRequest& req, HttpResponse& response, Buffer* output);
+    
+    // 流式响应体：发出头部，创建HttpResponseStream交给业务，发完之前暂停context
+    bool startStream(const std::shared_ptr<TcpConnection>& conn, HttpContext* context,
+                     const HttpRequest& req, HttpResponse& response, Buffer* output);
+    
+    // 流式响应体结束后在IO线程调用
+    void onStreamFinished(const std::shared_ptr<TcpConnection>& conn, bool close);
+    
+    // 暂停结束：继续处理暂停期间收到的请求，没有的话开始空闲计时
+    void resumeRequests(const std::shared_ptr<TcpConnection>& conn, HttpContext* context);
+    
+    // 路由 -> 业务回调 -> 404，HTTP/1.1和HTTP/2共用
+    // allowAsync为true时路由没有匹配就返回false（交给异步回调）
+    bool handleRequest(HttpRequest& req, HttpResponse* response, bool allowAsync = false);
+    
+    // 请求交给异步回调（offload为true时先交给工作线程），返回是否需要关闭连接
+    bool dispatchAsync(const std::shared_ptr<TcpConnection>& conn, HttpContext* context,
+                       bool close, bool offload, Buffer* output);
+    
+    // 流式业务回调：头部收完时创建writer交给业务，请求体之后由context转交给writer
+    void dispatchStreaming(const std::shared_ptr<TcpConnection>& conn, HttpContext* context);
+    
+    // 流式接收的请求体结束（aborted为true表示连接断开了）
+    void endStreamingBody(const std::shared_ptr<TcpConnection>& conn, HttpContext* context, bool aborted);
+    
+    // 工作线程中执行业务回调
+    void runHandler(const HttpResponseWriterPtr& writer);
+    
+    // writer完成后在IO线程调用
+    void onAsyncResponse(const std::shared_ptr<TcpConnection>& conn, HttpResponseWriter* writer);
+    
+    // HTTP/2的stream请求：handleRequest之后在IO线程压缩（stream之间没有顺序要求，但窗口由连接管理）
+    void handleHttp2Request(HttpRequest& req, HttpResponse* response);
+    
+    // 连接切换到HTTP/2，之后的数据交给Http2Connection
+    // 返回的Http2Connection由context中的升级处理函数持有
+    std::shared_ptr<Http2Connection> startHttp2(const std::shared_ptr<TcpConnection>& conn,
+                                                HttpContext* context);
+    
+    // 压缩响应体：缓存命中或者小响应体直接在IO线程压缩；否则交给工作线程，返回true
+    bool compressResponse(const std::shared_ptr<TcpConnection>& conn, const HttpRequest& req,
+                          HttpResponse* response);
+    
+    // 工作线程生成的响应回到IO线程：发送，然后继续处理暂停期间收到的请求
+    void onResponseReady(const std::shared_ptr<TcpConnection>& conn,
+                         const HttpResponse& response,
+                         Timestamp receiveTime);
+    
+    // 根据连接当前的状态更新超时阶段和到期时间，需要时启动定时器（每次读之后调用）
+    void updateTimeout(const std::shared_ptr<TcpConnection>& conn, HttpContext* context, Timestamp now);
+    
+    // 保证在context->deadline()之前有一个定时器会到期
+    void armTimer(const std::shared_ptr<TcpConnection>& conn, HttpContext* context);
+    
+    // 定时器到期：expiry是启动时的到期时间，和context里记录的不一致说明被更早的定时器取代了
+    void onTimeout(const std::shared_ptr<TcpConnection>& conn, Timestamp expiry);
+    
+    // 排队的响应发完之后关闭写端，之后收到的数据丢弃，对方迟迟不关闭时强制关闭
+    void shutdownConnection(const std::shared_ptr<TcpConnection>& conn, HttpContext* context);
+    
     TcpServer server_;              // 底层TCP服务器
-    HttpCallback httpCallback_;     // 用户的HTTP业务回调
+    HttpRouter router_;             // 路由表
+    HttpCallback httpCallback_;     // 用户的HTTP业务回调（路由之后的兜底）
+    BodyCallback bodyCallback_;     // 流式接收请求体的回调
+    AsyncHttpCallback asyncHttpCallback_;  // 异步业务回调
+    AsyncHttpCallback streamingHttpCallback_;  // 流式业务回调
+    size_t maxBodySize_;            // 请求体大小上限
+    size_t maxHeaderSize_;          // 头部大小上限
+    int maxHeaderCount_;            // 头部数量上限
+    double headerTimeout_;          // 头部超时
+    double bodyTimeout_;            // 请求体超时
+    double idleTimeout_;            // keep-alive空闲超时
+    std::unique_ptr<HttpCompressor> compressor_;  // 响应压缩（可选）
+    size_t offloadSize_;            // 交给工作线程压缩的响应体大小下限
+    int workerThreads_;             // 工作线程数
+    bool http2_;                    // 是否开启h2c
+    bool handlerOffload_;           // 业务回调是否交给工作线程
+    ThreadPool workerPool_;         // 放在最后：析构时先停止工作线程
 };
 
 #endif
\ No newline at end of file
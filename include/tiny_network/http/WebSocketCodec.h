@@ -0,0 +1,79 @@
+#ifndef TINY_NETWORK_HTTP_WEBSOCKETCODEC_H
+#define TINY_NETWORK_HTTP_WEBSOCKETCODEC_H
+
+#include "../base/StringPiece.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class Buffer;
+
+// WebSocketCodec：RFC 6455的帧格式
+//
+//  0                   1                   2                   3
+//  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+// +-+-+-+-+-------+-+-------------+-------------------------------+
+// |F|R|R|R| opcode|M| Payload len |    Extended payload length    |
+// |I|S|S|S|  (4)  |A|     (7)     |             (16/64)           |
+// |N|V|V|V|       |S|             |   (if payload len==126/127)   |
+// +-+-+-+-+-------+-+-------------+-------------------------------+
+// |     Masking-key (0 or 4 bytes, 客户端发出的帧必须有)            |
+// +---------------------------------------------------------------+
+// |                         Payload Data                          |
+// +---------------------------------------------------------------+
+//
+// 解析直接在Buffer上进行：只看帧头，payload原地解掩码，不拷贝
+class WebSocketCodec {
+public:
+    enum Opcode {
+        kContinuation = 0x0,
+        kText = 0x1,
+        kBinary = 0x2,
+        kClose = 0x8,
+        kPing = 0x9,
+        kPong = 0xA
+    };
+    
+    struct FrameHeader {
+        bool fin;
+        int opcode;
+        bool masked;
+        char mask[4];
+        size_t headerSize;      // 帧头长度（2~14字节）
+        uint64_t payloadSize;
+    };
+    
+    enum ParseResult {
+        kIncomplete,    // 帧头还没收全
+        kOk,
+        kError          // RSV位不为0、长度编码不合法
+    };
+    
+    // 解析data开头的帧头（不检查payload是否收全）
+    static ParseResult parseHeader(const char* data, size_t len, FrameHeader* header);
+    
+    // 帧头长度：payload长度 + 是否带掩码
+    static size_t headerSize(size_t payloadSize, bool masked);
+    
+    // 把一帧追加到out：服务器发出的帧不带掩码；mask不为空时生成带掩码的帧（客户端使用）
+    static void appendFrame(Buffer* out, int opcode, StringPiece payload,
+                            bool fin = true, const char* mask = nullptr);
+    static void appendFrame(std::string* out, int opcode, StringPiece payload,
+                            bool fin = true, const char* mask = nullptr);
+    
+    // 原地解掩码（掩码和解掩码是同一个操作）：data[i] ^= mask[i % 4]
+    // 按16/32字节一组用SIMD异或，没有SSE2时按8字节一组
+    static void unmask(char* data, size_t len, const char mask[4]);
+    
+    // 握手：base64(SHA1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"))
+    static std::string acceptKey(StringPiece key);
+    
+    // 文本消息必须是合法的UTF-8，否则以1007关闭连接
+    static bool isValidUtf8(StringPiece s);
+    
+    static bool isControl(int opcode) {
+        return (opcode & 0x8) != 0;
+    }
+};
+
+#endif
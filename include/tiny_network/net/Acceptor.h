@@ -2,13 +2,16 @@
 #define TINY_NETWORK_NET_ACCEPTOR_H
 
 #include "../base/noncopyable.h"
+#include "SocketOptions.h"
 #include <functional>
 #include <memory>
+#include <string>
 
 class EventLoop;
 class Channel;
 class Socket;
 class InetAddress;
+class UnixAddress;
 
 // Acceptor：专门负责接受新连接
 // 封装了listen socket的所有操作
@@ -18,7 +21,14 @@ public:
     // 参数是accept返回的connfd
     using NewConnectionCallback = std::function<void(int sockfd)>;
     
-    Acceptor(EventLoop* loop, int port);
+    Acceptor(EventLoop* loop, int port);  // 监听所有IPv4接口
+    
+    // 监听指定的IPv4或IPv6地址
+    // IPv6地址默认是双栈：同时接受IPv4连接（对端地址是::ffff:a.b.c.d），ipv6Only时只接受IPv6
+    Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool ipv6Only = false);
+    
+    // 监听Unix域socket：文件路径上残留的socket文件（上次没有正常退出）先删除，析构时也删除
+    Acceptor(EventLoop* loop, const UnixAddress& listenAddr);
     ~Acceptor();
     
     // 设置新连接回调
@@ -26,6 +36,11 @@ public:
         newConnectionCallback_ = cb;
     }
     
+    // 监听socket和新连接的选项（listen()之前设置）
+    void setSocketOptions(const SocketOptions& options) {
+        options_ = options;
+    }
+    
     // 开始监听
     void listen();
     
@@ -39,7 +54,10 @@ private:
     std::unique_ptr<Socket> acceptSocket_;  // 监听socket的封装
     std::unique_ptr<Channel> channel_;      // 监听socket的Channel
     NewConnectionCallback newConnectionCallback_;  // 用户回调
+    SocketOptions options_;
     bool listening_;
+    bool unixDomain_;                       // 监听的是Unix域socket
+    std::string unlinkPath_;                // 析构时删除的socket文件（抽象地址没有文件）
 };
 
 #endif
\ No newline at end of file
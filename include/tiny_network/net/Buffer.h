@@ -5,6 +5,8 @@
 #include <string>
 #include <algorithm>
 
+struct msghdr;
+
 // Buffer：应用层缓冲区
 // 
 // 设计思路：
@@ -76,6 +78,34 @@ public:
     // 从socket读取数据
     ssize_t readFd(int fd);
     
+    // 和readFd()一样，但是用recvmsg()读，msg的控制信息（msg_control）由调用者提供，
+    // msg_iov由这里设置（用来接收Unix域socket传来的fd）
+    ssize_t readMsg(int fd, struct msghdr* msg, int flags);
+    
+    // === 内存管理 ===
+    
+    // 底层实际占用的容量（字节）
+    size_t internalCapacity() const {
+        return buffer_.capacity();
+    }
+    
+    // 释放多余的容量，只保留可读数据再加reserve字节的可写空间
+    // retrieveAll只会重置下标，一次大请求之后容量会一直保持在峰值，
+    // 空闲连接很多时需要主动调用shrink把内存还给系统
+    void shrink(size_t reserve) {
+        std::vector<char> buf(std::max(readableBytes() + reserve, kInitialSize));
+        std::copy(peek(), peek() + readableBytes(), buf.begin());
+        writerIndex_ = readableBytes();
+        readerIndex_ = 0;
+        buffer_.swap(buf);
+    }
+    
+    void swap(Buffer& rhs) {
+        buffer_.swap(rhs.buffer_);
+        std::swap(readerIndex_, rhs.readerIndex_);
+        std::swap(writerIndex_, rhs.writerIndex_);
+    }
+    
     // === HTTP解析专用方法 ===
     
     // 查找\r\n（HTTP行结束符）
@@ -84,12 +114,19 @@ public:
         return crlf == beginWrite() ? nullptr : crlf;
     }
     
+    // 从start开始查找\r\n（增量解析时跳过已经解析过的数据）
+    const char* findCRLF(const char* start) const {
+        const char* crlf = std::search(start, beginWrite(), "\r\n", "\r\n" + 2);
+        return crlf == beginWrite() ? nullptr : crlf;
+    }
+    
     // 读取数据直到指定位置（不包括end）
     void retrieveUntil(const char* end) {
         retrieve(end - peek());
     }
     
-private:
+    // === 直接写入（先ensureWritableBytes预留空间，写完再hasWritten） ===
+    
     char* beginWrite() {
         return &buffer_[writerIndex_];
     }
@@ -105,6 +142,12 @@ private:
         }
     }
     
+    // 直接写入beginWrite()之后，移动写位置
+    void hasWritten(size_t len) {
+        writerIndex_ += len;
+    }
+    
+private:
     // 扩展缓冲区
     void makeSpace(size_t len) {
         if (writableBytes() + readerIndex_ < len) {
@@ -34,11 +34,13 @@ public:
     
     // 设置感兴趣的事件
     void enableReading() { events_ |= kReadEvent; }
+    void disableReading() { events_ &= ~kReadEvent; }
     void enableWriting() { events_ |= kWriteEvent; }
     void disableWriting() { events_ &= ~kWriteEvent; }
     void disableAll() { events_ = kNoneEvent; }
     
-    // 判断是否在监听写事件
+    // 判断是否在监听读/写事件
+    bool isReading() const { return events_ & kReadEvent; }
     bool isWriting() const { return events_ & kWriteEvent; }
 
 private:
@@ -0,0 +1,112 @@
+#ifndef TINY_NETWORK_NET_CONNECTOR_H
+#define TINY_NETWORK_NET_CONNECTOR_H
+
+#include "../base/noncopyable.h"
+#include "InetAddress.h"
+#include "Timer.h"
+#include <functional>
+#include <memory>
+#include <string>
+
+class Channel;
+class EventLoop;
+class UnixAddress;
+
+// Connector：在EventLoop上发起一个非阻塞connect（客户端一侧的Acceptor）
+//
+// connect()返回EINPROGRESS之后关注可写事件，可写时用SO_ERROR判断连接是否成功
+// 成功后把已连接的fd交给NewConnectionCallback（之后通常交给TcpConnection管理），
+// 失败（包括超时）时调用ErrorCallback，fd已经关闭
+//
+// 开启setRetry()之后，失败时按指数退避重试（默认0.5秒起，每次翻倍，最多30秒），直到成功或者stop()
+// 连接成功之后可以再次start()（比如TcpClient断线重连），退避时间从头开始
+// 用shared_ptr管理，定时器和延迟的清理只持有weak_ptr
+// 所有函数都只能在loop线程调用
+class Connector : noncopyable, public std::enable_shared_from_this<Connector> {
+public:
+    using NewConnectionCallback = std::function<void(int sockfd)>;
+    using ErrorCallback = std::function<void(int savedErrno)>;  // 超时是ETIMEDOUT
+    
+    Connector(EventLoop* loop, const InetAddress& serverAddr);
+    
+    // 连接Unix域socket：本机连接一般立即成功，监听队列满时是EAGAIN（开启重试时同样退避重试）
+    Connector(EventLoop* loop, const UnixAddress& serverAddr);
+    ~Connector();
+    
+    void setNewConnectionCallback(const NewConnectionCallback& cb) {
+        newConnectionCallback_ = cb;
+    }
+    
+    void setErrorCallback(const ErrorCallback& cb) {
+        errorCallback_ = cb;
+    }
+    
+    // 连接超时（秒），0表示只等内核的超时（start()之前设置）
+    void setConnectTimeout(double seconds) {
+        connectTimeout_ = seconds;
+    }
+    
+    // 失败后自动重试（start()之前设置）；每次失败仍然调用ErrorCallback，在回调里stop()可以放弃重试
+    void setRetry(bool on) {
+        retry_ = on;
+    }
+    
+    // 重试的退避时间（秒）：第一次等initial，之后每次翻倍，不超过max
+    void setRetryDelay(double initial, double max) {
+        initRetryDelay_ = initial;
+        maxRetryDelay_ = max;
+    }
+    
+    // TCP的目的地址（连接Unix域socket时没有意义）
+    const InetAddress& serverAddress() const { return serverAddr_; }
+    
+    // 目的地址的字符串（ip:port或者unix:路径），用于日志和连接名
+    const std::string& serverName() const { return serverName_; }
+    
+    // 发起连接，结果一定通过回调通知（即使connect()立即失败，也不在start()里回调）
+    void start();
+    
+    // 放弃正在进行的连接和等待中的重试：关闭fd，之后不再调用任何回调
+    void stop();
+
+private:
+    enum State { kDisconnected, kConnecting, kConnected };
+    
+    // 发起一次connect()
+    void connect();
+    
+    // connect()返回EINPROGRESS：等待可写事件
+    void connecting(int sockfd);
+    
+    // Channel的回调
+    void handleWrite();
+    void handleError();
+    
+    // 连接失败：关闭fd，需要时安排重试，通知ErrorCallback
+    void fail(int savedErrno);
+    
+    // 等待退避时间之后重新connect()
+    void retry();
+    
+    // 不再关注sockfd，返回它；Channel在当前事件处理完之后才能销毁
+    int removeAndResetChannel();
+    
+    EventLoop* loop_;
+    InetAddress serverAddr_;
+    std::unique_ptr<UnixAddress> unixAddr_;  // 非空时连接Unix域socket
+    std::string serverName_;
+    State state_;
+    double connectTimeout_;
+    bool retry_;                         // 失败后自动重试
+    bool started_;                       // start()之后、stop()之前
+    double initRetryDelay_;
+    double maxRetryDelay_;
+    double retryDelay_;                  // 下一次重试的退避时间
+    std::unique_ptr<Channel> channel_;   // 连接期间关注sockfd的可写事件
+    TimerId timeoutTimer_;               // 连接超时
+    TimerId retryTimer_;                 // 等待重试
+    NewConnectionCallback newConnectionCallback_;
+    ErrorCallback errorCallback_;
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <string>
+#include <functional>
 
 class EventLoop;
 
@@ -17,7 +18,11 @@ class EventLoop;
 // loop就运行在新线程中了！
 class EventLoopThread : noncopyable {
 public:
-    EventLoopThread(const std::string& name = "EventLoopThread");
+    // 新线程创建好EventLoop之后、开始循环之前调用（在新线程中）
+    using ThreadInitCallback = std::function<void(EventLoop*)>;
+    
+    EventLoopThread(const ThreadInitCallback& cb = ThreadInitCallback(),
+                    const std::string& name = "EventLoopThread");
     ~EventLoopThread();
     
     // 启动线程，返回新线程中的EventLoop对象
@@ -32,6 +37,7 @@ private:
     std::mutex mutex_;                     // 保护loop_
     std::condition_variable cond_;         // 等待EventLoop创建完成
     std::string name_;                      // 线程名称
+    ThreadInitCallback callback_;          // 线程初始化回调
 };
 
 #endif
\ No newline at end of file
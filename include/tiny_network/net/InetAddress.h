@@ -1,28 +1,51 @@
 #ifndef TINY_NETWORK_NET_INETADDRESS_H
 #define TINY_NETWORK_NET_INETADDRESS_H
 
-#include <netinet/in.h>  // 为了使用 sockaddr_in
+#include <netinet/in.h>  // 为了使用 sockaddr_in / sockaddr_in6
+#include <cstddef>
 #include <string>        // 为了使用 std::string
 
 // 我们的第一个网络地址类
+// 同时支持IPv4和IPv6：sockaddr_in和sockaddr_in6放在一个union里，按family()区分
 class InetAddress {
 public:
+    // toIpPort(buf, size)需要的缓冲区大小（"[IPv6地址]:端口"加结尾的'\0'）
+    static const size_t kMaxIpPortLength = INET6_ADDRSTRLEN + 8;
+    
     // 构造函数
-    explicit InetAddress(uint16_t port);  // 监听所有接口
-    InetAddress(const std::string& ip, uint16_t port);  // 指定IP和端口
+    explicit InetAddress(uint16_t port);  // 监听所有IPv4接口
+    
+    // 监听所有接口（loopbackOnly时只监听本机回环），ipv6时是::或::1
+    InetAddress(uint16_t port, bool loopbackOnly, bool ipv6 = false);
+    
+    // 指定IP和端口：IP里有':'时按IPv6解析（可以带方括号，比如"[::1]"），否则按IPv4
+    InetAddress(const std::string& ip, uint16_t port);
     explicit InetAddress(const struct sockaddr_in& addr);  // 从sockaddr_in构造
     
+    // 从sockaddr_in6构造：sin6_family是AF_INET时按sockaddr_in解释，
+    // 所以accept()/recvmsg()可以统一用sockaddr_in6接收两种地址
+    explicit InetAddress(const struct sockaddr_in6& addr);
+    
     // 获取信息
+    sa_family_t family() const { return addr_.sin_family; }
+    bool isIpv6() const { return family() == AF_INET6; }
     uint16_t toPort() const;
     std::string toIp() const;
-    std::string toIpPort() const;  // IP:端口格式
+    std::string toIpPort() const;  // IP:端口格式，IPv6是[IP]:端口
+    
+    // 不分配内存的toIpPort()：写入buf（总是以'\0'结尾），返回写入的长度（不含'\0'）
+    // size不小于kMaxIpPortLength时不会截断；accept路径上的日志用这个
+    size_t toIpPort(char* buf, size_t size) const;
     
     // 获取原始地址（给socket API使用）
     const struct sockaddr* getSockAddr() const;
-    socklen_t getSockLen() const;
+    socklen_t getSockLen() const;  // 按地址族返回sockaddr_in或sockaddr_in6的大小
 
 private:
-    sockaddr_in addr_;  // 存储网络地址信息的核心！
+    union {
+        sockaddr_in addr_;    // IPv4，sin_family和sin6_family位置相同
+        sockaddr_in6 addr6_;  // IPv6
+    };
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,107 @@
+#ifndef TINY_NETWORK_NET_TCPCLIENT_H
+#define TINY_NETWORK_NET_TCPCLIENT_H
+
+#include "../base/noncopyable.h"
+#include "InetAddress.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class Buffer;
+class Connector;
+class EventLoop;
+class TcpConnection;
+class UnixAddress;
+
+// TcpClient：在EventLoop上发起并维护一个出站连接（客户端一侧的TcpServer）
+//
+// 使用方式：
+// TcpClient client(&loop, InetAddress("127.0.0.1", 8080), "MyClient");
+// client.setConnectionCallback(连接建立/断开);
+// client.setMessageCallback(处理消息);
+// client.connect();
+//
+// 连接由Connector非阻塞建立，失败时按指数退避一直重试，直到连上或者stop()
+// 连上之后得到一个普通的TcpConnection，回调和TcpServer的连接完全一样
+// enableRetry()之后连接断开时自动重新连接
+//
+// connect()/disconnect()/stop()/connection()可以在任意线程调用，回调都在loop线程执行
+// 析构只能在loop线程进行，还在的连接被强制关闭
+class TcpClient : noncopyable {
+public:
+    using ConnectionPtr = std::shared_ptr<TcpConnection>;
+    using MessageCallback = std::function<void(const ConnectionPtr&, Buffer*)>;
+    using ConnectionCallback = std::function<void(const ConnectionPtr&)>;  // 连接建立/断开回调
+    using WriteCompleteCallback = std::function<void(const ConnectionPtr&)>;
+    
+    TcpClient(EventLoop* loop, const InetAddress& serverAddr, const std::string& name);
+    
+    // 连接Unix域socket，其他都和TCP一样
+    TcpClient(EventLoop* loop, const UnixAddress& serverAddr, const std::string& name);
+    ~TcpClient();
+    
+    EventLoop* getLoop() const { return loop_; }
+    const std::string& name() const { return name_; }
+    
+    // === 回调设置（connect()之前） ===
+    void setConnectionCallback(const ConnectionCallback& cb) {
+        connectionCallback_ = cb;
+    }
+    
+    void setMessageCallback(const MessageCallback& cb) {
+        messageCallback_ = cb;
+    }
+    
+    void setWriteCompleteCallback(const WriteCompleteCallback& cb) {
+        writeCompleteCallback_ = cb;
+    }
+    
+    // 每次连接尝试的超时（秒），0表示只等内核的超时（connect()之前设置）
+    void setConnectTimeout(double seconds);
+    
+    // 连接失败后重试的退避时间（秒），默认0.5秒起，每次翻倍，最多30秒（connect()之前设置）
+    void setRetryDelay(double initial, double max);
+    
+    // 连接断开后自动重新连接
+    void enableRetry() { retry_ = true; }
+    bool retry() const { return retry_; }
+    
+    // 开始连接
+    void connect();
+    
+    // 关闭已经建立的连接（发完已经写入的数据再关闭写端），不再重连
+    void disconnect();
+    
+    // 放弃正在进行的连接和重试，不影响已经建立的连接
+    void stop();
+    
+    // 当前的连接，没有连上时为空
+    ConnectionPtr connection() const;
+
+private:
+    // 两个构造函数共用：设置connector_的回调
+    void initConnector();
+    
+    // Connector连上了（loop线程）
+    void newConnection(int sockfd);
+    
+    // 连接关闭了（loop线程）
+    void removeConnection(const ConnectionPtr& conn);
+    
+    EventLoop* loop_;
+    std::shared_ptr<Connector> connector_;
+    const std::string name_;
+    const std::string serverName_;  // ip:port或者unix:路径
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+    std::atomic<bool> retry_;      // 断开后重连
+    std::atomic<bool> connect_;    // connect()之后、disconnect()/stop()之前
+    int nextConnId_;               // 连接计数器（loop线程）
+    mutable std::mutex mutex_;
+    ConnectionPtr connection_;     // 受mutex_保护
+};
+
+#endif
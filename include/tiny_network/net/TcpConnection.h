@@ -3,10 +3,15 @@
 
 #include "../base/noncopyable.h"
 #include "Buffer.h"
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <deque>
 #include <functional>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
+#include <sys/types.h>
 
 class Channel;
 class EventLoop;
@@ -26,11 +31,12 @@ public:
         kConnected,       // 已连接
         kDisconnecting    // 正在断开
     };
-
+    
     // 回调函数类型定义
     using ConnectionCallback = std::function<void(const std::shared_ptr<TcpConnection>&)>; // 连接建立/断开回调
     using MessageCallback = std::function<void(const std::shared_ptr<TcpConnection>&, Buffer*)>; // 消息回调
     using CloseCallback = std::function<void(const std::shared_ptr<TcpConnection>&)>; // 连接关闭回调（内部使用）
+    using WriteCompleteCallback = std::function<void(const std::shared_ptr<TcpConnection>&)>; // 数据全部写到socket
     
     // 构造函数
     // loop: 管理这个连接的EventLoop
@@ -40,11 +46,30 @@ public:
                   const std::string& name,
                   int sockfd);
     
+    // TcpServer用：连接名是"namePrefix-id"，第一次调用name()时才生成，建立连接时不格式化字符串
+    TcpConnection(EventLoop* loop,
+                  const std::shared_ptr<const std::string>& namePrefix,
+                  uint64_t id,
+                  int sockfd);
+    
     ~TcpConnection();
     
     // === 基本信息获取 ===
-    const std::string& name() const { return name_; }
+    const std::string& name() const;
+    uint64_t id() const { return id_; }  // TcpServer分配的编号（从1开始），其他方式创建的连接为0
     EventLoop* getLoop() const { return loop_; }
+    int fd() const { return sockfd_; }
+    
+    // 输入缓冲区：暂停处理请求的协议层恢复时，从这里继续解析已经收到的数据（只能在loop线程使用）
+    Buffer* inputBuffer() { return &inputBuffer_; }
+    
+    // 还有数据没有写到socket（输出缓冲区或者排队的文件）
+    bool hasPendingOutput() const {
+        return outputBuffer_.readableBytes() > 0 || !pendingOutputs_.empty() || pipeBytes_ > 0;
+    }
+    
+    // 还没写到socket的字节数（包括排队文件的剩余部分），用来做发送端的流量控制
+    size_t pendingOutputBytes() const;
     
     // === 连接状态管理 ===
     bool connected() const { return state_ == kConnected; }
@@ -56,9 +81,83 @@ public:
     // 强制关闭连接
     void forceClose();
     
+    // 暂停/恢复读（只能在loop线程调用）：下游消费不过来时停止从socket读，
+    // 数据留在内核的接收缓冲区里，TCP的窗口会让对端慢下来（接收端的流量控制）
+    void stopRead();
+    void startRead();
+    bool isReading() const;
+    
+    // 禁用Nagle算法：响应头和sendfile的文件内容分两次写出时，
+    // 不会因为等待ACK（对端延迟确认）卡住40ms
+    void setTcpNoDelay(bool on);
+    
     // === 数据发送接口 ===
     void send(const std::string& message);
     void send(Buffer* buf);  // 新增：支持Buffer发送
+    void send(const char* data, size_t len);  // 不需要先拷贝成string
+    
+    // 用sendfile发送文件的[offset, offset + count)，数据不经过用户态
+    // 连接接管fd，发送完（或连接断开）后负责close
+    // 和send()的数据严格按调用顺序发送
+    void sendFile(int fd, off_t offset, size_t count);
+    
+    // === 零拷贝发送（MSG_ZEROCOPY），只能在loop线程调用 ===
+    // 开启之后，不小于kZeroCopyThreshold的send(Buffer*)和sendZeroCopy()不再把数据拷贝进内核：
+    // 内核直接引用用户内存，发送完成后通过错误队列（EPOLLERR）通知，在那之前数据一直由连接持有；
+    // 通知没到齐连接就销毁时，socket和数据转交给loop线程的ZeroCopyGraveyard，等通知到齐再关闭、释放
+    // 小块数据的页面锁定和通知开销超过拷贝，照常发送；内核不支持SO_ZEROCOPY时返回false
+    // 本机回环和不支持的网卡上内核仍然会拷贝（zeroCopyCopied()计数），这时开启只有额外开销
+    bool setZeroCopy(bool on);
+    bool zeroCopy() const { return zeroCopy_; }
+    
+    // 发送data：开启零拷贝并且足够大时连接接管data，不拷贝；否则和send()一样
+    void sendZeroCopy(std::string&& data);
+    
+    // 发送共享的只读数据（比如缓存的大响应），多个连接可以同时发送同一份，在通知完成之前一直持有
+    void sendZeroCopy(const std::shared_ptr<const std::string>& data);
+    
+    // 已经交给内核、还在等完成通知的零拷贝发送次数
+    size_t zeroCopyInFlight() const { return zeroCopyInFlight_.size(); }
+    
+    // 完成通知里内核实际做了拷贝的发送次数
+    uint64_t zeroCopyCopied() const { return zeroCopyCopied_; }
+    
+    // 不小于这个大小的数据才走零拷贝
+    static const size_t kZeroCopyThreshold = 64 * 1024;
+    
+    // === 连接之间转发（四层代理），只能在loop线程调用 ===
+    // 之后从这个连接读到的数据直接写到target，不再调用消息回调；双向转发时两边各调用一次
+    // useSplice时数据经过一个pipe用splice(2)在两个socket之间移动，不进入用户态；
+    // pipe从每个loop线程的池里借，里面有数据时归target独占，写空了马上放回
+    // 不能splice时（比如socket类型不支持、开启了setFdPassing()、pipe用完了）经过inputBuffer_拷贝
+    // 背压：target写不出去（pipe里还有数据，或者积压超过kForwardHighWaterMark）时停止读这个连接，
+    // target写完之后恢复；对端关闭时关闭target的写端（排队的数据写完之后），任一端关闭后另一端随之关闭
+    // 已经在inputBuffer_里的数据先转发；两个连接必须属于同一个loop，否则返回false
+    // 转发期间不要再对target调用send()：数据可能排到pipe里的数据前面
+    bool forwardTo(const std::shared_ptr<TcpConnection>& target, bool useSplice = true);
+    
+    // 从这个连接读到、用splice/经过Buffer转发出去的字节数
+    uint64_t splicedBytes() const { return splicedBytes_; }
+    uint64_t forwardCopiedBytes() const { return forwardCopiedBytes_; }
+    
+    // 经过Buffer转发时target的积压上限
+    static const size_t kForwardHighWaterMark = 1024 * 1024;
+    
+    // === Unix域socket传递文件描述符（SCM_RIGHTS），只能在loop线程调用 ===
+    // 开启之后读数据时同时接收对端传来的fd；不开启时内核直接关闭收到的fd
+    void setFdPassing(bool on) { fdPassing_ = on; }
+    
+    // 取走到目前为止收到的fd（一般在消息回调里），之后由调用者负责close
+    // fd和携带它的那段数据一起到达：那段数据读进输入缓冲区时，fd也已经在这里了
+    std::vector<int> takeReceivedFds();
+    
+    // 发送[data, data + len)，fds附在这段数据上一起发出（len至少为1）
+    // 内核复制了一份fd，返回之后调用者可以close自己的
+    // 前面的数据还没写完或者发送缓冲区满时什么也不发、返回false，可以在WriteCompleteCallback里再试
+    bool sendFds(const char* data, size_t len, const std::vector<int>& fds);
+    
+    // 每次读最多接收的fd个数，超过的被内核关闭
+    static const size_t kMaxReceivedFds = 32;
     
     // === 上下文存储接口 ===
     // 设置上下文（用于存储协议相关状态，如HttpContext）
@@ -73,14 +172,50 @@ public:
     // 清除指定上下文
     void clearContext(const std::string& key);
     
+    // === 按类型存放的上下文（每条消息都要取的状态用这个） ===
+    // 每个类型第一次使用时分配一个槽位编号（所有连接共用），之后的访问只是数组下标，
+    // 没有哈希、字符串构造和shared_ptr的引用计数：
+    //   conn->setContext(std::make_shared<HttpContext>());
+    //   HttpContext* context = conn->context<HttpContext>();  // 没有设置过时为nullptr
+    // 返回的指针在连接析构、clearContext<T>()或者再次setContext()之前有效
+    // 和上面按字符串key存放的上下文互不相干；整个程序最多kMaxContextTypes个类型，超过时LOG_FATAL
+    template <typename T>
+    void setContext(std::shared_ptr<T> context) {
+        typedContexts_[contextSlot<T>()] = std::move(context);
+    }
+    
+    template <typename T>
+    T* context() const {
+        return static_cast<T*>(typedContexts_[contextSlot<T>()].get());
+    }
+    
+    template <typename T>
+    void clearContext() {
+        typedContexts_[contextSlot<T>()].reset();
+    }
+    
+    static const size_t kMaxContextTypes = 8;
+    
     // 设置连接回调（连接建立/断开时调用）
     void setConnectionCallback(const ConnectionCallback& cb) {
         connectionCallback_ = cb;
     }
     
     // 设置消息回调（用户提供的业务逻辑）
-    void setMessageCallback(const MessageCallback& cb) { 
-        messageCallback_ = cb; 
+    // 在消息回调里替换（比如连接池把连接交给下一个使用者）时，等这次回调返回之后才生效
+    void setMessageCallback(const MessageCallback& cb) {
+        if (inMessageCallback_) {
+            pendingMessageCallback_ = cb;
+            messageCallbackPending_ = true;
+        } else {
+            messageCallback_ = cb;
+        }
+    }
+    
+    // 设置写完成回调：输出缓冲区和排队的文件全部写到socket之后调用（总是通过queueInLoop）
+    // 配合pendingOutputBytes()：生产者发现积压太多时停下来，在这里继续（不设置时没有任何开销）
+    void setWriteCompleteCallback(const WriteCompleteCallback& cb) {
+        writeCompleteCallback_ = cb;
     }
     
     // 设置关闭回调（TcpServer使用）
@@ -88,6 +223,23 @@ public:
         closeCallback_ = cb;
     }
     
+    // === 缓冲区内存回收策略 ===
+    // 容量超过threshold的Buffer才会被收缩（0表示关闭收缩）
+    void setBufferShrinkThreshold(size_t threshold) {
+        shrinkThreshold_ = threshold;
+    }
+    
+    // Buffer空闲超过delay秒后收缩（<=0表示只在写完时收缩输出缓冲区）
+    void setBufferIdleShrinkDelay(double delay) {
+        idleShrinkDelay_ = delay;
+    }
+    
+    // 立即收缩空的输入/输出缓冲区（只能在loop线程调用）
+    void shrinkBuffers();
+    
+    // 默认阈值：64KB以下的Buffer不值得收缩
+    static const size_t kDefaultShrinkThreshold = 64 * 1024;
+    
     // 启动这个连接（开始监听事件）
     void connectEstablished();
     
@@ -95,30 +247,159 @@ public:
     void connectDestroyed();
 
 private:
+    friend class TcpServer;  // 维护registrySlot_
+    
+    // 类型T的上下文槽位：第一次调用时分配，之后不变
+    template <typename T>
+    static size_t contextSlot() {
+        static const size_t slot = nextContextSlot();
+        return slot;
+    }
+    static size_t nextContextSlot();
+    
     // 处理读事件（Channel的回调）
     void handleRead();
     
+    // setFdPassing()时代替Buffer::readFd()：用recvmsg()读，同时取出SCM_RIGHTS
+    ssize_t readWithFds();
+    
+    // forwardTo()之后代替handleRead()：把读到的数据转发给forwardTarget_
+    void handleForwardRead();
+    
+    // 作为转发目标：从fd读一次到自己的pipe并尝试写出，返回值和read()一样
+    ssize_t spliceFrom(int fd);
+    
+    // 把pipe里的数据写到socket，写空返回true；自己还有send()的数据没写完时先不写
+    bool flushPipe();
+    
+    // pipe空了放回池里，还有数据（连接出错）时直接关闭
+    void releasePipe();
+    
+    // 因为背压停止了读：target写完之后恢复
+    void resumeForward();
+    
     // 处理写事件（Channel的回调）
     void handleWrite();
     
     // 处理连接关闭
     void handleClose();
     
+    // 处理错误事件：读出零拷贝的完成通知（其他错误由读事件处理）
+    void handleError();
+    
+    // 发送数据的实际实现
+    void sendInLoop(const char* data, size_t len);
+    
+    // 写出排队中的文件和零拷贝内存块，返回false表示出错（连接已关闭）
+    bool writePendingOutputs();
+    
+    // 把文件或者零拷贝内存块排在已有的数据之后，前面没有数据时马上开始发送
+    void queuePendingOutput(int fd, off_t offset, size_t count,
+                            const char* data, std::shared_ptr<void> owner);
+    
+    // 零拷贝发送一次，记下这次发送的通知序号和持有数据的owner；返回值和send()一样
+    ssize_t sendZeroCopyOnce(const char* data, size_t len, const std::shared_ptr<void>& owner);
+    
+    // 读出错误队列里所有的零拷贝完成通知，释放内核不再引用的数据
+    void readZeroCopyCompletions();
+    
+    // 数据全部写出：回调放到这一轮事件处理之后，不在send()的调用栈里重入
+    void queueWriteComplete();
+    
+    // 等待发送的文件（sendFile）或者零拷贝的内存块（data非空），after保存排在它之后的数据
+    struct PendingOutput {
+        PendingOutput(int f, off_t off, size_t count, const char* d, std::shared_ptr<void> o)
+            : fd(f), offset(off), remaining(count), data(d), owner(std::move(o)) {}
+        ~PendingOutput();
+        
+        int fd;                        // 内存块是-1
+        off_t offset;
+        size_t remaining;
+        const char* data;              // 内存块中下一个要发送的位置
+        std::shared_ptr<void> owner;   // 持有内存块，发出去之后转给zeroCopyInFlight_
+        Buffer after;
+    };
+    
+    // 一次零拷贝发送：内核按发送顺序给每次发送一个序号，完成通知是一段序号[lo, hi]
+    struct ZeroCopyRef {
+        uint32_t id;
+        std::shared_ptr<void> owner;
+    };
+    
+    // 从fd的错误队列读出完成通知，删掉inFlight里完成了的发送；连接和ZeroCopyGraveyard共用
+    static void drainZeroCopyCompletions(int fd, std::deque<ZeroCopyRef>* inFlight, uint64_t* copied);
+    
+    // 连接销毁后继续等零拷贝完成通知，每个loop线程一个
+    class ZeroCopyGraveyard;
+    static ZeroCopyGraveyard& zeroCopyGraveyard();
+    
+    // Buffer变空后安排一次空闲收缩检查
+    void scheduleIdleShrink();
+    void handleIdleShrink(uint64_t activity);
+    
+    // 把Buffer容量的变化同步到EventLoop的统计中
+    void updateBufferGauge();
+    
+    // 两个公开的构造函数共用
+    TcpConnection(EventLoop* loop,
+                  const std::string& name,
+                  const std::shared_ptr<const std::string>& namePrefix,
+                  uint64_t id,
+                  int sockfd);
+    
+    // 由namePrefix_和id_生成name_
+    void formatName() const;
+    
     EventLoop* loop_;              // 所属的EventLoop
-    std::string name_;              // 连接名
+    mutable std::string name_;      // 连接名（有namePrefix_时在第一次name()时生成）
+    std::shared_ptr<const std::string> namePrefix_;
+    mutable std::once_flag nameOnce_;
+    uint64_t id_;
+    size_t registrySlot_;           // 在TcpServer的连接表里的位置（TcpServer使用）
     int sockfd_;                    // socket描述符
     std::unique_ptr<Channel> channel_;  // 管理sockfd的事件
     StateE state_;                  // 连接状态
+    bool closed_;                   // handleClose已经执行过
     
     Buffer inputBuffer_;                 // 输入缓冲区（接收数据）
     Buffer outputBuffer_;                // 输出缓冲区（发送数据）
+    std::deque<std::unique_ptr<PendingOutput>> pendingOutputs_;  // 排在outputBuffer_之后的文件和内存块
+    
+    bool zeroCopy_;                          // 开启了SO_ZEROCOPY
+    uint32_t nextZeroCopyId_;                // 下一次零拷贝发送的序号
+    std::deque<ZeroCopyRef> zeroCopyInFlight_;  // 等待完成通知，按序号排列
+    uint64_t zeroCopyCopied_;
+    
+    size_t shrinkThreshold_;             // 收缩阈值（字节）
+    double idleShrinkDelay_;             // 空闲多久后收缩（秒）
+    bool idleShrinkPending_;             // 是否已经安排了空闲收缩检查
+    uint64_t activity_;                  // 读写活动计数，用于判断是否一直空闲
+    size_t accountedBytes_;              // 已计入EventLoop统计的字节数
     
     ConnectionCallback connectionCallback_; // 连接建立/断开回调
     MessageCallback messageCallback_;       // 消息到达的回调
+    MessageCallback pendingMessageCallback_;  // 消息回调执行期间设置的新回调
+    bool inMessageCallback_;
+    bool messageCallbackPending_;
     CloseCallback closeCallback_;           // 连接关闭的回调
+    WriteCompleteCallback writeCompleteCallback_;  // 数据全部写出的回调
+    
+    std::weak_ptr<TcpConnection> forwardTarget_;  // 读到的数据转发给它
+    std::weak_ptr<TcpConnection> forwardSource_;  // 往这个连接转发的连接，写完pipe之后恢复它的读
+    bool forwarding_;                       // forwardTo()之后
+    bool forwardSplice_;                    // 用splice转发，不支持时改为经过Buffer
+    bool forwardPaused_;                    // 因为target的背压停止了读
+    int pipeFds_[2];                        // 转发过来、还没写到socket的数据（从池里借的pipe）
+    size_t pipeBytes_;
+    uint64_t splicedBytes_;
+    uint64_t forwardCopiedBytes_;
+    
+    bool fdPassing_;                        // 接收对端传来的fd
+    std::vector<int> receivedFds_;          // 收到、还没被取走的fd（析构时关闭）
     
     // 上下文存储（key-value方式存储任意类型的上下文对象）
     std::unordered_map<std::string, std::shared_ptr<void>> contexts_;
+    std::shared_ptr<void> typedContexts_[kMaxContextTypes];  // 按contextSlot<T>()的编号存放
 };
 
 #endif
\ No newline at end of file
@@ -2,16 +2,20 @@
 #define TINY_NETWORK_NET_TCPSERVER_H
 
 #include "../base/noncopyable.h"
+#include <cstdint>
 #include <string>
 #include <memory>
-#include <map>
 #include <functional>
+#include <vector>
 
 class EventLoop;
 class Acceptor;
+class InetAddress;
+struct SocketOptions;
 class TcpConnection;
 class Buffer;
 class EventLoopThreadPool;
+class UnixAddress;
 
 // TcpServer：用户使用的服务器类
 // 
@@ -25,6 +29,7 @@ public:
     using ConnectionPtr = std::shared_ptr<TcpConnection>;
     using MessageCallback = std::function<void(const ConnectionPtr&, Buffer*)>;
     using ConnectionCallback = std::function<void(const ConnectionPtr&)>;  // 连接建立/断开回调
+    using ThreadInitCallback = std::function<void(EventLoop*)>;  // IO线程初始化回调
     
     // 构造函数
     // loop: 事件循环
@@ -34,12 +39,25 @@ public:
              const std::string& name,
              int port);
     
+    // 监听指定的地址：InetAddress(port)是所有IPv4接口，InetAddress("::", port)是IPv6，
+    // IPv6默认双栈（IPv4客户端也能连上，对端地址是::ffff:a.b.c.d），ipv6Only时只接受IPv6
+    TcpServer(EventLoop* loop,
+              const std::string& name,
+              const InetAddress& listenAddr,
+              bool ipv6Only = false);
+    
+    // 监听Unix域socket（同一台机器上的客户端，比如sidecar），连接和TCP的完全一样
+    // 在路上的数据只受发送端SO_SNDBUF限制（没有TCP的窗口自动增长），大块传输时两端都要调大
+    TcpServer(EventLoop* loop,
+              const std::string& name,
+              const UnixAddress& listenAddr);
+    
     ~TcpServer();
     
     // === 基本信息获取 ===
     EventLoop* getLoop() const { return loop_; }
     const std::string& name() const { return name_; }
-    std::string ipPort() const;  // 获取监听地址字符串
+    std::string ipPort() const;  // 获取监听地址字符串（IPv6是"[ip]:端口"，Unix域socket是"unix:路径"）
     
     // === 回调设置 ===
     // 设置消息回调（用户的业务逻辑）
@@ -52,34 +70,67 @@ public:
         connectionCallback_ = cb;
     }
     
+    // 每个IO线程开始循环之前在该线程调用（没有IO线程时对getLoop()调用一次），start()之前设置
+    // 用来准备每个loop独占的数据（连接池等），start()返回时所有回调都已经执行完
+    void setThreadInitCallback(const ThreadInitCallback& cb) {
+        threadInitCallback_ = cb;
+    }
+    
+    // === 连接Buffer内存回收策略（应用到之后建立的所有连接） ===
+    void setBufferShrinkThreshold(size_t threshold) {
+        bufferShrinkThreshold_ = threshold;
+    }
+    
+    void setBufferIdleShrinkDelay(double delay) {
+        bufferIdleShrinkDelay_ = delay;
+    }
+    
+    // 监听socket和新连接的socket选项：backlog、TCP_NODELAY、缓冲区大小等（start()之前设置）
+    // 默认backlog为128，其他都用系统默认值；预设见SocketOptions::lowLatency()等
+    void setSocketOptions(const SocketOptions& options);
+    
     // === 服务器控制 ===
     // 设置IO线程数量（0表示所有IO都在主线程）
     void setThreadNum(int numThreads);
     
     // 启动服务器
     void start();
+    
+    // === 连接统计和遍历 ===
+    // 当前的连接数（各IO线程计数之和），可以在任意线程调用
+    size_t connectionCount() const;
+    
+    // 对每个连接调用cb：在连接所在的IO线程执行，调用时立即返回（用于统计、广播等）
+    // 各IO线程之间没有先后顺序，之后才建立的连接可能也会被遍历到
+    void forEachConnection(const ConnectionCallback& cb);
 
 private:
     // 处理新连接（Acceptor会调用这个）
     void newConnection(int sockfd);
     
-    // 移除连接（连接断开时调用）
-    void removeConnection(const ConnectionPtr& conn);
-    void removeConnectionInLoop(const ConnectionPtr& conn);
+    // 一个IO线程上的连接（定义在TcpServer.cpp）
+    struct LoopConnections;
     
     EventLoop* loop_;                      // 主事件循环（Acceptor所在）
     const std::string name_;               // 服务器名称
     const int port_;                       // 监听端口
+    std::string listenAddress_;            // 监听的地址（按端口构造时为空）
     std::unique_ptr<Acceptor> acceptor_;   // 负责accept
     std::unique_ptr<EventLoopThreadPool> threadPool_;  // IO线程池
     
     MessageCallback messageCallback_;      // 用户的消息处理函数
     ConnectionCallback connectionCallback_; // 用户的连接处理函数
+    ThreadInitCallback threadInitCallback_; // IO线程初始化回调
+    
+    size_t bufferShrinkThreshold_;         // 连接Buffer收缩阈值
+    double bufferIdleShrinkDelay_;         // 连接Buffer空闲收缩延迟
     
-    // 保存所有的连接
-    // key是连接名，value是TcpConnection
-    std::map<std::string, ConnectionPtr> connections_;
-    int nextConnId_;  // 连接计数器
+    // 保存所有的连接：每个IO线程一张表，只在该IO线程修改，连接建立和关闭都不用回到主线程
+    // 和threadPool_->getAllLoops()一一对应，start()时创建
+    std::vector<std::shared_ptr<LoopConnections>> loopConnections_;
+    size_t nextLoop_;                      // 轮询分配连接
+    std::shared_ptr<const std::string> connNamePrefix_;  // 连接名的前缀（服务器名称）
+    uint64_t nextConnId_;                  // 连接编号，从1开始
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef TINY_NETWORK_NET_TIMER_H
+#define TINY_NETWORK_NET_TIMER_H
+
+#include "../base/noncopyable.h"
+#include "../base/Timestamp.h"
+#include <functional>
+#include <atomic>
+
+// Timer：一个定时任务
+//
+// 保存回调、到期时间和重复间隔
+// interval > 0 表示周期性定时器，到期后会自动重新计算下一次到期时间
+class Timer : noncopyable {
+public:
+    using TimerCallback = std::function<void()>;
+
+    Timer(TimerCallback cb, Timestamp when, double interval)
+        : callback_(std::move(cb)),
+          expiration_(when),
+          interval_(interval),
+          repeat_(interval > 0.0),
+          sequence_(++s_numCreated_) {}
+
+    void run() const { callback_(); }
+
+    Timestamp expiration() const { return expiration_; }
+    bool repeat() const { return repeat_; }
+    int64_t sequence() const { return sequence_; }
+
+    // 周期定时器重新计算到期时间
+    void restart(Timestamp now) {
+        expiration_ = repeat_ ? addTime(now, interval_) : Timestamp();
+    }
+
+private:
+    const TimerCallback callback_;   // 到期时执行的回调
+    Timestamp expiration_;           // 到期时间
+    const double interval_;          // 重复间隔（秒）
+    const bool repeat_;              // 是否重复
+    const int64_t sequence_;         // 全局唯一序号（区分地址复用的Timer）
+
+    static std::atomic<int64_t> s_numCreated_;
+};
+
+// TimerId：用户持有的定时器句柄，用于取消定时器
+// 同时保存指针和序号，避免Timer被释放后地址复用导致误取消
+class TimerId {
+public:
+    TimerId() : timer_(nullptr), sequence_(0) {}
+    TimerId(Timer* timer, int64_t seq) : timer_(timer), sequence_(seq) {}
+
+    bool valid() const { return timer_ != nullptr; }
+
+private:
+    friend class TimerQueue;
+
+    Timer* timer_;
+    int64_t sequence_;
+};
+
+#endif
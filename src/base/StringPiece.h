@@ -0,0 +1,93 @@
+#ifndef TINY_NETWORK_BASE_STRINGPIECE_H
+#define TINY_NETWORK_BASE_STRINGPIECE_H
+
+#include <cstring>
+#include <string>
+#include <ostream>
+#include <strings.h>  // for strncasecmp
+
+// StringPiece：指向一段字符的只读视图（不拥有内存）
+//
+// 作用和C++17的std::string_view一样，本项目使用C++14所以自己实现
+// 典型用法：HTTP解析结果直接指向输入Buffer里的数据，不再构造std::string
+//
+// 注意：StringPiece只保存指针和长度，底层数据必须比它活得更久
+class StringPiece {
+public:
+    StringPiece() : ptr_(nullptr), length_(0) {}
+    StringPiece(const char* str) : ptr_(str), length_(str ? strlen(str) : 0) {}
+    StringPiece(const std::string& str) : ptr_(str.data()), length_(str.size()) {}
+    StringPiece(const char* offset, size_t len) : ptr_(offset), length_(len) {}
+    StringPiece(const char* begin, const char* end)
+        : ptr_(begin), length_(static_cast<size_t>(end - begin)) {}
+    
+    const char* data() const { return ptr_; }
+    size_t size() const { return length_; }
+    bool empty() const { return length_ == 0; }
+    const char* begin() const { return ptr_; }
+    const char* end() const { return ptr_ + length_; }
+    
+    char operator[](size_t i) const { return ptr_[i]; }
+    
+    void remove_prefix(size_t n) {
+        ptr_ += n;
+        length_ -= n;
+    }
+    
+    void remove_suffix(size_t n) {
+        length_ -= n;
+    }
+    
+    bool starts_with(const StringPiece& x) const {
+        return length_ >= x.length_ && memcmp(ptr_, x.ptr_, x.length_) == 0;
+    }
+    
+    bool ends_with(const StringPiece& x) const {
+        return length_ >= x.length_
+            && memcmp(ptr_ + length_ - x.length_, x.ptr_, x.length_) == 0;
+    }
+    
+    // 忽略大小写比较（HTTP头部名称不区分大小写）
+    bool equalsIgnoreCase(const StringPiece& x) const {
+        return length_ == x.length_
+            && (length_ == 0 || strncasecmp(ptr_, x.ptr_, length_) == 0);
+    }
+    
+    int compare(const StringPiece& x) const {
+        size_t n = length_ < x.length_ ? length_ : x.length_;
+        int r = n == 0 ? 0 : memcmp(ptr_, x.ptr_, n);
+        if (r == 0) {
+            if (length_ < x.length_) r = -1;
+            else if (length_ > x.length_) r = +1;
+        }
+        return r;
+    }
+    
+    bool operator==(const StringPiece& x) const {
+        return length_ == x.length_
+            && (length_ == 0 || memcmp(ptr_, x.ptr_, length_) == 0);
+    }
+    
+    bool operator!=(const StringPiece& x) const {
+        return !(*this == x);
+    }
+    
+    bool operator<(const StringPiece& x) const {
+        return compare(x) < 0;
+    }
+    
+    // 需要长期保存时显式拷贝一份
+    std::string as_string() const {
+        return std::string(ptr_, length_);
+    }
+
+private:
+    const char* ptr_;
+    size_t length_;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const StringPiece& piece) {
+    return os.write(piece.data(), static_cast<std::streamsize>(piece.size()));
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(const std::string& name)
+    : name_(name),
+      maxQueueSize_(0),
+      running_(false)
+{
+}
+
+ThreadPool::~ThreadPool() {
+    if (running_) {
+        stop();
+    }
+}
+
+void ThreadPool::start(int numThreads) {
+    running_ = true;
+    threads_.reserve(numThreads);
+    for (int i = 0; i < numThreads; ++i) {
+        threads_.emplace_back(new Thread(std::bind(&ThreadPool::runInThread, this),
+                                         name_ + std::to_string(i)));
+        threads_.back()->start();
+    }
+}
+
+void ThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        queue_.clear();
+    }
+    notEmpty_.notify_all();
+    for (auto& thread : threads_) {
+        thread->join();
+    }
+    threads_.clear();
+}
+
+bool ThreadPool::run(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || threads_.empty()
+            || (maxQueueSize_ > 0 && queue_.size() >= maxQueueSize_)) {
+            return false;
+        }
+        queue_.push_back(std::move(task));
+    }
+    notEmpty_.notify_one();
+    return true;
+}
+
+size_t ThreadPool::queueSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+// 工作线程：取任务、执行，直到stop()
+void ThreadPool::runInThread() {
+    while (true) {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            notEmpty_.wait(lock, [this] { return !queue_.empty() || !running_; });
+            if (!running_) {
+                return;
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef TINY_NETWORK_BASE_THREADPOOL_H
+#define TINY_NETWORK_BASE_THREADPOOL_H
+
+#include "noncopyable.h"
+#include "Thread.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ThreadPool：执行阻塞/耗CPU任务的工作线程池
+//
+// 和EventLoopThreadPool不同，这里的线程不跑事件循环，只从队列里取任务执行
+// 典型用法：IO线程把压缩、业务计算等耗时操作交给工作线程，
+// 做完之后再用EventLoop::queueInLoop把结果送回IO线程
+//
+// run()不会阻塞：队列满时直接返回false，由调用者决定在当前线程执行还是拒绝请求
+// （IO线程被阻塞的话，这个loop上的所有连接都会卡住）
+class ThreadPool : noncopyable {
+public:
+    using Task = std::function<void()>;
+    
+    explicit ThreadPool(const std::string& name = std::string("ThreadPool"));
+    ~ThreadPool();
+    
+    // 队列长度上限，0表示不限制（start之前设置）
+    void setMaxQueueSize(size_t maxSize) { maxQueueSize_ = maxSize; }
+    
+    // 启动numThreads个工作线程
+    void start(int numThreads);
+    
+    // 停止：不再接受新任务，等正在执行的任务结束，队列里剩下的任务丢弃
+    void stop();
+    
+    // 提交任务，队列已满或线程池没有运行时返回false
+    bool run(Task task);
+    
+    size_t queueSize() const;
+    size_t numThreads() const { return threads_.size(); }
+    bool running() const { return running_; }
+    const std::string& name() const { return name_; }
+
+private:
+    void runInThread();
+    
+    std::string name_;
+    size_t maxQueueSize_;
+    bool running_;
+    mutable std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::deque<Task> queue_;
+    std::vector<std::unique_ptr<Thread>> threads_;
+};
+
+#endif
@@ -44,4 +44,16 @@ inline bool operator>(Timestamp lhs, Timestamp rhs) {
     return lhs.microSecondsSinceEpoch() > rhs.microSecondsSinceEpoch();
 }
 
+// 时间戳加上若干秒（定时器计算到期时间用）
+inline Timestamp addTime(Timestamp timestamp, double seconds) {
+    int64_t delta = static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond);
+    return Timestamp(timestamp.microSecondsSinceEpoch() + delta);
+}
+
+// 两个时间戳相差的秒数（high - low）
+inline double timeDifference(Timestamp high, Timestamp low) {
+    int64_t diff = high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+    return static_cast<double>(diff) / Timestamp::kMicroSecondsPerSecond;
+}
+
 #endif
\ No newline at end of file
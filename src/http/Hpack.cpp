@@ -0,0 +1,477 @@
+#include "Hpack.h"
+#include <cstring>      // for memcmp
+#include <stdint.h>
+#include <vector>
+
+namespace {
+
+struct StaticEntry {
+    const char* name;
+    const char* value;
+};
+
+// RFC 7541 附录A
+const StaticEntry kStaticTable[] = {
+    { ":authority", "" },
+    { ":method", "GET" },
+    { ":method", "POST" },
+    { ":path", "/" },
+    { ":path", "/index.html" },
+    { ":scheme", "http" },
+    { ":scheme", "https" },
+    { ":status", "200" },
+    { ":status", "204" },
+    { ":status", "206" },
+    { ":status", "304" },
+    { ":status", "400" },
+    { ":status", "404" },
+    { ":status", "500" },
+    { "accept-charset", "" },
+    { "accept-encoding", "gzip, deflate" },
+    { "accept-language", "" },
+    { "accept-ranges", "" },
+    { "accept", "" },
+    { "access-control-allow-origin", "" },
+    { "age", "" },
+    { "allow", "" },
+    { "authorization", "" },
+    { "cache-control", "" },
+    { "content-disposition", "" },
+    { "content-encoding", "" },
+    { "content-language", "" },
+    { "content-length", "" },
+    { "content-location", "" },
+    { "content-range", "" },
+    { "content-type", "" },
+    { "cookie", "" },
+    { "date", "" },
+    { "etag", "" },
+    { "expect", "" },
+    { "expires", "" },
+    { "from", "" },
+    { "host", "" },
+    { "if-match", "" },
+    { "if-modified-since", "" },
+    { "if-none-match", "" },
+    { "if-range", "" },
+    { "if-unmodified-since", "" },
+    { "last-modified", "" },
+    { "link", "" },
+    { "location", "" },
+    { "max-forwards", "" },
+    { "proxy-authenticate", "" },
+    { "proxy-authorization", "" },
+    { "range", "" },
+    { "referer", "" },
+    { "refresh", "" },
+    { "retry-after", "" },
+    { "server", "" },
+    { "set-cookie", "" },
+    { "strict-transport-security", "" },
+    { "transfer-encoding", "" },
+    { "user-agent", "" },
+    { "vary", "" },
+    { "via", "" },
+    { "www-authenticate", "" },
+};
+
+// RFC 7541 附录B：每个符号（0~255，256是EOS）的Huffman码和位数
+const uint32_t kHuffmanCodes[257] = {
+    0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+    0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+    0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+    0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+    0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+    0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+    0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+    0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+    0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+    0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+    0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+    0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+    0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+    0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+    0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+    0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+    0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+    0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+    0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+    0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+    0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+    0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+    0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+    0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+    0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+    0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+    0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+    0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+    0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+    0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+    0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+    0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+    0x3fffffff,
+};
+
+const uint8_t kHuffmanLengths[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+
+// Huffman解码树：内部节点children[bit]，叶子节点的symbol >= 0
+// 码长最多30位，树一共511个节点，第一次使用时构造
+struct HuffmanTree {
+    struct Node {
+        int16_t children[2];
+        int16_t symbol;
+    };
+    
+    HuffmanTree() {
+        nodes.reserve(512);
+        nodes.push_back(Node{ { -1, -1 }, -1 });
+        for (int sym = 0; sym < 257; ++sym) {
+            int node = 0;
+            for (int bit = kHuffmanLengths[sym] - 1; bit >= 0; --bit) {
+                int b = (kHuffmanCodes[sym] >> bit) & 1;
+                if (nodes[node].children[b] < 0) {
+                    nodes[node].children[b] = static_cast<int16_t>(nodes.size());
+                    nodes.push_back(Node{ { -1, -1 }, -1 });
+                }
+                node = nodes[node].children[b];
+            }
+            nodes[node].symbol = static_cast<int16_t>(sym);
+        }
+    }
+    
+    std::vector<Node> nodes;
+};
+
+const HuffmanTree& huffmanTree() {
+    static const HuffmanTree tree;  // C++11起局部静态变量的初始化是线程安全的
+    return tree;
+}
+
+bool decodeInteger(const unsigned char*& p, const unsigned char* end, int prefixBits, uint64_t* value) {
+    if (p >= end) {
+        return false;
+    }
+    uint64_t max = (1u << prefixBits) - 1;
+    uint64_t v = *p++ & max;
+    if (v < max) {
+        *value = v;
+        return true;
+    }
+    int shift = 0;
+    while (p < end) {
+        unsigned char b = *p++;
+        v += static_cast<uint64_t>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            *value = v;
+            return true;
+        }
+        shift += 7;
+        if (shift > 28) {
+            return false;  // 超过32位，不可能是合法的长度或索引
+        }
+    }
+    return false;
+}
+
+// 字符串：H位 + 7位前缀的长度
+bool decodeString(const unsigned char*& p, const unsigned char* end, std::string* out) {
+    if (p >= end) {
+        return false;
+    }
+    bool huffman = (*p & 0x80) != 0;
+    uint64_t length;
+    if (!decodeInteger(p, end, 7, &length) || length > static_cast<uint64_t>(end - p)) {
+        return false;
+    }
+    StringPiece s(reinterpret_cast<const char*>(p), static_cast<size_t>(length));
+    p += length;
+    out->clear();
+    if (huffman) {
+        return HpackDecoder::decodeHuffman(s, out);
+    }
+    out->assign(s.data(), s.size());
+    return true;
+}
+
+}  // namespace
+
+// === HpackTable ===
+
+HpackTable::HpackTable(size_t maxSize)
+    : size_(0),
+      maxSize_(maxSize)
+{
+}
+
+void HpackTable::setMaxSize(size_t maxSize) {
+    maxSize_ = maxSize;
+    evict(maxSize_);
+}
+
+void HpackTable::evict(size_t limit) {
+    while (size_ > limit && !entries_.empty()) {
+        size_ -= entries_.back().first.size() + entries_.back().second.size() + kEntryOverhead;
+        entries_.pop_back();
+    }
+}
+
+// 比整个表还大的条目：清空表，但不加入（RFC 7541 4.4）
+void HpackTable::add(StringPiece name, StringPiece value) {
+    size_t entrySize = name.size() + value.size() + kEntryOverhead;
+    if (entrySize > maxSize_) {
+        evict(0);
+        return;
+    }
+    evict(maxSize_ - entrySize);
+    entries_.emplace_front(name.as_string(), value.as_string());
+    size_ += entrySize;
+}
+
+bool HpackTable::get(size_t index, StringPiece* name, StringPiece* value) const {
+    if (index == 0) {
+        return false;
+    }
+    if (index <= kStaticTableSize) {
+        *name = kStaticTable[index - 1].name;
+        *value = kStaticTable[index - 1].value;
+        return true;
+    }
+    index -= kStaticTableSize + 1;
+    if (index >= entries_.size()) {
+        return false;
+    }
+    *name = entries_[index].first;
+    *value = entries_[index].second;
+    return true;
+}
+
+size_t HpackTable::find(StringPiece name, StringPiece value, size_t* nameIndex) const {
+    *nameIndex = 0;
+    for (size_t i = 0; i < kStaticTableSize; ++i) {
+        if (name == kStaticTable[i].name) {
+            if (value == kStaticTable[i].value) {
+                return i + 1;
+            }
+            if (*nameIndex == 0) {
+                *nameIndex = i + 1;
+            }
+        }
+    }
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (name == entries_[i].first) {
+            if (value == entries_[i].second) {
+                return kStaticTableSize + 1 + i;
+            }
+            if (*nameIndex == 0) {
+                *nameIndex = kStaticTableSize + 1 + i;
+            }
+        }
+    }
+    return 0;
+}
+
+// === HpackDecoder ===
+
+HpackDecoder::HpackDecoder(size_t maxTableSize)
+    : table_(maxTableSize),
+      maxTableSize_(maxTableSize)
+{
+}
+
+bool HpackDecoder::decode(StringPiece block, const HeaderCallback& cb) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(block.data());
+    const unsigned char* end = p + block.size();
+    bool headerSeen = false;
+    
+    while (p < end) {
+        unsigned char b = *p;
+        uint64_t index;
+        if (b & 0x80) {
+            // 索引
+            StringPiece name, value;
+            if (!decodeInteger(p, end, 7, &index) || !table_.get(static_cast<size_t>(index), &name, &value)) {
+                return false;
+            }
+            cb(name, value);
+            headerSeen = true;
+        } else if ((b & 0xE0) == 0x20) {
+            // 动态表大小更新，只能出现在头部块开头
+            if (headerSeen || !decodeInteger(p, end, 5, &index) || index > maxTableSize_) {
+                return false;
+            }
+            table_.setMaxSize(static_cast<size_t>(index));
+        } else {
+            // 字面量：01 加入动态表（6位前缀），0000/0001 不加入（4位前缀）
+            bool indexing = (b & 0xC0) == 0x40;
+            if (!decodeInteger(p, end, indexing ? 6 : 4, &index)) {
+                return false;
+            }
+            if (index == 0) {
+                if (!decodeString(p, end, &name_)) {
+                    return false;
+                }
+            } else {
+                StringPiece name, value;
+                if (!table_.get(static_cast<size_t>(index), &name, &value)) {
+                    return false;
+                }
+                name_.assign(name.data(), name.size());
+            }
+            if (!decodeString(p, end, &value_)) {
+                return false;
+            }
+            cb(name_, value_);
+            if (indexing) {
+                table_.add(name_, value_);
+            }
+            headerSeen = true;
+        }
+    }
+    return true;
+}
+
+// 逐位沿解码树走，到叶子输出一个字节
+// 结尾的填充必须是不超过7位的全1（EOS码的前缀），EOS本身不能出现
+bool HpackDecoder::decodeHuffman(StringPiece in, std::string* out) {
+    const std::vector<HuffmanTree::Node>& nodes = huffmanTree().nodes;
+    int node = 0;
+    int depth = 0;          // 当前码已经读了几位
+    bool allOnes = true;    // 当前码到目前为止是否全是1
+    for (size_t i = 0; i < in.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(in[i]);
+        for (int bit = 7; bit >= 0; --bit) {
+            int b = (c >> bit) & 1;
+            node = nodes[node].children[b];
+            if (node < 0) {
+                return false;
+            }
+            ++depth;
+            allOnes = allOnes && b == 1;
+            int symbol = nodes[node].symbol;
+            if (symbol >= 0) {
+                if (symbol == 256) {
+                    return false;
+                }
+                out->push_back(static_cast<char>(symbol));
+                node = 0;
+                depth = 0;
+                allOnes = true;
+            }
+        }
+    }
+    return depth < 8 && allOnes;
+}
+
+// === HpackEncoder ===
+
+HpackEncoder::HpackEncoder()
+    : table_(4096),
+      sizeUpdatePending_(false)
+{
+}
+
+void HpackEncoder::setMaxTableSize(size_t maxSize) {
+    // 我们自己的动态表最多用4096字节，对方允许更大也不用
+    if (maxSize > 4096) {
+        maxSize = 4096;
+    }
+    if (maxSize != table_.maxSize()) {
+        table_.setMaxSize(maxSize);
+        sizeUpdatePending_ = true;
+    }
+}
+
+void HpackEncoder::encodeInteger(uint64_t value, int prefixBits, unsigned char flags, std::string* out) {
+    uint64_t max = (1u << prefixBits) - 1;
+    if (value < max) {
+        out->push_back(static_cast<char>(flags | value));
+        return;
+    }
+    out->push_back(static_cast<char>(flags | max));
+    value -= max;
+    while (value >= 0x80) {
+        out->push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out->push_back(static_cast<char>(value));
+}
+
+void HpackEncoder::encodeString(StringPiece s, std::string* out) {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        bits += kHuffmanLengths[static_cast<unsigned char>(s[i])];
+    }
+    size_t huffmanSize = static_cast<size_t>((bits + 7) / 8);
+    if (huffmanSize >= s.size()) {
+        encodeInteger(s.size(), 7, 0, out);
+        out->append(s.data(), s.size());
+        return;
+    }
+    
+    encodeInteger(huffmanSize, 7, 0x80, out);
+    uint64_t acc = 0;   // 还没输出的位
+    int count = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        acc = (acc << kHuffmanLengths[c]) | kHuffmanCodes[c];
+        count += kHuffmanLengths[c];
+        while (count >= 8) {
+            count -= 8;
+            out->push_back(static_cast<char>(acc >> count));
+        }
+    }
+    if (count > 0) {
+        // 用EOS的高位（全1）填充
+        out->push_back(static_cast<char>((acc << (8 - count)) | (0xFF >> count)));
+    }
+}
+
+void HpackEncoder::encode(StringPiece name, StringPiece value, std::string* out) {
+    if (sizeUpdatePending_) {
+        encodeInteger(table_.maxSize(), 5, 0x20, out);
+        sizeUpdatePending_ = false;
+    }
+    
+    size_t nameIndex = 0;
+    size_t index = table_.find(name, value, &nameIndex);
+    if (index != 0) {
+        encodeInteger(index, 7, 0x80, out);
+        return;
+    }
+    
+    // 每个响应都不同的值加入动态表只会把有用的条目挤出去
+    bool indexing = !(name == "date" || name == "content-length" || name == "etag"
+                      || name == "last-modified" || name == "content-range"
+                      || name == "set-cookie" || name == ":path")
+                    && name.size() + value.size() + HpackTable::kEntryOverhead <= table_.maxSize() / 2;
+    if (indexing) {
+        encodeInteger(nameIndex, 6, 0x40, out);
+    } else {
+        encodeInteger(nameIndex, 4, name == "set-cookie" ? 0x10 : 0x00, out);  // Cookie永不索引
+    }
+    if (nameIndex == 0) {
+        encodeString(name, out);
+    }
+    encodeString(value, out);
+    if (indexing) {
+        table_.add(name, value);
+    }
+}
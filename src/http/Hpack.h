@@ -0,0 +1,101 @@
+#ifndef TINY_NETWORK_HTTP_HPACK_H
+#define TINY_NETWORK_HTTP_HPACK_H
+
+#include "../base/noncopyable.h"
+#include "../base/StringPiece.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <utility>
+
+// HPACK（RFC 7541）：HTTP/2的头部压缩
+//
+// 头部块由一串表示组成：
+//   1xxxxxxx  索引（静态表1~61，之后是动态表）
+//   01xxxxxx  字面量，加入动态表
+//   0000xxxx  字面量，不加入动态表
+//   0001xxxx  字面量，永不索引（中间的代理也不能索引，如Cookie）
+//   001xxxxx  动态表大小更新
+// 字符串可以是原文或Huffman编码
+//
+// 每个连接一对编码器/解码器（两个方向的动态表是独立的），只在连接的IO线程使用
+
+// 动态表：新加入的条目索引最小，总大小（name + value + 32）超过上限时淘汰最老的
+class HpackTable {
+public:
+    static const size_t kStaticTableSize = 61;
+    static const size_t kEntryOverhead = 32;
+    
+    explicit HpackTable(size_t maxSize);
+    
+    void setMaxSize(size_t maxSize);
+    size_t maxSize() const { return maxSize_; }
+    size_t size() const { return size_; }
+    size_t entryCount() const { return entries_.size(); }
+    
+    void add(StringPiece name, StringPiece value);
+    
+    // index从1开始，包括静态表；越界返回false
+    bool get(size_t index, StringPiece* name, StringPiece* value) const;
+    
+    // 查找完全匹配的条目，找不到时nameIndex是名字匹配的条目（都没有时为0）
+    size_t find(StringPiece name, StringPiece value, size_t* nameIndex) const;
+
+private:
+    void evict(size_t limit);
+    
+    std::deque<std::pair<std::string, std::string>> entries_;  // 最新的在前面
+    size_t size_;
+    size_t maxSize_;
+};
+
+class HpackDecoder : noncopyable {
+public:
+    // 解码出的每个头部调用一次，name和value只在回调期间有效
+    using HeaderCallback = std::function<void(StringPiece name, StringPiece value)>;
+    
+    // maxTableSize是我们在SETTINGS_HEADER_TABLE_SIZE中允许的上限
+    explicit HpackDecoder(size_t maxTableSize = 4096);
+    
+    // 解码一个完整的头部块，格式错误返回false（连接级别的COMPRESSION_ERROR）
+    bool decode(StringPiece block, const HeaderCallback& cb);
+    
+    size_t tableSize() const { return table_.size(); }
+    
+    // Huffman解码，结果追加到out
+    static bool decodeHuffman(StringPiece in, std::string* out);
+
+private:
+    HpackTable table_;
+    size_t maxTableSize_;
+    std::string name_;      // 解码字符串用的临时空间，复用容量
+    std::string value_;
+};
+
+class HpackEncoder : noncopyable {
+public:
+    HpackEncoder();
+    
+    // 对方的SETTINGS_HEADER_TABLE_SIZE：下一个头部块开头会带上动态表大小更新
+    void setMaxTableSize(size_t maxSize);
+    
+    // 编码一个头部追加到out，name必须是小写
+    // 重复出现的头部（content-type、server等）加入动态表，之后只需要1个字节
+    // 每个响应都不一样的头部（date、content-length、etag...）不加入动态表
+    void encode(StringPiece name, StringPiece value, std::string* out);
+    
+    size_t tableSize() const { return table_.size(); }
+    
+    // 整数编码，prefixBits是第一个字节中可用的位数，flags是第一个字节的高位
+    static void encodeInteger(uint64_t value, int prefixBits, unsigned char flags, std::string* out);
+    
+    // 字符串：Huffman编码更短时使用Huffman
+    static void encodeString(StringPiece s, std::string* out);
+
+private:
+    HpackTable table_;
+    bool sizeUpdatePending_;
+};
+
+#endif
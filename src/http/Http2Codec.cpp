@@ -0,0 +1,65 @@
+#include "Http2Codec.h"
+#include "../net/Buffer.h"
+#include <cstring>      // for memcpy
+
+const char Http2Codec::kClientPreface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+const size_t Http2Codec::kFrameHeaderSize;
+const size_t Http2Codec::kClientPrefaceSize;
+const uint32_t Http2Codec::kDefaultWindowSize;
+const uint32_t Http2Codec::kDefaultMaxFrameSize;
+const uint32_t Http2Codec::kMaxWindowSize;
+
+bool Http2Codec::parseHeader(const char* data, size_t len, FrameHeader* header) {
+    if (len < kFrameHeaderSize) {
+        return false;
+    }
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    header->length = (static_cast<uint32_t>(p[0]) << 16) | (p[1] << 8) | p[2];
+    header->type = p[3];
+    header->flags = p[4];
+    header->streamId = readUint32(data + 5) & 0x7FFFFFFF;  // 忽略保留位
+    return true;
+}
+
+void Http2Codec::appendFrameHeader(Buffer* out, uint32_t length, int type, int flags, uint32_t streamId) {
+    char header[kFrameHeaderSize];
+    header[0] = static_cast<char>(length >> 16);
+    header[1] = static_cast<char>(length >> 8);
+    header[2] = static_cast<char>(length);
+    header[3] = static_cast<char>(type);
+    header[4] = static_cast<char>(flags);
+    writeUint32(header + 5, streamId & 0x7FFFFFFF);
+    out->append(header, kFrameHeaderSize);
+}
+
+void Http2Codec::appendFrame(Buffer* out, int type, int flags, uint32_t streamId, StringPiece payload) {
+    out->ensureWritableBytes(kFrameHeaderSize + payload.size());
+    appendFrameHeader(out, static_cast<uint32_t>(payload.size()), type, flags, streamId);
+    out->append(payload.data(), payload.size());
+}
+
+void Http2Codec::appendSetting(char* p, int id, uint32_t value) {
+    p[0] = static_cast<char>(id >> 8);
+    p[1] = static_cast<char>(id);
+    writeUint32(p + 2, value);
+}
+
+void Http2Codec::appendWindowUpdate(Buffer* out, uint32_t streamId, uint32_t increment) {
+    char payload[4];
+    writeUint32(payload, increment & 0x7FFFFFFF);
+    appendFrame(out, kWindowUpdate, 0, streamId, StringPiece(payload, 4));
+}
+
+void Http2Codec::appendRstStream(Buffer* out, uint32_t streamId, uint32_t errorCode) {
+    char payload[4];
+    writeUint32(payload, errorCode);
+    appendFrame(out, kRstStream, 0, streamId, StringPiece(payload, 4));
+}
+
+void Http2Codec::appendGoAway(Buffer* out, uint32_t lastStreamId, uint32_t errorCode) {
+    char payload[8];
+    writeUint32(payload, lastStreamId & 0x7FFFFFFF);
+    writeUint32(payload + 4, errorCode);
+    appendFrame(out, kGoAway, 0, 0, StringPiece(payload, 8));
+}
@@ -0,0 +1,886 @@
+#include "Http2Connection.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "../net/TcpConnection.h"
+#include "../logger/Logger.h"
+#include <algorithm>    // for std::min
+#include <cstring>      // for memcmp, memchr
+#include <unistd.h>     // for pread, close
+
+const uint32_t Http2Connection::kMaxConcurrentStreams;
+const uint32_t Http2Connection::kInitialWindowSize;
+const uint32_t Http2Connection::kMaxHeaderBlockSize;
+
+namespace {
+
+// 头部值中是否包含token（逗号分隔，不区分大小写），如Upgrade: h2c, websocket
+bool hasToken(StringPiece value, StringPiece token) {
+    const char* p = value.begin();
+    while (p < value.end()) {
+        while (p < value.end() && (*p == ' ' || *p == '\t' || *p == ',')) {
+            ++p;
+        }
+        const char* start = p;
+        while (p < value.end() && *p != ',') {
+            ++p;
+        }
+        StringPiece item(start, p);
+        while (!item.empty() && (item[item.size() - 1] == ' ' || item[item.size() - 1] == '\t')) {
+            item.remove_suffix(1);
+        }
+        if (item.equalsIgnoreCase(token)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 请求头是否存在（HTTP2-Settings的值可以为空，不能用getHeader判断）
+bool hasHeader(const HttpRequest& req, StringPiece field) {
+    for (int i = 0; i < req.headerCount(); ++i) {
+        if (req.headerField(i).equalsIgnoreCase(field)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// base64url解码（RFC 4648 5，不带填充），HTTP2-Settings用
+bool decodeBase64Url(StringPiece in, std::string* out) {
+    unsigned value = 0;
+    int bits = 0;
+    for (size_t i = 0; i < in.size(); ++i) {
+        char c = in[i];
+        int d;
+        if (c >= 'A' && c <= 'Z') {
+            d = c - 'A';
+        } else if (c >= 'a' && c <= 'z') {
+            d = c - 'a' + 26;
+        } else if (c >= '0' && c <= '9') {
+            d = c - '0' + 52;
+        } else if (c == '-' || c == '+') {
+            d = 62;
+        } else if (c == '_' || c == '/') {
+            d = 63;
+        } else if (c == '=') {
+            break;
+        } else {
+            return false;
+        }
+        value = (value << 6) | static_cast<unsigned>(d);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out->push_back(static_cast<char>((value >> bits) & 0xFF));
+        }
+    }
+    return true;
+}
+
+// HTTP/2禁止的连接相关头部（RFC 7540 8.1.2.2）
+bool isConnectionSpecific(StringPiece name) {
+    return name == "connection" || name == "keep-alive" || name == "proxy-connection"
+        || name == "transfer-encoding" || name == "upgrade";
+}
+
+bool hasUpperCase(StringPiece s) {
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] >= 'A' && s[i] <= 'Z') {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 1xx、204、304不能带响应体
+bool mayHaveBody(int code) {
+    return code >= 200 && code != 204 && code != 304;
+}
+
+}  // namespace
+
+Http2Connection::Stream::Stream(uint32_t streamId, int64_t window)
+    : id(streamId),
+      remoteClosed(false),
+      responding(false),
+      blocked(false),
+      sendWindow(window),
+      recvWindow(kInitialWindowSize),
+      method{0, 0, 0},
+      path{0, 0, 0},
+      authority{0, 0, 0},
+      headerError(false),
+      sawRegularHeader(false),
+      dataOffset(0),
+      dataRemaining(0),
+      fd(-1),
+      fileOffset(0)
+{
+}
+
+Http2Connection::Stream::~Stream() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+Http2Connection::Http2Connection(const std::shared_ptr<TcpConnection>& conn,
+                                 const RequestHandler& handler,
+                                 size_t maxBodySize)
+    : conn_(conn),
+      name_(conn->name()),
+      handler_(handler),
+      maxBodySize_(maxBodySize),
+      prefaceReceived_(false),
+      settingsReceived_(false),
+      goingAway_(false),
+      lastStreamId_(0),
+      peerInitialWindowSize_(Http2Codec::kDefaultWindowSize),
+      peerMaxFrameSize_(Http2Codec::kDefaultMaxFrameSize),
+      sendWindow_(Http2Codec::kDefaultWindowSize),
+      recvWindow_(Http2Codec::kDefaultWindowSize),
+      continuationStreamId_(0),
+      continuationEndStream_(false)
+{
+    LOG_DEBUG << "Http2Connection[" << name_ << "] created";
+}
+
+Http2Connection::~Http2Connection() {
+    LOG_DEBUG << "Http2Connection[" << name_ << "] destroyed, last stream " << lastStreamId_;
+}
+
+bool Http2Connection::isUpgradeRequest(const HttpRequest& req) {
+    return hasToken(req.getHeader("Upgrade"), "h2c") && hasHeader(req, "HTTP2-Settings");
+}
+
+int Http2Connection::checkPreface(const Buffer* buf) {
+    size_t n = std::min<size_t>(buf->readableBytes(), Http2Codec::kClientPrefaceSize);
+    if (memcmp(buf->peek(), Http2Codec::kClientPreface, n) != 0) {
+        return -1;
+    }
+    return n == Http2Codec::kClientPrefaceSize ? 1 : 0;
+}
+
+// 服务器的连接前言：SETTINGS，再把连接的接收窗口从65535扩大到kInitialWindowSize
+// （连接窗口不受SETTINGS_INITIAL_WINDOW_SIZE影响，只能用WINDOW_UPDATE调整）
+void Http2Connection::sendSettings() {
+    char payload[18];
+    Http2Codec::appendSetting(payload, Http2Codec::kSettingsMaxConcurrentStreams, kMaxConcurrentStreams);
+    Http2Codec::appendSetting(payload + 6, Http2Codec::kSettingsInitialWindowSize, kInitialWindowSize);
+    Http2Codec::appendSetting(payload + 12, Http2Codec::kSettingsEnablePush, 0);
+    Http2Codec::appendFrame(&output_, Http2Codec::kSettings, 0, 0, StringPiece(payload, sizeof payload));
+    Http2Codec::appendWindowUpdate(&output_, 0, kInitialWindowSize - Http2Codec::kDefaultWindowSize);
+    recvWindow_ = kInitialWindowSize;
+}
+
+void Http2Connection::start(Buffer* buf, Timestamp receiveTime) {
+    sendSettings();
+    handleData(buf, receiveTime);
+}
+
+bool Http2Connection::startUpgrade(const HttpRequest& req, StringPiece settings) {
+    receiveTime_ = req.receiveTime();
+    sendSettings();
+    
+    // HTTP2-Settings里的设置由101隐式确认，不回复ACK
+    std::string payload;
+    if (!decodeBase64Url(settings, &payload) || payload.size() % 6 != 0
+        || !applySettings(payload.data(), payload.size())) {
+        if (!goingAway_) {
+            connectionError(Http2Codec::kProtocolError, "invalid HTTP2-Settings");
+        }
+        return false;
+    }
+    
+    // 升级的请求是stream 1，请求已经收完（half-closed remote）
+    lastStreamId_ = 1;
+    Stream* stream = new Stream(1, peerInitialWindowSize_);
+    streams_[1].reset(stream);
+    stream->remoteClosed = true;
+    
+    HttpRequest request = req;
+    HttpResponse response(false);
+    handler_(request, &response);
+    sendResponse(stream, &response, req.method() == HttpRequest::kHead || response.headOnly());
+    flushOutput();
+    return true;
+}
+
+void Http2Connection::handleData(Buffer* buf, Timestamp receiveTime) {
+    receiveTime_ = receiveTime;
+    if (goingAway_) {
+        buf->retrieveAll();
+        return;
+    }
+    
+    if (!prefaceReceived_) {
+        int preface = checkPreface(buf);
+        if (preface == 0) {
+            return;
+        }
+        if (preface < 0) {
+            connectionError(Http2Codec::kProtocolError, "bad connection preface");
+            buf->retrieveAll();
+            return;
+        }
+        buf->retrieve(Http2Codec::kClientPrefaceSize);
+        prefaceReceived_ = true;
+    }
+    
+    // 处理所有完整的帧，payload直接指向buf
+    Http2Codec::FrameHeader header;
+    while (Http2Codec::parseHeader(buf->peek(), buf->readableBytes(), &header)) {
+        // 我们没有通告更大的SETTINGS_MAX_FRAME_SIZE
+        if (header.length > Http2Codec::kDefaultMaxFrameSize) {
+            connectionError(Http2Codec::kFrameSizeError, "frame too large");
+            break;
+        }
+        if (buf->readableBytes() < Http2Codec::kFrameHeaderSize + header.length) {
+            break;
+        }
+        bool ok = handleFrame(header, buf->peek() + Http2Codec::kFrameHeaderSize);
+        buf->retrieve(Http2Codec::kFrameHeaderSize + header.length);
+        if (!ok) {
+            break;
+        }
+    }
+    if (goingAway_) {
+        buf->retrieveAll();
+    }
+    
+    flushOutput();
+}
+
+bool Http2Connection::handleFrame(const Http2Codec::FrameHeader& header, const char* payload) {
+    // 连接前言之后的第一个帧必须是SETTINGS
+    if (!settingsReceived_ && (header.type != Http2Codec::kSettings || (header.flags & Http2Codec::kFlagAck))) {
+        return connectionError(Http2Codec::kProtocolError, "expected SETTINGS");
+    }
+    
+    // 头部块的HEADERS和CONTINUATION之间不能插入其他帧
+    if (continuationStreamId_ != 0 && header.type != Http2Codec::kContinuation) {
+        return connectionError(Http2Codec::kProtocolError, "expected CONTINUATION");
+    }
+    
+    switch (header.type) {
+        case Http2Codec::kData:
+            return onData(header, payload);
+        case Http2Codec::kHeaders:
+            return onHeaders(header, payload);
+        case Http2Codec::kContinuation:
+            return onContinuation(header, payload);
+        case Http2Codec::kSettings:
+            return onSettings(header, payload);
+        case Http2Codec::kWindowUpdate:
+            return onWindowUpdate(header, payload);
+        case Http2Codec::kRstStream:
+            return onRstStream(header, payload);
+        case Http2Codec::kPriority:
+            // 不实现优先级，只检查格式
+            if (header.streamId == 0) {
+                return connectionError(Http2Codec::kProtocolError, "PRIORITY on stream 0");
+            }
+            if (header.length != 5) {
+                resetStream(header.streamId, Http2Codec::kFrameSizeError);
+            }
+            return true;
+        case Http2Codec::kPing:
+            if (header.streamId != 0) {
+                return connectionError(Http2Codec::kProtocolError, "PING on a stream");
+            }
+            if (header.length != 8) {
+                return connectionError(Http2Codec::kFrameSizeError, "bad PING length");
+            }
+            if (!(header.flags & Http2Codec::kFlagAck)) {
+                Http2Codec::appendFrame(&output_, Http2Codec::kPing, Http2Codec::kFlagAck, 0,
+                                        StringPiece(payload, 8));
+            }
+            return true;
+        case Http2Codec::kGoAway:
+            if (header.streamId != 0) {
+                return connectionError(Http2Codec::kProtocolError, "GOAWAY on a stream");
+            }
+            // 对方不再打开新的stream，已有的响应照常发完，连接由对方关闭
+            LOG_DEBUG << "Http2Connection[" << name_ << "] GOAWAY received";
+            return true;
+        case Http2Codec::kPushPromise:
+            // 客户端不能推送
+            return connectionError(Http2Codec::kProtocolError, "PUSH_PROMISE from client");
+        default:
+            // 未知类型的帧必须忽略
+            return true;
+    }
+}
+
+bool Http2Connection::onHeaders(const Http2Codec::FrameHeader& header, const char* payload) {
+    if (header.streamId == 0 || (header.streamId & 1) == 0) {
+        return connectionError(Http2Codec::kProtocolError, "bad HEADERS stream id");
+    }
+    
+    // 去掉填充和优先级字段
+    size_t begin = 0;
+    size_t end = header.length;
+    if (header.flags & Http2Codec::kFlagPadded) {
+        if (header.length < 1) {
+            return connectionError(Http2Codec::kFrameSizeError, "bad HEADERS padding");
+        }
+        size_t padLength = static_cast<unsigned char>(payload[0]);
+        begin = 1;
+        if (padLength >= end - begin) {
+            return connectionError(Http2Codec::kProtocolError, "bad HEADERS padding");
+        }
+        end -= padLength;
+    }
+    if (header.flags & Http2Codec::kFlagPriority) {
+        if (end - begin < 5) {
+            return connectionError(Http2Codec::kFrameSizeError, "bad HEADERS priority");
+        }
+        begin += 5;
+    }
+    
+    continuationStreamId_ = header.streamId;
+    continuationEndStream_ = (header.flags & Http2Codec::kFlagEndStream) != 0;
+    headerBlock_.assign(payload + begin, end - begin);
+    
+    if (header.flags & Http2Codec::kFlagEndHeaders) {
+        return onHeaderBlockEnd();
+    }
+    return true;
+}
+
+bool Http2Connection::onContinuation(const Http2Codec::FrameHeader& header, const char* payload) {
+    if (continuationStreamId_ == 0 || header.streamId != continuationStreamId_) {
+        return connectionError(Http2Codec::kProtocolError, "unexpected CONTINUATION");
+    }
+    if (headerBlock_.size() + header.length > kMaxHeaderBlockSize) {
+        return connectionError(Http2Codec::kEnhanceYourCalm, "header block too large");
+    }
+    headerBlock_.append(payload, header.length);
+    
+    if (header.flags & Http2Codec::kFlagEndHeaders) {
+        return onHeaderBlockEnd();
+    }
+    return true;
+}
+
+// 头部块完整了：新的请求，或者请求体之后的trailer
+// 不管stream是否还存在，头部块都要解码，否则HPACK动态表会和对方不同步
+bool Http2Connection::onHeaderBlockEnd() {
+    uint32_t streamId = continuationStreamId_;
+    bool endStream = continuationEndStream_;
+    continuationStreamId_ = 0;
+    
+    Stream* stream = findStream(streamId);
+    if (stream) {
+        // trailer：只检查格式，内容不交给处理函数
+        if (!decodeHeaders(nullptr, headerBlock_)) {
+            return connectionError(Http2Codec::kCompressionError, "HPACK decoding failed");
+        }
+        if (stream->remoteClosed) {
+            resetStream(streamId, Http2Codec::kStreamClosed);
+        } else if (!endStream) {
+            resetStream(streamId, Http2Codec::kProtocolError);
+        } else {
+            stream->remoteClosed = true;
+            dispatch(stream);
+        }
+        return true;
+    }
+    
+    if (streamId <= lastStreamId_) {
+        // 已经关闭的stream（id只能递增）
+        decodeHeaders(nullptr, headerBlock_);
+        return connectionError(Http2Codec::kStreamClosed, "HEADERS on closed stream");
+    }
+    lastStreamId_ = streamId;
+    
+    if (streams_.size() >= kMaxConcurrentStreams) {
+        if (!decodeHeaders(nullptr, headerBlock_)) {
+            return connectionError(Http2Codec::kCompressionError, "HPACK decoding failed");
+        }
+        resetStream(streamId, Http2Codec::kRefusedStream);
+        return true;
+    }
+    
+    stream = new Stream(streamId, peerInitialWindowSize_);
+    streams_[streamId].reset(stream);
+    if (!decodeHeaders(stream, headerBlock_)) {
+        return connectionError(Http2Codec::kCompressionError, "HPACK decoding failed");
+    }
+    if (stream->headerError || stream->method.valueLength == 0 || stream->path.valueLength == 0) {
+        resetStream(streamId, Http2Codec::kProtocolError);
+        return true;
+    }
+    if (endStream) {
+        stream->remoteClosed = true;
+        dispatch(stream);
+    }
+    return true;
+}
+
+bool Http2Connection::decodeHeaders(Stream* stream, StringPiece block) {
+    return decoder_.decode(block, [stream](StringPiece name, StringPiece value) {
+        if (!stream || stream->headerError) {
+            return;
+        }
+        if (stream->headerStore.size() + name.size() + value.size() > kMaxHeaderBlockSize) {
+            stream->headerError = true;
+            return;
+        }
+        
+        std::string& store = stream->headerStore;
+        Stream::Field field = { static_cast<uint32_t>(store.size()), 0, static_cast<uint32_t>(value.size()) };
+        if (!name.empty() && name[0] == ':') {
+            // 伪头部：只在开头出现，每个只能有一个，值单独存放
+            Stream::Field* target = nullptr;
+            if (name == ":method") {
+                target = &stream->method;
+            } else if (name == ":path") {
+                target = &stream->path;
+            } else if (name == ":authority") {
+                target = &stream->authority;
+            } else if (name != ":scheme") {
+                stream->headerError = true;
+                return;
+            }
+            if (stream->sawRegularHeader || (target && target->valueLength != 0)) {
+                stream->headerError = true;
+                return;
+            }
+            store.append(value.data(), value.size());
+            if (target) {
+                *target = field;
+            }
+            
+            // :authority同时作为Host头部（HTTP/1.1的处理函数只认Host）
+            if (target == &stream->authority) {
+                Stream::Field host = { static_cast<uint32_t>(store.size()), 4, static_cast<uint32_t>(value.size()) };
+                store.append("host:", 5);
+                store.append(value.data(), value.size());
+                stream->fields.push_back(host);
+            }
+            return;
+        }
+        
+        // 普通头部：名字必须是小写，不能有连接相关的头部（TE只能是trailers）
+        stream->sawRegularHeader = true;
+        if (hasUpperCase(name) || isConnectionSpecific(name)
+            || (name == "te" && value != "trailers")
+            || stream->fields.size() >= static_cast<size_t>(HttpRequest::kMaxHeaders)) {
+            stream->headerError = true;
+            return;
+        }
+        field.nameLength = static_cast<uint32_t>(name.size());
+        store.append(name.data(), name.size());
+        store.push_back(':');
+        store.append(value.data(), value.size());
+        stream->fields.push_back(field);
+    });
+}
+
+bool Http2Connection::onData(const Http2Codec::FrameHeader& header, const char* payload) {
+    if (header.streamId == 0) {
+        return connectionError(Http2Codec::kProtocolError, "DATA on stream 0");
+    }
+    if (header.streamId > lastStreamId_) {
+        return connectionError(Http2Codec::kProtocolError, "DATA on idle stream");
+    }
+    
+    size_t begin = 0;
+    size_t end = header.length;
+    if (header.flags & Http2Codec::kFlagPadded) {
+        if (header.length < 1) {
+            return connectionError(Http2Codec::kFrameSizeError, "bad DATA padding");
+        }
+        size_t padLength = static_cast<unsigned char>(payload[0]);
+        begin = 1;
+        if (padLength > end - begin) {
+            return connectionError(Http2Codec::kProtocolError, "bad DATA padding");
+        }
+        end -= padLength;
+    }
+    
+    // 整个帧（包括填充）都计入流量控制
+    if (!consumeWindow(header.length)) {
+        return false;
+    }
+    Stream* stream = findStream(header.streamId);
+    if (!stream) {
+        // 我们已经关闭或reset的stream，对方可能还有数据在路上
+        return true;
+    }
+    if (stream->remoteClosed) {
+        resetStream(header.streamId, Http2Codec::kStreamClosed);
+        return true;
+    }
+    stream->recvWindow -= header.length;
+    if (stream->recvWindow < 0) {
+        resetStream(header.streamId, Http2Codec::kFlowControlError);
+        return true;
+    }
+    
+    if (stream->body.size() + (end - begin) > maxBodySize_) {
+        // 请求体太大：直接回复413，然后reset（对方不用再发剩下的请求体）
+        uint32_t streamId = stream->id;
+        stream->remoteClosed = true;
+        HttpResponse response(false);
+        response.setStatusCode(HttpResponse::k413PayloadTooLarge);
+        sendResponse(stream, &response, false);
+        if (findStream(streamId)) {
+            closeStream(streamId);
+        }
+        Http2Codec::appendRstStream(&output_, streamId, Http2Codec::kNoError);
+        return true;
+    }
+    stream->body.append(payload + begin, end - begin);
+    
+    if (header.flags & Http2Codec::kFlagEndStream) {
+        stream->remoteClosed = true;
+        dispatch(stream);
+    } else if (stream->recvWindow <= kInitialWindowSize / 2) {
+        // 窗口剩下不到一半时一次补满，而不是每个DATA帧回一个WINDOW_UPDATE
+        Http2Codec::appendWindowUpdate(&output_, stream->id,
+                                       static_cast<uint32_t>(kInitialWindowSize - stream->recvWindow));
+        stream->recvWindow = kInitialWindowSize;
+    }
+    return true;
+}
+
+// 连接的接收窗口：已经reset的stream上的数据也要计入
+bool Http2Connection::consumeWindow(uint32_t length) {
+    recvWindow_ -= length;
+    if (recvWindow_ < 0) {
+        return connectionError(Http2Codec::kFlowControlError, "connection window exceeded");
+    }
+    if (recvWindow_ <= kInitialWindowSize / 2) {
+        Http2Codec::appendWindowUpdate(&output_, 0, static_cast<uint32_t>(kInitialWindowSize - recvWindow_));
+        recvWindow_ = kInitialWindowSize;
+    }
+    return true;
+}
+
+bool Http2Connection::onSettings(const Http2Codec::FrameHeader& header, const char* payload) {
+    if (header.streamId != 0) {
+        return connectionError(Http2Codec::kProtocolError, "SETTINGS on a stream");
+    }
+    if (header.flags & Http2Codec::kFlagAck) {
+        if (header.length != 0) {
+            return connectionError(Http2Codec::kFrameSizeError, "SETTINGS ACK with payload");
+        }
+        return true;
+    }
+    if (header.length % 6 != 0) {
+        return connectionError(Http2Codec::kFrameSizeError, "bad SETTINGS length");
+    }
+    if (!applySettings(payload, header.length)) {
+        return false;
+    }
+    settingsReceived_ = true;
+    Http2Codec::appendFrameHeader(&output_, 0, Http2Codec::kSettings, Http2Codec::kFlagAck, 0);
+    
+    // INITIAL_WINDOW_SIZE变大了，窗口用完的stream可以继续发送
+    flushBlocked();
+    return true;
+}
+
+bool Http2Connection::applySettings(const char* data, size_t len) {
+    for (size_t i = 0; i + 6 <= len; i += 6) {
+        uint16_t id = Http2Codec::readUint16(data + i);
+        uint32_t value = Http2Codec::readUint32(data + i + 2);
+        switch (id) {
+            case Http2Codec::kSettingsHeaderTableSize:
+                encoder_.setMaxTableSize(value);
+                break;
+            case Http2Codec::kSettingsEnablePush:
+                if (value > 1) {
+                    return connectionError(Http2Codec::kProtocolError, "bad ENABLE_PUSH");
+                }
+                break;
+            case Http2Codec::kSettingsInitialWindowSize: {
+                if (value > Http2Codec::kMaxWindowSize) {
+                    return connectionError(Http2Codec::kFlowControlError, "bad INITIAL_WINDOW_SIZE");
+                }
+                // 已经打开的stream的发送窗口按差值调整（可能变成负数）
+                int64_t delta = static_cast<int64_t>(value) - peerInitialWindowSize_;
+                peerInitialWindowSize_ = value;
+                for (auto& item : streams_) {
+                    item.second->sendWindow += delta;
+                    if (item.second->sendWindow > Http2Codec::kMaxWindowSize) {
+                        return connectionError(Http2Codec::kFlowControlError, "stream window overflow");
+                    }
+                }
+                break;
+            }
+            case Http2Codec::kSettingsMaxFrameSize:
+                if (value < Http2Codec::kDefaultMaxFrameSize || value > 0xFFFFFF) {
+                    return connectionError(Http2Codec::kProtocolError, "bad MAX_FRAME_SIZE");
+                }
+                peerMaxFrameSize_ = value;
+                break;
+            default:
+                // MAX_CONCURRENT_STREAMS（我们不推送）、MAX_HEADER_LIST_SIZE和未知设置忽略
+                break;
+        }
+    }
+    return true;
+}
+
+bool Http2Connection::onWindowUpdate(const Http2Codec::FrameHeader& header, const char* payload) {
+    if (header.length != 4) {
+        return connectionError(Http2Codec::kFrameSizeError, "bad WINDOW_UPDATE length");
+    }
+    uint32_t increment = Http2Codec::readUint32(payload) & 0x7FFFFFFF;
+    
+    if (header.streamId == 0) {
+        if (increment == 0) {
+            return connectionError(Http2Codec::kProtocolError, "zero WINDOW_UPDATE");
+        }
+        sendWindow_ += increment;
+        if (sendWindow_ > Http2Codec::kMaxWindowSize) {
+            return connectionError(Http2Codec::kFlowControlError, "connection window overflow");
+        }
+    } else {
+        Stream* stream = findStream(header.streamId);
+        if (!stream) {
+            if (header.streamId > lastStreamId_) {
+                return connectionError(Http2Codec::kProtocolError, "WINDOW_UPDATE on idle stream");
+            }
+            return true;  // 已经关闭的stream
+        }
+        if (increment == 0) {
+            resetStream(header.streamId, Http2Codec::kProtocolError);
+            return true;
+        }
+        stream->sendWindow += increment;
+        if (stream->sendWindow > Http2Codec::kMaxWindowSize) {
+            resetStream(header.streamId, Http2Codec::kFlowControlError);
+            return true;
+        }
+    }
+    
+    flushBlocked();
+    return true;
+}
+
+bool Http2Connection::onRstStream(const Http2Codec::FrameHeader& header, const char* payload) {
+    if (header.streamId == 0) {
+        return connectionError(Http2Codec::kProtocolError, "RST_STREAM on stream 0");
+    }
+    if (header.length != 4) {
+        return connectionError(Http2Codec::kFrameSizeError, "bad RST_STREAM length");
+    }
+    if (header.streamId > lastStreamId_) {
+        return connectionError(Http2Codec::kProtocolError, "RST_STREAM on idle stream");
+    }
+    LOG_DEBUG << "Http2Connection[" << name_ << "] stream " << header.streamId
+              << " reset by peer, error " << Http2Codec::readUint32(payload);
+    closeStream(header.streamId);
+    return true;
+}
+
+// 用stream的头部存储构造HttpRequest，交给处理函数
+void Http2Connection::dispatch(Stream* stream) {
+    const char* base = stream->headerStore.data();
+    HttpRequest req;
+    req.setBase(base);
+    req.setVersion(HttpRequest::kHttp20);
+    req.setReceiveTime(receiveTime_);
+    
+    HttpResponse response(false);
+    const char* method = base + stream->method.offset;
+    if (!req.setMethod(method, method + stream->method.valueLength)) {
+        response.setStatusCode(HttpResponse::k400BadRequest);
+        sendResponse(stream, &response, false);
+        return;
+    }
+    
+    const char* path = base + stream->path.offset;
+    const char* pathEnd = path + stream->path.valueLength;
+    const char* question = static_cast<const char*>(memchr(path, '?', pathEnd - path));
+    if (question) {
+        req.setPath(path, question);
+        req.setQuery(question + 1, pathEnd);
+    } else {
+        req.setPath(path, pathEnd);
+    }
+    
+    for (const Stream::Field& field : stream->fields) {
+        const char* start = base + field.offset;
+        const char* colon = start + field.nameLength;
+        req.addHeader(start, colon, colon + 1 + field.valueLength);
+    }
+    req.setBody(stream->body);
+    
+    handler_(req, &response);
+    sendResponse(stream, &response, req.method() == HttpRequest::kHead || response.headOnly());
+}
+
+// 响应头：:status、date、content-length，然后是用户的头部（名字转小写，去掉连接相关的头部）
+void Http2Connection::sendResponse(Stream* stream, HttpResponse* response, bool headOnly) {
+    int code = response->statusCode();
+    if (code < 200 || code > 999) {
+        // 处理函数没有设置状态码，或者返回了HTTP/2里不存在的101
+        code = HttpResponse::k500InternalServerError;
+    }
+    
+    scratch_.clear();
+    char status[4] = { static_cast<char>('0' + code / 100), static_cast<char>('0' + code / 10 % 10),
+                       static_cast<char>('0' + code % 10), '\0' };
+    encoder_.encode(":status", StringPiece(status, 3), &scratch_);
+    
+    // "Date: ...\r\n"去掉名字和换行
+    StringPiece date = HttpResponse::dateHeader(receiveTime_);
+    encoder_.encode("date", StringPiece(date.data() + 6, date.size() - 8), &scratch_);
+    
+    bool hasBody = mayHaveBody(code);
+    size_t length = 0;
+    if (hasBody) {
+        off_t offset = 0;
+        if (response->hasFileBody()) {
+            stream->fd = response->releaseFileBody(&offset, &length);
+            stream->fileOffset = offset;
+        } else {
+            stream->data = response->releaseBody(&stream->dataOffset, &length);
+        }
+        std::string lengthText = std::to_string(length);
+        encoder_.encode("content-length", lengthText, &scratch_);
+    }
+    
+    for (int i = 0; i < response->headerCount(); ++i) {
+        StringPiece name = response->headerField(i);
+        lowerName_.assign(name.data(), name.size());
+        for (char& c : lowerName_) {
+            if (c >= 'A' && c <= 'Z') {
+                c = static_cast<char>(c - 'A' + 'a');
+            }
+        }
+        if (isConnectionSpecific(lowerName_) || lowerName_ == "content-length") {
+            continue;
+        }
+        encoder_.encode(lowerName_, response->headerValue(i), &scratch_);
+    }
+    
+    bool sendData = hasBody && !headOnly && length > 0;
+    sendHeaders(stream->id, scratch_, !sendData);
+    if (!sendData) {
+        closeStream(stream->id);
+        return;
+    }
+    
+    stream->responding = true;
+    stream->dataRemaining = length;
+    flushStream(stream);
+}
+
+// 头部块超过对方的MAX_FRAME_SIZE时拆成HEADERS + CONTINUATION
+void Http2Connection::sendHeaders(uint32_t streamId, const std::string& block, bool endStream) {
+    size_t offset = 0;
+    int type = Http2Codec::kHeaders;
+    int flags = endStream ? Http2Codec::kFlagEndStream : 0;
+    do {
+        size_t n = std::min<size_t>(block.size() - offset, peerMaxFrameSize_);
+        if (offset + n == block.size()) {
+            flags |= Http2Codec::kFlagEndHeaders;
+        }
+        Http2Codec::appendFrame(&output_, type, flags, streamId, StringPiece(block.data() + offset, n));
+        offset += n;
+        type = Http2Codec::kContinuation;
+        flags = 0;
+    } while (offset < block.size());
+}
+
+bool Http2Connection::flushStream(Stream* stream) {
+    while (stream->dataRemaining > 0) {
+        int64_t window = std::min(sendWindow_, stream->sendWindow);
+        if (window <= 0) {
+            if (!stream->blocked) {
+                stream->blocked = true;
+                blocked_.push_back(stream->id);
+            }
+            return false;
+        }
+        
+        size_t n = std::min<size_t>(stream->dataRemaining, peerMaxFrameSize_);
+        n = std::min<size_t>(n, static_cast<size_t>(window));
+        int flags = n == stream->dataRemaining ? Http2Codec::kFlagEndStream : 0;
+        
+        if (stream->fd >= 0) {
+            // 文件内容直接pread到输出Buffer里帧头的后面
+            output_.ensureWritableBytes(Http2Codec::kFrameHeaderSize + n);
+            ssize_t nread = ::pread(stream->fd, output_.beginWrite() + Http2Codec::kFrameHeaderSize,
+                                    n, stream->fileOffset);
+            if (nread != static_cast<ssize_t>(n)) {
+                LOG_ERROR << "Http2Connection[" << name_ << "] pread failed on stream " << stream->id;
+                resetStream(stream->id, Http2Codec::kInternalError);
+                return true;
+            }
+            Http2Codec::appendFrameHeader(&output_, static_cast<uint32_t>(n), Http2Codec::kData, flags, stream->id);
+            output_.hasWritten(n);
+            stream->fileOffset += static_cast<off_t>(n);
+        } else {
+            Http2Codec::appendFrame(&output_, Http2Codec::kData, flags, stream->id,
+                                    StringPiece(stream->data->data() + stream->dataOffset, n));
+            stream->dataOffset += n;
+        }
+        stream->dataRemaining -= n;
+        sendWindow_ -= static_cast<int64_t>(n);
+        stream->sendWindow -= static_cast<int64_t>(n);
+    }
+    
+    closeStream(stream->id);
+    return true;
+}
+
+// 按排队顺序轮流发送，连接窗口用完就停
+void Http2Connection::flushBlocked() {
+    size_t count = blocked_.size();
+    while (count-- > 0 && sendWindow_ > 0) {
+        uint32_t streamId = blocked_.front();
+        blocked_.pop_front();
+        Stream* stream = findStream(streamId);
+        if (!stream) {
+            continue;
+        }
+        stream->blocked = false;
+        flushStream(stream);
+    }
+}
+
+void Http2Connection::resetStream(uint32_t streamId, uint32_t errorCode) {
+    Http2Codec::appendRstStream(&output_, streamId, errorCode);
+    closeStream(streamId);
+}
+
+void Http2Connection::closeStream(uint32_t streamId) {
+    streams_.erase(streamId);
+}
+
+bool Http2Connection::connectionError(uint32_t errorCode, const char* reason) {
+    LOG_WARN << "Http2Connection[" << name_ << "] connection error " << errorCode << ": " << reason;
+    Http2Codec::appendGoAway(&output_, lastStreamId_, errorCode);
+    goingAway_ = true;
+    streams_.clear();
+    blocked_.clear();
+    flushOutput();
+    std::shared_ptr<TcpConnection> conn = conn_.lock();
+    if (conn) {
+        conn->shutdown();
+    }
+    return false;
+}
+
+void Http2Connection::flushOutput() {
+    if (output_.readableBytes() == 0) {
+        return;
+    }
+    std::shared_ptr<TcpConnection> conn = conn_.lock();
+    if (conn) {
+        conn->send(&output_);
+    }
+    output_.retrieveAll();
+}
+
+Http2Connection::Stream* Http2Connection::findStream(uint32_t streamId) {
+    auto it = streams_.find(streamId);
+    return it == streams_.end() ? nullptr : it->second.get();
+}
@@ -0,0 +1,187 @@
+#ifndef TINY_NETWORK_HTTP_HTTP2CONNECTION_H
+#define TINY_NETWORK_HTTP_HTTP2CONNECTION_H
+
+#include "../base/noncopyable.h"
+#include "../base/StringPiece.h"
+#include "../base/Timestamp.h"
+#include "../net/Buffer.h"
+#include "Hpack.h"
+#include "Http2Codec.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+class HttpRequest;
+class HttpResponse;
+class TcpConnection;
+
+// Http2Connection：一个HTTP/2（明文，h2c）连接
+//
+// 两种方式进入HTTP/2：
+// 1. prior knowledge：客户端一连上就发送连接前言（curl --http2-prior-knowledge、h2load）
+// 2. Upgrade: h2c：HTTP/1.1请求带Upgrade: h2c和HTTP2-Settings，回复101后切换，
+//    这个请求本身作为stream 1，响应用HTTP/2发送
+//
+// 多路复用：一个连接上同时有多个stream，每个stream是一个请求/响应
+// 请求收完（END_STREAM）后构造HttpRequest，交给和HTTP/1.1相同的处理函数（路由、业务回调）
+// HttpRequest的头部引用stream自己的头部存储（解码后的"name:value"），和HTTP/1.1一样是偏移
+//
+// 流量控制：
+// - 发送：连接和每个stream各有一个窗口，窗口用完的stream排队，收到WINDOW_UPDATE后继续发送
+// - 接收：我们通告1MB的窗口，消费了一半就发WINDOW_UPDATE补回来
+//
+// 一次onMessage产生的所有帧（多个stream的响应、SETTINGS ACK、WINDOW_UPDATE）攒在output_里一次发送
+// 只在连接所在的IO线程使用
+class Http2Connection : noncopyable {
+public:
+    // 处理请求的函数，和HTTP/1.1共用（请求不是const：路由要写入参数）
+    using RequestHandler = std::function<void(HttpRequest&, HttpResponse*)>;
+    
+    // 我们的SETTINGS
+    static const uint32_t kMaxConcurrentStreams = 128;
+    static const uint32_t kInitialWindowSize = 1024 * 1024;
+    static const uint32_t kMaxHeaderBlockSize = 64 * 1024;  // 头部块（含CONTINUATION）的上限
+    
+    Http2Connection(const std::shared_ptr<TcpConnection>& conn, const RequestHandler& handler,
+                    size_t maxBodySize);
+    ~Http2Connection();
+    
+    // prior knowledge：buf以连接前言开头时调用，之后的数据都交给handleData
+    void start(Buffer* buf, Timestamp receiveTime);
+    
+    // Upgrade: h2c：101已经发出，settings是HTTP2-Settings头部（base64url编码的SETTINGS payload）
+    // req作为stream 1处理，返回false表示HTTP2-Settings格式错误（连接已经关闭）
+    bool startUpgrade(const HttpRequest& req, StringPiece settings);
+    
+    // 收到数据：处理所有完整的帧
+    void handleData(Buffer* buf, Timestamp receiveTime);
+    
+    // 检查是不是h2c升级请求：Upgrade包含h2c，并且带HTTP2-Settings
+    static bool isUpgradeRequest(const HttpRequest& req);
+    
+    // buf的开头是不是连接前言：是返回1，不是返回-1，数据不够判断返回0
+    static int checkPreface(const Buffer* buf);
+    
+    // === 统计 ===
+    size_t streamCount() const { return streams_.size(); }
+    uint32_t lastStreamId() const { return lastStreamId_; }
+
+private:
+    // 一个stream：请求的头部和请求体，以及还没发完的响应体
+    struct Stream {
+        explicit Stream(uint32_t streamId, int64_t window);
+        ~Stream();
+        
+        uint32_t id;
+        bool remoteClosed;          // 收到了END_STREAM（请求收完）
+        bool responding;            // 响应已经生成，正在发送响应体
+        bool blocked;               // 在blocked_队列中（窗口用完）
+        int64_t sendWindow;         // 发送窗口（可能被SETTINGS减成负数）
+        int64_t recvWindow;         // 接收窗口（我们通告给对方的剩余部分）
+        
+        // 解码后的头部：fields里记录偏移，dispatch时构造HttpRequest
+        struct Field {
+            uint32_t offset;
+            uint32_t nameLength;
+            uint32_t valueLength;
+        };
+        std::string headerStore;
+        std::vector<Field> fields;
+        Field method;
+        Field path;
+        Field authority;
+        bool headerError;           // 头部不合法（大写名字、缺伪头部等）
+        bool sawRegularHeader;      // 伪头部必须在普通头部之前
+        
+        std::string body;
+        
+        // 响应体：内存（shared_ptr，不拷贝）或者文件（pread）
+        std::shared_ptr<const std::string> data;
+        size_t dataOffset;
+        size_t dataRemaining;
+        int fd;
+        off_t fileOffset;
+    };
+    
+    using StreamPtr = std::unique_ptr<Stream>;
+    
+    // 本地设置和对端设置
+    void sendSettings();
+    bool applySettings(const char* data, size_t len);
+    
+    // 处理一个完整的帧，返回false表示连接已经出错
+    bool handleFrame(const Http2Codec::FrameHeader& header, const char* payload);
+    bool onHeaders(const Http2Codec::FrameHeader& header, const char* payload);
+    bool onContinuation(const Http2Codec::FrameHeader& header, const char* payload);
+    bool onHeaderBlockEnd();
+    bool onData(const Http2Codec::FrameHeader& header, const char* payload);
+    bool onSettings(const Http2Codec::FrameHeader& header, const char* payload);
+    bool onWindowUpdate(const Http2Codec::FrameHeader& header, const char* payload);
+    bool onRstStream(const Http2Codec::FrameHeader& header, const char* payload);
+    
+    // 解码头部块到stream（stream为空时只解码，保持HPACK状态同步）
+    bool decodeHeaders(Stream* stream, StringPiece block);
+    
+    // 请求收完：调用处理函数，发送响应
+    void dispatch(Stream* stream);
+    void sendResponse(Stream* stream, HttpResponse* response, bool headOnly);
+    void sendHeaders(uint32_t streamId, const std::string& block, bool endStream);
+    
+    // 在窗口允许的范围内发送响应体，发完返回true（stream已经删除）
+    bool flushStream(Stream* stream);
+    void flushBlocked();
+    
+    // 收到DATA：扣减连接的接收窗口，剩下不到一半时发送WINDOW_UPDATE补回
+    bool consumeWindow(uint32_t length);
+    
+    void resetStream(uint32_t streamId, uint32_t errorCode);
+    void closeStream(uint32_t streamId);
+    
+    // 连接错误：发送GOAWAY后关闭连接
+    bool connectionError(uint32_t errorCode, const char* reason);
+    
+    void flushOutput();
+    
+    Stream* findStream(uint32_t streamId);
+    
+    std::weak_ptr<TcpConnection> conn_;
+    std::string name_;
+    RequestHandler handler_;
+    size_t maxBodySize_;
+    
+    HpackDecoder decoder_;
+    HpackEncoder encoder_;
+    
+    bool prefaceReceived_;
+    bool settingsReceived_;             // 第一个帧必须是SETTINGS
+    bool goingAway_;                    // 发送了GOAWAY，不再处理任何帧
+    uint32_t lastStreamId_;             // 对方打开的最大stream id
+    
+    // 对方的设置
+    uint32_t peerInitialWindowSize_;
+    uint32_t peerMaxFrameSize_;
+    
+    // 连接级别的流量控制
+    int64_t sendWindow_;
+    int64_t recvWindow_;
+    
+    // 正在接收的头部块（HEADERS之后跟着CONTINUATION）
+    uint32_t continuationStreamId_;     // 0表示没有
+    bool continuationEndStream_;
+    std::string headerBlock_;
+    
+    std::unordered_map<uint32_t, StreamPtr> streams_;
+    std::deque<uint32_t> blocked_;      // 窗口用完、等待WINDOW_UPDATE的stream
+    
+    Timestamp receiveTime_;             // 当前这批数据的接收时间
+    Buffer output_;                     // 一次handleData产生的所有帧
+    std::string scratch_;               // 编码头部块用的临时空间
+    std::string lowerName_;             // 响应头名字转小写
+};
+
+#endif
@@ -0,0 +1,387 @@
+#include "HttpCompressor.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include <cstring>      // for memcmp
+#include <zlib.h>
+
+namespace {
+
+StringPiece trim(StringPiece s) {
+    while (!s.empty() && (s[0] == ' ' || s[0] == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s[s.size() - 1] == ' ' || s[s.size() - 1] == '\t')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+// ";q=0.5"这样的参数，没有q时是1，格式不对按0处理
+double parseQValue(StringPiece params) {
+    while (!params.empty()) {
+        size_t semi = 0;
+        while (semi < params.size() && params[semi] != ';') {
+            ++semi;
+        }
+        StringPiece param = trim(StringPiece(params.data(), semi));
+        params.remove_prefix(semi < params.size() ? semi + 1 : semi);
+        if (param.size() < 2 || (param[0] != 'q' && param[0] != 'Q') || param[1] != '=') {
+            continue;
+        }
+        
+        // qvalue = ( "0" [ "." 0*3DIGIT ] ) / ( "1" [ "." 0*3("0") ] )
+        double q = 0;
+        double scale = 1;
+        bool fraction = false;
+        for (size_t i = 2; i < param.size(); ++i) {
+            char c = param[i];
+            if (c == '.' && !fraction) {
+                fraction = true;
+            } else if (c >= '0' && c <= '9') {
+                if (fraction) {
+                    scale /= 10;
+                    q += (c - '0') * scale;
+                } else {
+                    q = q * 10 + (c - '0');
+                }
+            } else {
+                return 0;
+            }
+        }
+        return q > 1 ? 1 : q;
+    }
+    return 1;
+}
+
+// 每个线程每种编码一个z_stream，用deflateReset复用
+// deflateInit2每次要分配、初始化几百KB的窗口和哈希表，1KB的响应体压缩时间大半花在这上面
+class DeflateStream : noncopyable {
+public:
+    DeflateStream() : initialized_(false), level_(0) {
+        memset(&zs_, 0, sizeof zs_);
+    }
+    
+    ~DeflateStream() {
+        if (initialized_) {
+            deflateEnd(&zs_);
+        }
+    }
+    
+    // windowBits：15 + 16输出gzip头部和CRC32，15输出zlib头部和adler32
+    z_stream* get(HttpCompressor::Encoding encoding, int level) {
+        if (initialized_ && level == level_) {
+            if (deflateReset(&zs_) == Z_OK) {
+                return &zs_;
+            }
+        }
+        if (initialized_) {
+            deflateEnd(&zs_);
+            initialized_ = false;
+        }
+        int windowBits = encoding == HttpCompressor::kGzip ? 15 + 16 : 15;
+        memset(&zs_, 0, sizeof zs_);
+        if (deflateInit2(&zs_, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return nullptr;
+        }
+        initialized_ = true;
+        level_ = level;
+        return &zs_;
+    }
+
+private:
+    z_stream zs_;
+    bool initialized_;
+    int level_;
+};
+
+thread_local DeflateStream t_gzipStream;
+thread_local DeflateStream t_deflateStream;
+
+}  // namespace
+
+HttpCompressor::HttpCompressor()
+    : minSize_(kDefaultMinSize),
+      level_(kDefaultLevel),
+      cacheCapacity_(kDefaultCacheCapacity),
+      cachedBytes_(0),
+      hits_(0),
+      misses_(0),
+      bytesIn_(0),
+      bytesOut_(0)
+{
+}
+
+HttpCompressor::~HttpCompressor() {
+}
+
+void HttpCompressor::setCacheCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cacheCapacity_ = capacity;
+    evict();
+}
+
+size_t HttpCompressor::cachedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cachedBytes_;
+}
+
+// Accept-Encoding: gzip;q=1.0, deflate;q=0.5, *;q=0
+// 没有单独列出的编码取*的q值，q=0表示明确拒绝；q相同时gzip优先
+HttpCompressor::Encoding HttpCompressor::negotiate(StringPiece acceptEncoding) {
+    double gzipQ = -1;
+    double deflateQ = -1;
+    double anyQ = -1;
+    
+    const char* p = acceptEncoding.begin();
+    while (p < acceptEncoding.end()) {
+        const char* start = p;
+        while (p < acceptEncoding.end() && *p != ',') {
+            ++p;
+        }
+        StringPiece item(start, p);
+        if (p < acceptEncoding.end()) {
+            ++p;  // 跳过','
+        }
+        
+        size_t semi = 0;
+        while (semi < item.size() && item[semi] != ';') {
+            ++semi;
+        }
+        StringPiece coding = trim(StringPiece(item.data(), semi));
+        StringPiece params(item.data() + semi, item.size() - semi);
+        if (coding.empty()) {
+            continue;
+        }
+        
+        double q = parseQValue(params);
+        if (coding.equalsIgnoreCase("gzip") || coding.equalsIgnoreCase("x-gzip")) {
+            gzipQ = q;
+        } else if (coding.equalsIgnoreCase("deflate")) {
+            deflateQ = q;
+        } else if (coding == "*") {
+            anyQ = q;
+        }
+    }
+    
+    if (gzipQ < 0) {
+        gzipQ = anyQ;
+    }
+    if (deflateQ < 0) {
+        deflateQ = anyQ;
+    }
+    if (gzipQ > 0 && gzipQ >= deflateQ) {
+        return kGzip;
+    }
+    if (deflateQ > 0) {
+        return kDeflate;
+    }
+    return kIdentity;
+}
+
+const char* HttpCompressor::encodingName(Encoding encoding) {
+    switch (encoding) {
+        case kGzip:    return "gzip";
+        case kDeflate: return "deflate";
+        default:       return "identity";
+    }
+}
+
+bool HttpCompressor::isCompressibleType(StringPiece contentType) {
+    // 去掉; charset=utf-8之类的参数
+    size_t semi = 0;
+    while (semi < contentType.size() && contentType[semi] != ';') {
+        ++semi;
+    }
+    StringPiece type = trim(StringPiece(contentType.data(), semi));
+    if (type.size() >= 5 && StringPiece(type.data(), 5).equalsIgnoreCase("text/")) {
+        return true;
+    }
+    
+    static const char* const kTypes[] = {
+        "application/json",
+        "application/javascript",
+        "application/xml",
+        "application/xhtml+xml",
+        "application/rss+xml",
+        "application/manifest+json",
+        "image/svg+xml",
+    };
+    for (const char* t : kTypes) {
+        if (type.equalsIgnoreCase(t)) {
+            return true;
+        }
+    }
+    // application/problem+json、application/vnd.xxx+json等
+    return type.ends_with("+json") || type.ends_with("+xml");
+}
+
+bool HttpCompressor::compress(Encoding encoding, StringPiece in, std::string* out, int level) {
+    if (encoding == kIdentity) {
+        return false;
+    }
+    
+    DeflateStream& stream = encoding == kGzip ? t_gzipStream : t_deflateStream;
+    z_stream* zs = stream.get(encoding, level);
+    if (zs == nullptr) {
+        return false;
+    }
+    
+    // deflateBound给出最坏情况的大小，一次分配好，一次deflate就能完成
+    size_t oldSize = out->size();
+    out->resize(oldSize + deflateBound(zs, static_cast<uLong>(in.size())));
+    zs->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    zs->avail_in = static_cast<uInt>(in.size());
+    zs->next_out = reinterpret_cast<Bytef*>(&(*out)[oldSize]);
+    zs->avail_out = static_cast<uInt>(out->size() - oldSize);
+    
+    int ret = deflate(zs, Z_FINISH);
+    out->resize(oldSize + zs->total_out);
+    if (ret != Z_STREAM_END) {
+        out->resize(oldSize);
+        return false;
+    }
+    return true;
+}
+
+HttpCompressor::Encoding HttpCompressor::select(const HttpRequest& req, HttpResponse* resp) const {
+    // 文件响应体走sendfile，HEAD的Content-Length要和GET的原始长度一致，都不压缩
+    if (resp->statusCode() != HttpResponse::k200Ok || resp->hasFileBody() || resp->headOnly()) {
+        return kIdentity;
+    }
+    if (resp->body().size() < minSize_ || !resp->header("Content-Encoding").empty()) {
+        return kIdentity;
+    }
+    if (!isCompressibleType(resp->header("Content-Type"))) {
+        return kIdentity;
+    }
+    
+    // 同一个URL的响应随Accept-Encoding变化，告诉中间的缓存
+    resp->addHeader("Vary", "Accept-Encoding");
+    return negotiate(req.getHeader("Accept-Encoding"));
+}
+
+bool HttpCompressor::applyCached(Encoding encoding, HttpResponse* resp) {
+    if (cacheCapacity_ == 0) {
+        return false;
+    }
+    StringPiece body = resp->body();
+    std::shared_ptr<const std::string> compressed = lookup(makeKey(encoding, body), body);
+    if (!compressed) {
+        return false;
+    }
+    bytesIn_ += body.size();
+    bytesOut_ += compressed->size();
+    apply(encoding, compressed, resp);
+    return true;
+}
+
+bool HttpCompressor::compressResponse(Encoding encoding, HttpResponse* resp) {
+    StringPiece body = resp->body();
+    Key key = makeKey(encoding, body);
+    std::shared_ptr<const std::string> compressed;
+    if (cacheCapacity_ > 0) {
+        compressed = lookup(key, body);
+    }
+    
+    if (!compressed) {
+        // 压缩时不持有锁，多个线程可以同时压缩
+        std::shared_ptr<std::string> out = std::make_shared<std::string>();
+        if (!compress(encoding, body, out.get(), level_)) {
+            return false;
+        }
+        // 压缩后反而更大（已经压缩过的数据），按原样发送
+        if (out->size() >= body.size()) {
+            return false;
+        }
+        out->shrink_to_fit();
+        compressed = out;
+        if (cacheCapacity_ > 0) {
+            insert(key, body, compressed, resp->hasSharedBody());
+        }
+    }
+    
+    bytesIn_ += body.size();
+    bytesOut_ += compressed->size();
+    apply(encoding, compressed, resp);
+    return true;
+}
+
+// adler32比CRC32快，冲突由命中时的memcmp兜底
+HttpCompressor::Key HttpCompressor::makeKey(Encoding encoding, StringPiece body) {
+    Key key;
+    key.encoding = encoding;
+    key.size = body.size();
+    key.checksum = adler32(adler32(0L, Z_NULL, 0),
+                           reinterpret_cast<const Bytef*>(body.data()),
+                           static_cast<uInt>(body.size()));
+    return key;
+}
+
+std::shared_ptr<const std::string> HttpCompressor::lookup(const Key& key, StringPiece body) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cache_.find(key);
+    if (it == cache_.end()
+        || memcmp(it->second.entry.original.data(), body.data(), body.size()) != 0) {
+        ++misses_;
+        return std::shared_ptr<const std::string>();
+    }
+    ++hits_;
+    lru_.splice(lru_.begin(), lru_, it->second.pos);
+    return it->second.entry.compressed;
+}
+
+void HttpCompressor::insert(const Key& key, StringPiece body,
+                            const std::shared_ptr<const std::string>& compressed, bool admitNow) {
+    size_t bytes = body.size() + compressed->size();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bytes > cacheCapacity_ / 4) {
+        return;  // 单个响应不能占掉缓存的一大块
+    }
+    if (!admitNow && seen_.insert(key).second) {
+        // 第一次见到，先记下来；只记key，数量到上限就整体清空
+        if (seen_.size() > 4096) {
+            seen_.clear();
+        }
+        return;
+    }
+    seen_.erase(key);
+    
+    auto it = cache_.find(key);
+    if (it != cache_.end()) {
+        // 同一个key的另一份原文（冲突）或者别的线程刚放进去的，替换掉
+        cachedBytes_ -= it->second.entry.original.size() + it->second.entry.compressed->size();
+        lru_.erase(it->second.pos);
+        cache_.erase(it);
+    }
+    
+    lru_.push_front(key);
+    Slot& slot = cache_[key];
+    slot.entry.original.assign(body.data(), body.size());
+    slot.entry.compressed = compressed;
+    slot.pos = lru_.begin();
+    cachedBytes_ += bytes;
+    evict();
+}
+
+// 调用者持有锁
+void HttpCompressor::evict() {
+    while (cachedBytes_ > cacheCapacity_ && !lru_.empty()) {
+        auto it = cache_.find(lru_.back());
+        cachedBytes_ -= it->second.entry.original.size() + it->second.entry.compressed->size();
+        cache_.erase(it);
+        lru_.pop_back();
+    }
+}
+
+void HttpCompressor::apply(Encoding encoding, const std::shared_ptr<const std::string>& compressed,
+                           HttpResponse* resp) {
+    resp->setBody(compressed, 0, compressed->size());
+    resp->addHeader("Content-Encoding", encodingName(encoding));
+    
+    // 压缩后的字节和原文不同，强ETag要变成弱ETag（和nginx一样）
+    // StaticFileHandler对If-None-Match做弱比较，304照常生效
+    StringPiece etag = resp->header("ETag");
+    if (!etag.empty() && !etag.starts_with("W/")) {
+        resp->addHeader("ETag", "W/" + etag.as_string());
+    }
+}
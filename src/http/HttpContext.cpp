@@ -1,6 +1,29 @@
 #include "HttpContext.h"
 #include "../net/Buffer.h"
-#include <algorithm>  // for std::find
+#include <algorithm>  // for std::find, std::min
+#include <cstdint>    // for SIZE_MAX
+#include <cstring>    // for strchr
+
+namespace {
+
+// 字段名只能由token字符组成（RFC 7230 3.2.6）
+bool isTchar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+        || (c != '\0' && strchr("!#$%&'*+-.^_`|~", c) != nullptr);
+}
+
+// 去掉两端的OWS（空格和制表符）
+StringPiece trimOws(StringPiece s) {
+    while (!s.empty() && (s[0] == ' ' || s[0] == '\t')) {
+        s.remove_prefix(1);
+    }
+    while (!s.empty() && (s[s.size() - 1] == ' ' || s[s.size() - 1] == '\t')) {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+}  // namespace
 
 // 解析请求行：GET /path?query HTTP/1.1
 bool HttpContext::processRequestLine(const char* begin, const char* end) {
@@ -44,52 +67,305 @@ bool HttpContext::processRequestLine(const char* begin, const char* end) {
 }
 
 // 核心解析函数：状态机驱动
+// 每次只从上次解析到的位置继续找\r\n，已经解析过的行不会重复扫描
 bool HttpContext::parseRequest(Buffer* buf, Timestamp receiveTime) {
     bool ok = true;
     bool hasMore = true;
     
+    // Buffer扩容后数据可能搬家，每次都重新设置请求的起始位置
+    // （流式模式下头部已经拷贝出来了，不再指向Buffer）
+    if (!headersDetached_) {
+        request_.setBase(buf->peek());
+    }
+    
     // 状态机循环，每次处理一行或一个状态
-    while (hasMore) {
+    while (hasMore && ok) {
+        const char* lineStart = buf->peek() + parsed_;
+        size_t available = buf->readableBytes() - parsed_;
+        
         if (state_ == kExpectRequestLine) {
             // 状态1：解析请求行
-            const char* crlf = buf->findCRLF();
-            if (crlf) {
+            const char* crlf = buf->findCRLF(lineStart);
+            if (static_cast<size_t>((crlf ? crlf : lineStart + available) - lineStart) > maxHeaderSize_) {
+                ok = fail(414);  // 请求行太长（一般是URL太长）
+            } else if (crlf) {
                 // 找到完整的请求行
-                ok = processRequestLine(buf->peek(), crlf);
+                ok = processRequestLine(lineStart, crlf) || fail(400);
                 if (ok) {
                     request_.setReceiveTime(receiveTime);
-                    buf->retrieveUntil(crlf + 2);  // 消费请求行（包括\r\n）
-                    state_ = kExpectHeaders;       // 转到下一状态
-                } else {
-                    hasMore = false;  // 解析失败，退出循环
+                    parsed_ = crlf + 2 - buf->peek();  // 跳过请求行（包括\r\n）
+                    state_ = kExpectHeaders;           // 转到下一状态
                 }
             } else {
                 hasMore = false;  // 请求行不完整，等待更多数据
             }
         } else if (state_ == kExpectHeaders) {
             // 状态2：解析请求头部
-            const char* crlf = buf->findCRLF();
-            if (crlf) {
-                const char* colon = std::find(buf->peek(), crlf, ':');
-                if (colon != crlf) {
-                    // 找到头部行：Key: Value
-                    request_.addHeader(buf->peek(), colon, crlf);
+            // 头部还没有detach，parsed_就是请求行加上已经解析的头部行的长度
+            const char* crlf = buf->findCRLF(lineStart);
+            if (parsed_ + ((crlf ? crlf : lineStart + available) - lineStart) > maxHeaderSize_) {
+                ok = fail(431);
+            } else if (crlf) {
+                parsed_ = crlf + 2 - buf->peek();  // 跳过这一行
+                if (crlf == lineStart) {
+                    // 空行表示头部结束，看看有没有请求体
+                    ok = processHeadersEnd(buf);
+                } else if (request_.headerCount() >= maxHeaderCount_) {
+                    ok = fail(431);
                 } else {
-                    // 空行表示头部结束
-                    state_ = kGotAll;  // 简化：暂时不处理请求体
-                    hasMore = false;
+                    // 头部行：Key: Value
+                    // 字段名不能为空，也不能有空白：否则"Content-Length : 5"会被当成别的字段，
+                    // 请求体被当成下一个请求（RFC 7230 3.2.4要求回复400）
+                    const char* colon = std::find(lineStart, crlf, ':');
+                    ok = (colon != crlf && colon != lineStart && std::all_of(lineStart, colon, isTchar)
+                          && request_.addHeader(lineStart, colon, crlf)) || fail(400);
                 }
-                buf->retrieveUntil(crlf + 2);  // 消费这一行
             } else {
                 hasMore = false;  // 头部行不完整，等待更多数据
             }
         } else if (state_ == kExpectBody) {
-            // TODO: 处理请求体（暂时跳过）
-            // 实际项目中需要根据Content-Length解析请求体
-            state_ = kGotAll;
-            hasMore = false;
+            // 状态3：Content-Length请求体
+            size_t n = std::min(available, bodyRemaining_);
+            if (headersDetached_) {
+                // 流式：有多少交多少
+                if (n > 0) {
+                    bodyCallback_(request_, StringPiece(lineStart, n));
+                }
+                parsed_ += n;
+                bodyRemaining_ -= n;
+            } else if (available >= bodyRemaining_) {
+                // 缓存：等整个请求体都到了，body()直接指向Buffer
+                parsed_ += bodyRemaining_;
+                bodyRemaining_ = 0;
+            }
+            if (bodyRemaining_ == 0) {
+                if (!headersDetached_) {
+                    request_.setBody(StringPiece(buf->peek() + bodyOffset_, parsed_ - bodyOffset_));
+                }
+                state_ = kGotAll;
+            } else {
+                hasMore = false;
+            }
+        } else if (state_ == kExpectChunkSize) {
+            // 状态4：chunk大小行（十六进制，可能带;扩展）
+            // 和请求行一样限制长度，否则没有\r\n的扩展可以无限堆积，每次都要从头扫描
+            const char* crlf = buf->findCRLF(lineStart);
+            if (static_cast<size_t>((crlf ? crlf : lineStart + available) - lineStart) > kMaxChunkSizeLine) {
+                ok = fail(400);
+            } else if (crlf) {
+                ok = processChunkSize(lineStart, crlf);
+                parsed_ = crlf + 2 - buf->peek();
+            } else {
+                hasMore = false;
+            }
+        } else if (state_ == kExpectChunkData) {
+            // 状态5：chunk数据，可以分多次到达
+            size_t n = std::min(available, bodyRemaining_);
+            if (n > 0) {
+                onChunkData(lineStart, n);
+                parsed_ += n;
+                bodyRemaining_ -= n;
+            }
+            if (bodyRemaining_ == 0) {
+                state_ = kExpectChunkEnd;
+            } else {
+                hasMore = false;
+            }
+        } else if (state_ == kExpectChunkEnd) {
+            // 状态6：chunk数据后面必须是\r\n
+            if (available >= 2) {
+                ok = (lineStart[0] == '\r' && lineStart[1] == '\n') || fail(400);
+                parsed_ += 2;
+                state_ = kExpectChunkSize;
+            } else {
+                hasMore = false;
+            }
+        } else if (state_ == kExpectTrailers) {
+            // 状态7：trailer头部（忽略），空行表示请求结束
+            // 大小和行数按头部的上限单独计算
+            const char* crlf = buf->findCRLF(lineStart);
+            size_t lineLength = (crlf ? crlf : lineStart + available) - lineStart;
+            if (trailerSize_ + lineLength > maxHeaderSize_) {
+                ok = fail(431);
+            } else if (crlf) {
+                parsed_ = crlf + 2 - buf->peek();
+                trailerSize_ += lineLength + 2;
+                if (crlf == lineStart) {
+                    if (!headersDetached_) {
+                        request_.setBody(body_);
+                    }
+                    state_ = kGotAll;
+                } else if (++trailerCount_ > maxHeaderCount_) {
+                    ok = fail(431);
+                }
+            } else {
+                hasMore = false;
+            }
+        } else {
+            hasMore = false;  // 已经解析完成
+        }
+        
+        // 流式模式：请求体已经交给用户，立即从Buffer中取走
+        if (headersDetached_ && parsed_ > 0) {
+            buf->retrieve(parsed_);
+            parsed_ = 0;
         }
     }
     
     return ok;
-}
\ No newline at end of file
+}
+
+// 头部结束：决定请求体的长度
+bool HttpContext::processHeadersEnd(Buffer* buf) {
+    headerSize_ = parsed_;
+    
+    // 可以有多个Content-Length头部，值必须都合法而且相同，
+    // 否则前面的代理和这里可能按不同的长度切分请求（请求走私）
+    // 多个Transfer-Encoding头部等于用逗号连在一起，决定分帧的是最后一个编码
+    bool hasContentLength = false;
+    bool hasTransferEncoding = false;
+    size_t length = 0;
+    StringPiece lastCoding;
+    for (int i = 0; i < request_.headerCount(); ++i) {
+        StringPiece field = request_.headerField(i);
+        if (field.equalsIgnoreCase("Transfer-Encoding")) {
+            StringPiece value = request_.headerValue(i);
+            const char* start = value.begin();
+            for (const char* p = value.begin(); p != value.end(); ++p) {
+                if (*p == ',') {
+                    start = p + 1;
+                }
+            }
+            hasTransferEncoding = true;
+            lastCoding = trimOws(StringPiece(start, value.end() - start));
+            continue;
+        }
+        if (!field.equalsIgnoreCase("Content-Length")) {
+            continue;
+        }
+        StringPiece value = request_.headerValue(i);
+        if (value.empty()) {
+            return fail(400);
+        }
+        size_t n = 0;
+        for (char c : value) {
+            if (c < '0' || c > '9' || n > (SIZE_MAX - 9) / 10) {
+                return fail(400);
+            }
+            n = n * 10 + (c - '0');
+        }
+        if (hasContentLength && n != length) {
+            return fail(400);
+        }
+        hasContentLength = true;
+        length = n;
+    }
+    
+    if (hasTransferEncoding) {
+        // 同时出现两个头部是请求走私的典型手法，直接拒绝
+        if (hasContentLength) {
+            return fail(400);
+        }
+        // 只支持chunked（必须是最后一个编码，完整的token）
+        if (!lastCoding.equalsIgnoreCase("chunked")) {
+            return fail(400);
+        }
+        state_ = kExpectChunkSize;
+    } else if (hasContentLength) {
+        if (length > maxBodySize_ && !bodyCallback_) {
+            return fail(413);
+        }
+        if (length == 0) {
+            state_ = kGotAll;
+            return true;
+        }
+        state_ = kExpectBody;
+        bodyRemaining_ = length;
+        bodyOffset_ = parsed_;
+    } else {
+        // 没有请求体
+        state_ = kGotAll;
+        return true;
+    }
+    
+    StringPiece expect = request_.getHeader("Expect");
+    expectContinue_ = request_.version() == HttpRequest::kHttp11
+                   && expect.equalsIgnoreCase("100-continue");
+    
+    if (bodyCallback_) {
+        detachHeaders(buf);
+    }
+    return true;
+}
+
+// 解析chunk大小行：1a2b;name=value
+bool HttpContext::processChunkSize(const char* begin, const char* end) {
+    size_t size = 0;
+    const char* p = begin;
+    for (; p < end && *p != ';' && *p != ' ' && *p != '\t'; ++p) {
+        int digit;
+        if (*p >= '0' && *p <= '9') digit = *p - '0';
+        else if (*p >= 'a' && *p <= 'f') digit = *p - 'a' + 10;
+        else if (*p >= 'A' && *p <= 'F') digit = *p - 'A' + 10;
+        else return fail(400);
+        if (size > (SIZE_MAX >> 4)) {
+            return fail(400);
+        }
+        size = (size << 4) | digit;
+    }
+    if (p == begin) {
+        return fail(400);  // 没有数字
+    }
+    
+    if (size == 0) {
+        // 最后一个chunk
+        state_ = kExpectTrailers;
+        return true;
+    }
+    
+    bodyReceived_ += size;
+    if (bodyReceived_ > maxBodySize_ && !bodyCallback_) {
+        return fail(413);
+    }
+    bodyRemaining_ = size;
+    state_ = kExpectChunkData;
+    return true;
+}
+
+// chunk数据：流式交给用户，否则拼接到body_
+void HttpContext::onChunkData(const char* data, size_t len) {
+    if (headersDetached_) {
+        bodyCallback_(request_, StringPiece(data, len));
+    } else {
+        body_.append(data, len);
+    }
+}
+
+// 把头部拷贝到headerStore_（容量复用），然后从Buffer中取走
+void HttpContext::detachHeaders(Buffer* buf) {
+    headerStore_.assign(buf->peek(), parsed_);
+    request_.setBase(headerStore_.data());
+    buf->retrieve(parsed_);
+    parsed_ = 0;
+    headersDetached_ = true;
+}
+
+void HttpContext::copyRequest(std::string* store, HttpRequest* out) const {
+    StringPiece body = request_.body();
+    store->reserve(headerSize_ + body.size());
+    store->assign(request_.base(), headerSize_);
+    store->append(body.data(), body.size());
+    
+    *out = request_;
+    out->setBase(store->data());
+    out->setBody(StringPiece(store->data() + headerSize_, body.size()));
+    out->clearParams();  // 参数指向原来的数据，由新请求重新路由
+}
+
+// 请求处理完毕：这时才从Buffer中取走请求的数据
+void HttpContext::finishRequest(Buffer* buf) {
+    buf->retrieve(parsed_);
+    ++requestCount_;
+    timeoutPhase_ = kNoTimeout;
+    reset();
+}
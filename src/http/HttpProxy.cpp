@@ -0,0 +1,864 @@
+#include "HttpProxy.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "HttpResponseParser.h"
+#include "HttpResponseStream.h"
+#include "HttpResponseWriter.h"
+#include "../net/Buffer.h"
+#include "../net/ConnectionPool.h"
+#include "../net/Connector.h"
+#include "../net/EventLoop.h"
+#include "../net/TcpConnection.h"
+#include "../logger/Logger.h"
+#include <algorithm>
+#include <assert.h>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <limits>
+#include <unistd.h>
+
+const size_t HttpProxy::kDefaultMaxIdlePerUpstream;
+const size_t HttpProxy::kDefaultHighWaterMark;
+
+namespace {
+
+// 逐跳头部：只对一跳连接有意义，不转发（Transfer-Encoding由转发的一方重新决定）
+bool isHopByHop(StringPiece field) {
+    static const char* const kHeaders[] = {
+        "Connection", "Keep-Alive", "Proxy-Connection", "TE", "Trailer",
+        "Transfer-Encoding", "Upgrade"
+    };
+    for (const char* header : kHeaders) {
+        if (field.equalsIgnoreCase(header)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void appendChunkSize(Buffer* buf, size_t len) {
+    char line[32];
+    int n = snprintf(line, sizeof line, "%zx\r\n", len);
+    buf->append(line, n);
+}
+
+// 丢掉一个Connector：可能正在它自己的回调里，等当前事件处理完再销毁
+void dropConnector(EventLoop* loop, std::shared_ptr<Connector>* connector) {
+    if (*connector) {
+        std::shared_ptr<Connector> dropped;
+        dropped.swap(*connector);
+        dropped->stop();
+        loop->queueInLoop([dropped]() {});
+    }
+}
+
+}  // namespace
+
+// 健康检查：一次GET请求
+struct HttpProxy::HealthCheck {
+    explicit HealthCheck(Upstream* u) : upstream(u), status(0), done(false) {}
+    
+    Upstream* upstream;
+    std::shared_ptr<Connector> connector;
+    std::shared_ptr<TcpConnection> conn;
+    HttpResponseParser parser;
+    TimerId timer;                  // 整个检查的超时
+    int status;                     // 响应的状态码，0表示还没收到
+    bool done;
+};
+
+struct HttpProxy::Upstream {
+    Upstream(const std::string& ip, uint16_t port)
+        : address(ip, port),
+          hostPort(address.toIpPort()),
+          healthy(true),
+          active(0),
+          requests(0),
+          connects(0),
+          failures(0)
+    {
+    }
+    
+    InetAddress address;
+    std::string hostPort;
+    std::atomic<bool> healthy;
+    std::atomic<int> active;
+    std::atomic<uint64_t> requests;
+    std::atomic<uint64_t> connects;
+    std::atomic<uint64_t> failures;
+    std::shared_ptr<HealthCheck> check;  // 正在进行的健康检查（只在getLoop()上访问）
+};
+
+// 代理在一个上游连接上的状态：第一次使用时作为连接的context创建，随连接一起销毁
+// 空闲时连接在ConnectionPool里，使用时属于一个Exchange
+struct HttpProxy::UpstreamConn {
+    UpstreamConn(TcpConnection* c, int i) : conn(c), index(i), broken(false) {}
+    
+    TcpConnection* conn;                    // context由连接持有，连接一定比它活得久
+    int index;                              // 上游的下标
+    HttpResponseParser parser;
+    ExchangePtr exchange;                   // 正在使用这个连接的请求
+    bool broken;                            // 收到了没有请求对应的数据，要关闭
+};
+
+// 一个正在转发的请求
+struct HttpProxy::Exchange {
+    Exchange(Upstream* u, int i, ConnectionPool* p, const HttpResponseWriterPtr& w)
+        : upstream(u),
+          index(i),
+          pool(p),
+          writer(w),
+          bodyWriter(w),
+          upconn(nullptr),
+          chunked(false),
+          headRequest(false),
+          hasBody(false),
+          requestDone(false),
+          bodyPaused(false),
+          responseStarted(false),
+          responseDone(false),
+          reused(false),
+          retried(false),
+          released(false),
+          failed(false)
+    {
+    }
+    
+    Upstream* upstream;
+    int index;
+    ConnectionPool* pool;
+    HttpResponseWriterPtr writer;                   // 响应交出去之前持有writer
+    std::weak_ptr<HttpResponseWriter> bodyWriter;   // 请求体的流量控制
+    HttpResponseStreamPtr stream;                   // 转发响应体
+    std::shared_ptr<TcpConnection> conn;            // 正在使用的上游连接
+    UpstreamConn* upconn;                           // conn的context
+    Buffer request;         // 上游连接就绪之前的请求；没有请求体时保留请求头部，重试时再发一次
+    Buffer response;        // stream就绪之前收到的响应体
+    TimerId responseTimer;
+    bool chunked;           // 请求体用分块编码转发
+    bool headRequest;
+    bool hasBody;           // 请求带请求体
+    bool requestDone;       // 整个请求都交给了上游连接（或者攒在request里）
+    bool bodyPaused;        // 暂停了读客户端
+    bool responseStarted;   // 响应头部已经交给writer（或者已经回复了错误）
+    bool responseDone;      // 上游的响应结束了
+    bool reused;            // 连接是池里的空闲连接（可能刚好被上游关闭）
+    bool retried;
+    bool released;          // 上游一侧已经结束
+    bool failed;            // 转发中途出错，客户端连接要断开
+};
+
+HttpProxy::HttpProxy(EventLoop* loop, const std::string& name, int port)
+    : loop_(loop),
+      name_(name),
+      balance_(kRoundRobin),
+      nextUpstream_(0),
+      maxIdle_(kDefaultMaxIdlePerUpstream),
+      upstreamIdleTimeout_(30.0),
+      connectTimeout_(5.0),
+      responseTimeout_(60.0),
+      highWaterMark_(kDefaultHighWaterMark),
+      healthInterval_(0),
+      server_(loop, name, port)
+{
+    server_.setStreamingHttpCallback(
+        [this](const HttpRequest& req, const HttpResponseWriterPtr& writer) {
+            onRequest(req, writer);
+        });
+    
+    // 每个IO线程开始循环之前建好自己的连接池，之后pools_只读
+    server_.setThreadInitCallback([this](EventLoop* ioLoop) {
+        std::unique_ptr<ConnectionPool> pool(new ConnectionPool(ioLoop, name_ + "-upstream"));
+        pool->setMaxIdle(maxIdle_);
+        pool->setMaxTotal(std::numeric_limits<size_t>::max());
+        pool->setIdleTimeout(upstreamIdleTimeout_);
+        pool->setConnectTimeout(connectTimeout_);
+        pool->setAcquireTimeout(0);  // 没有连接数上限不会排队，等待时间由连接超时限制
+        std::lock_guard<std::mutex> lock(poolsMutex_);
+        pools_[ioLoop] = std::move(pool);
+    });
+}
+
+HttpProxy::~HttpProxy() {
+    if (healthTimer_.valid()) {
+        loop_->cancel(healthTimer_);
+    }
+    for (const std::unique_ptr<Upstream>& upstream : upstreams_) {
+        if (upstream->check) {
+            std::shared_ptr<HealthCheck> check = upstream->check;
+            finishHealthCheck(check, upstream->healthy);
+        }
+    }
+    
+    // 连接池要在自己的loop线程析构（取消定时器、关闭连接），IO线程的loop这时还在运行
+    for (auto& item : pools_) {
+        EventLoop* ioLoop = item.first;
+        std::unique_ptr<ConnectionPool>& pool = item.second;
+        if (ioLoop == loop_) {
+            pool.reset();
+            continue;
+        }
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool done = false;
+        ioLoop->runInLoop([&]() {
+            pool.reset();
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            cond.notify_one();
+        });
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return done; });
+    }
+}
+
+void HttpProxy::addUpstream(const std::string& ip, uint16_t port) {
+    upstreams_.emplace_back(new Upstream(ip, port));
+}
+
+void HttpProxy::setHealthCheck(const std::string& path, double interval) {
+    healthPath_ = path;
+    healthInterval_ = interval;
+}
+
+void HttpProxy::start() {
+    assert(!upstreams_.empty());
+    if (!healthPath_.empty() && healthInterval_ > 0) {
+        healthTimer_ = loop_->runEvery(healthInterval_, [this]() { runHealthChecks(); });
+    }
+    server_.start();
+}
+
+HttpProxy::UpstreamStats HttpProxy::upstreamStats(size_t index) const {
+    const Upstream& upstream = *upstreams_[index];
+    UpstreamStats stats;
+    stats.address = upstream.hostPort;
+    stats.healthy = upstream.healthy;
+    stats.active = upstream.active;
+    stats.requests = upstream.requests;
+    stats.connects = upstream.connects;
+    stats.failures = upstream.failures;
+    return stats;
+}
+
+ConnectionPool* HttpProxy::poolFor(EventLoop* loop) {
+    // start()之后pools_不再修改，查找不需要加锁
+    auto it = pools_.find(loop);
+    assert(it != pools_.end());
+    return it->second.get();
+}
+
+int HttpProxy::selectUpstream() {
+    int n = static_cast<int>(upstreams_.size());
+    if (n == 0) {
+        return -1;
+    }
+    if (balance_ == kLeastConnections) {
+        // 从轮询的位置开始找，负载相同时也均匀分布
+        int start = static_cast<int>(nextUpstream_++ % n);
+        int best = -1;
+        int bestActive = 0;
+        for (int i = 0; i < n; ++i) {
+            int index = (start + i) % n;
+            const Upstream& upstream = *upstreams_[index];
+            if (!upstream.healthy) {
+                continue;
+            }
+            int active = upstream.active;
+            if (best < 0 || active < bestActive) {
+                best = index;
+                bestActive = active;
+            }
+        }
+        return best;
+    }
+    for (int i = 0; i < n; ++i) {
+        int index = static_cast<int>(nextUpstream_++ % n);
+        if (upstreams_[index]->healthy) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+void HttpProxy::onRequest(const HttpRequest& req, const HttpResponseWriterPtr& writer) {
+    int index = selectUpstream();
+    if (index < 0) {
+        HttpResponse* response = writer->response();
+        response->setStatusCode(HttpResponse::k503ServiceUnavailable);
+        response->setContentType("text/plain");
+        response->setBody("No healthy upstream\n");
+        writer->send();
+        return;
+    }
+    
+    Upstream* upstream = upstreams_[index].get();
+    ++upstream->active;
+    ++upstream->requests;
+    ExchangePtr ex = std::make_shared<Exchange>(upstream, index, poolFor(writer->getLoop()), writer);
+    ex->headRequest = req.method() == HttpRequest::kHead;
+    appendRequestHead(req, *upstream, &ex->request, &ex->chunked);
+    StringPiece contentLength = req.getHeader("Content-Length");
+    ex->hasBody = ex->chunked || (!contentLength.empty() && contentLength != "0");
+    
+    // 请求体结束时断开循环引用（writer -> 回调 -> ex -> writer）
+    writer->setBodyCallback([this, ex](StringPiece chunk, bool end) {
+        onRequestBody(ex, chunk, end);
+    });
+    acquireConnection(ex);
+}
+
+void HttpProxy::appendRequestHead(const HttpRequest& req, const Upstream& upstream,
+                                  Buffer* out, bool* chunked) const {
+    const char* method = req.methodString();
+    out->append(method, strlen(method));
+    out->append(" ", 1);
+    out->append(req.path().data(), req.path().size());
+    if (!req.query().empty()) {
+        out->append("?", 1);
+        out->append(req.query().data(), req.query().size());
+    }
+    out->append(" HTTP/1.1\r\n", 11);
+    
+    *chunked = false;
+    bool hasHost = false;
+    for (int i = 0; i < req.headerCount(); ++i) {
+        StringPiece field = req.headerField(i);
+        if (field.equalsIgnoreCase("Transfer-Encoding")) {
+            *chunked = true;
+            continue;
+        }
+        // 100 Continue已经由HttpServer回复过了
+        if (isHopByHop(field) || field.equalsIgnoreCase("Expect")) {
+            continue;
+        }
+        hasHost = hasHost || field.equalsIgnoreCase("Host");
+        StringPiece value = req.headerValue(i);
+        out->append(field.data(), field.size());
+        out->append(": ", 2);
+        out->append(value.data(), value.size());
+        out->append("\r\n", 2);
+    }
+    if (!hasHost) {
+        // HTTP/1.0的请求可能没有Host，HTTP/1.1的上游要求有
+        out->append("Host: ", 6);
+        out->append(upstream.hostPort);
+        out->append("\r\n", 2);
+    }
+    if (*chunked) {
+        out->append("Transfer-Encoding: chunked\r\n", 28);
+    }
+    out->append("\r\n", 2);
+}
+
+void HttpProxy::acquireConnection(const ExchangePtr& ex) {
+    // 回调持有ex，直到拿到连接或者连接失败
+    ex->pool->acquire(ex->upstream->address,
+        [this, ex](const std::shared_ptr<TcpConnection>& conn, int savedErrno) {
+            onAcquired(ex, conn, savedErrno);
+        });
+}
+
+void HttpProxy::onAcquired(const ExchangePtr& ex, const std::shared_ptr<TcpConnection>& conn,
+                           int savedErrno) {
+    if (!conn) {
+        LOG_WARN << "HttpProxy[" << name_ << "] connect to " << ex->upstream->hostPort
+                 << " failed: " << strerror(savedErrno);
+        if (ex->released) {
+            return;
+        }
+        ++ex->upstream->failures;
+        if (!healthPath_.empty()) {
+            setHealthy(ex->upstream, false);
+        }
+        fail(ex, savedErrno == ETIMEDOUT ? HttpResponse::k504GatewayTimeout
+                                         : HttpResponse::k502BadGateway);
+        return;
+    }
+    if (ex->released) {
+        // 等连接的时候请求已经结束了：连接没有用过，直接放回
+        ex->pool->release(conn);
+        return;
+    }
+    attach(ex, conn);
+}
+
+void HttpProxy::attach(const ExchangePtr& ex, const std::shared_ptr<TcpConnection>& conn) {
+    UpstreamConn* upconn = conn->context<UpstreamConn>();
+    ex->reused = upconn != nullptr;
+    if (!upconn) {
+        ++ex->upstream->connects;
+        conn->setContext(std::make_shared<UpstreamConn>(conn.get(), ex->index));
+        upconn = conn->context<UpstreamConn>();
+        
+        // 解析器属于upconn，它的回调只在parse()期间调用，这时upconn一定存活
+        upconn->parser.setHeadersCallback([this, upconn](const HttpResponseParser& parser) {
+            onUpstreamHeaders(upconn, parser);
+        });
+        upconn->parser.setBodyCallback([this, upconn](const char* data, size_t len) {
+            onUpstreamBody(upconn, data, len);
+        });
+        upconn->parser.setCompleteCallback([this, upconn]() {
+            onUpstreamComplete(upconn);
+        });
+    }
+    
+    // 放回池里时这些回调会被换掉，每次使用都要重新设置；回调在连接上调用，upconn一定存活
+    conn->setMessageCallback([this](const std::shared_ptr<TcpConnection>& conn, Buffer* buf) {
+        UpstreamConn* upconn = conn->context<UpstreamConn>();
+        bool ok = upconn->parser.parse(buf);
+        if (!ok || upconn->broken) {
+            LOG_WARN << "HttpProxy[" << name_ << "] bad response from "
+                     << upstreams_[upconn->index]->hostPort;
+            ExchangePtr ex = upconn->exchange;
+            if (ex && !ex->responseStarted) {
+                ++ex->upstream->failures;
+                fail(ex, HttpResponse::k502BadGateway);
+            } else if (ex) {
+                abort(ex);
+            }
+            // 连接不能再用：马上关闭，不等release()放回时再关
+            conn->forceClose();
+        }
+    });
+    conn->setConnectionCallback([this](const std::shared_ptr<TcpConnection>& conn) {
+        if (!conn->connected()) {
+            onUpstreamClose(conn->context<UpstreamConn>());
+        }
+    });
+    
+    ex->conn = conn;
+    ex->upconn = upconn;
+    upconn->exchange = ex;
+    upconn->parser.setHeadRequest(ex->headRequest);
+    
+    if (ex->hasBody) {
+        conn->send(&ex->request);
+    } else {
+        conn->send(ex->request.peek(), ex->request.readableBytes());
+    }
+    if (ex->requestDone) {
+        armResponseTimer(ex);
+    }
+    
+    // 连接期间攒下的请求体可能超过了高水位
+    updateRequestFlow(ex);
+}
+
+void HttpProxy::onRequestBody(const ExchangePtr& ex, StringPiece chunk, bool end) {
+    if (ex->released) {
+        // 已经响应或者出错了：剩下的请求体丢掉
+        return;
+    }
+    if (end) {
+        std::shared_ptr<HttpResponseWriter> writer = ex->bodyWriter.lock();
+        if (writer && writer->aborted()) {
+            // 客户端在请求体收完之前断开了
+            ex->failed = true;
+            ex->stream.reset();
+            release(ex, false);
+            return;
+        }
+    }
+    
+    // 分块编码需要加上chunk头，先拼在request里
+    Buffer* request = &ex->request;
+    if (ex->chunked) {
+        if (end) {
+            request->append("0\r\n\r\n", 5);
+        } else if (!chunk.empty()) {
+            appendChunkSize(request, chunk.size());
+            request->append(chunk.data(), chunk.size());
+            request->append("\r\n", 2);
+        }
+    } else if (!ex->upconn) {
+        request->append(chunk.data(), chunk.size());
+    }
+    
+    if (ex->upconn) {
+        TcpConnection* conn = ex->conn.get();
+        if (ex->chunked) {
+            conn->send(request);
+        } else if (!chunk.empty()) {
+            conn->send(chunk.data(), chunk.size());
+        }
+    }
+    
+    if (end) {
+        ex->requestDone = true;
+        if (ex->upconn) {
+            armResponseTimer(ex);
+        }
+    } else {
+        updateRequestFlow(ex);
+    }
+}
+
+void HttpProxy::updateRequestFlow(const ExchangePtr& ex) {
+    std::shared_ptr<HttpResponseWriter> writer = ex->bodyWriter.lock();
+    if (!writer || writer->bodyComplete()) {
+        return;
+    }
+    size_t backlog = ex->upconn ? ex->upconn->conn->pendingOutputBytes()
+                                : ex->request.readableBytes();
+    if (backlog < highWaterMark_) {
+        if (ex->bodyPaused) {
+            ex->bodyPaused = false;
+            writer->resumeBody();
+        }
+        return;
+    }
+    if (!ex->bodyPaused) {
+        ex->bodyPaused = true;
+        writer->pauseBody();
+    }
+    
+    // 还没有连接时在attach()里再检查；有连接时等积压的数据写完
+    if (ex->upconn) {
+        std::weak_ptr<Exchange> weakEx(ex);
+        ex->upconn->conn->setWriteCompleteCallback(
+            [this, weakEx](const std::shared_ptr<TcpConnection>& conn) {
+                conn->setWriteCompleteCallback(nullptr);
+                ExchangePtr ex = weakEx.lock();
+                if (ex && !ex->released) {
+                    updateRequestFlow(ex);
+                }
+            });
+    }
+}
+
+void HttpProxy::armResponseTimer(const ExchangePtr& ex) {
+    if (responseTimeout_ <= 0 || ex->responseStarted || ex->responseTimer.valid()) {
+        return;
+    }
+    std::weak_ptr<Exchange> weakEx(ex);
+    ex->responseTimer = ex->pool->getLoop()->runAfter(responseTimeout_, [this, weakEx]() {
+        ExchangePtr ex = weakEx.lock();
+        if (!ex || ex->released || ex->responseStarted) {
+            return;
+        }
+        ex->responseTimer = TimerId();
+        LOG_WARN << "HttpProxy[" << name_ << "] upstream " << ex->upstream->hostPort
+                 << " response timeout";
+        ++ex->upstream->failures;
+        fail(ex, HttpResponse::k504GatewayTimeout);
+    });
+}
+
+void HttpProxy::onUpstreamHeaders(UpstreamConn* upconn, const HttpResponseParser& parser) {
+    ExchangePtr ex = upconn->exchange;
+    if (!ex || ex->responseStarted || upconn->broken) {
+        // 空闲连接上收到了数据，或者一个请求收到了两个响应
+        upconn->broken = true;
+        return;
+    }
+    if (ex->responseTimer.valid()) {
+        ex->pool->getLoop()->cancel(ex->responseTimer);
+        ex->responseTimer = TimerId();
+    }
+    
+    HttpResponse* response = ex->writer->response();
+    response->setStatusCode(static_cast<HttpResponse::HttpStatusCode>(parser.statusCode()));
+    response->setStatusMessage(parser.reason());
+    for (int i = 0; i < parser.headerCount(); ++i) {
+        StringPiece field = parser.headerField(i);
+        // Content-Length、Date、Connection由HttpServer生成
+        if (isHopByHop(field) || field.equalsIgnoreCase("Content-Length")
+            || field.equalsIgnoreCase("Date")) {
+            continue;
+        }
+        response->appendHeader(field, parser.headerValue(i));
+    }
+    
+    // 长度已知时原样转发Content-Length，否则和客户端之间用分块编码（或者关闭连接）
+    int64_t length = -1;
+    if (parser.bodyKind() == HttpResponseParser::kContentLength
+        || (ex->headRequest && !parser.header("Content-Length").empty())) {
+        length = static_cast<int64_t>(parser.contentLength());
+    }
+    std::weak_ptr<Exchange> weakEx(ex);
+    response->setStream([this, weakEx](const HttpResponseStreamPtr& stream) {
+        ExchangePtr ex = weakEx.lock();
+        if (ex) {
+            onStreamReady(ex, stream);
+        }
+    }, length);
+    
+    // 发送在下一轮事件循环进行，之后检查stream有没有来（这里持有ex直到那时）
+    ex->responseStarted = true;
+    HttpResponseWriterPtr writer;
+    writer.swap(ex->writer);
+    writer->send();
+    ex->pool->getLoop()->queueInLoop([this, ex]() { afterResponseSent(ex); });
+}
+
+void HttpProxy::onUpstreamBody(UpstreamConn* upconn, const char* data, size_t len) {
+    ExchangePtr ex = upconn->exchange;
+    if (!ex || upconn->broken || ex->failed) {
+        return;
+    }
+    if (ex->stream) {
+        if (!ex->stream->write(StringPiece(data, len))) {
+            // 客户端断开了
+            abort(ex);
+            return;
+        }
+        if (!ex->stream->writable()) {
+            // 客户端读得慢：暂停读上游，stream的积压写完之后继续
+            upconn->conn->stopRead();
+        }
+    } else {
+        // 头部还在发送，stream没来之前先攒着（最多一个高水位）
+        ex->response.append(data, len);
+        if (ex->response.readableBytes() >= highWaterMark_) {
+            upconn->conn->stopRead();
+        }
+    }
+}
+
+void HttpProxy::onUpstreamComplete(UpstreamConn* upconn) {
+    ExchangePtr ex = upconn->exchange;
+    if (!ex || upconn->broken || ex->failed) {
+        return;
+    }
+    ex->responseDone = true;
+    if (ex->stream) {
+        ex->stream->finish();
+        ex->stream.reset();
+    }
+    // 请求体还没发完时上游就响应了：连接上还有没发完的请求，不能复用
+    release(ex, !upconn->parser.closeConnection() && ex->requestDone);
+}
+
+void HttpProxy::onUpstreamClose(UpstreamConn* upconn) {
+    // 以关闭结束的响应体到此完整，complete回调里已经release
+    upconn->parser.finishOnClose();
+    
+    ExchangePtr ex = upconn->exchange;
+    if (!ex) {
+        return;  // 请求已经结束，连接是代理自己关闭的
+    }
+    upconn->exchange.reset();
+    ex->upconn = nullptr;
+    ex->conn.reset();
+    
+    if (ex->responseStarted) {
+        // 响应体转发到一半：没法再告诉客户端出错了，只能断开客户端连接
+        LOG_WARN << "HttpProxy[" << name_ << "] upstream " << ex->upstream->hostPort
+                 << " closed in the middle of a response";
+        abort(ex);
+        return;
+    }
+    
+    // 复用的连接刚好被上游关闭，请求可能根本没有到达上游：没有请求体时换个连接重试一次
+    if (ex->reused && !upconn->parser.inProgress() && !ex->hasBody && !ex->retried) {
+        ex->retried = true;
+        if (ex->responseTimer.valid()) {
+            ex->pool->getLoop()->cancel(ex->responseTimer);
+            ex->responseTimer = TimerId();
+        }
+        acquireConnection(ex);
+        return;
+    }
+    ++ex->upstream->failures;
+    fail(ex, HttpResponse::k502BadGateway);
+}
+
+void HttpProxy::onStreamReady(const ExchangePtr& ex, const HttpResponseStreamPtr& stream) {
+    if (ex->failed) {
+        // 上游已经出错：stream不finish()就销毁，客户端连接被断开
+        return;
+    }
+    ex->stream = stream;
+    stream->setHighWaterMark(highWaterMark_);
+    std::weak_ptr<Exchange> weakEx(ex);
+    stream->setWritableCallback([this, weakEx](const HttpResponseStreamPtr& stream) {
+        ExchangePtr ex = weakEx.lock();
+        if (!ex) {
+            return;
+        }
+        if (stream->closed()) {
+            abort(ex);
+        } else if (ex->upconn) {
+            ex->upconn->conn->startRead();
+        }
+    });
+    
+    if (ex->response.readableBytes() > 0) {
+        stream->write(StringPiece(ex->response.peek(), ex->response.readableBytes()));
+        ex->response.retrieveAll();
+    }
+    if (ex->responseDone) {
+        stream->finish();
+        ex->stream.reset();
+    } else if (ex->upconn && stream->writable()) {
+        ex->upconn->conn->startRead();
+    }
+}
+
+void HttpProxy::afterResponseSent(const ExchangePtr& ex) {
+    // 还在等上游的响应体，stream却没有来：客户端已经断开了
+    if (!ex->stream && !ex->released) {
+        abort(ex);
+    }
+}
+
+void HttpProxy::fail(const ExchangePtr& ex, int status) {
+    HttpResponseWriterPtr writer;
+    writer.swap(ex->writer);
+    ex->responseStarted = true;
+    release(ex, false);
+    if (writer) {
+        HttpResponse* response = writer->response();
+        response->setStatusCode(static_cast<HttpResponse::HttpStatusCode>(status));
+        response->setContentType("text/plain");
+        response->setBody(std::string(HttpResponse::reasonPhrase(status)) + "\n");
+        writer->send();
+    }
+}
+
+void HttpProxy::abort(const ExchangePtr& ex) {
+    ex->failed = true;
+    ex->stream.reset();
+    ex->response.retrieveAll();
+    release(ex, false);
+}
+
+void HttpProxy::release(const ExchangePtr& ex, bool reusable) {
+    if (ex->released) {
+        return;
+    }
+    ex->released = true;
+    --ex->upstream->active;
+    if (ex->responseTimer.valid()) {
+        ex->pool->getLoop()->cancel(ex->responseTimer);
+        ex->responseTimer = TimerId();
+    }
+    ex->request.retrieveAll();
+    
+    // 先断开和请求的关系，连接被关闭时回调里就只是清理
+    std::shared_ptr<TcpConnection> conn;
+    conn.swap(ex->conn);
+    if (conn) {
+        UpstreamConn* upconn = ex->upconn;
+        ex->upconn = nullptr;
+        upconn->exchange.reset();
+        conn->setWriteCompleteCallback(nullptr);
+        // 可能正在这个连接的消息回调里（解析器还没返回），池又可能马上把它交给下一个请求：
+        // 这一轮事件处理完再放回。池放回时检查连接是否还能用，不能用的关闭
+        ConnectionPool* pool = ex->pool;
+        bool keep = reusable && !upconn->broken;
+        pool->getLoop()->queueInLoop([pool, conn, keep]() { pool->release(conn, keep); });
+    }
+    
+    // 请求体还没收完（上游提前响应了或者出错了）：继续读出来丢掉，连接才能处理下一个请求
+    if (ex->bodyPaused) {
+        ex->bodyPaused = false;
+        std::shared_ptr<HttpResponseWriter> writer = ex->bodyWriter.lock();
+        if (writer) {
+            writer->resumeBody();
+        }
+    }
+}
+
+void HttpProxy::runHealthChecks() {
+    for (const std::unique_ptr<Upstream>& u : upstreams_) {
+        Upstream* upstream = u.get();
+        if (upstream->check) {
+            continue;  // 上一次检查还没结束
+        }
+        std::shared_ptr<HealthCheck> check = std::make_shared<HealthCheck>(upstream);
+        upstream->check = check;
+        HealthCheck* raw = check.get();
+        raw->parser.setHeadersCallback([raw](const HttpResponseParser& parser) {
+            raw->status = parser.statusCode();
+        });
+        
+        // 回调只持有weak_ptr：check由upstream->check持有，结束时释放
+        std::weak_ptr<HealthCheck> weakCheck(check);
+        check->connector = std::make_shared<Connector>(loop_, upstream->address);
+        check->connector->setConnectTimeout(std::min(connectTimeout_, healthInterval_));
+        check->connector->setNewConnectionCallback([this, weakCheck](int sockfd) {
+            std::shared_ptr<HealthCheck> check = weakCheck.lock();
+            if (!check) {
+                ::close(sockfd);
+                return;
+            }
+            dropConnector(loop_, &check->connector);
+            Upstream* upstream = check->upstream;
+            std::shared_ptr<TcpConnection> conn = std::make_shared<TcpConnection>(
+                loop_, name_ + "-health-" + upstream->hostPort, sockfd);
+            check->conn = conn;
+            conn->setMessageCallback(
+                [this, weakCheck](const std::shared_ptr<TcpConnection>&, Buffer* buf) {
+                    std::shared_ptr<HealthCheck> check = weakCheck.lock();
+                    if (!check) {
+                        buf->retrieveAll();
+                        return;
+                    }
+                    if (!check->parser.parse(buf)) {
+                        finishHealthCheck(check, false);
+                    } else if (check->status != 0) {
+                        finishHealthCheck(check, check->status >= 200 && check->status < 400);
+                    }
+                });
+            conn->setCloseCallback([this, weakCheck](const std::shared_ptr<TcpConnection>& conn) {
+                conn->getLoop()->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+                std::shared_ptr<HealthCheck> check = weakCheck.lock();
+                if (check) {
+                    finishHealthCheck(check, false);
+                }
+            });
+            conn->connectEstablished();
+            conn->send("GET " + healthPath_ + " HTTP/1.1\r\nHost: " + upstream->hostPort
+                       + "\r\nConnection: close\r\n\r\n");
+        });
+        check->connector->setErrorCallback([this, weakCheck](int) {
+            std::shared_ptr<HealthCheck> check = weakCheck.lock();
+            if (check) {
+                finishHealthCheck(check, false);
+            }
+        });
+        
+        // 连上了但迟迟没有响应也算失败
+        check->timer = loop_->runAfter(healthInterval_, [this, weakCheck]() {
+            std::shared_ptr<HealthCheck> check = weakCheck.lock();
+            if (check) {
+                check->timer = TimerId();
+                finishHealthCheck(check, false);
+            }
+        });
+        check->connector->start();
+    }
+}
+
+void HttpProxy::finishHealthCheck(const std::shared_ptr<HealthCheck>& check, bool healthy) {
+    if (check->done) {
+        return;
+    }
+    check->done = true;
+    if (check->timer.valid()) {
+        loop_->cancel(check->timer);
+    }
+    dropConnector(loop_, &check->connector);
+    if (check->conn) {
+        std::shared_ptr<TcpConnection> conn;
+        conn.swap(check->conn);
+        conn->forceClose();
+    }
+    check->upstream->check.reset();
+    setHealthy(check->upstream, healthy);
+}
+
+void HttpProxy::setHealthy(Upstream* upstream, bool healthy) {
+    if (upstream->healthy.exchange(healthy) == healthy) {
+        return;
+    }
+    if (healthy) {
+        LOG_INFO << "HttpProxy[" << name_ << "] upstream " << upstream->hostPort << " is up";
+    } else {
+        LOG_WARN << "HttpProxy[" << name_ << "] upstream " << upstream->hostPort << " is down";
+    }
+}
@@ -0,0 +1,182 @@
+#ifndef TINY_NETWORK_HTTP_HTTPPROXY_H
+#define TINY_NETWORK_HTTP_HTTPPROXY_H
+
+#include "../base/noncopyable.h"
+#include "../net/InetAddress.h"
+#include "../net/Timer.h"
+#include "HttpServer.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Buffer;
+class ConnectionPool;
+class EventLoop;
+class HttpRequest;
+class HttpResponseParser;
+
+// HttpProxy：HTTP/1.x反向代理
+//
+// 基于HttpServer接收请求（超时、头部上限、IO线程数等都通过server()配置），
+// 用HttpServer的流式业务回调在头部收完时就开始转发，请求体和响应体都是边收边转发：
+//   客户端 -> 请求体 -> 上游：上游连接写不动时暂停读客户端（HttpResponseWriter::pauseBody）
+//   上游 -> 响应体 -> 客户端：客户端读得慢时暂停读上游（HttpResponseStream的高水位）
+// 两个方向都只缓存一个高水位左右的数据，不会把整个请求体/响应体攒在内存里
+//
+// 上游连接：
+// - 每个IO线程（EventLoop）一个ConnectionPool，上游连接和客户端连接在同一个线程，不需要加锁
+// - keep-alive复用，每个上游最多保留setMaxIdlePerUpstream()个空闲连接，空闲太久的关闭
+// - 到上游的连接数不设上限，每个等待连接的请求各自建立一个
+// - 复用的空闲连接刚好被上游关闭时，没有请求体的请求换一个新连接重试一次
+//
+// 负载均衡：轮询或者最少连接（正在处理的请求数，所有IO线程合计）
+// 健康检查：定期GET一个路径，2xx/3xx为健康；连接失败的上游也立即标记为不健康，
+// 等下一次检查通过再恢复。没有健康的上游时回复503，连接失败回复502，等待响应超时回复504
+//
+// 转发时去掉逐跳头部（Connection、Keep-Alive、Transfer-Encoding、Upgrade等），
+// 和上游之间总是HTTP/1.1 keep-alive；不支持转发协议升级（WebSocket）
+class HttpProxy : noncopyable {
+public:
+    // 负载均衡策略
+    enum Balance {
+        kRoundRobin,         // 轮询
+        kLeastConnections    // 正在处理的请求最少的上游
+    };
+    
+    // 一个上游的统计（跨线程读取，各项之间不是同一时刻的快照）
+    struct UpstreamStats {
+        std::string address;    // ip:port
+        bool healthy;           // 健康检查的结果
+        int active;             // 正在处理的请求数
+        uint64_t requests;      // 转发过的请求数
+        uint64_t connects;      // 建立过的连接数（和requests比较就是复用率）
+        uint64_t failures;      // 连接失败、没有响应、超时的次数
+    };
+    
+    // 默认值
+    static const size_t kDefaultMaxIdlePerUpstream = 32;
+    static const size_t kDefaultHighWaterMark = 64 * 1024;
+    
+    HttpProxy(EventLoop* loop, const std::string& name, int port);
+    ~HttpProxy();
+    
+    // 底层的HttpServer：IO线程数、超时、头部上限等在start()之前配置
+    // 它的流式业务回调和线程初始化回调由代理使用，不能再设置
+    HttpServer& server() { return server_; }
+    
+    // 添加一个上游（start()之前）
+    void addUpstream(const std::string& ip, uint16_t port);
+    
+    void setBalance(Balance balance) { balance_ = balance; }
+    
+    // 每个IO线程为每个上游最多保留的空闲连接
+    void setMaxIdlePerUpstream(size_t n) { maxIdle_ = n; }
+    
+    // 空闲连接超过这个时间（秒）就关闭，默认30秒（应该比上游的keep-alive超时短）
+    void setUpstreamIdleTimeout(double seconds) { upstreamIdleTimeout_ = seconds; }
+    
+    // 连接上游的超时（秒），默认5秒，超时回复502
+    void setConnectTimeout(double seconds) { connectTimeout_ = seconds; }
+    
+    // 请求发出之后等待响应头部的超时（秒），默认60秒，超时回复504
+    void setResponseTimeout(double seconds) { responseTimeout_ = seconds; }
+    
+    // 两个方向积压多少数据就暂停读对面，默认64KB
+    void setHighWaterMark(size_t bytes) { highWaterMark_ = bytes; }
+    
+    // 开启健康检查：每隔interval秒对每个上游GET path（start()之前调用）
+    void setHealthCheck(const std::string& path, double interval);
+    
+    // 启动：准备每个IO线程的连接池，开始健康检查，然后开始监听
+    // 连接池的设置（空闲连接数、空闲超时、连接超时）在这之前配置
+    void start();
+    
+    size_t upstreamCount() const { return upstreams_.size(); }
+    UpstreamStats upstreamStats(size_t index) const;
+
+private:
+    struct Upstream;
+    struct UpstreamConn;
+    struct Exchange;
+    struct HealthCheck;
+    
+    using ExchangePtr = std::shared_ptr<Exchange>;
+    
+    // 流式业务回调：头部收完时调用（IO线程）
+    void onRequest(const HttpRequest& req, const HttpResponseWriterPtr& writer);
+    
+    // 选择上游，没有健康的上游时返回-1
+    int selectUpstream();
+    
+    // 当前线程的连接池（start()时就已经建好，之后只读）
+    ConnectionPool* poolFor(EventLoop* loop);
+    
+    // 请求行和头部（去掉逐跳头部），chunked返回请求体是否要用分块编码转发
+    void appendRequestHead(const HttpRequest& req, const Upstream& upstream,
+                           Buffer* out, bool* chunked) const;
+    
+    // 从连接池取一个上游连接
+    void acquireConnection(const ExchangePtr& ex);
+    void onAcquired(const ExchangePtr& ex, const std::shared_ptr<TcpConnection>& conn, int savedErrno);
+    
+    // 连接交给请求：第一次使用的连接带上解析器，发出攒下的请求头部和请求体
+    void attach(const ExchangePtr& ex, const std::shared_ptr<TcpConnection>& conn);
+    
+    // 客户端的请求体
+    void onRequestBody(const ExchangePtr& ex, StringPiece chunk, bool end);
+    
+    // 请求体的流量控制：积压超过高水位时暂停读客户端，写完之后恢复
+    void updateRequestFlow(const ExchangePtr& ex);
+    
+    // 请求全部交给了上游连接：开始等待响应头部
+    void armResponseTimer(const ExchangePtr& ex);
+    
+    // 上游连接的事件
+    void onUpstreamHeaders(UpstreamConn* upconn, const HttpResponseParser& parser);
+    void onUpstreamBody(UpstreamConn* upconn, const char* data, size_t len);
+    void onUpstreamComplete(UpstreamConn* upconn);
+    void onUpstreamClose(UpstreamConn* upconn);
+    
+    // 响应头已经发给客户端，HttpServer创建了stream
+    void onStreamReady(const ExchangePtr& ex, const HttpResponseStreamPtr& stream);
+    
+    // 响应交给writer之后：stream没有来说明客户端已经断开了（或者响应没有响应体）
+    void afterResponseSent(const ExchangePtr& ex);
+    
+    // 请求还没有响应时出错：回复status（502/503/504）
+    void fail(const ExchangePtr& ex, int status);
+    
+    // 响应已经开始转发之后出错（上游或者客户端断开）：两边的连接都不能再用
+    void abort(const ExchangePtr& ex);
+    
+    // 请求结束，上游连接还能复用时放回池里，否则关闭
+    void release(const ExchangePtr& ex, bool reusable);
+    
+    // 健康检查（在getLoop()上执行）
+    void runHealthChecks();
+    void finishHealthCheck(const std::shared_ptr<HealthCheck>& check, bool healthy);
+    void setHealthy(Upstream* upstream, bool healthy);
+    
+    EventLoop* loop_;
+    std::string name_;
+    std::vector<std::unique_ptr<Upstream>> upstreams_;
+    Balance balance_;
+    std::atomic<uint64_t> nextUpstream_;        // 轮询计数
+    size_t maxIdle_;
+    double upstreamIdleTimeout_;
+    double connectTimeout_;
+    double responseTimeout_;
+    size_t highWaterMark_;
+    std::string healthPath_;                     // 健康检查的路径，空表示不检查
+    double healthInterval_;
+    TimerId healthTimer_;
+    std::mutex poolsMutex_;                      // 只在start()期间写pools_时使用
+    std::unordered_map<EventLoop*, std::unique_ptr<ConnectionPool>> pools_;
+    HttpServer server_;                          // 放在最后：析构时先停止IO线程
+};
+
+#endif
@@ -1,28 +1,32 @@
 #include "HttpRequest.h"
-#include <cctype>  // for isspace
+#include <cstring>  // for memcmp
 
 // 设置HTTP方法（从字符串解析）
+// 先按长度分支，再用memcmp比较，不需要构造临时字符串
 bool HttpRequest::setMethod(const char* start, const char* end) {
-    std::string m(start, end);  // 构造临时字符串
-    if (m == "GET") {
-        method_ = kGet;
-    } else if (m == "POST") {
-        method_ = kPost;
-    } else if (m == "HEAD") {
-        method_ = kHead;
-    } else if (m == "PUT") {
-        method_ = kPut;
-    } else if (m == "DELETE") {
-        method_ = kDelete;
-    } else {
-        method_ = kInvalid;
+    size_t len = end - start;
+    method_ = kInvalid;
+    switch (len) {
+        case 3:
+            if (memcmp(start, "GET", 3) == 0) method_ = kGet;
+            else if (memcmp(start, "PUT", 3) == 0) method_ = kPut;
+            break;
+        case 4:
+            if (memcmp(start, "POST", 4) == 0) method_ = kPost;
+            else if (memcmp(start, "HEAD", 4) == 0) method_ = kHead;
+            break;
+        case 6:
+            if (memcmp(start, "DELETE", 6) == 0) method_ = kDelete;
+            break;
+        default:
+            break;
     }
     return method_ != kInvalid;  // 返回是否解析成功
 }
 
 // 获取方法字符串表示
-const char* HttpRequest::methodString() const {
-    switch(method_) {
+const char* HttpRequest::methodName(Method method) {
+    switch(method) {
         case kGet:    return "GET";
         case kPost:   return "POST";
         case kHead:   return "HEAD";
@@ -32,27 +36,46 @@ const char* HttpRequest::methodString() const {
     }
 }
 
-// 添加请求头（复杂的字符串处理逻辑）
-void HttpRequest::addHeader(const char* start, const char* colon, const char* end) {
-    std::string field(start, colon);  // 头部名称
-    ++colon;
+// 添加请求头：只记录名称和值的位置
+bool HttpRequest::addHeader(const char* start, const char* colon, const char* end) {
+    if (numHeaders_ >= kMaxHeaders) {
+        return false;
+    }
+    
+    const char* valueStart = colon + 1;
     // 跳过冒号后的空格
-    while (colon < end && isspace(*colon)) {
-        ++colon;
+    while (valueStart < end && (*valueStart == ' ' || *valueStart == '\t')) {
+        ++valueStart;
     }
-    std::string value(colon, end);    // 头部值
     // 去掉值末尾的空格
-    while (!value.empty() && isspace(value[value.size()-1])) {
-        value.resize(value.size()-1);
+    const char* valueEnd = end;
+    while (valueEnd > valueStart && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t')) {
+        --valueEnd;
     }
-    headers_[field] = value;
+    
+    Header& header = headers_[numHeaders_++];
+    header.field = makeSlice(start, colon);
+    header.value = makeSlice(valueStart, valueEnd);
+    return true;
 }
 
 // 获取指定请求头的值
-std::string HttpRequest::getHeader(const std::string& field) const {
-    auto it = headers_.find(field);
-    if (it != headers_.end()) {
-        return it->second;
+// 头部一般只有十几个，线性查找比哈希表更快，而且没有内存分配
+StringPiece HttpRequest::getHeader(StringPiece field) const {
+    for (int i = 0; i < numHeaders_; ++i) {
+        if (toPiece(headers_[i].field).equalsIgnoreCase(field)) {
+            return toPiece(headers_[i].value);
+        }
     }
-    return "";  // 找不到返回空字符串
-}
\ No newline at end of file
+    return StringPiece();  // 找不到返回空
+}
+
+// 获取路由参数：参数最多几个，线性查找
+StringPiece HttpRequest::param(StringPiece name) const {
+    for (int i = 0; i < numParams_; ++i) {
+        if (params_[i].name == name) {
+            return params_[i].value;
+        }
+    }
+    return StringPiece();
+}
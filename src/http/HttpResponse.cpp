@@ -1,40 +1,348 @@
 #include "HttpResponse.h"
 #include "../net/Buffer.h"  // 需要Buffer的完整定义
-#include <stdio.h>          // for snprintf
+#include <algorithm>        // for std::reverse
+#include <cstring>          // for memcpy
+#include <time.h>           // for gmtime_r, strftime
+#include <unistd.h>         // for close
 
-void HttpResponse::appendToBuffer(Buffer* output) const {
-    char buf[32];
+namespace {
+
+// 字符串字面量转StringPiece，长度在编译期确定
+#define STATUS_LINE(code, reason) \
+    case code: return StringPiece("HTTP/1.1 " #code " " reason "\r\n", \
+                                  sizeof("HTTP/1.1 " #code " " reason "\r\n") - 1)
+
+// 预先生成的状态行，不在每个响应里snprintf
+StringPiece defaultStatusLine(int code) {
+    switch (code) {
+        STATUS_LINE(100, "Continue");
+        STATUS_LINE(101, "Switching Protocols");
+        STATUS_LINE(200, "OK");
+        STATUS_LINE(204, "No Content");
+        STATUS_LINE(206, "Partial Content");
+        STATUS_LINE(301, "Moved Permanently");
+        STATUS_LINE(302, "Found");
+        STATUS_LINE(304, "Not Modified");
+        STATUS_LINE(400, "Bad Request");
+        STATUS_LINE(403, "Forbidden");
+        STATUS_LINE(404, "Not Found");
+        STATUS_LINE(405, "Method Not Allowed");
+        STATUS_LINE(408, "Request Timeout");
+        STATUS_LINE(413, "Payload Too Large");
+        STATUS_LINE(414, "URI Too Long");
+        STATUS_LINE(416, "Range Not Satisfiable");
+        STATUS_LINE(426, "Upgrade Required");
+        STATUS_LINE(431, "Request Header Fields Too Large");
+        STATUS_LINE(500, "Internal Server Error");
+        STATUS_LINE(502, "Bad Gateway");
+        STATUS_LINE(503, "Service Unavailable");
+        STATUS_LINE(504, "Gateway Timeout");
+        default: return StringPiece();
+    }
+}
+
+#undef STATUS_LINE
+
+// 无符号整数转十进制，返回长度（不写'\0'）
+size_t formatUnsigned(char* buf, size_t value) {
+    char* p = buf;
+    do {
+        *p++ = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    std::reverse(buf, p);
+    return p - buf;
+}
+
+// 1xx、204、304不能带响应体，也不发送Content-Length
+bool mayHaveBody(int code) {
+    return code >= 200 && code != 204 && code != 304;
+}
+
+// 顺序写入预留好的空间
+class Writer {
+public:
+    explicit Writer(char* start) : cur_(start) {}
     
-    // 1. 构造状态行：HTTP/1.1 200 OK\r\n
-    snprintf(buf, sizeof buf, "HTTP/1.1 %d ", statusCode_);
-    output->append(buf);
-    output->append(statusMessage_);
-    output->append("\r\n");
+    void append(const char* data, size_t len) {
+        memcpy(cur_, data, len);
+        cur_ += len;
+    }
+    void append(StringPiece s) { append(s.data(), s.size()); }
+    void append(const std::string& s) { append(s.data(), s.size()); }
     
-    // 2. 如果有响应体，自动添加Content-Length头
-    if (!body_.empty()) {
-        snprintf(buf, sizeof buf, "Content-Length: %zd\r\n", body_.size());
-        output->append(buf);
+    char* current() const { return cur_; }
+
+private:
+    char* cur_;
+};
+
+const StringPiece kContentLength("Content-Length: ", 16);
+const StringPiece kChunked("Transfer-Encoding: chunked\r\n", 28);
+const StringPiece kConnectionClose("Connection: close\r\n", 19);
+const StringPiece kConnectionKeepAlive("Connection: Keep-Alive\r\n", 24);
+
+// 每个线程（即每个EventLoop）一份的Date缓存
+struct DateCache {
+    DateCache() : second(-1), length(0) {}
+    
+    int64_t second;   // 缓存对应的秒数
+    size_t length;
+    char line[64];    // "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+};
+
+thread_local DateCache t_dateCache;
+
+}  // namespace
+
+const char* HttpResponse::reasonPhrase(int code) {
+    switch (code) {
+        case 100: return "Continue";
+        case 101: return "Switching Protocols";
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 206: return "Partial Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 413: return "Payload Too Large";
+        case 414: return "URI Too Long";
+        case 416: return "Range Not Satisfiable";
+        case 426: return "Upgrade Required";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        case 504: return "Gateway Timeout";
+        default:  return "Unknown";
+    }
+}
+
+// RFC 7231 IMF-fixdate，秒数变化时才重新格式化
+StringPiece HttpResponse::dateHeader(Timestamp now) {
+    int64_t second = now.microSecondsSinceEpoch() / Timestamp::kMicroSecondsPerSecond;
+    DateCache& cache = t_dateCache;
+    if (second != cache.second) {
+        time_t t = static_cast<time_t>(second);
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        cache.length = strftime(cache.line, sizeof cache.line,
+                                "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+        cache.second = second;
+    }
+    return StringPiece(cache.line, cache.length);
+}
+
+HttpResponse::FileBody::~FileBody() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void HttpResponse::setFileBody(int fd, off_t offset, size_t length) {
+    body_.clear();
+    sharedBody_.reset();
+    fileBody_.reset(new FileBody(fd, offset, length));
+}
+
+int HttpResponse::releaseFileBody(off_t* offset, size_t* length) {
+    if (!fileBody_) {
+        return -1;
+    }
+    int fd = fileBody_->fd;
+    *offset = fileBody_->offset;
+    *length = fileBody_->length;
+    fileBody_->fd = -1;
+    fileBody_.reset();
+    return fd;
+}
+
+std::shared_ptr<const std::string> HttpResponse::releaseBody(size_t* offset, size_t* length) {
+    std::shared_ptr<const std::string> body;
+    if (sharedBody_) {
+        body = std::move(sharedBody_);
+        *offset = sharedOffset_;
+        *length = sharedLength_;
+    } else {
+        *offset = 0;
+        *length = body_.size();
+        body = std::make_shared<const std::string>(std::move(body_));
+        body_.clear();
+    }
+    return body;
+}
+
+void HttpResponse::reset(bool close) {
+    statusCode_ = kUnknown;
+    statusMessage_.clear();
+    closeConnection_ = close;
+    headerStore_.clear();
+    headers_.clear();
+    if (body_.capacity() > kMaxRetainedBodySize) {
+        std::string().swap(body_);
+    } else {
+        body_.clear();
+    }
+    sharedBody_.reset();
+    sharedOffset_ = 0;
+    sharedLength_ = 0;
+    fileBody_.reset();
+    stream_ = nullptr;
+    streamLength_ = -1;
+    headOnly_ = false;
+    upgrade_ = nullptr;
+}
+
+// 头部不多，线性查找，保持添加顺序
+void HttpResponse::addHeader(StringPiece key, StringPiece value) {
+    Header* target = nullptr;
+    for (Header& header : headers_) {
+        if (key.equalsIgnoreCase(StringPiece(headerStore_.data() + header.offset, header.nameLength))) {
+            target = &header;
+            break;
+        }
+    }
+    if (!target) {
+        appendHeader(key, value);
+        return;
     }
     
-    // 3. 添加所有响应头
-    for (const auto& header : headers_) {
-        output->append(header.first);        // 头部名称
-        output->append(": ");
-        output->append(header.second);       // 头部值
-        output->append("\r\n");
+    // value可能就是headerStore_里的数据（比如复制另一个头部的值），追加之前先记下偏移
+    const char* store = headerStore_.data();
+    bool aliased = value.data() >= store && value.data() < store + headerStore_.size();
+    target->valueOffset = static_cast<uint32_t>(headerStore_.size());
+    target->valueLength = static_cast<uint32_t>(value.size());
+    if (aliased) {
+        headerStore_.append(headerStore_, value.data() - store, value.size());
+    } else {
+        headerStore_.append(value.data(), value.size());
     }
+}
+
+void HttpResponse::appendHeader(StringPiece key, StringPiece value) {
+    const char* store = headerStore_.data();
+    bool aliased = value.data() >= store && value.data() < store + headerStore_.size();
+    size_t aliasOffset = aliased ? value.data() - store : 0;
     
-    // 4. 连接控制头
-    if (closeConnection_) {
-        output->append("Connection: close\r\n");
+    Header header;
+    header.offset = static_cast<uint32_t>(headerStore_.size());
+    header.nameLength = static_cast<uint32_t>(key.size());
+    headerStore_.append(key.data(), key.size());
+    header.valueOffset = static_cast<uint32_t>(headerStore_.size());
+    header.valueLength = static_cast<uint32_t>(value.size());
+    if (aliased) {
+        headerStore_.append(headerStore_, aliasOffset, value.size());
     } else {
-        output->append("Connection: Keep-Alive\r\n");
+        headerStore_.append(value.data(), value.size());
+    }
+    headers_.push_back(header);
+}
+
+StringPiece HttpResponse::header(StringPiece key) const {
+    for (int i = 0; i < headerCount(); ++i) {
+        if (key.equalsIgnoreCase(headerField(i))) {
+            return headerValue(i);
+        }
+    }
+    return StringPiece();
+}
+
+// 先算出响应的总长度，一次性预留空间，然后顺序memcpy
+// 原来的实现每个响应要做几次snprintf和十几次小的append
+void HttpResponse::appendToBuffer(Buffer* output, Timestamp now) const {
+    if (now.microSecondsSinceEpoch() == 0) {
+        now = Timestamp::now();
     }
     
-    // 5. 空行分隔头部和正文
-    output->append("\r\n");
+    // 1. 状态行：标准描述直接用预先生成好的
+    StringPiece statusLine = defaultStatusLine(statusCode_);
+    char customStatus[16];
+    StringPiece reason;
+    if (statusLine.empty() || (!statusMessage_.empty() && statusMessage_ != reasonPhrase(statusCode_))) {
+        // 自定义描述：HTTP/1.1 xxx <message>\r\n
+        memcpy(customStatus, "HTTP/1.1 ", 9);
+        size_t len = 9 + formatUnsigned(customStatus + 9, statusCode_);
+        customStatus[len++] = ' ';
+        statusLine = StringPiece(customStatus, len);
+        reason = statusMessage_.empty() ? StringPiece(reasonPhrase(statusCode_))
+                                        : StringPiece(statusMessage_);
+    }
     
-    // 6. 响应体
-    output->append(body_);
-}
\ No newline at end of file
+    StringPiece date = dateHeader(now);
+    
+    // 2. Content-Length（文件响应体、流式响应体和HEAD请求只有头部写进Buffer）
+    // 长度未知的流式响应体用分块编码，或者以关闭连接结束（两个都不发）
+    char lengthBuf[24];
+    size_t lengthLen = 0;
+    StringPiece chunked;
+    bool hasBody = mayHaveBody(statusCode_);
+    StringPiece payload = body();
+    if (hasBody) {
+        if (!stream_) {
+            lengthLen = formatUnsigned(lengthBuf, fileBody_ ? fileBody_->length : payload.size());
+        } else if (streamLength_ >= 0) {
+            lengthLen = formatUnsigned(lengthBuf, static_cast<size_t>(streamLength_));
+        } else if (!closeConnection_) {
+            chunked = kChunked;
+        }
+    }
+    if (!hasBody || fileBody_ || stream_ || headOnly_) {
+        payload = StringPiece();
+    }
+    
+    // 101响应的Connection: Upgrade由调用者作为普通头部添加
+    StringPiece connection = closeConnection_ ? kConnectionClose : kConnectionKeepAlive;
+    if (statusCode_ == k101SwitchingProtocols) {
+        connection = StringPiece();
+    }
+    
+    // 3. 计算总长度
+    size_t total = statusLine.size() + date.size() + connection.size() + 2;
+    if (!reason.empty()) {
+        total += reason.size() + 2;
+    }
+    if (lengthLen > 0) {
+        total += kContentLength.size() + lengthLen + 2;
+    }
+    total += chunked.size() + payload.size();
+    for (const Header& header : headers_) {
+        total += header.nameLength + 2 + header.valueLength + 2;
+    }
+    
+    // 4. 一次预留，顺序写入
+    output->ensureWritableBytes(total);
+    Writer w(output->beginWrite());
+    w.append(statusLine);
+    if (!reason.empty()) {
+        w.append(reason);
+        w.append("\r\n", 2);
+    }
+    w.append(date);
+    if (lengthLen > 0) {
+        w.append(kContentLength);
+        w.append(lengthBuf, lengthLen);
+        w.append("\r\n", 2);
+    }
+    if (!chunked.empty()) {
+        w.append(chunked);
+    }
+    for (const Header& header : headers_) {
+        w.append(headerStore_.data() + header.offset, header.nameLength);
+        w.append(": ", 2);
+        w.append(headerStore_.data() + header.valueOffset, header.valueLength);
+        w.append("\r\n", 2);
+    }
+    if (!connection.empty()) {
+        w.append(connection);
+    }
+    w.append("\r\n", 2);  // 空行分隔头部和正文
+    if (!payload.empty()) {
+        w.append(payload);
+    }
+    output->hasWritten(w.current() - output->beginWrite());
+}
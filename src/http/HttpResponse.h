@@ -1,38 +1,93 @@
 #ifndef TINY_NETWORK_HTTP_HTTPRESPONSE_H
 #define TINY_NETWORK_HTTP_HTTPRESPONSE_H
 
+#include "../base/Timestamp.h"
+#include "../base/StringPiece.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
-#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <sys/types.h>  // for off_t
 
 class Buffer;  // 前向声明，避免包含Buffer.h
+class HttpRequest;
+class TcpConnection;
+class HttpResponseStream;
 
+// HttpResponse：HTTP响应
+//
+// 头部的名字和值都拷贝到headerStore_里，headers_只记录偏移
+// HttpServer给每个连接复用同一个HttpResponse，reset()之后headerStore_、headers_、body_
+// 都保留容量，像一块每个请求清空一次的arena：常见的响应不需要任何堆分配
 class HttpResponse {
 public:
     // HTTP状态码枚举（常用的几个）
     enum HttpStatusCode {
         kUnknown,
+        k101SwitchingProtocols = 101,    // 协议升级（WebSocket）
         k200Ok = 200,                    // 成功
+        k204NoContent = 204,             // 成功，没有响应体
+        k206PartialContent = 206,        // 部分内容（Range请求）
         k301MovedPermanently = 301,      // 永久重定向
+        k302Found = 302,                 // 临时重定向
+        k304NotModified = 304,           // 资源未修改（条件请求）
         k400BadRequest = 400,            // 客户端请求错误
+        k403Forbidden = 403,             // 禁止访问
         k404NotFound = 404,              // 资源不存在
-        k500InternalServerError = 500    // 服务器内部错误
+        k405MethodNotAllowed = 405,      // 路径存在但不支持该方法
+        k408RequestTimeout = 408,        // 没有在规定时间内收完请求
+        k413PayloadTooLarge = 413,       // 请求体太大
+        k414UriTooLong = 414,            // 请求行太长
+        k416RangeNotSatisfiable = 416,   // Range超出文件范围
+        k426UpgradeRequired = 426,       // 需要升级协议（如WebSocket版本不支持）
+        k431RequestHeaderFieldsTooLarge = 431,  // 头部太大或太多
+        k500InternalServerError = 500,   // 服务器内部错误
+        k502BadGateway = 502,            // 上游出错（反向代理）
+        k503ServiceUnavailable = 503,    // 服务暂时不可用
+        k504GatewayTimeout = 504         // 上游超时（反向代理）
     };
-
+    
+    // 协议升级后接管连接的处理函数：收到数据时调用onMessage，连接断开时调用onClose
+    struct Upgrade {
+        std::function<void(const std::shared_ptr<TcpConnection>&, Buffer*)> onMessage;
+        std::function<void(const std::shared_ptr<TcpConnection>&)> onClose;
+    };
+    
+    // 101响应发出之后调用，创建新协议的处理函数（此时请求仍然有效）
+    using UpgradeCallback = std::function<Upgrade(const std::shared_ptr<TcpConnection>&,
+                                                  const HttpRequest&)>;
+    
+    // 流式响应体：头部发出后调用，之后由HttpResponseStream分块写入（在连接所在的IO线程调用）
+    using StreamCallback = std::function<void(const std::shared_ptr<HttpResponseStream>&)>;
+    
+    // 响应体容量超过这个值时reset()释放它，偶尔的大响应不会让连接一直占着内存
+    static const size_t kMaxRetainedBodySize = 64 * 1024;
+    
     // 构造函数
     explicit HttpResponse(bool close)
         : statusCode_(kUnknown),
-          closeConnection_(close)
+          closeConnection_(close),
+          sharedOffset_(0),
+          sharedLength_(0),
+          streamLength_(-1),
+          headOnly_(false)
     {
     }
-
+    
+    // 清空响应，准备下一个请求（保留存储的容量）
+    void reset(bool close);
+    
     // === 设置响应信息（用户业务逻辑调用） ===
     
     void setStatusCode(HttpStatusCode code) {
         statusCode_ = code;
     }
     
-    void setStatusMessage(const std::string& message) {
-        statusMessage_ = message;
+    // 不设置时使用状态码的标准描述（可以直接用预先生成好的状态行）
+    void setStatusMessage(StringPiece message) {
+        statusMessage_.assign(message.data(), message.size());
     }
     
     void setCloseConnection(bool on) {
@@ -40,20 +95,91 @@ public:
     }
     
     // 便利方法：设置Content-Type
-    void setContentType(const std::string& contentType) {
+    void setContentType(StringPiece contentType) {
         addHeader("Content-Type", contentType);
     }
     
-    // 添加响应头
-    void addHeader(const std::string& key, const std::string& value) {
-        headers_[key] = value;
+    // 添加响应头，同名（不区分大小写）的头部会被替换
+    // 名字和值都会被拷贝，可以直接传请求里的头部、路由参数
+    void addHeader(StringPiece key, StringPiece value);
+    
+    // 追加一个响应头，不检查同名的头部（Set-Cookie这类可以出现多次的头部，反向代理原样转发上游的头部）
+    void appendHeader(StringPiece key, StringPiece value);
+    
+    // 设置响应体（拷贝到body_，复用它的容量）
+    void setBody(StringPiece body) {
+        body_.assign(body.data(), body.size());
+        sharedBody_.reset();
     }
     
-    // 设置响应体
-    void setBody(const std::string& body) {
-        body_ = body;
+    void setBody(const char* body) {
+        setBody(StringPiece(body));
     }
-
+    
+    // 已经生成好的大响应体直接move进来，不拷贝
+    void setBody(std::string&& body) {
+        body_ = std::move(body);
+        sharedBody_.reset();
+    }
+    
+    // 响应体引用一块共享的数据（如文件缓存），只取[offset, offset + length)，不拷贝
+    void setBody(std::shared_ptr<const std::string> body, size_t offset, size_t length) {
+        body_.clear();
+        sharedBody_ = std::move(body);
+        sharedOffset_ = offset;
+        sharedLength_ = length;
+    }
+    
+    // 响应体是文件的[offset, offset + length)，由HttpServer用sendfile发送
+    // 响应接管fd，没有发送出去时析构会close
+    void setFileBody(int fd, off_t offset, size_t length);
+    
+    // 流式响应体：不需要一次性准备好整个响应体（大的导出、边生成边发送）
+    // 头部先发出去，然后调用cb，响应体通过HttpResponseStream分块写入，可以来自内存、文件或生成器
+    // contentLength >= 0时发送Content-Length，否则HTTP/1.1用Transfer-Encoding: chunked，
+    // 要关闭的连接（包括HTTP/1.0）不加分块编码，发完后关闭连接作为结束
+    // 流式响应不压缩；HEAD请求只发送头部，不调用cb
+    void setStream(StreamCallback cb, int64_t contentLength = -1) {
+        body_.clear();
+        sharedBody_.reset();
+        fileBody_.reset();
+        stream_ = std::move(cb);
+        streamLength_ = contentLength;
+    }
+    
+    const StreamCallback& streamCallback() const {
+        return stream_;
+    }
+    
+    bool hasStream() const {
+        return static_cast<bool>(stream_);
+    }
+    
+    // 流式响应体的长度，-1表示未知
+    int64_t streamLength() const {
+        return streamLength_;
+    }
+    
+    // 流式响应体是否使用分块编码
+    bool chunked() const {
+        return stream_ && streamLength_ < 0 && !closeConnection_;
+    }
+    
+    // 101 Switching Protocols：响应发出后连接不再按HTTP处理，交给cb返回的处理函数
+    // 101响应不自动添加Connection头部，由调用者设置（Connection: Upgrade）
+    void setUpgrade(UpgradeCallback cb) {
+        upgrade_ = std::move(cb);
+    }
+    
+    const UpgradeCallback& upgradeCallback() const {
+        return upgrade_;
+    }
+    
+    // 只发送头部（HEAD请求）：Content-Length照常计算，但不带响应体
+    void setHeadOnly(bool on) {
+        headOnly_ = on;
+    }
+    
     // === 获取响应信息 ===
     
     bool closeConnection() const {
@@ -63,18 +189,92 @@ public:
     HttpStatusCode statusCode() const {
         return statusCode_;
     }
-
+    
+    // 内存中的响应体（文件响应体不在这里）
+    StringPiece body() const {
+        if (sharedBody_) {
+            return StringPiece(sharedBody_->data() + sharedOffset_, sharedLength_);
+        }
+        return StringPiece(body_);
+    }
+    
+    bool hasFileBody() const {
+        return fileBody_ != nullptr;
+    }
+    
+    // 响应体是否引用共享数据（静态文件缓存等会反复发送的内容）
+    bool hasSharedBody() const {
+        return sharedBody_ != nullptr;
+    }
+    
+    bool headOnly() const {
+        return headOnly_;
+    }
+    
+    // 查找响应头（不区分大小写），没有时返回空
+    StringPiece header(StringPiece key) const;
+    
+    // 用户添加的响应头（不含Date/Content-Length/Connection），按添加顺序
+    int headerCount() const { return static_cast<int>(headers_.size()); }
+    StringPiece headerField(int i) const {
+        return StringPiece(headerStore_.data() + headers_[i].offset, headers_[i].nameLength);
+    }
+    StringPiece headerValue(int i) const {
+        return StringPiece(headerStore_.data() + headers_[i].valueOffset, headers_[i].valueLength);
+    }
+    
+    // 取走内存中的响应体，响应体在返回值的[offset, offset + length)
+    // 普通响应体会被move进一个新的shared_ptr，不拷贝（HTTP/2分帧发送时用）
+    std::shared_ptr<const std::string> releaseBody(size_t* offset, size_t* length);
+    
+    // 取走文件响应体的fd，之后由调用者负责close
+    int releaseFileBody(off_t* offset, size_t* length);
+    
     // === 核心功能：生成HTTP响应文本 ===
     
     // 将响应转换为HTTP格式并写入Buffer
-    void appendToBuffer(Buffer* output) const;
+    // now用来生成Date头部，不传时取当前时间（HttpServer传入请求的接收时间，省一次系统调用）
+    void appendToBuffer(Buffer* output, Timestamp now = Timestamp()) const;
+    
+    // 状态码的标准描述，如200 -> "OK"，未知状态码返回"Unknown"
+    static const char* reasonPhrase(int code);
+    
+    // 当前线程缓存的Date头部（"Date: ...\r\n"），每秒只格式化一次
+    // 每个EventLoop独占一个线程，所以这就是每个loop一份缓存，不需要加锁
+    static StringPiece dateHeader(Timestamp now);
 
 private:
-    std::unordered_map<std::string, std::string> headers_;  // 响应头
-    HttpStatusCode statusCode_;                             // 状态码
-    std::string statusMessage_;                             // 状态描述
-    bool closeConnection_;                                  // 是否关闭连接
-    std::string body_;                                      // 响应体
+    struct FileBody {
+        FileBody(int f, off_t off, size_t len) : fd(f), offset(off), length(len) {}
+        ~FileBody();
+        
+        int fd;
+        off_t offset;
+        size_t length;
+    };
+    
+    // 一个响应头在headerStore_中的位置（替换值时新值追加在后面，旧值留到reset）
+    struct Header {
+        uint32_t offset;
+        uint32_t nameLength;
+        uint32_t valueOffset;
+        uint32_t valueLength;
+    };
+    
+    std::string headerStore_;                   // 响应头的名字和值
+    std::vector<Header> headers_;               // 响应头（按添加顺序输出）
+    HttpStatusCode statusCode_;                 // 状态码
+    std::string statusMessage_;                 // 状态描述
+    bool closeConnection_;                      // 是否关闭连接
+    std::string body_;                          // 响应体
+    std::shared_ptr<const std::string> sharedBody_;  // 共享的响应体（优先于body_）
+    size_t sharedOffset_;
+    size_t sharedLength_;
+    std::unique_ptr<FileBody> fileBody_;        // 用sendfile发送的响应体
+    StreamCallback stream_;                     // 流式响应体
+    int64_t streamLength_;                      // 流式响应体的长度（-1表示未知）
+    bool headOnly_;                             // 只发送头部
+    UpgradeCallback upgrade_;                   // 协议升级
 };
 
-#endif
\ No newline at end of file
+#endif
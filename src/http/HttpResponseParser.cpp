@@ -0,0 +1,260 @@
+#include "HttpResponseParser.h"
+#include "../net/Buffer.h"
+#include <algorithm>
+#include <cstring>
+
+const size_t HttpResponseParser::kMaxHeaderSize;
+
+namespace {
+
+// 十进制长度，格式错误或溢出返回false
+bool parseLength(StringPiece value, uint64_t* length) {
+    if (value.empty()) {
+        return false;
+    }
+    uint64_t n = 0;
+    for (char c : value) {
+        if (c < '0' || c > '9' || n > (UINT64_MAX - 9) / 10) {
+            return false;
+        }
+        n = n * 10 + (c - '0');
+    }
+    *length = n;
+    return true;
+}
+
+StringPiece trim(const char* begin, const char* end) {
+    while (begin < end && (*begin == ' ' || *begin == '\t')) {
+        ++begin;
+    }
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t')) {
+        --end;
+    }
+    return StringPiece(begin, end);
+}
+
+}  // namespace
+
+HttpResponseParser::HttpResponseParser()
+    : state_(kExpectStatusLine),
+      partial_(false),
+      headRequest_(false),
+      statusCode_(0),
+      http10_(false),
+      close_(false),
+      bodyKind_(kNoBody),
+      contentLength_(0),
+      bodyRemaining_(0)
+{
+}
+
+StringPiece HttpResponseParser::header(StringPiece field) const {
+    for (const Header& h : headers_) {
+        if (h.field.equalsIgnoreCase(field)) {
+            return h.value;
+        }
+    }
+    return StringPiece();
+}
+
+bool HttpResponseParser::parse(Buffer* buf) {
+    while (buf->readableBytes() > 0) {
+        if (state_ == kExpectStatusLine) {
+            // 头部收全之后再解析：头部很小，一般一次就能读到
+            const char* begin = buf->peek();
+            const char* end = static_cast<const char*>(
+                memmem(begin, buf->readableBytes(), "\r\n\r\n", 4));
+            if (!end) {
+                partial_ = true;
+                return buf->readableBytes() <= kMaxHeaderSize;
+            }
+            end += 4;
+            if (!processHeaders(begin, end)) {
+                return false;
+            }
+            partial_ = false;
+            
+            // 1xx中间响应：没有响应体，后面紧跟着真正的响应
+            if (statusCode_ >= 100 && statusCode_ < 200) {
+                buf->retrieveUntil(end);
+                headers_.clear();
+                continue;
+            }
+            if (headersCallback_) {
+                headersCallback_(*this);
+            }
+            buf->retrieveUntil(end);
+            headers_.clear();  // 指向的数据已经取走了
+            reason_ = StringPiece();
+            
+            if (bodyKind_ == kNoBody || (bodyKind_ == kContentLength && contentLength_ == 0)) {
+                complete();
+            } else if (bodyKind_ == kContentLength) {
+                bodyRemaining_ = contentLength_;
+                state_ = kExpectBody;
+            } else if (bodyKind_ == kChunked) {
+                state_ = kExpectChunkSize;
+            } else {
+                state_ = kExpectClose;
+            }
+        } else if (state_ == kExpectBody || state_ == kExpectChunkData || state_ == kExpectClose) {
+            size_t n = buf->readableBytes();
+            if (state_ != kExpectClose && n > bodyRemaining_) {
+                n = static_cast<size_t>(bodyRemaining_);
+            }
+            if (bodyCallback_) {
+                bodyCallback_(buf->peek(), n);
+            }
+            buf->retrieve(n);
+            partial_ = true;
+            if (state_ != kExpectClose) {
+                bodyRemaining_ -= n;
+                if (bodyRemaining_ == 0) {
+                    if (state_ == kExpectBody) {
+                        complete();
+                    } else {
+                        state_ = kExpectChunkEnd;
+                    }
+                }
+            }
+        } else if (state_ == kExpectChunkEnd) {
+            if (buf->readableBytes() < 2) {
+                return true;
+            }
+            if (buf->peek()[0] != '\r' || buf->peek()[1] != '\n') {
+                return false;
+            }
+            buf->retrieve(2);
+            state_ = kExpectChunkSize;
+        } else {
+            // chunk大小行或者trailer行
+            const char* crlf = buf->findCRLF();
+            if (!crlf) {
+                return buf->readableBytes() <= kMaxHeaderSize;
+            }
+            if (state_ == kExpectChunkSize) {
+                if (!processChunkSize(buf->peek(), crlf)) {
+                    return false;
+                }
+            } else if (crlf == buf->peek()) {
+                // trailer结束（trailer本身忽略）
+                buf->retrieveUntil(crlf + 2);
+                complete();
+                continue;
+            }
+            buf->retrieveUntil(crlf + 2);
+        }
+    }
+    return true;
+}
+
+bool HttpResponseParser::finishOnClose() {
+    if (state_ == kExpectClose) {
+        complete();
+        return true;
+    }
+    return !inProgress();
+}
+
+bool HttpResponseParser::processHeaders(const char* begin, const char* end) {
+    // 状态行：HTTP/1.1 200 OK
+    const char* crlf = std::search(begin, end, "\r\n", "\r\n" + 2);
+    StringPiece line(begin, crlf);
+    if (line.size() < 12 || !line.starts_with("HTTP/1.") || line[8] != ' ') {
+        return false;
+    }
+    http10_ = line[7] == '0';
+    int code = 0;
+    for (size_t i = 9; i < 12; ++i) {
+        if (line[i] < '0' || line[i] > '9') {
+            return false;
+        }
+        code = code * 10 + (line[i] - '0');
+    }
+    if (line.size() > 12 && line[12] != ' ') {
+        return false;
+    }
+    statusCode_ = code;
+    reason_ = line.size() > 13 ? StringPiece(line.data() + 13, line.size() - 13) : StringPiece();
+    
+    // 头部行
+    headers_.clear();
+    const char* p = crlf + 2;
+    while (p < end - 2) {
+        const char* lineEnd = std::search(p, end, "\r\n", "\r\n" + 2);
+        const char* colon = std::find(p, lineEnd, ':');
+        if (colon == lineEnd || colon == p) {
+            return false;
+        }
+        Header h;
+        h.field = StringPiece(p, colon);
+        h.value = trim(colon + 1, lineEnd);
+        headers_.push_back(h);
+        p = lineEnd + 2;
+    }
+    
+    // 连接能不能复用
+    StringPiece connection = header("Connection");
+    close_ = connection.equalsIgnoreCase("close") || (http10_ && !connection.equalsIgnoreCase("keep-alive"));
+    
+    // 响应体怎么结束
+    contentLength_ = 0;
+    StringPiece transferEncoding = header("Transfer-Encoding");
+    StringPiece contentLength = header("Content-Length");
+    if (headRequest_ || (code >= 100 && code < 200) || code == 204 || code == 304) {
+        bodyKind_ = kNoBody;
+        parseLength(contentLength, &contentLength_);  // HEAD的Content-Length原样转发
+    } else if (!transferEncoding.empty()) {
+        StringPiece chunked("chunked");
+        if (transferEncoding.size() < chunked.size()
+            || !StringPiece(transferEncoding.end() - chunked.size(), chunked.size())
+                    .equalsIgnoreCase(chunked)) {
+            return false;
+        }
+        bodyKind_ = kChunked;
+    } else if (!contentLength.empty()) {
+        if (!parseLength(contentLength, &contentLength_)) {
+            return false;
+        }
+        bodyKind_ = kContentLength;
+    } else {
+        bodyKind_ = kUntilClose;
+        close_ = true;
+    }
+    return true;
+}
+
+bool HttpResponseParser::processChunkSize(const char* begin, const char* end) {
+    uint64_t size = 0;
+    const char* p = begin;
+    for (; p < end && *p != ';' && *p != ' ' && *p != '\t'; ++p) {
+        int digit;
+        if (*p >= '0' && *p <= '9') digit = *p - '0';
+        else if (*p >= 'a' && *p <= 'f') digit = *p - 'a' + 10;
+        else if (*p >= 'A' && *p <= 'F') digit = *p - 'A' + 10;
+        else return false;
+        if (size > (UINT64_MAX >> 4)) {
+            return false;
+        }
+        size = (size << 4) | digit;
+    }
+    if (p == begin) {
+        return false;
+    }
+    if (size == 0) {
+        state_ = kExpectTrailers;
+    } else {
+        bodyRemaining_ = size;
+        state_ = kExpectChunkData;
+    }
+    return true;
+}
+
+void HttpResponseParser::complete() {
+    state_ = kExpectStatusLine;
+    partial_ = false;
+    bodyRemaining_ = 0;
+    if (completeCallback_) {
+        completeCallback_();
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef TINY_NETWORK_HTTP_HTTPRESPONSEPARSER_H
+#define TINY_NETWORK_HTTP_HTTPRESPONSEPARSER_H
+
+#include "../base/StringPiece.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class Buffer;
+
+// HttpResponseParser：解析从上游（客户端一侧的连接）收到的HTTP/1.x响应
+//
+// 头部收全之后一次性解析，HeadersCallback里可以读取状态码和头部（直接引用Buffer里的数据，
+// 只在回调期间有效）。响应体按Content-Length、分块编码或者连接关闭来界定，
+// 解码后的数据到达一段交给BodyCallback一段，随即从Buffer中取走，不会在内存里攒整个响应体
+//
+// 1xx中间响应（100 Continue等）直接跳过；HEAD请求的响应以及204/304没有响应体
+// 一个连接上的多个响应依次解析，每个响应结束时调用CompleteCallback
+class HttpResponseParser {
+public:
+    using HeadersCallback = std::function<void(const HttpResponseParser&)>;
+    using BodyCallback = std::function<void(const char* data, size_t len)>;
+    using CompleteCallback = std::function<void()>;
+    
+    // 响应体的界定方式
+    enum BodyKind {
+        kNoBody,           // 没有响应体
+        kContentLength,    // Content-Length
+        kChunked,          // Transfer-Encoding: chunked
+        kUntilClose        // 读到连接关闭为止（HTTP/1.0风格）
+    };
+    
+    // 响应头部（状态行 + 头部行）的大小上限
+    static const size_t kMaxHeaderSize = 64 * 1024;
+    
+    HttpResponseParser();
+    
+    void setHeadersCallback(const HeadersCallback& cb) { headersCallback_ = cb; }
+    void setBodyCallback(const BodyCallback& cb) { bodyCallback_ = cb; }
+    void setCompleteCallback(const CompleteCallback& cb) { completeCallback_ = cb; }
+    
+    // 下一个响应对应的请求是HEAD：只有头部（每个请求发出前设置）
+    void setHeadRequest(bool on) { headRequest_ = on; }
+    
+    // 解析buf中的数据并取走，返回false表示响应格式错误（连接不能再用）
+    bool parse(Buffer* buf);
+    
+    // 连接关闭了：以关闭结束的响应体到此完整（调用CompleteCallback），返回true
+    // 其他状态下说明响应被截断，返回false
+    bool finishOnClose();
+    
+    // 正在解析一个响应（已经收到了它的一部分）
+    bool inProgress() const { return state_ != kExpectStatusLine || partial_; }
+    
+    // === 以下只在HeadersCallback期间有效 ===
+    int statusCode() const { return statusCode_; }
+    StringPiece reason() const { return reason_; }
+    bool http10() const { return http10_; }
+    
+    int headerCount() const { return static_cast<int>(headers_.size()); }
+    StringPiece headerField(int i) const { return headers_[i].field; }
+    StringPiece headerValue(int i) const { return headers_[i].value; }
+    
+    // 查找头部（不区分大小写），没有时返回空
+    StringPiece header(StringPiece field) const;
+    
+    // 响应体的界定方式和长度（kContentLength时有效）
+    BodyKind bodyKind() const { return bodyKind_; }
+    uint64_t contentLength() const { return contentLength_; }
+    
+    // 上游要求关闭连接（Connection: close，HTTP/1.0没有keep-alive，或者响应体以关闭结束）
+    bool closeConnection() const { return close_; }
+
+private:
+    enum State {
+        kExpectStatusLine,
+        kExpectBody,
+        kExpectChunkSize,
+        kExpectChunkData,
+        kExpectChunkEnd,
+        kExpectTrailers,
+        kExpectClose
+    };
+    
+    struct Header {
+        StringPiece field;
+        StringPiece value;
+    };
+    
+    // 解析状态行和头部（end指向空行之后）
+    bool processHeaders(const char* begin, const char* end);
+    
+    bool processChunkSize(const char* begin, const char* end);
+    
+    // 一个响应结束，准备解析下一个
+    void complete();
+    
+    State state_;
+    bool partial_;                 // 当前状态下已经收到了一部分数据
+    bool headRequest_;
+    int statusCode_;
+    StringPiece reason_;
+    bool http10_;
+    bool close_;
+    BodyKind bodyKind_;
+    uint64_t contentLength_;
+    uint64_t bodyRemaining_;       // Content-Length或者当前chunk还差多少字节
+    std::vector<Header> headers_;  // 保留容量
+    HeadersCallback headersCallback_;
+    BodyCallback bodyCallback_;
+    CompleteCallback completeCallback_;
+};
+
+#endif
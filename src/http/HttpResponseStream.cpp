@@ -0,0 +1,291 @@
+#include "HttpResponseStream.h"
+#include "../net/TcpConnection.h"
+#include "../net/EventLoop.h"
+#include "../logger/Logger.h"
+#include <cstdio>
+#include <unistd.h>
+
+const size_t HttpResponseStream::kDefaultHighWaterMark;
+const size_t HttpResponseStream::kPullChunkSize;
+
+namespace {
+
+// 小于这个长度的chunk和chunk头拼在一起发送（一次write），更大的直接从调用者的内存发送
+const size_t kCopyThreshold = 4096;
+
+}  // namespace
+
+HttpResponseStream::HttpResponseStream(const std::shared_ptr<TcpConnection>& conn, bool chunked,
+                                       int64_t length, const FinishCallback& cb)
+    : conn_(conn),
+      loop_(conn->getLoop()),
+      chunked_(chunked),
+      length_(length),
+      written_(0),
+      highWaterMark_(kDefaultHighWaterMark),
+      blocked_(false),
+      closed_(false),
+      finished_(false),
+      failed_(false),
+      finishCallback_(cb)
+{
+}
+
+HttpResponseStream::~HttpResponseStream() {
+    if (!finished_ && !closed_) {
+        // 没有调用finish()：对端永远等不到响应体结束，只能断开
+        LOG_ERROR << "HttpResponseStream destroyed without finish()";
+        std::weak_ptr<TcpConnection> weakConn(conn_);
+        loop_->queueInLoop([weakConn]() {
+            std::shared_ptr<TcpConnection> conn = weakConn.lock();
+            if (conn) {
+                conn->forceClose();
+            }
+        });
+    }
+}
+
+void HttpResponseStream::start() {
+    std::shared_ptr<TcpConnection> conn = conn_.lock();
+    if (!conn) {
+        return;
+    }
+    // 连接持有stream的weak_ptr：业务放弃stream时，它能正常析构
+    std::weak_ptr<HttpResponseStream> weakSelf(shared_from_this());
+    conn->setWriteCompleteCallback([weakSelf](const std::shared_ptr<TcpConnection>&) {
+        std::shared_ptr<HttpResponseStream> self = weakSelf.lock();
+        if (self) {
+            self->onWriteComplete();
+        }
+    });
+}
+
+bool HttpResponseStream::write(StringPiece data) {
+    if (closed_ || finished_) {
+        return false;
+    }
+    if (loop_->isInLoopThread()) {
+        return writeInLoop(data.data(), data.size());
+    }
+    std::shared_ptr<HttpResponseStream> self(shared_from_this());
+    loop_->queueInLoop([self, copy = data.as_string()]() {
+        self->writeInLoop(copy.data(), copy.size());
+    });
+    return true;
+}
+
+bool HttpResponseStream::sendFile(int fd, off_t offset, size_t length) {
+    if (closed_ || finished_) {
+        ::close(fd);
+        return false;
+    }
+    if (loop_->isInLoopThread()) {
+        return sendFileInLoop(fd, offset, length);
+    }
+    std::shared_ptr<HttpResponseStream> self(shared_from_this());
+    loop_->queueInLoop([self, fd, offset, length]() {
+        self->sendFileInLoop(fd, offset, length);
+    });
+    return true;
+}
+
+void HttpResponseStream::finish() {
+    if (finished_.exchange(true)) {
+        return;
+    }
+    if (loop_->isInLoopThread()) {
+        finishInLoop();
+    } else {
+        // 排在这个线程之前写的数据后面
+        std::shared_ptr<HttpResponseStream> self(shared_from_this());
+        loop_->queueInLoop([self]() {
+            self->finishInLoop();
+        });
+    }
+}
+
+void HttpResponseStream::pull(Generator gen) {
+    std::shared_ptr<HttpResponseStream> self(shared_from_this());
+    loop_->runInLoop([self, gen]() {
+        if (self->closed_ || self->finished_) {
+            return;
+        }
+        self->generator_ = gen;
+        self->self_ = self;
+        self->pullInLoop();
+    });
+}
+
+std::shared_ptr<TcpConnection> HttpResponseStream::prepareWrite(size_t len) {
+    std::shared_ptr<TcpConnection> conn = conn_.lock();
+    if (!conn || !conn->connected() || closed_) {
+        abort();
+        return nullptr;
+    }
+    if (length_ >= 0 && written_ + len > static_cast<uint64_t>(length_)) {
+        LOG_ERROR << "HttpResponseStream on " << conn->name() << " writes more than Content-Length "
+                  << length_;
+        failed_ = true;
+        return nullptr;
+    }
+    return conn;
+}
+
+bool HttpResponseStream::writeInLoop(const char* data, size_t len) {
+    // 长度为0的chunk表示响应体结束，不能发出去
+    if (len == 0) {
+        return !closed_;
+    }
+    std::shared_ptr<TcpConnection> conn = prepareWrite(len);
+    if (!conn) {
+        return false;
+    }
+    written_ += len;
+    
+    if (!chunked_) {
+        conn->send(data, len);
+    } else if (len < kCopyThreshold) {
+        appendChunkSize(len);
+        chunk_.append(data, len);
+        chunk_.append("\r\n", 2);
+        conn->send(&chunk_);
+    } else {
+        // 大块数据不拷贝：chunk头、数据、结尾的\r\n分三次交给连接
+        appendChunkSize(len);
+        conn->send(&chunk_);
+        conn->send(data, len);
+        conn->send("\r\n", 2);
+    }
+    updateBlocked(conn.get());
+    return true;
+}
+
+bool HttpResponseStream::sendFileInLoop(int fd, off_t offset, size_t length) {
+    if (length == 0) {
+        ::close(fd);
+        return !closed_;
+    }
+    std::shared_ptr<TcpConnection> conn = prepareWrite(length);
+    if (!conn) {
+        ::close(fd);
+        return false;
+    }
+    written_ += length;
+    
+    if (chunked_) {
+        appendChunkSize(length);
+        conn->send(&chunk_);
+        conn->sendFile(fd, offset, length);
+        conn->send("\r\n", 2);
+    } else {
+        conn->sendFile(fd, offset, length);
+    }
+    updateBlocked(conn.get());
+    return true;
+}
+
+void HttpResponseStream::finishInLoop() {
+    generator_ = nullptr;
+    writableCallback_ = nullptr;
+    HttpResponseStreamPtr self;
+    self.swap(self_);  // 这个函数返回之前不能析构
+    std::shared_ptr<TcpConnection> conn = conn_.lock();
+    if (!conn) {
+        return;
+    }
+    conn->setWriteCompleteCallback(TcpConnection::WriteCompleteCallback());
+    
+    bool ok = !closed_ && !failed_ && conn->connected();
+    if (ok && length_ >= 0 && written_ != static_cast<uint64_t>(length_)) {
+        LOG_ERROR << "HttpResponseStream on " << conn->name() << " finished after " << written_
+                  << " bytes, Content-Length is " << length_;
+        ok = false;
+    }
+    if (ok && chunked_) {
+        conn->send("0\r\n\r\n", 5);
+    }
+    
+    // 在当前的回调返回之后再通知HttpServer：finish()可能就在业务的StreamCallback里调用
+    FinishCallback cb;
+    cb.swap(finishCallback_);
+    if (cb) {
+        loop_->queueInLoop([conn, cb, ok]() {
+            cb(conn, ok);
+        });
+    }
+}
+
+void HttpResponseStream::pullInLoop() {
+    std::shared_ptr<HttpResponseStream> self(shared_from_this());
+    size_t round = 0;
+    while (generator_ && !blocked_ && !closed_ && !finished_) {
+        pullBuffer_.clear();
+        bool more = true;
+        while (more && pullBuffer_.size() < kPullChunkSize) {
+            more = generator_(&pullBuffer_);
+        }
+        if (!pullBuffer_.empty() && !writeInLoop(pullBuffer_.data(), pullBuffer_.size())) {
+            generator_ = nullptr;
+            if (!closed_) {
+                finish();  // 超过了Content-Length：结束并关闭连接
+            }
+            return;
+        }
+        if (!more) {
+            generator_ = nullptr;
+            finish();
+            return;
+        }
+        
+        // 对端读得很快时socket一直可写：写够一个高水位就让出IO线程，其他连接也能得到处理
+        round += pullBuffer_.size();
+        if (round >= highWaterMark_ && !blocked_) {
+            loop_->queueInLoop([self]() {
+                self->pullInLoop();
+            });
+            return;
+        }
+    }
+    if (pullBuffer_.capacity() > kPullChunkSize * 4) {
+        std::string().swap(pullBuffer_);  // 生成器偶尔返回的大块数据不一直占着内存
+    }
+}
+
+void HttpResponseStream::onWriteComplete() {
+    if (!blocked_ || finished_) {
+        return;
+    }
+    blocked_ = false;
+    if (generator_) {
+        pullInLoop();
+    } else if (writableCallback_) {
+        writableCallback_(shared_from_this());
+    }
+}
+
+void HttpResponseStream::abort() {
+    if (closed_.exchange(true)) {
+        return;
+    }
+    generator_ = nullptr;
+    finishCallback_ = nullptr;
+    HttpResponseStreamPtr self;
+    self.swap(self_);
+    WritableCallback cb;
+    cb.swap(writableCallback_);
+    if (cb && !finished_) {
+        cb(shared_from_this());
+    }
+}
+
+void HttpResponseStream::appendChunkSize(size_t len) {
+    char buf[32];
+    int n = snprintf(buf, sizeof buf, "%zx\r\n", len);
+    chunk_.append(buf, n);
+}
+
+void HttpResponseStream::updateBlocked(TcpConnection* conn) {
+    if (conn->pendingOutputBytes() >= highWaterMark_) {
+        blocked_ = true;
+    }
+}
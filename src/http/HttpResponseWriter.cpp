@@ -0,0 +1,103 @@
+#include "HttpResponseWriter.h"
+#include "HttpContext.h"
+#include "../net/TcpConnection.h"
+#include "../net/EventLoop.h"
+#include "../logger/Logger.h"
+
+HttpResponseWriter::HttpResponseWriter(const std::shared_ptr<TcpConnection>& conn, const HttpContext& context,
+                                       bool close, const CompleteCallback& cb)
+    : conn_(conn),
+      loop_(conn->getLoop()),
+      completeCallback_(cb),
+      response_(close),
+      sent_(false),
+      bodyDone_(false),
+      aborted_(false)
+{
+    context.copyRequest(&requestData_, &request_);
+    
+    // HEAD请求只发送头部（Content-Length仍然是完整响应体的长度）
+    if (request_.method() == HttpRequest::kHead) {
+        response_.setHeadOnly(true);
+    }
+}
+
+HttpResponseWriter::~HttpResponseWriter() {
+    if (!sent_) {
+        // 不能再用shared_from_this，只通知IO线程回复500
+        LOG_ERROR << "HttpResponseWriter destroyed without send()";
+        std::weak_ptr<TcpConnection> weakConn(conn_);
+        CompleteCallback cb(std::move(completeCallback_));
+        loop_->queueInLoop([weakConn, cb]() {
+            std::shared_ptr<TcpConnection> conn = weakConn.lock();
+            if (conn) {
+                cb(conn, nullptr);
+            }
+        });
+    }
+}
+
+void HttpResponseWriter::send() {
+    if (sent_.exchange(true)) {
+        return;
+    }
+    
+    // 总是queueInLoop：在IO线程的回调里直接调用send()时，也等当前的事件处理完再发送
+    std::shared_ptr<HttpResponseWriter> self(shared_from_this());
+    loop_->queueInLoop([self]() {
+        std::shared_ptr<TcpConnection> conn = self->conn_.lock();
+        if (conn) {
+            self->completeCallback_(conn, self.get());
+        }
+    });
+}
+
+void HttpResponseWriter::setBodyCallback(const BodyCallback& cb) {
+    if (!pendingBody_.empty()) {
+        std::string pending;
+        pending.swap(pendingBody_);
+        cb(pending, false);
+    }
+    if (bodyDone_) {
+        cb(StringPiece(), true);
+    } else {
+        bodyCallback_ = cb;
+    }
+}
+
+void HttpResponseWriter::pauseBody() {
+    std::shared_ptr<TcpConnection> conn = conn_.lock();
+    if (conn && !bodyDone_) {
+        conn->stopRead();
+    }
+}
+
+void HttpResponseWriter::resumeBody() {
+    std::shared_ptr<TcpConnection> conn = conn_.lock();
+    if (conn) {
+        conn->startRead();
+    }
+}
+
+void HttpResponseWriter::deliverBody(StringPiece chunk) {
+    if (bodyCallback_) {
+        bodyCallback_(chunk, false);
+    } else {
+        pendingBody_.append(chunk.data(), chunk.size());
+    }
+}
+
+void HttpResponseWriter::endBody(bool aborted) {
+    if (bodyDone_) {
+        return;
+    }
+    bodyDone_ = true;
+    aborted_ = aborted;
+    
+    // 回调通常持有writer（业务的请求对象里保存着它），调用之后释放，打破引用环
+    BodyCallback cb;
+    cb.swap(bodyCallback_);
+    if (cb) {
+        cb(StringPiece(), true);
+    }
+}
@@ -0,0 +1,236 @@
+#include "HttpRouter.h"
+#include "HttpResponse.h"
+#include "../logger/Logger.h"
+#include <algorithm>  // for std::find
+#include <cstring>    // for memchr
+
+namespace {
+
+const int kNumMethods = HttpRequest::kDelete + 1;
+
+// 两段字符串的公共前缀长度
+size_t commonPrefix(const std::string& a, StringPiece b) {
+    size_t n = std::min(a.size(), b.size());
+    size_t i = 0;
+    while (i < n && a[i] == b[i]) {
+        ++i;
+    }
+    return i;
+}
+
+}  // namespace
+
+// 树节点
+// 静态子节点按首字符区分（同一个节点下首字符互不相同），indices保存这些首字符，
+// 查找子节点只需要在一个很短的字符串里memchr
+struct HttpRouter::Node {
+    Node() : methods(0) {}
+    
+    std::string prefix;                          // 从父节点到这里的静态路径片段
+    std::string indices;                         // 静态子节点的首字符
+    std::vector<std::unique_ptr<Node>> children; // 静态子节点
+    std::unique_ptr<Node> paramChild;            // :name 子节点
+    std::unique_ptr<Node> wildcardChild;         // *name 子节点
+    std::string name;                            // 参数/通配节点的名称
+    Handler handlers[kNumMethods];               // 按方法索引的处理函数
+    unsigned methods;                            // 已注册的方法（1 << Method）
+};
+
+HttpRouter::HttpRouter()
+    : root_(new Node),
+      numRoutes_(0)
+{
+}
+
+HttpRouter::~HttpRouter() {
+}
+
+void HttpRouter::addRoute(HttpRequest::Method method, StringPiece pattern, const Handler& handler) {
+    if (pattern.empty() || pattern[0] != '/') {
+        LOG_FATAL << "HttpRouter: route must start with '/': " << pattern;
+    }
+    if (method == HttpRequest::kInvalid || !handler) {
+        LOG_FATAL << "HttpRouter: invalid route " << pattern;
+    }
+    
+    Node* node = root_.get();
+    const char* p = pattern.begin();
+    const char* end = pattern.end();
+    int numParams = 0;
+    while (p < end) {
+        if (*p == ':' || *p == '*') {
+            // 参数/通配：名称一直到下一个'/'
+            const char* nameEnd = std::find(p + 1, end, '/');
+            if (nameEnd == p + 1) {
+                LOG_FATAL << "HttpRouter: empty parameter name in " << pattern;
+            }
+            if (*p == '*' && nameEnd != end) {
+                LOG_FATAL << "HttpRouter: wildcard must be the last segment: " << pattern;
+            }
+            if (++numParams > HttpRequest::kMaxParams) {
+                LOG_FATAL << "HttpRouter: too many parameters in " << pattern;
+            }
+            
+            std::unique_ptr<Node>& child = (*p == ':') ? node->paramChild : node->wildcardChild;
+            StringPiece name(p + 1, nameEnd);
+            if (!child) {
+                child.reset(new Node);
+                child->name = name.as_string();
+            } else if (StringPiece(child->name) != name) {
+                // 同一位置的参数名称必须相同，否则匹配结果有歧义
+                LOG_FATAL << "HttpRouter: parameter :" << name << " in " << pattern
+                          << " conflicts with existing :" << child->name;
+            }
+            node = child.get();
+            p = nameEnd;
+        } else {
+            // 静态片段：一直到下一个参数/通配
+            const char* q = p;
+            while (q < end && *q != ':' && *q != '*') {
+                ++q;
+            }
+            node = insertStatic(node, StringPiece(p, q));
+            p = q;
+        }
+    }
+    
+    if (node->handlers[method]) {
+        LOG_FATAL << "HttpRouter: duplicate route " << HttpRequest::methodName(method)
+                  << " " << pattern;
+    }
+    node->handlers[method] = handler;
+    node->methods |= 1u << method;
+    ++numRoutes_;
+}
+
+// 插入静态片段：和已有子节点的公共前缀不足整个子节点前缀时，分裂出一个中间节点
+// 例如已有/users，插入/uploads：/u -> {sers, ploads}
+HttpRouter::Node* HttpRouter::insertStatic(Node* node, StringPiece text) {
+    while (!text.empty()) {
+        size_t pos = node->indices.find(text[0]);
+        if (pos == std::string::npos) {
+            // 没有相同首字符的子节点，整段作为新节点
+            node->indices.push_back(text[0]);
+            node->children.emplace_back(new Node);
+            node->children.back()->prefix = text.as_string();
+            return node->children.back().get();
+        }
+        
+        Node* child = node->children[pos].get();
+        size_t len = commonPrefix(child->prefix, text);
+        if (len < child->prefix.size()) {
+            // 分裂：child变成中间节点的子节点
+            std::unique_ptr<Node> mid(new Node);
+            mid->prefix = child->prefix.substr(0, len);
+            child->prefix.erase(0, len);
+            mid->indices.push_back(child->prefix[0]);
+            mid->children.push_back(std::move(node->children[pos]));
+            node->children[pos] = std::move(mid);
+            child = node->children[pos].get();
+        }
+        text.remove_prefix(len);
+        node = child;
+    }
+    return node;
+}
+
+const HttpRouter::Node* HttpRouter::matchNode(const Node* node, StringPiece path,
+                                              HttpRequest::Method method, HttpRequest* req,
+                                              unsigned* allowedMethods) const {
+    if (path.empty()) {
+        if (node->handlers[method]) {
+            return node;
+        }
+        *allowedMethods |= node->methods;
+    } else {
+        // 1. 静态子节点
+        const void* hit = memchr(node->indices.data(), path[0], node->indices.size());
+        if (hit) {
+            const Node* child = node->children[static_cast<const char*>(hit) - node->indices.data()].get();
+            if (path.starts_with(child->prefix)) {
+                StringPiece rest(path);
+                rest.remove_prefix(child->prefix.size());
+                const Node* found = matchNode(child, rest, method, req, allowedMethods);
+                if (found) {
+                    return found;
+                }
+            }
+        }
+        
+        // 2. 参数：匹配到下一个'/'为止（不能为空）
+        const Node* param = node->paramChild.get();
+        if (param && path[0] != '/') {
+            const void* slash = memchr(path.data(), '/', path.size());
+            StringPiece value(path.data(), slash ? static_cast<const char*>(slash) : path.end());
+            if (req->addParam(param->name, value)) {
+                StringPiece rest(path);
+                rest.remove_prefix(value.size());
+                const Node* found = matchNode(param, rest, method, req, allowedMethods);
+                if (found) {
+                    return found;
+                }
+                req->popParam();  // 回溯
+            }
+        }
+    }
+    
+    // 3. 通配：匹配剩下的全部路径
+    const Node* wildcard = node->wildcardChild.get();
+    if (wildcard) {
+        if (wildcard->handlers[method]) {
+            if (req->addParam(wildcard->name, path)) {
+                return wildcard;
+            }
+        } else {
+            *allowedMethods |= wildcard->methods;
+        }
+    }
+    return nullptr;
+}
+
+const HttpRouter::Handler* HttpRouter::match(HttpRequest* req, unsigned* allowedMethods) const {
+    unsigned allowed = 0;
+    req->clearParams();
+    const Node* node = nullptr;
+    HttpRequest::Method method = req->method();
+    if (method != HttpRequest::kInvalid) {
+        node = matchNode(root_.get(), req->path(), method, req, &allowed);
+    }
+    // 没有单独注册HEAD时使用GET的处理函数，HttpServer只发送响应头
+    if (!node && method == HttpRequest::kHead) {
+        method = HttpRequest::kGet;
+        req->clearParams();
+        node = matchNode(root_.get(), req->path(), method, req, &allowed);
+    }
+    if (allowedMethods) {
+        *allowedMethods = node ? 0 : allowed;
+    }
+    return node ? &node->handlers[method] : nullptr;
+}
+
+bool HttpRouter::dispatch(HttpRequest* req, HttpResponse* resp) const {
+    unsigned allowed = 0;
+    const Handler* handler = match(req, &allowed);
+    if (handler) {
+        (*handler)(*req, resp);
+        return true;
+    }
+    if (allowed == 0) {
+        return false;
+    }
+    
+    // 路径存在但不支持这个方法：405 + Allow
+    std::string allow;
+    for (int m = HttpRequest::kGet; m < kNumMethods; ++m) {
+        if (allowed & (1u << m)) {
+            if (!allow.empty()) {
+                allow += ", ";
+            }
+            allow += HttpRequest::methodName(static_cast<HttpRequest::Method>(m));
+        }
+    }
+    resp->setStatusCode(HttpResponse::k405MethodNotAllowed);
+    resp->setStatusMessage("Method Not Allowed");
+    resp->addHeader("Allow", allow);
+    return true;
+}
@@ -0,0 +1,79 @@
+#ifndef TINY_NETWORK_HTTP_HTTPROUTER_H
+#define TINY_NETWORK_HTTP_HTTPROUTER_H
+
+#include "../base/noncopyable.h"
+#include "../base/StringPiece.h"
+#include "HttpRequest.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class HttpResponse;
+
+// HttpRouter：基于压缩前缀树（radix tree）的请求路由
+//
+// 路由规则：
+//   /users            静态路径，完全匹配
+//   /users/:id        参数，匹配一个路径段（不含'/'），通过req.param("id")获取
+//   /static/*path     通配，匹配剩下的全部路径（可以为空），只能放在最后
+//
+// 匹配优先级：静态 > 参数 > 通配，前面的分支匹配失败会回溯尝试后面的分支
+// 路径匹配但方法不匹配时返回405，并在Allow头部中列出支持的方法
+// 没有单独注册HEAD的路径，HEAD请求使用GET的处理函数
+//
+// 使用方式：服务器启动前注册好所有路由，之后树只读，多个IO线程可以同时匹配
+// 匹配过程不分配内存，捕获的参数是指向请求路径的StringPiece
+class HttpRouter : noncopyable {
+public:
+    using Handler = std::function<void(const HttpRequest&, HttpResponse*)>;
+    
+    HttpRouter();
+    ~HttpRouter();
+    
+    // 注册路由，模式非法或与已有路由冲突时LOG_FATAL（启动阶段的编程错误）
+    void addRoute(HttpRequest::Method method, StringPiece pattern, const Handler& handler);
+    
+    void GET(StringPiece pattern, const Handler& handler) {
+        addRoute(HttpRequest::kGet, pattern, handler);
+    }
+    void POST(StringPiece pattern, const Handler& handler) {
+        addRoute(HttpRequest::kPost, pattern, handler);
+    }
+    void PUT(StringPiece pattern, const Handler& handler) {
+        addRoute(HttpRequest::kPut, pattern, handler);
+    }
+    void DELETE(StringPiece pattern, const Handler& handler) {
+        addRoute(HttpRequest::kDelete, pattern, handler);
+    }
+    void HEAD(StringPiece pattern, const Handler& handler) {
+        addRoute(HttpRequest::kHead, pattern, handler);
+    }
+    
+    // 查找req对应的处理函数，捕获的参数写入req
+    // 找不到返回nullptr；如果路径存在但方法不对，allowedMethods中置位支持的方法（1 << Method）
+    const Handler* match(HttpRequest* req, unsigned* allowedMethods = nullptr) const;
+    
+    // 匹配并调用处理函数；方法不匹配时填充405响应
+    // 返回false表示没有任何路由匹配这个路径
+    bool dispatch(HttpRequest* req, HttpResponse* resp) const;
+    
+    // 已注册的路由数量
+    size_t size() const { return numRoutes_; }
+    bool empty() const { return numRoutes_ == 0; }
+
+private:
+    struct Node;
+    
+    // 插入静态路径片段，返回片段末尾对应的节点（必要时分裂已有节点）
+    Node* insertStatic(Node* node, StringPiece text);
+    
+    // 递归匹配，node的前缀已经匹配完，path是剩余的路径
+    const Node* matchNode(const Node* node, StringPiece path, HttpRequest::Method method,
+                          HttpRequest* req, unsigned* allowedMethods) const;
+    
+    std::unique_ptr<Node> root_;
+    size_t numRoutes_;
+};
+
+#endif
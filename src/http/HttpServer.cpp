@@ -2,18 +2,47 @@
 #include "HttpContext.h"
 #include "HttpRequest.h" 
 #include "HttpResponse.h"
+#include "Http2Connection.h"
+#include "HttpResponseStream.h"
 #include "../net/TcpConnection.h"
+#include "../net/EventLoop.h"
 #include "../net/Buffer.h"
-#include <iostream>
+#include "../logger/Logger.h"
 
-// HttpContext在连接对象中的存储key
-const std::string kHttpContext = "HttpContext";
+
+// 关闭写端之后最多再等多久，对方还不关闭就强制关闭
+const double kLingerTime = 5.0;
+
+namespace {
+
+// HTTP/1.1默认keep-alive，HTTP/1.0默认close
+bool requestWantsClose(const HttpRequest& req) {
+    StringPiece connection = req.getHeader("Connection");
+    return connection.equalsIgnoreCase("close") || 
+           (req.version() == HttpRequest::kHttp10 && !connection.equalsIgnoreCase("Keep-Alive"));
+}
+
+}  // namespace
 
 HttpServer::HttpServer(EventLoop* loop,
                        const std::string& name,
                        int port)
-    : server_(loop, name, port)
+    : server_(loop, name, port),
+      maxBodySize_(HttpContext::kDefaultMaxBodySize),
+      maxHeaderSize_(HttpContext::kDefaultMaxHeaderSize),
+      maxHeaderCount_(HttpRequest::kMaxHeaders),
+      headerTimeout_(30.0),
+      bodyTimeout_(30.0),
+      idleTimeout_(60.0),
+      offloadSize_(kDefaultCompressionOffloadSize),
+      workerThreads_(0),
+      http2_(false),
+      handlerOffload_(false),
+      workerPool_(name + "-worker")
 {
+    // 工作线程跟不上时在IO线程自己做，不无限排队
+    workerPool_.setMaxQueueSize(1024);
+    
     // 设置TcpServer的回调函数
     server_.setConnectionCallback([this](const std::shared_ptr<TcpConnection>& conn) {
         onConnection(conn);
@@ -28,9 +57,33 @@ HttpServer::HttpServer(EventLoop* loop,
 HttpServer::~HttpServer() {
 }
 
+void HttpServer::websocket(StringPiece pattern, const WebSocketHandler& handler,
+                           size_t maxMessageSize) {
+    std::shared_ptr<const WebSocketHandler> shared = std::make_shared<WebSocketHandler>(handler);
+    router_.GET(pattern, [shared, maxMessageSize](const HttpRequest& req, HttpResponse* resp) {
+        WebSocketConnection::handshake(req, resp, shared, maxMessageSize);
+    });
+}
+
+void HttpServer::enableCompression(size_t minSize) {
+    if (!compressor_) {
+        compressor_.reset(new HttpCompressor);
+    }
+    compressor_->setMinSize(minSize);
+}
+
 void HttpServer::start() {
-    std::cout << "HttpServer[" << server_.name() << "] starts listening on " 
-              << server_.ipPort() << std::endl;
+    LOG_INFO << "HttpServer[" << server_.name() << "] starts listening on " 
+              << server_.ipPort();
+    if (http2_ && (asyncHttpCallback_ || streamingHttpCallback_)) {
+        // 否则路由没有匹配的HTTP/2请求都会是404
+        LOG_WARN << "HttpServer[" << server_.name()
+                 << "] HTTP/2 does not support async or streaming callbacks, disabled";
+        http2_ = false;
+    }
+    if (workerThreads_ > 0 && !workerPool_.running()) {
+        workerPool_.start(workerThreads_);
+    }
     server_.start();
 }
 
@@ -39,12 +92,57 @@ void HttpServer::onConnection(const std::shared_ptr<TcpConnection>& conn) {
     if (conn->state() == TcpConnection::kConnecting || conn->state() == TcpConnection::kConnected) {
         // 新连接建立：为每个连接创建一个HttpContext
         std::shared_ptr<HttpContext> context = std::make_shared<HttpContext>();
-        conn->setContext(kHttpContext, context);
+        context->setMaxBodySize(maxBodySize_);
+        context->setMaxHeaderSize(maxHeaderSize_);
+        context->setMaxHeaderCount(maxHeaderCount_);
+        if (streamingHttpCallback_) {
+            // 流式业务回调：请求体交给当前请求的writer（第一段请求体可能和头部在同一次读里）
+            // context由连接持有，回调由context持有，所以只持有连接的weak_ptr
+            std::weak_ptr<TcpConnection> weakConn(conn);
+            HttpContext* ctx = context.get();
+            context->setBodyCallback([this, weakConn, ctx](const HttpRequest&, StringPiece chunk) {
+                std::shared_ptr<TcpConnection> conn = weakConn.lock();
+                if (!conn) {
+                    return;
+                }
+                if (!ctx->bodyWriter()) {
+                    dispatchStreaming(conn, ctx);
+                }
+                ctx->bodyWriter()->deliverBody(chunk);
+            });
+        } else if (bodyCallback_) {
+            context->setBodyCallback(bodyCallback_);
+        }
+        conn->setContext(context);
         
-        std::cout << "New HTTP connection: " << conn->name() << std::endl;
+        // 连上之后什么都不发的连接也要在头部超时之后关闭
+        updateTimeout(conn, context.get(), Timestamp::now());
+        
+        // 响应都是一次写完的，不需要Nagle合并小包；
+        // 而文件响应体是头部之后的第二次写，开着Nagle会和对端的延迟ACK互相等待
+        conn->setTcpNoDelay(true);
+        
+        LOG_DEBUG << "New HTTP connection: " << conn->name();
     } else {
+        // 升级过的连接通知新协议（WebSocket的onClose）
+        HttpContext* context = conn->context<HttpContext>();
+        if (context && context->upgraded() && context->upgrade().onClose) {
+            context->upgrade().onClose(conn);
+        }
+        
+        // 流式响应体还没发完：停止生成器，等待可写的业务方得到通知
+        std::shared_ptr<HttpResponseStream> stream = context ? context->stream() : nullptr;
+        if (stream) {
+            stream->abort();
+        }
+        
+        // 流式接收的请求体还没收完：通知业务请求被放弃了
+        if (context && context->bodyWriter()) {
+            endStreamingBody(conn, context, true);
+        }
+        
         // 连接断开：HttpContext会自动销毁（智能指针）
-        std::cout << "HTTP connection closed: " << conn->name() << std::endl;
+        LOG_DEBUG << "HTTP connection closed: " << conn->name();
     }
 }
 
@@ -53,64 +151,599 @@ void HttpServer::onMessage(const std::shared_ptr<TcpConnection>& conn,
                           Buffer* buf,
                           Timestamp receiveTime) {
     // 1. 获取这个连接的HttpContext
-    auto context = std::static_pointer_cast<HttpContext>(
-        conn->getContext(kHttpContext));
+    HttpContext* context = conn->context<HttpContext>();
     
     if (!context) {
-        std::cout << "Error: HttpContext not found for connection " 
-                  << conn->name() << std::endl;
+        LOG_ERROR << "Error: HttpContext not found for connection " 
+                  << conn->name();
         conn->shutdown();
         return;
     }
     
-    // 2. 使用HttpContext解析HTTP请求
-    if (!context->parseRequest(buf, receiveTime)) {
-        // 解析失败，发送400 Bad Request
-        std::cout << "HTTP parse error from " << conn->name() << std::endl;
-        conn->send("HTTP/1.1 400 Bad Request\r\n\r\n");
-        conn->shutdown();
+    // 已经升级成其他协议，数据不再按HTTP解析
+    if (context->upgraded()) {
+        context->upgrade().onMessage(conn, buf);
+        return;
+    }
+    
+    // 已经关闭了写端，后面的数据不再处理
+    if (context->timeoutPhase() == HttpContext::kLingerTimeout) {
+        buf->retrieveAll();
+        return;
+    }
+    
+    // 前面的请求还在工作线程里，数据先留在Buffer中，响应发出后再处理
+    // 流式业务回调正在接收的请求体例外：响应可能要等请求体收完才能完成
+    if (context->paused() && !context->bodyWriter()) {
         return;
     }
     
-    // 3. 检查是否解析完成
-    if (context->gotAll()) {
-        // 解析完成，处理HTTP请求
-        onRequest(conn, context->request());
+    // HTTP/2 prior knowledge：新连接的第一个请求之前就是连接前言
+    // 前言的前缀（"PRI * HTTP/2.0..."）不可能是合法的HTTP/1.1请求，收全之前先等待
+    if (http2_ && context->requestCount() == 0 && context->parsedBytes() == 0) {
+        int preface = Http2Connection::checkPreface(buf);
+        if (preface == 0) {
+            updateTimeout(conn, context, receiveTime);
+            return;
+        }
+        if (preface > 0) {
+            startHttp2(conn, context)->start(buf, receiveTime);
+            return;
+        }
+    }
+    
+    // 2. 循环解析Buffer中所有完整的请求（HTTP/1.1 pipelining）
+    // 客户端可能一次发来多个请求，只解析一个的话剩下的会一直留在Buffer里
+    // 这一次读到的所有响应按请求顺序追加到output，最后一次性发送
+    // output是连接复用的缓冲区，不用每次读都分配
+    Buffer& output = *context->output();
+    output.retrieveAll();
+    bool close = false;
+    while (!close) {
+        if (!context->parseRequest(buf, receiveTime)) {
+            // 解析失败，发送400 Bad Request（或者413、414、431这些超过上限的错误）
+            LOG_WARN << "HTTP parse error " << context->errorStatus() << " from " << conn->name();
+            HttpResponse response(true);
+            int status = context->errorStatus();
+            response.setStatusCode(status > 0 ? static_cast<HttpResponse::HttpStatusCode>(status)
+                                              : HttpResponse::k400BadRequest);
+            response.appendToBuffer(&output, receiveTime);
+            close = true;
+            if (context->bodyWriter()) {
+                endStreamingBody(conn, context, true);
+            }
+            break;
+        }
+        
+        // 客户端在等待100 Continue才发送请求体，前面的响应要一起立即发出去
+        if (context->takeExpectContinue()) {
+            output.append("HTTP/1.1 100 Continue\r\n\r\n");
+            conn->send(&output);
+        }
+        
+        // 流式业务回调：头部收完就交给业务，不等请求体
+        if (streamingHttpCallback_ && context->expectingBody() && !context->bodyWriter()) {
+            dispatchStreaming(conn, context);
+        }
+        
+        // 3. 检查是否解析完成，没解析完成就继续等待更多数据
+        if (!context->gotAll()) {
+            break;
+        }
+        
+        if (context->bodyWriter()) {
+            // 已经交给流式业务回调的请求：请求体收完了，响应由writer完成
+            endStreamingBody(conn, context, false);
+        } else {
+            // 解析完成，处理HTTP请求
+            // 请求直接引用buf里的数据，处理完之前不能retrieve
+            close = onRequest(conn, context, &output);
+        }
+        
+        // 取走请求数据并重置Context，为下一个请求做准备（HTTP/1.1 keep-alive）
+        context->finishRequest(buf);
         
-        // 重置Context，为下一个请求做准备（HTTP/1.1 keep-alive）
-        context->reset();
+        // 响应交给了工作线程，后面的请求等它完成后再处理
+        if (buf->readableBytes() == 0 || context->paused()) {
+            break;
+        }
+        
+        // 101之后的数据属于新协议（101已经在onRequest里发出）
+        if (context->upgraded()) {
+            context->upgrade().onMessage(conn, buf);
+            break;
+        }
+    }
+    
+    // 4. 合并发送，一次读事件最多一次write
+    if (output.readableBytes() > 0) {
+        conn->send(&output);
+    }
+    if (output.internalCapacity() > TcpConnection::kDefaultShrinkThreshold) {
+        output.shrink(0);  // 一次大响应之后不一直占着内存
+    }
+    
+    // 根据HTTP协议决定是否关闭连接（之后的请求不再处理）
+    if (close) {
+        shutdownConnection(conn, context);
+    } else {
+        updateTimeout(conn, context, receiveTime);
     }
-    // 如果没解析完成，继续等待更多数据
 }
 
-// 处理完整的HTTP请求
-void HttpServer::onRequest(const std::shared_ptr<TcpConnection>& conn,
-                          const HttpRequest& req) {
-    const std::string& connection = req.getHeader("Connection");
-    // HTTP/1.1默认keep-alive，HTTP/1.0默认close
-    bool close = (connection == "close" || 
-                  (req.version() == HttpRequest::kHttp10 && connection != "Keep-Alive"));
+// 处理完整的HTTP请求：响应追加到output，返回是否需要关闭连接
+bool HttpServer::onRequest(const std::shared_ptr<TcpConnection>& conn, HttpContext* context, Buffer* output) {
+    HttpRequest& req = context->request();
+    bool close = requestWantsClose(req);
+    
+    // 连接复用的响应对象（保留上一个请求的存储容量）
+    HttpResponse& response = context->response();
+    response.reset(close);
     
-    // 创建HTTP响应对象
-    HttpResponse response(close);
+    if (http2_ && Http2Connection::isUpgradeRequest(req)) {
+        // Upgrade: h2c：回复101，这个请求作为stream 1由Http2Connection处理
+        response.setStatusCode(HttpResponse::k101SwitchingProtocols);
+        response.addHeader("Connection", "Upgrade");
+        response.addHeader("Upgrade", "h2c");
+        response.setUpgrade([this, context](const std::shared_ptr<TcpConnection>& conn,
+                                            const HttpRequest& request) {
+            std::shared_ptr<Http2Connection> h2 = startHttp2(conn, context);
+            h2->startUpgrade(request, request.getHeader("HTTP2-Settings"));
+            return context->upgrade();
+        });
+    } else if (streamingHttpCallback_) {
+        // 没有请求体的请求也交给流式业务回调，请求体直接结束
+        dispatchStreaming(conn, context);
+        endStreamingBody(conn, context, false);
+        return false;
+    } else if (handlerOffload_ && workerPool_.running()) {
+        // 业务回调在工作线程执行
+        return dispatchAsync(conn, context, close, true, output);
+    } else if (!handleRequest(req, &response, static_cast<bool>(asyncHttpCallback_))) {
+        // 没有路由匹配，交给异步回调
+        return dispatchAsync(conn, context, close, false, output);
+    }
     
-    // 调用用户提供的业务回调
-    if (httpCallback_) {
-        httpCallback_(req, &response);
+    return sendResponse(conn, context, req, response, output);
+}
+
+// 响应生成之后：协议升级、压缩、序列化，文件响应体用sendfile
+bool HttpServer::sendResponse(const std::shared_ptr<TcpConnection>& conn, HttpContext* context,
+                              const HttpRequest& req, HttpResponse& response, Buffer* output) {
+    // 协议升级：先发出101（以及前面排队的响应），再把连接交给新协议
+    // 新协议的处理函数在请求数据被取走之前创建，可以读取请求的路径参数和头部
+    if (response.statusCode() == HttpResponse::k101SwitchingProtocols && response.upgradeCallback()) {
+        response.appendToBuffer(output, req.receiveTime());
+        conn->send(output);
+        context->setUpgrade(response.upgradeCallback()(conn, req));
+        return false;
+    }
+    
+    // 流式响应体：先发出头部，响应体由HttpResponseStream写入（不压缩）
+    if (response.hasStream()) {
+        return startStream(conn, context, req, response, output);
+    }
+    
+    // 压缩交给了工作线程：响应由onResponseReady发送
+    if (compressor_ && compressResponse(conn, req, &response)) {
+        context->setPaused(true);
+        return false;
+    }
+    
+    // 将HTTP响应转换为文本，和同一批的其他响应一起发送
+    response.appendToBuffer(output, req.receiveTime());
+    
+    // 文件响应体：头部和之前的响应先发出去，文件内容用sendfile直接从page cache发送
+    if (response.hasFileBody() && req.method() != HttpRequest::kHead) {
+        off_t offset = 0;
+        size_t length = 0;
+        int fd = response.releaseFileBody(&offset, &length);
+        conn->send(output);
+        conn->sendFile(fd, offset, length);
+    }
+    
+    // 根据HTTP协议决定是否关闭连接
+    return response.closeConnection();
+}
+
+bool HttpServer::startStream(const std::shared_ptr<TcpConnection>& conn, HttpContext* context,
+                             const HttpRequest& req, HttpResponse& response, Buffer* output) {
+    // HTTP/1.0不认识分块编码：长度未知时发完关闭连接
+    if (response.streamLength() < 0 && req.version() == HttpRequest::kHttp10) {
+        response.setCloseConnection(true);
+    }
+    bool close = response.closeConnection();
+    
+    // 头部和前面排队的响应先发出去，之后响应体直接写进连接
+    response.appendToBuffer(output, req.receiveTime());
+    conn->send(output);
+    
+    // HEAD请求以及不能带响应体的状态码：只有头部
+    int status = response.statusCode();
+    if (response.headOnly() || status < 200 || status == HttpResponse::k204NoContent
+        || status == HttpResponse::k304NotModified) {
+        return close;
+    }
+    
+    std::shared_ptr<HttpResponseStream> stream = std::make_shared<HttpResponseStream>(
+        conn, response.chunked(), response.streamLength(),
+        [this, close](const std::shared_ptr<TcpConnection>& conn, bool ok) {
+            onStreamFinished(conn, close || !ok);
+        });
+    
+    // 响应体发完之前不处理这个连接的后续请求
+    context->setStream(stream);
+    context->setPaused(true);
+    stream->start();
+    response.streamCallback()(stream);
+    return false;
+}
+
+// 流式响应体结束（finish()之后回到IO线程）
+void HttpServer::onStreamFinished(const std::shared_ptr<TcpConnection>& conn, bool close) {
+    HttpContext* context = conn->context<HttpContext>();
+    if (!context || !conn->connected()) {
+        return;
+    }
+    context->setStream(nullptr);
+    context->setPaused(false);
+    
+    // 长度不符或者以关闭连接结束的响应体：连接不能复用
+    if (close) {
+        shutdownConnection(conn, context);
+        return;
+    }
+    resumeRequests(conn, context);
+}
+
+// 暂停期间收到的请求（pipelining）
+void HttpServer::resumeRequests(const std::shared_ptr<TcpConnection>& conn, HttpContext* context) {
+    Buffer* input = conn->inputBuffer();
+    if (input->readableBytes() > 0) {
+        onMessage(conn, input, Timestamp::now());
+    } else {
+        updateTimeout(conn, context, Timestamp::now());
+    }
+}
+
+bool HttpServer::handleRequest(HttpRequest& req, HttpResponse* response, bool allowAsync) {
+    // 先查路由表，没有匹配的再交给用户的业务回调
+    if (router_.dispatch(&req, response)) {
+        // 已经由路由处理（包括405）
+    } else if (allowAsync) {
+        return false;
+    } else if (httpCallback_) {
+        httpCallback_(req, response);
     } else {
         // 没有设置回调，返回404
-        response.setStatusCode(HttpResponse::k404NotFound);
-        response.setStatusMessage("Not Found");
-        response.setCloseConnection(true);
+        response->setStatusCode(HttpResponse::k404NotFound);
+        response->setStatusMessage("Not Found");
+        response->setCloseConnection(true);
     }
     
-    // 将HTTP响应转换为文本并发送
-    Buffer buf;
-    response.appendToBuffer(&buf);
-    conn->send(&buf);
+    // HEAD请求只发送头部（Content-Length仍然是完整响应体的长度）
+    if (req.method() == HttpRequest::kHead) {
+        response->setHeadOnly(true);
+    }
+    return true;
+}
+
+bool HttpServer::dispatchAsync(const std::shared_ptr<TcpConnection>& conn, HttpContext* context,
+                               bool close, bool offload, Buffer* output) {
+    // 请求拷贝到writer里：之后IO线程继续读数据，Buffer里的请求会被取走
+    HttpResponseWriterPtr writer = std::make_shared<HttpResponseWriter>(
+        conn, *context, close, [this](const std::shared_ptr<TcpConnection>& conn, HttpResponseWriter* writer) {
+            onAsyncResponse(conn, writer);
+        });
+    
+    // 响应发出之前不处理这个连接的后续请求，保证响应顺序
+    context->setPaused(true);
+    if (!offload) {
+        asyncHttpCallback_(writer->request(), writer);
+        return false;
+    }
+    if (workerPool_.run([this, writer]() { runHandler(writer); })) {
+        return false;
+    }
+    
+    // 工作线程的队列满了：直接回复503，不让排队无限增长
+    context->setPaused(false);
+    writer->discard();
+    HttpResponse& response = context->response();
+    response.setStatusCode(HttpResponse::k503ServiceUnavailable);
+    response.addHeader("Retry-After", "1");
+    response.appendToBuffer(output, context->request().receiveTime());
+    return response.closeConnection();
+}
+
+void HttpServer::dispatchStreaming(const std::shared_ptr<TcpConnection>& conn, HttpContext* context) {
+    // 流式接收模式下头部已经拷贝出来了，writer拷贝的只是头部
+    HttpResponseWriterPtr writer = std::make_shared<HttpResponseWriter>(
+        conn, *context, requestWantsClose(context->request()),
+        [this](const std::shared_ptr<TcpConnection>& conn, HttpResponseWriter* writer) {
+            onAsyncResponse(conn, writer);
+        });
+    
+    // 响应完成之前不处理后面的请求，但这个请求的请求体照常解析
+    context->setBodyWriter(writer);
+    context->setPaused(true);
+    streamingHttpCallback_(writer->request(), writer);
+}
+
+void HttpServer::endStreamingBody(const std::shared_ptr<TcpConnection>& conn, HttpContext* context,
+                                  bool aborted) {
+    HttpResponseWriterPtr writer = context->bodyWriter();
+    context->setBodyWriter(nullptr);
+    writer->endBody(aborted);
+    
+    // 业务在最后一段请求体时暂停了读：请求体已经结束，后面的请求还要从连接读
+    if (!aborted) {
+        conn->startRead();
+    }
+}
+
+// 在工作线程执行：路由 -> 异步回调 -> 业务回调 -> 404
+void HttpServer::runHandler(const HttpResponseWriterPtr& writer) {
+    HttpRequest& req = writer->request();
+    HttpResponse* response = writer->response();
+    if (router_.dispatch(&req, response)) {
+        // 已经由路由处理（包括405）
+    } else if (asyncHttpCallback_) {
+        asyncHttpCallback_(req, writer);
+        return;
+    } else if (httpCallback_) {
+        httpCallback_(req, response);
+    } else {
+        response->setStatusCode(HttpResponse::k404NotFound);
+        response->setStatusMessage("Not Found");
+        response->setCloseConnection(true);
+    }
+    writer->send();
+}
+
+// writer->send()之后回到IO线程：发送响应，继续处理暂停期间收到的请求
+void HttpServer::onAsyncResponse(const std::shared_ptr<TcpConnection>& conn, HttpResponseWriter* writer) {
+    HttpContext* context = conn->context<HttpContext>();
+    if (!context || !conn->connected()) {
+        return;
+    }
+    context->setPaused(false);
+    
+    Buffer& output = *context->output();
+    output.retrieveAll();
+    bool close = true;
+    if (writer) {
+        close = sendResponse(conn, context, writer->request(), *writer->response(), &output);
+    } else {
+        HttpResponse response(true);
+        response.setStatusCode(HttpResponse::k500InternalServerError);
+        response.appendToBuffer(&output, Timestamp::now());
+    }
+    if (output.readableBytes() > 0) {
+        conn->send(&output);
+    }
+    
+    if (close) {
+        shutdownConnection(conn, context);
+        return;
+    }
+    
+    // 压缩又交给了工作线程，或者开始了流式响应体，等它完成
+    if (context->paused()) {
+        return;
+    }
+    resumeRequests(conn, context);
+}
+
+void HttpServer::handleHttp2Request(HttpRequest& req, HttpResponse* response) {
+    handleRequest(req, response);
+    if (response->hasStream()) {
+        // 流式响应体只支持HTTP/1.x（HTTP/2的DATA帧由Http2Connection统一分帧和流控）
+        LOG_ERROR << "Streaming response is not supported over HTTP/2: " << req.path().as_string();
+        response->reset(false);
+        response->setStatusCode(HttpResponse::k500InternalServerError);
+        return;
+    }
+    if (compressor_) {
+        HttpCompressor::Encoding encoding = compressor_->select(req, response);
+        if (encoding != HttpCompressor::kIdentity && !compressor_->applyCached(encoding, response)) {
+            compressor_->compressResponse(encoding, response);
+        }
+    }
+}
+
+std::shared_ptr<Http2Connection> HttpServer::startHttp2(const std::shared_ptr<TcpConnection>& conn,
+                                                        HttpContext* context) {
+    std::shared_ptr<Http2Connection> h2 = std::make_shared<Http2Connection>(
+        conn, [this](HttpRequest& req, HttpResponse* response) {
+            handleHttp2Request(req, response);
+        }, maxBodySize_);
+    
+    // Http2Connection只持有连接的weak_ptr，连接（context）持有它，没有循环引用
+    HttpResponse::Upgrade upgrade;
+    upgrade.onMessage = [h2](const std::shared_ptr<TcpConnection>&, Buffer* buf) {
+        h2->handleData(buf, Timestamp::now());
+    };
+    context->setUpgrade(upgrade);
+    return h2;
+}
+
+bool HttpServer::compressResponse(const std::shared_ptr<TcpConnection>& conn, const HttpRequest& req,
+                                  HttpResponse* response) {
+    HttpCompressor::Encoding encoding = compressor_->select(req, response);
+    if (encoding == HttpCompressor::kIdentity) {
+        return false;
+    }
+    
+    // 1. 缓存命中（静态文件、重复的响应）：只是换一下响应体
+    if (compressor_->applyCached(encoding, response)) {
+        return false;
+    }
+    
+    // 2. 小响应体直接压缩，来回切线程的开销比压缩本身还大
+    if (response->body().size() < offloadSize_ || !workerPool_.running()) {
+        compressor_->compressResponse(encoding, response);
+        return false;
+    }
+    
+    // 3. 大响应体交给工作线程，完成后回到连接所在的loop发送
+    // std::function要求可拷贝，响应用shared_ptr包起来；连接可能先断开，只持有weak_ptr
+    std::shared_ptr<HttpResponse> pending = std::make_shared<HttpResponse>(std::move(*response));
+    std::weak_ptr<TcpConnection> weakConn(conn);
+    EventLoop* loop = conn->getLoop();
+    Timestamp receiveTime = req.receiveTime();
+    bool queued = workerPool_.run([this, pending, weakConn, loop, encoding, receiveTime] {
+        compressor_->compressResponse(encoding, pending.get());
+        loop->queueInLoop([this, pending, weakConn, receiveTime] {
+            std::shared_ptr<TcpConnection> conn = weakConn.lock();
+            if (conn) {
+                onResponseReady(conn, *pending, receiveTime);
+            }
+        });
+    });
+    if (!queued) {
+        // 队列满了：在IO线程压缩
+        *response = std::move(*pending);
+        compressor_->compressResponse(encoding, response);
+    }
+    return queued;
+}
+
+// 在连接所在的IO线程调用
+void HttpServer::onResponseReady(const std::shared_ptr<TcpConnection>& conn,
+                                 const HttpResponse& response,
+                                 Timestamp receiveTime) {
+    HttpContext* context = conn->context<HttpContext>();
+    if (!context || !conn->connected()) {
+        return;
+    }
+    
+    Buffer output;
+    response.appendToBuffer(&output, receiveTime);
+    conn->send(&output);
+    context->setPaused(false);
     
-    // 根据HTTP协议决定是否关闭连接
     if (response.closeConnection()) {
-        conn->shutdown();
+        shutdownConnection(conn, context);
+        return;
+    }
+    resumeRequests(conn, context);
+}
+
+void HttpServer::updateTimeout(const std::shared_ptr<TcpConnection>& conn, HttpContext* context,
+                               Timestamp now) {
+    HttpContext::TimeoutPhase phase = context->timeoutPhase();
+    if (phase == HttpContext::kLingerTimeout) {
+        return;
+    }
+    
+    // 升级后的协议自己管理连接；等待工作线程时客户端没有责任（流式接收的请求体除外）
+    if (context->upgraded() || (context->paused() && !context->bodyWriter())) {
+        context->setTimeout(HttpContext::kNoTimeout, Timestamp());
+        return;
+    }
+    
+    double timeout = 0;
+    if (context->expectingBody()) {
+        // 请求体：每次收到数据都重新计时
+        phase = HttpContext::kBodyTimeout;
+        timeout = bodyTimeout_;
+    } else if (conn->inputBuffer()->readableBytes() > 0 || context->requestCount() == 0) {
+        // 头部：从第一个字节开始计时，之后收到数据不延长
+        if (phase == HttpContext::kHeaderTimeout) {
+            return;
+        }
+        phase = HttpContext::kHeaderTimeout;
+        timeout = headerTimeout_;
+    } else {
+        // 空闲：从上一个请求处理完开始计时
+        if (phase == HttpContext::kIdleTimeout) {
+            return;
+        }
+        phase = HttpContext::kIdleTimeout;
+        timeout = idleTimeout_;
+    }
+    
+    if (timeout <= 0) {
+        context->setTimeout(HttpContext::kNoTimeout, Timestamp());
+        return;
+    }
+    context->setTimeout(phase, addTime(now, timeout));
+    armTimer(conn, context);
+}
+
+void HttpServer::armTimer(const std::shared_ptr<TcpConnection>& conn, HttpContext* context) {
+    // 已经有一个不晚于deadline的定时器（最常见的情况：空闲期间deadline只会往后推）
+    Timestamp expiry = context->timerExpiry();
+    if (expiry.microSecondsSinceEpoch() != 0 && !(context->deadline() < expiry)) {
+        return;
     }
-}
\ No newline at end of file
+    expiry = context->deadline();
+    context->setTimerExpiry(expiry);
+    
+    // 用weak_ptr，定时器不延长连接的生命周期
+    std::weak_ptr<TcpConnection> weakConn(conn);
+    conn->getLoop()->runAt(expiry, [this, weakConn, expiry]() {
+        std::shared_ptr<TcpConnection> conn = weakConn.lock();
+        if (conn) {
+            onTimeout(conn, expiry);
+        }
+    });
+}
+
+void HttpServer::onTimeout(const std::shared_ptr<TcpConnection>& conn, Timestamp expiry) {
+    HttpContext* context = conn->context<HttpContext>();
+    if (!context || !(context->timerExpiry() == expiry)) {
+        return;
+    }
+    context->setTimerExpiry(Timestamp());
+    
+    HttpContext::TimeoutPhase phase = context->timeoutPhase();
+    if (phase == HttpContext::kNoTimeout || context->upgraded()) {
+        return;
+    }
+    
+    // 期间有新的活动，deadline往后推了
+    Timestamp now = Timestamp::now();
+    if (now < context->deadline()) {
+        armTimer(conn, context);
+        return;
+    }
+    
+    // 业务暂停了读请求体（下游消费不过来），不是客户端慢
+    if (phase == HttpContext::kBodyTimeout && !conn->isReading()) {
+        context->setTimeout(phase, addTime(now, bodyTimeout_));
+        armTimer(conn, context);
+        return;
+    }
+    
+    if (phase == HttpContext::kIdleTimeout || phase == HttpContext::kLingerTimeout) {
+        // 响应还没发完（对方读得慢）不算空闲
+        if (conn->hasPendingOutput()) {
+            double timeout = phase == HttpContext::kIdleTimeout ? idleTimeout_ : kLingerTime;
+            context->setTimeout(phase, addTime(now, timeout));
+            armTimer(conn, context);
+            return;
+        }
+        LOG_DEBUG << "HTTP connection " << conn->name() << " idle timeout";
+        conn->forceClose();
+    } else if (phase == HttpContext::kHeaderTimeout && conn->inputBuffer()->readableBytes() == 0) {
+        // 连上之后一个字节也没发：没有请求可以回复
+        LOG_DEBUG << "HTTP connection " << conn->name() << " sent nothing";
+        conn->forceClose();
+    } else {
+        LOG_INFO << "HTTP request timeout from " << conn->name();
+        Buffer output;
+        HttpResponse response(true);
+        response.setStatusCode(HttpResponse::k408RequestTimeout);
+        response.appendToBuffer(&output, now);
+        conn->send(&output);
+        shutdownConnection(conn, context);
+    }
+}
+
+void HttpServer::shutdownConnection(const std::shared_ptr<TcpConnection>& conn, HttpContext* context) {
+    conn->shutdown();
+    context->setTimeout(HttpContext::kLingerTimeout, addTime(Timestamp::now(), kLingerTime));
+    armTimer(conn, context);
+}
@@ -0,0 +1,493 @@
+#include "StaticFileHandler.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "../logger/Logger.h"
+#include <algorithm>  // for std::find
+#include <cerrno>
+#include <cstdio>     // for snprintf
+#include <cstring>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+const size_t StaticFileHandler::kDefaultMaxCachedFileSize;
+const size_t StaticFileHandler::kDefaultCacheCapacity;
+
+// 缓存的文件：内容和用来校验的元数据，创建后不再修改
+struct StaticFileHandler::CacheEntry {
+    std::shared_ptr<const std::string> content;
+    off_t size;
+    ino_t inode;
+    struct timespec mtime;
+    std::string etag;
+    std::string lastModified;
+};
+
+namespace {
+
+struct MimeEntry {
+    const char* extension;
+    const char* type;
+};
+
+const MimeEntry kMimeTypes[] = {
+    {"html", "text/html; charset=utf-8"},
+    {"htm", "text/html; charset=utf-8"},
+    {"css", "text/css; charset=utf-8"},
+    {"js", "application/javascript; charset=utf-8"},
+    {"mjs", "application/javascript; charset=utf-8"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"txt", "text/plain; charset=utf-8"},
+    {"xml", "application/xml"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"ico", "image/x-icon"},
+    {"wasm", "application/wasm"},
+    {"pdf", "application/pdf"},
+    {"zip", "application/zip"},
+    {"gz", "application/gzip"},
+    {"mp3", "audio/mpeg"},
+    {"mp4", "video/mp4"},
+    {"webm", "video/webm"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"otf", "font/otf"},
+};
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 和nginx一样用mtime和大小生成ETag
+std::string makeETag(const struct stat& st) {
+    char buf[64];
+    snprintf(buf, sizeof buf, "\"%lx-%lx\"",
+             static_cast<unsigned long>(st.st_mtime), static_cast<unsigned long>(st.st_size));
+    return buf;
+}
+
+std::string formatHttpDate(time_t t) {
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    char buf[64];
+    size_t n = strftime(buf, sizeof buf, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    return std::string(buf, n);
+}
+
+// 解析IMF-fixdate，失败返回-1
+time_t parseHttpDate(StringPiece value) {
+    std::string str = value.as_string();
+    struct tm tm;
+    memset(&tm, 0, sizeof tm);
+    const char* end = strptime(str.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (!end || *end != '\0') {
+        return -1;
+    }
+    return timegm(&tm);
+}
+
+// If-None-Match: "a", W/"b", *
+bool etagMatches(StringPiece header, const std::string& etag) {
+    const char* p = header.begin();
+    while (p < header.end()) {
+        while (p < header.end() && (*p == ' ' || *p == ',')) {
+            ++p;
+        }
+        const char* start = p;
+        while (p < header.end() && *p != ',') {
+            ++p;
+        }
+        StringPiece tag(start, p);
+        while (!tag.empty() && tag[tag.size() - 1] == ' ') {
+            tag.remove_suffix(1);
+        }
+        if (tag.starts_with("W/")) {
+            tag.remove_prefix(2);  // 弱比较
+        }
+        if (tag == "*" || tag == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 解析单个Range：bytes=a-b、bytes=a-、bytes=-n
+// 返回1表示有效，0表示格式不支持（忽略Range返回整个文件），-1表示超出范围（416）
+int parseRange(StringPiece header, off_t size, off_t* first, off_t* last) {
+    if (!header.starts_with("bytes=")) {
+        return 0;
+    }
+    header.remove_prefix(6);
+    const char* p = header.begin();
+    const char* end = header.end();
+    if (std::find(p, end, ',') != end) {
+        return 0;  // 多个范围需要multipart响应，直接返回整个文件（RFC 7233允许）
+    }
+    
+    auto parseNumber = [&p, end](off_t* value) {
+        const char* start = p;
+        *value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (*value > (static_cast<off_t>(1) << 60)) {
+                return false;
+            }
+            *value = *value * 10 + (*p - '0');
+            ++p;
+        }
+        return p != start;
+    };
+    
+    off_t a = 0;
+    off_t b = 0;
+    bool hasFirst = parseNumber(&a);
+    if (p == end || *p != '-') {
+        return 0;
+    }
+    ++p;
+    bool hasLast = parseNumber(&b);
+    if (p != end || (!hasFirst && !hasLast)) {
+        return 0;
+    }
+    
+    if (!hasFirst) {
+        // 最后b个字节
+        if (b == 0) {
+            return -1;
+        }
+        *first = b >= size ? 0 : size - b;
+        *last = size - 1;
+    } else {
+        if (a >= size) {
+            return -1;
+        }
+        if (hasLast && b < a) {
+            return 0;
+        }
+        *first = a;
+        *last = (!hasLast || b >= size) ? size - 1 : b;
+    }
+    return 1;
+}
+
+// 读取整个文件（小文件进缓存用）
+bool readFile(int fd, size_t size, std::string* content) {
+    content->resize(size);
+    size_t got = 0;
+    while (got < size) {
+        ssize_t n = ::pread(fd, &(*content)[got], size - got, static_cast<off_t>(got));
+        if (n <= 0) {
+            return false;
+        }
+        got += n;
+    }
+    return true;
+}
+
+bool sameFile(const struct stat& st, off_t size, ino_t inode, const struct timespec& mtime) {
+    return st.st_size == size && st.st_ino == inode
+        && st.st_mtim.tv_sec == mtime.tv_sec && st.st_mtim.tv_nsec == mtime.tv_nsec;
+}
+
+}  // namespace
+
+StaticFileHandler::StaticFileHandler(const std::string& root)
+    : root_(root),
+      maxCachedFileSize_(kDefaultMaxCachedFileSize),
+      cacheCapacity_(kDefaultCacheCapacity),
+      cachedBytes_(0),
+      hits_(0),
+      misses_(0)
+{
+    while (root_.size() > 1 && root_.back() == '/') {
+        root_.pop_back();
+    }
+}
+
+StaticFileHandler::~StaticFileHandler() {
+}
+
+void StaticFileHandler::setCacheCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cacheCapacity_ = capacity;
+    evict();
+}
+
+HttpRouter::Handler StaticFileHandler::handler(const std::string& param) {
+    return [this, param](const HttpRequest& req, HttpResponse* resp) {
+        serve(req, req.param(param), resp);
+    };
+}
+
+const char* StaticFileHandler::mimeType(StringPiece path) {
+    const char* dot = nullptr;
+    for (const char* p = path.end(); p > path.begin(); --p) {
+        if (p[-1] == '.') {
+            dot = p;
+            break;
+        }
+        if (p[-1] == '/') {
+            break;
+        }
+    }
+    if (dot) {
+        StringPiece ext(dot, path.end());
+        for (const MimeEntry& mime : kMimeTypes) {
+            if (ext.equalsIgnoreCase(mime.extension)) {
+                return mime.type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+// 百分号解码，按'/'分段检查：不允许..和空字符
+bool StaticFileHandler::resolvePath(StringPiece path, std::string* fsPath) const {
+    std::string decoded;
+    decoded.reserve(path.size());
+    for (size_t i = 0; i < path.size(); ++i) {
+        char c = path[i];
+        if (c == '%') {
+            if (i + 2 >= path.size()) {
+                return false;
+            }
+            int hi = hexValue(path[i + 1]);
+            int lo = hexValue(path[i + 2]);
+            if (hi < 0 || lo < 0) {
+                return false;
+            }
+            c = static_cast<char>(hi * 16 + lo);
+            i += 2;
+        }
+        if (c == '\0') {
+            return false;
+        }
+        decoded.push_back(c);
+    }
+    
+    fsPath->assign(root_);
+    size_t pos = 0;
+    while (pos <= decoded.size()) {
+        size_t slash = decoded.find('/', pos);
+        if (slash == std::string::npos) {
+            slash = decoded.size();
+        }
+        StringPiece segment(decoded.data() + pos, slash - pos);
+        if (segment == "..") {
+            return false;
+        }
+        if (!segment.empty() && segment != ".") {
+            fsPath->push_back('/');
+            fsPath->append(segment.data(), segment.size());
+        }
+        pos = slash + 1;
+    }
+    // 目录（包括根目录）使用index.html
+    if (decoded.empty() || decoded.back() == '/') {
+        fsPath->append("/index.html");
+    }
+    return true;
+}
+
+void StaticFileHandler::serve(const HttpRequest& req, StringPiece path, HttpResponse* resp) {
+    std::string fsPath;
+    if (!resolvePath(path, &fsPath)) {
+        resp->setStatusCode(HttpResponse::k400BadRequest);
+        return;
+    }
+    
+    struct stat st;
+    if (::stat(fsPath.c_str(), &st) != 0) {
+        st.st_mode = 0;
+    } else if (S_ISDIR(st.st_mode)) {
+        fsPath.append("/index.html");
+        if (::stat(fsPath.c_str(), &st) != 0) {
+            st.st_mode = 0;
+        }
+    }
+    if (!S_ISREG(st.st_mode)) {
+        resp->setStatusCode(HttpResponse::k404NotFound);
+        resp->setBody("Not Found\n");
+        return;
+    }
+    
+    // 1. 小文件先查缓存，命中就不需要打开文件
+    bool cacheable = static_cast<size_t>(st.st_size) <= maxCachedFileSize_;
+    EntryPtr entry;
+    int fd = -1;
+    if (cacheable) {
+        entry = lookup(fsPath, st);
+    }
+    if (!entry) {
+        fd = ::open(fsPath.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0 || ::fstat(fd, &st) != 0) {
+            int savedErrno = errno;
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            resp->setStatusCode(savedErrno == EACCES ? HttpResponse::k403Forbidden
+                                                     : HttpResponse::k404NotFound);
+            return;
+        }
+        cacheable = static_cast<size_t>(st.st_size) <= maxCachedFileSize_;
+        if (cacheable) {
+            // 读进缓存，之后这个fd就不需要了
+            std::shared_ptr<CacheEntry> fresh = std::make_shared<CacheEntry>();
+            std::shared_ptr<std::string> content = std::make_shared<std::string>();
+            bool ok = readFile(fd, static_cast<size_t>(st.st_size), content.get());
+            ::close(fd);
+            fd = -1;
+            if (!ok) {
+                LOG_ERROR << "StaticFileHandler: failed to read " << fsPath;
+                resp->setStatusCode(HttpResponse::k500InternalServerError);
+                return;
+            }
+            fresh->content = content;
+            fresh->size = st.st_size;
+            fresh->inode = st.st_ino;
+            fresh->mtime = st.st_mtim;
+            fresh->etag = makeETag(st);
+            fresh->lastModified = formatHttpDate(st.st_mtime);
+            entry = fresh;
+            insert(fsPath, entry);
+        }
+    }
+    
+    std::string etag = entry ? entry->etag : makeETag(st);
+    std::string lastModified = entry ? entry->lastModified : formatHttpDate(st.st_mtime);
+    resp->addHeader("Content-Type", mimeType(fsPath));
+    resp->addHeader("ETag", etag);
+    resp->addHeader("Last-Modified", lastModified);
+    resp->addHeader("Accept-Ranges", "bytes");
+    
+    // 2. 条件请求：If-None-Match优先于If-Modified-Since
+    StringPiece ifNoneMatch = req.getHeader("If-None-Match");
+    bool notModified = false;
+    if (!ifNoneMatch.empty()) {
+        notModified = etagMatches(ifNoneMatch, etag);
+    } else {
+        StringPiece ifModifiedSince = req.getHeader("If-Modified-Since");
+        if (!ifModifiedSince.empty()) {
+            time_t since = parseHttpDate(ifModifiedSince);
+            notModified = since >= 0 && st.st_mtime <= since;
+        }
+    }
+    if (notModified) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        resp->setStatusCode(HttpResponse::k304NotModified);
+        return;
+    }
+    
+    // 3. Range：If-Range和当前版本不一致时忽略Range，返回整个文件
+    off_t first = 0;
+    off_t last = st.st_size - 1;
+    bool partial = false;
+    StringPiece range = req.getHeader("Range");
+    StringPiece ifRange = req.getHeader("If-Range");
+    if (!range.empty() && (ifRange.empty() || ifRange == etag || ifRange == lastModified)) {
+        int result = parseRange(range, st.st_size, &first, &last);
+        if (result < 0) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            resp->setStatusCode(HttpResponse::k416RangeNotSatisfiable);
+            resp->addHeader("Content-Range", "bytes */" + std::to_string(st.st_size));
+            return;
+        }
+        partial = result > 0;
+        if (partial) {
+            resp->setStatusCode(HttpResponse::k206PartialContent);
+            resp->addHeader("Content-Range", "bytes " + std::to_string(first) + "-" +
+                            std::to_string(last) + "/" + std::to_string(st.st_size));
+        }
+    }
+    if (!partial) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        first = 0;
+        last = st.st_size - 1;
+    }
+    
+    // 4. 响应体：缓存直接引用，不拷贝；大文件交给sendfile
+    size_t length = static_cast<size_t>(last - first + 1);
+    if (entry) {
+        resp->setBody(entry->content, static_cast<size_t>(first), length);
+    } else {
+        resp->setFileBody(fd, first, length);
+    }
+}
+
+StaticFileHandler::EntryPtr StaticFileHandler::lookup(const std::string& fsPath, const struct stat& st) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = cache_.find(fsPath);
+    if (it == cache_.end()) {
+        ++misses_;
+        return EntryPtr();
+    }
+    const EntryPtr& entry = it->second.entry;
+    if (!sameFile(st, entry->size, entry->inode, entry->mtime)) {
+        // 文件被修改过：丢掉旧内容，由调用者重新读取
+        cachedBytes_ -= entry->content->size();
+        lru_.erase(it->second.pos);
+        cache_.erase(it);
+        ++misses_;
+        return EntryPtr();
+    }
+    // 移到LRU链表头部
+    lru_.splice(lru_.begin(), lru_, it->second.pos);
+    ++hits_;
+    return entry;
+}
+
+void StaticFileHandler::insert(const std::string& fsPath, const EntryPtr& entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entry->content->size() > cacheCapacity_) {
+        return;
+    }
+    auto it = cache_.find(fsPath);
+    if (it != cache_.end()) {
+        // 另一个线程同时读了同一个文件
+        cachedBytes_ -= it->second.entry->content->size();
+        it->second.entry = entry;
+        lru_.splice(lru_.begin(), lru_, it->second.pos);
+    } else {
+        lru_.push_front(fsPath);
+        cache_[fsPath] = Slot{entry, lru_.begin()};
+    }
+    cachedBytes_ += entry->content->size();
+    evict();
+}
+
+// 淘汰最久没有使用的文件，调用时必须持有mutex_
+void StaticFileHandler::evict() {
+    while (cachedBytes_ > cacheCapacity_ && !lru_.empty()) {
+        auto it = cache_.find(lru_.back());
+        cachedBytes_ -= it->second.entry->content->size();
+        cache_.erase(it);
+        lru_.pop_back();
+    }
+}
+
+size_t StaticFileHandler::cacheHits() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return hits_;
+}
+
+size_t StaticFileHandler::cacheMisses() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return misses_;
+}
+
+size_t StaticFileHandler::cachedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return cachedBytes_;
+}
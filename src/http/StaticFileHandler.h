@@ -0,0 +1,91 @@
+#ifndef TINY_NETWORK_HTTP_STATICFILEHANDLER_H
+#define TINY_NETWORK_HTTP_STATICFILEHANDLER_H
+
+#include "../base/noncopyable.h"
+#include "../base/StringPiece.h"
+#include "HttpRouter.h"
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <sys/stat.h>
+
+class HttpRequest;
+class HttpResponse;
+
+// StaticFileHandler：把一个目录作为静态文件对外提供
+//
+// 用法：
+//   StaticFileHandler files("/var/www");
+//   server.router().GET("/static/*file", files.handler("file"));
+//
+// 功能：
+// 1. 根据扩展名设置Content-Type
+// 2. ETag/Last-Modified，If-None-Match/If-Modified-Since命中时返回304
+// 3. 单个Range请求（bytes=a-b、bytes=a-、bytes=-n），返回206/416
+// 4. 小文件放在LRU缓存里，每次请求stat一次，mtime/大小/inode变了就重新读取
+// 5. 大文件不读进内存，由TcpConnection::sendFile发送
+//
+// 多个IO线程共享同一个handler，缓存用互斥锁保护（读文件时不持有锁）
+class StaticFileHandler : noncopyable {
+public:
+    // 默认：64KB以下的文件进缓存，缓存总共最多64MB
+    static const size_t kDefaultMaxCachedFileSize = 64 * 1024;
+    static const size_t kDefaultCacheCapacity = 64 * 1024 * 1024;
+    
+    explicit StaticFileHandler(const std::string& root);
+    ~StaticFileHandler();
+    
+    // 超过这个大小的文件用sendfile发送（0表示不使用缓存）
+    void setMaxCachedFileSize(size_t size) {
+        maxCachedFileSize_ = size;
+    }
+    
+    // 缓存的总字节数上限，超过后淘汰最久没有使用的文件
+    void setCacheCapacity(size_t capacity);
+    
+    // 处理请求，path是相对于根目录的路径（未解码）
+    void serve(const HttpRequest& req, StringPiece path, HttpResponse* resp);
+    
+    // 生成路由处理函数，相对路径取自路由参数param
+    // handler持有this，StaticFileHandler必须比服务器活得久
+    HttpRouter::Handler handler(const std::string& param);
+    
+    // 根据扩展名返回MIME类型，未知类型返回application/octet-stream
+    static const char* mimeType(StringPiece path);
+    
+    // === 统计 ===
+    size_t cacheHits() const;
+    size_t cacheMisses() const;
+    size_t cachedBytes() const;
+
+private:
+    struct CacheEntry;
+    using EntryPtr = std::shared_ptr<const CacheEntry>;
+    
+    // 解码并检查路径，拒绝..等跳出根目录的路径
+    bool resolvePath(StringPiece path, std::string* fsPath) const;
+    
+    // 文件没有变化时返回缓存
+    EntryPtr lookup(const std::string& fsPath, const struct stat& st);
+    void insert(const std::string& fsPath, const EntryPtr& entry);
+    void evict();
+    
+    std::string root_;                  // 根目录（不带结尾的/）
+    size_t maxCachedFileSize_;          // 进缓存的文件大小上限
+    size_t cacheCapacity_;              // 缓存总字节数上限
+    
+    mutable std::mutex mutex_;
+    std::list<std::string> lru_;        // 最近使用的在前面
+    struct Slot {
+        EntryPtr entry;
+        std::list<std::string>::iterator pos;
+    };
+    std::unordered_map<std::string, Slot> cache_;
+    size_t cachedBytes_;
+    size_t hits_;
+    size_t misses_;
+};
+
+#endif
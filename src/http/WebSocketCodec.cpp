@@ -0,0 +1,302 @@
+#include "WebSocketCodec.h"
+#include "../net/Buffer.h"
+#include <cstring>      // for memcpy
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// 写帧头，返回长度
+size_t writeHeader(char* p, int opcode, size_t payloadSize, bool fin, const char* mask) {
+    size_t n = 0;
+    p[n++] = static_cast<char>((fin ? 0x80 : 0) | (opcode & 0x0F));
+    char maskBit = mask ? static_cast<char>(0x80) : 0;
+    if (payloadSize < 126) {
+        p[n++] = static_cast<char>(maskBit | payloadSize);
+    } else if (payloadSize <= 0xFFFF) {
+        p[n++] = static_cast<char>(maskBit | 126);
+        p[n++] = static_cast<char>(payloadSize >> 8);
+        p[n++] = static_cast<char>(payloadSize);
+    } else {
+        p[n++] = static_cast<char>(maskBit | 127);
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            p[n++] = static_cast<char>(static_cast<uint64_t>(payloadSize) >> shift);
+        }
+    }
+    if (mask) {
+        memcpy(p + n, mask, 4);
+        n += 4;
+    }
+    return n;
+}
+
+// === SHA-1（只用于握手，不追求速度） ===
+
+inline uint32_t rotl(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+void sha1Block(uint32_t h[5], const unsigned char* block) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (static_cast<uint32_t>(block[i * 4]) << 24) | (block[i * 4 + 1] << 16)
+             | (block[i * 4 + 2] << 8) | block[i * 4 + 3];
+    }
+    for (int i = 16; i < 80; ++i) {
+        w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; ++i) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t t = rotl(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotl(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+void sha1(const std::string& input, unsigned char digest[20]) {
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    
+    // 补位：0x80，0...，64位的比特长度
+    std::string msg = input;
+    uint64_t bits = static_cast<uint64_t>(input.size()) * 8;
+    msg.push_back(static_cast<char>(0x80));
+    while (msg.size() % 64 != 56) {
+        msg.push_back('\0');
+    }
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        msg.push_back(static_cast<char>(bits >> shift));
+    }
+    
+    for (size_t i = 0; i < msg.size(); i += 64) {
+        sha1Block(h, reinterpret_cast<const unsigned char*>(msg.data() + i));
+    }
+    for (int i = 0; i < 5; ++i) {
+        digest[i * 4] = static_cast<unsigned char>(h[i] >> 24);
+        digest[i * 4 + 1] = static_cast<unsigned char>(h[i] >> 16);
+        digest[i * 4 + 2] = static_cast<unsigned char>(h[i] >> 8);
+        digest[i * 4 + 3] = static_cast<unsigned char>(h[i]);
+    }
+}
+
+std::string base64(const unsigned char* data, size_t len) {
+    static const char kTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((len + 2) / 3 * 4);
+    for (size_t i = 0; i < len; i += 3) {
+        uint32_t v = data[i] << 16;
+        if (i + 1 < len) v |= data[i + 1] << 8;
+        if (i + 2 < len) v |= data[i + 2];
+        out.push_back(kTable[(v >> 18) & 0x3F]);
+        out.push_back(kTable[(v >> 12) & 0x3F]);
+        out.push_back(i + 1 < len ? kTable[(v >> 6) & 0x3F] : '=');
+        out.push_back(i + 2 < len ? kTable[v & 0x3F] : '=');
+    }
+    return out;
+}
+
+}  // namespace
+
+WebSocketCodec::ParseResult WebSocketCodec::parseHeader(const char* data, size_t len,
+                                                        FrameHeader* header) {
+    if (len < 2) {
+        return kIncomplete;
+    }
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    if (p[0] & 0x70) {
+        return kError;  // 没有协商扩展，RSV1~3必须为0
+    }
+    header->fin = (p[0] & 0x80) != 0;
+    header->opcode = p[0] & 0x0F;
+    header->masked = (p[1] & 0x80) != 0;
+    
+    uint64_t payloadSize = p[1] & 0x7F;
+    size_t n = 2;
+    if (payloadSize == 126) {
+        if (len < 4) {
+            return kIncomplete;
+        }
+        payloadSize = (p[2] << 8) | p[3];
+        if (payloadSize < 126) {
+            return kError;  // 必须使用最短的长度编码
+        }
+        n = 4;
+    } else if (payloadSize == 127) {
+        if (len < 10) {
+            return kIncomplete;
+        }
+        payloadSize = 0;
+        for (int i = 2; i < 10; ++i) {
+            payloadSize = (payloadSize << 8) | p[i];
+        }
+        if (payloadSize <= 0xFFFF || (payloadSize >> 63)) {
+            return kError;
+        }
+        n = 10;
+    }
+    
+    if (header->masked) {
+        if (len < n + 4) {
+            return kIncomplete;
+        }
+        memcpy(header->mask, data + n, 4);
+        n += 4;
+    }
+    header->headerSize = n;
+    header->payloadSize = payloadSize;
+    return kOk;
+}
+
+size_t WebSocketCodec::headerSize(size_t payloadSize, bool masked) {
+    size_t n = payloadSize < 126 ? 2 : (payloadSize <= 0xFFFF ? 4 : 10);
+    return masked ? n + 4 : n;
+}
+
+void WebSocketCodec::appendFrame(Buffer* out, int opcode, StringPiece payload,
+                                 bool fin, const char* mask) {
+    // 一次预留，帧头和payload连续写入
+    out->ensureWritableBytes(headerSize(payload.size(), mask != nullptr) + payload.size());
+    char* p = out->beginWrite();
+    size_t n = writeHeader(p, opcode, payload.size(), fin, mask);
+    if (!payload.empty()) {
+        memcpy(p + n, payload.data(), payload.size());
+        if (mask) {
+            unmask(p + n, payload.size(), mask);
+        }
+    }
+    out->hasWritten(n + payload.size());
+}
+
+void WebSocketCodec::appendFrame(std::string* out, int opcode, StringPiece payload,
+                                 bool fin, const char* mask) {
+    char header[14];
+    size_t n = writeHeader(header, opcode, payload.size(), fin, mask);
+    size_t start = out->size();
+    out->reserve(start + n + payload.size());
+    out->append(header, n);
+    out->append(payload.data(), payload.size());
+    if (mask && !payload.empty()) {
+        unmask(&(*out)[start + n], payload.size(), mask);
+    }
+}
+
+// 掩码按4字节循环，扩展成16/32字节的向量后每次异或一整块
+// 1MB的payload逐字节处理约1ms，向量化之后是几十微秒
+void WebSocketCodec::unmask(char* data, size_t len, const char mask[4]) {
+    size_t i = 0;
+    uint32_t m32;
+    memcpy(&m32, mask, 4);
+
+#if defined(__AVX2__)
+    const __m256i m256 = _mm256_set1_epi32(static_cast<int>(m32));
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), _mm256_xor_si256(v, m256));
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i m128 = _mm_set1_epi32(static_cast<int>(m32));
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(v, m128));
+    }
+#endif
+
+    // 每次处理的字节数都是4的倍数，掩码的相位不变
+    uint64_t m64 = (static_cast<uint64_t>(m32) << 32) | m32;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, 8);
+        v ^= m64;
+        memcpy(data + i, &v, 8);
+    }
+    for (; i < len; ++i) {
+        data[i] ^= mask[i & 3];
+    }
+}
+
+std::string WebSocketCodec::acceptKey(StringPiece key) {
+    unsigned char digest[20];
+    sha1(key.as_string() + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", digest);
+    return base64(digest, sizeof digest);
+}
+
+// 拒绝过长编码、代理区（U+D800~U+DFFF）和超过U+10FFFF的码点
+bool WebSocketCodec::isValidUtf8(StringPiece s) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(s.data());
+    const unsigned char* end = p + s.size();
+    while (p < end) {
+        // ASCII快速路径：8字节一组
+        while (end - p >= 8) {
+            uint64_t v;
+            memcpy(&v, p, 8);
+            if (v & 0x8080808080808080ULL) {
+                break;
+            }
+            p += 8;
+        }
+        if (p >= end) {
+            break;
+        }
+        
+        unsigned char c = *p;
+        if (c < 0x80) {
+            ++p;
+            continue;
+        }
+        int n;
+        uint32_t cp;
+        if ((c & 0xE0) == 0xC0) {
+            n = 1;
+            cp = c & 0x1F;
+        } else if ((c & 0xF0) == 0xE0) {
+            n = 2;
+            cp = c & 0x0F;
+        } else if ((c & 0xF8) == 0xF0) {
+            n = 3;
+            cp = c & 0x07;
+        } else {
+            return false;
+        }
+        if (end - p <= n) {
+            return false;
+        }
+        for (int i = 1; i <= n; ++i) {
+            if ((p[i] & 0xC0) != 0x80) {
+                return false;
+            }
+            cp = (cp << 6) | (p[i] & 0x3F);
+        }
+        static const uint32_t kMin[] = { 0, 0x80, 0x800, 0x10000 };
+        if (cp < kMin[n] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            return false;
+        }
+        p += n + 1;
+    }
+    return true;
+}
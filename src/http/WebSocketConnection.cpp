@@ -0,0 +1,475 @@
+#include "WebSocketConnection.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "../net/TcpConnection.h"
+#include "../net/EventLoop.h"
+#include "../net/Buffer.h"
+#include "../logger/Logger.h"
+#include <algorithm>    // for std::min
+#include <cstring>      // for memcpy
+#include <vector>
+
+namespace {
+
+// 发出关闭帧之后等待对方回复的时间
+const double kCloseTimeout = 5.0;
+
+// 每个IO线程一个，用来拼帧，避免每次发送都分配Buffer
+thread_local Buffer t_frameBuffer;
+
+// 头部值中是否包含token（逗号分隔，不区分大小写），如Connection: keep-alive, Upgrade
+bool hasToken(StringPiece value, StringPiece token) {
+    const char* p = value.begin();
+    while (p < value.end()) {
+        while (p < value.end() && (*p == ' ' || *p == '\t' || *p == ',')) {
+            ++p;
+        }
+        const char* start = p;
+        while (p < value.end() && *p != ',') {
+            ++p;
+        }
+        StringPiece item(start, p);
+        while (!item.empty() && (item[item.size() - 1] == ' ' || item[item.size() - 1] == '\t')) {
+            item.remove_suffix(1);
+        }
+        if (item.equalsIgnoreCase(token)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+WebSocketMessage::WebSocketMessage(int opcode, StringPiece payload) {
+    std::shared_ptr<std::string> frame = std::make_shared<std::string>();
+    WebSocketCodec::appendFrame(frame.get(), opcode, payload);
+    frame_ = std::move(frame);
+}
+
+WebSocketConnection::WebSocketConnection(const std::shared_ptr<TcpConnection>& conn,
+                                         const std::shared_ptr<const WebSocketHandler>& handler,
+                                         size_t maxMessageSize)
+    : conn_(conn),
+      loop_(conn->getLoop()),
+      name_(conn->name()),
+      handler_(handler),
+      maxMessageSize_(maxMessageSize),
+      state_(kOpen),
+      closeNotified_(false),
+      fragmentOpcode_(WebSocketCodec::kContinuation)
+{
+}
+
+WebSocketConnection::~WebSocketConnection() {
+    LOG_DEBUG << "WebSocketConnection[" << name_ << "] destroyed";
+}
+
+// RFC 6455 4.2.1：GET、Upgrade: websocket、Connection: Upgrade、
+// Sec-WebSocket-Version: 13、Sec-WebSocket-Key（16字节的base64）
+bool WebSocketConnection::handshake(const HttpRequest& req, HttpResponse* resp,
+                                    const std::shared_ptr<const WebSocketHandler>& handler,
+                                    size_t maxMessageSize) {
+    StringPiece key = req.getHeader("Sec-WebSocket-Key");
+    if (req.method() != HttpRequest::kGet || req.version() != HttpRequest::kHttp11
+        || !hasToken(req.getHeader("Upgrade"), "websocket")
+        || !hasToken(req.getHeader("Connection"), "upgrade")
+        || key.size() != 24) {
+        resp->setStatusCode(HttpResponse::k400BadRequest);
+        resp->setCloseConnection(true);
+        return false;
+    }
+    if (req.getHeader("Sec-WebSocket-Version") != "13") {
+        resp->setStatusCode(HttpResponse::k426UpgradeRequired);
+        resp->addHeader("Sec-WebSocket-Version", "13");
+        return false;
+    }
+    
+    resp->setStatusCode(HttpResponse::k101SwitchingProtocols);
+    resp->addHeader("Upgrade", "websocket");
+    resp->addHeader("Connection", "Upgrade");
+    resp->addHeader("Sec-WebSocket-Accept", WebSocketCodec::acceptKey(key));
+    
+    // 101发出去之后才创建WebSocketConnection，onOpen里发送的消息一定在101之后
+    resp->setUpgrade([handler, maxMessageSize](const std::shared_ptr<TcpConnection>& conn,
+                                               const HttpRequest& request) {
+        WebSocketConnectionPtr ws = std::make_shared<WebSocketConnection>(conn, handler, maxMessageSize);
+        if (handler->onOpen) {
+            handler->onOpen(ws, request);
+        }
+        HttpResponse::Upgrade upgrade;
+        upgrade.onMessage = [ws](const std::shared_ptr<TcpConnection>&, Buffer* buf) {
+            ws->handleData(buf);
+        };
+        upgrade.onClose = [ws](const std::shared_ptr<TcpConnection>&) {
+            ws->handleDisconnected();
+        };
+        return upgrade;
+    });
+    return true;
+}
+
+void WebSocketConnection::sendText(StringPiece message) {
+    sendFrame(WebSocketCodec::kText, message);
+}
+
+void WebSocketConnection::sendBinary(StringPiece message) {
+    sendFrame(WebSocketCodec::kBinary, message);
+}
+
+void WebSocketConnection::ping(StringPiece payload) {
+    sendFrame(WebSocketCodec::kPing, payload.size() > 125 ? StringPiece(payload.data(), 125) : payload);
+}
+
+// 共享的帧直接从frame()写到socket，只有写不完的部分才拷进输出缓冲区
+void WebSocketConnection::send(const WebSocketMessage& message) {
+    if (loop_->isInLoopThread()) {
+        std::shared_ptr<TcpConnection> conn = conn_.lock();
+        if (state_ == kOpen && conn) {
+            conn->send(message.frame());
+        }
+    } else {
+        WebSocketConnectionPtr self = shared_from_this();
+        loop_->queueInLoop([self, message] {
+            self->send(message);
+        });
+    }
+}
+
+void WebSocketConnection::sendFrame(int opcode, StringPiece payload) {
+    if (loop_->isInLoopThread()) {
+        sendFrameInLoop(opcode, payload);
+    } else {
+        // payload要拷贝一份带到IO线程
+        WebSocketConnectionPtr self = shared_from_this();
+        std::string data = payload.as_string();
+        loop_->queueInLoop([self, opcode, data] {
+            self->sendFrameInLoop(opcode, data);
+        });
+    }
+}
+
+void WebSocketConnection::sendFrameInLoop(int opcode, StringPiece payload) {
+    // 关闭帧发出之后只允许回复关闭帧
+    if (state_ == kClosed || (state_ == kClosing && opcode != WebSocketCodec::kClose)) {
+        return;
+    }
+    std::shared_ptr<TcpConnection> conn = conn_.lock();
+    if (!conn) {
+        return;
+    }
+    Buffer& buf = t_frameBuffer;
+    WebSocketCodec::appendFrame(&buf, opcode, payload);
+    conn->send(&buf);
+}
+
+void WebSocketConnection::close(int code, StringPiece reason) {
+    if (!loop_->isInLoopThread()) {
+        WebSocketConnectionPtr self = shared_from_this();
+        std::string data = reason.as_string();
+        loop_->queueInLoop([self, code, data] {
+            self->close(code, data);
+        });
+        return;
+    }
+    if (state_ != kOpen) {
+        return;
+    }
+    
+    // 关闭帧：2字节的关闭码 + 原因（控制帧payload最多125字节）
+    char payload[125];
+    payload[0] = static_cast<char>(code >> 8);
+    payload[1] = static_cast<char>(code);
+    size_t len = std::min(reason.size(), sizeof payload - 2);
+    memcpy(payload + 2, reason.data(), len);
+    sendFrameInLoop(WebSocketCodec::kClose, StringPiece(payload, len + 2));
+    state_ = kClosing;
+    
+    // 对方一直不回复关闭帧，超时后强制断开
+    std::weak_ptr<TcpConnection> weakConn(conn_);
+    loop_->runAfter(kCloseTimeout, [weakConn] {
+        std::shared_ptr<TcpConnection> conn = weakConn.lock();
+        if (conn) {
+            conn->forceClose();
+        }
+    });
+}
+
+// 在输入Buffer上逐帧解析：payload原地解掩码，完整的单帧消息直接把Buffer里的数据交给回调
+void WebSocketConnection::handleData(Buffer* buf) {
+    while (state_ != kClosed) {
+        WebSocketCodec::FrameHeader header;
+        WebSocketCodec::ParseResult result =
+            WebSocketCodec::parseHeader(buf->peek(), buf->readableBytes(), &header);
+        if (result == WebSocketCodec::kIncomplete) {
+            break;
+        }
+        if (result == WebSocketCodec::kError || !header.masked) {
+            fail(kProtocolError);  // 客户端发来的帧必须带掩码
+            break;
+        }
+        
+        // 还没收完就可以根据长度拒绝，不用等一个超大的帧收完
+        size_t pending = fragmentOpcode_ != WebSocketCodec::kContinuation ? fragments_.size() : 0;
+        if (header.payloadSize > maxMessageSize_ - pending) {
+            fail(kMessageTooBig);
+            break;
+        }
+        size_t frameSize = header.headerSize + static_cast<size_t>(header.payloadSize);
+        if (buf->readableBytes() < frameSize) {
+            break;
+        }
+        
+        char* payload = const_cast<char*>(buf->peek()) + header.headerSize;
+        size_t payloadSize = static_cast<size_t>(header.payloadSize);
+        WebSocketCodec::unmask(payload, payloadSize, header.mask);
+        bool ok = handleFrame(header, StringPiece(payload, payloadSize));
+        buf->retrieve(frameSize);
+        if (!ok) {
+            break;
+        }
+    }
+    
+    // 关闭之后收到的数据直接丢弃
+    if (state_ == kClosed) {
+        buf->retrieveAll();
+    }
+}
+
+bool WebSocketConnection::handleFrame(const WebSocketCodec::FrameHeader& header, StringPiece payload) {
+    int opcode = header.opcode;
+    
+    // 控制帧：不能分片，payload最多125字节，可以夹在一条分片消息的中间
+    if (WebSocketCodec::isControl(opcode)) {
+        if (!header.fin || payload.size() > 125) {
+            fail(kProtocolError);
+            return false;
+        }
+        switch (opcode) {
+            case WebSocketCodec::kClose:
+                handleClose(payload);
+                return false;
+            case WebSocketCodec::kPing:
+                sendFrameInLoop(WebSocketCodec::kPong, payload);
+                return true;
+            case WebSocketCodec::kPong:
+                return true;
+            default:
+                fail(kProtocolError);
+                return false;
+        }
+    }
+    
+    switch (opcode) {
+        case WebSocketCodec::kText:
+        case WebSocketCodec::kBinary:
+            if (fragmentOpcode_ != WebSocketCodec::kContinuation) {
+                fail(kProtocolError);  // 上一条分片消息还没结束
+                return false;
+            }
+            if (header.fin) {
+                // 最常见的情况：单帧消息，直接交出Buffer里的数据，不拷贝
+                deliver(payload, opcode == WebSocketCodec::kBinary);
+            } else {
+                fragmentOpcode_ = opcode;
+                fragments_.assign(payload.data(), payload.size());
+            }
+            return state_ != kClosed;
+        case WebSocketCodec::kContinuation:
+            if (fragmentOpcode_ == WebSocketCodec::kContinuation) {
+                fail(kProtocolError);  // 没有开始帧的后续帧
+                return false;
+            }
+            fragments_.append(payload.data(), payload.size());
+            if (header.fin) {
+                bool binary = fragmentOpcode_ == WebSocketCodec::kBinary;
+                fragmentOpcode_ = WebSocketCodec::kContinuation;
+                deliver(fragments_, binary);
+                fragments_.clear();  // 保留容量，下一条分片消息复用
+            }
+            return state_ != kClosed;
+        default:
+            fail(kProtocolError);  // 保留的opcode
+            return false;
+    }
+}
+
+void WebSocketConnection::deliver(StringPiece message, bool binary) {
+    if (!binary && !WebSocketCodec::isValidUtf8(message)) {
+        fail(kInvalidPayload);
+        return;
+    }
+    if (handler_->onMessage) {
+        handler_->onMessage(shared_from_this(), message, binary);
+    }
+}
+
+// 对方发来关闭帧：我们先发的关闭帧，这是回复，断开连接；否则回复同样的关闭码
+void WebSocketConnection::handleClose(StringPiece payload) {
+    int code = kNoStatus;
+    if (payload.size() == 1) {
+        fail(kProtocolError);
+        return;
+    }
+    if (payload.size() >= 2) {
+        code = (static_cast<unsigned char>(payload[0]) << 8) | static_cast<unsigned char>(payload[1]);
+        bool valid = (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1011)
+                     || (code >= 3000 && code <= 4999);
+        if (!valid || !WebSocketCodec::isValidUtf8(StringPiece(payload.data() + 2, payload.size() - 2))) {
+            fail(kProtocolError);
+            return;
+        }
+    }
+    
+    if (state_ == kOpen) {
+        char reply[2] = { static_cast<char>(code >> 8), static_cast<char>(code) };
+        sendFrameInLoop(WebSocketCodec::kClose,
+                        code == kNoStatus ? StringPiece() : StringPiece(reply, 2));
+    }
+    state_ = kClosed;
+    
+    std::shared_ptr<TcpConnection> conn = conn_.lock();
+    if (conn) {
+        conn->shutdown();
+    }
+    notifyClosed(code);
+}
+
+void WebSocketConnection::fail(int code) {
+    LOG_WARN << "WebSocketConnection[" << name_ << "] closing with " << code;
+    if (state_ == kOpen) {
+        char payload[2] = { static_cast<char>(code >> 8), static_cast<char>(code) };
+        sendFrameInLoop(WebSocketCodec::kClose, StringPiece(payload, 2));
+    }
+    state_ = kClosed;
+    
+    std::shared_ptr<TcpConnection> conn = conn_.lock();
+    if (conn) {
+        conn->shutdown();
+    }
+    notifyClosed(code);
+}
+
+void WebSocketConnection::handleDisconnected() {
+    state_ = kClosed;
+    notifyClosed(kAbnormalClosure);
+}
+
+void WebSocketConnection::notifyClosed(int code) {
+    if (closeNotified_) {
+        return;
+    }
+    closeNotified_ = true;
+    if (handler_->onClose) {
+        handler_->onClose(shared_from_this(), code);
+    }
+}
+
+// === WebSocketGroup ===
+
+// 一个loop上的成员，只在这个loop的线程访问
+// 广播时顺序遍历vector（比遍历unordered_map的节点对缓存友好），index用来O(1)删除
+struct WebSocketGroup::Members {
+    struct Member {
+        WebSocketConnection* key;       // 连接析构后weak_ptr取不到地址，单独保存
+        std::weak_ptr<WebSocketConnection> conn;
+    };
+    
+    std::vector<Member> conns;
+    std::unordered_map<WebSocketConnection*, size_t> index;
+    
+    bool add(WebSocketConnection* key, const std::weak_ptr<WebSocketConnection>& conn) {
+        auto result = index.emplace(key, conns.size());
+        if (!result.second) {
+            conns[result.first->second].conn = conn;  // 地址被新连接复用
+            return false;
+        }
+        conns.push_back(Member{ key, conn });
+        return true;
+    }
+    
+    // 和最后一个交换后删除
+    void removeAt(size_t i) {
+        index.erase(conns[i].key);
+        if (i + 1 != conns.size()) {
+            conns[i] = std::move(conns.back());
+            index[conns[i].key] = i;
+        }
+        conns.pop_back();
+    }
+    
+    bool remove(WebSocketConnection* key) {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            return false;
+        }
+        removeAt(it->second);
+        return true;
+    }
+};
+
+WebSocketGroup::WebSocketGroup()
+    : size_(std::make_shared<std::atomic<size_t>>(0))
+{
+}
+
+WebSocketGroup::~WebSocketGroup() {
+}
+
+std::shared_ptr<WebSocketGroup::Members> WebSocketGroup::membersOf(EventLoop* loop) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_ptr<Members>& members = loops_[loop];
+    if (!members) {
+        members = std::make_shared<Members>();
+    }
+    return members;
+}
+
+void WebSocketGroup::add(const WebSocketConnectionPtr& conn) {
+    std::shared_ptr<Members> members = membersOf(conn->getLoop());
+    std::weak_ptr<WebSocketConnection> weak(conn);
+    WebSocketConnection* key = conn.get();
+    std::shared_ptr<std::atomic<size_t>> size = size_;
+    conn->getLoop()->runInLoop([members, weak, key, size] {
+        if (members->add(key, weak)) {
+            ++*size;
+        }
+    });
+}
+
+void WebSocketGroup::remove(const WebSocketConnectionPtr& conn) {
+    std::shared_ptr<Members> members = membersOf(conn->getLoop());
+    WebSocketConnection* key = conn.get();
+    std::shared_ptr<std::atomic<size_t>> size = size_;
+    conn->getLoop()->runInLoop([members, key, size] {
+        if (members->remove(key)) {
+            --*size;
+        }
+    });
+}
+
+// 每个loop只投递一个任务，任务里把同一个帧写给这个loop上的所有连接
+void WebSocketGroup::broadcast(const WebSocketMessage& message) {
+    std::vector<std::pair<EventLoop*, std::shared_ptr<Members>>> loops;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loops.assign(loops_.begin(), loops_.end());
+    }
+    std::shared_ptr<std::atomic<size_t>> size = size_;
+    for (auto& entry : loops) {
+        std::shared_ptr<Members> members = entry.second;
+        entry.first->runInLoop([members, message, size] {
+            size_t i = 0;
+            while (i < members->conns.size()) {
+                WebSocketConnectionPtr conn = members->conns[i].conn.lock();
+                if (conn && conn->connected()) {
+                    conn->send(message);
+                    ++i;
+                } else {
+                    members->removeAt(i);
+                    --*size;
+                }
+            }
+        });
+    }
+}
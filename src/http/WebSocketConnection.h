@@ -0,0 +1,179 @@
+#ifndef TINY_NETWORK_HTTP_WEBSOCKETCONNECTION_H
+#define TINY_NETWORK_HTTP_WEBSOCKETCONNECTION_H
+
+#include "../base/noncopyable.h"
+#include "../base/StringPiece.h"
+#include "WebSocketCodec.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class Buffer;
+class EventLoop;
+class HttpRequest;
+class HttpResponse;
+class TcpConnection;
+class WebSocketConnection;
+
+using WebSocketConnectionPtr = std::shared_ptr<WebSocketConnection>;
+
+// 一个WebSocket路由的回调，所有回调都在连接所在的IO线程调用
+struct WebSocketHandler {
+    // 握手完成，req是升级请求（可以取路由参数、Cookie等）
+    std::function<void(const WebSocketConnectionPtr&, const HttpRequest&)> onOpen;
+    // 收到一条完整的消息（分片已经拼好）；message只在回调期间有效
+    std::function<void(const WebSocketConnectionPtr&, StringPiece message, bool binary)> onMessage;
+    // 连接关闭，code是对方发来的关闭码（连接直接断开时是1006）
+    std::function<void(const WebSocketConnectionPtr&, int code)> onClose;
+};
+
+// WebSocketMessage：序列化好的一帧，可以发给任意多个连接
+// 帧只生成一次，多个连接、多个loop共享同一块内存（shared_ptr）
+class WebSocketMessage {
+public:
+    static WebSocketMessage text(StringPiece payload) {
+        return WebSocketMessage(WebSocketCodec::kText, payload);
+    }
+    
+    static WebSocketMessage binary(StringPiece payload) {
+        return WebSocketMessage(WebSocketCodec::kBinary, payload);
+    }
+    
+    const std::string& frame() const {
+        return *frame_;
+    }
+
+private:
+    WebSocketMessage(int opcode, StringPiece payload);
+    
+    std::shared_ptr<const std::string> frame_;
+};
+
+// WebSocketConnection：一个升级成WebSocket的连接
+//
+// 由HttpServer::websocket()注册的路由创建：握手成功后连接交给它，
+// 之后收到的数据按帧解析（在输入Buffer上原地解掩码），支持分片、ping/pong、关闭握手
+//
+// send系列函数可以在任意线程调用：在IO线程直接写，其他线程转到IO线程再写
+class WebSocketConnection : noncopyable,
+                            public std::enable_shared_from_this<WebSocketConnection> {
+public:
+    // 关闭码（RFC 6455 7.4.1）
+    enum CloseCode {
+        kNormalClosure = 1000,
+        kGoingAway = 1001,
+        kProtocolError = 1002,
+        kUnsupportedData = 1003,
+        kNoStatus = 1005,           // 关闭帧没有带关闭码（不能出现在帧里）
+        kAbnormalClosure = 1006,    // 没有关闭握手就断开了（不能出现在帧里）
+        kInvalidPayload = 1007,
+        kPolicyViolation = 1008,
+        kMessageTooBig = 1009,
+        kInternalError = 1011
+    };
+    
+    // 默认消息大小上限：16MB
+    static const size_t kDefaultMaxMessageSize = 16 * 1024 * 1024;
+    
+    WebSocketConnection(const std::shared_ptr<TcpConnection>& conn,
+                        const std::shared_ptr<const WebSocketHandler>& handler,
+                        size_t maxMessageSize);
+    ~WebSocketConnection();
+    
+    // 检查升级请求，合法时把resp设置成101并挂上升级回调，否则设置成400/426
+    // 返回是否握手成功
+    static bool handshake(const HttpRequest& req, HttpResponse* resp,
+                          const std::shared_ptr<const WebSocketHandler>& handler,
+                          size_t maxMessageSize = kDefaultMaxMessageSize);
+    
+    // === 发送 ===
+    void sendText(StringPiece message);
+    void sendBinary(StringPiece message);
+    void send(const WebSocketMessage& message);  // 预先序列化好的帧（广播）
+    void ping(StringPiece payload = StringPiece());
+    
+    // 发起关闭握手：发送关闭帧，等对方回复后断开（超时强制断开）
+    void close(int code = kNormalClosure, StringPiece reason = StringPiece());
+    
+    // === 状态 ===
+    bool connected() const { return state_ == kOpen; }
+    EventLoop* getLoop() const { return loop_; }
+    const std::string& name() const { return name_; }
+    
+    // 底层连接，已经断开时为空
+    std::shared_ptr<TcpConnection> connection() const { return conn_.lock(); }
+    
+    // 用户数据（如用户ID、所在的房间）
+    void setContext(const std::shared_ptr<void>& context) { context_ = context; }
+    const std::shared_ptr<void>& getContext() const { return context_; }
+    
+    // === HttpServer使用 ===
+    // 收到数据：解析所有完整的帧
+    void handleData(Buffer* buf);
+    // 底层连接断开
+    void handleDisconnected();
+
+private:
+    enum State { kOpen, kClosing, kClosed };
+    
+    // 在IO线程发送一帧（payload只在调用期间有效）
+    void sendFrameInLoop(int opcode, StringPiece payload);
+    void sendFrame(int opcode, StringPiece payload);
+    
+    // 处理一个完整的帧，返回false表示连接已经关闭
+    bool handleFrame(const WebSocketCodec::FrameHeader& header, StringPiece payload);
+    void handleClose(StringPiece payload);
+    void deliver(StringPiece message, bool binary);
+    
+    // 协议错误：发送关闭帧后断开
+    void fail(int code);
+    void notifyClosed(int code);
+    
+    std::weak_ptr<TcpConnection> conn_;
+    EventLoop* loop_;
+    std::string name_;
+    std::shared_ptr<const WebSocketHandler> handler_;
+    size_t maxMessageSize_;
+    State state_;
+    bool closeNotified_;                // onClose已经调用过
+    
+    // 分片消息：第一帧的类型和到目前为止的数据
+    int fragmentOpcode_;                // kContinuation表示不在分片中
+    std::string fragments_;
+    
+    std::shared_ptr<void> context_;
+};
+
+// WebSocketGroup：一组连接（聊天室、订阅同一个主题的客户端），支持广播
+//
+// 成员按所在的EventLoop分组，每组只在自己的IO线程访问
+// broadcast()把同一个WebSocketMessage投递到每个loop，各loop把帧写给自己的连接，
+// 消息只序列化一次，发给N个连接也只有一份内存
+//
+// 所有函数都可以在任意线程调用；已经关闭的连接在广播时顺便移除
+class WebSocketGroup : noncopyable {
+public:
+    WebSocketGroup();
+    ~WebSocketGroup();
+    
+    void add(const WebSocketConnectionPtr& conn);
+    void remove(const WebSocketConnectionPtr& conn);
+    void broadcast(const WebSocketMessage& message);
+    
+    // 成员数（add/remove已经在各自的loop上生效的部分）
+    size_t size() const { return *size_; }
+
+private:
+    struct Members;
+    
+    std::shared_ptr<Members> membersOf(EventLoop* loop);
+    
+    std::mutex mutex_;
+    std::unordered_map<EventLoop*, std::shared_ptr<Members>> loops_;
+    std::shared_ptr<std::atomic<size_t>> size_;   // loop上的任务也要更新，group析构后仍然有效
+};
+
+#endif
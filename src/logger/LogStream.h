@@ -2,6 +2,7 @@
 #define TINY_NETWORK_LOGGER_LOGSTREAM_H
 
 #include "../base/noncopyable.h"
+#include "../base/StringPiece.h"
 #include <string>
 #include <string.h>
 
@@ -71,6 +72,10 @@ public:
     LogStream& operator<<(const char* str);
     LogStream& operator<<(const unsigned char* str);
     LogStream& operator<<(const std::string& str);
+    LogStream& operator<<(const StringPiece& str) {
+        buffer_.append(str.data(), str.size());
+        return *this;
+    }
 
     // 直接添加数据
     void append(const char* data, int len) { buffer_.append(data, len); }
@@ -3,17 +3,26 @@
 #include "EventLoop.h"
 #include "Socket.h"
 #include "InetAddress.h"
+#include "UnixAddress.h"
 #include "../logger/Logger.h"
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <errno.h>
 #include <unistd.h>
 #include <iostream>
 
 Acceptor::Acceptor(EventLoop* loop, int port)
+    : Acceptor(loop, InetAddress(static_cast<uint16_t>(port)))
+{
+}
+
+Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool ipv6Only)
     : loop_(loop),
-      listening_(false)
+      listening_(false),
+      unixDomain_(false)
 {
     // 创建监听socket
-    int listenfd = socket(AF_INET, SOCK_STREAM, 0);
+    int listenfd = socket(listenAddr.family(), SOCK_STREAM, 0);
     if (listenfd < 0) {
         LOG_ERROR << "Acceptor: socket() failed";
         return;
@@ -26,8 +35,12 @@ Acceptor::Acceptor(EventLoop* loop, int port)
     acceptSocket_->setReuseAddr(true);
     acceptSocket_->setReusePort(true);
     
+    // 双栈与否不依赖系统默认值（net.ipv6.bindv6only）
+    if (listenAddr.isIpv6()) {
+        acceptSocket_->setIpv6Only(ipv6Only);
+    }
+    
     // 绑定地址
-    InetAddress listenAddr(port);
     acceptSocket_->bindAddress(listenAddr);
     
     // 创建Channel管理listenfd
@@ -35,16 +48,66 @@ Acceptor::Acceptor(EventLoop* loop, int port)
     channel_->setReadCallback(
         std::bind(&Acceptor::handleRead, this));
     
-    LOG_INFO << "Acceptor: listening on port " << port;
+    LOG_INFO << "Acceptor: listening on " << listenAddr.toIpPort()
+             << (listenAddr.isIpv6() && !ipv6Only ? " (dual-stack)" : "");
+}
+
+Acceptor::Acceptor(EventLoop* loop, const UnixAddress& listenAddr)
+    : loop_(loop),
+      listening_(false),
+      unixDomain_(true)
+{
+    int listenfd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenfd < 0) {
+        LOG_ERROR << "Acceptor: socket(AF_UNIX) failed";
+        return;
+    }
+    acceptSocket_.reset(new Socket(listenfd));
+    
+    // 文件路径上已经有socket文件时bind()返回EADDRINUSE：连不上说明是上次残留的，删掉
+    // 只删除没有进程在监听的socket文件，不会误删同名的普通文件或者别人正在用的socket
+    if (!listenAddr.isAbstract()) {
+        std::string path = listenAddr.path();
+        struct stat st;
+        if (::stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (probe >= 0 && ::connect(probe, listenAddr.getSockAddr(), listenAddr.getSockLen()) < 0
+                && errno == ECONNREFUSED) {
+                LOG_INFO << "Acceptor: removing stale socket file " << path;
+                ::unlink(path.c_str());
+            }
+            if (probe >= 0) {
+                ::close(probe);
+            }
+        }
+    }
+    if (acceptSocket_->bindAddress(listenAddr) && !listenAddr.isAbstract()) {
+        unlinkPath_ = listenAddr.path();
+    }
+    
+    channel_.reset(new Channel(listenfd));
+    channel_->setReadCallback(
+        std::bind(&Acceptor::handleRead, this));
+    
+    LOG_INFO << "Acceptor: listening on " << listenAddr.toString();
 }
 
 Acceptor::~Acceptor() {
+    // 先从Poller中移除，否则fd被复用时新的Channel会走MOD分支而注册失败
+    if (listening_) {
+        channel_->disableAll();
+        loop_->removeChannel(channel_.get());
+    }
+    if (!unlinkPath_.empty()) {
+        ::unlink(unlinkPath_.c_str());
+    }
     // Socket的析构函数会自动close
 }
 
 void Acceptor::listen() {
     // 开始监听
-    acceptSocket_->listen();
+    options_.applyToListenSocket(acceptSocket_->fd(), !unixDomain_);
+    acceptSocket_->listen(options_.backlog);
     listening_ = true;
     
     // 注册到EventLoop，开始监听可读事件
@@ -55,11 +118,21 @@ void Acceptor::listen() {
 void Acceptor::handleRead() {
     // 有新连接到达
     InetAddress peerAddr(0);  // 临时构造，accept会重新设置
-    int connfd = acceptSocket_->accept(&peerAddr);
+    // Unix域socket的客户端一般没有bind()，对端地址没有意义
+    int connfd = acceptSocket_->accept(unixDomain_ ? nullptr : &peerAddr);
     
     if (connfd >= 0) {
-        LOG_INFO << "Acceptor: new connection from " << peerAddr.toIpPort() 
-                 << ", fd=" << connfd;
+        // 每个连接都经过这里：默认的INFO级别不做任何格式化
+        if (unixDomain_) {
+            LOG_DEBUG << "Acceptor: new unix connection, fd=" << connfd;
+        } else if (Logger::logLevel() <= Logger::DEBUG) {
+            // 格式化到栈上的缓冲区，不分配内存
+            char peer[InetAddress::kMaxIpPortLength];
+            peerAddr.toIpPort(peer, sizeof peer);
+            LOG_DEBUG << "Acceptor: new connection from " << peer << ", fd=" << connfd;
+        }
+        
+        options_.applyToConnection(connfd, !unixDomain_);
         
         // 调用用户设置的回调
         if (newConnectionCallback_) {
@@ -1,8 +1,11 @@
 #include "Buffer.h"
 #include <sys/uio.h>  // for readv
+#include <sys/socket.h>  // for recvmsg
 #include <unistd.h>
 #include <errno.h>
 
+const size_t Buffer::kInitialSize;
+
 // 从socket读取数据到Buffer
 ssize_t Buffer::readFd(int fd) {
     // 使用栈上的临时缓冲区
@@ -38,4 +41,31 @@ ssize_t Buffer::readFd(int fd) {
     }
     
     return n;
-}
\ No newline at end of file
+}
+ssize_t Buffer::readMsg(int fd, struct msghdr* msg, int flags) {
+    // 和readFd()一样读到两块缓冲区
+    char extrabuf[65536];
+    struct iovec vec[2];
+    const size_t writable = writableBytes();
+    vec[0].iov_base = beginWrite();
+    vec[0].iov_len = writable;
+    vec[1].iov_base = extrabuf;
+    vec[1].iov_len = sizeof(extrabuf);
+    msg->msg_iov = vec;
+    msg->msg_iovlen = 2;
+    
+    ssize_t n = ::recvmsg(fd, msg, flags);
+    msg->msg_iov = nullptr;
+    msg->msg_iovlen = 0;
+    
+    if (n < 0) {
+        return n;
+    } else if (static_cast<size_t>(n) <= writable) {
+        writerIndex_ += n;
+    } else {
+        writerIndex_ = buffer_.size();
+        append(extrabuf, n - writable);
+    }
+    
+    return n;
+}
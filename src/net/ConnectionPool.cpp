@@ -0,0 +1,371 @@
+#include "ConnectionPool.h"
+#include "Buffer.h"
+#include "Connector.h"
+#include "EventLoop.h"
+#include "TcpConnection.h"
+#include "../base/Timestamp.h"
+#include "../logger/Logger.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <errno.h>
+#include <sys/socket.h>
+
+const size_t ConnectionPool::kDefaultMaxIdle;
+const size_t ConnectionPool::kDefaultMaxTotal;
+
+// 排队的acquire()
+struct ConnectionPool::Waiter {
+    explicit Waiter(const AcquireCallback& c) : cb(c) {}
+    
+    AcquireCallback cb;
+    TimerId timer;      // 等待超时
+};
+
+// 池里的一个连接（池持有所有还没关闭的连接，使用者不保存也不会被提前析构）
+struct ConnectionPool::Entry {
+    Entry(Destination* d, const ConnectionPtr& c) : dest(d), conn(c), idle(false) {}
+    
+    Destination* dest;
+    ConnectionPtr conn;
+    bool idle;          // 在空闲列表里
+};
+
+// 一个目的地址的连接
+struct ConnectionPool::Destination {
+    struct IdleConn {
+        ConnectionPtr conn;
+        Timestamp since;    // 放回池里的时间
+    };
+    
+    explicit Destination(const InetAddress& a)
+        : addr(a),
+          key(a.toIpPort()),
+          active(0),
+          connects(0),
+          reuses(0),
+          evictions(0),
+          failures(0)
+    {
+    }
+    
+    InetAddress addr;
+    std::string key;
+    std::vector<IdleConn> idle;                          // 末尾是最近放回的
+    size_t active;                                       // 交给使用者的连接数
+    std::vector<std::shared_ptr<Connector>> connectors;  // 正在建立的连接
+    std::deque<std::shared_ptr<Waiter>> waiters;
+    uint64_t connects;
+    uint64_t reuses;
+    uint64_t evictions;
+    uint64_t failures;
+};
+
+ConnectionPool::ConnectionPool(EventLoop* loop, const std::string& name)
+    : loop_(loop),
+      name_(name),
+      maxIdle_(kDefaultMaxIdle),
+      maxTotal_(kDefaultMaxTotal),
+      idleTimeout_(0),
+      connectTimeout_(5.0),
+      acquireTimeout_(5.0),
+      nextConnId_(1)
+{
+    setIdleTimeout(30.0);
+}
+
+ConnectionPool::~ConnectionPool() {
+    if (sweepTimer_.valid()) {
+        loop_->cancel(sweepTimer_);
+    }
+    
+    // 排队的acquire()不再回调，正在建立的连接放弃
+    for (const auto& item : destinations_) {
+        for (const std::shared_ptr<Waiter>& waiter : item.second->waiters) {
+            if (waiter->timer.valid()) {
+                loop_->cancel(waiter->timer);
+            }
+        }
+        for (const std::shared_ptr<Connector>& connector : item.second->connectors) {
+            connector->stop();
+        }
+    }
+    
+    // 关闭所有连接（包括使用中的）：关闭回调原来指向this，换成只做清理的版本
+    std::unordered_map<TcpConnection*, std::shared_ptr<Entry>> owners;
+    owners.swap(owners_);
+    EventLoop* loop = loop_;
+    for (const auto& item : owners) {
+        item.second->conn->setCloseCallback([loop](const ConnectionPtr& conn) {
+            loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+        });
+        item.second->conn->forceClose();
+    }
+}
+
+void ConnectionPool::setIdleTimeout(double seconds) {
+    if (sweepTimer_.valid()) {
+        loop_->cancel(sweepTimer_);
+        sweepTimer_ = TimerId();
+    }
+    idleTimeout_ = seconds;
+    if (idleTimeout_ > 0) {
+        sweepTimer_ = loop_->runEvery(idleTimeout_ / 2, [this]() { sweepIdle(); });
+    }
+}
+
+void ConnectionPool::acquire(const InetAddress& addr, const AcquireCallback& cb) {
+    Destination* dest = destinationFor(addr);
+    std::shared_ptr<Waiter> waiter = std::make_shared<Waiter>(cb);
+    dest->waiters.push_back(waiter);
+    dispatch(dest);
+    
+    // 没有马上拿到连接：开始计算等待时间
+    bool queued = std::find(dest->waiters.begin(), dest->waiters.end(), waiter) != dest->waiters.end();
+    if (queued && acquireTimeout_ > 0) {
+        std::weak_ptr<Waiter> weakWaiter(waiter);
+        waiter->timer = loop_->runAfter(acquireTimeout_, [this, dest, weakWaiter]() {
+            std::shared_ptr<Waiter> waiter = weakWaiter.lock();
+            if (!waiter) {
+                return;
+            }
+            auto it = std::find(dest->waiters.begin(), dest->waiters.end(), waiter);
+            if (it == dest->waiters.end()) {
+                return;
+            }
+            dest->waiters.erase(it);
+            waiter->timer = TimerId();
+            LOG_WARN << "ConnectionPool[" << name_ << "] acquire " << dest->key << " timed out";
+            waiter->cb(ConnectionPtr(), ETIMEDOUT);
+        });
+    }
+}
+
+void ConnectionPool::release(const ConnectionPtr& conn, bool reusable) {
+    auto it = owners_.find(conn.get());
+    if (it == owners_.end()) {
+        return;  // 已经关闭了，或者不是这个池的连接
+    }
+    Entry* entry = it->second.get();
+    Destination* dest = entry->dest;
+    if (entry->idle) {
+        return;  // 重复release()
+    }
+    
+    // 不能复用的关闭，关闭回调里清理（仍然算在active里）
+    if (!reusable || !usable(conn)) {
+        conn->forceClose();
+        return;
+    }
+    if (!dest->waiters.empty()) {
+        --dest->active;
+        ++dest->reuses;
+        handOut(dest, conn);
+    } else if (dest->idle.size() < maxIdle_) {
+        --dest->active;
+        park(entry, conn);
+    } else {
+        conn->forceClose();
+    }
+}
+
+ConnectionPool::Stats ConnectionPool::stats(const InetAddress& addr) const {
+    Stats stats;
+    memset(&stats, 0, sizeof stats);
+    auto it = destinations_.find(addr.toIpPort());
+    if (it != destinations_.end()) {
+        const Destination* dest = it->second.get();
+        stats.idle = dest->idle.size();
+        stats.active = dest->active;
+        stats.connecting = dest->connectors.size();
+        stats.waiting = dest->waiters.size();
+        stats.connects = dest->connects;
+        stats.reuses = dest->reuses;
+        stats.evictions = dest->evictions;
+        stats.failures = dest->failures;
+    }
+    return stats;
+}
+
+ConnectionPool::Destination* ConnectionPool::destinationFor(const InetAddress& addr) {
+    std::unique_ptr<Destination>& dest = destinations_[addr.toIpPort()];
+    if (!dest) {
+        dest.reset(new Destination(addr));
+    }
+    return dest.get();
+}
+
+void ConnectionPool::dispatch(Destination* dest) {
+    while (!dest->waiters.empty()) {
+        if (!dest->idle.empty()) {
+            // 后进先出：最近用过的连接最不可能已经被对端的空闲超时关闭
+            ConnectionPtr conn = dest->idle.back().conn;
+            dest->idle.pop_back();
+            owners_[conn.get()]->idle = false;
+            ++dest->active;
+            if (!usable(conn)) {
+                // 关闭回调里减掉active，可能再次进入dispatch()
+                ++dest->evictions;
+                conn->forceClose();
+                continue;
+            }
+            --dest->active;
+            ++dest->reuses;
+            handOut(dest, conn);
+            continue;
+        }
+        
+        // 每个等待者最多对应一个正在建立的连接
+        size_t total = dest->active + dest->connectors.size();
+        if (dest->connectors.size() < dest->waiters.size() && total < maxTotal_) {
+            connect(dest);
+            continue;
+        }
+        break;
+    }
+}
+
+void ConnectionPool::connect(Destination* dest) {
+    std::shared_ptr<Connector> connector = std::make_shared<Connector>(loop_, dest->addr);
+    connector->setConnectTimeout(connectTimeout_);
+    
+    // 有了结果之后从列表里拿掉：正在它自己的回调里，等这次事件处理完再销毁
+    Connector* raw = connector.get();
+    auto drop = [this, dest, raw]() {
+        auto it = std::find_if(dest->connectors.begin(), dest->connectors.end(),
+                               [raw](const std::shared_ptr<Connector>& c) { return c.get() == raw; });
+        assert(it != dest->connectors.end());
+        std::shared_ptr<Connector> dropped = *it;
+        dest->connectors.erase(it);
+        loop_->queueInLoop([dropped]() {});
+    };
+    connector->setNewConnectionCallback([this, dest, drop](int sockfd) {
+        drop();
+        ++dest->connects;
+        ConnectionPtr conn = newConnection(dest, sockfd);
+        if (!dest->waiters.empty()) {
+            handOut(dest, conn);
+        } else if (dest->idle.size() < maxIdle_) {
+            park(owners_[conn.get()].get(), conn);   // 等待者超时走了
+        } else {
+            ++dest->active;
+            conn->forceClose();
+        }
+    });
+    connector->setErrorCallback([this, dest, drop](int savedErrno) {
+        drop();
+        ++dest->failures;
+        LOG_WARN << "ConnectionPool[" << name_ << "] connect to " << dest->key
+                 << " failed: " << strerror(savedErrno);
+        if (!dest->waiters.empty()) {
+            std::shared_ptr<Waiter> waiter = dest->waiters.front();
+            dest->waiters.pop_front();
+            if (waiter->timer.valid()) {
+                loop_->cancel(waiter->timer);
+            }
+            waiter->cb(ConnectionPtr(), savedErrno);
+        }
+        dispatch(dest);
+    });
+    dest->connectors.push_back(connector);
+    connector->start();
+}
+
+ConnectionPool::ConnectionPtr ConnectionPool::newConnection(Destination* dest, int sockfd) {
+    char buf[32];
+    snprintf(buf, sizeof buf, "#%d", nextConnId_++);
+    ConnectionPtr conn = std::make_shared<TcpConnection>(loop_, name_ + "-" + dest->key + buf, sockfd);
+    conn->setCloseCallback(
+        std::bind(&ConnectionPool::removeConnection, this, std::placeholders::_1));
+    conn->setTcpNoDelay(true);
+    owners_[conn.get()] = std::make_shared<Entry>(dest, conn);
+    conn->connectEstablished();
+    return conn;
+}
+
+void ConnectionPool::handOut(Destination* dest, const ConnectionPtr& conn) {
+    std::shared_ptr<Waiter> waiter = dest->waiters.front();
+    dest->waiters.pop_front();
+    if (waiter->timer.valid()) {
+        loop_->cancel(waiter->timer);
+        waiter->timer = TimerId();
+    }
+    owners_[conn.get()]->idle = false;
+    ++dest->active;
+    waiter->cb(conn, 0);
+}
+
+void ConnectionPool::park(Entry* entry, const ConnectionPtr& conn) {
+    // 空闲时收到的数据不属于任何请求，连接的状态已经不可信
+    std::string name = name_;
+    conn->setMessageCallback([name](const ConnectionPtr& conn, Buffer* buf) {
+        LOG_WARN << "ConnectionPool[" << name << "] unexpected " << buf->readableBytes()
+                 << " bytes on idle connection " << conn->name();
+        buf->retrieveAll();
+        conn->forceClose();
+    });
+    conn->setConnectionCallback(nullptr);
+    conn->setWriteCompleteCallback(nullptr);
+    conn->startRead();  // 空闲时也要读，才能发现对端关闭了连接
+    
+    entry->idle = true;
+    Destination::IdleConn idle;
+    idle.conn = conn;
+    idle.since = Timestamp::now();
+    entry->dest->idle.push_back(idle);
+}
+
+bool ConnectionPool::usable(const ConnectionPtr& conn) {
+    if (!conn->connected() || conn->inputBuffer()->readableBytes() > 0) {
+        return false;
+    }
+    // 关闭的事件可能还在这一轮epoll_wait的结果里没有处理：直接看socket
+    char c;
+    ssize_t n = ::recv(conn->fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+void ConnectionPool::removeConnection(const ConnectionPtr& conn) {
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    
+    auto it = owners_.find(conn.get());
+    if (it == owners_.end()) {
+        return;
+    }
+    std::shared_ptr<Entry> entry = it->second;
+    owners_.erase(it);
+    Destination* dest = entry->dest;
+    if (entry->idle) {
+        entry->idle = false;
+        auto idleIt = std::find_if(dest->idle.begin(), dest->idle.end(),
+                                   [&conn](const Destination::IdleConn& idle) { return idle.conn == conn; });
+        assert(idleIt != dest->idle.end());
+        dest->idle.erase(idleIt);
+    } else {
+        --dest->active;
+    }
+    
+    // 空出了一个名额
+    dispatch(dest);
+}
+
+void ConnectionPool::sweepIdle() {
+    Timestamp now = Timestamp::now();
+    std::vector<ConnectionPtr> expired;
+    for (const auto& item : destinations_) {
+        Destination* dest = item.second.get();
+        // 前面的空闲最久
+        for (const Destination::IdleConn& idle : dest->idle) {
+            if (timeDifference(now, idle.since) < idleTimeout_) {
+                break;
+            }
+            expired.push_back(idle.conn);
+            ++dest->evictions;
+        }
+    }
+    // 关闭回调把它们从空闲列表里拿掉
+    for (const ConnectionPtr& conn : expired) {
+        conn->forceClose();
+    }
+}
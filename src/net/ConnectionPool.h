@@ -0,0 +1,134 @@
+#ifndef TINY_NETWORK_NET_CONNECTIONPOOL_H
+#define TINY_NETWORK_NET_CONNECTIONPOOL_H
+
+#include "../base/noncopyable.h"
+#include "InetAddress.h"
+#include "Timer.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Connector;
+class EventLoop;
+class TcpConnection;
+
+// ConnectionPool：一个EventLoop上的出站连接池，按目的地址分组复用TcpConnection
+//
+// 使用方式（每个IO线程一个池，比如在ThreadInitCallback里创建）：
+// ConnectionPool pool(loop, "rpc");
+// pool.acquire(addr, [&](const ConnectionPtr& conn, int savedErrno) {
+//     if (!conn) { 连接失败或者等待超时; return; }
+//     conn->setMessageCallback(处理响应);   // 响应处理完之后pool.release(conn)
+//     conn->send(request);
+// });
+//
+// - 每个目的地址最多setMaxTotal()个连接（空闲 + 使用中 + 正在建立），
+//   达到上限时acquire()排队，有连接放回或者关闭时按顺序交给等待者
+// - 最多保留setMaxIdle()个空闲连接，空闲超过setIdleTimeout()的关闭
+// - 取出空闲连接时检查它是否还能用（对端关闭了、收到了不属于任何请求的数据都不能用），
+//   不能用的关闭，换下一个或者新建
+//
+// 连接交给使用者之后，消息/连接/写完成回调由使用者设置，release()时恢复成池的回调
+// 使用中的连接被关闭时池会自动忘掉它，之后再release()也没有关系
+// 析构时关闭所有连接（包括使用中的）
+// 所有函数都只能在loop线程调用，不加锁；AcquireCallback可能在acquire()/release()里直接调用
+class ConnectionPool : noncopyable {
+public:
+    using ConnectionPtr = std::shared_ptr<TcpConnection>;
+    // 成功时conn非空、savedErrno为0；失败时conn为空，savedErrno是连接失败的原因，等待超时是ETIMEDOUT
+    using AcquireCallback = std::function<void(const ConnectionPtr& conn, int savedErrno)>;
+    
+    // 一个目的地址的统计
+    struct Stats {
+        size_t idle;            // 空闲连接
+        size_t active;          // 使用中的连接
+        size_t connecting;      // 正在建立的连接
+        size_t waiting;         // 排队的acquire()
+        uint64_t connects;      // 建立过的连接数
+        uint64_t reuses;        // 复用空闲连接的次数
+        uint64_t evictions;     // 因为空闲超时或者取出时检查失败而关闭的空闲连接
+        uint64_t failures;      // 连接失败的次数
+    };
+    
+    // 默认值
+    static const size_t kDefaultMaxIdle = 8;
+    static const size_t kDefaultMaxTotal = 64;
+    
+    ConnectionPool(EventLoop* loop, const std::string& name);
+    ~ConnectionPool();
+    
+    EventLoop* getLoop() const { return loop_; }
+    const std::string& name() const { return name_; }
+    
+    // 每个目的地址最多保留的空闲连接
+    void setMaxIdle(size_t n) { maxIdle_ = n; }
+    
+    // 每个目的地址最多的连接数（包括使用中和正在建立的）
+    void setMaxTotal(size_t n) { maxTotal_ = n; }
+    
+    // 空闲连接超过这个时间（秒）就关闭，默认30秒（应该比对端的空闲超时短），0表示不关闭
+    void setIdleTimeout(double seconds);
+    
+    // 建立连接的超时（秒），默认5秒
+    void setConnectTimeout(double seconds) { connectTimeout_ = seconds; }
+    
+    // acquire()排队等待的超时（秒），默认5秒，0表示一直等
+    void setAcquireTimeout(double seconds) { acquireTimeout_ = seconds; }
+    
+    // 取一个到addr的连接：有空闲的直接给，没有就新建，达到上限就排队
+    void acquire(const InetAddress& addr, const AcquireCallback& cb);
+    
+    // 用完之后放回；reusable为false（比如响应没有读完、协议出错）时直接关闭
+    void release(const ConnectionPtr& conn, bool reusable = true);
+    
+    Stats stats(const InetAddress& addr) const;
+
+private:
+    struct Destination;
+    struct Entry;
+    struct Waiter;
+    
+    Destination* destinationFor(const InetAddress& addr);
+    
+    // 有空闲连接或者还能新建连接时，交给排队的acquire()
+    void dispatch(Destination* dest);
+    
+    // 发起一个新连接
+    void connect(Destination* dest);
+    
+    // 建立好的连接交给TcpConnection，加入池
+    ConnectionPtr newConnection(Destination* dest, int sockfd);
+    
+    // 连接交给第一个等待者
+    void handOut(Destination* dest, const ConnectionPtr& conn);
+    
+    // 放回空闲列表，换成空闲时的回调
+    void park(Entry* entry, const ConnectionPtr& conn);
+    
+    // 空闲连接是否还能用
+    static bool usable(const ConnectionPtr& conn);
+    
+    // 连接关闭了（TcpConnection的关闭回调）
+    void removeConnection(const ConnectionPtr& conn);
+    
+    // 定期关闭空闲太久的连接
+    void sweepIdle();
+    
+    EventLoop* loop_;
+    std::string name_;
+    size_t maxIdle_;
+    size_t maxTotal_;
+    double idleTimeout_;
+    double connectTimeout_;
+    double acquireTimeout_;
+    int nextConnId_;
+    TimerId sweepTimer_;
+    std::unordered_map<std::string, std::unique_ptr<Destination>> destinations_;  // ip:port
+    std::unordered_map<TcpConnection*, std::shared_ptr<Entry>> owners_;  // 池建立的、还没关闭的连接
+};
+
+#endif
@@ -0,0 +1,258 @@
+#include "Connector.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "UnixAddress.h"
+#include "../logger/Logger.h"
+#include <algorithm>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstring>
+#include <errno.h>
+
+namespace {
+
+// 本端地址和对端地址相同
+bool isSelfConnect(int sockfd) {
+    struct sockaddr_in6 local;
+    struct sockaddr_in6 peer;
+    socklen_t localLen = sizeof local;
+    socklen_t peerLen = sizeof peer;
+    if (::getsockname(sockfd, reinterpret_cast<struct sockaddr*>(&local), &localLen) < 0
+        || ::getpeername(sockfd, reinterpret_cast<struct sockaddr*>(&peer), &peerLen) < 0) {
+        return false;
+    }
+    if (local.sin6_family == AF_INET6) {
+        return local.sin6_port == peer.sin6_port
+            && memcmp(&local.sin6_addr, &peer.sin6_addr, sizeof local.sin6_addr) == 0;
+    }
+    const struct sockaddr_in* local4 = reinterpret_cast<const struct sockaddr_in*>(&local);
+    const struct sockaddr_in* peer4 = reinterpret_cast<const struct sockaddr_in*>(&peer);
+    return local4->sin_port == peer4->sin_port && local4->sin_addr.s_addr == peer4->sin_addr.s_addr;
+}
+
+}  // namespace
+
+Connector::Connector(EventLoop* loop, const InetAddress& serverAddr)
+    : loop_(loop),
+      serverAddr_(serverAddr),
+      serverName_(serverAddr.toIpPort()),
+      state_(kDisconnected),
+      connectTimeout_(0),
+      retry_(false),
+      started_(false),
+      initRetryDelay_(0.5),
+      maxRetryDelay_(30.0),
+      retryDelay_(0.5)
+{
+}
+
+Connector::Connector(EventLoop* loop, const UnixAddress& serverAddr)
+    : loop_(loop),
+      serverAddr_(0),
+      unixAddr_(new UnixAddress(serverAddr)),
+      serverName_(serverAddr.toString()),
+      state_(kDisconnected),
+      connectTimeout_(0),
+      retry_(false),
+      started_(false),
+      initRetryDelay_(0.5),
+      maxRetryDelay_(30.0),
+      retryDelay_(0.5)
+{
+}
+
+Connector::~Connector() {
+    // 还在连接中就销毁：不再关注fd，直接关闭
+    if (channel_) {
+        int sockfd = channel_->fd();
+        channel_->disableAll();
+        loop_->removeChannel(channel_.get());
+        ::close(sockfd);
+    }
+    if (timeoutTimer_.valid()) {
+        loop_->cancel(timeoutTimer_);
+    }
+    if (retryTimer_.valid()) {
+        loop_->cancel(retryTimer_);
+    }
+}
+
+void Connector::start() {
+    started_ = true;
+    retryDelay_ = initRetryDelay_;
+    connect();
+}
+
+void Connector::connect() {
+    int sockfd = unixAddr_
+        ? ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)
+        : ::socket(serverAddr_.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (sockfd < 0) {
+        int savedErrno = errno;
+        LOG_ERROR << "Connector::connect socket() failed: " << strerror(savedErrno);
+        state_ = kConnecting;
+        std::weak_ptr<Connector> weakSelf(shared_from_this());
+        loop_->queueInLoop([weakSelf, savedErrno]() {
+            std::shared_ptr<Connector> self = weakSelf.lock();
+            if (self && self->state_ == kConnecting) {
+                self->fail(savedErrno);
+            }
+        });
+        return;
+    }
+    
+    int ret = unixAddr_
+        ? ::connect(sockfd, unixAddr_->getSockAddr(), unixAddr_->getSockLen())
+        : ::connect(sockfd, serverAddr_.getSockAddr(), serverAddr_.getSockLen());
+    int savedErrno = (ret == 0) ? 0 : errno;
+    switch (savedErrno) {
+        case 0:
+        case EINPROGRESS:
+        case EINTR:
+        case EISCONN:
+            // 本机连接也可能立即成功，统一等可写事件再回调
+            connecting(sockfd);
+            break;
+        default: {
+            // ECONNREFUSED、ENETUNREACH、EADDRNOTAVAIL（本地端口耗尽）等，
+            // Unix域socket还有ENOENT（没有这个文件）和EAGAIN（监听队列满）
+            // 期间调用了stop()就不再回调
+            ::close(sockfd);
+            state_ = kConnecting;
+            std::weak_ptr<Connector> weakSelf(shared_from_this());
+            loop_->queueInLoop([weakSelf, savedErrno]() {
+                std::shared_ptr<Connector> self = weakSelf.lock();
+                if (self && self->state_ == kConnecting) {
+                    self->fail(savedErrno);
+                }
+            });
+            break;
+        }
+    }
+}
+
+void Connector::stop() {
+    started_ = false;
+    state_ = kDisconnected;
+    if (channel_) {
+        ::close(removeAndResetChannel());
+    }
+    if (timeoutTimer_.valid()) {
+        loop_->cancel(timeoutTimer_);
+        timeoutTimer_ = TimerId();
+    }
+    if (retryTimer_.valid()) {
+        loop_->cancel(retryTimer_);
+        retryTimer_ = TimerId();
+    }
+}
+
+void Connector::connecting(int sockfd) {
+    state_ = kConnecting;
+    channel_.reset(new Channel(sockfd));
+    channel_->setWriteCallback(std::bind(&Connector::handleWrite, this));
+    channel_->setErrorCallback(std::bind(&Connector::handleError, this));
+    channel_->enableWriting();
+    loop_->updateChannel(channel_.get());
+    
+    if (connectTimeout_ > 0) {
+        std::weak_ptr<Connector> weakSelf(shared_from_this());
+        timeoutTimer_ = loop_->runAfter(connectTimeout_, [weakSelf]() {
+            std::shared_ptr<Connector> self = weakSelf.lock();
+            if (self && self->state_ == kConnecting) {
+                self->timeoutTimer_ = TimerId();
+                LOG_DEBUG << "Connector to " << self->serverName_ << " timed out";
+                self->fail(ETIMEDOUT);
+            }
+        });
+    }
+}
+
+void Connector::handleWrite() {
+    if (state_ != kConnecting) {
+        return;
+    }
+    int sockfd = removeAndResetChannel();
+    
+    // 可写不代表成功：连接被拒绝时也是可写（带EPOLLERR），要看SO_ERROR
+    int err = 0;
+    socklen_t len = sizeof err;
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &err, &len) < 0) {
+        err = errno;
+    }
+    if (err != 0) {
+        LOG_DEBUG << "Connector to " << serverName_ << " failed: " << strerror(err);
+        ::close(sockfd);
+        fail(err);
+        return;
+    }
+    
+    // 连接本机一个没有监听的端口时可能连上自己（TCP同时打开），重试也是一样，当作被拒绝
+    if (!unixAddr_ && isSelfConnect(sockfd)) {
+        LOG_WARN << "Connector to " << serverName_ << " connected to itself";
+        ::close(sockfd);
+        fail(ECONNREFUSED);
+        return;
+    }
+    
+    if (timeoutTimer_.valid()) {
+        loop_->cancel(timeoutTimer_);
+        timeoutTimer_ = TimerId();
+    }
+    state_ = kConnected;
+    if (newConnectionCallback_) {
+        newConnectionCallback_(sockfd);
+    } else {
+        ::close(sockfd);
+    }
+}
+
+void Connector::handleError() {
+    // EPOLLERR一般和可写事件一起报告，同样用SO_ERROR取到具体原因
+    handleWrite();
+}
+
+void Connector::fail(int savedErrno) {
+    if (channel_) {
+        ::close(removeAndResetChannel());
+    }
+    if (timeoutTimer_.valid()) {
+        loop_->cancel(timeoutTimer_);
+        timeoutTimer_ = TimerId();
+    }
+    state_ = kDisconnected;
+    
+    // 先安排重试再回调：回调里调用stop()可以取消这次重试
+    if (retry_ && started_) {
+        retry();
+    }
+    if (errorCallback_) {
+        errorCallback_(savedErrno);
+    }
+}
+
+void Connector::retry() {
+    LOG_INFO << "Connector: retry connecting to " << serverName_
+             << " in " << retryDelay_ << " seconds";
+    std::weak_ptr<Connector> weakSelf(shared_from_this());
+    retryTimer_ = loop_->runAfter(retryDelay_, [weakSelf]() {
+        std::shared_ptr<Connector> self = weakSelf.lock();
+        if (self && self->started_) {
+            self->retryTimer_ = TimerId();
+            self->connect();
+        }
+    });
+    retryDelay_ = std::min(retryDelay_ * 2, maxRetryDelay_);
+}
+
+int Connector::removeAndResetChannel() {
+    channel_->disableAll();
+    loop_->removeChannel(channel_.get());
+    int sockfd = channel_->fd();
+    
+    // 可能正在Channel::handleEvent里，不能马上销毁Channel
+    std::shared_ptr<Channel> channel(channel_.release());
+    loop_->queueInLoop([channel]() {});
+    return sockfd;
+}
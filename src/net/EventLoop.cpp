@@ -1,6 +1,7 @@
 #include "EventLoop.h"
 #include "Channel.h"
 #include "Poller.h"
+#include "TimerQueue.h"
 #include <iostream>
 #include <sys/eventfd.h>
 #include <unistd.h>
@@ -24,8 +25,10 @@ EventLoop::EventLoop()
       callingPendingFunctors_(false),
       threadId_(CurrentThread::tid()),
       poller_(new Poller()),
+      timerQueue_(new TimerQueue(this)),
       wakeupFd_(createEventfd()),
-      wakeupChannel_(new Channel(wakeupFd_))  // Channel只需要fd
+      wakeupChannel_(new Channel(wakeupFd_)),  // Channel只需要fd
+      bufferedBytes_(0)
 {
     std::cout << "EventLoop created in thread " << threadId_ << std::endl;
     
@@ -34,6 +37,7 @@ EventLoop::EventLoop()
         std::bind(&EventLoop::handleRead, this));
     // 注册wakeupChannel到poller，监听读事件
     wakeupChannel_->enableReading();
+    updateChannel(wakeupChannel_.get());
 }
 
 // 析构函数
@@ -130,6 +134,27 @@ void EventLoop::wakeup() {
     }
 }
 
+// 在指定时间执行回调
+TimerId EventLoop::runAt(Timestamp time, Timer::TimerCallback cb) {
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+// delay秒之后执行回调
+TimerId EventLoop::runAfter(double delay, Timer::TimerCallback cb) {
+    return runAt(addTime(Timestamp::now(), delay), std::move(cb));
+}
+
+// 每隔interval秒执行一次回调
+TimerId EventLoop::runEvery(double interval, Timer::TimerCallback cb) {
+    Timestamp time(addTime(Timestamp::now(), interval));
+    return timerQueue_->addTimer(std::move(cb), time, interval);
+}
+
+// 取消定时器
+void EventLoop::cancel(TimerId timerId) {
+    timerQueue_->cancel(timerId);
+}
+
 // 处理eventfd的读事件
 void EventLoop::handleRead() {
     uint64_t one = 1;
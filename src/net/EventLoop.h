@@ -3,6 +3,8 @@
 
 #include "../base/noncopyable.h"
 #include "../base/CurrentThread.h"
+#include "../base/Timestamp.h"
+#include "Timer.h"
 #include <memory>
 #include <vector>
 #include <atomic>
@@ -11,6 +13,7 @@
 
 class Channel;
 class Poller;
+class TimerQueue;
 
 // EventLoop：事件循环（Reactor模式的核心）
 // 
@@ -44,6 +47,19 @@ public:
     // 唤醒EventLoop线程
     void wakeup();
     
+    // === 定时器接口（线程安全） ===
+    // 在指定时间执行回调
+    TimerId runAt(Timestamp time, Timer::TimerCallback cb);
+    
+    // delay秒之后执行回调
+    TimerId runAfter(double delay, Timer::TimerCallback cb);
+    
+    // 每隔interval秒执行一次回调
+    TimerId runEvery(double interval, Timer::TimerCallback cb);
+    
+    // 取消定时器
+    void cancel(TimerId timerId);
+    
     // 更新Channel（其实是转发给Poller）
     void updateChannel(Channel* channel);
     
@@ -57,6 +73,18 @@ public:
     
     // 判断是否在循环中
     bool isLooping() const { return looping_; }
+    
+    // === 缓冲区内存统计 ===
+    // 这个loop上所有连接的Buffer当前占用的内存（字节）
+    // 只在loop线程中修改，其他线程可以随时读取（用于监控）
+    size_t bufferedBytes() const {
+        return bufferedBytes_.load(std::memory_order_relaxed);
+    }
+    
+    // 由TcpConnection在loop线程中调用，delta可以为负
+    void addBufferedBytes(ssize_t delta) {
+        bufferedBytes_.fetch_add(static_cast<size_t>(delta), std::memory_order_relaxed);
+    }
 
 private:
     using ChannelList = std::vector<Channel*>;
@@ -73,6 +101,7 @@ private:
     
     const pid_t threadId_;              // 创建EventLoop的线程ID
     std::unique_ptr<Poller> poller_;   // Poller对象（用unique_ptr自动管理）
+    std::unique_ptr<TimerQueue> timerQueue_; // 定时器队列（依赖poller_，必须在其后构造）
     
     int wakeupFd_;                      // eventfd，用于唤醒EventLoop
     std::unique_ptr<Channel> wakeupChannel_; // 监听wakeupFd_的Channel
@@ -81,6 +110,8 @@ private:
     
     std::mutex mutex_;                  // 保护pendingFunctors_
     std::vector<Functor> pendingFunctors_; // 待执行的回调函数
+    
+    std::atomic<size_t> bufferedBytes_;  // 连接Buffer占用的内存统计
 };
 
 #endif
\ No newline at end of file
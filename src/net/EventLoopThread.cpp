@@ -2,9 +2,10 @@
 #include "EventLoop.h"
 #include <iostream>
 
-EventLoopThread::EventLoopThread(const std::string& name)
+EventLoopThread::EventLoopThread(const ThreadInitCallback& cb, const std::string& name)
     : loop_(nullptr),
-      name_(name)
+      name_(name),
+      callback_(cb)
 {
     std::cout << "EventLoopThread[" << name_ << "] created" << std::endl;
 }
@@ -47,6 +48,11 @@ void EventLoopThread::threadFunc() {
     // 在新线程中创建EventLoop
     EventLoop loop;
     
+    // 在startLoop()返回之前完成：初始化回调里准备的每个loop的数据，之后不需要加锁就能读
+    if (callback_) {
+        callback_(&loop);
+    }
+    
     {
         std::unique_lock<std::mutex> lock(mutex_);
         loop_ = &loop;
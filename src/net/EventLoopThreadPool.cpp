@@ -18,7 +18,7 @@ EventLoopThreadPool::~EventLoopThreadPool() {
     std::cout << "EventLoopThreadPool[" << name_ << "] destroyed" << std::endl;
 }
 
-void EventLoopThreadPool::start() {
+void EventLoopThreadPool::start(const ThreadInitCallback& cb) {
     started_ = true;
     
     // 创建numThreads_个线程
@@ -27,7 +27,7 @@ void EventLoopThreadPool::start() {
         snprintf(buf, sizeof(buf), "%s%d", name_.c_str(), i);
         
         // 创建EventLoopThread
-        auto t = std::make_unique<EventLoopThread>(buf);
+        auto t = std::make_unique<EventLoopThread>(cb, buf);
         
         // 启动线程，获取EventLoop
         loops_.push_back(t->startLoop());
@@ -38,6 +38,9 @@ void EventLoopThreadPool::start() {
     
     // 如果numThreads_为0，说明是单线程模式
     if (numThreads_ == 0) {
+        if (cb) {
+            cb(baseLoop_);
+        }
         std::cout << "EventLoopThreadPool[" << name_ << "] single thread mode" << std::endl;
     } else {
         std::cout << "EventLoopThreadPool[" << name_ << "] started with " 
@@ -5,6 +5,7 @@
 #include <vector>
 #include <memory>
 #include <string>
+#include <functional>
 
 class EventLoop;
 class EventLoopThread;
@@ -15,14 +16,16 @@ class EventLoopThread;
 // 主要用于TcpServer，把新连接分配给不同的EventLoop
 class EventLoopThreadPool : noncopyable {
 public:
+    using ThreadInitCallback = std::function<void(EventLoop*)>;
+    
     EventLoopThreadPool(EventLoop* baseLoop, const std::string& name);
     ~EventLoopThreadPool();
     
     // 设置线程数量
     void setThreadNum(int numThreads) { numThreads_ = numThreads; }
     
-    // 启动线程池
-    void start();
+    // 启动线程池，cb在每个IO线程开始循环之前调用（没有IO线程时对baseLoop调用一次）
+    void start(const ThreadInitCallback& cb = ThreadInitCallback());
     
     // 获取下一个EventLoop（轮询方式）
     EventLoop* getNextLoop();
@@ -2,45 +2,141 @@
 #include <cstring>      // 为了使用 memset
 #include <arpa/inet.h>  // 为了使用 inet_ntop
 
+namespace {
+
+// 把v的十进制写到p，返回写入的字节数（v不超过65535）
+size_t formatUint(char* p, unsigned v) {
+    char tmp[8];
+    size_t n = 0;
+    do {
+        tmp[n++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    for (size_t i = 0; i < n; ++i) {
+        p[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+// IPv4地址的点分十进制，比inet_ntop少一次格式解析
+size_t formatIpv4(char* p, const struct in_addr& addr) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&addr.s_addr);
+    size_t n = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (i > 0) {
+            p[n++] = '.';
+        }
+        n += formatUint(p + n, bytes[i]);
+    }
+    return n;
+}
+
+}  // namespace
+
 // 构造函数：根据端口号创建地址（监听所有接口）
 InetAddress::InetAddress(uint16_t port) {
-    memset(&addr_, 0, sizeof(addr_));
+    memset(&addr6_, 0, sizeof(addr6_));
     addr_.sin_family = AF_INET;
     addr_.sin_port = htons(port);
     addr_.sin_addr.s_addr = INADDR_ANY;
 }
 
+InetAddress::InetAddress(uint16_t port, bool loopbackOnly, bool ipv6) {
+    memset(&addr6_, 0, sizeof(addr6_));
+    if (ipv6) {
+        addr6_.sin6_family = AF_INET6;
+        addr6_.sin6_port = htons(port);
+        addr6_.sin6_addr = loopbackOnly ? in6addr_loopback : in6addr_any;
+    } else {
+        addr_.sin_family = AF_INET;
+        addr_.sin_port = htons(port);
+        addr_.sin_addr.s_addr = htonl(loopbackOnly ? INADDR_LOOPBACK : INADDR_ANY);
+    }
+}
+
 // 构造函数：指定IP和端口
 InetAddress::InetAddress(const std::string& ip, uint16_t port) {
-    memset(&addr_, 0, sizeof(addr_));
-    addr_.sin_family = AF_INET;
-    addr_.sin_port = htons(port);
-    inet_pton(AF_INET, ip.c_str(), &addr_.sin_addr);
+    memset(&addr6_, 0, sizeof(addr6_));
+    if (ip.find(':') != std::string::npos) {
+        std::string host = ip;
+        if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+            host = host.substr(1, host.size() - 2);
+        }
+        addr6_.sin6_family = AF_INET6;
+        addr6_.sin6_port = htons(port);
+        inet_pton(AF_INET6, host.c_str(), &addr6_.sin6_addr);
+    } else {
+        addr_.sin_family = AF_INET;
+        addr_.sin_port = htons(port);
+        inet_pton(AF_INET, ip.c_str(), &addr_.sin_addr);
+    }
 }
 
 // 构造函数：从sockaddr_in构造
-InetAddress::InetAddress(const struct sockaddr_in& addr)
-    : addr_(addr) {
+InetAddress::InetAddress(const struct sockaddr_in& addr) {
+    memset(&addr6_, 0, sizeof(addr6_));
+    addr_ = addr;
+}
+
+InetAddress::InetAddress(const struct sockaddr_in6& addr) {
+    memset(&addr6_, 0, sizeof(addr6_));
+    if (addr.sin6_family == AF_INET) {
+        memcpy(&addr_, &addr, sizeof(addr_));
+    } else {
+        addr6_ = addr;
+    }
 }
 
 uint16_t InetAddress::toPort() const {
+    // sin_port和sin6_port位置相同
     return ntohs(addr_.sin_port);
 }
 
 std::string InetAddress::toIp() const {
-    char buf[64] = {0};
-    inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof(buf));
-    return std::string(buf);
+    char buf[INET6_ADDRSTRLEN] = {0};
+    if (isIpv6()) {
+        inet_ntop(AF_INET6, &addr6_.sin6_addr, buf, sizeof(buf));
+        return std::string(buf);
+    }
+    return std::string(buf, formatIpv4(buf, addr_.sin_addr));
 }
 
 std::string InetAddress::toIpPort() const {
-    return toIp() + ":" + std::to_string(toPort());
+    char buf[kMaxIpPortLength];
+    size_t n = toIpPort(buf, sizeof(buf));
+    return std::string(buf, n);
+}
+
+size_t InetAddress::toIpPort(char* buf, size_t size) const {
+    if (size == 0) {
+        return 0;
+    }
+    // 先在栈上格式化，buf不够大时截断
+    char tmp[kMaxIpPortLength];
+    size_t n = 0;
+    if (isIpv6()) {
+        tmp[n++] = '[';
+        inet_ntop(AF_INET6, &addr6_.sin6_addr, tmp + n, INET6_ADDRSTRLEN);
+        n += strlen(tmp + n);
+        tmp[n++] = ']';
+    } else {
+        n = formatIpv4(tmp, addr_.sin_addr);
+    }
+    tmp[n++] = ':';
+    n += formatUint(tmp + n, toPort());
+    
+    if (n >= size) {
+        n = size - 1;
+    }
+    memcpy(buf, tmp, n);
+    buf[n] = '\0';
+    return n;
 }
 
 const struct sockaddr* InetAddress::getSockAddr() const {
-    return reinterpret_cast<const struct sockaddr*>(&addr_);
+    return reinterpret_cast<const struct sockaddr*>(&addr6_);
 }
 
 socklen_t InetAddress::getSockLen() const {
-    return sizeof(addr_);
-}
\ No newline at end of file
+    return isIpv6() ? sizeof(addr6_) : sizeof(addr_);
+}
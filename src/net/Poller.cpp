@@ -1,9 +1,9 @@
 #include "Poller.h"
 #include "Channel.h"
+#include "../logger/Logger.h"
 #include <sys/epoll.h>
 #include <unistd.h>
 #include <cstring>
-#include <iostream>
 #include <cassert>
 
 // 构造函数：创建epoll实例
@@ -12,7 +12,7 @@ Poller::Poller() {
     // 返回值是epoll的文件描述符
     epollfd_ = epoll_create1(0);
     if (epollfd_ < 0) {
-        std::cerr << "Poller::Poller() epoll_create1 failed" << std::endl;
+        LOG_ERROR << "Poller::Poller() epoll_create1 failed";
     }
 }
 
@@ -39,7 +39,7 @@ void Poller::poll(int timeoutMs, ChannelList* activeChannels) {
     int numEvents = epoll_wait(epollfd_, events, 128, timeoutMs);
     
     if (numEvents > 0) {
-        std::cout << "Poller::poll() " << numEvents << " events happened" << std::endl;
+        LOG_DEBUG << "Poller::poll() " << numEvents << " events happened";
         
         // 遍历所有发生的事件
         for (int i = 0; i < numEvents; ++i) {
@@ -54,9 +54,9 @@ void Poller::poll(int timeoutMs, ChannelList* activeChannels) {
             activeChannels->push_back(channel);
         }
     } else if (numEvents == 0) {
-        std::cout << "Poller::poll() timeout" << std::endl;
+        LOG_DEBUG << "Poller::poll() timeout";
     } else {
-        std::cerr << "Poller::poll() error" << std::endl;
+        LOG_ERROR << "Poller::poll() error";
     }
 }
 
@@ -69,7 +69,7 @@ void Poller::updateChannel(Channel* channel) {
     
     if (it == channels_.end()) {
         // 新的Channel，需要添加到epoll
-        std::cout << "Poller::updateChannel() ADD fd=" << fd << std::endl;
+        LOG_DEBUG << "Poller::updateChannel() ADD fd=" << fd;
         
         // 保存到map中
         channels_[fd] = channel;
@@ -82,11 +82,11 @@ void Poller::updateChannel(Channel* channel) {
         
         // 添加到epoll
         if (epoll_ctl(epollfd_, EPOLL_CTL_ADD, fd, &event) < 0) {
-            std::cerr << "Poller::updateChannel() EPOLL_CTL_ADD failed" << std::endl;
+            LOG_ERROR << "Poller::updateChannel() EPOLL_CTL_ADD failed";
         }
     } else {
         // 已存在的Channel，修改它关注的事件
-        std::cout << "Poller::updateChannel() MOD fd=" << fd << std::endl;
+        LOG_DEBUG << "Poller::updateChannel() MOD fd=" << fd;
         
         // 更新map中的指针（虽然通常不会变）
         channels_[fd] = channel;
@@ -99,7 +99,7 @@ void Poller::updateChannel(Channel* channel) {
         
         // 修改epoll中的事件
         if (epoll_ctl(epollfd_, EPOLL_CTL_MOD, fd, &event) < 0) {
-            std::cerr << "Poller::updateChannel() EPOLL_CTL_MOD failed" << std::endl;
+            LOG_ERROR << "Poller::updateChannel() EPOLL_CTL_MOD failed";
         }
     }
 }
@@ -112,11 +112,11 @@ void Poller::removeChannel(Channel* channel) {
     assert(channels_.find(fd) != channels_.end());
     assert(channels_[fd] == channel);
     
-    std::cout << "Poller::removeChannel() DEL fd=" << fd << std::endl;
+    LOG_DEBUG << "Poller::removeChannel() DEL fd=" << fd;
     
     // 从epoll中删除
     if (::epoll_ctl(epollfd_, EPOLL_CTL_DEL, fd, nullptr) < 0) {
-        std::cerr << "epoll_ctl DEL error: " << strerror(errno) << std::endl;
+        LOG_ERROR << "epoll_ctl DEL error: " << strerror(errno);
     }
     
     // 从map中删除
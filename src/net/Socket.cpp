@@ -1,5 +1,6 @@
 #include "Socket.h"
 #include "InetAddress.h"
+#include "UnixAddress.h"
 #include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -10,30 +11,44 @@ Socket::~Socket() {
     close(sockfd_);
 }
 
-void Socket::bindAddress(const InetAddress& addr) {
+bool Socket::bindAddress(const InetAddress& addr) {
     int ret = bind(sockfd_, addr.getSockAddr(), addr.getSockLen());
     if (ret < 0) {
         std::cerr << "Socket::bindAddress failed" << std::endl;
+        return false;
     }
+    return true;
 }
 
-void Socket::listen() {
-    int ret = ::listen(sockfd_, 128);  // 全连接队列最大128
+bool Socket::bindAddress(const UnixAddress& addr) {
+    int ret = bind(sockfd_, addr.getSockAddr(), addr.getSockLen());
+    if (ret < 0) {
+        std::cerr << "Socket::bindAddress " << addr.toString() << " failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void Socket::listen(int backlog) {
+    int ret = ::listen(sockfd_, backlog);
     if (ret < 0) {
         std::cerr << "Socket::listen failed" << std::endl;
     }
 }
 
 int Socket::accept(InetAddress* peeraddr) {
-    struct sockaddr_in addr;
+    // sockaddr_in6放得下IPv4和IPv6两种对端地址
+    struct sockaddr_in6 addr;
     socklen_t len = sizeof(addr);
     
     // 从全连接队列取出一个连接
-    int connfd = ::accept(sockfd_, 
-                         reinterpret_cast<struct sockaddr*>(&addr), 
-                         &len);
+    // 已连接的socket必须是非阻塞的：对端读得慢时send()返回EAGAIN，数据留在输出缓冲区，
+    // 而不是卡住整个IO线程
+    int connfd = ::accept4(sockfd_, 
+                          peeraddr ? reinterpret_cast<struct sockaddr*>(&addr) : nullptr,
+                          peeraddr ? &len : nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
     
-    if (connfd >= 0) {
+    if (connfd >= 0 && peeraddr) {
         // 设置对端地址
         *peeraddr = InetAddress(addr);
     }
@@ -69,4 +84,10 @@ void Socket::setTcpNoDelay(bool on) {
     int optval = on ? 1 : 0;
     ::setsockopt(sockfd_, IPPROTO_TCP, TCP_NODELAY,
                 &optval, sizeof(optval));
+}
+
+void Socket::setIpv6Only(bool on) {
+    int optval = on ? 1 : 0;
+    ::setsockopt(sockfd_, IPPROTO_IPV6, IPV6_V6ONLY,
+                &optval, sizeof(optval));
 }
\ No newline at end of file
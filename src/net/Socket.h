@@ -4,6 +4,7 @@
 #include "../base/noncopyable.h"
 
 class InetAddress;
+class UnixAddress;
 
 // Socket类：封装socket文件描述符
 // 
@@ -19,9 +20,11 @@ public:
     int fd() const { return sockfd_; }
     
     // 服务端操作
-    void bindAddress(const InetAddress& addr);
-    void listen();
-    int accept(InetAddress* peeraddr);
+    // 失败时返回false
+    bool bindAddress(const InetAddress& addr);
+    bool bindAddress(const UnixAddress& addr);
+    void listen(int backlog = 128);  // backlog：全连接队列长度
+    int accept(InetAddress* peeraddr);  // peeraddr为空时不取对端地址（Unix域socket）
     
     // 通用操作
     void shutdownWrite();
@@ -31,6 +34,7 @@ public:
     void setReusePort(bool on);
     void setKeepAlive(bool on);
     void setTcpNoDelay(bool on);  // 禁用Nagle算法
+    void setIpv6Only(bool on);    // IPv6 socket只接受IPv6连接（关闭时同时接受IPv4，bind之前设置）
 
 private:
     const int sockfd_;
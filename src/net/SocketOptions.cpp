@@ -0,0 +1,93 @@
+#include "SocketOptions.h"
+#include "../logger/Logger.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <errno.h>
+#include <string.h>
+
+namespace {
+
+// 设置一个int选项，失败时打印警告
+void setIntOption(int sockfd, int level, int name, int value, const char* what) {
+    if (::setsockopt(sockfd, level, name, &value, sizeof value) < 0) {
+        LOG_WARN << "SocketOptions: setsockopt(" << what << ", " << value << ") failed on fd="
+                 << sockfd << ": " << strerror(errno);
+    }
+}
+
+}  // namespace
+
+SocketOptions SocketOptions::lowLatency() {
+    SocketOptions options;
+    options.backlog = 1024;
+    options.tcpNoDelay = true;
+    options.quickAck = true;
+    options.busyPollMicros = 50;
+    return options;
+}
+
+SocketOptions SocketOptions::requestResponse() {
+    SocketOptions options;
+    options.backlog = 1024;
+    options.deferAcceptSeconds = 1;
+    options.fastOpenQueue = 256;
+    options.tcpNoDelay = true;
+    options.userTimeoutMs = 10000;
+    return options;
+}
+
+SocketOptions SocketOptions::bulk() {
+    SocketOptions options;
+    options.backlog = 1024;
+    options.sendBufferSize = 4 * 1024 * 1024;
+    options.receiveBufferSize = 4 * 1024 * 1024;
+    return options;
+}
+
+void SocketOptions::applyToListenSocket(int sockfd, bool tcp) const {
+    if (!tcp) {
+        return;
+    }
+    if (deferAcceptSeconds > 0) {
+        setIntOption(sockfd, IPPROTO_TCP, TCP_DEFER_ACCEPT, deferAcceptSeconds, "TCP_DEFER_ACCEPT");
+    }
+    if (fastOpenQueue > 0) {
+        setIntOption(sockfd, IPPROTO_TCP, TCP_FASTOPEN, fastOpenQueue, "TCP_FASTOPEN");
+    }
+    // 接收缓冲区决定SYN里通告的窗口扩大因子，accept之后再设置就晚了
+    if (sendBufferSize > 0) {
+        setIntOption(sockfd, SOL_SOCKET, SO_SNDBUF, sendBufferSize, "SO_SNDBUF");
+    }
+    if (receiveBufferSize > 0) {
+        setIntOption(sockfd, SOL_SOCKET, SO_RCVBUF, receiveBufferSize, "SO_RCVBUF");
+    }
+}
+
+void SocketOptions::applyToConnection(int sockfd, bool tcp) const {
+    if (!tcp) {
+        if (sendBufferSize > 0) {
+            setIntOption(sockfd, SOL_SOCKET, SO_SNDBUF, sendBufferSize, "SO_SNDBUF");
+        }
+        if (receiveBufferSize > 0) {
+            setIntOption(sockfd, SOL_SOCKET, SO_RCVBUF, receiveBufferSize, "SO_RCVBUF");
+        }
+        return;
+    }
+    // 下面这些不一定从监听socket继承（TCP_QUICKACK本来就不是持久的），逐个连接设置
+    if (tcpNoDelay) {
+        setIntOption(sockfd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+    }
+    if (keepAlive) {
+        setIntOption(sockfd, SOL_SOCKET, SO_KEEPALIVE, 1, "SO_KEEPALIVE");
+    }
+    if (userTimeoutMs > 0) {
+        setIntOption(sockfd, IPPROTO_TCP, TCP_USER_TIMEOUT, static_cast<int>(userTimeoutMs), "TCP_USER_TIMEOUT");
+    }
+    if (busyPollMicros > 0) {
+        setIntOption(sockfd, SOL_SOCKET, SO_BUSY_POLL, busyPollMicros, "SO_BUSY_POLL");
+    }
+    if (quickAck) {
+        setIntOption(sockfd, IPPROTO_TCP, TCP_QUICKACK, 1, "TCP_QUICKACK");
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef TINY_NETWORK_NET_SOCKETOPTIONS_H
+#define TINY_NETWORK_NET_SOCKETOPTIONS_H
+
+// SocketOptions：监听socket和accept得到的连接上要设置的选项，和InetAddress一样是一个值类型
+//
+// 使用方式：
+// TcpServer server(&loop, "Server", 8080);
+// server.setSocketOptions(SocketOptions::requestResponse());  // start()之前
+//
+// 默认构造的值和原来的行为一样：backlog为128，其他选项都不设置（用系统默认值）
+// 每个字段为0/false表示不设置；设置失败只打印警告，不影响监听和连接
+//
+// 监听时设置（accept得到的TCP连接继承）：backlog、TCP_DEFER_ACCEPT、TCP_FASTOPEN、SO_SNDBUF/SO_RCVBUF
+// 每个连接accept之后设置：TCP_NODELAY、SO_KEEPALIVE、TCP_USER_TIMEOUT、SO_BUSY_POLL、TCP_QUICKACK
+// Unix域socket只用backlog和缓冲区大小（在accept之后设置，Unix域socket不继承）
+struct SocketOptions {
+    int backlog;                // listen()的全连接队列长度，超过net.core.somaxconn时被内核截断
+    int deferAcceptSeconds;     // TCP_DEFER_ACCEPT：客户端发来数据（或者等了这么多秒）才唤醒accept
+    int fastOpenQueue;          // TCP_FASTOPEN：SYN里带数据的半连接队列长度（需要net.ipv4.tcp_fastopen开启服务端）
+    int sendBufferSize;         // SO_SNDBUF（字节）
+    int receiveBufferSize;      // SO_RCVBUF（字节），设置之后内核不再自动调整接收窗口
+    bool tcpNoDelay;            // TCP_NODELAY：禁用Nagle算法
+    bool keepAlive;             // SO_KEEPALIVE
+    unsigned int userTimeoutMs; // TCP_USER_TIMEOUT：发出的数据这么久没有确认就断开连接
+    int busyPollMicros;         // SO_BUSY_POLL：没有数据时在网卡队列上忙等的微秒数（超过net.core.busy_poll需要CAP_NET_ADMIN）
+    bool quickAck;              // TCP_QUICKACK：连接刚建立时立即回ACK（内核之后可能恢复延迟确认）
+    
+    SocketOptions()
+        : backlog(128),
+          deferAcceptSeconds(0),
+          fastOpenQueue(0),
+          sendBufferSize(0),
+          receiveBufferSize(0),
+          tcpNoDelay(false),
+          keepAlive(false),
+          userTimeoutMs(0),
+          busyPollMicros(0),
+          quickAck(false) {}
+    
+    // === 预设 ===
+    // 交互式的小消息（游戏、行情推送）：关闭Nagle，立即ACK，忙等50微秒
+    static SocketOptions lowLatency();
+    
+    // 客户端先发请求的短连接（HTTP、RPC）：请求到达才accept，支持TFO，对端失联10秒断开
+    static SocketOptions requestResponse();
+    
+    // 大块传输：4MB收发缓冲区（不再自动调整），更长的队列
+    static SocketOptions bulk();
+    
+    // 监听socket：listen()之前调用，TCP的缓冲区大小要在这里设置才能影响窗口扩大因子
+    void applyToListenSocket(int sockfd, bool tcp) const;
+    
+    // accept得到的连接：交给TcpConnection之前调用
+    void applyToConnection(int sockfd, bool tcp) const;
+};
+
+#endif
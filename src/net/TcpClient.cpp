@@ -0,0 +1,135 @@
+#include "TcpClient.h"
+#include "Connector.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "UnixAddress.h"
+#include "../logger/Logger.h"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+TcpClient::TcpClient(EventLoop* loop, const InetAddress& serverAddr, const std::string& name)
+    : loop_(loop),
+      connector_(std::make_shared<Connector>(loop, serverAddr)),
+      name_(name),
+      serverName_(serverAddr.toIpPort()),
+      retry_(false),
+      connect_(false),
+      nextConnId_(1)
+{
+    initConnector();
+}
+
+TcpClient::TcpClient(EventLoop* loop, const UnixAddress& serverAddr, const std::string& name)
+    : loop_(loop),
+      connector_(std::make_shared<Connector>(loop, serverAddr)),
+      name_(name),
+      serverName_(serverAddr.toString()),
+      retry_(false),
+      connect_(false),
+      nextConnId_(1)
+{
+    initConnector();
+}
+
+void TcpClient::initConnector() {
+    // 连不上就一直按退避时间重试，直到连上或者stop()
+    connector_->setRetry(true);
+    connector_->setNewConnectionCallback(
+        std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
+    connector_->setErrorCallback([this](int savedErrno) {
+        LOG_DEBUG << "TcpClient[" << name_ << "] connect to " << serverName_
+                  << " failed: " << strerror(savedErrno);
+    });
+    LOG_INFO << "TcpClient[" << name_ << "] created, server=" << serverName_;
+}
+
+TcpClient::~TcpClient() {
+    assert(loop_->isInLoopThread());
+    LOG_INFO << "TcpClient[" << name_ << "] destructing";
+    
+    connector_->stop();
+    ConnectionPtr conn;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        conn.swap(connection_);
+    }
+    if (conn) {
+        // 关闭回调原来指向this，换成只做清理的版本
+        EventLoop* loop = loop_;
+        conn->setCloseCallback([loop](const ConnectionPtr& c) {
+            loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, c));
+        });
+        conn->forceClose();
+    }
+}
+
+void TcpClient::setConnectTimeout(double seconds) {
+    connector_->setConnectTimeout(seconds);
+}
+
+void TcpClient::setRetryDelay(double initial, double max) {
+    connector_->setRetryDelay(initial, max);
+}
+
+void TcpClient::connect() {
+    LOG_INFO << "TcpClient[" << name_ << "] connecting to " << serverName_;
+    connect_ = true;
+    std::shared_ptr<Connector> connector = connector_;
+    loop_->runInLoop([connector]() { connector->start(); });
+}
+
+void TcpClient::disconnect() {
+    connect_ = false;
+    ConnectionPtr conn = connection();
+    if (conn) {
+        loop_->runInLoop([conn]() { conn->shutdown(); });
+    }
+}
+
+void TcpClient::stop() {
+    connect_ = false;
+    std::shared_ptr<Connector> connector = connector_;
+    loop_->runInLoop([connector]() { connector->stop(); });
+}
+
+TcpClient::ConnectionPtr TcpClient::connection() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return connection_;
+}
+
+void TcpClient::newConnection(int sockfd) {
+    // 连接名：客户端名 + 服务器地址 + 序号
+    char buf[32];
+    snprintf(buf, sizeof(buf), "#%d", nextConnId_);
+    ++nextConnId_;
+    std::string connName = name_ + ":" + serverName_ + buf;
+    
+    LOG_INFO << "TcpClient::newConnection [" << connName << "] fd=" << sockfd;
+    
+    auto conn = std::make_shared<TcpConnection>(loop_, connName, sockfd);
+    conn->setConnectionCallback(connectionCallback_);
+    conn->setMessageCallback(messageCallback_);
+    conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setCloseCallback(
+        std::bind(&TcpClient::removeConnection, this, std::placeholders::_1));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection_ = conn;
+    }
+    conn->connectEstablished();
+}
+
+void TcpClient::removeConnection(const ConnectionPtr& conn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        assert(connection_ == conn);
+        connection_.reset();
+    }
+    loop_->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    
+    if (retry_ && connect_) {
+        LOG_INFO << "TcpClient[" << name_ << "] reconnecting to " << serverName_;
+        connector_->start();
+    }
+}
@@ -1,22 +1,152 @@
 #include "TcpConnection.h"
 #include "Channel.h"
 #include "EventLoop.h"
+#include "../logger/Logger.h"
 #include <unistd.h>
 #include <sys/socket.h>
-#include <iostream>
+#include <sys/sendfile.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/errqueue.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <cstring>
+#include <map>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
+const size_t TcpConnection::kDefaultShrinkThreshold;
+const size_t TcpConnection::kMaxReceivedFds;
+const size_t TcpConnection::kZeroCopyThreshold;
+const size_t TcpConnection::kForwardHighWaterMark;
+const size_t TcpConnection::kMaxContextTypes;
+
+namespace {
+
+// 转发用的pipe容量：每次splice最多移动这么多（超过fs.pipe-max-size时保持默认的64KB）
+const int kForwardPipeSize = 1024 * 1024;
+
+// 每个loop线程一个空闲pipe池：转发的数据在pipe里时由目标连接独占，写空了马上放回，
+// 所以pipe的数量只和同时写不出去的连接数有关，而不是连接总数
+class PipePool {
+public:
+    ~PipePool() {
+        for (const std::pair<int, int>& p : pipes_) {
+            ::close(p.first);
+            ::close(p.second);
+        }
+    }
+    
+    bool acquire(int fds[2]) {
+        if (!pipes_.empty()) {
+            fds[0] = pipes_.back().first;
+            fds[1] = pipes_.back().second;
+            pipes_.pop_back();
+            return true;
+        }
+        if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0) {
+            return false;
+        }
+        ::fcntl(fds[1], F_SETPIPE_SZ, kForwardPipeSize);
+        return true;
+    }
+    
+    // 只能放回空的pipe
+    void release(int fds[2]) {
+        if (pipes_.size() < kMaxIdle) {
+            pipes_.push_back(std::make_pair(fds[0], fds[1]));
+        } else {
+            ::close(fds[0]);
+            ::close(fds[1]);
+        }
+    }
+
+private:
+    static const size_t kMaxIdle = 64;
+    std::vector<std::pair<int, int>> pipes_;
+};
+
+thread_local PipePool t_pipePool;
+
+// splice()写socket时没有MSG_NOSIGNAL，对端重置会产生SIGPIPE：进程还是默认处理方式时改为忽略
+void ignoreSigPipe() {
+    static const bool ignored = []() {
+        struct sigaction sa;
+        if (::sigaction(SIGPIPE, nullptr, &sa) == 0 && sa.sa_handler == SIG_DFL) {
+            ::signal(SIGPIPE, SIG_IGN);
+        }
+        return true;
+    }();
+    (void)ignored;
+}
+
+}  // namespace
 
 // 构造函数：初始化一个TCP连接
 TcpConnection::TcpConnection(EventLoop* loop,
                            const std::string& name,
                            int sockfd)
+    : TcpConnection(loop, name, nullptr, 0, sockfd)
+{
+}
+
+TcpConnection::TcpConnection(EventLoop* loop,
+                             const std::shared_ptr<const std::string>& namePrefix,
+                             uint64_t id,
+                             int sockfd)
+    : TcpConnection(loop, std::string(), namePrefix, id, sockfd)
+{
+}
+
+TcpConnection::TcpConnection(EventLoop* loop,
+                             const std::string& name,
+                             const std::shared_ptr<const std::string>& namePrefix,
+                             uint64_t id,
+                             int sockfd)
     : loop_(loop),
       name_(name),
+      namePrefix_(namePrefix),
+      id_(id),
+      registrySlot_(0),
       sockfd_(sockfd),
       channel_(new Channel(sockfd)),  // 创建Channel管理这个sockfd
-      state_(kConnecting)             // 初始状态为正在连接
+      state_(kConnecting),            // 初始状态为正在连接
+      closed_(false),
+      zeroCopy_(false),
+      nextZeroCopyId_(0),
+      zeroCopyCopied_(0),
+      shrinkThreshold_(kDefaultShrinkThreshold),
+      idleShrinkDelay_(5.0),
+      idleShrinkPending_(false),
+      activity_(0),
+      accountedBytes_(0),
+      inMessageCallback_(false),
+      messageCallbackPending_(false),
+      forwarding_(false),
+      forwardSplice_(false),
+      forwardPaused_(false),
+      pipeBytes_(0),
+      splicedBytes_(0),
+      forwardCopiedBytes_(0),
+      fdPassing_(false)
 {
-    std::cout << "TcpConnection::ctor[" << name_ << "] fd=" << sockfd_ << std::endl;
+    pipeFds_[0] = pipeFds_[1] = -1;
+    LOG_DEBUG << "TcpConnection::ctor[" << this->name() << "] fd=" << sockfd_;
     
     // 设置Channel的回调函数
     // 当sockfd可读时，Channel会调用handleRead
@@ -25,84 +155,224 @@ TcpConnection::TcpConnection(EventLoop* loop,
     // 当sockfd可写时，Channel会调用handleWrite
     channel_->setWriteCallback(
         std::bind(&TcpConnection::handleWrite, this));
+    // 停止读的期间对端断开：没有读事件，只有EPOLLHUP
+    channel_->setCloseCallback(
+        std::bind(&TcpConnection::handleClose, this));
+    // 零拷贝的完成通知放在错误队列里，以EPOLLERR报告
+    channel_->setErrorCallback(
+        std::bind(&TcpConnection::handleError, this));
+}
+
+const std::string& TcpConnection::name() const {
+    if (namePrefix_) {
+        std::call_once(nameOnce_, &TcpConnection::formatName, this);
+    }
+    return name_;
+}
+
+void TcpConnection::formatName() const {
+    char buf[32];
+    snprintf(buf, sizeof buf, "-%llu", static_cast<unsigned long long>(id_));
+    name_ = *namePrefix_ + buf;
 }
 
 // 析构函数：清理资源
 TcpConnection::~TcpConnection() {
-    std::cout << "TcpConnection::dtor[" << name_ << "] fd=" << sockfd_ << std::endl;
+    LOG_DEBUG << "TcpConnection::dtor[" << name() << "] fd=" << sockfd_;
     close(sockfd_);  // 关闭socket
+    for (int fd : receivedFds_) {
+        close(fd);
+    }
+    releasePipe();
 }
 
 // 处理读事件：读取数据并调用用户回调
 void TcpConnection::handleRead() {
+    if (forwarding_) {
+        handleForwardRead();
+        return;
+    }
+    
     // 使用Buffer读取数据
-    ssize_t n = inputBuffer_.readFd(sockfd_);
+    ssize_t n = fdPassing_ ? readWithFds() : inputBuffer_.readFd(sockfd_);
     
     if (n > 0) {
         // 收到数据
-        std::cout << "TcpConnection[" << name_ << "] recv " << n << " bytes" << std::endl;
+        LOG_DEBUG << "TcpConnection[" << name() << "] recv " << n << " bytes";
         
         // 调用用户设置的消息回调
         // 用户负责从inputBuffer_中取出数据
         if (messageCallback_) {
+            // 回调里可能替换消息回调：正在执行的std::function不能在这时销毁
+            inMessageCallback_ = true;
             messageCallback_(shared_from_this(), &inputBuffer_);
+            inMessageCallback_ = false;
+            if (messageCallbackPending_) {
+                messageCallbackPending_ = false;
+                messageCallback_.swap(pendingMessageCallback_);
+                pendingMessageCallback_ = nullptr;
+            }
+        }
+        
+        ++activity_;
+        updateBufferGauge();
+        // 一次大请求处理完后，输入缓冲区可能保持着很大的容量
+        if (inputBuffer_.readableBytes() == 0
+            && inputBuffer_.internalCapacity() > shrinkThreshold_) {
+            scheduleIdleShrink();
         }
     } else if (n == 0) {
         // 对端关闭连接
-        std::cout << "TcpConnection[" << name_ << "] peer closed" << std::endl;
+        LOG_DEBUG << "TcpConnection[" << name() << "] peer closed";
         handleClose();  // 处理连接关闭
-    } else {
+    } else if (errno != EAGAIN && errno != EINTR) {
         // 出错
-        std::cout << "TcpConnection[" << name_ << "] recv error" << std::endl;
+        LOG_ERROR << "TcpConnection[" << name() << "] recv error";
+    }
+}
+
+ssize_t TcpConnection::readWithFds() {
+    char control[CMSG_SPACE(kMaxReceivedFds * sizeof(int))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof control;
+    
+    // 收到的fd也不要被exec()继承
+    ssize_t n = inputBuffer_.readMsg(sockfd_, &msg, MSG_CMSG_CLOEXEC);
+    if (n < 0) {
+        return n;
+    }
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const unsigned char* data = CMSG_DATA(cmsg);
+            for (size_t i = 0; i < count; ++i) {
+                int fd;
+                memcpy(&fd, data + i * sizeof(int), sizeof fd);
+                receivedFds_.push_back(fd);
+            }
+        }
+    }
+    if (msg.msg_flags & MSG_CTRUNC) {
+        LOG_WARN << "TcpConnection[" << name() << "] more than " << kMaxReceivedFds
+                 << " fds in one read, the rest were closed";
+    }
+    return n;
+}
+
+std::vector<int> TcpConnection::takeReceivedFds() {
+    std::vector<int> fds;
+    fds.swap(receivedFds_);
+    return fds;
+}
+
+bool TcpConnection::sendFds(const char* data, size_t len, const std::vector<int>& fds) {
+    if (state_ != kConnected || len == 0 || hasPendingOutput()) {
+        return false;
+    }
+    
+    struct iovec iov;
+    iov.iov_base = const_cast<char*>(data);
+    iov.iov_len = len;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    std::vector<char> control(CMSG_SPACE(fds.size() * sizeof(int)));
+    if (!fds.empty()) {
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(fds.size() * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds.data(), fds.size() * sizeof(int));
     }
+    
+    ssize_t n = ::sendmsg(sockfd_, &msg, MSG_NOSIGNAL);
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOG_ERROR << "TcpConnection[" << name() << "] sendmsg error: " << strerror(errno);
+        }
+        return false;
+    }
+    
+    // fd已经随第一个字节发出，剩下的数据和普通send()一样
+    if (static_cast<size_t>(n) < len) {
+        sendInLoop(data + n, len - n);
+    } else {
+        queueWriteComplete();
+    }
+    return true;
 }
 
 // 发送数据
 void TcpConnection::send(const std::string& message) {
+    sendInLoop(message.data(), message.size());
+}
+
+// 发送数据（string和Buffer共用，避免Buffer先拷贝成string）
+void TcpConnection::sendInLoop(const char* data, size_t len) {
     if (sockfd_ < 0) {
-        std::cout << "TcpConnection[" << name_ << "] sockfd invalid" << std::endl;
+        LOG_ERROR << "TcpConnection[" << name() << "] sockfd invalid";
         return;
     }
     
-    size_t remaining = message.size();
+    // 前面还有文件没发完，数据只能排在文件后面
+    if (!pendingOutputs_.empty()) {
+        pendingOutputs_.back()->after.append(data, len);
+        return;
+    }
+    
+    size_t remaining = len;
     ssize_t nwrote = 0;
     
     // 如果输出缓冲区没有待发送数据，尝试直接发送
     if (outputBuffer_.readableBytes() == 0) {
         // 尝试直接发送
-        nwrote = ::send(sockfd_, message.c_str(), message.size(), 0);
+        nwrote = ::send(sockfd_, data, len, MSG_NOSIGNAL);
         
         if (nwrote >= 0) {
             remaining -= nwrote;
-            std::cout << "TcpConnection[" << name_ << "] send " << nwrote << " bytes, "
-                     << remaining << " bytes remaining" << std::endl;
+            LOG_DEBUG << "TcpConnection[" << name() << "] send " << nwrote << " bytes, "
+                     << remaining << " bytes remaining";
             
             if (remaining == 0) {
                 // 全部发送完成，完美！
+                queueWriteComplete();
                 return;
             }
         } else {
             nwrote = 0;
-            std::cout << "TcpConnection[" << name_ << "] send error" << std::endl;
-            return;
+            if (errno == EPIPE || errno == ECONNRESET) {
+                // 对端已经断开，关闭由读事件处理（持续写入的流式响应在这期间会一直走到这里）
+                LOG_DEBUG << "TcpConnection[" << name() << "] peer reset, drop " << len << " bytes";
+                return;
+            }
+            if (errno != EWOULDBLOCK) {
+                LOG_ERROR << "TcpConnection[" << name() << "] send error";
+                return;
+            }
         }
     }
     
     // 没有发送完，或者outputBuffer_本来就有数据
     // 把剩余数据（或全部数据）追加到缓冲区
-    outputBuffer_.append(message.c_str() + nwrote, remaining);
+    outputBuffer_.append(data + nwrote, remaining);
+    updateBufferGauge();
     
     // 关注可写事件
     if (!channel_->isWriting()) {
         channel_->enableWriting();
         loop_->updateChannel(channel_.get());
-        std::cout << "TcpConnection[" << name_ << "] enable writing" << std::endl;
+        LOG_DEBUG << "TcpConnection[" << name() << "] enable writing";
     }
 }
 
 // 启动连接：注册到EventLoop开始监听事件
 void TcpConnection::connectEstablished() {
-    std::cout << "TcpConnection[" << name_ << "] connectEstablished" << std::endl;
+    LOG_DEBUG << "TcpConnection[" << name() << "] connectEstablished";
     
     // 更新连接状态为已连接
     state_ = kConnected;
@@ -113,6 +383,9 @@ void TcpConnection::connectEstablished() {
     // 注册到EventLoop
     loop_->updateChannel(channel_.get());
     
+    // 开始统计这个连接的Buffer内存
+    updateBufferGauge();
+    
     // 调用用户的连接回调（通知连接建立）
     if (connectionCallback_) {
         connectionCallback_(shared_from_this());
@@ -122,37 +395,476 @@ void TcpConnection::connectEstablished() {
 // 处理写事件：发送缓冲区中的数据
 void TcpConnection::handleWrite() {
     if (!channel_->isWriting()) {
-        std::cout << "TcpConnection[" << name_ << "] handleWrite but not writing" << std::endl;
+        LOG_DEBUG << "TcpConnection[" << name() << "] handleWrite but not writing";
         return;
     }
     
     // 发送outputBuffer_中的数据
-    ssize_t n = ::send(sockfd_, 
-                      outputBuffer_.peek(), 
-                      outputBuffer_.readableBytes(), 0);
+    if (outputBuffer_.readableBytes() > 0) {
+        ssize_t n = ::send(sockfd_, 
+                          outputBuffer_.peek(), 
+                          outputBuffer_.readableBytes(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno != EWOULDBLOCK) {
+                LOG_ERROR << "TcpConnection[" << name() << "] handleWrite error";
+            }
+            return;
+        }
+        outputBuffer_.retrieve(n);
+        ++activity_;
+        LOG_DEBUG << "TcpConnection[" << name() << "] write " << n << " bytes, " 
+                 << outputBuffer_.readableBytes() << " bytes remaining";
+    }
+    
+    // 缓冲区写完了才轮到后面的文件
+    if (outputBuffer_.readableBytes() == 0 && !writePendingOutputs()) {
+        return;
+    }
+    
+    // 自己的数据都写完了才轮到转发过来、还在pipe里的数据
+    if (outputBuffer_.readableBytes() == 0 && pendingOutputs_.empty()
+        && pipeBytes_ > 0 && !flushPipe()) {
+        return;
+    }
+    
+    if (outputBuffer_.readableBytes() == 0 && pendingOutputs_.empty()) {
+        // 发送完成，停止关注可写事件
+        channel_->disableWriting();
+        loop_->updateChannel(channel_.get());
+        LOG_DEBUG << "TcpConnection[" << name() << "] disable writing";
+        
+        // 积压的数据已经写完，输出缓冲区的峰值容量不再需要
+        if (shrinkThreshold_ > 0
+            && outputBuffer_.internalCapacity() > shrinkThreshold_) {
+            outputBuffer_.shrink(0);
+        }
+        
+        // 之前调用过shutdown，数据发完了才能真正关闭写端
+        if (state_ == kDisconnecting) {
+            ::shutdown(sockfd_, SHUT_WR);
+        }
+        queueWriteComplete();
+        
+        // 往这里转发的连接因为背压停止了读，现在可以继续了
+        if (std::shared_ptr<TcpConnection> source = forwardSource_.lock()) {
+            source->resumeForward();
+        }
+    }
+    updateBufferGauge();
+}
+
+void TcpConnection::queueWriteComplete() {
+    if (writeCompleteCallback_) {
+        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+    }
+}
+
+size_t TcpConnection::pendingOutputBytes() const {
+    size_t bytes = outputBuffer_.readableBytes() + pipeBytes_;
+    for (const std::unique_ptr<PendingOutput>& output : pendingOutputs_) {
+        bytes += output->remaining + output->after.readableBytes();
+    }
+    return bytes;
+}
+
+// 发送排队的文件和内存块：一个发完后，排在它后面的数据成为新的outputBuffer_
+// 调用时outputBuffer_必须为空，返回false表示出错并且连接已经关闭
+bool TcpConnection::writePendingOutputs() {
+    while (!pendingOutputs_.empty() && outputBuffer_.readableBytes() == 0) {
+        PendingOutput& output = *pendingOutputs_.front();
+        while (output.remaining > 0) {
+            ssize_t n = output.data
+                ? sendZeroCopyOnce(output.data, output.remaining, output.owner)
+                : ::sendfile(sockfd_, output.fd, &output.offset, output.remaining);
+            if (n > 0) {
+                output.remaining -= n;
+                if (output.data) {
+                    output.data += n;
+                }
+                ++activity_;
+            } else if (n < 0 && errno == EWOULDBLOCK) {
+                return true;  // socket写满，等下一次可写事件
+            } else {
+                // 出错，或者文件被截短了（返回0）：已经发出去的响应头无法兑现，只能断开
+                LOG_ERROR << "TcpConnection[" << name() << "] "
+                          << (output.data ? "zero-copy send" : "sendfile") << " error, "
+                          << output.remaining << " bytes remaining";
+                pendingOutputs_.clear();
+                handleClose();
+                return false;
+            }
+        }
+        outputBuffer_.swap(output.after);
+        pendingOutputs_.pop_front();
+        
+        // 后面的数据先尝试直接发送
+        if (outputBuffer_.readableBytes() > 0) {
+            ssize_t n = ::send(sockfd_, outputBuffer_.peek(), outputBuffer_.readableBytes(), MSG_NOSIGNAL);
+            if (n > 0) {
+                outputBuffer_.retrieve(n);
+            }
+        }
+    }
+    return true;
+}
+
+void TcpConnection::queuePendingOutput(int fd, off_t offset, size_t count,
+                                       const char* data, std::shared_ptr<void> owner) {
+    bool idle = outputBuffer_.readableBytes() == 0 && pendingOutputs_.empty();
+    pendingOutputs_.emplace_back(new PendingOutput(fd, offset, count, data, std::move(owner)));
     
+    // 前面没有排队的数据，马上开始发送
+    if (idle && !writePendingOutputs()) {
+        return;
+    }
+    
+    if ((outputBuffer_.readableBytes() > 0 || !pendingOutputs_.empty()) && !channel_->isWriting()) {
+        channel_->enableWriting();
+        loop_->updateChannel(channel_.get());
+    } else if (idle && outputBuffer_.readableBytes() == 0 && pendingOutputs_.empty()) {
+        queueWriteComplete();
+    }
+}
+
+// 发送文件：前面没有排队的数据时直接sendfile，没发完的部分排队等可写事件
+void TcpConnection::sendFile(int fd, off_t offset, size_t count) {
+    if (state_ != kConnected) {
+        LOG_DEBUG << "TcpConnection[" << name() << "] not connected, cannot send file";
+        ::close(fd);
+        return;
+    }
+    queuePendingOutput(fd, offset, count, nullptr, nullptr);
+}
+
+TcpConnection::PendingOutput::~PendingOutput() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+bool TcpConnection::setZeroCopy(bool on) {
+    if (on && !zeroCopy_) {
+        int optval = 1;
+        if (::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof optval) < 0) {
+            LOG_WARN << "TcpConnection[" << name() << "] SO_ZEROCOPY not supported: " << strerror(errno);
+            return false;
+        }
+    }
+    // SO_ZEROCOPY打开之后不需要关闭：不带MSG_ZEROCOPY的send()照常拷贝
+    zeroCopy_ = on;
+    return true;
+}
+
+void TcpConnection::sendZeroCopy(std::string&& data) {
+    if (!zeroCopy_ || data.size() < kZeroCopyThreshold) {
+        send(data.data(), data.size());
+        return;
+    }
+    sendZeroCopy(std::make_shared<const std::string>(std::move(data)));
+}
+
+void TcpConnection::sendZeroCopy(const std::shared_ptr<const std::string>& data) {
+    if (state_ != kConnected) {
+        LOG_DEBUG << "TcpConnection[" << name() << "] not connected, cannot send";
+        return;
+    }
+    if (!zeroCopy_ || data->size() < kZeroCopyThreshold) {
+        sendInLoop(data->data(), data->size());
+        return;
+    }
+    // owner只用来延长生命周期，去掉const保存成shared_ptr<void>
+    std::shared_ptr<void> owner = std::const_pointer_cast<std::string>(data);
+    queuePendingOutput(-1, 0, data->size(), data->data(), std::move(owner));
+}
+
+ssize_t TcpConnection::sendZeroCopyOnce(const char* data, size_t len, const std::shared_ptr<void>& owner) {
+    ssize_t n = ::send(sockfd_, data, len, MSG_NOSIGNAL | MSG_ZEROCOPY);
+    if (n < 0 && errno == ENOBUFS) {
+        // 锁定的页面超过了optmem的限制，这一次改为拷贝
+        return ::send(sockfd_, data, len, MSG_NOSIGNAL);
+    }
     if (n > 0) {
-        outputBuffer_.retrieve(n);
-        std::cout << "TcpConnection[" << name_ << "] write " << n << " bytes, " 
-                 << outputBuffer_.readableBytes() << " bytes remaining" << std::endl;
+        // 只有发出了数据的调用才占用一个序号
+        zeroCopyInFlight_.push_back(ZeroCopyRef{nextZeroCopyId_++, owner});
+    }
+    return n;
+}
+
+void TcpConnection::handleError() {
+    if (!zeroCopyInFlight_.empty()) {
+        readZeroCopyCompletions();
+    }
+}
+
+void TcpConnection::readZeroCopyCompletions() {
+    drainZeroCopyCompletions(sockfd_, &zeroCopyInFlight_, &zeroCopyCopied_);
+}
+
+void TcpConnection::drainZeroCopyCompletions(int fd, std::deque<ZeroCopyRef>* inFlight, uint64_t* copied) {
+    while (!inFlight->empty()) {
+        char control[128];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof msg);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        if (::recvmsg(fd, &msg, MSG_ERRQUEUE) < 0) {
+            return;  // EAGAIN：通知都读完了
+        }
         
-        if (outputBuffer_.readableBytes() == 0) {
-            // 发送完成，停止关注可写事件
-            channel_->disableWriting();
-            loop_->updateChannel(channel_.get());
-            std::cout << "TcpConnection[" << name_ << "] disable writing" << std::endl;
+        for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+                && !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+                continue;
+            }
+            const struct sock_extended_err* err =
+                reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cmsg));
+            if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+            uint32_t lo = err->ee_info;
+            uint32_t hi = err->ee_data;
+            if (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                *copied += hi - lo + 1;
+            }
+            // 重传时通知可能乱序，逐个检查；序号回绕时用无符号减法判断是否在[lo, hi]里
+            inFlight->erase(
+                std::remove_if(inFlight->begin(), inFlight->end(),
+                               [lo, hi](const ZeroCopyRef& ref) { return ref.id - lo <= hi - lo; }),
+                inFlight->end());
         }
+    }
+}
+
+// 连接销毁时内核可能还在发送零拷贝的页面，这时释放数据，内存被复用后对端会收到别的内容
+// 所以socket（dup出来的fd）和持有数据的owner留在这里，继续读错误队列，通知到齐才关闭fd、释放数据
+class TcpConnection::ZeroCopyGraveyard : noncopyable {
+public:
+    ~ZeroCopyGraveyard() {
+        // loop线程退出了，不会再有事件：还没完成的数据故意不释放，只关闭fd
+        for (auto& item : graves_) {
+            Grave& grave = item.second;
+            drainZeroCopyCompletions(item.first, &grave.inFlight, &grave.copied);
+            if (!grave.inFlight.empty()) {
+                LOG_WARN << "ZeroCopyGraveyard: fd=" << item.first << " exits with "
+                         << grave.inFlight.size() << " zero-copy sends in flight, leaking their buffers";
+                new std::deque<ZeroCopyRef>(std::move(grave.inFlight));
+            }
+            ::close(item.first);
+        }
+    }
+    
+    void adopt(EventLoop* loop, int fd, std::deque<ZeroCopyRef>&& inFlight) {
+        // 原来close()会在排队的数据之后发FIN，fd还开着时改由shutdown()发
+        ::shutdown(fd, SHUT_WR);
+        
+        Grave& grave = graves_[fd];
+        grave.inFlight = std::move(inFlight);
+        grave.copied = 0;
+        grave.channel = std::make_shared<Channel>(fd);
+        // 不关注读写，EPOLLERR（完成通知）和EPOLLHUP总会报告
+        grave.channel->setErrorCallback(std::bind(&ZeroCopyGraveyard::handleEvent, this, loop, fd));
+        grave.channel->setCloseCallback(std::bind(&ZeroCopyGraveyard::handleEvent, this, loop, fd));
+        loop->updateChannel(grave.channel.get());
+    }
+
+private:
+    struct Grave {
+        std::shared_ptr<Channel> channel;
+        std::deque<ZeroCopyRef> inFlight;
+        uint64_t copied;
+    };
+    
+    void handleEvent(EventLoop* loop, int fd) {
+        auto it = graves_.find(fd);
+        if (it == graves_.end()) {
+            return;
+        }
+        Grave& grave = it->second;
+        drainZeroCopyCompletions(fd, &grave.inFlight, &grave.copied);
+        
+        // 对端重置等socket错误同样报告EPOLLERR，读掉它，否则水平触发会一直返回
+        int err = 0;
+        socklen_t len = sizeof err;
+        ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        
+        if (grave.inFlight.empty()) {
+            grave.channel->disableAll();
+            loop->removeChannel(grave.channel.get());
+            // 正在Channel::handleEvent里，不能马上销毁Channel
+            std::shared_ptr<Channel> channel = grave.channel;
+            loop->queueInLoop([channel]() {});
+            graves_.erase(it);
+            ::close(fd);
+        }
+    }
+    
+    std::map<int, Grave> graves_;  // fd -> 等待通知的发送
+};
+
+TcpConnection::ZeroCopyGraveyard& TcpConnection::zeroCopyGraveyard() {
+    thread_local ZeroCopyGraveyard graveyard;
+    return graveyard;
+}
+
+bool TcpConnection::forwardTo(const std::shared_ptr<TcpConnection>& target, bool useSplice) {
+    if (target->getLoop() != loop_) {
+        LOG_ERROR << "TcpConnection[" << name() << "] forwardTo " << target->name()
+                  << " in another loop is not supported";
+        return false;
+    }
+    if (useSplice) {
+        ignoreSigPipe();
+    }
+    forwardTarget_ = target;
+    forwarding_ = true;
+    forwardSplice_ = useSplice;
+    target->forwardSource_ = shared_from_this();
+    
+    // 已经读进来的数据先发出去，之后splice的数据排在它后面（flushPipe()会等它写完）
+    if (inputBuffer_.readableBytes() > 0) {
+        forwardCopiedBytes_ += inputBuffer_.readableBytes();
+        target->send(&inputBuffer_);
+    }
+    return true;
+}
+
+void TcpConnection::handleForwardRead() {
+    std::shared_ptr<TcpConnection> target = forwardTarget_.lock();
+    if (!target || target->closed_) {
+        // 另一端已经关闭，读到的数据没有地方去
+        handleClose();
+        return;
+    }
+    
+    ssize_t n = -1;
+    bool spliced = false;
+    if (forwardSplice_ && !fdPassing_) {
+        n = target->spliceFrom(sockfd_);
+        if (n >= 0 || errno == EAGAIN || errno == EINTR || errno == ECONNRESET) {
+            spliced = true;
+        } else if (errno == EINVAL) {
+            // 这个socket不支持splice，以后都经过Buffer
+            LOG_WARN << "TcpConnection[" << name() << "] splice not supported, forwarding through buffer";
+            forwardSplice_ = false;
+        }
+        // 其他错误（比如pipe用完了，EMFILE）：这一次经过Buffer
+    }
+    if (!spliced) {
+        n = fdPassing_ ? readWithFds() : inputBuffer_.readFd(sockfd_);
+        if (n > 0) {
+            forwardCopiedBytes_ += n;
+            target->send(&inputBuffer_);
+        }
+    } else if (n > 0) {
+        splicedBytes_ += n;
+    }
+    int savedErrno = errno;
+    
+    // 背压：target写不出去时不再读，数据留在内核里，TCP窗口让对端慢下来
+    // （pipe满了splice返回EAGAIN时同样停下来，否则水平触发的读事件会一直报告）
+    if (n != 0 && (target->pipeBytes_ > 0 || target->pendingOutputBytes() >= kForwardHighWaterMark)) {
+        forwardPaused_ = true;
+        stopRead();
+    }
+    
+    if (n > 0) {
+        ++activity_;
+        updateBufferGauge();
+    } else if (n == 0 || (savedErrno != EAGAIN && savedErrno != EINTR)) {
+        // 对端关闭，或者读出错（对端重置在代理里很常见）：target排队的数据写完之后关闭它的写端
+        LOG_DEBUG << "TcpConnection[" << name() << "] peer closed ("
+                  << (n == 0 ? "EOF" : strerror(savedErrno)) << "), shutdown " << target->name();
+        target->shutdown();
+        handleClose();
+    }
+}
+
+ssize_t TcpConnection::spliceFrom(int fd) {
+    if (pipeFds_[0] < 0 && !t_pipePool.acquire(pipeFds_)) {
+        return -1;
+    }
+    ssize_t n = ::splice(fd, nullptr, pipeFds_[1], nullptr, kForwardPipeSize,
+                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    int savedErrno = errno;
+    if (n > 0) {
+        pipeBytes_ += n;
+        flushPipe();
+    } else if (pipeBytes_ == 0) {
+        releasePipe();
+    }
+    errno = savedErrno;
+    return n;
+}
+
+bool TcpConnection::flushPipe() {
+    // 之前send()的数据（比如forwardTo()时inputBuffer_里的）要先写出去
+    if (outputBuffer_.readableBytes() == 0 && pendingOutputs_.empty()) {
+        while (pipeBytes_ > 0) {
+            ssize_t n = ::splice(pipeFds_[0], nullptr, sockfd_, nullptr, pipeBytes_,
+                                 SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0) {
+                pipeBytes_ -= n;
+                ++activity_;
+            } else if (n < 0 && errno == EAGAIN) {
+                break;
+            } else {
+                // 对端已经断开，pipe里的数据发不出去了，关闭由读事件处理
+                LOG_DEBUG << "TcpConnection[" << name() << "] peer reset, drop " << pipeBytes_ << " forwarded bytes";
+                releasePipe();
+                return true;
+            }
+        }
+    }
+    if (pipeBytes_ == 0) {
+        releasePipe();
+        return true;
+    }
+    if (!channel_->isWriting()) {
+        channel_->enableWriting();
+        loop_->updateChannel(channel_.get());
+    }
+    return false;
+}
+
+void TcpConnection::releasePipe() {
+    if (pipeFds_[0] < 0) {
+        return;
+    }
+    if (pipeBytes_ == 0) {
+        t_pipePool.release(pipeFds_);
     } else {
-        std::cout << "TcpConnection[" << name_ << "] handleWrite error" << std::endl;
+        ::close(pipeFds_[0]);
+        ::close(pipeFds_[1]);
+        pipeBytes_ = 0;
+    }
+    pipeFds_[0] = pipeFds_[1] = -1;
+}
+
+void TcpConnection::resumeForward() {
+    if (forwardPaused_) {
+        forwardPaused_ = false;
+        startRead();
     }
 }
 
 // 处理连接关闭
 void TcpConnection::handleClose() {
-    std::cout << "TcpConnection[" << name_ << "] handleClose" << std::endl;
+    // 移除Channel之前EPOLLHUP可能再报告一次，forceClose()也可能在这之后调用
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    LOG_DEBUG << "TcpConnection[" << name() << "] handleClose";
     
     // 停止监听所有事件
+    // 同步到epoll，否则LT模式下对端关闭会一直触发读事件
     channel_->disableAll();
+    loop_->updateChannel(channel_.get());
+    
+    // 往这里转发的连接如果停止了读，让它读下去，发现这边关闭了之后随之关闭
+    if (std::shared_ptr<TcpConnection> source = forwardSource_.lock()) {
+        source->resumeForward();
+    }
     
     // 调用关闭回调（通知TcpServer移除这个连接）
     if (closeCallback_) {
@@ -162,9 +874,10 @@ void TcpConnection::handleClose() {
 
 // 连接销毁（由TcpServer调用）
 void TcpConnection::connectDestroyed() {
-    std::cout << "TcpConnection[" << name_ << "] connectDestroyed" << std::endl;
+    LOG_DEBUG << "TcpConnection[" << name() << "] connectDestroyed";
     
-    if (state_ == kConnected) {
+    // shutdown()/forceClose()之后是kDisconnecting，同样要通知断开
+    if (state_ == kConnected || state_ == kDisconnecting) {
         // 更新连接状态为已断开
         state_ = kDisconnected;
         
@@ -175,8 +888,87 @@ void TcpConnection::connectDestroyed() {
     }
     
     // 从EventLoop中移除Channel
+    // 必须从Poller中删除，否则fd被复用时新连接会走MOD分支而注册失败
     channel_->disableAll();
-    // 注意：这里简化处理，实际应该从Poller中移除
+    loop_->removeChannel(channel_.get());
+    
+    // 内核还在引用零拷贝的数据：dup一份socket交给graveyard等通知，连接照常销毁
+    if (!zeroCopyInFlight_.empty()) {
+        readZeroCopyCompletions();
+    }
+    if (!zeroCopyInFlight_.empty()) {
+        int fd = ::fcntl(sockfd_, F_DUPFD_CLOEXEC, 0);
+        if (fd >= 0) {
+            zeroCopyGraveyard().adopt(loop_, fd, std::move(zeroCopyInFlight_));
+            zeroCopyInFlight_.clear();
+        } else {
+            // 只能由连接继续持有，直到连接析构
+            LOG_ERROR << "TcpConnection[" << name() << "] dup for zero-copy completions failed: "
+                      << strerror(errno);
+        }
+    }
+    
+    // 这个连接的Buffer不再计入统计
+    loop_->addBufferedBytes(-static_cast<ssize_t>(accountedBytes_));
+    accountedBytes_ = 0;
+}
+
+// === Buffer内存回收 ===
+
+// 立即收缩空的Buffer
+void TcpConnection::shrinkBuffers() {
+    if (shrinkThreshold_ == 0) {
+        return;
+    }
+    if (inputBuffer_.readableBytes() == 0
+        && inputBuffer_.internalCapacity() > shrinkThreshold_) {
+        inputBuffer_.shrink(0);
+    }
+    if (outputBuffer_.readableBytes() == 0
+        && outputBuffer_.internalCapacity() > shrinkThreshold_) {
+        outputBuffer_.shrink(0);
+    }
+    updateBufferGauge();
+}
+
+// 安排一次空闲检查：同一时间每个连接最多只有一个定时器
+void TcpConnection::scheduleIdleShrink() {
+    if (shrinkThreshold_ == 0 || idleShrinkDelay_ <= 0 || idleShrinkPending_) {
+        return;
+    }
+    idleShrinkPending_ = true;
+    
+    // 用weak_ptr，定时器不延长连接的生命周期
+    std::weak_ptr<TcpConnection> weakConn(shared_from_this());
+    uint64_t activity = activity_;
+    loop_->runAfter(idleShrinkDelay_, [weakConn, activity]() {
+        std::shared_ptr<TcpConnection> conn = weakConn.lock();
+        if (conn) {
+            conn->handleIdleShrink(activity);
+        }
+    });
+}
+
+// 空闲检查到期：期间没有任何读写才收缩，否则推迟到下一个周期
+void TcpConnection::handleIdleShrink(uint64_t activity) {
+    idleShrinkPending_ = false;
+    if (state_ != kConnected) {
+        return;
+    }
+    if (activity != activity_) {
+        scheduleIdleShrink();
+        return;
+    }
+    shrinkBuffers();
+}
+
+// 只累计差值，EventLoop::bufferedBytes()就是所有连接的总和
+void TcpConnection::updateBufferGauge() {
+    size_t current = inputBuffer_.internalCapacity() + outputBuffer_.internalCapacity();
+    if (current != accountedBytes_) {
+        loop_->addBufferedBytes(static_cast<ssize_t>(current) - static_cast<ssize_t>(accountedBytes_));
+        accountedBytes_ = current;
+    }
 }
 
 // === 新增的连接控制方法 ===
@@ -185,9 +977,12 @@ void TcpConnection::connectDestroyed() {
 void TcpConnection::shutdown() {
     if (state_ == kConnected) {
         state_ = kDisconnecting;
-        // 关闭写端，允许继续读取
-        ::shutdown(sockfd_, SHUT_WR);  
-        std::cout << "TcpConnection[" << name_ << "] shutdown write end" << std::endl;
+        // 输出缓冲区还有数据时先不关，等handleWrite发完再关闭写端
+        if (!channel_->isWriting()) {
+            // 关闭写端，允许继续读取
+            ::shutdown(sockfd_, SHUT_WR);
+            LOG_DEBUG << "TcpConnection[" << name() << "] shutdown write end";
+        }
     }
 }
 
@@ -197,18 +992,56 @@ void TcpConnection::forceClose() {
         state_ = kDisconnecting;
         // 直接触发关闭处理
         handleClose();
-        std::cout << "TcpConnection[" << name_ << "] force close" << std::endl;
+        LOG_DEBUG << "TcpConnection[" << name() << "] force close";
+    }
+}
+
+void TcpConnection::stopRead() {
+    if (!closed_ && channel_->isReading()) {
+        channel_->disableReading();
+        loop_->updateChannel(channel_.get());
+    }
+}
+
+void TcpConnection::startRead() {
+    if (!closed_ && !channel_->isReading()) {
+        channel_->enableReading();
+        loop_->updateChannel(channel_.get());
     }
 }
 
+bool TcpConnection::isReading() const {
+    return channel_->isReading();
+}
+
+void TcpConnection::setTcpNoDelay(bool on) {
+    int optval = on ? 1 : 0;
+    ::setsockopt(sockfd_, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof optval);
+}
+
 // 发送Buffer数据
 void TcpConnection::send(Buffer* buf) {
     if (state_ == kConnected) {
-        // 直接从Buffer发送数据
-        send(std::string(buf->peek(), buf->readableBytes()));
+        if (zeroCopy_ && buf->readableBytes() >= kZeroCopyThreshold) {
+            // 接管Buffer的内存（交换，不拷贝），调用者拿到一个空的Buffer
+            std::shared_ptr<Buffer> owned = std::make_shared<Buffer>();
+            owned->swap(*buf);
+            queuePendingOutput(-1, 0, owned->readableBytes(), owned->peek(), owned);
+            return;
+        }
+        // 直接从Buffer发送数据，不再先拷贝成string
+        sendInLoop(buf->peek(), buf->readableBytes());
         buf->retrieveAll();  // 清空Buffer
     } else {
-        std::cout << "TcpConnection[" << name_ << "] not connected, cannot send" << std::endl;
+        LOG_DEBUG << "TcpConnection[" << name() << "] not connected, cannot send";
+    }
+}
+
+void TcpConnection::send(const char* data, size_t len) {
+    if (state_ == kConnected) {
+        sendInLoop(data, len);
+    } else {
+        LOG_DEBUG << "TcpConnection[" << name() << "] not connected, cannot send";
     }
 }
 
@@ -217,7 +1050,7 @@ void TcpConnection::send(Buffer* buf) {
 // 设置上下文
 void TcpConnection::setContext(const std::string& key, std::shared_ptr<void> context) {
     contexts_[key] = context;
-    std::cout << "TcpConnection[" << name_ << "] setContext: " << key << std::endl;
+    LOG_DEBUG << "TcpConnection[" << name() << "] setContext: " << key;
 }
 
 // 获取上下文
@@ -239,6 +1072,16 @@ void TcpConnection::clearContext(const std::string& key) {
     auto it = contexts_.find(key);
     if (it != contexts_.end()) {
         contexts_.erase(it);
-        std::cout << "TcpConnection[" << name_ << "] clearContext: " << key << std::endl;
+        LOG_DEBUG << "TcpConnection[" << name() << "] clearContext: " << key;
+    }
+}
+
+// 新的上下文类型：分配下一个槽位
+size_t TcpConnection::nextContextSlot() {
+    static std::atomic<size_t> next(0);
+    size_t slot = next++;
+    if (slot >= kMaxContextTypes) {
+        LOG_FATAL << "TcpConnection: more than " << kMaxContextTypes << " context types";
     }
+    return slot;
 }
\ No newline at end of file
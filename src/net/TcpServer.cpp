@@ -3,7 +3,49 @@
 #include "TcpConnection.h"
 #include "EventLoop.h"
 #include "EventLoopThreadPool.h"
+#include "InetAddress.h"
+#include "UnixAddress.h"
 #include "../logger/Logger.h"
+#include <atomic>
+
+// 一个IO线程上的连接：槽位表，连接记住自己的槽位（registrySlot_），加入和移除都是O(1)
+// 只在这个IO线程修改；count给connectionCount()在其他线程读
+// TcpServer和它的连接（通过关闭回调）共同持有，TcpServer析构之后连接仍然可以安全地移除自己
+struct TcpServer::LoopConnections {
+    explicit LoopConnections(EventLoop* ioLoop) : loop(ioLoop), count(0) {}
+    
+    void add(const ConnectionPtr& conn) {
+        if (freeSlots.empty()) {
+            conn->registrySlot_ = slots.size();
+            slots.push_back(conn);
+        } else {
+            conn->registrySlot_ = freeSlots.back();
+            freeSlots.pop_back();
+            slots[conn->registrySlot_] = conn;
+        }
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // 连接关闭时（TcpConnection::handleClose）调用
+    void remove(const ConnectionPtr& conn) {
+        LOG_DEBUG << "TcpServer::removeConnection - connection " << conn->name();
+        
+        size_t slot = conn->registrySlot_;
+        if (slot < slots.size() && slots[slot] == conn) {
+            slots[slot].reset();
+            freeSlots.push_back(slot);
+            count.fetch_sub(1, std::memory_order_relaxed);
+        }
+        
+        // 在IO线程执行最后的清理
+        loop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+    }
+    
+    EventLoop* loop;
+    std::vector<ConnectionPtr> slots;   // 空出来的槽位是nullptr
+    std::vector<size_t> freeSlots;
+    std::atomic<size_t> count;
+};
 
 
 // 构造函数：初始化服务器
@@ -15,6 +57,10 @@ TcpServer::TcpServer(EventLoop* loop,
       port_(port),  // 保存端口号
       acceptor_(new Acceptor(loop, port)),  // 创建Acceptor
       threadPool_(new EventLoopThreadPool(loop, name + "-pool")),  // 创建线程池
+      bufferShrinkThreshold_(TcpConnection::kDefaultShrinkThreshold),
+      bufferIdleShrinkDelay_(5.0),
+      nextLoop_(0),
+      connNamePrefix_(std::make_shared<const std::string>(name)),
       nextConnId_(1)  // 连接ID从1开始
 {
     LOG_INFO << "TcpServer[" << name_ << "] created, port=" << port;
@@ -25,14 +71,72 @@ TcpServer::TcpServer(EventLoop* loop,
         std::bind(&TcpServer::newConnection, this, std::placeholders::_1));
 }
 
+TcpServer::TcpServer(EventLoop* loop,
+                     const std::string& name,
+                     const InetAddress& listenAddr,
+                     bool ipv6Only)
+    : loop_(loop),
+      name_(name),
+      port_(listenAddr.toPort()),
+      listenAddress_(listenAddr.toIpPort()),
+      acceptor_(new Acceptor(loop, listenAddr, ipv6Only)),
+      threadPool_(new EventLoopThreadPool(loop, name + "-pool")),
+      bufferShrinkThreshold_(TcpConnection::kDefaultShrinkThreshold),
+      bufferIdleShrinkDelay_(5.0),
+      nextLoop_(0),
+      connNamePrefix_(std::make_shared<const std::string>(name)),
+      nextConnId_(1)
+{
+    LOG_INFO << "TcpServer[" << name_ << "] created, " << listenAddress_;
+    
+    acceptor_->setNewConnectionCallback(
+        std::bind(&TcpServer::newConnection, this, std::placeholders::_1));
+}
+
+TcpServer::TcpServer(EventLoop* loop,
+                     const std::string& name,
+                     const UnixAddress& listenAddr)
+    : loop_(loop),
+      name_(name),
+      port_(0),
+      listenAddress_(listenAddr.toString()),
+      acceptor_(new Acceptor(loop, listenAddr)),
+      threadPool_(new EventLoopThreadPool(loop, name + "-pool")),
+      bufferShrinkThreshold_(TcpConnection::kDefaultShrinkThreshold),
+      bufferIdleShrinkDelay_(5.0),
+      nextLoop_(0),
+      connNamePrefix_(std::make_shared<const std::string>(name)),
+      nextConnId_(1)
+{
+    LOG_INFO << "TcpServer[" << name_ << "] created, " << listenAddress_;
+    
+    acceptor_->setNewConnectionCallback(
+        std::bind(&TcpServer::newConnection, this, std::placeholders::_1));
+}
+
 TcpServer::~TcpServer() {
     LOG_INFO << "TcpServer[" << name_ << "] destructing";
     
-    // 清理所有连接
-    for (auto& item : connections_) {
-        auto conn = item.second;
-        item.second.reset();  // 释放shared_ptr
-        // TcpConnection的析构函数会关闭socket
+    // 关闭还在的连接：只释放shared_ptr的话，Channel留在Poller里，fd被复用时注册失败
+    // 关闭回调原来指向连接表，换成只做清理的版本（在连接所在的IO线程进行）
+    // 之前建立的连接加入连接表的任务排在这之前，不会漏掉
+    for (const std::shared_ptr<LoopConnections>& connections : loopConnections_) {
+        EventLoop* ioLoop = connections->loop;
+        ioLoop->runInLoop([connections, ioLoop]() {
+            std::vector<ConnectionPtr> slots;
+            slots.swap(connections->slots);
+            connections->freeSlots.clear();
+            connections->count = 0;
+            for (const ConnectionPtr& conn : slots) {
+                if (!conn) {
+                    continue;
+                }
+                conn->setCloseCallback([ioLoop](const ConnectionPtr& c) {
+                    ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, c));
+                });
+                conn->forceClose();
+            }
+        });
     }
 }
 
@@ -46,65 +150,81 @@ void TcpServer::start() {
     LOG_INFO << "TcpServer[" << name_ << "] starting";
     
     // 启动线程池
-    threadPool_->start();
+    threadPool_->start(threadInitCallback_);
+    
+    // 每个IO线程一张连接表
+    if (loopConnections_.empty()) {
+        for (EventLoop* ioLoop : threadPool_->getAllLoops()) {
+            loopConnections_.push_back(std::make_shared<LoopConnections>(ioLoop));
+        }
+    }
     
     // 让Acceptor开始监听
     acceptor_->listen();
 }
 
+void TcpServer::setSocketOptions(const SocketOptions& options) {
+    acceptor_->setSocketOptions(options);
+}
+
 // 处理新连接（这是核心函数！）
 void TcpServer::newConnection(int sockfd) {
-    // 为新连接生成一个名字
-    char buf[32];
-    snprintf(buf, sizeof(buf), "-%d", nextConnId_);
-    ++nextConnId_;
-    std::string connName = name_ + buf;
-    
-    LOG_INFO << "TcpServer::newConnection [" << connName << "] fd=" << sockfd;
-    
-    // 从线程池中选择一个EventLoop
-    EventLoop* ioLoop = threadPool_->getNextLoop();
-    LOG_DEBUG << "TcpServer: assign connection to EventLoop " << ioLoop;
+    // 轮询选择一个IO线程（和EventLoopThreadPool::getNextLoop()的顺序一样）
+    std::shared_ptr<LoopConnections> connections = loopConnections_[nextLoop_];
+    if (++nextLoop_ == loopConnections_.size()) {
+        nextLoop_ = 0;
+    }
+    EventLoop* ioLoop = connections->loop;
     
     // 先在主线程创建TcpConnection对象
-    // 注意：TcpConnection的构造函数只是初始化，不涉及IO操作
-    auto conn = std::make_shared<TcpConnection>(ioLoop, connName, sockfd);
+    // 注意：TcpConnection的构造函数只是初始化，不涉及IO操作；连接名等到用的时候才生成
+    auto conn = std::make_shared<TcpConnection>(ioLoop, connNamePrefix_, nextConnId_++, sockfd);
     
-    // 在主线程保存到connections_中（线程安全）
-    connections_[connName] = conn;
+    LOG_DEBUG << "TcpServer::newConnection [" << conn->name() << "] fd=" << sockfd;
+    LOG_DEBUG << "TcpServer: assign connection to EventLoop " << ioLoop;
     
     // 设置各种回调（在主线程）- muduo风格
+    // 关闭回调只持有连接表，在IO线程直接移除，不用回到主线程
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setCloseCallback(
-        std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
+        std::bind(&LoopConnections::remove, connections, std::placeholders::_1));
+    conn->setBufferShrinkThreshold(bufferShrinkThreshold_);
+    conn->setBufferIdleShrinkDelay(bufferIdleShrinkDelay_);
     
-    // 只让connectEstablished在IO线程执行
-    ioLoop->runInLoop(
-        std::bind(&TcpConnection::connectEstablished, conn));
+    // 加入连接表和connectEstablished都在IO线程执行
+    ioLoop->runInLoop([connections, conn]() {
+        connections->add(conn);
+        conn->connectEstablished();
+    });
 }
 
-// 移除连接（由TcpConnection在关闭时调用）
-void TcpServer::removeConnection(const std::shared_ptr<TcpConnection>& conn) {
-    // 在主线程执行移除操作
-    loop_->runInLoop(
-        std::bind(&TcpServer::removeConnectionInLoop, this, conn));
+size_t TcpServer::connectionCount() const {
+    size_t count = 0;
+    for (const std::shared_ptr<LoopConnections>& connections : loopConnections_) {
+        count += connections->count.load(std::memory_order_relaxed);
+    }
+    return count;
 }
 
-// 在主线程移除连接
-void TcpServer::removeConnectionInLoop(const std::shared_ptr<TcpConnection>& conn) {
-    LOG_INFO << "TcpServer::removeConnectionInLoop [" << name_ << "] - connection " << conn->name();
-    
-    // 从主线程的map中删除
-    connections_.erase(conn->name());
-    
-    // 在IO线程执行最后的清理
-    EventLoop* ioLoop = conn->getLoop();
-    ioLoop->queueInLoop(
-        std::bind(&TcpConnection::connectDestroyed, conn));
+void TcpServer::forEachConnection(const ConnectionCallback& cb) {
+    for (const std::shared_ptr<LoopConnections>& connections : loopConnections_) {
+        connections->loop->runInLoop([connections, cb]() {
+            // 回调里可能关闭连接（从slots里移除），所以遍历一份拷贝
+            std::vector<ConnectionPtr> slots(connections->slots);
+            for (const ConnectionPtr& conn : slots) {
+                if (conn) {
+                    cb(conn);
+                }
+            }
+        });
+    }
 }
 
 // 获取监听地址字符串
 std::string TcpServer::ipPort() const {
+    if (!listenAddress_.empty()) {
+        return listenAddress_;
+    }
     return "0.0.0.0:" + std::to_string(port_);
 }
\ No newline at end of file
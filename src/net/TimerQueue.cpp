@@ -0,0 +1,171 @@
+#include "TimerQueue.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "../logger/Logger.h"
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdint>
+#include <iterator>
+
+std::atomic<int64_t> Timer::s_numCreated_(0);
+
+// 创建timerfd（使用单调时钟，不受系统时间调整影响）
+static int createTimerfd() {
+    int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerfd < 0) {
+        LOG_FATAL << "Failed in timerfd_create";
+    }
+    return timerfd;
+}
+
+// 计算从现在到when还有多久
+static struct timespec howMuchTimeFromNow(Timestamp when) {
+    int64_t microseconds = when.microSecondsSinceEpoch()
+                         - Timestamp::now().microSecondsSinceEpoch();
+    // 至少100微秒，避免设置为0导致timerfd停止
+    if (microseconds < 100) {
+        microseconds = 100;
+    }
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(microseconds / Timestamp::kMicroSecondsPerSecond);
+    ts.tv_nsec = static_cast<long>((microseconds % Timestamp::kMicroSecondsPerSecond) * 1000);
+    return ts;
+}
+
+// 读走timerfd的计数，否则LT模式下会一直触发
+static void readTimerfd(int timerfd) {
+    uint64_t howmany;
+    ssize_t n = ::read(timerfd, &howmany, sizeof howmany);
+    if (n != sizeof howmany) {
+        LOG_ERROR << "TimerQueue::handleRead() reads " << n << " bytes instead of 8";
+    }
+}
+
+// 设置timerfd的下一次到期时间
+static void resetTimerfd(int timerfd, Timestamp expiration) {
+    struct itimerspec newValue;
+    struct itimerspec oldValue;
+    memset(&newValue, 0, sizeof newValue);
+    memset(&oldValue, 0, sizeof oldValue);
+    newValue.it_value = howMuchTimeFromNow(expiration);
+    if (::timerfd_settime(timerfd, 0, &newValue, &oldValue) < 0) {
+        LOG_ERROR << "timerfd_settime() failed";
+    }
+}
+
+TimerQueue::TimerQueue(EventLoop* loop)
+    : loop_(loop),
+      timerfd_(createTimerfd()),
+      timerfdChannel_(new Channel(timerfd_)),
+      callingExpiredTimers_(false)
+{
+    timerfdChannel_->setReadCallback(
+        std::bind(&TimerQueue::handleRead, this));
+    timerfdChannel_->enableReading();
+    loop_->updateChannel(timerfdChannel_.get());
+}
+
+TimerQueue::~TimerQueue() {
+    timerfdChannel_->disableAll();
+    loop_->removeChannel(timerfdChannel_.get());
+    ::close(timerfd_);
+
+    // 释放所有还没到期的定时器
+    for (const Entry& timer : timers_) {
+        delete timer.second;
+    }
+}
+
+TimerId TimerQueue::addTimer(Timer::TimerCallback cb, Timestamp when, double interval) {
+    Timer* timer = new Timer(std::move(cb), when, interval);
+    loop_->runInLoop(
+        std::bind(&TimerQueue::addTimerInLoop, this, timer));
+    return TimerId(timer, timer->sequence());
+}
+
+void TimerQueue::cancel(TimerId timerId) {
+    loop_->runInLoop(
+        std::bind(&TimerQueue::cancelInLoop, this, timerId));
+}
+
+void TimerQueue::addTimerInLoop(Timer* timer) {
+    bool earliestChanged = insert(timer);
+    if (earliestChanged) {
+        // 新定时器比原来最早的还早，需要重设timerfd
+        resetTimerfd(timerfd_, timer->expiration());
+    }
+}
+
+void TimerQueue::cancelInLoop(TimerId timerId) {
+    ActiveTimer timer(timerId.timer_, timerId.sequence_);
+    auto it = activeTimers_.find(timer);
+    if (it != activeTimers_.end()) {
+        timers_.erase(Entry(it->first->expiration(), it->first));
+        delete it->first;
+        activeTimers_.erase(it);
+    } else if (callingExpiredTimers_) {
+        // 定时器正在执行回调（比如周期定时器在回调里取消自己）
+        // 记下来，reset时不再重新插入
+        cancelingTimers_.insert(timer);
+    }
+}
+
+void TimerQueue::handleRead() {
+    Timestamp now(Timestamp::now());
+    readTimerfd(timerfd_);
+
+    std::vector<Entry> expired = getExpired(now);
+
+    callingExpiredTimers_ = true;
+    cancelingTimers_.clear();
+    for (const Entry& it : expired) {
+        it.second->run();
+    }
+    callingExpiredTimers_ = false;
+
+    reset(expired, now);
+}
+
+std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now) {
+    std::vector<Entry> expired;
+    // 哨兵：所有到期时间<=now的定时器都排在它前面
+    Entry sentry(now, reinterpret_cast<Timer*>(UINTPTR_MAX));
+    auto end = timers_.lower_bound(sentry);
+    std::copy(timers_.begin(), end, std::back_inserter(expired));
+    timers_.erase(timers_.begin(), end);
+
+    for (const Entry& it : expired) {
+        activeTimers_.erase(ActiveTimer(it.second, it.second->sequence()));
+    }
+    return expired;
+}
+
+void TimerQueue::reset(const std::vector<Entry>& expired, Timestamp now) {
+    for (const Entry& it : expired) {
+        ActiveTimer timer(it.second, it.second->sequence());
+        if (it.second->repeat()
+            && cancelingTimers_.find(timer) == cancelingTimers_.end()) {
+            it.second->restart(now);
+            insert(it.second);
+        } else {
+            delete it.second;
+        }
+    }
+
+    if (!timers_.empty()) {
+        resetTimerfd(timerfd_, timers_.begin()->second->expiration());
+    }
+}
+
+bool TimerQueue::insert(Timer* timer) {
+    bool earliestChanged = false;
+    Timestamp when = timer->expiration();
+    auto it = timers_.begin();
+    if (it == timers_.end() || when < it->first) {
+        earliestChanged = true;
+    }
+    timers_.insert(Entry(when, timer));
+    activeTimers_.insert(ActiveTimer(timer, timer->sequence()));
+    return earliestChanged;
+}
@@ -0,0 +1,64 @@
+#ifndef TINY_NETWORK_NET_TIMERQUEUE_H
+#define TINY_NETWORK_NET_TIMERQUEUE_H
+
+#include "../base/noncopyable.h"
+#include "../base/Timestamp.h"
+#include "Timer.h"
+#include <memory>
+#include <set>
+#include <vector>
+
+class EventLoop;
+class Channel;
+
+// TimerQueue：定时器队列
+//
+// 设计思路：
+// 1. 用timerfd把"时间到了"变成一个可读事件，和其他IO事件统一由epoll处理
+// 2. 所有定时器按到期时间排序保存在std::set中，timerfd只设置为最早的到期时间
+// 3. 所有操作都在EventLoop线程中完成，跨线程调用通过runInLoop转发
+class TimerQueue : noncopyable {
+public:
+    explicit TimerQueue(EventLoop* loop);
+    ~TimerQueue();
+
+    // 添加定时器（线程安全）
+    TimerId addTimer(Timer::TimerCallback cb, Timestamp when, double interval);
+
+    // 取消定时器（线程安全）
+    void cancel(TimerId timerId);
+
+private:
+    // 按(到期时间, 地址)排序，允许到期时间相同的多个定时器
+    using Entry = std::pair<Timestamp, Timer*>;
+    using TimerList = std::set<Entry>;
+    // 按(地址, 序号)索引，用于取消
+    using ActiveTimer = std::pair<Timer*, int64_t>;
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    void addTimerInLoop(Timer* timer);
+    void cancelInLoop(TimerId timerId);
+
+    // timerfd可读时调用
+    void handleRead();
+
+    // 取出所有已到期的定时器
+    std::vector<Entry> getExpired(Timestamp now);
+    // 重新插入周期定时器，并重设timerfd
+    void reset(const std::vector<Entry>& expired, Timestamp now);
+
+    // 插入定时器，返回最早到期时间是否改变
+    bool insert(Timer* timer);
+
+    EventLoop* loop_;
+    const int timerfd_;
+    std::unique_ptr<Channel> timerfdChannel_;
+
+    TimerList timers_;              // 按到期时间排序的定时器
+    ActiveTimerSet activeTimers_;   // 当前有效的定时器
+
+    bool callingExpiredTimers_;     // 是否正在执行到期回调
+    ActiveTimerSet cancelingTimers_; // 回调执行期间被取消的定时器
+};
+
+#endif
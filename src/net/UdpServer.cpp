@@ -0,0 +1,77 @@
+#include "UdpServer.h"
+#include "EventLoop.h"
+#include "EventLoopThreadPool.h"
+#include "../logger/Logger.h"
+#include <condition_variable>
+#include <mutex>
+
+UdpServer::UdpServer(EventLoop* loop, const std::string& name, int port)
+    : loop_(loop),
+      name_(name),
+      port_(port),
+      threadPool_(new EventLoopThreadPool(loop, name + "-pool")),
+      batchSize_(UdpSocket::kDefaultBatchSize),
+      maxDatagramSize_(UdpSocket::kDefaultMaxDatagramSize),
+      gro_(false),
+      receiveBufferSize_(0),
+      started_(false)
+{
+    LOG_INFO << "UdpServer[" << name_ << "] created, port=" << port;
+}
+
+UdpServer::~UdpServer() {
+    LOG_INFO << "UdpServer[" << name_ << "] destructing";
+    
+    // socket要在自己的loop线程析构（从Poller中移除），IO线程的loop这时还在运行
+    for (std::unique_ptr<UdpSocket>& socket : sockets_) {
+        EventLoop* ioLoop = socket->getLoop();
+        if (ioLoop == loop_) {
+            socket.reset();
+            continue;
+        }
+        std::mutex mutex;
+        std::condition_variable cond;
+        bool done = false;
+        ioLoop->runInLoop([&]() {
+            socket.reset();
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            cond.notify_one();
+        });
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return done; });
+    }
+}
+
+void UdpServer::setThreadNum(int numThreads) {
+    threadPool_->setThreadNum(numThreads);
+}
+
+void UdpServer::start() {
+    if (started_) {
+        return;
+    }
+    started_ = true;
+    LOG_INFO << "UdpServer[" << name_ << "] starting";
+    
+    threadPool_->start(threadInitCallback_);
+    
+    // 只有一个socket时不需要SO_REUSEPORT，端口被占用时bind()会报错而不是悄悄分走一部分数据报
+    std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+    bool reusePort = loops.size() > 1;
+    for (EventLoop* ioLoop : loops) {
+        // 在这里创建绑定（所有socket在start()返回时都已经绑定好），在各自的loop线程开始接收
+        UdpSocket* socket = new UdpSocket(ioLoop, InetAddress(static_cast<uint16_t>(port_)), reusePort);
+        sockets_.emplace_back(socket);
+        socket->setMessageCallback(messageCallback_);
+        socket->setBatchSize(batchSize_);
+        socket->setMaxDatagramSize(maxDatagramSize_);
+        if (gro_) {
+            socket->setGro(true);
+        }
+        if (receiveBufferSize_ > 0) {
+            socket->setReceiveBufferSize(receiveBufferSize_);
+        }
+        ioLoop->runInLoop([socket]() { socket->start(); });
+    }
+}
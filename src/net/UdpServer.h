@@ -0,0 +1,74 @@
+#ifndef TINY_NETWORK_NET_UDPSERVER_H
+#define TINY_NETWORK_NET_UDPSERVER_H
+
+#include "../base/noncopyable.h"
+#include "UdpSocket.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class EventLoop;
+class EventLoopThreadPool;
+
+// UdpServer：在一个端口上接收UDP数据报，可以分给多个IO线程
+//
+// 使用方式：
+// UdpServer server(&loop, "EchoServer", 9000);
+// server.setThreadNum(4);
+// server.setMessageCallback([](UdpSocket* socket, const UdpDatagram* d, size_t n) {
+//     socket->sendBatch(d, n);    // 回显
+// });
+// server.start();
+//
+// UDP没有连接，不需要Acceptor：每个IO loop一个UdpSocket，都用SO_REUSEPORT绑定同一个端口，
+// 内核按来源地址的hash把数据报分给它们，同一个来源总是到同一个socket（同一个线程）
+// 回调在收到数据报的socket所在的loop线程执行，回复也用这个socket发
+class UdpServer : noncopyable {
+public:
+    using MessageCallback = UdpSocket::MessageCallback;
+    using ThreadInitCallback = std::function<void(EventLoop*)>;
+    
+    UdpServer(EventLoop* loop, const std::string& name, int port);
+    ~UdpServer();
+    
+    EventLoop* getLoop() const { return loop_; }
+    const std::string& name() const { return name_; }
+    
+    // === 回调设置（start()之前） ===
+    void setMessageCallback(const MessageCallback& cb) { messageCallback_ = cb; }
+    
+    // 同TcpServer::setThreadInitCallback
+    void setThreadInitCallback(const ThreadInitCallback& cb) { threadInitCallback_ = cb; }
+    
+    // === 每个socket的设置（start()之前，见UdpSocket） ===
+    void setBatchSize(size_t n) { batchSize_ = n; }
+    void setMaxDatagramSize(size_t bytes) { maxDatagramSize_ = bytes; }
+    void setGro(bool on) { gro_ = on; }
+    void setReceiveBufferSize(int bytes) { receiveBufferSize_ = bytes; }
+    
+    // 设置IO线程数量（0表示只在getLoop()上收）
+    void setThreadNum(int numThreads);
+    
+    // 启动：每个IO loop创建一个socket开始接收
+    void start();
+    
+    // 所有socket（start()之后），只能在各自的loop线程使用
+    const std::vector<std::unique_ptr<UdpSocket>>& sockets() const { return sockets_; }
+
+private:
+    EventLoop* loop_;
+    const std::string name_;
+    const int port_;
+    std::unique_ptr<EventLoopThreadPool> threadPool_;
+    MessageCallback messageCallback_;
+    ThreadInitCallback threadInitCallback_;
+    size_t batchSize_;
+    size_t maxDatagramSize_;
+    bool gro_;
+    int receiveBufferSize_;     // 0表示不修改
+    bool started_;
+    std::vector<std::unique_ptr<UdpSocket>> sockets_;
+};
+
+#endif
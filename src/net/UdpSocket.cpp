@@ -0,0 +1,414 @@
+#include "UdpSocket.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "../logger/Logger.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <unistd.h>
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+const size_t UdpSocket::kDefaultBatchSize;
+const size_t UdpSocket::kMaxBatchSize;
+const size_t UdpSocket::kDefaultMaxDatagramSize;
+const size_t UdpSocket::kMaxDatagramsPerEvent;
+const size_t UdpSocket::kDefaultMaxPendingBytes;
+
+namespace {
+
+// 开启GRO时每格要能放下合并后的最大数据报
+const size_t kGroSlotSize = 65536;
+
+// GSO一次最多切多少段（内核的UDP_MAX_SEGMENTS），以及一次最多多少字节
+const size_t kMaxGsoSegments = 64;
+const size_t kMaxGsoBytes = 65000;
+
+bool isWouldBlock(int err) {
+    // ENOBUFS：网卡队列满了，和发送缓冲区满一样处理
+    return err == EAGAIN || err == EWOULDBLOCK || err == ENOBUFS;
+}
+
+}  // namespace
+
+UdpSocket::UdpSocket(EventLoop* loop, const InetAddress& bindAddr, bool reusePort)
+    : loop_(loop),
+      sockfd_(::socket(bindAddr.family(), SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)),
+      channel_(new Channel(sockfd_)),
+      batchSize_(kDefaultBatchSize),
+      maxDatagramSize_(kDefaultMaxDatagramSize),
+      gro_(false),
+      started_(false),
+      registered_(false),
+      slotSize_(0),
+      pendingBytes_(0),
+      maxPendingBytes_(kDefaultMaxPendingBytes),
+      gsoSupported_(false),
+      receivedDatagrams_(0),
+      receivedBytes_(0),
+      receiveCalls_(0),
+      truncatedDatagrams_(0),
+      sentDatagrams_(0),
+      sendCalls_(0),
+      droppedDatagrams_(0)
+{
+    if (sockfd_ < 0) {
+        LOG_ERROR << "UdpSocket: socket() failed: " << strerror(errno);
+        return;
+    }
+    
+    int on = 1;
+    ::setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+    if (reusePort && ::setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &on, sizeof on) < 0) {
+        LOG_ERROR << "UdpSocket: SO_REUSEPORT failed: " << strerror(errno);
+    }
+    if (::bind(sockfd_, bindAddr.getSockAddr(), bindAddr.getSockLen()) < 0) {
+        LOG_ERROR << "UdpSocket: bind " << bindAddr.toIpPort() << " failed: " << strerror(errno);
+    }
+    
+    // 段大小为0的UDP_SEGMENT不改变行为，只用来探测内核是否支持GSO
+    int zero = 0;
+    gsoSupported_ = ::setsockopt(sockfd_, SOL_UDP, UDP_SEGMENT, &zero, sizeof zero) == 0;
+    
+    channel_->setReadCallback(std::bind(&UdpSocket::handleRead, this));
+    channel_->setWriteCallback(std::bind(&UdpSocket::handleWrite, this));
+    LOG_DEBUG << "UdpSocket::ctor fd=" << sockfd_ << " bound to " << bindAddr.toIpPort();
+}
+
+UdpSocket::~UdpSocket() {
+    // 先从Poller中移除，否则fd被复用时新的Channel会走MOD分支而注册失败
+    if (registered_) {
+        channel_->disableAll();
+        loop_->removeChannel(channel_.get());
+    }
+    if (sockfd_ >= 0) {
+        ::close(sockfd_);
+    }
+}
+
+InetAddress UdpSocket::localAddress() const {
+    struct sockaddr_in6 addr;
+    memset(&addr, 0, sizeof addr);
+    socklen_t len = sizeof addr;
+    ::getsockname(sockfd_, reinterpret_cast<struct sockaddr*>(&addr), &len);
+    return InetAddress(addr);
+}
+
+void UdpSocket::setBatchSize(size_t n) {
+    assert(!started_);
+    batchSize_ = std::max<size_t>(1, std::min(n, kMaxBatchSize));
+}
+
+bool UdpSocket::setGro(bool on) {
+    assert(!started_);
+    int optval = on ? 1 : 0;
+    if (::setsockopt(sockfd_, SOL_UDP, UDP_GRO, &optval, sizeof optval) < 0) {
+        LOG_WARN << "UdpSocket: UDP_GRO not supported: " << strerror(errno);
+        gro_ = false;
+        return false;
+    }
+    gro_ = on;
+    return true;
+}
+
+void UdpSocket::setReceiveBufferSize(int bytes) {
+    ::setsockopt(sockfd_, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof bytes);
+}
+
+void UdpSocket::setSendBufferSize(int bytes) {
+    ::setsockopt(sockfd_, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof bytes);
+}
+
+void UdpSocket::start() {
+    if (started_) {
+        return;
+    }
+    started_ = true;
+    
+    // 每格一个数据报，msghdr里的指针在这里设好，之后每次recvmmsg()只重置长度
+    slotSize_ = gro_ ? kGroSlotSize : maxDatagramSize_;
+    const size_t controlSize = gro_ ? CMSG_SPACE(sizeof(int)) : 0;
+    ring_.resize(batchSize_ * slotSize_);
+    iovecs_.resize(batchSize_);
+    msgs_.resize(batchSize_);
+    addrs_.resize(batchSize_);
+    controls_.resize(batchSize_ * controlSize);
+    datagrams_.reserve(batchSize_);
+    for (size_t i = 0; i < batchSize_; ++i) {
+        iovecs_[i].iov_base = &ring_[i * slotSize_];
+        iovecs_[i].iov_len = slotSize_;
+        struct msghdr& hdr = msgs_[i].msg_hdr;
+        memset(&hdr, 0, sizeof hdr);
+        hdr.msg_name = &addrs_[i];
+        hdr.msg_iov = &iovecs_[i];
+        hdr.msg_iovlen = 1;
+        if (controlSize > 0) {
+            hdr.msg_control = &controls_[i * controlSize];
+        }
+    }
+    
+    channel_->enableReading();
+    loop_->updateChannel(channel_.get());
+    registered_ = true;
+}
+
+void UdpSocket::handleRead() {
+    const size_t controlSize = gro_ ? CMSG_SPACE(sizeof(int)) : 0;
+    size_t total = 0;
+    while (total < kMaxDatagramsPerEvent) {
+        // 上一次recvmmsg()改写了这些长度
+        for (size_t i = 0; i < batchSize_; ++i) {
+            msgs_[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+            msgs_[i].msg_hdr.msg_controllen = controlSize;
+            msgs_[i].msg_hdr.msg_flags = 0;
+        }
+        
+        int n = ::recvmmsg(sockfd_, msgs_.data(), static_cast<unsigned int>(batchSize_), 0, nullptr);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                LOG_ERROR << "UdpSocket::handleRead recvmmsg error: " << strerror(errno);
+            }
+            break;
+        }
+        ++receiveCalls_;
+        deliver(n);
+        total += n;
+        
+        // 没有读满一批，说明已经读空了，省一次返回EAGAIN的系统调用
+        if (static_cast<size_t>(n) < batchSize_) {
+            break;
+        }
+    }
+}
+
+void UdpSocket::deliver(int count) {
+    datagrams_.clear();
+    for (int i = 0; i < count; ++i) {
+        struct msghdr& hdr = msgs_[i].msg_hdr;
+        const char* data = static_cast<const char*>(iovecs_[i].iov_base);
+        size_t len = msgs_[i].msg_len;
+        if (hdr.msg_flags & MSG_TRUNC) {
+            ++truncatedDatagrams_;
+        }
+        InetAddress peer(addrs_[i]);
+        
+        // GRO合并的数据报带着原来每段的大小（最后一段可能短一些）
+        size_t segmentSize = 0;
+        if (gro_) {
+            for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+                if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                    int gsoSize = 0;
+                    memcpy(&gsoSize, CMSG_DATA(cmsg), sizeof gsoSize);
+                    segmentSize = static_cast<size_t>(gsoSize);
+                }
+            }
+        }
+        
+        if (segmentSize > 0 && segmentSize < len) {
+            for (size_t offset = 0; offset < len; offset += segmentSize) {
+                datagrams_.push_back(UdpDatagram(data + offset, std::min(segmentSize, len - offset), peer));
+            }
+        } else {
+            datagrams_.push_back(UdpDatagram(data, len, peer));
+        }
+        receivedBytes_ += len;
+    }
+    receivedDatagrams_ += datagrams_.size();
+    
+    if (messageCallback_) {
+        messageCallback_(this, datagrams_.data(), datagrams_.size());
+    }
+}
+
+bool UdpSocket::sendTo(const char* data, size_t len, const InetAddress& peer) {
+    // 前面还有排队的，直接发会乱序
+    if (!pending_.empty()) {
+        return enqueue(data, len, peer);
+    }
+    
+    ++sendCalls_;
+    ssize_t n = ::sendto(sockfd_, data, len, 0, peer.getSockAddr(), peer.getSockLen());
+    if (n >= 0) {
+        ++sentDatagrams_;
+        return true;
+    }
+    if (isWouldBlock(errno)) {
+        return enqueue(data, len, peer);
+    }
+    LOG_ERROR << "UdpSocket::sendTo " << peer.toIpPort() << " error: " << strerror(errno);
+    ++droppedDatagrams_;
+    return false;
+}
+
+size_t UdpSocket::sendBatch(const UdpDatagram* datagrams, size_t count) {
+    uint64_t droppedBefore = droppedDatagrams_;
+    size_t done = 0;
+    if (pending_.empty()) {
+        done = sendNow(datagrams, count);
+    }
+    for (size_t i = done; i < count; ++i) {
+        enqueue(datagrams[i].data, datagrams[i].len, datagrams[i].peer);
+    }
+    return count - static_cast<size_t>(droppedDatagrams_ - droppedBefore);
+}
+
+size_t UdpSocket::sendSegments(const char* data, size_t len, size_t segmentSize, const InetAddress& peer) {
+    assert(segmentSize > 0);
+    uint64_t droppedBefore = droppedDatagrams_;
+    size_t segments = (len + segmentSize - 1) / segmentSize;
+    const size_t perCall = std::max<size_t>(1, std::min(kMaxGsoSegments, kMaxGsoBytes / segmentSize));
+    
+    size_t offset = 0;
+    if (gsoSupported_ && segments > 1 && pending_.empty()) {
+        char control[CMSG_SPACE(sizeof(uint16_t))];
+        while (offset < len) {
+            size_t chunk = std::min(len - offset, perCall * segmentSize);
+            struct iovec iov;
+            iov.iov_base = const_cast<char*>(data + offset);
+            iov.iov_len = chunk;
+            struct msghdr hdr;
+            memset(&hdr, 0, sizeof hdr);
+            hdr.msg_name = const_cast<struct sockaddr*>(peer.getSockAddr());
+            hdr.msg_namelen = peer.getSockLen();
+            hdr.msg_iov = &iov;
+            hdr.msg_iovlen = 1;
+            
+            // 只有一段时不用带UDP_SEGMENT
+            if (chunk > segmentSize) {
+                memset(control, 0, sizeof control);
+                hdr.msg_control = control;
+                hdr.msg_controllen = sizeof control;
+                struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t gsoSize = static_cast<uint16_t>(segmentSize);
+                memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof gsoSize);
+            }
+            
+            ++sendCalls_;
+            if (::sendmsg(sockfd_, &hdr, 0) < 0) {
+                if (isWouldBlock(errno)) {
+                    break;
+                }
+                // 比如网卡不支持校验和卸载（EIO），之后都不再用GSO
+                LOG_WARN << "UdpSocket::sendSegments GSO failed, falling back: " << strerror(errno);
+                gsoSupported_ = false;
+                break;
+            }
+            sentDatagrams_ += (chunk + segmentSize - 1) / segmentSize;
+            offset += chunk;
+        }
+    }
+    
+    // 剩下的（不支持GSO或者发送缓冲区满了）一段一段地走sendBatch()
+    if (offset < len) {
+        std::vector<UdpDatagram> rest;
+        rest.reserve((len - offset + segmentSize - 1) / segmentSize);
+        for (; offset < len; offset += segmentSize) {
+            rest.push_back(UdpDatagram(data + offset, std::min(segmentSize, len - offset), peer));
+        }
+        sendBatch(rest.data(), rest.size());
+    }
+    return segments - static_cast<size_t>(droppedDatagrams_ - droppedBefore);
+}
+
+size_t UdpSocket::sendNow(const UdpDatagram* datagrams, size_t count) {
+    size_t done = 0;
+    while (done < count) {
+        size_t n = std::min(count - done, kMaxBatchSize);
+        if (sendMsgs_.size() < n) {
+            sendMsgs_.resize(n);
+            sendIovecs_.resize(n);
+        }
+        for (size_t i = 0; i < n; ++i) {
+            const UdpDatagram& d = datagrams[done + i];
+            sendIovecs_[i].iov_base = const_cast<char*>(d.data);
+            sendIovecs_[i].iov_len = d.len;
+            struct msghdr& hdr = sendMsgs_[i].msg_hdr;
+            memset(&hdr, 0, sizeof hdr);
+            hdr.msg_name = const_cast<struct sockaddr*>(d.peer.getSockAddr());
+            hdr.msg_namelen = d.peer.getSockLen();
+            hdr.msg_iov = &sendIovecs_[i];
+            hdr.msg_iovlen = 1;
+        }
+        
+        ++sendCalls_;
+        int sent = ::sendmmsg(sockfd_, sendMsgs_.data(), static_cast<unsigned int>(n), 0);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (isWouldBlock(errno)) {
+                break;
+            }
+            // 第一个数据报就出错（比如太大），丢掉它继续发后面的
+            LOG_ERROR << "UdpSocket::sendNow " << datagrams[done].peer.toIpPort()
+                      << " error: " << strerror(errno);
+            ++droppedDatagrams_;
+            ++done;
+            continue;
+        }
+        sentDatagrams_ += sent;
+        done += sent;
+        
+        // 只发出一部分时继续：下一轮要么EAGAIN（发送缓冲区满了），要么拿到具体的错误
+        if (sent == 0) {
+            break;
+        }
+    }
+    return done;
+}
+
+bool UdpSocket::enqueue(const char* data, size_t len, const InetAddress& peer) {
+    if (pendingBytes_ + len > maxPendingBytes_) {
+        ++droppedDatagrams_;
+        return false;
+    }
+    pending_.emplace_back(data, len, peer);
+    pendingBytes_ += len;
+    if (!channel_->isWriting()) {
+        channel_->enableWriting();
+        loop_->updateChannel(channel_.get());
+        registered_ = true;
+    }
+    return true;
+}
+
+void UdpSocket::handleWrite() {
+    flushPending();
+}
+
+void UdpSocket::flushPending() {
+    std::vector<UdpDatagram> batch;
+    while (!pending_.empty()) {
+        size_t n = std::min(pending_.size(), kMaxBatchSize);
+        batch.clear();
+        for (size_t i = 0; i < n; ++i) {
+            const Pending& p = pending_[i];
+            batch.push_back(UdpDatagram(p.data.data(), p.data.size(), p.peer));
+        }
+        size_t done = sendNow(batch.data(), n);
+        for (size_t i = 0; i < done; ++i) {
+            pendingBytes_ -= pending_.front().data.size();
+            pending_.pop_front();
+        }
+        if (done < n) {
+            return;
+        }
+    }
+    
+    channel_->disableWriting();
+    loop_->updateChannel(channel_.get());
+}
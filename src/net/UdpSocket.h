@@ -0,0 +1,173 @@
+#ifndef TINY_NETWORK_NET_UDPSOCKET_H
+#define TINY_NETWORK_NET_UDPSOCKET_H
+
+#include "../base/noncopyable.h"
+#include "InetAddress.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+class Channel;
+class EventLoop;
+
+// 一个数据报：收到时data只在回调期间有效；发送时由调用者提供
+struct UdpDatagram {
+    UdpDatagram() : data(nullptr), len(0), peer(0) {}
+    UdpDatagram(const char* d, size_t l, const InetAddress& p) : data(d), len(l), peer(p) {}
+    
+    const char* data;
+    size_t len;
+    InetAddress peer;     // 来源（收到时）或者目的地址（发送时）
+};
+
+// UdpSocket：注册在EventLoop上的非阻塞UDP socket
+//
+// 使用方式：
+// UdpSocket socket(&loop, InetAddress(9000));
+// socket.setMessageCallback([](UdpSocket* s, const UdpDatagram* d, size_t n) { ... });
+// socket.start();
+//
+// 接收：可读时用recvmmsg()一次读一批（setBatchSize()，默认64），读到EAGAIN为止
+// （每次事件最多kMaxDatagramsPerEvent个，避免饿死同一个loop上的其他fd），
+// 每一批调用一次MessageCallback。数据报读进预先分配好的一圈缓冲区，之后一直复用，接收时不分配内存
+//
+// 发送：sendTo()/sendBatch()直接写socket（sendBatch()用sendmmsg()一次发一批），
+// 内核的发送缓冲区满时拷贝到发送队列，可写时用sendmmsg()发出；
+// 队列超过setMaxPendingBytes()的数据报丢掉（UDP本来就不保证送达），计入droppedDatagrams
+//
+// GRO/GSO（内核4.18/5.0以上）：
+// - setGro(true)之后内核把同一个流的多个数据报合并成一个大的交上来，这里再按段大小拆开，
+//   回调看到的还是一个一个的数据报（缓冲区每格按64KB分配）
+// - sendSegments()把一段按segmentSize切成多个数据报，只用一次系统调用发出（UDP_SEGMENT），
+//   内核不支持时退回sendBatch()
+//
+// 所有函数都只能在loop线程调用（构造除外），析构也要在loop线程（或者loop还没开始循环）
+class UdpSocket : noncopyable {
+public:
+    using MessageCallback = std::function<void(UdpSocket* socket, const UdpDatagram* datagrams, size_t count)>;
+    
+    // 默认值
+    static const size_t kDefaultBatchSize = 64;
+    static const size_t kMaxBatchSize = 1024;           // sendmmsg/recvmmsg一次最多UIO_MAXIOV个
+    static const size_t kDefaultMaxDatagramSize = 2048;
+    static const size_t kMaxDatagramsPerEvent = 1024;
+    static const size_t kDefaultMaxPendingBytes = 4 * 1024 * 1024;
+    
+    // 绑定bindAddr（端口为0时由内核选择，用localAddress()查看）
+    // reusePort：多个socket绑定同一个端口，内核按来源地址把数据报分给它们（每个IO线程一个socket）
+    UdpSocket(EventLoop* loop, const InetAddress& bindAddr, bool reusePort = false);
+    ~UdpSocket();
+    
+    EventLoop* getLoop() const { return loop_; }
+    int fd() const { return sockfd_; }
+    InetAddress localAddress() const;
+    
+    void setMessageCallback(const MessageCallback& cb) { messageCallback_ = cb; }
+    
+    // === 接收（start()之前设置） ===
+    // 每次recvmmsg()最多读几个数据报，1表示每个数据报一次系统调用
+    void setBatchSize(size_t n);
+    
+    // 超过这个大小的数据报被截断（计入truncatedDatagrams），开启GRO时不起作用
+    void setMaxDatagramSize(size_t bytes) { maxDatagramSize_ = bytes; }
+    
+    // 开启UDP GRO，内核不支持时返回false
+    bool setGro(bool on);
+    
+    // 内核的接收/发送缓冲区大小（SO_RCVBUF/SO_SNDBUF）
+    void setReceiveBufferSize(int bytes);
+    void setSendBufferSize(int bytes);
+    
+    // 开始接收
+    void start();
+    
+    // === 发送 ===
+    // 发送队列超过这么多字节时丢掉新的数据报
+    void setMaxPendingBytes(size_t bytes) { maxPendingBytes_ = bytes; }
+    
+    // 发送一个数据报，被丢掉时返回false
+    bool sendTo(const char* data, size_t len, const InetAddress& peer);
+    
+    // 用sendmmsg()发送一批，返回没有被丢掉的个数
+    size_t sendBatch(const UdpDatagram* datagrams, size_t count);
+    
+    // GSO：把[data, data + len)按segmentSize切开发给peer，返回没有被丢掉的数据报个数
+    size_t sendSegments(const char* data, size_t len, size_t segmentSize, const InetAddress& peer);
+    
+    size_t pendingBytes() const { return pendingBytes_; }
+    
+    // === 统计（loop线程读取） ===
+    uint64_t receivedDatagrams() const { return receivedDatagrams_; }
+    uint64_t receivedBytes() const { return receivedBytes_; }
+    uint64_t receiveCalls() const { return receiveCalls_; }     // recvmmsg()的次数
+    uint64_t truncatedDatagrams() const { return truncatedDatagrams_; }
+    uint64_t sentDatagrams() const { return sentDatagrams_; }
+    uint64_t sendCalls() const { return sendCalls_; }           // sendto/sendmmsg/sendmsg的次数
+    uint64_t droppedDatagrams() const { return droppedDatagrams_; }
+
+private:
+    // 排队等待发送的数据报
+    struct Pending {
+        Pending(const char* d, size_t l, const InetAddress& p) : data(d, l), peer(p) {}
+        
+        std::string data;
+        InetAddress peer;
+    };
+    
+    void handleRead();
+    void handleWrite();
+    
+    // 一批收到的数据报交给回调（GRO合并的拆开）
+    void deliver(int count);
+    
+    // 直接用sendmmsg()发送，返回处理掉的个数（发出的加上出错丢掉的），小于count说明发送缓冲区满了
+    size_t sendNow(const UdpDatagram* datagrams, size_t count);
+    
+    // 放进发送队列，开始关注可写
+    bool enqueue(const char* data, size_t len, const InetAddress& peer);
+    
+    // 发送队列：可写时尽量发出
+    void flushPending();
+    
+    EventLoop* loop_;
+    int sockfd_;
+    std::unique_ptr<Channel> channel_;
+    MessageCallback messageCallback_;
+    size_t batchSize_;
+    size_t maxDatagramSize_;
+    bool gro_;
+    bool started_;
+    bool registered_;       // channel_已经加入Poller
+    
+    // 接收的缓冲区，start()时按batchSize_分配，之后一直复用
+    size_t slotSize_;
+    std::vector<char> ring_;
+    std::vector<struct iovec> iovecs_;
+    std::vector<struct mmsghdr> msgs_;
+    std::vector<struct sockaddr_in6> addrs_;  // 放得下IPv4和IPv6的对端地址
+    std::vector<char> controls_;             // 每格一个GRO的cmsg
+    std::vector<UdpDatagram> datagrams_;     // 交给回调的一批
+    
+    // 发送
+    std::vector<struct iovec> sendIovecs_;
+    std::vector<struct mmsghdr> sendMsgs_;
+    std::deque<Pending> pending_;
+    size_t pendingBytes_;
+    size_t maxPendingBytes_;
+    bool gsoSupported_;
+    
+    uint64_t receivedDatagrams_;
+    uint64_t receivedBytes_;
+    uint64_t receiveCalls_;
+    uint64_t truncatedDatagrams_;
+    uint64_t sentDatagrams_;
+    uint64_t sendCalls_;
+    uint64_t droppedDatagrams_;
+};
+
+#endif
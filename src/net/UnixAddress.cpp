@@ -0,0 +1,53 @@
+#include "UnixAddress.h"
+#include "../logger/Logger.h"
+#include <algorithm>
+#include <cstddef>      // 为了使用 offsetof
+#include <cstring>
+
+UnixAddress::UnixAddress(const std::string& path) {
+    memset(&addr_, 0, sizeof(addr_));
+    addr_.sun_family = AF_UNIX;
+    
+    // 文件路径要留一个字节给结尾的'\0'；抽象地址的名字前面是'\0'，后面不需要
+    bool abstract = !path.empty() && path[0] == '@';
+    size_t maxLen = abstract ? sizeof(addr_.sun_path) : sizeof(addr_.sun_path) - 1;
+    size_t len = std::min(path.size(), maxLen);
+    if (len < path.size()) {
+        LOG_ERROR << "UnixAddress: path too long, truncated: " << path;
+    }
+    memcpy(addr_.sun_path, path.data(), len);
+    if (abstract) {
+        addr_.sun_path[0] = '\0';
+        len_ = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + len);
+    } else {
+        len_ = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + len + 1);
+    }
+}
+
+UnixAddress::UnixAddress(const struct sockaddr_un& addr, socklen_t len)
+    : addr_(addr),
+      len_(len) {
+}
+
+std::string UnixAddress::path() const {
+    size_t offset = offsetof(struct sockaddr_un, sun_path);
+    if (len_ <= offset) {
+        return std::string();   // 没有bind()的客户端socket
+    }
+    if (isAbstract()) {
+        return "@" + std::string(addr_.sun_path + 1, len_ - offset - 1);
+    }
+    return std::string(addr_.sun_path, strnlen(addr_.sun_path, len_ - offset));
+}
+
+bool UnixAddress::isAbstract() const {
+    return len_ > offsetof(struct sockaddr_un, sun_path) && addr_.sun_path[0] == '\0';
+}
+
+std::string UnixAddress::toString() const {
+    return "unix:" + path();
+}
+
+const struct sockaddr* UnixAddress::getSockAddr() const {
+    return reinterpret_cast<const struct sockaddr*>(&addr_);
+}
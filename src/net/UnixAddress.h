@@ -0,0 +1,34 @@
+#ifndef TINY_NETWORK_NET_UNIXADDRESS_H
+#define TINY_NETWORK_NET_UNIXADDRESS_H
+
+#include <sys/socket.h>
+#include <sys/un.h>      // 为了使用 sockaddr_un
+#include <string>
+
+// Unix域socket的地址（AF_UNIX），和InetAddress一样是一个值类型
+//
+// 两种地址：
+// - 文件路径，比如"/run/app.sock"：bind()时在文件系统里创建socket文件，权限由目录和文件控制
+// - 抽象命名空间（Linux特有），用'@'开头表示，比如"@app"：不创建文件，最后一个socket关闭时自动消失，
+//   实际的sun_path是'\0'加上名字
+class UnixAddress {
+public:
+    // 路径超过sun_path的长度（108字节）时截断
+    explicit UnixAddress(const std::string& path);
+    UnixAddress(const struct sockaddr_un& addr, socklen_t len);  // 从accept()/getsockname()的结果构造
+    
+    // 获取信息
+    std::string path() const;        // 抽象地址以'@'开头
+    bool isAbstract() const;
+    std::string toString() const;    // "unix:" + path()
+    
+    // 获取原始地址（给socket API使用）
+    const struct sockaddr* getSockAddr() const;
+    socklen_t getSockLen() const { return len_; }
+
+private:
+    sockaddr_un addr_;
+    socklen_t len_;     // 抽象地址的长度决定了名字在哪里结束，不能用sizeof(addr_)
+};
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef TINY_NETWORK_TESTS_TESTUTIL_H
+#define TINY_NETWORK_TESTS_TESTUTIL_H
+
+#include "EventLoop.h"
+#include "Timestamp.h"
+#include <functional>
+#include <future>
+#include <unistd.h>
+
+// 测试共用的辅助函数：测试代码跑在主线程，网络对象跑在EventLoopThread里
+//
+// 用到这些函数的测试需要定义 EventLoop* g_loop，并在main()里指向loop线程的EventLoop
+
+extern EventLoop* g_loop;
+
+// 在loop线程执行f并等它完成
+inline void runSync(const std::function<void()>& f) {
+    std::promise<void> done;
+    g_loop->runInLoop([&]() {
+        f();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
+// 最多等seconds秒直到cond成立（cond在调用线程求值）
+inline bool waitFor(const std::function<bool()>& cond, double seconds) {
+    Timestamp start = Timestamp::now();
+    while (!cond()) {
+        if (timeDifference(Timestamp::now(), start) > seconds) {
+            return false;
+        }
+        ::usleep(10 * 1000);
+    }
+    return true;
+}
+
+// 最多等seconds秒直到cond成立（cond在loop线程求值，可以直接读loop线程的状态）
+inline bool waitForInLoop(const std::function<bool()>& cond, double seconds) {
+    return waitFor([&]() {
+        bool ok = false;
+        runSync([&]() { ok = cond(); });
+        return ok;
+    }, seconds);
+}
+
+#endif
@@ -0,0 +1,108 @@
+// 测试Buffer的内存回收
+// 1. Buffer::shrink只保留可读数据
+// 2. TcpConnection的空闲收缩策略 + EventLoop的bufferedBytes统计
+
+#include "Buffer.h"
+#include "EventLoop.h"
+#include "TcpConnection.h"
+#include <iostream>
+#include <string>
+#include <memory>
+#include <cassert>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+// 测试1：Buffer::shrink
+void testShrink() {
+    std::cout << "--- Buffer::shrink ---" << std::endl;
+    
+    Buffer buf;
+    buf.append(std::string(1024 * 1024, 'x'));
+    assert(buf.internalCapacity() >= 1024 * 1024);
+    
+    // retrieveAll只重置下标，容量不变
+    buf.retrieveAll();
+    assert(buf.readableBytes() == 0);
+    assert(buf.internalCapacity() >= 1024 * 1024);
+    std::cout << "retrieveAll后容量: " << buf.internalCapacity() << std::endl;
+    
+    // shrink之后容量回到初始大小
+    buf.shrink(0);
+    assert(buf.internalCapacity() == Buffer::kInitialSize);
+    std::cout << "shrink后容量: " << buf.internalCapacity() << std::endl;
+    
+    // 有可读数据时shrink要保留数据
+    buf.append(std::string(4096, 'a'));
+    buf.append("hello");
+    buf.retrieve(4096);
+    buf.shrink(0);
+    assert(buf.retrieveAsString() == "hello");
+    
+    std::cout << "✅ Buffer::shrink正确" << std::endl;
+}
+
+// 测试2：大请求处理完后，空闲的连接会自动释放Buffer容量
+void testIdleShrink() {
+    std::cout << "--- TcpConnection空闲收缩 ---" << std::endl;
+    
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+    
+    EventLoop loop;
+    auto conn = std::make_shared<TcpConnection>(&loop, "shrink-test", fds[0]);
+    conn->setBufferShrinkThreshold(64 * 1024);
+    conn->setBufferIdleShrinkDelay(0.2);
+    
+    size_t received = 0;
+    const size_t total = 1024 * 1024;
+    size_t peak = 0;
+    conn->setMessageCallback([&](const std::shared_ptr<TcpConnection>&, Buffer* buf) {
+        // 不急着取走，让输入缓冲区涨到峰值
+        if (received + buf->readableBytes() >= total) {
+            received += buf->readableBytes();
+            peak = loop.bufferedBytes();
+            buf->retrieveAll();
+        }
+    });
+    conn->connectEstablished();
+    
+    // 对端一次性写入1MB
+    std::string data(total, 'y');
+    size_t written = 0;
+    while (written < total) {
+        ssize_t n = ::write(fds[1], data.data() + written, total - written);
+        if (n > 0) {
+            written += n;
+        }
+        if (written < total) {
+            loop.runAfter(0.01, [&loop]() { loop.quit(); });
+            loop.loop();
+        }
+    }
+    
+    // 等待空闲收缩（延迟0.2秒）
+    loop.runAfter(1.0, [&loop]() { loop.quit(); });
+    loop.loop();
+    
+    std::cout << "峰值占用: " << peak << " 字节, 收缩后: "
+              << loop.bufferedBytes() << " 字节" << std::endl;
+    assert(received == total);
+    assert(peak >= total);
+    assert(loop.bufferedBytes() <= 2 * 64 * 1024);
+    
+    conn->connectDestroyed();
+    assert(loop.bufferedBytes() == 0);
+    ::close(fds[1]);
+    
+    std::cout << "✅ 空闲连接的Buffer已收缩" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 测试Buffer内存回收 ===" << std::endl;
+    testShrink();
+    testIdleShrink();
+    return 0;
+}
@@ -0,0 +1,128 @@
+// 测试TcpConnection按类型存放的上下文
+// 1. 没有设置过时为nullptr，设置之后取到同一个对象
+// 2. 不同类型互不影响，不同连接互不影响
+// 3. 替换、清除和连接析构时释放对象
+// 4. 和按字符串key存放的上下文互不相干
+
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include <iostream>
+#include <memory>
+#include <string>
+#include <cassert>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct Session {
+    explicit Session(int i) : id(i) { ++alive; }
+    ~Session() { --alive; }
+    int id;
+    static int alive;
+};
+int Session::alive = 0;
+
+struct Counter {
+    int value = 0;
+};
+
+std::shared_ptr<TcpConnection> newConnection(EventLoop* loop, const std::string& name) {
+    int fds[2];
+    int rc = ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    assert(rc == 0);
+    (void)rc;
+    ::close(fds[1]);
+    return std::make_shared<TcpConnection>(loop, name, fds[0]);
+}
+
+void testSetAndGet(EventLoop* loop) {
+    std::cout << "\n[测试1] 设置和读取" << std::endl;
+    std::shared_ptr<TcpConnection> conn = newConnection(loop, "conn");
+    assert(conn->context<Session>() == nullptr);
+    
+    std::shared_ptr<Session> session = std::make_shared<Session>(1);
+    conn->setContext(session);
+    assert(conn->context<Session>() == session.get());
+    assert(conn->context<Session>()->id == 1);
+    
+    // 取到的是对象本身，修改对下一次读取可见
+    conn->setContext(std::make_shared<Counter>());
+    ++conn->context<Counter>()->value;
+    ++conn->context<Counter>()->value;
+    assert(conn->context<Counter>()->value == 2);
+    std::cout << "  ✓ 没有设置时为nullptr，设置之后取到同一个对象" << std::endl;
+}
+
+void testIndependent(EventLoop* loop) {
+    std::cout << "\n[测试2] 类型和连接互不影响" << std::endl;
+    std::shared_ptr<TcpConnection> a = newConnection(loop, "a");
+    std::shared_ptr<TcpConnection> b = newConnection(loop, "b");
+    a->setContext(std::make_shared<Session>(10));
+    b->setContext(std::make_shared<Session>(20));
+    a->setContext(std::make_shared<Counter>());
+    
+    assert(a->context<Session>()->id == 10);
+    assert(b->context<Session>()->id == 20);
+    assert(a->context<Counter>() != nullptr);
+    assert(b->context<Counter>() == nullptr);
+    std::cout << "  ✓ 每个连接、每个类型各有一份" << std::endl;
+}
+
+void testLifetime(EventLoop* loop) {
+    std::cout << "\n[测试3] 释放" << std::endl;
+    assert(Session::alive == 0);
+    {
+        std::shared_ptr<TcpConnection> conn = newConnection(loop, "conn");
+        conn->setContext(std::make_shared<Session>(1));
+        assert(Session::alive == 1);
+        
+        // 替换时旧的对象被释放
+        conn->setContext(std::make_shared<Session>(2));
+        assert(Session::alive == 1 && conn->context<Session>()->id == 2);
+        
+        conn->clearContext<Session>();
+        assert(Session::alive == 0 && conn->context<Session>() == nullptr);
+        
+        conn->setContext(std::make_shared<Session>(3));
+        assert(Session::alive == 1);
+    }
+    // 连接析构时释放
+    assert(Session::alive == 0);
+    
+    // 调用者还持有时不释放
+    std::shared_ptr<Session> kept = std::make_shared<Session>(4);
+    {
+        std::shared_ptr<TcpConnection> conn = newConnection(loop, "conn");
+        conn->setContext(kept);
+    }
+    assert(Session::alive == 1 && kept->id == 4);
+    std::cout << "  ✓ 替换、清除和连接析构时释放" << std::endl;
+}
+
+void testStringKeys(EventLoop* loop) {
+    std::cout << "\n[测试4] 和字符串key的上下文互不相干" << std::endl;
+    std::shared_ptr<TcpConnection> conn = newConnection(loop, "conn");
+    conn->setContext("Session", std::make_shared<Session>(7));
+    assert(conn->hasContext("Session"));
+    assert(conn->context<Session>() == nullptr);
+    
+    conn->setContext(std::make_shared<Session>(8));
+    conn->clearContext("Session");
+    assert(!conn->hasContext("Session"));
+    assert(conn->context<Session>()->id == 8);
+    std::cout << "  ✓ 两种方式各存各的" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 连接上下文 测试 ===" << std::endl;
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    testSetAndGet(&loop);
+    testIndependent(&loop);
+    testLifetime(&loop);
+    testStringKeys(&loop);
+    
+    std::cout << "\n=== 所有测试通过 ===" << std::endl;
+    return 0;
+}
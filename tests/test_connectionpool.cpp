@@ -0,0 +1,264 @@
+// 测试ConnectionPool
+// 1. 复用：用完放回的连接再次acquire()拿到的是同一个连接
+// 2. 上限：超过maxTotal的acquire()排队，有连接放回时按顺序拿到；等待超时返回ETIMEDOUT
+// 3. 取出时检查：对端刚关闭（关闭事件还没处理）的空闲连接不再交出去，换一个新连接
+// 4. 空闲：超过maxIdle的连接放回时关闭，空闲超时的连接被关闭
+// 5. 连接失败：回调拿到空连接和ECONNREFUSED；release(conn, false)关闭连接
+
+#include "ConnectionPool.h"
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include "TestUtil.h"
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cassert>
+#include <cstring>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+using ConnectionPtr = ConnectionPool::ConnectionPtr;
+
+const int kEchoPort = 18200;
+const int kDeadPort = 18201;      // 没有在监听
+const int kRawPort = 18202;       // 测试线程自己accept
+
+EventLoop* g_loop = nullptr;
+std::unique_ptr<ConnectionPool> g_pool;
+const InetAddress g_echoAddr("127.0.0.1", kEchoPort);
+
+ConnectionPool::Stats echoStats() {
+    ConnectionPool::Stats stats;
+    runSync([&]() { stats = g_pool->stats(g_echoAddr); });
+    return stats;
+}
+
+// 取一个连接，返回时已经拿到（或者失败）
+ConnectionPtr acquireSync(const InetAddress& addr, int* savedErrno = nullptr) {
+    std::promise<std::pair<ConnectionPtr, int>> result;
+    runSync([&]() {
+        g_pool->acquire(addr, [&](const ConnectionPtr& conn, int err) {
+            result.set_value(std::make_pair(conn, err));
+        });
+    });
+    std::pair<ConnectionPtr, int> r = result.get_future().get();
+    if (savedErrno) {
+        *savedErrno = r.second;
+    }
+    return r.first;
+}
+
+// 在连接上发一条消息，等回显
+void roundTrip(const ConnectionPtr& conn, const std::string& msg) {
+    std::promise<std::string> reply;
+    runSync([&]() {
+        conn->setMessageCallback([&](const ConnectionPtr&, Buffer* buf) {
+            if (buf->readableBytes() >= msg.size()) {
+                reply.set_value(buf->retrieveAsString());
+            }
+        });
+        conn->send(msg);
+    });
+    assert(reply.get_future().get() == msg);
+}
+
+void release(const ConnectionPtr& conn, bool reusable = true) {
+    runSync([&]() { g_pool->release(conn, reusable); });
+}
+
+void testReuse() {
+    std::cout << "\n[测试1] 复用" << std::endl;
+    
+    ConnectionPtr first = acquireSync(g_echoAddr);
+    assert(first);
+    roundTrip(first, "hello");
+    release(first);
+    
+    ConnectionPtr second = acquireSync(g_echoAddr);
+    assert(second == first);
+    roundTrip(second, "again");
+    release(second);
+    
+    ConnectionPool::Stats stats = echoStats();
+    assert(stats.connects == 1);
+    assert(stats.reuses == 1);
+    assert(stats.idle == 1 && stats.active == 0);
+    std::cout << "  ✓ 两次acquire()只建立了一个连接" << std::endl;
+}
+
+void testLimit() {
+    std::cout << "\n[测试2] 上限和排队" << std::endl;
+    
+    runSync([&]() { g_pool->setMaxTotal(2); });
+    ConnectionPtr a = acquireSync(g_echoAddr);
+    ConnectionPtr b = acquireSync(g_echoAddr);
+    assert(a && b && a != b);
+    
+    // 第三个排队
+    std::vector<int> order;
+    std::vector<ConnectionPtr> got;
+    runSync([&]() {
+        for (int i = 0; i < 2; ++i) {
+            g_pool->acquire(g_echoAddr, [&, i](const ConnectionPtr& conn, int) {
+                order.push_back(i);
+                got.push_back(conn);
+            });
+        }
+    });
+    ConnectionPool::Stats stats = echoStats();
+    assert(stats.waiting == 2 && stats.active == 2 && stats.connecting == 0);
+    
+    release(b);
+    assert(waitForInLoop([&]() { return order.size() == 1; }, 1.0));
+    assert(order[0] == 0 && got[0] == b);
+    
+    // 使用中的连接被关闭，空出的名额新建一个连接
+    runSync([&]() { a->forceClose(); });
+    assert(waitForInLoop([&]() { return order.size() == 2; }, 2.0));
+    assert(order[1] == 1 && got[1] && got[1] != a);
+    release(a);  // 已经关闭了，什么也不做
+    
+    // 等待超时
+    runSync([&]() { g_pool->setAcquireTimeout(0.2); });
+    Timestamp start = Timestamp::now();
+    int savedErrno = 0;
+    ConnectionPtr none = acquireSync(g_echoAddr, &savedErrno);
+    assert(!none && savedErrno == ETIMEDOUT);
+    assert(timeDifference(Timestamp::now(), start) >= 0.15);
+    
+    release(got[0]);
+    release(got[1]);
+    runSync([&]() {
+        g_pool->setMaxTotal(ConnectionPool::kDefaultMaxTotal);
+        g_pool->setAcquireTimeout(5.0);
+    });
+    stats = echoStats();
+    assert(stats.active == 0 && stats.waiting == 0);
+    std::cout << "  ✓ 按顺序交给等待者，关闭的连接让出名额，超时返回ETIMEDOUT" << std::endl;
+}
+
+void testCheckout() {
+    std::cout << "\n[测试3] 取出时检查" << std::endl;
+    
+    // 对端是一个普通的阻塞socket，由测试决定什么时候关闭
+    int listenfd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    ::setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kRawPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int rc = ::bind(listenfd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr);
+    assert(rc == 0);
+    rc = ::listen(listenfd, 16);
+    assert(rc == 0);
+    (void)rc;
+    
+    InetAddress raw("127.0.0.1", kRawPort);
+    ConnectionPtr conn = acquireSync(raw);
+    assert(conn);
+    int peer = ::accept(listenfd, nullptr, nullptr);
+    assert(peer >= 0);
+    release(conn);
+    
+    // 在同一次回调里关闭对端再acquire()：关闭事件还没来得及处理，只能靠取出时的检查
+    std::promise<ConnectionPtr> next;
+    runSync([&]() {
+        ::close(peer);
+        ::usleep(20 * 1000);
+        g_pool->acquire(raw, [&](const ConnectionPtr& c, int) { next.set_value(c); });
+    });
+    ConnectionPtr fresh = next.get_future().get();
+    assert(fresh && fresh != conn);
+    ConnectionPool::Stats stats;
+    runSync([&]() { stats = g_pool->stats(raw); });
+    assert(stats.evictions == 1 && stats.connects == 2 && stats.reuses == 0);
+    
+    release(fresh, false);
+    ::close(listenfd);
+    std::cout << "  ✓ 对端关闭的空闲连接没有交出去，换了一个新连接" << std::endl;
+}
+
+void testIdle() {
+    std::cout << "\n[测试4] 空闲连接" << std::endl;
+    
+    runSync([&]() { g_pool->setMaxIdle(2); });
+    std::vector<ConnectionPtr> conns;
+    for (int i = 0; i < 4; ++i) {
+        conns.push_back(acquireSync(g_echoAddr));
+    }
+    for (const ConnectionPtr& conn : conns) {
+        release(conn);
+    }
+    ConnectionPool::Stats stats = echoStats();
+    assert(stats.idle == 2 && stats.active == 0);
+    
+    uint64_t evictions = stats.evictions;
+    runSync([&]() { g_pool->setIdleTimeout(0.2); });
+    assert(waitForInLoop([&]() { return g_pool->stats(g_echoAddr).idle == 0; }, 1.0));
+    assert(echoStats().evictions == evictions + 2);
+    runSync([&]() {
+        g_pool->setIdleTimeout(30.0);
+        g_pool->setMaxIdle(ConnectionPool::kDefaultMaxIdle);
+    });
+    std::cout << "  ✓ 最多保留2个空闲连接，空闲超时后关闭" << std::endl;
+}
+
+void testFailure() {
+    std::cout << "\n[测试5] 连接失败" << std::endl;
+    
+    InetAddress dead("127.0.0.1", kDeadPort);
+    int savedErrno = 0;
+    ConnectionPtr conn = acquireSync(dead, &savedErrno);
+    assert(!conn && savedErrno == ECONNREFUSED);
+    ConnectionPool::Stats stats;
+    runSync([&]() { stats = g_pool->stats(dead); });
+    assert(stats.failures == 1 && stats.connecting == 0);
+    
+    conn = acquireSync(g_echoAddr);
+    release(conn, false);
+    assert(!conn->connected());
+    std::cout << "  ✓ 拿到ECONNREFUSED，不能复用的连接被关闭" << std::endl;
+}
+
+int main() {
+    std::cout << "=== ConnectionPool 测试 ===" << std::endl;
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    g_loop = &loop;
+    TcpServer echo(&loop, "EchoServer", kEchoPort);
+    echo.setMessageCallback([](const ConnectionPtr& conn, Buffer* buf) {
+        conn->send(buf->retrieveAsString());
+    });
+    echo.start();
+    g_pool.reset(new ConnectionPool(&loop, "TestPool"));
+    
+    std::thread driver([&]() {
+        testReuse();
+        testLimit();
+        testCheckout();
+        testIdle();
+        testFailure();
+        
+        runSync([&]() { g_pool.reset(); });
+        std::cout << "\n=== 所有测试通过 ===" << std::endl;
+        loop.quit();
+    });
+    
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,331 @@
+// 测试连接之间的转发（forwardTo）
+// 客户端 -> 中继（TcpServer，每个连接用TcpClient连到后端，两个方向forwardTo） -> 回显后端
+// 1. splice转发：数据原样往返，forwardTo()之前已经读进来的数据排在最前面
+// 2. 经过Buffer转发（useSplice=false）：结果一样，没有splice
+// 3. 背压：后端不读时中继停止读客户端，积压有上限；后端恢复后数据完整到达
+// 4. 关闭传递：客户端关闭后，中继的两个连接和后端的连接都关闭
+// 5. 重置传递：客户端用RST断开（SO_LINGER 0）时同样都关闭，splice和Buffer两种方式
+
+#include "TcpClient.h"
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "InetAddress.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "Logger.h"
+#include "TestUtil.h"
+#include <algorithm>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <cassert>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+EventLoop* g_loop = nullptr;
+const uint16_t kBackendPort = 18229;
+const uint16_t kRelayPort = 18230;
+
+// 回显后端，记住最近的连接（测试背压时停止读）
+struct Backend {
+    Backend() : server(g_loop, "Backend", InetAddress(kBackendPort)), disconnected(0) {
+        server.setConnectionCallback([this](const TcpServer::ConnectionPtr& c) {
+            if (c->connected()) {
+                conn = c;
+            } else {
+                ++disconnected;
+            }
+        });
+        server.setMessageCallback([](const TcpServer::ConnectionPtr& c, Buffer* buf) {
+            c->send(buf);
+        });
+        server.start();
+    }
+    
+    TcpServer server;
+    TcpServer::ConnectionPtr conn;
+    int disconnected;
+};
+
+// 中继：新连接进来之后延迟一会儿再连后端，这期间客户端发来的数据留在inputBuffer_里
+struct Relay {
+    explicit Relay(bool useSplice) : server(g_loop, "Relay", InetAddress(kRelayPort)), splice(useSplice) {
+        server.setConnectionCallback([this](const TcpServer::ConnectionPtr& c) {
+            if (c->connected()) {
+                inbound = c;
+                g_loop->runAfter(0.05, [this]() { connectBackend(); });
+            }
+        });
+        // 连上后端之前不取走数据
+        server.setMessageCallback([](const TcpServer::ConnectionPtr&, Buffer*) {});
+        server.start();
+    }
+    
+    void connectBackend() {
+        client.reset(new TcpClient(g_loop, InetAddress("127.0.0.1", kBackendPort), "RelayClient"));
+        client->setConnectionCallback([this](const TcpClient::ConnectionPtr& c) {
+            if (c->connected()) {
+                outbound = c;
+                bool ok = inbound->forwardTo(outbound, splice) && outbound->forwardTo(inbound, splice);
+                assert(ok);
+                (void)ok;
+            }
+        });
+        client->connect();
+    }
+    
+    TcpServer server;
+    bool splice;
+    std::unique_ptr<TcpClient> client;
+    TcpServer::ConnectionPtr inbound;
+    TcpClient::ConnectionPtr outbound;
+};
+
+std::string pattern(size_t len) {
+    std::string s(len, '\0');
+    for (size_t i = 0; i < len; ++i) {
+        s[i] = static_cast<char>(i % 251);
+    }
+    return s;
+}
+
+int connectRelay() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    InetAddress addr("127.0.0.1", kRelayPort);
+    int rc = ::connect(fd, addr.getSockAddr(), addr.getSockLen());
+    assert(rc == 0);
+    (void)rc;
+    return fd;
+}
+
+// 一个线程写，当前线程读回同样多的字节（不多读）
+std::string roundTrip(int fd, const std::string& data) {
+    std::thread writer([fd, &data]() {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = ::write(fd, data.data() + sent, data.size() - sent);
+            assert(n > 0);
+            sent += n;
+        }
+    });
+    std::string echoed;
+    char buf[65536];
+    while (echoed.size() < data.size()) {
+        ssize_t n = ::read(fd, buf, std::min(sizeof buf, data.size() - echoed.size()));
+        assert(n > 0);
+        echoed.append(buf, n);
+    }
+    writer.join();
+    return echoed;
+}
+
+void testRelay(bool useSplice) {
+    std::unique_ptr<Backend> backend;
+    std::unique_ptr<Relay> relay;
+    runSync([&]() {
+        backend.reset(new Backend);
+        relay.reset(new Relay(useSplice));
+    });
+    
+    int fd = connectRelay();
+    // 中继还没连上后端，这6个字节在forwardTo()时经过Buffer转发
+    ssize_t rc = ::write(fd, "early|", 6);
+    assert(rc == 6);
+    (void)rc;
+    ::usleep(100 * 1000);
+    std::string data = "early|" + pattern(8 * 1024 * 1024);
+    std::string echoed = roundTrip(fd, data.substr(6));
+    // 回显里early|在最前面，所以最后还剩6个字节
+    char rest[6];
+    size_t got = 0;
+    while (got < sizeof rest) {
+        ssize_t n = ::read(fd, rest + got, sizeof rest - got);
+        assert(n > 0);
+        got += n;
+    }
+    assert(echoed + std::string(rest, 6) == data);
+    
+    runSync([&]() {
+        if (useSplice) {
+            assert(relay->inbound->splicedBytes() > 0 && relay->outbound->splicedBytes() > 0);
+            // 只有forwardTo()之前读进来的数据经过了Buffer
+            assert(relay->inbound->forwardCopiedBytes() == 6);
+        } else {
+            assert(relay->inbound->splicedBytes() == 0);
+            assert(relay->inbound->forwardCopiedBytes() == data.size());
+        }
+    });
+    ::close(fd);
+    runSync([&]() {
+        relay.reset();
+        backend.reset();
+    });
+}
+
+void testSplice() {
+    std::cout << "\n[测试1] splice转发" << std::endl;
+    testRelay(true);
+    std::cout << "  ✓ 8MB原样往返，早到的数据排在最前面" << std::endl;
+}
+
+void testBuffered() {
+    std::cout << "\n[测试2] 经过Buffer转发" << std::endl;
+    testRelay(false);
+    std::cout << "  ✓ 8MB原样往返，没有splice" << std::endl;
+}
+
+void testBackpressure() {
+    std::cout << "\n[测试3] 背压" << std::endl;
+    std::unique_ptr<Backend> backend;
+    std::unique_ptr<Relay> relay;
+    runSync([&]() {
+        backend.reset(new Backend);
+        relay.reset(new Relay(true));
+    });
+    
+    int fd = connectRelay();
+    // 等转发建立，然后让后端停止读
+    bool ready = false;
+    while (!ready) {
+        ::usleep(10 * 1000);
+        runSync([&]() {
+            ready = relay->outbound && backend->conn;
+            if (ready) {
+                backend->conn->stopRead();
+            }
+        });
+    }
+    
+    // 一直写到写不进去：客户端、中继、后端的内核缓冲区都满了
+    ::fcntl(fd, F_SETFL, O_NONBLOCK);
+    const std::string chunk = pattern(64 * 1024);
+    size_t written = 0;
+    int idle = 0;
+    while (idle < 20) {
+        ssize_t n = ::write(fd, chunk.data(), chunk.size());
+        if (n > 0) {
+            written += n;
+            idle = 0;
+        } else {
+            assert(errno == EAGAIN);
+            ++idle;
+            ::usleep(10 * 1000);
+        }
+    }
+    
+    size_t pending = 0;
+    bool reading = true;
+    runSync([&]() {
+        reading = relay->inbound->isReading();
+        pending = relay->outbound->pendingOutputBytes();
+    });
+    assert(!reading);
+    assert(pending <= 1024 * 1024);
+    std::cout << "  写入" << written << "字节后中继停止读客户端，积压" << pending << "字节" << std::endl;
+    
+    // 后端恢复：数据全部回来
+    ::fcntl(fd, F_SETFL, 0);
+    runSync([&]() { backend->conn->startRead(); });
+    size_t received = 0;
+    char buf[65536];
+    while (received < written) {
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        assert(n > 0);
+        received += n;
+    }
+    ::close(fd);
+    runSync([&]() {
+        relay.reset();
+        backend.reset();
+    });
+    std::cout << "  ✓ 后端恢复后" << received << "字节全部回来" << std::endl;
+}
+
+void testClose() {
+    std::cout << "\n[测试4] 关闭传递" << std::endl;
+    std::unique_ptr<Backend> backend;
+    std::unique_ptr<Relay> relay;
+    runSync([&]() {
+        backend.reset(new Backend);
+        relay.reset(new Relay(true));
+    });
+    int fd = connectRelay();
+    assert(roundTrip(fd, "ping") == "ping");
+    ::close(fd);
+    
+    bool closed = false;
+    for (int i = 0; i < 100 && !closed; ++i) {
+        ::usleep(10 * 1000);
+        runSync([&]() {
+            closed = backend->disconnected == 1 && !relay->inbound->connected()
+                && !relay->outbound->connected();
+        });
+    }
+    assert(closed);
+    runSync([&]() {
+        relay.reset();
+        backend.reset();
+    });
+    std::cout << "  ✓ 中继的两个连接和后端的连接都关闭了" << std::endl;
+}
+
+void testReset() {
+    std::cout << "\n[测试5] 重置传递" << std::endl;
+    for (bool useSplice : {true, false}) {
+        std::unique_ptr<Backend> backend;
+        std::unique_ptr<Relay> relay;
+        runSync([&]() {
+            backend.reset(new Backend);
+            relay.reset(new Relay(useSplice));
+        });
+        int fd = connectRelay();
+        assert(roundTrip(fd, "ping") == "ping");
+        struct linger lg = { 1, 0 };
+        int rc = ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof lg);
+        assert(rc == 0);
+        (void)rc;
+        ::close(fd);
+        
+        bool closed = false;
+        for (int i = 0; i < 100 && !closed; ++i) {
+            ::usleep(10 * 1000);
+            runSync([&]() {
+                closed = backend->disconnected == 1 && !relay->inbound->connected()
+                    && !relay->outbound->connected();
+            });
+        }
+        assert(closed);
+        runSync([&]() {
+            relay.reset();
+            backend.reset();
+        });
+    }
+    std::cout << "  ✓ 客户端重置后，中继的两个连接和后端的连接都关闭了" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 连接转发 测试 ===" << std::endl;
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    g_loop = &loop;
+    
+    std::thread driver([&]() {
+        testSplice();
+        testBuffered();
+        testBackpressure();
+        testClose();
+        testReset();
+        
+        std::cout << "\n=== 所有测试通过 ===" << std::endl;
+        loop.quit();
+    });
+    
+    loop.loop();
+    driver.join();
+    return 0;
+}
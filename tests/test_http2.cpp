@@ -0,0 +1,621 @@
+// 测试HTTP/2（h2c）
+// 1. HPACK：RFC 7541附录C的例子（整数、Huffman、动态表），编码器和解码器互相解码
+// 2. 帧编解码
+// 3. prior knowledge：一个连接上同时发多个请求（多路复用）、POST请求体、HEAD
+// 4. 流量控制：对方窗口很小时分批发送，WINDOW_UPDATE之后继续
+// 5. Upgrade: h2c：101之后请求作为stream 1响应
+// 6. 错误处理：PING、非法头部RST_STREAM、协议错误GOAWAY
+// 7. 设置了异步业务回调的服务器不开启HTTP/2，Upgrade: h2c的请求照常由异步回调响应
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "HttpResponseWriter.h"
+#include "Hpack.h"
+#include "Http2Codec.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <utility>
+#include <cassert>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cstring>
+
+const int kPort = 18088;
+const int kAsyncPort = 18235;
+const size_t kBigSize = 100000;
+
+using Headers = std::vector<std::pair<std::string, std::string>>;
+
+std::string fromHex(const std::string& hex) {
+    std::string out;
+    for (size_t i = 0; i + 1 < hex.size(); ) {
+        if (hex[i] == ' ') {
+            ++i;
+            continue;
+        }
+        out.push_back(static_cast<char>(strtol(hex.substr(i, 2).c_str(), nullptr, 16)));
+        i += 2;
+    }
+    return out;
+}
+
+Headers decodeBlock(HpackDecoder* decoder, const std::string& block) {
+    Headers headers;
+    bool ok = decoder->decode(block, [&headers](StringPiece name, StringPiece value) {
+        headers.emplace_back(name.as_string(), value.as_string());
+    });
+    assert(ok);
+    return headers;
+}
+
+std::string bigBody() {
+    std::string body(kBigSize, '\0');
+    for (size_t i = 0; i < body.size(); ++i) {
+        body[i] = static_cast<char>('a' + i % 26);
+    }
+    return body;
+}
+
+// 测试1：HPACK
+void testHpack() {
+    std::cout << "\n[测试1] HPACK" << std::endl;
+    
+    // C.1 整数编码
+    std::string out;
+    HpackEncoder::encodeInteger(10, 5, 0, &out);
+    assert(out == fromHex("0a"));
+    out.clear();
+    HpackEncoder::encodeInteger(1337, 5, 0, &out);
+    assert(out == fromHex("1f9a0a"));
+    out.clear();
+    HpackEncoder::encodeInteger(42, 8, 0, &out);
+    assert(out == fromHex("2a"));
+    
+    // C.4.1 Huffman
+    out.clear();
+    HpackEncoder::encodeString("www.example.com", &out);
+    assert(out == fromHex("8c f1e3 c2e5 f23a 6ba0 ab90 f4ff"));
+    std::string decoded;
+    assert(HpackDecoder::decodeHuffman(out.substr(1), &decoded));
+    assert(decoded == "www.example.com");
+    
+    // 所有字节值的Huffman往返
+    std::string all;
+    for (int i = 0; i < 256; ++i) {
+        all.push_back(static_cast<char>(i));
+    }
+    out.clear();
+    HpackEncoder::encodeString(all + all, &out);
+    HpackDecoder decoder0;
+    Headers h0 = decodeBlock(&decoder0, std::string("\x00", 1) + out + out);
+    assert(h0.size() == 1 && h0[0].first == all + all && h0[0].second == all + all);
+    
+    // C.3 请求（不用Huffman），三个头部块共用一个动态表
+    HpackDecoder decoder;
+    Headers h = decodeBlock(&decoder, fromHex("8286 8441 0f77 7777 2e65 7861 6d70 6c65 2e63 6f6d"));
+    assert(h.size() == 4);
+    assert(h[0] == std::make_pair(std::string(":method"), std::string("GET")));
+    assert(h[3] == std::make_pair(std::string(":authority"), std::string("www.example.com")));
+    assert(decoder.tableSize() == 57);
+    h = decodeBlock(&decoder, fromHex("8286 84be 5808 6e6f 2d63 6163 6865"));
+    assert(h.size() == 5 && h[3].second == "www.example.com" && h[4].second == "no-cache");
+    assert(decoder.tableSize() == 110);
+    h = decodeBlock(&decoder, fromHex("8287 85bf 400a 6375 7374 6f6d 2d6b 6579 0c63 7573 746f 6d2d 7661 6c75 65"));
+    assert(h.size() == 5 && h[1].second == "https" && h[2].second == "/index.html");
+    assert(h[4] == std::make_pair(std::string("custom-key"), std::string("custom-value")));
+    assert(decoder.tableSize() == 164);
+    
+    // C.4 同样的请求（Huffman）
+    HpackDecoder huffman;
+    h = decodeBlock(&huffman, fromHex("8286 8441 8cf1 e3c2 e5f2 3a6b a0ab 90f4 ff"));
+    assert(h[3].second == "www.example.com");
+    h = decodeBlock(&huffman, fromHex("8286 84be 5886 a8eb 1064 9cbf"));
+    assert(h[4].second == "no-cache");
+    h = decodeBlock(&huffman, fromHex("8287 85bf 4088 25a8 49e9 5ba9 7d7f 8925 a849 e95b b8e8 b4bf"));
+    assert(h[4] == std::make_pair(std::string("custom-key"), std::string("custom-value")));
+    
+    // 非法输入：索引越界、整数溢出、Huffman的EOS填充不对
+    HpackDecoder bad;
+    assert(!bad.decode(fromHex("ff00"), [](StringPiece, StringPiece) {}));
+    assert(!bad.decode(fromHex("1fffffffffffffffffffff"), [](StringPiece, StringPiece) {}));
+    std::string badHuffman;
+    assert(!HpackDecoder::decodeHuffman(fromHex("ff ff ff ff"), &badHuffman));
+    
+    // 编码器 -> 解码器：重复的头部第二次只要一个字节
+    HpackEncoder encoder;
+    HpackDecoder peer;
+    std::string first, second;
+    encoder.encode(":status", "200", &first);
+    encoder.encode("content-type", "text/plain", &first);
+    encoder.encode("server", "TinyNetwork", &first);
+    encoder.encode("date", "Mon, 19 Oct 2026 08:00:00 GMT", &first);
+    encoder.encode(":status", "200", &second);
+    encoder.encode("content-type", "text/plain", &second);
+    encoder.encode("server", "TinyNetwork", &second);
+    h = decodeBlock(&peer, first);
+    assert(h.size() == 4 && h[2].second == "TinyNetwork" && h[3].first == "date");
+    h = decodeBlock(&peer, second);
+    assert(h.size() == 3 && h[1].second == "text/plain");
+    assert(second.size() == 3);
+    
+    // 对方缩小动态表：下一个头部块开头是大小更新
+    encoder.setMaxTableSize(0);
+    std::string third;
+    encoder.encode("server", "TinyNetwork", &third);
+    h = decodeBlock(&peer, third);
+    assert(h.size() == 1 && h[0].second == "TinyNetwork");
+    assert(peer.tableSize() == 0);
+    std::cout << "  ✓ HPACK正确" << std::endl;
+}
+
+// 测试2：帧编解码
+void testFrames() {
+    std::cout << "\n[测试2] 帧编解码" << std::endl;
+    
+    Buffer buf;
+    Http2Codec::appendFrame(&buf, Http2Codec::kHeaders, Http2Codec::kFlagEndHeaders, 0x80000003, "abc");
+    Http2Codec::appendWindowUpdate(&buf, 5, 70000);
+    Http2Codec::FrameHeader header;
+    assert(!Http2Codec::parseHeader(buf.peek(), 8, &header));
+    assert(Http2Codec::parseHeader(buf.peek(), buf.readableBytes(), &header));
+    assert(header.length == 3 && header.type == Http2Codec::kHeaders);
+    assert(header.flags == Http2Codec::kFlagEndHeaders && header.streamId == 3);  // 保留位被忽略
+    buf.retrieve(Http2Codec::kFrameHeaderSize + 3);
+    assert(Http2Codec::parseHeader(buf.peek(), buf.readableBytes(), &header));
+    assert(header.type == Http2Codec::kWindowUpdate && header.streamId == 5 && header.length == 4);
+    assert(Http2Codec::readUint32(buf.peek() + Http2Codec::kFrameHeaderSize) == 70000);
+    std::cout << "  ✓ 帧编解码正确" << std::endl;
+}
+
+// 测试用的HTTP/2客户端
+class Client {
+public:
+    struct Response {
+        Response() : endStream(false), reset(0) {}
+        Headers headers;
+        std::string body;
+        bool endStream;
+        uint32_t reset;     // RST_STREAM的错误码
+        
+        std::string header(const std::string& name) const {
+            for (const auto& h : headers) {
+                if (h.first == name) {
+                    return h.second;
+                }
+            }
+            return std::string();
+        }
+    };
+    
+    Client() : fd_(-1), goAway_(-1), pingAcked_(false) {}
+    ~Client() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+    
+    void connect(int port = kPort) {
+        fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof addr);
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int ret = ::connect(fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr);
+        assert(ret == 0);
+        (void)ret;
+    }
+    
+    // 连接前言 + SETTINGS
+    void handshake(uint32_t initialWindow = Http2Codec::kDefaultWindowSize) {
+        std::string out(Http2Codec::kClientPreface, Http2Codec::kClientPrefaceSize);
+        char settings[6];
+        Http2Codec::appendSetting(settings, Http2Codec::kSettingsInitialWindowSize, initialWindow);
+        out += frame(Http2Codec::kSettings, 0, 0, std::string(settings, 6));
+        send(out);
+    }
+    
+    static std::string frame(int type, int flags, uint32_t streamId, const std::string& payload) {
+        Buffer buf;
+        Http2Codec::appendFrame(&buf, type, flags, streamId, payload);
+        return buf.retrieveAsString();
+    }
+    
+    std::string headers(uint32_t streamId, const std::string& method, const std::string& path,
+                        bool endStream, const Headers& extra = Headers()) {
+        std::string block;
+        encoder_.encode(":method", method, &block);
+        encoder_.encode(":scheme", "http", &block);
+        encoder_.encode(":path", path, &block);
+        encoder_.encode(":authority", "localhost", &block);
+        for (const auto& h : extra) {
+            encoder_.encode(h.first, h.second, &block);
+        }
+        int flags = Http2Codec::kFlagEndHeaders | (endStream ? Http2Codec::kFlagEndStream : 0);
+        return frame(Http2Codec::kHeaders, flags, streamId, block);
+    }
+    
+    void send(const std::string& data) {
+        size_t n = 0;
+        while (n < data.size()) {
+            ssize_t w = ::write(fd_, data.data() + n, data.size() - n);
+            assert(w > 0);
+            n += w;
+        }
+    }
+    
+    // 读一帧并处理，连接关闭返回false
+    bool readFrame() {
+        Http2Codec::FrameHeader header;
+        while (!Http2Codec::parseHeader(pending_.data(), pending_.size(), &header)
+               || pending_.size() < Http2Codec::kFrameHeaderSize + header.length) {
+            char buf[65536];
+            ssize_t n = ::read(fd_, buf, sizeof buf);
+            if (n <= 0) {
+                return false;
+            }
+            pending_.append(buf, n);
+        }
+        std::string payload = pending_.substr(Http2Codec::kFrameHeaderSize, header.length);
+        pending_.erase(0, Http2Codec::kFrameHeaderSize + header.length);
+        
+        Response& r = responses_[header.streamId];
+        switch (header.type) {
+            case Http2Codec::kHeaders:
+                assert(header.flags & Http2Codec::kFlagEndHeaders);
+                r.headers = decodeBlock(&decoder_, payload);
+                r.endStream = (header.flags & Http2Codec::kFlagEndStream) != 0;
+                break;
+            case Http2Codec::kData:
+                assert(payload.size() <= Http2Codec::kDefaultMaxFrameSize);
+                r.body += payload;
+                r.endStream = (header.flags & Http2Codec::kFlagEndStream) != 0;
+                break;
+            case Http2Codec::kRstStream:
+                r.reset = Http2Codec::readUint32(payload.data());
+                break;
+            case Http2Codec::kGoAway:
+                goAway_ = static_cast<int>(Http2Codec::readUint32(payload.data() + 4));
+                break;
+            case Http2Codec::kPing:
+                assert(header.flags & Http2Codec::kFlagAck);
+                assert(payload == "12345678");
+                pingAcked_ = true;
+                break;
+            case Http2Codec::kSettings:
+                if (!(header.flags & Http2Codec::kFlagAck)) {
+                    ++settingsReceived_;
+                }
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+    
+    // 读到stream结束（或者被reset）
+    const Response& wait(uint32_t streamId) {
+        while (!responses_[streamId].endStream && responses_[streamId].reset == 0) {
+            bool ok = readFrame();
+            assert(ok);
+            (void)ok;
+        }
+        return responses_[streamId];
+    }
+    
+    // 读到收到指定数量的响应体字节（流量控制测试）
+    const Response& waitBody(uint32_t streamId, size_t size) {
+        while (responses_[streamId].body.size() < size) {
+            bool ok = readFrame();
+            assert(ok);
+            (void)ok;
+        }
+        return responses_[streamId];
+    }
+    
+    // 读到连接关闭
+    void waitClosed() {
+        while (readFrame()) {
+        }
+    }
+    
+    int goAway() const { return goAway_; }
+    bool pingAcked() const { return pingAcked_; }
+    int settingsReceived() const { return settingsReceived_; }
+    Response& response(uint32_t streamId) { return responses_[streamId]; }
+    std::string& pending() { return pending_; }
+    int fd() const { return fd_; }
+
+private:
+    int fd_;
+    std::string pending_;
+    HpackEncoder encoder_;
+    HpackDecoder decoder_;
+    std::map<uint32_t, Response> responses_;
+    int goAway_;
+    bool pingAcked_;
+    int settingsReceived_ = 0;
+};
+
+// 测试3：多路复用
+void testMultiplexing() {
+    std::cout << "\n[测试3] 多路复用" << std::endl;
+    
+    Client client;
+    client.connect();
+    client.handshake();
+    
+    // 所有请求一次发出去，POST的请求体分两个DATA帧
+    // 头部块必须按发送顺序编码（动态表），所以逐个追加而不是用一个+表达式
+    std::string out = client.headers(1, "GET", "/hello/alice", true);
+    out += client.headers(3, "POST", "/echo", false, { { "content-type", "text/plain" } });
+    out += client.headers(5, "GET", "/hello/bob?x=1", true);
+    out += Client::frame(Http2Codec::kData, 0, 3, "hello ");
+    out += Client::frame(Http2Codec::kData, Http2Codec::kFlagEndStream, 3, "world");
+    out += client.headers(7, "HEAD", "/big", true);
+    out += client.headers(9, "GET", "/info", true, { { "x-test", "yes" } });
+    client.send(out);
+    
+    const Client::Response& r1 = client.wait(1);
+    assert(r1.header(":status") == "200" && r1.body == "hello alice");
+    assert(r1.header("content-length") == "11");
+    assert(!r1.header("date").empty());
+    assert(r1.header("connection").empty());
+    const Client::Response& r5 = client.wait(5);
+    assert(r5.body == "hello bob");
+    const Client::Response& r3 = client.wait(3);
+    assert(r3.body == "hello world" && r3.header("content-type") == "text/plain");
+    
+    // HEAD：只有头部，Content-Length是完整响应体的长度
+    const Client::Response& r7 = client.wait(7);
+    assert(r7.header(":status") == "200" && r7.body.empty());
+    assert(r7.header("content-length") == std::to_string(kBigSize));
+    
+    // 处理函数看到的是HTTP/2请求，:authority作为Host
+    const Client::Response& r9 = client.wait(9);
+    assert(r9.body == "h2 localhost yes");
+    
+    // 404（没有路由）
+    client.send(client.headers(11, "GET", "/nothing", true));
+    assert(client.wait(11).header(":status") == "404");
+    assert(client.settingsReceived() == 1);
+    std::cout << "  ✓ 多个stream在一个连接上交错完成" << std::endl;
+}
+
+// 测试4：流量控制
+void testFlowControl() {
+    std::cout << "\n[测试4] 流量控制" << std::endl;
+    
+    Client client;
+    client.connect();
+    client.handshake(1000);   // 每个stream只给1000字节的窗口
+    client.send(client.headers(1, "GET", "/big", true));
+    
+    client.waitBody(1, 1000);
+    assert(!client.response(1).endStream);
+    
+    // 对方不补窗口就不会有更多数据：发PING，收到ACK时仍然只有1000字节
+    client.send(Client::frame(Http2Codec::kPing, 0, 0, "12345678"));
+    while (!client.pingAcked()) {
+        client.readFrame();
+    }
+    assert(client.response(1).body.size() == 1000);
+    
+    // 补stream窗口：再发5000（连接窗口还有64535）
+    char increment[4];
+    Http2Codec::writeUint32(increment, 5000);
+    client.send(Client::frame(Http2Codec::kWindowUpdate, 0, 1, std::string(increment, 4)));
+    client.waitBody(1, 6000);
+    
+    // 调大初始窗口（已打开的stream按差值调整），连接窗口补足，剩下的全部发完
+    char settings[6];
+    Http2Codec::appendSetting(settings, Http2Codec::kSettingsInitialWindowSize, 1 << 20);
+    Http2Codec::writeUint32(increment, 1 << 20);
+    client.send(Client::frame(Http2Codec::kSettings, 0, 0, std::string(settings, 6))
+              + Client::frame(Http2Codec::kWindowUpdate, 0, 0, std::string(increment, 4)));
+    const Client::Response& r = client.wait(1);
+    assert(r.body == bigBody());
+    
+    // 大请求体：超过我们的初始窗口（65535）之前就会收到WINDOW_UPDATE
+    std::string body(200000, 'x');
+    std::string out = client.headers(3, "POST", "/echo", false);
+    for (size_t i = 0; i < body.size(); i += 16384) {
+        size_t n = std::min<size_t>(16384, body.size() - i);
+        out += Client::frame(Http2Codec::kData, i + n == body.size() ? Http2Codec::kFlagEndStream : 0,
+                             3, body.substr(i, n));
+    }
+    client.send(out);
+    assert(client.wait(3).body == body);
+    std::cout << "  ✓ 窗口用完后暂停，WINDOW_UPDATE/SETTINGS之后继续" << std::endl;
+}
+
+// 测试5：Upgrade: h2c
+void testUpgrade() {
+    std::cout << "\n[测试5] Upgrade: h2c" << std::endl;
+    
+    Client client;
+    client.connect();
+    // HTTP2-Settings：INITIAL_WINDOW_SIZE = 100（base64url的"AAQAAABk"）
+    client.send("GET /hello/h2c HTTP/1.1\r\nHost: localhost\r\nConnection: Upgrade, HTTP2-Settings\r\n"
+                "Upgrade: h2c\r\nHTTP2-Settings: AAQAAABk\r\n\r\n");
+    std::string& pending = client.pending();
+    size_t end;
+    while ((end = pending.find("\r\n\r\n")) == std::string::npos) {
+        char buf[4096];
+        ssize_t n = ::read(client.fd(), buf, sizeof buf);
+        assert(n > 0);
+        pending.append(buf, n);
+    }
+    std::string headers = pending.substr(0, end + 4);
+    pending.erase(0, end + 4);
+    assert(headers.find("HTTP/1.1 101 ") == 0);
+    assert(headers.find("Upgrade: h2c\r\n") != std::string::npos);
+    
+    // 切换之后仍然要发连接前言
+    client.handshake();
+    const Client::Response& r1 = client.wait(1);
+    assert(r1.header(":status") == "200" && r1.body == "hello h2c");
+    
+    client.send(client.headers(3, "GET", "/hello/again", true));
+    assert(client.wait(3).body == "hello again");
+    std::cout << "  ✓ 101之后请求作为stream 1响应" << std::endl;
+}
+
+// 测试6：错误处理
+void testErrors() {
+    std::cout << "\n[测试6] 错误处理" << std::endl;
+    
+    // 大写的头部名字：stream错误，连接继续可用
+    {
+        Client client;
+        client.connect();
+        client.handshake();
+        std::string block;
+        HpackEncoder encoder;
+        encoder.encode(":method", "GET", &block);
+        encoder.encode(":scheme", "http", &block);
+        encoder.encode(":path", "/hello/x", &block);
+        encoder.encode("X-Upper", "1", &block);
+        // 这个头部块用的是另一个编码器，之后的请求也用它，保持动态表同步
+        client.send(Client::frame(Http2Codec::kHeaders, Http2Codec::kFlagEndHeaders | Http2Codec::kFlagEndStream,
+                                  1, block));
+        assert(client.wait(1).reset == Http2Codec::kProtocolError);
+        
+        // 连接级别的Connection头部也不允许
+        block.clear();
+        encoder.encode(":method", "GET", &block);
+        encoder.encode(":scheme", "http", &block);
+        encoder.encode(":path", "/hello/y", &block);
+        encoder.encode("connection", "keep-alive", &block);
+        client.send(Client::frame(Http2Codec::kHeaders, Http2Codec::kFlagEndHeaders | Http2Codec::kFlagEndStream,
+                                  3, block));
+        assert(client.wait(3).reset == Http2Codec::kProtocolError);
+        
+        block.clear();
+        encoder.encode(":method", "GET", &block);
+        encoder.encode(":scheme", "http", &block);
+        encoder.encode(":path", "/hello/z", &block);
+        client.send(Client::frame(Http2Codec::kHeaders, Http2Codec::kFlagEndHeaders | Http2Codec::kFlagEndStream,
+                                  5, block));
+        assert(client.wait(5).body == "hello z");
+    }
+    
+    // DATA在stream 0上：GOAWAY(PROTOCOL_ERROR)后关闭连接
+    {
+        Client client;
+        client.connect();
+        client.handshake();
+        client.send(Client::frame(Http2Codec::kData, 0, 0, "oops"));
+        client.waitClosed();
+        assert(client.goAway() == Http2Codec::kProtocolError);
+    }
+    
+    // 连接前言之后第一个帧不是SETTINGS
+    {
+        Client client;
+        client.connect();
+        client.send(std::string(Http2Codec::kClientPreface, Http2Codec::kClientPrefaceSize)
+                    + Client::frame(Http2Codec::kPing, 0, 0, "12345678"));
+        client.waitClosed();
+        assert(client.goAway() == Http2Codec::kProtocolError);
+    }
+    
+    // stream id必须递增
+    {
+        Client client;
+        client.connect();
+        client.handshake();
+        client.send(client.headers(5, "GET", "/hello/a", true));
+        client.wait(5);
+        client.send(client.headers(3, "GET", "/hello/b", true));
+        client.waitClosed();
+        assert(client.goAway() != -1 && client.goAway() != Http2Codec::kNoError);
+    }
+    std::cout << "  ✓ stream错误RST_STREAM，连接错误GOAWAY" << std::endl;
+}
+
+// 测试7：异步业务回调
+void testAsyncCallback() {
+    std::cout << "\n[测试7] 异步业务回调" << std::endl;
+    
+    Client client;
+    client.connect(kAsyncPort);
+    client.send("GET /async HTTP/1.1\r\nHost: localhost\r\nConnection: Upgrade, HTTP2-Settings\r\n"
+                "Upgrade: h2c\r\nHTTP2-Settings: AAQAAABk\r\n\r\n");
+    std::string& pending = client.pending();
+    while (pending.find("async /async") == std::string::npos) {
+        char buf[4096];
+        ssize_t n = ::read(client.fd(), buf, sizeof buf);
+        assert(n > 0);
+        pending.append(buf, n);
+    }
+    assert(pending.find("HTTP/1.1 200 ") == 0);
+    std::cout << "  ✓ 没有切换到HTTP/2，请求由异步回调响应" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 测试HTTP/2 ===" << std::endl;
+    
+    EventLoop loop;
+    HttpServer server(&loop, "TestHttp2", kPort);
+    server.enableHttp2();
+    
+    std::string big = bigBody();
+    server.router().GET("/hello/:name", [](const HttpRequest& req, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody("hello " + req.param("name").as_string());
+    });
+    server.router().POST("/echo", [](const HttpRequest& req, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        if (!req.getHeader("Content-Type").empty()) {
+            resp->setContentType(req.getHeader("Content-Type").as_string());
+        }
+        resp->setBody(req.body().as_string());
+    });
+    server.router().GET("/big", [&big](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody(big);
+    });
+    server.router().GET("/info", [](const HttpRequest& req, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody(std::string(req.version() == HttpRequest::kHttp20 ? "h2" : "h1") + " "
+                      + req.getHeader("Host").as_string() + " " + req.getHeader("X-Test").as_string());
+    });
+    server.start();
+    
+    // 异步回调在HTTP/2上没有实现：这个服务器的enableHttp2()不生效
+    HttpServer asyncServer(&loop, "TestHttp2Async", kAsyncPort);
+    asyncServer.enableHttp2();
+    asyncServer.setAsyncHttpCallback([](const HttpRequest& req, const HttpResponseWriterPtr& writer) {
+        writer->response()->setStatusCode(HttpResponse::k200Ok);
+        writer->response()->setBody("async " + req.path().as_string());
+        writer->send();
+    });
+    asyncServer.start();
+    
+    std::thread client([&]() {
+        testHpack();
+        testFrames();
+        testMultiplexing();
+        testFlowControl();
+        testUpgrade();
+        testErrors();
+        testAsyncCallback();
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    
+    std::cout << "\n=== 所有测试通过 ===" << std::endl;
+    return 0;
+}
@@ -0,0 +1,344 @@
+// 测试HTTP响应压缩
+// 1. Accept-Encoding协商（q值、*、q=0）
+// 2. gzip/deflate压缩后能解压回原文
+// 3. 文本类、不小于minSize的200响应才压缩，带Vary头部
+// 4. 重复的响应体第二次进缓存，之后命中缓存
+// 5. 大响应体交给工作线程压缩，pipelined的响应顺序不乱
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "HttpCompressor.h"
+#include "EventLoop.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <cassert>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cstring>
+#include <zlib.h>
+
+const int kPort = 18085;
+
+struct Response {
+    int status;
+    std::string headers;
+    std::string body;
+    
+    std::string header(const std::string& name) const {
+        size_t pos = headers.find("\r\n" + name + ": ");
+        if (pos == std::string::npos) {
+            return "";
+        }
+        pos += name.size() + 4;
+        return headers.substr(pos, headers.find("\r\n", pos) - pos);
+    }
+};
+
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 从连接里读一个完整的响应，pending保存多读的数据
+Response readResponse(int fd, std::string* pending, bool head = false) {
+    char buf[65536];
+    size_t end;
+    while ((end = pending->find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        assert(n > 0);
+        pending->append(buf, n);
+    }
+    Response resp;
+    resp.headers = pending->substr(0, end + 2);
+    resp.status = atoi(resp.headers.c_str() + 9);
+    pending->erase(0, end + 4);
+    
+    size_t length = head ? 0 : strtoul(resp.header("Content-Length").c_str(), nullptr, 10);
+    while (pending->size() < length) {
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        assert(n > 0);
+        pending->append(buf, n);
+    }
+    resp.body = pending->substr(0, length);
+    pending->erase(0, length);
+    return resp;
+}
+
+Response request(const std::string& text, bool head = false) {
+    int fd = connectServer();
+    assert(fd >= 0);
+    ::write(fd, text.data(), text.size());
+    std::string pending;
+    Response resp = readResponse(fd, &pending, head);
+    ::close(fd);
+    return resp;
+}
+
+Response get(const std::string& path, const std::string& extraHeaders = "") {
+    return request("GET " + path + " HTTP/1.1\r\nHost: test\r\n" + extraHeaders + "\r\n");
+}
+
+// windowBits 15 + 32：自动识别gzip和zlib格式
+std::string decompress(const std::string& in) {
+    z_stream zs;
+    memset(&zs, 0, sizeof zs);
+    assert(inflateInit2(&zs, 15 + 32) == Z_OK);
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+    zs.avail_in = static_cast<uInt>(in.size());
+    std::string out;
+    char buf[16384];
+    int ret;
+    do {
+        zs.next_out = reinterpret_cast<Bytef*>(buf);
+        zs.avail_out = sizeof buf;
+        ret = inflate(&zs, Z_NO_FLUSH);
+        assert(ret == Z_OK || ret == Z_STREAM_END);
+        out.append(buf, sizeof buf - zs.avail_out);
+    } while (ret != Z_STREAM_END);
+    inflateEnd(&zs);
+    return out;
+}
+
+// 生成n字节左右的JSON数组，seed不同内容不同
+std::string makeJson(size_t n, int seed) {
+    std::string json = "[";
+    for (int i = 0; json.size() < n; ++i) {
+        if (i > 0) {
+            json += ",";
+        }
+        json += "{\"id\":" + std::to_string(i * 7 + seed) + ",\"name\":\"user" + std::to_string(i)
+              + "\",\"active\":" + (i % 3 ? "true" : "false") + "}";
+    }
+    json += "]";
+    return json;
+}
+
+std::string g_json;     // 4KB
+std::string g_big;      // 300KB，超过offload阈值
+int g_dynamic = 0;      // 每次都不一样的响应体
+
+// 测试1：Accept-Encoding协商
+void testNegotiate() {
+    std::cout << "\n[测试1] Accept-Encoding协商" << std::endl;
+    
+    assert(HttpCompressor::negotiate("") == HttpCompressor::kIdentity);
+    assert(HttpCompressor::negotiate("gzip") == HttpCompressor::kGzip);
+    assert(HttpCompressor::negotiate("deflate") == HttpCompressor::kDeflate);
+    assert(HttpCompressor::negotiate("gzip, deflate, br") == HttpCompressor::kGzip);
+    assert(HttpCompressor::negotiate("deflate, gzip") == HttpCompressor::kGzip);
+    assert(HttpCompressor::negotiate("gzip;q=0.5, deflate") == HttpCompressor::kDeflate);
+    assert(HttpCompressor::negotiate("gzip;q=0, deflate;q=0") == HttpCompressor::kIdentity);
+    assert(HttpCompressor::negotiate("br, identity") == HttpCompressor::kIdentity);
+    assert(HttpCompressor::negotiate("*") == HttpCompressor::kGzip);
+    assert(HttpCompressor::negotiate("*;q=0.1, gzip;q=0") == HttpCompressor::kDeflate);
+    assert(HttpCompressor::negotiate("  GZIP ; Q=1.0 ") == HttpCompressor::kGzip);
+    assert(HttpCompressor::negotiate("x-gzip") == HttpCompressor::kGzip);
+    
+    assert(HttpCompressor::isCompressibleType("application/json"));
+    assert(HttpCompressor::isCompressibleType("text/html; charset=utf-8"));
+    assert(HttpCompressor::isCompressibleType("application/problem+json"));
+    assert(HttpCompressor::isCompressibleType("image/svg+xml"));
+    assert(!HttpCompressor::isCompressibleType("image/png"));
+    assert(!HttpCompressor::isCompressibleType("application/octet-stream"));
+    assert(!HttpCompressor::isCompressibleType(""));
+    std::cout << "  ✓ 协商和类型判断正确" << std::endl;
+}
+
+// 测试2：压缩、解压
+void testRoundTrip() {
+    std::cout << "\n[测试2] gzip/deflate压缩解压" << std::endl;
+    
+    std::string gz;
+    assert(HttpCompressor::compress(HttpCompressor::kGzip, g_json, &gz));
+    assert(gz.size() > 2 && static_cast<unsigned char>(gz[0]) == 0x1f
+           && static_cast<unsigned char>(gz[1]) == 0x8b);
+    assert(decompress(gz) == g_json);
+    
+    std::string zl;
+    assert(HttpCompressor::compress(HttpCompressor::kDeflate, g_json, &zl));
+    assert(static_cast<unsigned char>(zl[0]) == 0x78);  // zlib头部
+    assert(decompress(zl) == g_json);
+    
+    std::string empty;
+    assert(HttpCompressor::compress(HttpCompressor::kGzip, "", &empty));
+    assert(decompress(empty).empty());
+    std::cout << "  ✓ " << g_json.size() << " -> gzip " << gz.size()
+              << " / deflate " << zl.size() << " 字节" << std::endl;
+}
+
+// 测试3：服务器上的压缩规则
+void testServer() {
+    std::cout << "\n[测试3] 服务器压缩规则" << std::endl;
+    
+    Response resp = get("/json", "Accept-Encoding: gzip, deflate\r\n");
+    assert(resp.status == 200);
+    assert(resp.header("Content-Encoding") == "gzip");
+    assert(resp.header("Vary") == "Accept-Encoding");
+    assert(resp.body.size() < g_json.size());
+    assert(decompress(resp.body) == g_json);
+    
+    resp = get("/json", "Accept-Encoding: deflate\r\n");
+    assert(resp.header("Content-Encoding") == "deflate");
+    assert(decompress(resp.body) == g_json);
+    
+    // 不支持压缩的客户端：原文，但仍然有Vary
+    resp = get("/json");
+    assert(resp.header("Content-Encoding").empty());
+    assert(resp.header("Vary") == "Accept-Encoding");
+    assert(resp.body == g_json);
+    
+    // 太小、不是文本、不是200、HEAD都不压缩
+    resp = get("/small", "Accept-Encoding: gzip\r\n");
+    assert(resp.header("Content-Encoding").empty());
+    assert(resp.body == "{\"ok\":true}");
+    resp = get("/png", "Accept-Encoding: gzip\r\n");
+    assert(resp.header("Content-Encoding").empty());
+    resp = get("/missing", "Accept-Encoding: gzip\r\n");
+    assert(resp.status == 404);
+    assert(resp.header("Content-Encoding").empty());
+    resp = request("HEAD /json HTTP/1.1\r\nHost: test\r\nAccept-Encoding: gzip\r\n\r\n", true);
+    assert(resp.header("Content-Encoding").empty());
+    assert(resp.header("Content-Length") == std::to_string(g_json.size()));
+    
+    // 强ETag变成弱ETag
+    resp = get("/etag", "Accept-Encoding: gzip\r\n");
+    assert(resp.header("ETag") == "W/\"v1\"");
+    std::cout << "  ✓ 只压缩值得压缩的响应" << std::endl;
+}
+
+// 测试4：缓存准入和命中
+void testCache(HttpCompressor* compressor) {
+    std::cout << "\n[测试4] 压缩结果缓存" << std::endl;
+    
+    // 每次都不一样的响应体不进缓存
+    size_t before = compressor->cachedBytes();
+    for (int i = 0; i < 3; ++i) {
+        Response resp = get("/dynamic", "Accept-Encoding: gzip\r\n");
+        assert(resp.header("Content-Encoding") == "gzip");
+    }
+    assert(compressor->cachedBytes() == before);
+    
+    // /json在测试3里出现过一次（gzip），这一次进缓存，下一次命中
+    get("/json", "Accept-Encoding: gzip\r\n");
+    assert(compressor->cachedBytes() > before);
+    size_t hits = compressor->cacheHits();
+    Response resp = get("/json", "Accept-Encoding: gzip\r\n");
+    assert(compressor->cacheHits() == hits + 1);
+    assert(decompress(resp.body) == g_json);
+    
+    assert(compressor->bytesOut() < compressor->bytesIn());
+    std::cout << "  ✓ 缓存命中 " << compressor->cacheHits() << " 次，压缩率 "
+              << 100 * compressor->bytesOut() / compressor->bytesIn() << "%" << std::endl;
+}
+
+// 测试5：工作线程压缩大响应体，pipelining顺序不变
+void testOffload() {
+    std::cout << "\n[测试5] 工作线程压缩 + pipelining" << std::endl;
+    
+    int fd = connectServer();
+    assert(fd >= 0);
+    std::string req = "GET /big HTTP/1.1\r\nHost: test\r\nAccept-Encoding: gzip\r\n\r\n"
+                      "GET /small HTTP/1.1\r\nHost: test\r\nAccept-Encoding: gzip\r\n\r\n"
+                      "GET /big HTTP/1.1\r\nHost: test\r\nAccept-Encoding: deflate\r\n\r\n"
+                      "GET /json HTTP/1.1\r\nHost: test\r\nAccept-Encoding: gzip\r\n\r\n";
+    ::write(fd, req.data(), req.size());
+    
+    std::string pending;
+    Response r1 = readResponse(fd, &pending);
+    Response r2 = readResponse(fd, &pending);
+    Response r3 = readResponse(fd, &pending);
+    Response r4 = readResponse(fd, &pending);
+    assert(r1.header("Content-Encoding") == "gzip");
+    assert(decompress(r1.body) == g_big);
+    assert(r2.body == "{\"ok\":true}");
+    assert(r3.header("Content-Encoding") == "deflate");
+    assert(decompress(r3.body) == g_big);
+    assert(decompress(r4.body) == g_json);
+    
+    // 暂停期间的请求处理完之后，同一个连接还能继续用
+    req = "GET /small HTTP/1.1\r\nHost: test\r\n\r\n";
+    ::write(fd, req.data(), req.size());
+    Response r5 = readResponse(fd, &pending);
+    assert(r5.body == "{\"ok\":true}");
+    
+    // Connection: close的大响应：发完再关闭
+    req = "GET /big HTTP/1.1\r\nHost: test\r\nAccept-Encoding: gzip\r\nConnection: close\r\n\r\n";
+    ::write(fd, req.data(), req.size());
+    Response r6 = readResponse(fd, &pending);
+    assert(decompress(r6.body) == g_big);
+    char c;
+    ssize_t rc = ::read(fd, &c, 1);
+    assert(rc == 0);
+    (void)rc;
+    ::close(fd);
+    std::cout << "  ✓ " << g_big.size() << " 字节的响应体在工作线程压缩，顺序正确" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 测试HTTP响应压缩 ===" << std::endl;
+    
+    g_json = makeJson(4096, 1);
+    g_big = makeJson(300000, 2);
+    
+    EventLoop loop;
+    HttpServer server(&loop, "TestCompress", kPort);
+    server.enableCompression(1024);
+    server.setWorkerThreadNum(2);
+    
+    auto json = [](const std::string& body) {
+        return [body](const HttpRequest&, HttpResponse* resp) {
+            resp->setStatusCode(HttpResponse::k200Ok);
+            resp->setContentType("application/json");
+            resp->setBody(body);
+        };
+    };
+    server.router().GET("/json", json(g_json));
+    server.router().GET("/big", json(g_big));
+    server.router().GET("/small", json("{\"ok\":true}"));
+    server.router().GET("/dynamic", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("application/json");
+        resp->setBody(makeJson(2048, ++g_dynamic));
+    });
+    server.router().GET("/png", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("image/png");
+        resp->setBody(std::string(4096, 'x'));
+    });
+    server.router().GET("/etag", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/plain");
+        resp->addHeader("ETag", "\"v1\"");
+        resp->setBody(std::string(4096, 'e'));
+    });
+    server.start();
+    
+    std::thread client([&]() {
+        testNegotiate();
+        testRoundTrip();
+        testServer();
+        testCache(server.compressor());
+        testOffload();
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    
+    std::cout << "\n=== 所有测试通过 ===" << std::endl;
+    return 0;
+}
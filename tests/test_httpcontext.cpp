@@ -0,0 +1,462 @@
+// 测试HttpContext的零拷贝解析
+// 1. 解析结果正确（方法、路径、查询参数、头部大小写不敏感）
+// 2. 数据分多次到达（逐字节喂给解析器）
+// 3. 解析典型GET请求时没有任何堆内存分配
+// 4. 请求体：Content-Length、chunked、流式接收、大小上限
+// 5. 多个Content-Length、超长的chunk大小行和trailer被拒绝
+
+#include "HttpContext.h"
+#include "Buffer.h"
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <new>
+#include <cassert>
+#include <vector>
+
+// 统计堆分配次数：替换全局operator new
+static size_t g_allocations = 0;
+
+void* operator new(size_t size) {
+    ++g_allocations;
+    void* p = malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+const char* kGetRequest =
+    "GET /api/users?id=42&name=tiny HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: curl/8.0\r\n"
+    "Accept: */*\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+void checkRequest(const HttpRequest& req) {
+    assert(req.method() == HttpRequest::kGet);
+    assert(req.version() == HttpRequest::kHttp11);
+    assert(req.path() == "/api/users");
+    assert(req.query() == "id=42&name=tiny");
+    assert(req.headerCount() == 4);
+    assert(req.getHeader("Host") == "localhost:8080");
+    // 头部名称不区分大小写
+    assert(req.getHeader("user-agent") == "curl/8.0");
+    assert(req.getHeader("CONNECTION") == "keep-alive");
+    assert(req.getHeader("Cookie").empty());
+}
+
+// 测试1：一次性收到完整请求，keep-alive连续两个请求
+void testParse() {
+    Buffer buf;
+    buf.append(kGetRequest);
+    buf.append("POST /submit HTTP/1.0\r\nHost: a\r\n\r\n");
+    
+    HttpContext context;
+    assert(context.parseRequest(&buf, Timestamp::now()));
+    assert(context.gotAll());
+    checkRequest(context.request());
+    context.finishRequest(&buf);
+    
+    assert(context.parseRequest(&buf, Timestamp::now()));
+    assert(context.gotAll());
+    assert(context.request().method() == HttpRequest::kPost);
+    assert(context.request().version() == HttpRequest::kHttp10);
+    assert(context.request().path() == "/submit");
+    assert(context.request().query().empty());
+    context.finishRequest(&buf);
+    assert(buf.readableBytes() == 0);
+    
+    std::cout << "✅ 完整请求解析正确" << std::endl;
+}
+
+// 测试2：逐字节到达，中间Buffer会多次扩容搬家
+void testSplit() {
+    Buffer buf;
+    HttpContext context;
+    std::string request(kGetRequest);
+    for (size_t i = 0; i < request.size(); ++i) {
+        buf.append(&request[i], 1);
+        assert(context.parseRequest(&buf, Timestamp::now()));
+        assert(context.gotAll() == (i == request.size() - 1));
+    }
+    checkRequest(context.request());
+    context.finishRequest(&buf);
+    assert(buf.readableBytes() == 0);
+    
+    std::cout << "✅ 分段到达的请求解析正确" << std::endl;
+}
+
+// 测试3：错误的请求
+void testBadRequest() {
+    const char* bad[] = {
+        "FOO / HTTP/1.1\r\n\r\n",
+        "GET / HTTP/2.0\r\n\r\n",
+        "GET / HTTP/1.1\r\nNoColonHere\r\n\r\n",
+    };
+    for (const char* req : bad) {
+        Buffer buf;
+        buf.append(req);
+        HttpContext context;
+        assert(!context.parseRequest(&buf, Timestamp::now()));
+    }
+    std::cout << "✅ 错误请求被拒绝" << std::endl;
+}
+
+// 测试4：解析过程零堆分配
+void testNoAllocation() {
+    Buffer buf;
+    HttpContext context;
+    std::string request(kGetRequest);
+    
+    // 预热：让Buffer容量稳定
+    buf.append(request);
+    context.parseRequest(&buf, Timestamp::now());
+    context.finishRequest(&buf);
+    
+    const int kRounds = 10000;
+    size_t before = g_allocations;
+    for (int i = 0; i < kRounds; ++i) {
+        buf.append(request.data(), request.size());
+        context.parseRequest(&buf, Timestamp::now());
+        assert(context.gotAll());
+        const HttpRequest& req = context.request();
+        assert(req.path() == "/api/users");
+        assert(!req.getHeader("Host").empty());
+        context.finishRequest(&buf);
+    }
+    size_t allocations = g_allocations - before;
+    
+    std::cout << kRounds << "个GET请求的堆分配次数: " << allocations << std::endl;
+    assert(allocations == 0);
+    std::cout << "✅ 解析过程零堆分配" << std::endl;
+}
+
+// 把数据按step字节一段段喂给解析器，返回解析完成时已经喂了多少字节
+size_t feed(HttpContext* context, Buffer* buf, const std::string& data, size_t step) {
+    for (size_t i = 0; i < data.size(); i += step) {
+        buf->append(data.data() + i, std::min(step, data.size() - i));
+        assert(context->parseRequest(buf, Timestamp::now()));
+        if (context->gotAll()) {
+            return std::min(i + step, data.size());
+        }
+    }
+    return data.size();
+}
+
+// 测试5：Content-Length请求体，后面紧跟下一个请求（keep-alive）
+void testContentLength() {
+    std::string post =
+        "POST /upload HTTP/1.1\r\n"
+        "Content-Length: 11\r\n"
+        "\r\n"
+        "hello world";
+    std::string next = "GET /next HTTP/1.1\r\n\r\n";
+    
+    std::string data = post + next;
+    for (size_t step : {1, 3, 1000}) {
+        Buffer buf;
+        HttpContext context;
+        size_t consumed = feed(&context, &buf, data, step);
+        assert(context.gotAll());
+        assert(context.request().method() == HttpRequest::kPost);
+        assert(context.request().body() == "hello world");
+        context.finishRequest(&buf);
+        
+        // 请求体被完整取走，下一个请求不受影响
+        assert(context.parseRequest(&buf, Timestamp::now()));
+        if (!context.gotAll()) {
+            feed(&context, &buf, data.substr(consumed), step);
+        }
+        assert(context.gotAll());
+        assert(context.request().path() == "/next");
+    }
+    
+    std::cout << "✅ Content-Length请求体正确，不影响下一个请求" << std::endl;
+}
+
+// 测试6：chunked请求体，逐字节到达
+void testChunked() {
+    std::string post =
+        "POST /chunked HTTP/1.1\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "5\r\nhello\r\n"
+        "1;ext=1\r\n \r\n"
+        "A\r\n0123456789\r\n"
+        "0\r\n"
+        "Trailer: x\r\n"
+        "\r\n";
+    std::string next = "GET /after HTTP/1.1\r\n\r\n";
+    
+    for (size_t step : {1, 7, 1000}) {
+        Buffer buf;
+        HttpContext context;
+        size_t consumed = feed(&context, &buf, post, step);
+        assert(consumed == post.size());
+        assert(context.gotAll());
+        assert(context.request().body() == "hello 0123456789");
+        context.finishRequest(&buf);
+        assert(buf.readableBytes() == 0);
+        
+        buf.append(next);
+        assert(context.parseRequest(&buf, Timestamp::now()) && context.gotAll());
+        assert(context.request().path() == "/after");
+    }
+    
+    // 错误的chunk
+    Buffer buf;
+    HttpContext context;
+    buf.append("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n");
+    assert(!context.parseRequest(&buf, Timestamp::now()));
+    assert(context.errorStatus() == 400);
+    
+    std::cout << "✅ chunked请求体解码正确" << std::endl;
+}
+
+// 测试7：请求体大小上限
+void testMaxBodySize() {
+    {
+        Buffer buf;
+        HttpContext context;
+        context.setMaxBodySize(10);
+        buf.append("POST / HTTP/1.1\r\nContent-Length: 11\r\n\r\n");
+        assert(!context.parseRequest(&buf, Timestamp::now()));
+        assert(context.errorStatus() == 413);
+    }
+    {
+        Buffer buf;
+        HttpContext context;
+        context.setMaxBodySize(10);
+        buf.append("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+                   "8\r\n12345678\r\n8\r\n");
+        assert(!context.parseRequest(&buf, Timestamp::now()));
+        assert(context.errorStatus() == 413);
+    }
+    {
+        // 同时有Content-Length和Transfer-Encoding
+        Buffer buf;
+        HttpContext context;
+        buf.append("POST / HTTP/1.1\r\nContent-Length: 3\r\n"
+                   "Transfer-Encoding: chunked\r\n\r\n");
+        assert(!context.parseRequest(&buf, Timestamp::now()));
+        assert(context.errorStatus() == 400);
+    }
+    std::cout << "✅ 请求体大小上限生效" << std::endl;
+}
+
+// 测试8：流式接收，请求体边收边交给回调，不在Buffer里堆积
+void testStreaming() {
+    const size_t kBodySize = 1024 * 1024;
+    std::string body(kBodySize, 'z');
+    for (size_t i = 0; i < body.size(); i += 4099) {
+        body[i] = static_cast<char>('a' + i % 26);
+    }
+    
+    for (int chunked = 0; chunked < 2; ++chunked) {
+        std::string request = "PUT /stream?x=1 HTTP/1.1\r\nHost: a\r\n";
+        if (chunked) {
+            request += "Transfer-Encoding: chunked\r\n\r\n";
+            char line[32];
+            for (size_t i = 0; i < body.size(); i += 10000) {
+                size_t n = std::min<size_t>(10000, body.size() - i);
+                snprintf(line, sizeof line, "%zx\r\n", n);
+                request += line;
+                request.append(body, i, n);
+                request += "\r\n";
+            }
+            request += "0\r\n\r\n";
+        } else {
+            request += "Content-Length: " + std::to_string(kBodySize) + "\r\n\r\n";
+            request += body;
+        }
+        
+        Buffer buf;
+        HttpContext context;
+        context.setMaxBodySize(1024);  // 流式模式不受限制
+        std::string received;
+        size_t calls = 0;
+        size_t maxBuffered = 0;
+        context.setBodyCallback([&](const HttpRequest& req, StringPiece chunk) {
+            // 回调里头部依然可以访问
+            assert(req.path() == "/stream");
+            assert(req.getHeader("host") == "a");
+            received.append(chunk.data(), chunk.size());
+            ++calls;
+        });
+        
+        const size_t kStep = 16 * 1024;
+        for (size_t i = 0; i < request.size(); i += kStep) {
+            buf.append(request.data() + i, std::min(kStep, request.size() - i));
+            assert(context.parseRequest(&buf, Timestamp::now()));
+            maxBuffered = std::max(maxBuffered, buf.readableBytes());
+        }
+        assert(context.gotAll());
+        assert(context.request().query() == "x=1");
+        assert(context.request().body().empty());
+        assert(received == body);
+        assert(maxBuffered < 2 * kStep);
+        context.finishRequest(&buf);
+        assert(buf.readableBytes() == 0);
+        
+        std::cout << (chunked ? "chunked" : "Content-Length")
+                  << " 流式接收: " << calls << "次回调, Buffer最多积压 "
+                  << maxBuffered << " 字节" << std::endl;
+    }
+    std::cout << "✅ 流式接收正确" << std::endl;
+}
+
+// 测试9：多个Content-Length头部必须一致
+void testDuplicateContentLength() {
+    {
+        // 值相同：按这个长度接收
+        Buffer buf;
+        HttpContext context;
+        buf.append("POST / HTTP/1.1\r\nContent-Length: 3\r\ncontent-length: 3\r\n\r\nabc");
+        assert(context.parseRequest(&buf, Timestamp::now()) && context.gotAll());
+        assert(context.request().body() == "abc");
+    }
+    const char* bad[] = {
+        // 值不同：前面的代理可能按最后一个切分请求
+        "POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 40\r\n\r\nabc",
+        // 后面的值不合法
+        "POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length: 3x\r\n\r\nabc",
+        "POST / HTTP/1.1\r\nContent-Length: 3\r\nContent-Length:\r\n\r\nabc",
+        // chunked之外再出现Content-Length，不管是第几个
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 3\r\n\r\n",
+    };
+    for (const char* request : bad) {
+        Buffer buf;
+        HttpContext context;
+        buf.append(request);
+        assert(!context.parseRequest(&buf, Timestamp::now()));
+        assert(context.errorStatus() == 400);
+    }
+    std::cout << "✅ 多个Content-Length不一致时拒绝" << std::endl;
+}
+
+// 测试10：chunk大小行和trailer的上限
+void testChunkLimits() {
+    const std::string head = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n";
+    {
+        // 没有\r\n的chunk扩展不能一直堆积
+        Buffer buf;
+        HttpContext context;
+        context.setMaxBodySize(1024);
+        buf.append(head + "5;ext=");
+        assert(context.parseRequest(&buf, Timestamp::now()));
+        std::string ext(4096, 'e');
+        bool ok = true;
+        for (int i = 0; i < 4 && ok; ++i) {
+            buf.append(ext);
+            ok = context.parseRequest(&buf, Timestamp::now());
+        }
+        assert(!ok && context.errorStatus() == 400);
+        assert(buf.readableBytes() < head.size() + 2 * ext.size());
+    }
+    {
+        // 长度在上限之内的扩展可以
+        Buffer buf;
+        HttpContext context;
+        buf.append(head + "3;" + std::string(HttpContext::kMaxChunkSizeLine - 8, 'e') + "\r\nabc\r\n0\r\n\r\n");
+        assert(context.parseRequest(&buf, Timestamp::now()) && context.gotAll());
+        assert(context.request().body() == "abc");
+    }
+    {
+        // trailer的大小按头部上限计算（不完整的行同样算数）
+        Buffer buf;
+        HttpContext context;
+        context.setMaxHeaderSize(1024);
+        buf.append(head + "0\r\nX-Trailer: " + std::string(2048, 't'));
+        assert(!context.parseRequest(&buf, Timestamp::now()));
+        assert(context.errorStatus() == 431);
+    }
+    {
+        // 很多短的trailer行加起来也不能超过头部上限
+        Buffer buf;
+        HttpContext context;
+        context.setMaxHeaderSize(1024);
+        context.setMaxHeaderCount(1000);
+        std::string request = head + "0\r\n";
+        for (int i = 0; i < 100; ++i) {
+            request += "X-T: 0123456789\r\n";
+        }
+        buf.append(request);
+        assert(!context.parseRequest(&buf, Timestamp::now()));
+        assert(context.errorStatus() == 431);
+    }
+    {
+        // trailer的行数按头部数量上限计算
+        Buffer buf;
+        HttpContext context;
+        context.setMaxHeaderCount(3);
+        buf.append(head + "0\r\nA: 1\r\nB: 2\r\nC: 3\r\nD: 4\r\n\r\n");
+        assert(!context.parseRequest(&buf, Timestamp::now()));
+        assert(context.errorStatus() == 431);
+        
+        Buffer ok;
+        HttpContext okContext;
+        okContext.setMaxHeaderCount(3);
+        ok.append(head + "0\r\nA: 1\r\nB: 2\r\nC: 3\r\n\r\n");
+        assert(okContext.parseRequest(&ok, Timestamp::now()) && okContext.gotAll());
+    }
+    std::cout << "✅ chunk大小行和trailer的上限生效" << std::endl;
+}
+
+// 测试11：Transfer-Encoding按最后一个完整的编码判断，字段名不能有空白
+void testFraming() {
+    {
+        // 多个头部、逗号分隔、大小写和空白
+        Buffer buf;
+        HttpContext context;
+        buf.append("POST / HTTP/1.1\r\nTransfer-Encoding: gzip\r\n"
+                   "Transfer-Encoding: identity ,\tChunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n");
+        assert(context.parseRequest(&buf, Timestamp::now()) && context.gotAll());
+        assert(context.request().body() == "abc");
+    }
+    const char* bad[] = {
+        // 只是以chunked结尾，不是chunked编码
+        "POST / HTTP/1.1\r\nTransfer-Encoding: xchunked\r\n\r\n3\r\nabc\r\n0\r\n\r\n",
+        // 第一个头部是chunked，合起来最后一个编码却不是
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nTransfer-Encoding: identity\r\n\r\n",
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked,\r\n\r\n",
+        // 字段名后面有空格：不能忽略这个Content-Length，把请求体当成下一个请求
+        "POST / HTTP/1.1\r\nContent-Length : 18\r\n\r\nGET /admin HTTP/1.1\r\n\r\n",
+        "GET / HTTP/1.1\r\n: empty\r\n\r\n",
+        "GET / HTTP/1.1\r\nX Y: 1\r\n\r\n",
+        "GET / HTTP/1.1\r\nX(Y): 1\r\n\r\n",
+    };
+    for (const char* request : bad) {
+        Buffer buf;
+        HttpContext context;
+        buf.append(request);
+        assert(!context.parseRequest(&buf, Timestamp::now()));
+        assert(context.errorStatus() == 400);
+    }
+    std::cout << "✅ 分帧有歧义的请求被拒绝" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 测试HttpContext零拷贝解析 ===" << std::endl;
+    testParse();
+    testSplit();
+    testBadRequest();
+    testNoAllocation();
+    testContentLength();
+    testChunked();
+    testMaxBodySize();
+    testStreaming();
+    testDuplicateContentLength();
+    testChunkLimits();
+    testFraming();
+    return 0;
+}
@@ -0,0 +1,317 @@
+// 测试业务回调交给工作线程（setHandlerOffload）和异步响应（HttpResponseWriter）
+// 1. 业务回调在工作线程执行，请求（头部、参数、请求体）是完整的拷贝
+// 2. 慢的业务回调不影响同一个loop上其他连接的请求
+// 3. pipelining：慢请求和快请求交错，响应顺序和请求顺序一致
+// 4. 异步回调在其他线程完成；没有调用send()就丢掉writer时回复500
+// 5. 工作线程和队列都满了：新请求直接503，放开之后排队的请求全部完成
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "HttpResponseWriter.h"
+#include "EventLoop.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <atomic>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const int kPort = 18092;
+const int kWorkers = 2;
+const int kQueueSize = 4;
+
+std::thread::id g_ioThread;
+
+// /block用：先进入的请求一直等到release
+std::mutex g_mutex;
+std::condition_variable g_cond;
+bool g_released = false;
+std::atomic<int> g_blocked(0);
+
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void writeAll(int fd, const std::string& data) {
+    size_t n = 0;
+    while (n < data.size()) {
+        ssize_t w = ::write(fd, data.data() + n, data.size() - n);
+        assert(w > 0);
+        n += w;
+    }
+}
+
+struct Response {
+    int status;
+    std::string headers;
+    std::string body;
+};
+
+// 读一个响应，HEAD请求的响应没有响应体（headOnly）
+Response readResponse(int fd, std::string* pending, bool headOnly = false) {
+    size_t end;
+    while ((end = pending->find("\r\n\r\n")) == std::string::npos) {
+        char buf[4096];
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        assert(n > 0);
+        pending->append(buf, n);
+    }
+    Response resp;
+    resp.headers = pending->substr(0, end + 4);
+    resp.status = atoi(resp.headers.c_str() + 9);
+    size_t pos = resp.headers.find("Content-Length: ");
+    size_t length = (pos != std::string::npos && !headOnly) ? atoi(resp.headers.c_str() + pos + 16) : 0;
+    while (pending->size() < end + 4 + length) {
+        char buf[4096];
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        assert(n > 0);
+        pending->append(buf, n);
+    }
+    resp.body = pending->substr(end + 4, length);
+    pending->erase(0, end + 4 + length);
+    return resp;
+}
+
+Response get(int fd, const std::string& path, std::string* pending) {
+    writeAll(fd, "GET " + path + " HTTP/1.1\r\nHost: test\r\n\r\n");
+    return readResponse(fd, pending);
+}
+
+// 测试1：在工作线程执行
+void testWorkerThread() {
+    std::cout << "\n[测试1] 业务回调在工作线程执行" << std::endl;
+    
+    int fd = connectServer();
+    std::string pending;
+    Response resp = get(fd, "/thread", &pending);
+    assert(resp.status == 200 && resp.body == "worker");
+    
+    // 路由参数、查询参数、头部、请求体都在拷贝里
+    writeAll(fd, "POST /echo/42?x=1 HTTP/1.1\r\nHost: test\r\nX-Name: tiny\r\nContent-Length: 5\r\n\r\nhello");
+    resp = readResponse(fd, &pending);
+    assert(resp.status == 200 && resp.body == "42|x=1|tiny|hello");
+    
+    // chunked请求体（解码到context里，也要拷贝）
+    writeAll(fd, "POST /echo/7 HTTP/1.1\r\nHost: test\r\nX-Name: c\r\nTransfer-Encoding: chunked\r\n\r\n"
+                 "3\r\nabc\r\n2\r\nde\r\n0\r\n\r\n");
+    resp = readResponse(fd, &pending);
+    assert(resp.status == 200 && resp.body == "7||c|abcde");
+    
+    // HEAD：只有头部
+    writeAll(fd, "HEAD /thread HTTP/1.1\r\nHost: test\r\n\r\n");
+    resp = readResponse(fd, &pending, true);
+    assert(resp.status == 200 && resp.headers.find("Content-Length: 6\r\n") != std::string::npos);
+    assert(get(fd, "/fast", &pending).body == "fast");
+    
+    // 没有路由匹配，也没有HttpCallback之外的处理：异步回调处理
+    assert(get(fd, "/nothing", &pending).status == 404);
+    ::close(fd);
+    std::cout << "  ✓ 请求完整，响应正确" << std::endl;
+}
+
+// 测试2：慢请求不影响其他连接
+void testSlowDoesNotBlock() {
+    std::cout << "\n[测试2] 慢的业务回调不卡住IO线程" << std::endl;
+    
+    int slow = connectServer();
+    writeAll(slow, "GET /slow?ms=500 HTTP/1.1\r\nHost: test\r\n\r\n");
+    ::usleep(50 * 1000);
+    
+    int fast = connectServer();
+    std::string pending;
+    Timestamp start = Timestamp::now();
+    for (int i = 0; i < 20; ++i) {
+        assert(get(fast, "/fast", &pending).body == "fast");
+    }
+    double elapsed = timeDifference(Timestamp::now(), start);
+    assert(elapsed < 0.3);
+    
+    std::string slowPending;
+    assert(readResponse(slow, &slowPending).body == "slow");
+    ::close(slow);
+    ::close(fast);
+    std::cout << "  ✓ 慢请求期间20个快请求用了" << elapsed * 1000 << "ms" << std::endl;
+}
+
+// 测试3：pipelining的响应顺序
+void testOrdering() {
+    std::cout << "\n[测试3] pipelining响应顺序" << std::endl;
+    
+    int fd = connectServer();
+    writeAll(fd, "GET /slow?ms=100 HTTP/1.1\r\nHost: test\r\n\r\n"
+                 "GET /fast HTTP/1.1\r\nHost: test\r\n\r\n"
+                 "POST /echo/1 HTTP/1.1\r\nHost: test\r\nX-Name: n\r\nContent-Length: 3\r\n\r\nabc"
+                 "GET /slow?ms=30 HTTP/1.1\r\nHost: test\r\n\r\n"
+                 "GET /async/10 HTTP/1.1\r\nHost: test\r\n\r\n"
+                 "GET /fast HTTP/1.1\r\nHost: test\r\n\r\n");
+    std::string pending;
+    assert(readResponse(fd, &pending).body == "slow");
+    assert(readResponse(fd, &pending).body == "fast");
+    assert(readResponse(fd, &pending).body == "1||n|abc");
+    assert(readResponse(fd, &pending).body == "slow");
+    assert(readResponse(fd, &pending).body == "async 10");
+    assert(readResponse(fd, &pending).body == "fast");
+    ::close(fd);
+    std::cout << "  ✓ 6个请求按顺序响应" << std::endl;
+}
+
+// 测试4：异步回调
+void testAsync() {
+    std::cout << "\n[测试4] 异步回调" << std::endl;
+    
+    int fd = connectServer();
+    std::string pending;
+    Response resp = get(fd, "/async/50", &pending);
+    assert(resp.status == 200 && resp.body == "async 50");
+    
+    // writer没有send()就销毁了：500并关闭连接
+    resp = get(fd, "/async-drop", &pending);
+    assert(resp.status == 500);
+    assert(resp.headers.find("Connection: close\r\n") != std::string::npos);
+    char c;
+    ssize_t rc = ::read(fd, &c, 1);
+    assert(rc == 0);
+    (void)rc;
+    ::close(fd);
+    std::cout << "  ✓ 其他线程完成的响应、丢掉的writer都正确" << std::endl;
+}
+
+// 测试5：503
+void testShedding() {
+    std::cout << "\n[测试5] 队列满时503" << std::endl;
+    
+    // 先占满工作线程，再排满队列
+    std::vector<int> fds;
+    for (int i = 0; i < kWorkers; ++i) {
+        fds.push_back(connectServer());
+        writeAll(fds.back(), "GET /block HTTP/1.1\r\nHost: test\r\n\r\n");
+    }
+    while (g_blocked < kWorkers) {
+        ::usleep(1000);
+    }
+    for (int i = 0; i < kQueueSize; ++i) {
+        fds.push_back(connectServer());
+        writeAll(fds.back(), "GET /block HTTP/1.1\r\nHost: test\r\n\r\n");
+    }
+    ::usleep(100 * 1000);
+    
+    // 再来的请求立即503，同一个连接之后还能继续用
+    int fd = connectServer();
+    std::string pending;
+    Timestamp start = Timestamp::now();
+    Response resp = get(fd, "/fast", &pending);
+    assert(resp.status == 503);
+    assert(resp.headers.find("Retry-After: 1\r\n") != std::string::npos);
+    assert(timeDifference(Timestamp::now(), start) < 0.1);
+    
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_released = true;
+    }
+    g_cond.notify_all();
+    
+    for (int blocked : fds) {
+        std::string p;
+        assert(readResponse(blocked, &p).body == "released");
+        ::close(blocked);
+    }
+    assert(get(fd, "/fast", &pending).status == 200);
+    ::close(fd);
+    std::cout << "  ✓ " << kWorkers + kQueueSize << "个请求在处理/排队时新请求503，之后全部完成" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 测试业务回调offload ===" << std::endl;
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    g_ioThread = std::this_thread::get_id();
+    HttpServer server(&loop, "TestHttpOffload", kPort);
+    server.setWorkerThreadNum(kWorkers);
+    server.setMaxWorkerQueueSize(kQueueSize);
+    server.setHandlerOffload(true);
+    
+    server.router().GET("/fast", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody("fast");
+    });
+    server.router().GET("/slow", [](const HttpRequest& req, HttpResponse* resp) {
+        int ms = atoi(req.query().as_string().c_str() + 3);  // ms=N
+        ::usleep(ms * 1000);
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody("slow");
+    });
+    server.router().GET("/thread", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody(std::this_thread::get_id() == g_ioThread ? "io" : "worker");
+    });
+    server.router().POST("/echo/:id", [](const HttpRequest& req, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody(req.param("id").as_string() + "|" + req.query().as_string() + "|"
+                      + req.getHeader("X-Name").as_string() + "|" + req.body().as_string());
+    });
+    server.router().GET("/block", [](const HttpRequest&, HttpResponse* resp) {
+        ++g_blocked;
+        std::unique_lock<std::mutex> lock(g_mutex);
+        g_cond.wait(lock, [] { return g_released; });
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody("released");
+    });
+    
+    // 路由没有匹配的请求：/async/N在另一个线程N毫秒后完成
+    server.setAsyncHttpCallback([](const HttpRequest& req, const HttpResponseWriterPtr& writer) {
+        StringPiece path = req.path();
+        if (path.starts_with("/async/")) {
+            int ms = atoi(path.as_string().c_str() + 7);
+            std::thread([writer, ms]() {
+                ::usleep(ms * 1000);
+                writer->response()->setStatusCode(HttpResponse::k200Ok);
+                writer->response()->setBody("async " + std::to_string(ms));
+                writer->send();
+            }).detach();
+        } else if (path == "/async-drop") {
+            // 什么都不做，writer在这里被丢掉
+        } else {
+            writer->response()->setStatusCode(HttpResponse::k404NotFound);
+            writer->send();
+        }
+    });
+    server.start();
+    
+    std::thread client([&]() {
+        ::usleep(100 * 1000);
+        testWorkerThread();
+        testSlowDoesNotBlock();
+        testOrdering();
+        testAsync();
+        testShedding();
+        
+        std::cout << "\n=== 所有测试通过 ===" << std::endl;
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    return 0;
+}
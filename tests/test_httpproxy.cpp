@@ -0,0 +1,510 @@
+// 测试HttpProxy反向代理
+// 1. 基本转发：路径、查询参数、头部原样到达上游，逐跳头部被去掉
+// 2. keep-alive复用：多个请求只建立很少的上游连接；上游关闭空闲连接后照常转发
+// 3. 轮询：两个上游各分到一半请求
+// 4. 大的请求体和响应体边收边转发，分块编码的请求体和响应体
+// 5. HEAD：Content-Length原样转发，没有响应体
+// 6. 出错：上游连不上回复502并标记为不健康，之后回复503；上游不响应回复504
+// 7. 健康检查：检查失败的上游不再分到请求，恢复后重新加入
+// 8. 最少连接：有请求在处理的上游不再分到新请求
+
+#include "HttpProxy.h"
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "HttpResponseStream.h"
+#include "HttpResponseWriter.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const int kProxyPort = 18096;         // A、B，轮询，健康检查
+const int kDeadProxyPort = 18190;     // 上游没有在监听
+const int kSilentProxyPort = 18191;   // 上游只listen不响应
+const int kLeastProxyPort = 18192;    // A、B，最少连接
+const int kUpstreamA = 18196;
+const int kUpstreamB = 18197;
+const int kSilentUpstream = 18198;
+const int kDeadUpstream = 18199;
+const size_t kLargeSize = 8 * 1024 * 1024;
+
+std::atomic<bool> g_healthyB(true);        // 上游B的/health是否返回200
+std::mutex g_mutex;
+std::vector<HttpResponseWriterPtr> g_held;  // /hold的请求，由测试决定什么时候响应
+
+int connectTo(int port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void writeAll(int fd, const std::string& data) {
+    size_t n = 0;
+    while (n < data.size()) {
+        ssize_t w = ::write(fd, data.data() + n, data.size() - n);
+        assert(w > 0);
+        n += w;
+    }
+}
+
+// 至少读到n字节，连接关闭返回false
+bool fill(int fd, std::string* pending, size_t n) {
+    while (pending->size() < n) {
+        char buf[65536];
+        ssize_t r = ::read(fd, buf, sizeof buf);
+        if (r <= 0) {
+            return false;
+        }
+        pending->append(buf, r);
+    }
+    return true;
+}
+
+struct Response {
+    int status;
+    std::string headers;
+    std::string body;
+    bool complete;
+};
+
+// 读一个响应：Content-Length或者分块编码
+Response readResponse(int fd, std::string* pending, bool headOnly = false) {
+    Response resp;
+    resp.status = 0;
+    resp.complete = false;
+    size_t end;
+    while ((end = pending->find("\r\n\r\n")) == std::string::npos) {
+        if (!fill(fd, pending, pending->size() + 1)) {
+            return resp;
+        }
+    }
+    resp.headers = pending->substr(0, end + 4);
+    resp.status = atoi(resp.headers.c_str() + 9);
+    pending->erase(0, end + 4);
+    if (headOnly) {
+        resp.complete = true;
+        return resp;
+    }
+    
+    size_t pos = resp.headers.find("Content-Length: ");
+    if (pos != std::string::npos) {
+        size_t length = atoi(resp.headers.c_str() + pos + 16);
+        resp.complete = fill(fd, pending, length);
+        resp.body = pending->substr(0, length);
+        pending->erase(0, resp.body.size());
+    } else if (resp.headers.find("Transfer-Encoding: chunked\r\n") != std::string::npos) {
+        while (true) {
+            size_t lineEnd;
+            while ((lineEnd = pending->find("\r\n")) == std::string::npos) {
+                if (!fill(fd, pending, pending->size() + 1)) {
+                    return resp;
+                }
+            }
+            size_t size = strtoul(pending->c_str(), nullptr, 16);
+            if (!fill(fd, pending, lineEnd + 2 + size + 2)) {
+                return resp;
+            }
+            resp.body.append(*pending, lineEnd + 2, size);
+            pending->erase(0, lineEnd + 2 + size + 2);
+            if (size == 0) {
+                resp.complete = true;
+                break;
+            }
+        }
+    }
+    return resp;
+}
+
+// 一个请求一个连接
+Response request(int port, const std::string& req) {
+    int fd = connectTo(port);
+    assert(fd >= 0);
+    writeAll(fd, req);
+    std::string pending;
+    Response resp = readResponse(fd, &pending);
+    ::close(fd);
+    return resp;
+}
+
+bool hasHeader(const Response& resp, const std::string& line) {
+    return resp.headers.find(line + "\r\n") != std::string::npos;
+}
+
+char patternAt(size_t i) {
+    return static_cast<char>('a' + (i * 7 + i / 4096) % 26);
+}
+
+uint64_t totalConnects(HttpProxy& proxy) {
+    uint64_t n = 0;
+    for (size_t i = 0; i < proxy.upstreamCount(); ++i) {
+        n += proxy.upstreamStats(i).connects;
+    }
+    return n;
+}
+
+// 上游：A和B只有X-Upstream不同
+void setupUpstream(HttpServer& server, const std::string& name) {
+    server.setMaxBodySize(64 * 1024 * 1024);
+    server.router().GET("/echo", [name](const HttpRequest& req, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->addHeader("X-Upstream", name);
+        resp->addHeader("Set-Cookie", "a=1");
+        resp->appendHeader("Set-Cookie", "b=2");  // 重复的头部都要转发
+        resp->setBody(req.path().as_string() + "?" + req.query().as_string()
+                      + "|" + req.getHeader("X-Test").as_string()
+                      + "|" + req.getHeader("Connection").as_string()
+                      + "|" + req.getHeader("Host").as_string());
+    });
+    server.router().GET("/large", [](const HttpRequest&, HttpResponse* resp) {
+        std::string body(kLargeSize, 0);
+        for (size_t i = 0; i < body.size(); ++i) {
+            body[i] = patternAt(i);
+        }
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody(std::move(body));
+    });
+    server.router().GET("/chunked", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStream([](const HttpResponseStreamPtr& stream) {
+            for (int i = 0; i < 100; ++i) {
+                stream->write("line " + std::to_string(i) + "\n");
+            }
+            stream->finish();
+        });
+    });
+    server.router().POST("/upload", [](const HttpRequest& req, HttpResponse* resp) {
+        StringPiece body = req.body();
+        bool ok = true;
+        for (size_t i = 0; i < body.size(); ++i) {
+            ok = ok && body[i] == patternAt(i);
+        }
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody(std::to_string(body.size()) + (ok ? " ok" : " bad")
+                      + (req.getHeader("Transfer-Encoding").empty() ? "" : " chunked"));
+    });
+    server.router().GET("/health", [name](const HttpRequest&, HttpResponse* resp) {
+        bool healthy = name != "B" || g_healthyB;
+        resp->setStatusCode(healthy ? HttpResponse::k200Ok : HttpResponse::k503ServiceUnavailable);
+        resp->setBody(healthy ? "ok" : "down");
+    });
+    // 没有路由的路径（/hold）：先不响应，由测试决定什么时候响应
+    server.setAsyncHttpCallback([name](const HttpRequest&, const HttpResponseWriterPtr& writer) {
+        writer->response()->setStatusCode(HttpResponse::k200Ok);
+        writer->response()->setBody(name);
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_held.push_back(writer);
+    });
+}
+
+// 测试1：基本转发
+void testBasic() {
+    std::cout << "\n[测试1] 基本转发" << std::endl;
+    
+    Response resp = request(kProxyPort, "GET /echo?x=1&y=2 HTTP/1.1\r\nHost: example.com\r\n"
+                                        "X-Test: hello\r\nConnection: keep-alive\r\n\r\n");
+    assert(resp.status == 200 && resp.complete);
+    assert(resp.body == "/echo?x=1&y=2|hello||example.com");
+    assert(hasHeader(resp, "Set-Cookie: a=1") && hasHeader(resp, "Set-Cookie: b=2"));
+    assert(hasHeader(resp, "X-Upstream: A") || hasHeader(resp, "X-Upstream: B"));
+    
+    // HTTP/1.0没有Host：补上上游的地址
+    resp = request(kProxyPort, "GET /echo HTTP/1.0\r\n\r\n");
+    assert(resp.status == 200);
+    assert(resp.body.find("|127.0.0.1:1819") != std::string::npos);
+    std::cout << "  ✓ 路径、查询参数、头部原样转发，逐跳头部被去掉" << std::endl;
+}
+
+// 测试2：keep-alive复用
+void testKeepAlive(HttpProxy& proxy) {
+    std::cout << "\n[测试2] 上游连接复用" << std::endl;
+    
+    uint64_t connects = totalConnects(proxy);
+    int fd = connectTo(kProxyPort);
+    std::string pending;
+    for (int i = 0; i < 20; ++i) {
+        writeAll(fd, "GET /echo HTTP/1.1\r\nHost: test\r\n\r\n");
+        Response resp = readResponse(fd, &pending);
+        assert(resp.status == 200 && resp.complete);
+    }
+    uint64_t used = totalConnects(proxy) - connects;
+    std::cout << "  20个请求新建了 " << used << " 个上游连接" << std::endl;
+    assert(used <= 2);
+    
+    // 上游的keep-alive超时关闭了池里的连接：代理发现后丢掉，请求照常转发
+    ::usleep(600 * 1000);
+    for (int i = 0; i < 4; ++i) {
+        writeAll(fd, "GET /echo HTTP/1.1\r\nHost: test\r\n\r\n");
+        Response resp = readResponse(fd, &pending);
+        assert(resp.status == 200 && resp.complete);
+    }
+    ::close(fd);
+    std::cout << "  ✓ keep-alive复用，上游关闭的空闲连接不影响转发" << std::endl;
+}
+
+// 测试3：轮询
+void testRoundRobin() {
+    std::cout << "\n[测试3] 轮询" << std::endl;
+    
+    int a = 0;
+    int b = 0;
+    for (int i = 0; i < 10; ++i) {
+        Response resp = request(kProxyPort, "GET /echo HTTP/1.1\r\nHost: test\r\n\r\n");
+        if (hasHeader(resp, "X-Upstream: A")) {
+            ++a;
+        } else if (hasHeader(resp, "X-Upstream: B")) {
+            ++b;
+        }
+    }
+    assert(a == 5 && b == 5);
+    std::cout << "  ✓ A " << a << " 次，B " << b << " 次" << std::endl;
+}
+
+// 测试4：大的请求体和响应体，分块编码
+void testBodies() {
+    std::cout << "\n[测试4] 请求体和响应体" << std::endl;
+    
+    int fd = connectTo(kProxyPort);
+    std::string pending;
+    writeAll(fd, "GET /large HTTP/1.1\r\nHost: test\r\n\r\n");
+    Response resp = readResponse(fd, &pending);
+    assert(resp.status == 200 && resp.complete);
+    assert(hasHeader(resp, "Content-Length: " + std::to_string(kLargeSize)));
+    assert(resp.body.size() == kLargeSize);
+    for (size_t i = 0; i < resp.body.size(); ++i) {
+        assert(resp.body[i] == patternAt(i));
+    }
+    
+    // 长度未知的响应体：和客户端之间也用分块编码
+    writeAll(fd, "GET /chunked HTTP/1.1\r\nHost: test\r\n\r\n");
+    resp = readResponse(fd, &pending);
+    assert(resp.status == 200 && resp.complete);
+    assert(hasHeader(resp, "Transfer-Encoding: chunked"));
+    std::string expected;
+    for (int i = 0; i < 100; ++i) {
+        expected += "line " + std::to_string(i) + "\n";
+    }
+    assert(resp.body == expected);
+    
+    // 4MB请求体：另一个线程慢慢写，代理边收边转发
+    const size_t uploadSize = 4 * 1024 * 1024;
+    std::string body(uploadSize, 0);
+    for (size_t i = 0; i < body.size(); ++i) {
+        body[i] = patternAt(i);
+    }
+    std::thread writer([fd, &body]() {
+        writeAll(fd, "POST /upload HTTP/1.1\r\nHost: test\r\nContent-Length: "
+                     + std::to_string(body.size()) + "\r\n\r\n");
+        for (size_t off = 0; off < body.size(); off += 256 * 1024) {
+            writeAll(fd, body.substr(off, 256 * 1024));
+        }
+    });
+    resp = readResponse(fd, &pending);
+    writer.join();
+    assert(resp.status == 200 && resp.body == std::to_string(uploadSize) + " ok");
+    
+    // 分块编码的请求体：重新分块转发给上游
+    std::string chunked = "POST /upload HTTP/1.1\r\nHost: test\r\nTransfer-Encoding: chunked\r\n\r\n";
+    std::string small = body.substr(0, 30000);
+    for (size_t off = 0; off < small.size(); off += 7000) {
+        std::string piece = small.substr(off, 7000);
+        char line[16];
+        snprintf(line, sizeof line, "%zx\r\n", piece.size());
+        chunked += line + piece + "\r\n";
+    }
+    chunked += "0\r\n\r\n";
+    writeAll(fd, chunked);
+    resp = readResponse(fd, &pending);
+    assert(resp.status == 200 && resp.body == "30000 ok chunked");
+    ::close(fd);
+    std::cout << "  ✓ 8MB响应体、4MB请求体内容完整，分块编码两个方向都正确" << std::endl;
+}
+
+// 测试5：HEAD
+void testHead() {
+    std::cout << "\n[测试5] HEAD" << std::endl;
+    
+    int fd = connectTo(kProxyPort);
+    std::string pending;
+    writeAll(fd, "HEAD /large HTTP/1.1\r\nHost: test\r\n\r\n");
+    Response resp = readResponse(fd, &pending, true);
+    assert(resp.status == 200);
+    assert(hasHeader(resp, "Content-Length: " + std::to_string(kLargeSize)));
+    
+    // 没有响应体：下一个响应紧跟在后面
+    writeAll(fd, "GET /echo HTTP/1.1\r\nHost: test\r\n\r\n");
+    resp = readResponse(fd, &pending);
+    assert(resp.status == 200 && resp.body.compare(0, 6, "/echo?") == 0);
+    ::close(fd);
+    std::cout << "  ✓ Content-Length原样转发，连接可以继续使用" << std::endl;
+}
+
+// 测试6：出错
+void testErrors(HttpProxy& deadProxy) {
+    std::cout << "\n[测试6] 502 / 503 / 504" << std::endl;
+    
+    Response resp = request(kDeadProxyPort, "GET /echo HTTP/1.1\r\nHost: test\r\n\r\n");
+    assert(resp.status == 502);
+    assert(!deadProxy.upstreamStats(0).healthy);
+    assert(deadProxy.upstreamStats(0).failures == 1);
+    
+    // 唯一的上游被标记为不健康
+    resp = request(kDeadProxyPort, "GET /echo HTTP/1.1\r\nHost: test\r\n\r\n");
+    assert(resp.status == 503);
+    
+    // 连接成功但一直没有响应
+    resp = request(kSilentProxyPort, "GET /echo HTTP/1.1\r\nHost: test\r\n\r\n");
+    assert(resp.status == 504);
+    std::cout << "  ✓ 连不上502，没有健康的上游503，响应超时504" << std::endl;
+}
+
+// 测试7：健康检查
+void testHealthCheck(HttpProxy& proxy) {
+    std::cout << "\n[测试7] 健康检查" << std::endl;
+    
+    g_healthyB = false;
+    ::usleep(700 * 1000);
+    assert(proxy.upstreamStats(0).healthy && !proxy.upstreamStats(1).healthy);
+    for (int i = 0; i < 6; ++i) {
+        Response resp = request(kProxyPort, "GET /echo HTTP/1.1\r\nHost: test\r\n\r\n");
+        assert(resp.status == 200 && hasHeader(resp, "X-Upstream: A"));
+    }
+    
+    g_healthyB = true;
+    ::usleep(700 * 1000);
+    assert(proxy.upstreamStats(1).healthy);
+    int b = 0;
+    for (int i = 0; i < 6; ++i) {
+        Response resp = request(kProxyPort, "GET /echo HTTP/1.1\r\nHost: test\r\n\r\n");
+        b += hasHeader(resp, "X-Upstream: B") ? 1 : 0;
+    }
+    assert(b == 3);
+    std::cout << "  ✓ 检查失败时不再转发给B，恢复后重新轮询" << std::endl;
+}
+
+// 测试8：最少连接
+void testLeastConnections(HttpProxy& proxy) {
+    std::cout << "\n[测试8] 最少连接" << std::endl;
+    
+    // 一个请求停在上游，那个上游的正在处理数为1
+    int held = connectTo(kLeastProxyPort);
+    writeAll(held, "GET /hold HTTP/1.1\r\nHost: test\r\n\r\n");
+    while (proxy.upstreamStats(0).active + proxy.upstreamStats(1).active == 0) {
+        ::usleep(10 * 1000);
+    }
+    std::string busy = proxy.upstreamStats(0).active == 1 ? "A" : "B";
+    
+    for (int i = 0; i < 6; ++i) {
+        Response resp = request(kLeastProxyPort, "GET /echo HTTP/1.1\r\nHost: test\r\n\r\n");
+        assert(resp.status == 200 && !hasHeader(resp, "X-Upstream: " + busy));
+    }
+    
+    // 客户端断开之后上游才响应：代理发现客户端已经不在了，关闭上游连接，正在处理数回到0
+    ::close(held);
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        for (const HttpResponseWriterPtr& writer : g_held) {
+            writer->send();
+        }
+        g_held.clear();
+    }
+    while (proxy.upstreamStats(0).active + proxy.upstreamStats(1).active != 0) {
+        ::usleep(10 * 1000);
+    }
+    std::cout << "  ✓ 新请求都避开了正在处理请求的上游 " << busy << std::endl;
+}
+
+int main() {
+    std::cout << "=== 测试HttpProxy ===" << std::endl;
+    Logger::setLogLevel(Logger::ERROR);
+    
+    EventLoop loop;
+    HttpServer upstreamA(&loop, "UpstreamA", kUpstreamA);
+    HttpServer upstreamB(&loop, "UpstreamB", kUpstreamB);
+    setupUpstream(upstreamA, "A");
+    setupUpstream(upstreamB, "B");
+    upstreamA.setIdleTimeout(0.5);
+    upstreamB.setIdleTimeout(0.5);
+    upstreamA.start();
+    upstreamB.start();
+    
+    // 只listen不accept：连接能建立，但永远没有响应
+    int silent = ::socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    ::setsockopt(silent, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kSilentUpstream);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int rc = ::bind(silent, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr);
+    assert(rc == 0);
+    rc = ::listen(silent, 16);
+    assert(rc == 0);
+    (void)rc;
+    
+    HttpProxy proxy(&loop, "TestProxy", kProxyPort);
+    proxy.server().setThreadNum(2);
+    proxy.server().setMaxBodySize(64 * 1024 * 1024);
+    proxy.addUpstream("127.0.0.1", kUpstreamA);
+    proxy.addUpstream("127.0.0.1", kUpstreamB);
+    proxy.setHealthCheck("/health", 0.2);
+    proxy.start();
+    
+    HttpProxy deadProxy(&loop, "DeadProxy", kDeadProxyPort);
+    deadProxy.addUpstream("127.0.0.1", kDeadUpstream);
+    deadProxy.setHealthCheck("/health", 60);
+    deadProxy.start();
+    
+    HttpProxy silentProxy(&loop, "SilentProxy", kSilentProxyPort);
+    silentProxy.addUpstream("127.0.0.1", kSilentUpstream);
+    silentProxy.setResponseTimeout(0.3);
+    silentProxy.start();
+    
+    HttpProxy leastProxy(&loop, "LeastProxy", kLeastProxyPort);
+    leastProxy.addUpstream("127.0.0.1", kUpstreamA);
+    leastProxy.addUpstream("127.0.0.1", kUpstreamB);
+    leastProxy.setBalance(HttpProxy::kLeastConnections);
+    leastProxy.start();
+    
+    std::thread client([&]() {
+        ::usleep(100 * 1000);
+        testBasic();
+        testKeepAlive(proxy);
+        testRoundRobin();
+        testBodies();
+        testHead();
+        testErrors(deadProxy);
+        testHealthCheck(proxy);
+        testLeastConnections(leastProxy);
+        
+        std::cout << "\n=== 所有测试通过 ===" << std::endl;
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    g_held.clear();
+    ::close(silent);
+    return 0;
+}
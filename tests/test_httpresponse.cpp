@@ -0,0 +1,173 @@
+// 测试HttpResponse的序列化
+// 1. 标准状态行、自定义描述、未知状态码
+// 2. Date头部格式正确，同一秒内复用缓存
+// 3. 头部按添加顺序输出，同名头部替换
+// 4. 204/304不带Content-Length和响应体
+// 5. reset()之后复用：上一个响应的内容全部清除，存储不重新分配
+
+#include "HttpResponse.h"
+#include "Buffer.h"
+#include <iostream>
+#include <string>
+#include <cassert>
+
+std::string serialize(const HttpResponse& resp, Timestamp now) {
+    Buffer buf;
+    resp.appendToBuffer(&buf, now);
+    return buf.retrieveAsString();
+}
+
+// 1994-11-06 08:49:37 UTC（RFC 7231中的例子）
+const Timestamp kExampleTime(784111777LL * Timestamp::kMicroSecondsPerSecond);
+
+// 测试1：状态行
+void testStatusLine() {
+    HttpResponse resp(false);
+    resp.setStatusCode(HttpResponse::k200Ok);
+    resp.setBody("hello world");
+    std::string text = serialize(resp, kExampleTime);
+    assert(text ==
+           "HTTP/1.1 200 OK\r\n"
+           "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+           "Content-Length: 11\r\n"
+           "Connection: Keep-Alive\r\n"
+           "\r\n"
+           "hello world");
+    
+    // 描述和标准描述一样时仍然使用预先生成的状态行
+    resp.setStatusMessage("OK");
+    assert(serialize(resp, kExampleTime) == text);
+    
+    // 自定义描述
+    resp.setStatusCode(HttpResponse::k404NotFound);
+    resp.setStatusMessage("Nothing Here");
+    text = serialize(resp, kExampleTime);
+    assert(text.compare(0, 32, "HTTP/1.1 404 Nothing Here\r\nDate:") == 0);
+    
+    // 枚举之外的状态码
+    HttpResponse teapot(true);
+    teapot.setStatusCode(static_cast<HttpResponse::HttpStatusCode>(418));
+    text = serialize(teapot, kExampleTime);
+    assert(text.compare(0, 22, "HTTP/1.1 418 Unknown\r\n") == 0);
+    assert(text.find("Connection: close\r\n") != std::string::npos);
+    
+    std::cout << "✅ 状态行正确" << std::endl;
+}
+
+// 测试2：Date头部
+void testDate() {
+    StringPiece date = HttpResponse::dateHeader(kExampleTime);
+    assert(date == "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n");
+    
+    // 同一秒内返回同一块缓存
+    Timestamp later(kExampleTime.microSecondsSinceEpoch() + 999999);
+    assert(HttpResponse::dateHeader(later).data() == date.data());
+    assert(HttpResponse::dateHeader(later) == "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n");
+    
+    // 下一秒重新格式化
+    Timestamp next(kExampleTime.microSecondsSinceEpoch() + Timestamp::kMicroSecondsPerSecond);
+    assert(HttpResponse::dateHeader(next) == "Date: Sun, 06 Nov 1994 08:49:38 GMT\r\n");
+    
+    std::cout << "✅ Date头部正确" << std::endl;
+}
+
+// 测试3：头部顺序和替换
+void testHeaders() {
+    HttpResponse resp(false);
+    resp.setStatusCode(HttpResponse::k200Ok);
+    resp.setContentType("text/plain");
+    resp.addHeader("Server", "TinyNetwork");
+    resp.addHeader("X-Trace", "1");
+    resp.addHeader("content-type", "application/json");  // 替换，不改变位置
+    resp.setBody("{}");
+    std::string text = serialize(resp, kExampleTime);
+    assert(text ==
+           "HTTP/1.1 200 OK\r\n"
+           "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+           "Content-Length: 2\r\n"
+           "Content-Type: application/json\r\n"
+           "Server: TinyNetwork\r\n"
+           "X-Trace: 1\r\n"
+           "Connection: Keep-Alive\r\n"
+           "\r\n"
+           "{}");
+    
+    // 空响应体也要有Content-Length，否则keep-alive的客户端不知道响应在哪里结束
+    HttpResponse empty(false);
+    empty.setStatusCode(HttpResponse::k200Ok);
+    assert(serialize(empty, kExampleTime).find("Content-Length: 0\r\n") != std::string::npos);
+    
+    std::cout << "✅ 头部顺序正确" << std::endl;
+}
+
+// 测试4：没有响应体的状态码
+void testNoBody() {
+    HttpResponse resp(false);
+    resp.setStatusCode(HttpResponse::k304NotModified);
+    resp.setBody("ignored");
+    std::string text = serialize(resp, kExampleTime);
+    assert(text ==
+           "HTTP/1.1 304 Not Modified\r\n"
+           "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+           "Connection: Keep-Alive\r\n"
+           "\r\n");
+    
+    resp.setStatusCode(HttpResponse::k204NoContent);
+    text = serialize(resp, kExampleTime);
+    assert(text.find("Content-Length") == std::string::npos);
+    assert(text.compare(text.size() - 4, 4, "\r\n\r\n") == 0);
+    
+    std::cout << "✅ 204/304没有响应体" << std::endl;
+}
+
+// 测试5：复用同一个响应对象
+void testReset() {
+    HttpResponse resp(false);
+    resp.setStatusCode(HttpResponse::k404NotFound);
+    resp.setStatusMessage("Nothing Here");
+    resp.addHeader("X-Long-Header-Name", std::string(100, 'a'));
+    resp.addHeader("X-Copy", resp.header("X-Long-Header-Name"));  // 值来自自己的存储
+    assert(resp.header("X-Copy") == std::string(100, 'a'));
+    resp.setBody(std::string(1000, 'b'));
+    assert(resp.headerCount() == 2);
+    
+    resp.reset(true);
+    assert(resp.statusCode() == HttpResponse::kUnknown);
+    assert(resp.headerCount() == 0);
+    assert(resp.header("X-Copy").empty());
+    assert(resp.body().empty());
+    assert(resp.closeConnection());
+    
+    // 同名替换：新值更长、更短都可以，位置不变
+    resp.setStatusCode(HttpResponse::k200Ok);
+    resp.addHeader("A", "1");
+    resp.addHeader("B", "2");
+    resp.addHeader("a", "a much longer value");
+    resp.addHeader("b", "");
+    assert(resp.headerCount() == 2);
+    assert(resp.headerField(0) == "A" && resp.headerValue(0) == "a much longer value");
+    assert(resp.headerField(1) == "B" && resp.headerValue(1).empty());
+    resp.setBody("ok");
+    std::string text = serialize(resp, kExampleTime);
+    assert(text ==
+           "HTTP/1.1 200 OK\r\n"
+           "Date: Sun, 06 Nov 1994 08:49:37 GMT\r\n"
+           "Content-Length: 2\r\n"
+           "A: a much longer value\r\n"
+           "B: \r\n"
+           "Connection: close\r\n"
+           "\r\n"
+           "ok");
+    
+    std::cout << "✅ reset之后复用正确" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 测试HttpResponse ===" << std::endl;
+    testStatusLine();
+    testDate();
+    testHeaders();
+    testNoBody();
+    testReset();
+    return 0;
+}
@@ -0,0 +1,221 @@
+// 测试HttpRouter的路由匹配
+// 1. 静态路径、参数、通配，以及它们之间的优先级和回溯
+// 2. 方法不匹配返回405和Allow头部
+// 3. 节点分裂（公共前缀）后原有路由仍然正确
+// 4. 匹配时没有堆内存分配
+
+#include "HttpRouter.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "Buffer.h"
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <new>
+#include <cassert>
+#include <cstring>
+
+// 统计堆分配次数：替换全局operator new
+static size_t g_allocations = 0;
+
+void* operator new(size_t size) {
+    ++g_allocations;
+    void* p = malloc(size);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// 用路径构造一个请求（path需要比req活得久）
+void makeRequest(HttpRequest* req, const char* method, const std::string& path) {
+    req->reset();
+    req->setBase(path.data());
+    req->setMethod(method, method + strlen(method));
+    req->setPath(path.data(), path.data() + path.size());
+}
+
+// 匹配并返回处理函数写入的响应体
+// 路径拷贝到g_path里，匹配之后还要通过req检查捕获的参数
+std::string g_path;
+
+std::string route(const HttpRouter& router, const char* method, const std::string& path,
+                  HttpRequest* req) {
+    g_path = path;
+    makeRequest(req, method, g_path);
+    const HttpRouter::Handler* handler = router.match(req);
+    if (!handler) {
+        return "<none>";
+    }
+    HttpResponse resp(false);
+    (*handler)(*req, &resp);
+    Buffer buf;
+    resp.appendToBuffer(&buf);
+    std::string text = buf.retrieveAsString();
+    return text.substr(text.find("\r\n\r\n") + 4);
+}
+
+// 返回固定内容的处理函数
+HttpRouter::Handler reply(const std::string& body) {
+    return [body](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody(body);
+    };
+}
+
+// 测试1：静态、参数、通配
+void testMatch() {
+    HttpRouter router;
+    router.GET("/", reply("root"));
+    router.GET("/users", reply("users"));
+    router.GET("/users/new", reply("new-user"));
+    router.GET("/users/:id", reply("user"));
+    router.GET("/users/:id/posts/:post", reply("post"));
+    router.GET("/static/*filepath", reply("static"));
+    router.POST("/users", reply("create"));
+    assert(router.size() == 7);
+    
+    HttpRequest req;
+    assert(route(router, "GET", "/", &req) == "root");
+    assert(route(router, "GET", "/users", &req) == "users");
+    assert(route(router, "POST", "/users", &req) == "create");
+    
+    // 静态优先于参数
+    assert(route(router, "GET", "/users/new", &req) == "new-user");
+    assert(req.paramCount() == 0);
+    
+    assert(route(router, "GET", "/users/42", &req) == "user");
+    assert(req.paramCount() == 1);
+    assert(req.param("id") == "42");
+    
+    // 静态分支/users/new匹配了前缀，但后面不对，要回溯到参数分支
+    assert(route(router, "GET", "/users/newton", &req) == "user");
+    assert(req.param("id") == "newton");
+    
+    assert(route(router, "GET", "/users/7/posts/hello", &req) == "post");
+    assert(req.paramCount() == 2);
+    assert(req.param("id") == "7");
+    assert(req.param("post") == "hello");
+    assert(req.param("missing").empty());
+    
+    assert(route(router, "GET", "/static/css/site.css", &req) == "static");
+    assert(req.param("filepath") == "css/site.css");
+    assert(route(router, "GET", "/static/", &req) == "static");
+    assert(req.param("filepath").empty());
+    
+    // 不匹配：参数不能为空，也不能跨越'/'
+    assert(route(router, "GET", "/users/", &req) == "<none>");
+    assert(route(router, "GET", "/users/7/posts", &req) == "<none>");
+    assert(route(router, "GET", "/users/7/extra", &req) == "<none>");
+    assert(route(router, "GET", "/unknown", &req) == "<none>");
+    assert(route(router, "GET", "/user", &req) == "<none>");
+    assert(req.paramCount() == 0);
+    
+    std::cout << "✅ 静态/参数/通配匹配正确" << std::endl;
+}
+
+// 测试2：路径存在但方法不对
+void testMethodNotAllowed() {
+    HttpRouter router;
+    router.GET("/items/:id", reply("get"));
+    router.PUT("/items/:id", reply("put"));
+    router.DELETE("/items/:id", reply("delete"));
+    router.POST("/items", reply("post"));
+    
+    HttpRequest req;
+    makeRequest(&req, "POST", "/items/1");
+    unsigned allowed = 0;
+    assert(router.match(&req, &allowed) == nullptr);
+    assert(allowed == ((1u << HttpRequest::kGet) | (1u << HttpRequest::kPut) |
+                       (1u << HttpRequest::kDelete)));
+    
+    HttpResponse resp(false);
+    assert(router.dispatch(&req, &resp));
+    assert(resp.statusCode() == HttpResponse::k405MethodNotAllowed);
+    Buffer buf;
+    resp.appendToBuffer(&buf);
+    std::string text = buf.retrieveAsString();
+    assert(text.find("Allow: GET, PUT, DELETE\r\n") != std::string::npos);
+    
+    // 完全不存在的路径：dispatch返回false，交给调用者处理
+    makeRequest(&req, "GET", "/nothing");
+    HttpResponse resp2(false);
+    assert(!router.dispatch(&req, &resp2));
+    
+    // 方法不同的路由在同一条路径上可以回溯：POST /items/new走参数分支
+    router.GET("/items/new", reply("form"));
+    assert(route(router, "PUT", "/items/new", &req) == "put");
+    assert(req.param("id") == "new");
+    assert(route(router, "GET", "/items/new", &req) == "form");
+    
+    std::cout << "✅ 405 Method Not Allowed正确" << std::endl;
+}
+
+// 测试3：公共前缀导致节点分裂
+void testSplit() {
+    HttpRouter router;
+    const char* paths[] = {
+        "/search", "/support", "/blog/:post", "/blog", "/about-us", "/about",
+        "/s", "/src/*file", "/api/v1/users", "/api/v2/users", "/api/v1/user",
+    };
+    for (const char* path : paths) {
+        router.GET(path, reply(path));
+    }
+    
+    HttpRequest req;
+    assert(route(router, "GET", "/search", &req) == "/search");
+    assert(route(router, "GET", "/support", &req) == "/support");
+    assert(route(router, "GET", "/s", &req) == "/s");
+    assert(route(router, "GET", "/src/a/b.c", &req) == "/src/*file");
+    assert(req.param("file") == "a/b.c");
+    assert(route(router, "GET", "/blog", &req) == "/blog");
+    assert(route(router, "GET", "/blog/hi", &req) == "/blog/:post");
+    assert(route(router, "GET", "/about", &req) == "/about");
+    assert(route(router, "GET", "/about-us", &req) == "/about-us");
+    assert(route(router, "GET", "/api/v1/user", &req) == "/api/v1/user");
+    assert(route(router, "GET", "/api/v1/users", &req) == "/api/v1/users");
+    assert(route(router, "GET", "/api/v2/users", &req) == "/api/v2/users");
+    assert(route(router, "GET", "/api/v2/user", &req) == "<none>");
+    assert(route(router, "GET", "/se", &req) == "<none>");
+    
+    std::cout << "✅ 节点分裂后路由正确" << std::endl;
+}
+
+// 测试4：匹配过程不分配内存
+void testNoAllocation() {
+    HttpRouter router;
+    router.GET("/users/:id/posts/:post", reply("post"));
+    router.GET("/static/*filepath", reply("static"));
+    
+    std::string path1 = "/users/42/posts/7";
+    std::string path2 = "/static/js/app.js";
+    HttpRequest req;
+    
+    size_t before = g_allocations;
+    for (int i = 0; i < 1000; ++i) {
+        makeRequest(&req, "GET", (i & 1) ? path1 : path2);
+        assert(router.match(&req) != nullptr);
+    }
+    size_t allocations = g_allocations - before;
+    std::cout << "1000次匹配的堆分配次数: " << allocations << std::endl;
+    assert(allocations == 0);
+    
+    std::cout << "✅ 匹配时零分配" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 测试HttpRouter ===" << std::endl;
+    testMatch();
+    testMethodNotAllowed();
+    testSplit();
+    testNoAllocation();
+    return 0;
+}
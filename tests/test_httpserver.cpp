@@ -0,0 +1,111 @@
+// 测试HttpServer
+// 客户端在一个TCP段里发送多个请求（pipelining），服务器要全部处理并按顺序返回
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "EventLoop.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <cassert>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cstring>
+
+const int kPort = 18081;
+
+// 连接到测试服务器（阻塞socket）
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 读到对端关闭或出现期望的内容为止
+std::string readUntil(int fd, const std::string& needle, int count) {
+    std::string data;
+    char buf[4096];
+    while (true) {
+        int found = 0;
+        for (size_t pos = data.find(needle); pos != std::string::npos;
+             pos = data.find(needle, pos + 1)) {
+            ++found;
+        }
+        if (found >= count) {
+            break;
+        }
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n <= 0) {
+            break;
+        }
+        data.append(buf, n);
+    }
+    return data;
+}
+
+// 测试1：pipelining，5个请求一次发出，响应按顺序返回
+void testPipelining() {
+    int fd = connectServer();
+    assert(fd >= 0);
+    
+    std::string requests;
+    for (int i = 1; i <= 5; ++i) {
+        requests += "GET /echo/" + std::to_string(i) + " HTTP/1.1\r\nHost: test\r\n\r\n";
+    }
+    // POST请求体也不能打乱后面的请求
+    requests += "POST /echo/6 HTTP/1.1\r\nContent-Length: 4\r\n\r\nbody";
+    requests += "GET /echo/7 HTTP/1.1\r\nConnection: close\r\n\r\n";
+    ::write(fd, requests.data(), requests.size());
+    
+    std::string responses = readUntil(fd, "HTTP/1.1 200", 7);
+    ::close(fd);
+    
+    // 响应顺序和请求顺序一致
+    size_t pos = 0;
+    for (int i = 1; i <= 7; ++i) {
+        std::string body = "path=/echo/" + std::to_string(i);
+        size_t found = responses.find(body, pos);
+        assert(found != std::string::npos);
+        pos = found + body.size();
+    }
+    assert(responses.find("body=body") != std::string::npos);
+    std::cout << "✅ 7个pipelined请求全部按顺序返回" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 测试HttpServer ===" << std::endl;
+    
+    EventLoop loop;
+    HttpServer server(&loop, "TestHttpServer", kPort);
+    server.setHttpCallback([](const HttpRequest& req, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStatusMessage("OK");
+        resp->setContentType("text/plain");
+        std::string body = "path=" + req.path().as_string();
+        if (!req.body().empty()) {
+            body += " body=" + req.body().as_string();
+        }
+        resp->setBody(body);
+    });
+    server.start();
+    
+    std::thread client([&loop]() {
+        testPipelining();
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    return 0;
+}
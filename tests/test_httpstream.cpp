@@ -0,0 +1,451 @@
+// 测试流式响应体（HttpResponse::setStream + HttpResponseStream）
+// 1. 分块编码：多次write之后finish，同一个连接上pipelining的下一个请求排在后面
+// 2. 已知长度：Content-Length，不加分块编码；长度不符时关闭连接
+// 3. 生成器 + 流量控制：客户端不读时服务器停在高水位附近，读完之后内容完整
+// 4. 文件作为一个chunk（sendfile），和内存数据交错
+// 5. 在其他线程write/finish
+// 6. HTTP/1.0：长度未知时不用分块编码，发完关闭连接
+// 7. HEAD：只有头部，不调用StreamCallback
+// 8. 没有finish就丢掉stream、客户端中途断开
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "HttpResponseStream.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const int kPort = 18094;
+const size_t kLargeSize = 32 * 1024 * 1024;
+
+std::atomic<uint64_t> g_generated(0);      // 生成器已经生成的字节数
+std::atomic<int> g_headCalls(0);           // HEAD请求时StreamCallback被调用的次数
+std::string g_filePath;
+
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void writeAll(int fd, const std::string& data) {
+    size_t n = 0;
+    while (n < data.size()) {
+        ssize_t w = ::write(fd, data.data() + n, data.size() - n);
+        assert(w > 0);
+        n += w;
+    }
+}
+
+// 至少读到n字节，连接关闭返回false
+bool fill(int fd, std::string* pending, size_t n) {
+    while (pending->size() < n) {
+        char buf[65536];
+        ssize_t r = ::read(fd, buf, sizeof buf);
+        if (r <= 0) {
+            return false;
+        }
+        pending->append(buf, r);
+    }
+    return true;
+}
+
+struct Response {
+    int status;
+    std::string headers;
+    std::string body;
+    bool complete;  // 响应体完整（分块编码读到了最后的0长度chunk，或者读够了Content-Length）
+};
+
+// 读一个响应：Content-Length、分块编码、或者读到连接关闭
+Response readResponse(int fd, std::string* pending, bool headOnly = false) {
+    Response resp;
+    resp.complete = false;
+    size_t end;
+    while ((end = pending->find("\r\n\r\n")) == std::string::npos) {
+        if (!fill(fd, pending, pending->size() + 1)) {
+            resp.status = 0;
+            return resp;
+        }
+    }
+    resp.headers = pending->substr(0, end + 4);
+    resp.status = atoi(resp.headers.c_str() + 9);
+    pending->erase(0, end + 4);
+    if (headOnly) {
+        resp.complete = true;
+        return resp;
+    }
+    
+    size_t pos = resp.headers.find("Content-Length: ");
+    if (pos != std::string::npos) {
+        size_t length = atoi(resp.headers.c_str() + pos + 16);
+        resp.complete = fill(fd, pending, length);
+        resp.body = pending->substr(0, length);
+        pending->erase(0, resp.body.size());
+    } else if (resp.headers.find("Transfer-Encoding: chunked\r\n") != std::string::npos) {
+        while (true) {
+            size_t lineEnd;
+            while ((lineEnd = pending->find("\r\n")) == std::string::npos) {
+                if (!fill(fd, pending, pending->size() + 1)) {
+                    return resp;
+                }
+            }
+            size_t size = strtoul(pending->c_str(), nullptr, 16);
+            if (!fill(fd, pending, lineEnd + 2 + size + 2)) {
+                return resp;
+            }
+            assert(pending->compare(lineEnd + 2 + size, 2, "\r\n") == 0);
+            resp.body.append(*pending, lineEnd + 2, size);
+            pending->erase(0, lineEnd + 2 + size + 2);
+            if (size == 0) {
+                resp.complete = true;
+                break;
+            }
+        }
+    } else {
+        // 以关闭连接结束
+        char buf[65536];
+        ssize_t r;
+        while ((r = ::read(fd, buf, sizeof buf)) > 0) {
+            pending->append(buf, r);
+        }
+        resp.body.swap(*pending);
+        pending->clear();
+        resp.complete = true;
+    }
+    return resp;
+}
+
+bool peerClosed(int fd) {
+    char c;
+    return ::read(fd, &c, 1) == 0;
+}
+
+// 第i个字节的内容（检查大响应体的每一个字节）
+char patternAt(size_t i) {
+    return static_cast<char>('a' + (i * 7 + i / 4096) % 26);
+}
+
+// 测试1：分块编码
+void testChunked() {
+    std::cout << "\n[测试1] 分块编码" << std::endl;
+    
+    int fd = connectServer();
+    writeAll(fd, "GET /chunks HTTP/1.1\r\nHost: test\r\n\r\n"
+                 "GET /plain HTTP/1.1\r\nHost: test\r\n\r\n");
+    std::string pending;
+    Response resp = readResponse(fd, &pending);
+    assert(resp.status == 200 && resp.complete);
+    assert(resp.headers.find("Transfer-Encoding: chunked\r\n") != std::string::npos);
+    assert(resp.headers.find("Content-Length") == std::string::npos);
+    assert(resp.headers.find("X-Stream: yes\r\n") != std::string::npos);
+    assert(resp.body == "hello, " + std::string(10000, 'x') + "world");
+    
+    // 流式响应发完之后才处理下一个请求
+    resp = readResponse(fd, &pending);
+    assert(resp.status == 200 && resp.body == "plain");
+    ::close(fd);
+    std::cout << "  ✓ 分块的响应体完整，pipelining顺序正确" << std::endl;
+}
+
+// 测试2：已知长度
+void testContentLength() {
+    std::cout << "\n[测试2] Content-Length" << std::endl;
+    
+    int fd = connectServer();
+    std::string pending;
+    writeAll(fd, "GET /length HTTP/1.1\r\nHost: test\r\n\r\n");
+    Response resp = readResponse(fd, &pending);
+    assert(resp.status == 200 && resp.complete);
+    assert(resp.headers.find("Content-Length: 10\r\n") != std::string::npos);
+    assert(resp.headers.find("Transfer-Encoding") == std::string::npos);
+    assert(resp.body == "0123456789");
+    
+    // keep-alive
+    writeAll(fd, "GET /plain HTTP/1.1\r\nHost: test\r\n\r\n");
+    assert(readResponse(fd, &pending).body == "plain");
+    
+    // 声明10字节只写了5字节：连接被关闭，客户端能发现响应体不完整
+    writeAll(fd, "GET /short HTTP/1.1\r\nHost: test\r\n\r\n");
+    resp = readResponse(fd, &pending);
+    assert(resp.status == 200 && !resp.complete);
+    ::close(fd);
+    std::cout << "  ✓ 长度正确时保持连接，长度不符时关闭" << std::endl;
+}
+
+// 测试3：生成器和流量控制
+void testBackpressure() {
+    std::cout << "\n[测试3] 生成器 + 流量控制" << std::endl;
+    
+    int fd = connectServer();
+    int rcvbuf = 64 * 1024;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+    writeAll(fd, "GET /large HTTP/1.1\r\nHost: test\r\n\r\n");
+    
+    // 客户端先不读：服务器只能生成socket缓冲区加一个高水位左右的数据
+    ::usleep(300 * 1000);
+    uint64_t generated = g_generated;
+    std::cout << "  客户端不读时已经生成 " << generated / 1024 << "KB / " << kLargeSize / 1024 << "KB" << std::endl;
+    assert(generated > 0 && generated < kLargeSize / 4);
+    
+    std::string pending;
+    Response resp = readResponse(fd, &pending);
+    assert(resp.status == 200 && resp.complete);
+    assert(resp.body.size() == kLargeSize);
+    for (size_t i = 0; i < resp.body.size(); ++i) {
+        if (resp.body[i] != patternAt(i)) {
+            std::cout << "  mismatch at " << i << std::endl;
+            assert(false);
+        }
+    }
+    assert(g_generated == kLargeSize);
+    
+    writeAll(fd, "GET /plain HTTP/1.1\r\nHost: test\r\n\r\n");
+    assert(readResponse(fd, &pending).body == "plain");
+    ::close(fd);
+    std::cout << "  ✓ " << kLargeSize / 1024 / 1024 << "MB响应体内容完整" << std::endl;
+}
+
+// 测试4：文件
+void testFile() {
+    std::cout << "\n[测试4] 文件chunk" << std::endl;
+    
+    int fd = connectServer();
+    std::string pending;
+    writeAll(fd, "GET /file HTTP/1.1\r\nHost: test\r\n\r\n");
+    Response resp = readResponse(fd, &pending);
+    assert(resp.status == 200 && resp.complete);
+    std::string expected = "[" + std::string(100000, 'f').substr(0, 1000) + "|" + std::string(99000, 'f') + "]";
+    assert(resp.body == expected);
+    ::close(fd);
+    std::cout << "  ✓ 内存数据和文件数据按顺序发送" << std::endl;
+}
+
+// 测试5：其他线程
+void testOtherThread() {
+    std::cout << "\n[测试5] 在其他线程写入" << std::endl;
+    
+    int fd = connectServer();
+    std::string pending;
+    writeAll(fd, "GET /thread HTTP/1.1\r\nHost: test\r\n\r\n");
+    Response resp = readResponse(fd, &pending);
+    assert(resp.status == 200 && resp.complete);
+    std::string expected;
+    for (int i = 0; i < 100; ++i) {
+        expected += "line " + std::to_string(i) + "\n";
+    }
+    assert(resp.body == expected);
+    ::close(fd);
+    std::cout << "  ✓ 100次跨线程write顺序正确" << std::endl;
+}
+
+// 测试6：HTTP/1.0
+void testHttp10() {
+    std::cout << "\n[测试6] HTTP/1.0" << std::endl;
+    
+    int fd = connectServer();
+    std::string pending;
+    writeAll(fd, "GET /chunks HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n");
+    Response resp = readResponse(fd, &pending);
+    assert(resp.status == 200);
+    assert(resp.headers.find("Transfer-Encoding") == std::string::npos);
+    assert(resp.headers.find("Connection: close\r\n") != std::string::npos);
+    assert(resp.body == "hello, " + std::string(10000, 'x') + "world");
+    ::close(fd);
+    std::cout << "  ✓ 不用分块编码，以关闭连接结束" << std::endl;
+}
+
+// 测试7：HEAD
+void testHead() {
+    std::cout << "\n[测试7] HEAD" << std::endl;
+    
+    int fd = connectServer();
+    std::string pending;
+    writeAll(fd, "HEAD /head HTTP/1.1\r\nHost: test\r\n\r\n");
+    Response resp = readResponse(fd, &pending, true);
+    assert(resp.status == 200);
+    assert(resp.headers.find("Transfer-Encoding: chunked\r\n") != std::string::npos);
+    writeAll(fd, "GET /plain HTTP/1.1\r\nHost: test\r\n\r\n");
+    assert(readResponse(fd, &pending).body == "plain");
+    assert(g_headCalls == 0);
+    ::close(fd);
+    std::cout << "  ✓ 只有头部，StreamCallback没有被调用" << std::endl;
+}
+
+// 测试8：异常情况
+void testAbort() {
+    std::cout << "\n[测试8] 丢掉的stream、中途断开的客户端" << std::endl;
+    
+    // 没有finish()就丢掉了stream：连接被断开
+    int fd = connectServer();
+    std::string pending;
+    writeAll(fd, "GET /drop HTTP/1.1\r\nHost: test\r\n\r\n");
+    Response resp = readResponse(fd, &pending);
+    assert(resp.status == 200 && !resp.complete);
+    ::close(fd);
+    
+    // 客户端读了一部分就断开：生成器不再被调用
+    g_generated = 0;
+    fd = connectServer();
+    writeAll(fd, "GET /large HTTP/1.1\r\nHost: test\r\n\r\n");
+    pending.clear();
+    assert(fill(fd, &pending, 1024 * 1024));
+    ::close(fd);
+    ::usleep(200 * 1000);
+    uint64_t generated = g_generated;
+    ::usleep(200 * 1000);
+    assert(g_generated == generated && generated < kLargeSize);
+    
+    // 服务器正常
+    fd = connectServer();
+    pending.clear();
+    writeAll(fd, "GET /plain HTTP/1.1\r\nHost: test\r\n\r\n");
+    assert(readResponse(fd, &pending).body == "plain");
+    ::close(fd);
+    std::cout << "  ✓ 连接断开，生成器停在 " << generated / 1024 << "KB" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 测试流式响应体 ===" << std::endl;
+    Logger::setLogLevel(Logger::WARN);
+    
+    // 测试4用的文件
+    char path[] = "/tmp/test_httpstream_XXXXXX";
+    int tmp = ::mkstemp(path);
+    assert(tmp >= 0);
+    std::string content(100000, 'f');
+    ssize_t rc = ::write(tmp, content.data(), content.size());
+    assert(rc == static_cast<ssize_t>(content.size()));
+    (void)rc;
+    ::close(tmp);
+    g_filePath = path;
+    
+    EventLoop loop;
+    HttpServer server(&loop, "TestHttpStream", kPort);
+    
+    server.router().GET("/plain", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setBody("plain");
+    });
+    server.router().GET("/chunks", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->addHeader("X-Stream", "yes");
+        resp->setStream([](const HttpResponseStreamPtr& stream) {
+            assert(stream->write("hello, "));
+            assert(stream->write(""));  // 空数据不会变成结束标记
+            assert(stream->write(std::string(10000, 'x')));  // 大块数据不拷贝
+            assert(stream->write("world"));
+            stream->finish();
+            assert(!stream->write("after finish"));
+        });
+    });
+    server.router().GET("/length", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStream([](const HttpResponseStreamPtr& stream) {
+            stream->write("01234");
+            stream->write("56789");
+            stream->finish();
+        }, 10);
+    });
+    server.router().GET("/short", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStream([](const HttpResponseStreamPtr& stream) {
+            stream->write("01234");
+            stream->finish();
+        }, 10);
+    });
+    server.router().GET("/large", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStream([](const HttpResponseStreamPtr& stream) {
+            g_generated = 0;
+            std::shared_ptr<size_t> offset = std::make_shared<size_t>(0);
+            // 一次生成一行（1000字节），由stream攒成大chunk
+            stream->pull([offset](std::string* chunk) {
+                size_t n = std::min<size_t>(1000, kLargeSize - *offset);
+                for (size_t i = 0; i < n; ++i) {
+                    chunk->push_back(patternAt(*offset + i));
+                }
+                *offset += n;
+                g_generated += n;
+                return *offset < kLargeSize;
+            });
+        });
+    });
+    server.router().GET("/file", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStream([](const HttpResponseStreamPtr& stream) {
+            stream->write("[");
+            stream->sendFile(::open(g_filePath.c_str(), O_RDONLY), 0, 1000);
+            stream->write("|");
+            stream->sendFile(::open(g_filePath.c_str(), O_RDONLY), 1000, 99000);
+            stream->write("]");
+            stream->finish();
+        });
+    });
+    server.router().GET("/thread", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStream([](const HttpResponseStreamPtr& stream) {
+            std::thread([stream]() {
+                for (int i = 0; i < 100; ++i) {
+                    stream->write("line " + std::to_string(i) + "\n");
+                }
+                stream->finish();
+            }).detach();
+        });
+    });
+    server.router().GET("/head", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStream([](const HttpResponseStreamPtr& stream) {
+            ++g_headCalls;
+            stream->finish();
+        });
+    });
+    server.router().GET("/drop", [](const HttpRequest&, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setStream([](const HttpResponseStreamPtr& stream) {
+            stream->write("partial");
+        });
+    });
+    server.start();
+    
+    std::thread client([&]() {
+        ::usleep(100 * 1000);
+        testChunked();
+        testContentLength();
+        testBackpressure();
+        testFile();
+        testOtherThread();
+        testHttp10();
+        testHead();
+        testAbort();
+        
+        std::cout << "\n=== 所有测试通过 ===" << std::endl;
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    ::unlink(g_filePath.c_str());
+    return 0;
+}
@@ -0,0 +1,395 @@
+// 测试HttpServer的超时和头部限制
+// 1. 头部限制：请求行太长414，头部太大431，头部太多431
+// 2. 几千个连上之后什么都不发的连接：头部超时之后全部被关闭
+// 3. 几千个slowloris连接（头部一个字节一个字节地发）：头部超时之后收到408并被关闭
+// 4. 请求体超时：请求体停住返回408，慢慢发但间隔不超时的请求体正常处理
+// 5. keep-alive空闲超时：空闲的连接被关闭，一直有请求的连接不受影响
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "EventLoop.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const int kPort = 18090;
+const int kConnections = 2000;
+const double kHeaderTimeout = 1.0;
+const double kBodyTimeout = 0.5;
+const double kIdleTimeout = 0.5;
+
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void writeAll(int fd, const std::string& data) {
+    size_t n = 0;
+    while (n < data.size()) {
+        ssize_t w = ::write(fd, data.data() + n, data.size() - n);
+        assert(w > 0);
+        n += w;
+    }
+}
+
+// 读一个响应（只有头部和Content-Length的响应体），返回状态码，连接关闭返回0
+int readResponse(int fd, std::string* pending) {
+    size_t end;
+    while ((end = pending->find("\r\n\r\n")) == std::string::npos) {
+        char buf[4096];
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n <= 0) {
+            return 0;
+        }
+        pending->append(buf, n);
+    }
+    size_t pos = pending->find("Content-Length: ");
+    size_t length = pos < end ? atoi(pending->c_str() + pos + 16) : 0;
+    while (pending->size() < end + 4 + length) {
+        char buf[4096];
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        assert(n > 0);
+        pending->append(buf, n);
+    }
+    int status = atoi(pending->c_str() + 9);
+    pending->erase(0, end + 4 + length);
+    return status;
+}
+
+// 读到EOF，返回期间收到的数据
+std::string readUntilEof(int fd) {
+    std::string data;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof buf)) > 0) {
+        data.append(buf, n);
+    }
+    return data;
+}
+
+// 这个进程打开的fd数量（服务器和客户端在同一个进程里）
+int countOpenFds() {
+    int count = 0;
+    DIR* dir = ::opendir("/proc/self/fd");
+    assert(dir);
+    while (::readdir(dir)) {
+        ++count;
+    }
+    ::closedir(dir);
+    return count;
+}
+
+// 等到fd数量降到expect（服务器关闭连接是在它自己的线程里）
+bool waitOpenFds(int expect, double seconds) {
+    Timestamp start = Timestamp::now();
+    while (timeDifference(Timestamp::now(), start) < seconds) {
+        if (countOpenFds() <= expect) {
+            return true;
+        }
+        ::usleep(10 * 1000);
+    }
+    return false;
+}
+
+// 同时等待所有连接被服务器关闭，trickle不为空时每100ms给每个还没关闭的连接写一个字节
+// 每个连接收到的数据放在received里，返回全部关闭用的秒数
+double waitAllClosed(const std::vector<int>& fds, std::vector<std::string>* received,
+                     const std::string& trickle, double limit) {
+    std::vector<struct pollfd> pfds(fds.size());
+    for (size_t i = 0; i < fds.size(); ++i) {
+        pfds[i].fd = fds[i];
+        pfds[i].events = POLLIN;
+    }
+    received->assign(fds.size(), std::string());
+    std::vector<size_t> written(fds.size(), 0);
+    size_t remaining = fds.size();
+    
+    Timestamp start = Timestamp::now();
+    Timestamp lastTrickle = start;
+    while (remaining > 0) {
+        double elapsed = timeDifference(Timestamp::now(), start);
+        assert(elapsed < limit);
+        
+        if (!trickle.empty() && timeDifference(Timestamp::now(), lastTrickle) >= 0.1) {
+            lastTrickle = Timestamp::now();
+            for (size_t i = 0; i < fds.size(); ++i) {
+                if (pfds[i].fd >= 0) {
+                    // 服务器已经关闭写端时会失败，不用管
+                    ::write(fds[i], trickle.data() + written[i] % trickle.size(), 1);
+                    ++written[i];
+                }
+            }
+        }
+        
+        int n = ::poll(pfds.data(), pfds.size(), 20);
+        for (size_t i = 0; n > 0 && i < pfds.size(); ++i) {
+            if (pfds[i].fd < 0 || pfds[i].revents == 0) {
+                continue;
+            }
+            --n;
+            char buf[4096];
+            ssize_t r = ::read(fds[i], buf, sizeof buf);
+            if (r > 0) {
+                (*received)[i].append(buf, r);
+            } else {
+                pfds[i].fd = -1;
+                --remaining;
+            }
+        }
+    }
+    return timeDifference(Timestamp::now(), start);
+}
+
+// 建立count个连接，每个连接先发送prefix
+// 每100个停一下让服务器accept（监听队列只有128）
+std::vector<int> connectMany(int count, const std::string& prefix) {
+    std::vector<int> fds;
+    for (int i = 0; i < count; ++i) {
+        if (i % 100 == 0) {
+            ::usleep(10 * 1000);
+        }
+        int fd = connectServer();
+        assert(fd >= 0);
+        if (!prefix.empty()) {
+            writeAll(fd, prefix);
+        }
+        fds.push_back(fd);
+    }
+    return fds;
+}
+
+void closeAll(std::vector<int>* fds) {
+    for (int fd : *fds) {
+        ::close(fd);
+    }
+    fds->clear();
+}
+
+// 测试1：头部限制（服务器设置了4KB、16个头部）
+void testHeaderLimits() {
+    std::cout << "\n[测试1] 头部大小和数量限制" << std::endl;
+    
+    std::string pending;
+    
+    // 正常的请求
+    int fd = connectServer();
+    writeAll(fd, "GET /hello HTTP/1.1\r\nHost: test\r\n\r\n");
+    assert(readResponse(fd, &pending) == 200);
+    
+    // 请求行太长（完整的和还没收完的都一样）
+    writeAll(fd, "GET /" + std::string(5000, 'a') + " HTTP/1.1\r\nHost: test\r\n\r\n");
+    assert(readResponse(fd, &pending) == 414);
+    assert(readUntilEof(fd).empty());
+    ::close(fd);
+    
+    fd = connectServer();
+    writeAll(fd, "GET /" + std::string(5000, 'a'));
+    assert(readResponse(fd, &pending) == 414);
+    ::close(fd);
+    
+    // 头部太大：每一行都不长，加起来超过上限
+    std::string request = "GET /hello HTTP/1.1\r\nHost: test\r\n";
+    for (int i = 0; i < 10; ++i) {
+        request += "X-Large-" + std::to_string(i) + ": " + std::string(500, 'v') + "\r\n";
+    }
+    fd = connectServer();
+    writeAll(fd, request + "\r\n");
+    assert(readResponse(fd, &pending) == 431);
+    ::close(fd);
+    
+    // 头部太多
+    request = "GET /hello HTTP/1.1\r\nHost: test\r\n";
+    for (int i = 0; i < 16; ++i) {
+        request += "X-Header-" + std::to_string(i) + ": v\r\n";
+    }
+    fd = connectServer();
+    writeAll(fd, request + "\r\n");
+    assert(readResponse(fd, &pending) == 431);
+    ::close(fd);
+    
+    // 刚好16个头部没问题
+    request = "GET /hello HTTP/1.1\r\n";
+    for (int i = 0; i < 16; ++i) {
+        request += "X-Header-" + std::to_string(i) + ": v\r\n";
+    }
+    fd = connectServer();
+    writeAll(fd, request + "\r\n");
+    assert(readResponse(fd, &pending) == 200);
+    ::close(fd);
+    std::cout << "  ✓ 414/431正确" << std::endl;
+}
+
+// 测试2：连上之后什么都不发
+void testSilentConnections(int baseline) {
+    std::cout << "\n[测试2] " << kConnections << "个不发数据的连接" << std::endl;
+    
+    std::vector<int> fds = connectMany(kConnections, std::string());
+    
+    std::vector<std::string> received;
+    double elapsed = waitAllClosed(fds, &received, std::string(), kHeaderTimeout + 3);
+    for (const std::string& data : received) {
+        assert(data.empty());  // 没有请求，直接关闭
+    }
+    
+    // 客户端的fd还开着，服务器那一端已经全部关闭
+    assert(waitOpenFds(baseline + kConnections, 2));
+    closeAll(&fds);
+    std::cout << "  ✓ " << elapsed << "秒内全部关闭" << std::endl;
+}
+
+// 测试3：slowloris
+void testSlowloris(int baseline) {
+    std::cout << "\n[测试3] " << kConnections << "个slowloris连接" << std::endl;
+    
+    std::vector<int> fds = connectMany(kConnections, "GET /hello HTTP/1.1\r\nHost: test\r\n");
+    
+    // 每个连接每100ms发一个字节，头部永远收不完
+    std::vector<std::string> received;
+    double elapsed = waitAllClosed(fds, &received, "X-Slow: 1\r\n", kHeaderTimeout + 3);
+    for (const std::string& data : received) {
+        assert(data.compare(0, 30, "HTTP/1.1 408 Request Timeout\r\n") == 0);
+        assert(data.find("Connection: close\r\n") != std::string::npos);
+    }
+    
+    // 服务器关闭了写端，客户端关闭之后服务器那一端也关闭
+    closeAll(&fds);
+    assert(waitOpenFds(baseline, 2));
+    std::cout << "  ✓ " << elapsed << "秒内全部收到408并关闭" << std::endl;
+}
+
+// 测试4：请求体超时
+void testBodyTimeout() {
+    std::cout << "\n[测试4] 请求体超时" << std::endl;
+    
+    std::string pending;
+    
+    // 请求体停住
+    int fd = connectServer();
+    Timestamp start = Timestamp::now();
+    writeAll(fd, "POST /echo HTTP/1.1\r\nHost: test\r\nContent-Length: 10\r\n\r\n12345");
+    assert(readResponse(fd, &pending) == 408);
+    double elapsed = timeDifference(Timestamp::now(), start);
+    assert(elapsed >= kBodyTimeout - 0.05 && elapsed < kBodyTimeout + 0.5);
+    assert(readUntilEof(fd).empty());
+    ::close(fd);
+    
+    // 每个字节间隔小于请求体超时，总时间超过头部超时也没关系
+    fd = connectServer();
+    writeAll(fd, "POST /echo HTTP/1.1\r\nHost: test\r\nContent-Length: 8\r\n\r\n");
+    for (int i = 0; i < 8; ++i) {
+        ::usleep(200 * 1000);
+        writeAll(fd, std::string(1, static_cast<char>('a' + i)));
+    }
+    assert(readResponse(fd, &pending) == 200);
+    ::close(fd);
+    std::cout << "  ✓ 停住的请求体408，慢但持续的请求体正常" << std::endl;
+}
+
+// 测试5：keep-alive空闲超时
+void testIdleTimeout() {
+    std::cout << "\n[测试5] keep-alive空闲超时" << std::endl;
+    
+    std::string pending;
+    
+    // 一直有请求：总时间远超空闲超时，连接不会被关闭
+    int fd = connectServer();
+    for (int i = 0; i < 10; ++i) {
+        writeAll(fd, "GET /hello HTTP/1.1\r\nHost: test\r\n\r\n");
+        assert(readResponse(fd, &pending) == 200);
+        ::usleep(200 * 1000);
+    }
+    
+    // 停下来之后空闲超时关闭，不发任何响应
+    Timestamp start = Timestamp::now();
+    assert(readUntilEof(fd).empty());
+    double elapsed = timeDifference(Timestamp::now(), start);
+    assert(elapsed >= kIdleTimeout - 0.25 && elapsed < kIdleTimeout + 0.5);
+    ::close(fd);
+    
+    // 空闲期间开始了一个新请求：按头部超时计算，而不是空闲超时
+    fd = connectServer();
+    writeAll(fd, "GET /hello HTTP/1.1\r\nHost: test\r\n\r\n");
+    assert(readResponse(fd, &pending) == 200);
+    start = Timestamp::now();
+    writeAll(fd, "GET /hello HTTP/1.1\r\n");
+    assert(readResponse(fd, &pending) == 408);
+    elapsed = timeDifference(Timestamp::now(), start);
+    assert(elapsed >= kHeaderTimeout - 0.05 && elapsed < kHeaderTimeout + 0.5);
+    ::close(fd);
+    std::cout << "  ✓ 空闲连接被关闭，空闲期间开始的请求按头部超时处理" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 测试HTTP超时 ===" << std::endl;
+    
+    // 服务器和客户端两端一共要4000多个fd
+    struct rlimit limit;
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    if (limit.rlim_cur < 2 * kConnections + 100) {
+        limit.rlim_cur = std::min<rlim_t>(limit.rlim_max, 2 * kConnections + 100);
+        ::setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    if (limit.rlim_cur < 2 * kConnections + 100) {
+        std::cout << "需要" << 2 * kConnections + 100 << "个fd，当前上限" << limit.rlim_cur << std::endl;
+        return 1;
+    }
+    ::signal(SIGPIPE, SIG_IGN);
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    HttpServer server(&loop, "TestHttpTimeout", kPort);
+    server.setHeaderTimeout(kHeaderTimeout);
+    server.setBodyTimeout(kBodyTimeout);
+    server.setIdleTimeout(kIdleTimeout);
+    server.setMaxHeaderSize(4096);
+    server.setMaxHeaderCount(16);
+    server.setHttpCallback([](const HttpRequest& req, HttpResponse* resp) {
+        resp->setStatusCode(HttpResponse::k200Ok);
+        resp->setContentType("text/plain");
+        resp->setBody(req.body().as_string());
+    });
+    server.start();
+    
+    std::thread client([&]() {
+        ::usleep(100 * 1000);
+        int baseline = countOpenFds();
+        
+        testHeaderLimits();
+        testSilentConnections(baseline);
+        testSlowloris(baseline);
+        testBodyTimeout();
+        testIdleTimeout();
+        
+        std::cout << "\n=== 所有测试通过 ===" << std::endl;
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -1,6 +1,114 @@
 #include <iostream>
+#include <string>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
 #include "InetAddress.h"
 
+// 用inet_ntop和snprintf格式化，作为toIpPort()的对照
+std::string referenceIpPort(const InetAddress& addr) {
+    char ip[INET6_ADDRSTRLEN];
+    char buf[InetAddress::kMaxIpPortLength];
+    if (addr.isIpv6()) {
+        const struct sockaddr_in6* sa = reinterpret_cast<const struct sockaddr_in6*>(addr.getSockAddr());
+        inet_ntop(AF_INET6, &sa->sin6_addr, ip, sizeof ip);
+        snprintf(buf, sizeof buf, "[%s]:%u", ip, addr.toPort());
+    } else {
+        const struct sockaddr_in* sa = reinterpret_cast<const struct sockaddr_in*>(addr.getSockAddr());
+        inet_ntop(AF_INET, &sa->sin_addr, ip, sizeof ip);
+        snprintf(buf, sizeof buf, "%s:%u", ip, addr.toPort());
+    }
+    return buf;
+}
+
+// 两个版本的toIpPort()结果相同，返回值是长度
+void checkIpPort(const InetAddress& addr, const std::string& expected) {
+    char buf[InetAddress::kMaxIpPortLength];
+    size_t n = addr.toIpPort(buf, sizeof buf);
+    assert(addr.toIpPort() == expected);
+    assert(n == expected.size() && std::string(buf) == expected);
+    assert(referenceIpPort(addr) == expected);
+}
+
+void testIpv4Format() {
+    std::cout << "\n[测试] IPv4格式化" << std::endl;
+    checkIpPort(InetAddress("192.168.1.10", 8080), "192.168.1.10:8080");
+    checkIpPort(InetAddress("0.0.0.0", 0), "0.0.0.0:0");
+    checkIpPort(InetAddress("255.255.255.255", 65535), "255.255.255.255:65535");
+    checkIpPort(InetAddress(9000, true), "127.0.0.1:9000");
+    assert(InetAddress("10.0.0.1", 1).toIp() == "10.0.0.1");
+    assert(InetAddress(80).getSockLen() == sizeof(struct sockaddr_in));
+    
+    // 随机地址和inet_ntop的结果一致
+    srand(12345);
+    for (int i = 0; i < 10000; ++i) {
+        struct sockaddr_in sa;
+        memset(&sa, 0, sizeof sa);
+        sa.sin_family = AF_INET;
+        sa.sin_addr.s_addr = static_cast<uint32_t>(rand()) ^ (static_cast<uint32_t>(rand()) << 16);
+        sa.sin_port = static_cast<uint16_t>(rand());
+        InetAddress addr(sa);
+        checkIpPort(addr, referenceIpPort(addr));
+    }
+    std::cout << "  ✓ 和inet_ntop+snprintf的结果一致" << std::endl;
+}
+
+void testIpv6Format() {
+    std::cout << "\n[测试] IPv6格式化" << std::endl;
+    InetAddress loopback("::1", 80);
+    assert(loopback.isIpv6() && loopback.family() == AF_INET6);
+    assert(loopback.getSockLen() == sizeof(struct sockaddr_in6));
+    assert(loopback.toIp() == "::1" && loopback.toPort() == 80);
+    checkIpPort(loopback, "[::1]:80");
+    
+    // 带方括号的写法，零段压缩
+    checkIpPort(InetAddress("[fe80::1]", 443), "[fe80::1]:443");
+    checkIpPort(InetAddress("2001:db8:0:0:0:0:0:1", 8080), "[2001:db8::1]:8080");
+    checkIpPort(InetAddress(53, false, true), "[::]:53");
+    checkIpPort(InetAddress(53, true, true), "[::1]:53");
+    checkIpPort(InetAddress("::ffff:127.0.0.1", 1234), "[::ffff:127.0.0.1]:1234");
+    
+    // 最长的地址也放得下
+    std::string longest = "[ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff]:65535";
+    checkIpPort(InetAddress("ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff", 65535), longest);
+    std::cout << "  ✓ [ip]:端口，最长" << longest.size() << "字节" << std::endl;
+}
+
+void testSockAddrIn6() {
+    std::cout << "\n[测试] 从sockaddr_in6构造" << std::endl;
+    // accept()用sockaddr_in6接收，对端是IPv4时按sockaddr_in解释
+    struct sockaddr_in6 storage;
+    memset(&storage, 0, sizeof storage);
+    struct sockaddr_in* v4 = reinterpret_cast<struct sockaddr_in*>(&storage);
+    v4->sin_family = AF_INET;
+    v4->sin_port = htons(7000);
+    inet_pton(AF_INET, "172.16.0.5", &v4->sin_addr);
+    InetAddress fromV4(storage);
+    assert(!fromV4.isIpv6());
+    checkIpPort(fromV4, "172.16.0.5:7000");
+    
+    memset(&storage, 0, sizeof storage);
+    storage.sin6_family = AF_INET6;
+    storage.sin6_port = htons(7001);
+    inet_pton(AF_INET6, "fd00::2", &storage.sin6_addr);
+    InetAddress fromV6(storage);
+    assert(fromV6.isIpv6());
+    checkIpPort(fromV6, "[fd00::2]:7001");
+    std::cout << "  ✓ 按sin6_family区分" << std::endl;
+}
+
+void testTruncate() {
+    std::cout << "\n[测试] 缓冲区不够大" << std::endl;
+    char buf[5];
+    assert(InetAddress("192.168.1.10", 8080).toIpPort(buf, sizeof buf) == 4);
+    assert(std::string(buf) == "192.");
+    assert(InetAddress("::1", 80).toIpPort(buf, 1) == 0 && buf[0] == '\0');
+    assert(InetAddress("::1", 80).toIpPort(buf, 0) == 0);
+    std::cout << "  ✓ 截断并以'\\0'结尾" << std::endl;
+}
+
 int main() {
     std::cout << "测试InetAddress类" << std::endl;
     
@@ -17,5 +125,11 @@ int main() {
     std::string ip = addr.toIp();
     std::cout << "获取到的IP地址: " << ip << std::endl;
     
+    testIpv4Format();
+    testIpv6Format();
+    testSockAddrIn6();
+    testTruncate();
+    
+    std::cout << "\n=== 所有测试通过 ===" << std::endl;
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,177 @@
+// 测试IPv6和双栈监听
+// 1. 只监听IPv6：IPv6客户端能连上，IPv4客户端被拒绝
+// 2. 双栈：IPv4和IPv6客户端都能连上，IPv4的对端地址是::ffff:a.b.c.d
+// 3. 只监听IPv4：IPv6客户端被拒绝
+// 4. TcpClient连接IPv6地址
+
+#include "TcpClient.h"
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "InetAddress.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "Logger.h"
+#include "TestUtil.h"
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+EventLoop* g_loop = nullptr;
+std::mutex g_mutex;
+std::string g_lastPeer;  // 服务器看到的最近一个对端地址
+
+std::unique_ptr<TcpServer> newEchoServer(const InetAddress& addr, bool ipv6Only) {
+    std::unique_ptr<TcpServer> server(new TcpServer(g_loop, "EchoServer", addr, ipv6Only));
+    server->setMessageCallback([](const TcpServer::ConnectionPtr& conn, Buffer* buf) {
+        // accept()得到的对端地址
+        struct sockaddr_in6 peer;
+        socklen_t len = sizeof peer;
+        ::getpeername(conn->fd(), reinterpret_cast<struct sockaddr*>(&peer), &len);
+        {
+            std::lock_guard<std::mutex> lock(g_mutex);
+            g_lastPeer = InetAddress(peer).toIpPort();
+        }
+        conn->send(buf->retrieveAsString());
+    });
+    server->start();
+    return server;
+}
+
+// 阻塞连接addr，发一条消息等回显；成功返回0，连不上返回errno
+int echoOnce(const InetAddress& addr) {
+    int fd = ::socket(addr.family(), SOCK_STREAM, 0);
+    if (::connect(fd, addr.getSockAddr(), addr.getSockLen()) < 0) {
+        int err = errno;
+        ::close(fd);
+        return err;
+    }
+    ssize_t rc = ::write(fd, "ping", 4);
+    assert(rc == 4);
+    (void)rc;
+    char buf[4];
+    size_t got = 0;
+    while (got < sizeof buf) {
+        ssize_t n = ::read(fd, buf + got, sizeof buf - got);
+        assert(n > 0);
+        got += n;
+    }
+    assert(memcmp(buf, "ping", 4) == 0);
+    ::close(fd);
+    return 0;
+}
+
+std::string lastPeer() {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_lastPeer;
+}
+
+bool startsWith(const std::string& s, const std::string& prefix) {
+    return s.compare(0, prefix.size(), prefix) == 0;
+}
+
+void testIpv6Only() {
+    std::cout << "\n[测试1] 只监听IPv6" << std::endl;
+    const uint16_t port = 18220;
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() { server = newEchoServer(InetAddress("::", port), true); });
+    assert(server->ipPort() == "[::]:18220");
+    
+    assert(echoOnce(InetAddress("::1", port)) == 0);
+    assert(startsWith(lastPeer(), "[::1]:"));
+    assert(echoOnce(InetAddress("127.0.0.1", port)) == ECONNREFUSED);
+    
+    runSync([&]() { server.reset(); });
+    std::cout << "  ✓ IPv6连上（" << lastPeer() << "），IPv4被拒绝" << std::endl;
+}
+
+void testDualStack() {
+    std::cout << "\n[测试2] 双栈" << std::endl;
+    const uint16_t port = 18221;
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() { server = newEchoServer(InetAddress(port, false, true), false); });
+    
+    assert(echoOnce(InetAddress("127.0.0.1", port)) == 0);
+    std::string v4Peer = lastPeer();
+    assert(startsWith(v4Peer, "[::ffff:127.0.0.1]:"));
+    assert(echoOnce(InetAddress("::1", port)) == 0);
+    assert(startsWith(lastPeer(), "[::1]:"));
+    
+    runSync([&]() { server.reset(); });
+    std::cout << "  ✓ IPv4（" << v4Peer << "）和IPv6都能连上" << std::endl;
+}
+
+void testIpv4Only() {
+    std::cout << "\n[测试3] 只监听IPv4" << std::endl;
+    const uint16_t port = 18222;
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() { server = newEchoServer(InetAddress(port), false); });
+    assert(server->ipPort() == "0.0.0.0:18222");
+    
+    assert(echoOnce(InetAddress("127.0.0.1", port)) == 0);
+    assert(startsWith(lastPeer(), "127.0.0.1:"));
+    assert(echoOnce(InetAddress("::1", port)) == ECONNREFUSED);
+    
+    runSync([&]() { server.reset(); });
+    std::cout << "  ✓ IPv4连上，IPv6被拒绝" << std::endl;
+}
+
+void testClient() {
+    std::cout << "\n[测试4] TcpClient连接IPv6" << std::endl;
+    const uint16_t port = 18223;
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() { server = newEchoServer(InetAddress(port, true, true), true); });
+    
+    std::unique_ptr<TcpClient> client;
+    std::promise<std::string> reply;
+    runSync([&]() {
+        client.reset(new TcpClient(g_loop, InetAddress("[::1]", port), "Client6"));
+        client->setConnectionCallback([](const TcpClient::ConnectionPtr& conn) {
+            if (conn->connected()) {
+                conn->send("over ipv6");
+            }
+        });
+        client->setMessageCallback([&](const TcpClient::ConnectionPtr&, Buffer* buf) {
+            if (buf->readableBytes() >= 9) {
+                reply.set_value(buf->retrieveAsString());
+            }
+        });
+        client->connect();
+    });
+    assert(reply.get_future().get() == "over ipv6");
+    
+    runSync([&]() {
+        client.reset();
+        server.reset();
+    });
+    std::cout << "  ✓ 收发正常" << std::endl;
+}
+
+int main() {
+    std::cout << "=== IPv6 测试 ===" << std::endl;
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    g_loop = &loop;
+    
+    std::thread driver([&]() {
+        testIpv6Only();
+        testDualStack();
+        testIpv4Only();
+        testClient();
+        
+        std::cout << "\n=== 所有测试通过 ===" << std::endl;
+        loop.quit();
+    });
+    
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,199 @@
+// 测试SocketOptions
+// 1. 默认值：和原来一样，连接上没有设置任何选项
+// 2. accept之后的选项：TCP_NODELAY、SO_KEEPALIVE、TCP_USER_TIMEOUT、SO_BUSY_POLL、缓冲区大小
+// 3. TCP_DEFER_ACCEPT：客户端只连接不发数据时不会建立TcpConnection
+// 4. Unix域socket：只设置缓冲区大小，TCP选项被忽略
+
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "SocketOptions.h"
+#include "InetAddress.h"
+#include "UnixAddress.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "Logger.h"
+#include "TestUtil.h"
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <cassert>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+
+EventLoop* g_loop = nullptr;
+
+int getIntOption(int fd, int level, int name) {
+    int value = 0;
+    socklen_t len = sizeof value;
+    int rc = ::getsockopt(fd, level, name, &value, &len);
+    assert(rc == 0);
+    (void)rc;
+    return value;
+}
+
+struct Observed {
+    int noDelay;
+    int keepAlive;
+    int userTimeout;
+    int busyPoll;
+    int sendBuffer;
+    int receiveBuffer;
+};
+
+// 用options启动服务器，连上一次，返回服务器一侧连接上的选项
+Observed observe(const SocketOptions& options, uint16_t port) {
+    std::promise<Observed> result;
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() {
+        server.reset(new TcpServer(g_loop, "OptionServer", InetAddress(port)));
+        server->setSocketOptions(options);
+        server->setConnectionCallback([&](const TcpServer::ConnectionPtr& conn) {
+            if (conn->connected()) {
+                int fd = conn->fd();
+                Observed o;
+                o.noDelay = getIntOption(fd, IPPROTO_TCP, TCP_NODELAY);
+                o.keepAlive = getIntOption(fd, SOL_SOCKET, SO_KEEPALIVE);
+                o.userTimeout = getIntOption(fd, IPPROTO_TCP, TCP_USER_TIMEOUT);
+                o.busyPoll = getIntOption(fd, SOL_SOCKET, SO_BUSY_POLL);
+                o.sendBuffer = getIntOption(fd, SOL_SOCKET, SO_SNDBUF);
+                o.receiveBuffer = getIntOption(fd, SOL_SOCKET, SO_RCVBUF);
+                result.set_value(o);
+            }
+        });
+        server->start();
+    });
+    
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    InetAddress addr("127.0.0.1", port);
+    int rc = ::connect(fd, addr.getSockAddr(), addr.getSockLen());
+    assert(rc == 0);
+    (void)rc;
+    Observed o = result.get_future().get();
+    ::close(fd);
+    runSync([&]() { server.reset(); });
+    return o;
+}
+
+void testDefault() {
+    std::cout << "\n[测试1] 默认值" << std::endl;
+    SocketOptions options;
+    assert(options.backlog == 128);
+    Observed o = observe(options, 18224);
+    assert(o.noDelay == 0 && o.keepAlive == 0 && o.userTimeout == 0 && o.busyPoll == 0);
+    std::cout << "  ✓ 没有设置任何选项" << std::endl;
+}
+
+void testConnectionOptions() {
+    std::cout << "\n[测试2] accept之后的选项" << std::endl;
+    SocketOptions options = SocketOptions::lowLatency();
+    options.keepAlive = true;
+    options.userTimeoutMs = 5000;
+    options.receiveBufferSize = 1024 * 1024;
+    Observed o = observe(options, 18225);
+    assert(o.noDelay == 1 && o.keepAlive == 1 && o.userTimeout == 5000);
+    // SO_BUSY_POLL超过系统默认值需要CAP_NET_ADMIN，没有权限时只打印警告
+    if (::geteuid() == 0) {
+        assert(o.busyPoll == 50);
+    }
+    // 内核把SO_RCVBUF翻倍保存（包括管理开销），监听socket上设置的值被继承
+    assert(o.receiveBuffer >= 1024 * 1024);
+    std::cout << "  ✓ nodelay/keepalive/user timeout/busy poll/rcvbuf，接收缓冲区"
+              << o.receiveBuffer << "字节" << std::endl;
+}
+
+void testDeferAccept() {
+    std::cout << "\n[测试3] TCP_DEFER_ACCEPT" << std::endl;
+    const uint16_t port = 18226;
+    std::atomic<int> established(0);
+    std::promise<std::string> request;
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() {
+        server.reset(new TcpServer(g_loop, "DeferServer", InetAddress(port)));
+        server->setSocketOptions(SocketOptions::requestResponse());
+        server->setConnectionCallback([&](const TcpServer::ConnectionPtr& conn) {
+            if (conn->connected()) {
+                ++established;
+            }
+        });
+        server->setMessageCallback([&](const TcpServer::ConnectionPtr&, Buffer* buf) {
+            request.set_value(buf->retrieveAsString());
+        });
+        server->start();
+    });
+    
+    // 三次握手完成了，但没有数据，accept不会被唤醒
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    InetAddress addr("127.0.0.1", port);
+    int rc = ::connect(fd, addr.getSockAddr(), addr.getSockLen());
+    assert(rc == 0);
+    (void)rc;
+    ::usleep(300 * 1000);
+    assert(established == 0);
+    
+    // 请求到达之后才建立连接，而且第一次读就能读到请求
+    ssize_t n = ::write(fd, "GET", 3);
+    assert(n == 3);
+    (void)n;
+    assert(request.get_future().get() == "GET");
+    assert(established == 1);
+    ::close(fd);
+    runSync([&]() { server.reset(); });
+    std::cout << "  ✓ 请求到达之前没有建立连接" << std::endl;
+}
+
+void testUnixDomain() {
+    std::cout << "\n[测试4] Unix域socket" << std::endl;
+    std::string path = "/tmp/tiny_network_options_" + std::to_string(::getpid()) + ".sock";
+    UnixAddress addr(path);
+    SocketOptions options = SocketOptions::lowLatency();
+    options.sendBufferSize = 1024 * 1024;
+    
+    std::promise<int> sendBuffer;
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() {
+        server.reset(new TcpServer(g_loop, "UnixServer", addr));
+        server->setSocketOptions(options);
+        server->setConnectionCallback([&](const TcpServer::ConnectionPtr& conn) {
+            if (conn->connected()) {
+                sendBuffer.set_value(getIntOption(conn->fd(), SOL_SOCKET, SO_SNDBUF));
+            }
+        });
+        server->start();
+    });
+    
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    int rc = ::connect(fd, addr.getSockAddr(), addr.getSockLen());
+    assert(rc == 0);
+    (void)rc;
+    assert(sendBuffer.get_future().get() >= 1024 * 1024);
+    ::close(fd);
+    runSync([&]() { server.reset(); });
+    std::cout << "  ✓ 发送缓冲区已设置，TCP选项被忽略" << std::endl;
+}
+
+int main() {
+    std::cout << "=== SocketOptions 测试 ===" << std::endl;
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    g_loop = &loop;
+    
+    std::thread driver([&]() {
+        testDefault();
+        testConnectionOptions();
+        testDeferAccept();
+        testUnixDomain();
+        
+        std::cout << "\n=== 所有测试通过 ===" << std::endl;
+        loop.quit();
+    });
+    
+    loop.loop();
+    driver.join();
+    return 0;
+}
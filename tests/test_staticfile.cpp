@@ -0,0 +1,316 @@
+// 测试StaticFileHandler
+// 1. 小文件走缓存，大文件走sendfile，内容完全一致
+// 2. ETag/Last-Modified条件请求返回304
+// 3. Range请求返回206/416
+// 4. 文件被修改后缓存失效
+// 5. 路径穿越被拒绝，目录返回index.html，HEAD只有头部
+// 6. sendfile的响应和后面pipelined的响应顺序不乱
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "StaticFileHandler.h"
+#include "EventLoop.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <cassert>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cstring>
+
+const int kPort = 18083;
+
+struct Response {
+    int status;
+    std::string headers;
+    std::string body;
+    
+    std::string header(const std::string& name) const {
+        size_t pos = headers.find("\r\n" + name + ": ");
+        if (pos == std::string::npos) {
+            return "";
+        }
+        pos += name.size() + 4;
+        return headers.substr(pos, headers.find("\r\n", pos) - pos);
+    }
+};
+
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 从连接里读一个完整的响应，pending保存多读的数据
+Response readResponse(int fd, std::string* pending, bool head = false) {
+    char buf[65536];
+    size_t end;
+    while ((end = pending->find("\r\n\r\n")) == std::string::npos) {
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        assert(n > 0);
+        pending->append(buf, n);
+    }
+    Response resp;
+    resp.headers = pending->substr(0, end + 2);
+    resp.status = atoi(resp.headers.c_str() + 9);
+    pending->erase(0, end + 4);
+    
+    size_t length = head ? 0 : strtoul(resp.header("Content-Length").c_str(), nullptr, 10);
+    while (pending->size() < length) {
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        assert(n > 0);
+        pending->append(buf, n);
+    }
+    resp.body = pending->substr(0, length);
+    pending->erase(0, length);
+    return resp;
+}
+
+Response request(const std::string& text, bool head = false) {
+    int fd = connectServer();
+    assert(fd >= 0);
+    ::write(fd, text.data(), text.size());
+    std::string pending;
+    Response resp = readResponse(fd, &pending, head);
+    ::close(fd);
+    return resp;
+}
+
+Response get(const std::string& path, const std::string& extraHeaders = "") {
+    return request("GET " + path + " HTTP/1.1\r\nHost: test\r\n" + extraHeaders + "\r\n");
+}
+
+void writeFile(const std::string& path, const std::string& content) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+}
+
+std::string g_root;
+std::string g_small;
+std::string g_large;
+
+// 测试1：小文件和大文件
+void testServe(StaticFileHandler* files) {
+    Response resp = get("/static/hello.txt");
+    assert(resp.status == 200);
+    assert(resp.body == g_small);
+    assert(resp.header("Content-Type") == "text/plain; charset=utf-8");
+    assert(!resp.header("ETag").empty());
+    assert(!resp.header("Last-Modified").empty());
+    assert(resp.header("Accept-Ranges") == "bytes");
+    
+    // 第二次命中缓存
+    size_t hits = files->cacheHits();
+    resp = get("/static/hello.txt");
+    assert(resp.body == g_small);
+    assert(files->cacheHits() == hits + 1);
+    
+    // 大文件用sendfile，不进缓存
+    size_t cached = files->cachedBytes();
+    resp = get("/static/big.bin");
+    assert(resp.status == 200);
+    assert(resp.body == g_large);
+    assert(resp.header("Content-Type") == "application/octet-stream");
+    assert(files->cachedBytes() == cached);
+    
+    std::cout << "✅ 小文件缓存、大文件sendfile内容正确" << std::endl;
+}
+
+// 测试2：条件请求
+void testConditional() {
+    Response resp = get("/static/hello.txt");
+    std::string etag = resp.header("ETag");
+    std::string lastModified = resp.header("Last-Modified");
+    
+    resp = get("/static/hello.txt", "If-None-Match: " + etag + "\r\n");
+    assert(resp.status == 304);
+    assert(resp.body.empty());
+    assert(resp.header("ETag") == etag);
+    
+    resp = get("/static/hello.txt", "If-None-Match: \"other\", W/" + etag + "\r\n");
+    assert(resp.status == 304);
+    
+    resp = get("/static/hello.txt", "If-None-Match: \"other\"\r\n");
+    assert(resp.status == 200);
+    
+    resp = get("/static/big.bin", "If-Modified-Since: " + lastModified + "\r\n");
+    assert(resp.status == 304);
+    
+    resp = get("/static/big.bin", "If-Modified-Since: Sun, 06 Nov 1994 08:49:37 GMT\r\n");
+    assert(resp.status == 200);
+    assert(resp.body.size() == g_large.size());
+    
+    std::cout << "✅ 304 Not Modified正确" << std::endl;
+}
+
+// 测试3：Range
+void testRange() {
+    Response resp = get("/static/hello.txt", "Range: bytes=0-4\r\n");
+    assert(resp.status == 206);
+    assert(resp.body == g_small.substr(0, 5));
+    assert(resp.header("Content-Range") == "bytes 0-4/" + std::to_string(g_small.size()));
+    
+    resp = get("/static/hello.txt", "Range: bytes=-3\r\n");
+    assert(resp.status == 206);
+    assert(resp.body == g_small.substr(g_small.size() - 3));
+    
+    // 大文件的中间一段（sendfile带偏移）
+    resp = get("/static/big.bin", "Range: bytes=100000-\r\n");
+    assert(resp.status == 206);
+    assert(resp.body == g_large.substr(100000));
+    
+    resp = get("/static/big.bin", "Range: bytes=5000-5999\r\n");
+    assert(resp.body == g_large.substr(5000, 1000));
+    
+    resp = get("/static/hello.txt", "Range: bytes=1000-\r\n");
+    assert(resp.status == 416);
+    assert(resp.header("Content-Range") == "bytes */" + std::to_string(g_small.size()));
+    
+    // If-Range不匹配：返回整个文件
+    resp = get("/static/hello.txt", "Range: bytes=0-4\r\nIf-Range: \"stale\"\r\n");
+    assert(resp.status == 200);
+    assert(resp.body == g_small);
+    
+    // 多个范围：返回整个文件
+    resp = get("/static/hello.txt", "Range: bytes=0-1,3-4\r\n");
+    assert(resp.status == 200);
+    
+    std::cout << "✅ Range请求正确" << std::endl;
+}
+
+// 测试4：文件修改后缓存失效
+void testInvalidate() {
+    std::string path = g_root + "/hello.txt";
+    std::string updated = "updated content, a bit longer than before\n";
+    writeFile(path, updated);
+    Response resp = get("/static/hello.txt");
+    assert(resp.body == updated);
+    
+    // 大小相同、mtime不同也能发现
+    std::string same(updated.size(), 'x');
+    struct stat st;
+    ::stat(path.c_str(), &st);
+    writeFile(path, same);
+    struct timespec times[2] = {st.st_atim, st.st_mtim};
+    times[1].tv_sec += 10;
+    ::utimensat(AT_FDCWD, path.c_str(), times, 0);
+    resp = get("/static/hello.txt");
+    assert(resp.body == same);
+    
+    writeFile(path, g_small);
+    std::cout << "✅ 文件修改后缓存失效" << std::endl;
+}
+
+// 测试5：路径检查、目录、HEAD
+void testPaths() {
+    assert(get("/static/../test_staticfile.cpp").status == 400);
+    assert(get("/static/%2e%2e/etc/passwd").status == 400);
+    assert(get("/static/sub/%2E%2E/%2E%2E/x").status == 400);
+    assert(get("/static/missing.txt").status == 404);
+    assert(get("/static/bad%zz").status == 400);
+    
+    Response resp = get("/static/");
+    assert(resp.status == 200);
+    assert(resp.body == "<h1>index</h1>");
+    assert(resp.header("Content-Type") == "text/html; charset=utf-8");
+    resp = get("/static/sub");
+    assert(resp.body == "<p>sub</p>");
+    resp = get("/static/sub%20dir/a.json");
+    assert(resp.body == "{}");
+    assert(resp.header("Content-Type") == "application/json");
+    
+    // HEAD：Content-Length是完整长度，没有响应体
+    resp = request("HEAD /static/big.bin HTTP/1.1\r\nHost: test\r\nConnection: close\r\n\r\n", true);
+    assert(resp.status == 200);
+    assert(resp.header("Content-Length") == std::to_string(g_large.size()));
+    
+    std::cout << "✅ 路径检查、目录和HEAD正确" << std::endl;
+}
+
+// 测试6：sendfile响应夹在pipelined请求中间
+void testPipelined() {
+    int fd = connectServer();
+    std::string requests =
+        "GET /static/hello.txt HTTP/1.1\r\n\r\n"
+        "GET /static/big.bin HTTP/1.1\r\n\r\n"
+        "GET /static/hello.txt HTTP/1.1\r\n\r\n"
+        "HEAD /static/big.bin HTTP/1.1\r\n\r\n"
+        "GET /static/big.bin HTTP/1.1\r\nRange: bytes=10-19\r\n\r\n"
+        "GET /static/big.bin HTTP/1.1\r\n\r\n"
+        "GET /static/sub/ HTTP/1.1\r\n\r\n";
+    ::write(fd, requests.data(), requests.size());
+    
+    std::string pending;
+    assert(readResponse(fd, &pending).body == g_small);
+    assert(readResponse(fd, &pending).body == g_large);
+    assert(readResponse(fd, &pending).body == g_small);
+    assert(readResponse(fd, &pending, true).header("Content-Length") == std::to_string(g_large.size()));
+    assert(readResponse(fd, &pending).body == g_large.substr(10, 10));
+    assert(readResponse(fd, &pending).body == g_large);
+    assert(readResponse(fd, &pending).body == "<p>sub</p>");
+    assert(pending.empty());
+    ::close(fd);
+    
+    std::cout << "✅ sendfile和pipelining的响应顺序正确" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 测试StaticFileHandler ===" << std::endl;
+    
+    char dir[] = "/tmp/test_staticfile.XXXXXX";
+    char* created = ::mkdtemp(dir);
+    assert(created);
+    (void)created;
+    g_root = dir;
+    ::mkdir((g_root + "/sub").c_str(), 0755);
+    ::mkdir((g_root + "/sub dir").c_str(), 0755);
+    g_small = "hello static file\n";
+    for (int i = 0; i < 300000; ++i) {
+        g_large.push_back(static_cast<char>(i * 31 + i / 7));
+    }
+    writeFile(g_root + "/hello.txt", g_small);
+    writeFile(g_root + "/big.bin", g_large);
+    writeFile(g_root + "/index.html", "<h1>index</h1>");
+    writeFile(g_root + "/sub/index.html", "<p>sub</p>");
+    writeFile(g_root + "/sub dir/a.json", "{}");
+    
+    EventLoop loop;
+    HttpServer server(&loop, "TestStaticFile", kPort);
+    StaticFileHandler files(g_root);
+    server.router().GET("/static/*file", files.handler("file"));
+    server.start();
+    
+    std::thread client([&]() {
+        testServe(&files);
+        testConditional();
+        testRange();
+        testInvalidate();
+        testPaths();
+        testPipelined();
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    
+    std::string cleanup = "rm -rf '" + g_root + "'";
+    if (::system(cleanup.c_str()) != 0) {
+        std::cerr << "failed to remove " << g_root << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,249 @@
+// 测试TcpClient和Connector的重试
+// 1. 基本：连上回显服务器，收发数据，disconnect()之后收到断开回调
+// 2. 退避：连不上时按0.1、0.2、0.4、0.8秒的间隔重试，stop()之后不再重试
+// 3. 服务器晚启动：客户端先开始重试，服务器起来之后连上
+// 4. enableRetry()：服务器关闭连接后自动重连，disconnect()之后不再重连
+// 5. 100个客户端同时连接、收发
+
+#include "TcpClient.h"
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "Connector.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include "TestUtil.h"
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cassert>
+#include <unistd.h>
+
+const int kEchoPort = 18180;
+const int kDeadPort = 18181;      // 没有在监听
+const int kLatePort = 18182;      // 测试中途才开始监听
+
+EventLoop* g_loop = nullptr;
+
+void onEchoMessage(const TcpClient::ConnectionPtr& conn, Buffer* buf) {
+    std::string msg = buf->retrieveAsString();
+    if (msg == "quit") {
+        conn->shutdown();
+    } else {
+        conn->send(msg);
+    }
+}
+
+void testBasic() {
+    std::cout << "\n[测试1] 基本收发" << std::endl;
+    
+    std::atomic<int> ups(0);
+    std::atomic<int> downs(0);
+    std::mutex mutex;
+    std::string received;
+    std::unique_ptr<TcpClient> client;
+    runSync([&]() {
+        client.reset(new TcpClient(g_loop, InetAddress("127.0.0.1", kEchoPort), "Basic"));
+        client->setConnectionCallback([&](const TcpClient::ConnectionPtr& conn) {
+            if (conn->connected()) {
+                ++ups;
+                conn->send("hello, tcpclient");
+            } else {
+                ++downs;
+            }
+        });
+        client->setMessageCallback([&](const TcpClient::ConnectionPtr&, Buffer* buf) {
+            std::lock_guard<std::mutex> lock(mutex);
+            received += buf->retrieveAsString();
+        });
+        client->connect();
+    });
+    
+    assert(waitFor([&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return received == "hello, tcpclient";
+    }, 2.0));
+    assert(ups == 1);
+    assert(client->connection());
+    
+    client->disconnect();
+    assert(waitFor([&]() { return downs == 1; }, 2.0));
+    assert(!client->connection());
+    runSync([&]() { client.reset(); });
+    std::cout << "  ✓ 回显正确，disconnect()之后收到断开回调" << std::endl;
+}
+
+void testBackoff() {
+    std::cout << "\n[测试2] 退避重试" << std::endl;
+    
+    std::mutex mutex;
+    std::vector<Timestamp> failures;
+    std::shared_ptr<Connector> connector;
+    runSync([&]() {
+        connector = std::make_shared<Connector>(g_loop, InetAddress("127.0.0.1", kDeadPort));
+        connector->setRetry(true);
+        connector->setRetryDelay(0.1, 10.0);
+        connector->setErrorCallback([&](int) {
+            std::lock_guard<std::mutex> lock(mutex);
+            failures.push_back(Timestamp::now());
+        });
+        connector->start();
+    });
+    
+    // 0、0.1、0.3、0.7、1.5秒各失败一次
+    ::usleep(1600 * 1000);
+    runSync([&]() { connector->stop(); });
+    size_t count;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        count = failures.size();
+        std::cout << "  1.6秒内失败 " << count << " 次，间隔(秒):";
+        for (size_t i = 1; i < failures.size(); ++i) {
+            double gap = timeDifference(failures[i], failures[i - 1]);
+            std::cout << " " << gap;
+            // 每次等待是上一次的两倍
+            double expected = 0.1 * (1 << (i - 1));
+            assert(gap > expected * 0.8 && gap < expected + 0.1);
+        }
+        std::cout << std::endl;
+    }
+    assert(count >= 4 && count <= 6);
+    
+    ::usleep(1000 * 1000);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        assert(failures.size() == count);
+    }
+    runSync([&]() { connector.reset(); });
+    std::cout << "  ✓ 间隔逐次翻倍，stop()之后不再重试" << std::endl;
+}
+
+void testLateServer() {
+    std::cout << "\n[测试3] 服务器晚启动" << std::endl;
+    
+    std::atomic<int> ups(0);
+    std::unique_ptr<TcpClient> client;
+    runSync([&]() {
+        client.reset(new TcpClient(g_loop, InetAddress("127.0.0.1", kLatePort), "Late"));
+        client->setRetryDelay(0.05, 0.2);
+        client->setConnectionCallback([&](const TcpClient::ConnectionPtr& conn) {
+            if (conn->connected()) {
+                ++ups;
+            }
+        });
+        client->connect();
+    });
+    
+    ::usleep(500 * 1000);
+    assert(ups == 0);
+    
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() {
+        server.reset(new TcpServer(g_loop, "LateServer", kLatePort));
+        server->setMessageCallback(onEchoMessage);
+        server->start();
+    });
+    assert(waitFor([&]() { return ups == 1; }, 2.0));
+    
+    runSync([&]() { client.reset(); });
+    ::usleep(100 * 1000);
+    runSync([&]() { server.reset(); });
+    std::cout << "  ✓ 服务器起来之后连上" << std::endl;
+}
+
+void testReconnect() {
+    std::cout << "\n[测试4] 断线重连" << std::endl;
+    
+    std::atomic<int> ups(0);
+    std::atomic<int> downs(0);
+    std::unique_ptr<TcpClient> client;
+    runSync([&]() {
+        client.reset(new TcpClient(g_loop, InetAddress("127.0.0.1", kEchoPort), "Reconnect"));
+        client->enableRetry();
+        client->setConnectionCallback([&](const TcpClient::ConnectionPtr& conn) {
+            if (conn->connected()) {
+                // 第一个连接让服务器关掉
+                if (++ups == 1) {
+                    conn->send("quit");
+                }
+            } else {
+                ++downs;
+            }
+        });
+        client->connect();
+    });
+    
+    assert(waitFor([&]() { return ups == 2; }, 2.0));
+    assert(downs == 1);
+    
+    client->disconnect();
+    assert(waitFor([&]() { return downs == 2; }, 2.0));
+    ::usleep(300 * 1000);
+    assert(ups == 2);
+    runSync([&]() { client.reset(); });
+    std::cout << "  ✓ 服务器关闭后重连，disconnect()之后不再重连" << std::endl;
+}
+
+void testManyClients() {
+    std::cout << "\n[测试5] 100个客户端" << std::endl;
+    
+    const int kClients = 100;
+    std::atomic<int> echoed(0);
+    std::vector<std::unique_ptr<TcpClient>> clients;
+    runSync([&]() {
+        for (int i = 0; i < kClients; ++i) {
+            std::string msg = "ping-" + std::to_string(i);
+            TcpClient* client = new TcpClient(g_loop, InetAddress("127.0.0.1", kEchoPort),
+                                              "Many" + std::to_string(i));
+            client->setConnectionCallback([msg](const TcpClient::ConnectionPtr& conn) {
+                if (conn->connected()) {
+                    conn->send(msg);
+                }
+            });
+            client->setMessageCallback([msg, &echoed](const TcpClient::ConnectionPtr&, Buffer* buf) {
+                if (buf->readableBytes() >= msg.size()) {
+                    assert(buf->retrieveAsString() == msg);
+                    ++echoed;
+                }
+            });
+            client->connect();
+            clients.emplace_back(client);
+        }
+    });
+    
+    assert(waitFor([&]() { return echoed == kClients; }, 5.0));
+    runSync([&]() { clients.clear(); });
+    std::cout << "  ✓ " << kClients << " 个连接都收到了自己的回显" << std::endl;
+}
+
+int main() {
+    std::cout << "=== TcpClient 测试 ===" << std::endl;
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    g_loop = &loop;
+    TcpServer echo(&loop, "EchoServer", kEchoPort);
+    echo.setMessageCallback(onEchoMessage);
+    echo.start();
+    
+    std::thread driver([&]() {
+        testBasic();
+        testBackoff();
+        testLateServer();
+        testReconnect();
+        testManyClients();
+        
+        std::cout << "\n=== 所有测试通过 ===" << std::endl;
+        loop.quit();
+    });
+    
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,209 @@
+// 测试TcpServer的连接表
+// 1. 连接编号和名字：编号从1开始，名字是"服务器名-编号"，轮流分给各个IO线程
+// 2. connectionCount()：连接建立和关闭之后计数跟着变，槽位被复用
+// 3. forEachConnection()：在连接所在的IO线程遍历所有连接
+// 4. 服务器析构：还在的连接被关闭
+
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "InetAddress.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include "TestUtil.h"
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cassert>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const int kPort = 18234;
+
+EventLoop* g_loop = nullptr;
+
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    InetAddress addr("127.0.0.1", kPort);
+    int rc = ::connect(fd, addr.getSockAddr(), addr.getSockLen());
+    assert(rc == 0);
+    (void)rc;
+    return fd;
+}
+
+// 读到EOF为止，返回读到的数据
+std::string readAll(int fd) {
+    std::string data;
+    char buf[256];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof buf)) > 0) {
+        data.append(buf, n);
+    }
+    return data;
+}
+
+struct Seen {
+    std::mutex mutex;
+    std::vector<uint64_t> ids;
+    std::vector<std::string> names;
+    std::vector<EventLoop*> loops;
+};
+
+std::unique_ptr<TcpServer> newServer(int threads, Seen* seen) {
+    std::unique_ptr<TcpServer> server(new TcpServer(g_loop, "Server", InetAddress(kPort)));
+    server->setThreadNum(threads);
+    server->setConnectionCallback([seen](const TcpServer::ConnectionPtr& conn) {
+        if (conn->connected() && seen) {
+            std::lock_guard<std::mutex> lock(seen->mutex);
+            seen->ids.push_back(conn->id());
+            seen->names.push_back(conn->name());
+            seen->loops.push_back(conn->getLoop());
+        }
+    });
+    server->start();
+    return server;
+}
+
+void testIdsAndNames() {
+    std::cout << "\n[测试1] 连接编号和名字" << std::endl;
+    Seen seen;
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() { server = newServer(2, &seen); });
+    
+    std::vector<int> fds;
+    for (int i = 0; i < 4; ++i) {
+        fds.push_back(connectServer());
+        // 一个一个地等，回调的顺序就是accept的顺序
+        assert(waitFor([&]() {
+            std::lock_guard<std::mutex> lock(seen.mutex);
+            return seen.ids.size() == fds.size();
+        }, 5));
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        assert(seen.ids[i] == i + 1);
+        assert(seen.names[i] == "Server-" + std::to_string(i + 1));
+        assert(seen.loops[i] != g_loop);
+    }
+    // 两个IO线程轮流
+    assert(seen.loops[0] != seen.loops[1] && seen.loops[0] == seen.loops[2] && seen.loops[1] == seen.loops[3]);
+    
+    for (int fd : fds) {
+        ::close(fd);
+    }
+    runSync([&]() { server.reset(); });
+    std::cout << "  ✓ 编号1到4，名字Server-1到Server-4，轮流分给两个IO线程" << std::endl;
+}
+
+void testCount() {
+    std::cout << "\n[测试2] connectionCount()" << std::endl;
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() { server = newServer(2, nullptr); });
+    assert(server->connectionCount() == 0);
+    
+    std::vector<int> fds;
+    for (int i = 0; i < 10; ++i) {
+        fds.push_back(connectServer());
+    }
+    assert(waitFor([&]() { return server->connectionCount() == 10; }, 5));
+    for (int i = 0; i < 4; ++i) {
+        ::close(fds.back());
+        fds.pop_back();
+    }
+    assert(waitFor([&]() { return server->connectionCount() == 6; }, 5));
+    
+    // 连接不断地建立和关闭，空出来的槽位被复用
+    for (int i = 0; i < 200; ++i) {
+        ::close(connectServer());
+    }
+    for (int fd : fds) {
+        ::close(fd);
+    }
+    assert(waitFor([&]() { return server->connectionCount() == 0; }, 5));
+    runSync([&]() { server.reset(); });
+    std::cout << "  ✓ 10个连接、关闭4个之后6个、全部关闭之后0个" << std::endl;
+}
+
+void testForEach() {
+    std::cout << "\n[测试3] forEachConnection()" << std::endl;
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() { server = newServer(2, nullptr); });
+    
+    std::vector<int> fds;
+    for (int i = 0; i < 6; ++i) {
+        fds.push_back(connectServer());
+    }
+    assert(waitFor([&]() { return server->connectionCount() == 6; }, 5));
+    
+    // 给每个连接发一条消息然后关闭写端
+    std::atomic<int> visited(0);
+    std::atomic<bool> inLoop(true);
+    std::mutex mutex;
+    std::set<uint64_t> ids;
+    server->forEachConnection([&](const TcpServer::ConnectionPtr& conn) {
+        if (!conn->getLoop()->isInLoopThread()) {
+            inLoop = false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ids.insert(conn->id());
+        }
+        conn->send("bye");
+        conn->shutdown();
+        ++visited;
+    });
+    for (int fd : fds) {
+        assert(readAll(fd) == "bye");
+        ::close(fd);
+    }
+    assert(visited == 6 && inLoop && ids.size() == 6);
+    assert(waitFor([&]() { return server->connectionCount() == 0; }, 5));
+    runSync([&]() { server.reset(); });
+    std::cout << "  ✓ 6个连接都在各自的IO线程里收到了消息" << std::endl;
+}
+
+void testDestroy() {
+    std::cout << "\n[测试4] 服务器析构" << std::endl;
+    for (int threads = 0; threads <= 2; threads += 2) {
+        std::unique_ptr<TcpServer> server;
+        runSync([&]() { server = newServer(threads, nullptr); });
+        std::vector<int> fds;
+        for (int i = 0; i < 5; ++i) {
+            fds.push_back(connectServer());
+        }
+        assert(waitFor([&]() { return server->connectionCount() == 5; }, 5));
+        runSync([&]() { server.reset(); });
+        for (int fd : fds) {
+            assert(readAll(fd).empty());
+            ::close(fd);
+        }
+    }
+    std::cout << "  ✓ 没有IO线程和2个IO线程时，还在的连接都被关闭" << std::endl;
+}
+
+int main() {
+    std::cout << "=== TcpServer连接表 测试 ===" << std::endl;
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    g_loop = &loop;
+    
+    std::thread driver([&]() {
+        testIdsAndNames();
+        testCount();
+        testForEach();
+        testDestroy();
+        
+        std::cout << "\n=== 所有测试通过 ===" << std::endl;
+        loop.quit();
+    });
+    
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,60 @@
+// 测试EventLoop的定时器
+// runAfter/runEvery/cancel，以及跨线程添加定时器（需要eventfd唤醒）
+
+#include "EventLoop.h"
+#include <iostream>
+#include <thread>
+#include <cassert>
+
+int main() {
+    std::cout << "=== 测试定时器 ===" << std::endl;
+    
+    EventLoop loop;
+    Timestamp start = Timestamp::now();
+    
+    int onceCount = 0;
+    int everyCount = 0;
+    bool canceledFired = false;
+    
+    // 一次性定时器
+    loop.runAfter(0.1, [&]() {
+        ++onceCount;
+        std::cout << "runAfter(0.1) fired at +"
+                  << timeDifference(Timestamp::now(), start) << "s" << std::endl;
+    });
+    
+    // 周期定时器：执行3次后在回调里取消自己
+    TimerId every;
+    every = loop.runEvery(0.1, [&]() {
+        ++everyCount;
+        std::cout << "runEvery(0.1) #" << everyCount << std::endl;
+        if (everyCount == 3) {
+            loop.cancel(every);
+        }
+    });
+    
+    // 被取消的定时器不应该执行
+    TimerId canceled = loop.runAfter(0.2, [&]() { canceledFired = true; });
+    loop.cancel(canceled);
+    
+    // 其他线程添加定时器，到期后退出loop
+    std::thread other([&loop, start]() {
+        loop.runAfter(0.6, [&loop, start]() {
+            std::cout << "跨线程定时器 fired at +"
+                      << timeDifference(Timestamp::now(), start) << "s" << std::endl;
+            loop.quit();
+        });
+    });
+    other.join();
+    
+    loop.loop();
+    
+    double elapsed = timeDifference(Timestamp::now(), start);
+    assert(onceCount == 1);
+    assert(everyCount == 3);
+    assert(!canceledFired);
+    assert(elapsed >= 0.6 && elapsed < 2.0);
+    
+    std::cout << "✅ 定时器测试通过，耗时 " << elapsed << "s" << std::endl;
+    return 0;
+}
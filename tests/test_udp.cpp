@@ -0,0 +1,280 @@
+// 测试UdpSocket/UdpServer
+// 1. 批量接收：排在接收队列里的数据报用recvmmsg()一批一批读出，内容和来源地址正确
+// 2. 回显：回调里sendBatch()一次把这一批发回去
+// 3. 截断：超过maxDatagramSize的数据报被截断并计数
+// 4. GSO/GRO：sendSegments()切开发送，接收端开启GRO时拆开交给回调，看到的还是一个一个的数据报
+// 5. UdpServer：两个IO线程用SO_REUSEPORT共享端口，每个客户端都收到自己的回显
+
+#include "UdpServer.h"
+#include "UdpSocket.h"
+#include "EventLoop.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include "TestUtil.h"
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cassert>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+const int kSocketPort = 18210;
+const int kServerPort = 18211;
+
+EventLoop* g_loop = nullptr;
+
+// 普通的阻塞UDP socket，绑定一个临时端口，收的时候最多等1秒
+int clientSocket() {
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    assert(fd >= 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int rc = ::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr);
+    assert(rc == 0);
+    (void)rc;
+    struct timeval tv = {1, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+    return fd;
+}
+
+uint16_t localPort(int fd) {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof addr;
+    ::getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len);
+    return ntohs(addr.sin_port);
+}
+
+void sendTo(int fd, const std::string& msg, int port) {
+    InetAddress to("127.0.0.1", static_cast<uint16_t>(port));
+    ssize_t n = ::sendto(fd, msg.data(), msg.size(), 0, to.getSockAddr(), to.getSockLen());
+    assert(n == static_cast<ssize_t>(msg.size()));
+}
+
+std::string recvFrom(int fd) {
+    char buf[4096];
+    ssize_t n = ::recv(fd, buf, sizeof buf, 0);
+    assert(n >= 0);
+    return std::string(buf, n);
+}
+
+void testBatchReceive() {
+    std::cout << "\n[测试1] 批量接收" << std::endl;
+    
+    std::unique_ptr<UdpSocket> socket;
+    std::vector<std::string> received;
+    std::vector<uint16_t> peers;
+    std::vector<size_t> batches;
+    runSync([&]() {
+        socket.reset(new UdpSocket(g_loop, InetAddress("127.0.0.1", kSocketPort)));
+        socket->setBatchSize(16);
+        socket->setMessageCallback([&](UdpSocket*, const UdpDatagram* d, size_t n) {
+            batches.push_back(n);
+            for (size_t i = 0; i < n; ++i) {
+                received.push_back(std::string(d[i].data, d[i].len));
+                peers.push_back(d[i].peer.toPort());
+            }
+        });
+        socket->start();
+    });
+    
+    // 在loop线程里发，发完之前loop不会去读，100个数据报都排在接收队列里
+    int client = clientSocket();
+    runSync([&]() {
+        for (int i = 0; i < 100; ++i) {
+            sendTo(client, "datagram-" + std::to_string(i), kSocketPort);
+        }
+    });
+    assert(waitForInLoop([&]() { return received.size() == 100; }, 2.0));
+    for (int i = 0; i < 100; ++i) {
+        assert(received[i] == "datagram-" + std::to_string(i));
+        assert(peers[i] == localPort(client));
+    }
+    runSync([&]() {
+        // 6批16个加上最后4个
+        assert(socket->receiveCalls() == 7);
+        assert(batches.size() == 7 && batches[0] == 16 && batches[6] == 4);
+        assert(socket->receivedDatagrams() == 100);
+        socket.reset();
+    });
+    ::close(client);
+    std::cout << "  ✓ 100个数据报用7次recvmmsg()读完，内容和来源地址正确" << std::endl;
+}
+
+void testEcho() {
+    std::cout << "\n[测试2] 回显" << std::endl;
+    
+    std::unique_ptr<UdpSocket> socket;
+    runSync([&]() {
+        socket.reset(new UdpSocket(g_loop, InetAddress("127.0.0.1", kSocketPort)));
+        socket->setMessageCallback([](UdpSocket* s, const UdpDatagram* d, size_t n) {
+            s->sendBatch(d, n);
+        });
+        socket->start();
+    });
+    
+    int client = clientSocket();
+    runSync([&]() {
+        for (int i = 0; i < 20; ++i) {
+            sendTo(client, "echo-" + std::to_string(i), kSocketPort);
+        }
+    });
+    for (int i = 0; i < 20; ++i) {
+        assert(recvFrom(client) == "echo-" + std::to_string(i));
+    }
+    runSync([&]() {
+        assert(socket->sentDatagrams() == 20);
+        assert(socket->sendCalls() == socket->receiveCalls());
+        assert(socket->droppedDatagrams() == 0 && socket->pendingBytes() == 0);
+        socket.reset();
+    });
+    ::close(client);
+    std::cout << "  ✓ 每一批用一次sendmmsg()发回" << std::endl;
+}
+
+void testTruncate() {
+    std::cout << "\n[测试3] 截断" << std::endl;
+    
+    std::unique_ptr<UdpSocket> socket;
+    std::vector<size_t> lengths;
+    runSync([&]() {
+        socket.reset(new UdpSocket(g_loop, InetAddress("127.0.0.1", kSocketPort)));
+        socket->setMaxDatagramSize(64);
+        socket->setMessageCallback([&](UdpSocket*, const UdpDatagram* d, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                lengths.push_back(d[i].len);
+            }
+        });
+        socket->start();
+    });
+    
+    int client = clientSocket();
+    sendTo(client, std::string(100, 'x'), kSocketPort);
+    sendTo(client, std::string(10, 'y'), kSocketPort);
+    assert(waitForInLoop([&]() { return lengths.size() == 2; }, 2.0));
+    assert(lengths[0] == 64 && lengths[1] == 10);
+    runSync([&]() {
+        assert(socket->truncatedDatagrams() == 1);
+        socket.reset();
+    });
+    ::close(client);
+    std::cout << "  ✓ 100字节的数据报截断成64字节" << std::endl;
+}
+
+void testSegments() {
+    std::cout << "\n[测试4] GSO/GRO" << std::endl;
+    
+    std::unique_ptr<UdpSocket> receiver;
+    std::unique_ptr<UdpSocket> sender;
+    std::vector<std::string> received;
+    bool gro = false;
+    runSync([&]() {
+        receiver.reset(new UdpSocket(g_loop, InetAddress("127.0.0.1", kSocketPort)));
+        gro = receiver->setGro(true);
+        receiver->setMessageCallback([&](UdpSocket*, const UdpDatagram* d, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                received.push_back(std::string(d[i].data, d[i].len));
+            }
+        });
+        receiver->start();
+        sender.reset(new UdpSocket(g_loop, InetAddress("127.0.0.1", 0)));
+    });
+    
+    // 9段100字节加上最后50字节，每段内容不同
+    std::string payload;
+    for (int i = 0; i < 10; ++i) {
+        payload.append(i < 9 ? 100 : 50, static_cast<char>('a' + i));
+    }
+    size_t accepted = 0;
+    runSync([&]() {
+        accepted = sender->sendSegments(payload.data(), payload.size(), 100, receiver->localAddress());
+    });
+    assert(accepted == 10);
+    assert(waitForInLoop([&]() { return received.size() == 10; }, 2.0));
+    for (int i = 0; i < 10; ++i) {
+        assert(received[i] == std::string(i < 9 ? 100 : 50, static_cast<char>('a' + i)));
+    }
+    runSync([&]() {
+        assert(sender->sentDatagrams() == 10);
+        std::cout << "  GRO " << (gro ? "开启" : "不支持") << "，发送用了" << sender->sendCalls()
+                  << "次系统调用，接收用了" << receiver->receiveCalls() << "次" << std::endl;
+        receiver.reset();
+        sender.reset();
+    });
+    std::cout << "  ✓ 收到10个数据报，大小和内容正确" << std::endl;
+}
+
+void testServer() {
+    std::cout << "\n[测试5] UdpServer" << std::endl;
+    
+    std::unique_ptr<UdpServer> server;
+    std::atomic<int> initialized(0);
+    runSync([&]() {
+        server.reset(new UdpServer(g_loop, "EchoServer", kServerPort));
+        server->setThreadNum(2);
+        server->setThreadInitCallback([&](EventLoop*) { ++initialized; });
+        server->setMessageCallback([](UdpSocket* s, const UdpDatagram* d, size_t n) {
+            s->sendBatch(d, n);
+        });
+        server->start();
+    });
+    assert(initialized == 2);
+    assert(server->sockets().size() == 2);
+    
+    std::vector<int> clients;
+    for (int i = 0; i < 8; ++i) {
+        clients.push_back(clientSocket());
+    }
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 8; ++i) {
+            std::string msg = std::to_string(i) + ":" + std::to_string(round);
+            sendTo(clients[i], msg, kServerPort);
+            assert(recvFrom(clients[i]) == msg);
+        }
+    }
+    
+    // 统计要在各自的loop线程读
+    uint64_t total = 0;
+    for (const std::unique_ptr<UdpSocket>& socket : server->sockets()) {
+        std::promise<uint64_t> count;
+        socket->getLoop()->runInLoop([&]() { count.set_value(socket->receivedDatagrams()); });
+        total += count.get_future().get();
+    }
+    assert(total == 80);
+    
+    runSync([&]() { server.reset(); });
+    for (int fd : clients) {
+        ::close(fd);
+    }
+    std::cout << "  ✓ 8个客户端各收到10个回显，两个IO线程共收到80个数据报" << std::endl;
+}
+
+int main() {
+    std::cout << "=== UdpSocket/UdpServer 测试 ===" << std::endl;
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    g_loop = &loop;
+    
+    std::thread driver([&]() {
+        testBatchReceive();
+        testEcho();
+        testTruncate();
+        testSegments();
+        testServer();
+        
+        std::cout << "\n=== 所有测试通过 ===" << std::endl;
+        loop.quit();
+    });
+    
+    loop.loop();
+    driver.join();
+    return 0;
+}
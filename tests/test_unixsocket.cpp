@@ -0,0 +1,253 @@
+// 测试Unix域socket的监听和连接
+// 1. 文件路径：TcpServer/TcpClient收发数据，服务器销毁后socket文件被删除
+// 2. 抽象命名空间：不创建文件
+// 3. 残留的socket文件：没有进程监听的旧文件被删掉重新监听，别人正在监听的不动
+// 4. 连接失败：文件不存在是ENOENT，没有进程监听是ECONNREFUSED
+// 5. 传递fd：客户端把pipe的读端发给服务器，服务器从里面读出数据
+
+#include "TcpClient.h"
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "Connector.h"
+#include "UnixAddress.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "Timestamp.h"
+#include "Logger.h"
+#include "TestUtil.h"
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cassert>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+EventLoop* g_loop = nullptr;
+
+bool fileExists(const std::string& path) {
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0;
+}
+
+std::string tempPath(const char* name) {
+    return "/tmp/tiny_network_" + std::string(name) + "_" + std::to_string(::getpid()) + ".sock";
+}
+
+std::unique_ptr<TcpServer> newEchoServer(const UnixAddress& addr) {
+    std::unique_ptr<TcpServer> server(new TcpServer(g_loop, "EchoServer", addr));
+    server->setMessageCallback([](const TcpServer::ConnectionPtr& conn, Buffer* buf) {
+        conn->send(buf->retrieveAsString());
+    });
+    server->start();
+    return server;
+}
+
+// 连上addr，发一条消息，返回回显
+std::string echoOnce(const UnixAddress& addr, const std::string& msg) {
+    std::unique_ptr<TcpClient> client;
+    std::promise<std::string> reply;
+    runSync([&]() {
+        client.reset(new TcpClient(g_loop, addr, "Client"));
+        client->setConnectionCallback([&](const TcpClient::ConnectionPtr& conn) {
+            if (conn->connected()) {
+                conn->send(msg);
+            }
+        });
+        client->setMessageCallback([&](const TcpClient::ConnectionPtr&, Buffer* buf) {
+            if (buf->readableBytes() >= msg.size()) {
+                reply.set_value(buf->retrieveAsString());
+            }
+        });
+        client->connect();
+    });
+    std::string result = reply.get_future().get();
+    runSync([&]() { client.reset(); });
+    return result;
+}
+
+void testPathname() {
+    std::cout << "\n[测试1] 文件路径" << std::endl;
+    
+    std::string path = tempPath("echo");
+    UnixAddress addr(path);
+    assert(!addr.isAbstract() && addr.path() == path && addr.toString() == "unix:" + path);
+    
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() { server = newEchoServer(addr); });
+    assert(server->ipPort() == "unix:" + path);
+    assert(fileExists(path));
+    
+    assert(echoOnce(addr, "hello unix") == "hello unix");
+    assert(echoOnce(addr, std::string(100000, 'x')).size() == 100000);
+    
+    runSync([&]() { server.reset(); });
+    assert(!fileExists(path));
+    std::cout << "  ✓ 收发正常，服务器销毁后socket文件被删除" << std::endl;
+}
+
+void testAbstract() {
+    std::cout << "\n[测试2] 抽象命名空间" << std::endl;
+    
+    std::string name = "@tiny_network_echo_" + std::to_string(::getpid());
+    UnixAddress addr(name);
+    assert(addr.isAbstract() && addr.path() == name);
+    
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() { server = newEchoServer(addr); });
+    assert(!fileExists(name) && !fileExists(name.substr(1)));
+    assert(echoOnce(addr, "abstract") == "abstract");
+    runSync([&]() { server.reset(); });
+    std::cout << "  ✓ 收发正常，没有创建文件" << std::endl;
+}
+
+void testStaleFile() {
+    std::cout << "\n[测试3] 残留的socket文件" << std::endl;
+    
+    // 绑定之后直接关闭，留下一个没有进程监听的socket文件
+    std::string path = tempPath("stale");
+    UnixAddress addr(path);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    int rc = ::bind(fd, addr.getSockAddr(), addr.getSockLen());
+    assert(rc == 0);
+    (void)rc;
+    ::close(fd);
+    assert(fileExists(path));
+    
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() { server = newEchoServer(addr); });
+    assert(echoOnce(addr, "stale") == "stale");
+    
+    // 正在监听的文件不会被第二个服务器删掉
+    std::unique_ptr<TcpServer> second;
+    runSync([&]() { second.reset(new TcpServer(g_loop, "Second", addr)); });
+    assert(echoOnce(addr, "still here") == "still here");
+    runSync([&]() { second.reset(); });
+    assert(fileExists(path));
+    
+    runSync([&]() { server.reset(); });
+    assert(!fileExists(path));
+    std::cout << "  ✓ 残留文件被替换，正在使用的文件没有被删" << std::endl;
+}
+
+// 用Connector连一次，返回错误码
+int connectError(const UnixAddress& addr) {
+    std::promise<int> result;
+    std::shared_ptr<Connector> connector;
+    runSync([&]() {
+        connector = std::make_shared<Connector>(g_loop, addr);
+        connector->setNewConnectionCallback([&](int sockfd) {
+            ::close(sockfd);
+            result.set_value(0);
+        });
+        connector->setErrorCallback([&](int savedErrno) { result.set_value(savedErrno); });
+        connector->start();
+    });
+    int err = result.get_future().get();
+    runSync([&]() { connector.reset(); });
+    return err;
+}
+
+void testConnectFailure() {
+    std::cout << "\n[测试4] 连接失败" << std::endl;
+    
+    std::string path = tempPath("missing");
+    assert(connectError(UnixAddress(path)) == ENOENT);
+    
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    UnixAddress addr(path);
+    int rc = ::bind(fd, addr.getSockAddr(), addr.getSockLen());
+    assert(rc == 0);
+    (void)rc;
+    ::close(fd);
+    assert(connectError(addr) == ECONNREFUSED);
+    ::unlink(path.c_str());
+    std::cout << "  ✓ ENOENT和ECONNREFUSED" << std::endl;
+}
+
+void testFdPassing() {
+    std::cout << "\n[测试5] 传递fd" << std::endl;
+    
+    std::string path = tempPath("fds");
+    UnixAddress addr(path);
+    std::promise<std::string> fromPipe;
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() {
+        server.reset(new TcpServer(g_loop, "FdServer", addr));
+        server->setConnectionCallback([](const TcpServer::ConnectionPtr& conn) {
+            if (conn->connected()) {
+                conn->setFdPassing(true);
+            }
+        });
+        // 收到"F"时取出fd，从pipe里读出客户端写的数据
+        server->setMessageCallback([&](const TcpServer::ConnectionPtr& conn, Buffer* buf) {
+            assert(buf->retrieveAsString() == "F");
+            std::vector<int> fds = conn->takeReceivedFds();
+            assert(fds.size() == 1);
+            char data[64];
+            ssize_t n = ::read(fds[0], data, sizeof data);
+            ::close(fds[0]);
+            fromPipe.set_value(std::string(data, n > 0 ? n : 0));
+        });
+        server->start();
+    });
+    
+    int pipefd[2];
+    int rc = ::pipe(pipefd);
+    assert(rc == 0);
+    (void)rc;
+    ssize_t n = ::write(pipefd[1], "through the pipe", 16);
+    assert(n == 16);
+    (void)n;
+    
+    std::unique_ptr<TcpClient> client;
+    std::promise<bool> sent;
+    runSync([&]() {
+        client.reset(new TcpClient(g_loop, addr, "FdClient"));
+        client->setConnectionCallback([&](const TcpClient::ConnectionPtr& conn) {
+            if (conn->connected()) {
+                sent.set_value(conn->sendFds("F", 1, std::vector<int>(1, pipefd[0])));
+            }
+        });
+        client->connect();
+    });
+    assert(sent.get_future().get());
+    
+    // 发出之后自己的fd可以关掉，服务器那份不受影响
+    ::close(pipefd[0]);
+    assert(fromPipe.get_future().get() == "through the pipe");
+    ::close(pipefd[1]);
+    
+    runSync([&]() {
+        client.reset();
+        server.reset();
+    });
+    std::cout << "  ✓ 服务器通过收到的fd读出了pipe里的数据" << std::endl;
+}
+
+int main() {
+    std::cout << "=== Unix域socket 测试 ===" << std::endl;
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    g_loop = &loop;
+    
+    std::thread driver([&]() {
+        testPathname();
+        testAbstract();
+        testStaleFile();
+        testConnectFailure();
+        testFdPassing();
+        
+        std::cout << "\n=== 所有测试通过 ===" << std::endl;
+        loop.quit();
+    });
+    
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,419 @@
+// 测试WebSocket
+// 1. 帧编解码：Sec-WebSocket-Accept、长度编码、SIMD解掩码、UTF-8检查
+// 2. 握手：101、版本不对426、缺少头部400，握手后面紧跟的帧也能处理
+// 3. 文本/二进制回显、分片、ping/pong（包括夹在分片中间的ping）、大消息
+// 4. 协议错误：没有掩码1002、非法UTF-8 1007、消息太大1009
+// 5. 关闭握手：客户端发起、服务器发起
+// 6. WebSocketGroup广播
+
+#include "HttpServer.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "WebSocketCodec.h"
+#include "WebSocketConnection.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cstring>
+
+const int kPort = 18086;
+const char kMask[4] = { 0x12, 0x34, 0x56, 0x78 };
+
+std::atomic<int> g_lastCloseCode(0);
+std::atomic<int> g_closed(0);
+WebSocketGroup g_room;
+
+int connectServer() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(kPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void writeAll(int fd, const std::string& data) {
+    size_t n = 0;
+    while (n < data.size()) {
+        ssize_t w = ::write(fd, data.data() + n, data.size() - n);
+        assert(w > 0);
+        n += w;
+    }
+}
+
+void readMore(int fd, std::string* pending) {
+    char buf[65536];
+    ssize_t n = ::read(fd, buf, sizeof buf);
+    assert(n > 0);
+    pending->append(buf, n);
+}
+
+// 读HTTP响应头部，返回状态码
+int readHandshake(int fd, std::string* pending, std::string* headers) {
+    size_t end;
+    while ((end = pending->find("\r\n\r\n")) == std::string::npos) {
+        readMore(fd, pending);
+    }
+    *headers = pending->substr(0, end + 4);
+    pending->erase(0, end + 4);
+    return atoi(headers->c_str() + 9);
+}
+
+std::string upgradeRequest(const std::string& path, const std::string& version = "13") {
+    return "GET " + path + " HTTP/1.1\r\nHost: test\r\nUpgrade: websocket\r\n"
+           "Connection: keep-alive, Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+           "Sec-WebSocket-Version: " + version + "\r\n\r\n";
+}
+
+int wsConnect(const std::string& path, std::string* pending) {
+    int fd = connectServer();
+    assert(fd >= 0);
+    writeAll(fd, upgradeRequest(path));
+    std::string headers;
+    assert(readHandshake(fd, pending, &headers) == 101);
+    return fd;
+}
+
+std::string frame(int opcode, const std::string& payload, bool fin = true) {
+    std::string out;
+    WebSocketCodec::appendFrame(&out, opcode, payload, fin, kMask);
+    return out;
+}
+
+// 读一帧（服务器发来的帧不带掩码）
+int readFrame(int fd, std::string* pending, std::string* payload) {
+    WebSocketCodec::FrameHeader header;
+    while (WebSocketCodec::parseHeader(pending->data(), pending->size(), &header) != WebSocketCodec::kOk
+           || pending->size() < header.headerSize + header.payloadSize) {
+        readMore(fd, pending);
+    }
+    assert(!header.masked && header.fin);
+    *payload = pending->substr(header.headerSize, header.payloadSize);
+    pending->erase(0, header.headerSize + header.payloadSize);
+    return header.opcode;
+}
+
+int closeCode(const std::string& payload) {
+    assert(payload.size() >= 2);
+    return (static_cast<unsigned char>(payload[0]) << 8) | static_cast<unsigned char>(payload[1]);
+}
+
+// 读到EOF，说明服务器关闭了连接
+void expectEof(int fd) {
+    char buf[1024];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof buf)) > 0) {
+    }
+    assert(n == 0);
+}
+
+// 测试1：编解码
+void testCodec() {
+    std::cout << "\n[测试1] 帧编解码" << std::endl;
+    
+    // RFC 6455 1.3的例子
+    assert(WebSocketCodec::acceptKey("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+    
+    // 三种长度编码
+    const size_t sizes[] = { 0, 125, 126, 65535, 65536, 100000 };
+    for (size_t size : sizes) {
+        std::string payload(size, 'a');
+        Buffer buf;
+        WebSocketCodec::appendFrame(&buf, WebSocketCodec::kBinary, payload, true, kMask);
+        WebSocketCodec::FrameHeader header;
+        assert(WebSocketCodec::parseHeader(buf.peek(), buf.readableBytes(), &header) == WebSocketCodec::kOk);
+        assert(header.fin && header.masked && header.opcode == WebSocketCodec::kBinary);
+        assert(header.payloadSize == size);
+        assert(header.headerSize == WebSocketCodec::headerSize(size, true));
+        assert(buf.readableBytes() == header.headerSize + size);
+        char* p = const_cast<char*>(buf.peek()) + header.headerSize;
+        WebSocketCodec::unmask(p, size, header.mask);
+        assert(std::string(p, size) == payload);
+        
+        // 帧头不完整
+        assert(WebSocketCodec::parseHeader(buf.peek(), header.headerSize - 1, &header)
+               == WebSocketCodec::kIncomplete);
+    }
+    
+    // 解掩码和逐字节的结果一致（各种长度和起始对齐）
+    for (size_t len = 0; len < 200; ++len) {
+        for (size_t offset = 0; offset < 4; ++offset) {
+            std::string data(len + offset, '\0');
+            for (size_t i = 0; i < data.size(); ++i) {
+                data[i] = static_cast<char>(i * 7 + len);
+            }
+            std::string expect = data;
+            for (size_t i = 0; i < len; ++i) {
+                expect[offset + i] ^= kMask[i % 4];
+            }
+            WebSocketCodec::unmask(&data[offset], len, kMask);
+            assert(data == expect);
+        }
+    }
+    
+    // RSV位、非最短长度编码
+    const char rsv[] = { static_cast<char>(0xC1), 0x00 };
+    WebSocketCodec::FrameHeader header;
+    assert(WebSocketCodec::parseHeader(rsv, 2, &header) == WebSocketCodec::kError);
+    const char shortLen[] = { static_cast<char>(0x81), 126, 0, 10 };
+    assert(WebSocketCodec::parseHeader(shortLen, 4, &header) == WebSocketCodec::kError);
+    
+    assert(WebSocketCodec::isValidUtf8("hello, world"));
+    assert(WebSocketCodec::isValidUtf8("\xE4\xBD\xA0\xE5\xA5\xBD"));           // 你好
+    assert(WebSocketCodec::isValidUtf8("\xF0\x9F\x98\x80"));                   // emoji
+    assert(!WebSocketCodec::isValidUtf8("\xC0\xAF"));                          // 过长编码
+    assert(!WebSocketCodec::isValidUtf8("\xED\xA0\x80"));                      // 代理区
+    assert(!WebSocketCodec::isValidUtf8("abc\xE4\xBD"));                       // 截断
+    assert(!WebSocketCodec::isValidUtf8("\xF4\x90\x80\x80"));                  // 超过U+10FFFF
+    std::cout << "  ✓ 编解码正确" << std::endl;
+}
+
+// 测试2：握手
+void testHandshake() {
+    std::cout << "\n[测试2] 握手" << std::endl;
+    
+    int fd = connectServer();
+    // 握手和第一帧一起发过去
+    writeAll(fd, upgradeRequest("/echo") + frame(WebSocketCodec::kText, "early"));
+    std::string pending, headers, payload;
+    assert(readHandshake(fd, &pending, &headers) == 101);
+    assert(headers.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n") != std::string::npos);
+    assert(headers.find("Upgrade: websocket\r\n") != std::string::npos);
+    assert(headers.find("Connection: Upgrade\r\n") != std::string::npos);
+    assert(headers.find("Keep-Alive") == std::string::npos);
+    assert(headers.find("Content-Length") == std::string::npos);
+    
+    // onOpen发的欢迎消息在101之后，然后是回显
+    assert(readFrame(fd, &pending, &payload) == WebSocketCodec::kText);
+    assert(payload == "welcome /echo");
+    assert(readFrame(fd, &pending, &payload) == WebSocketCodec::kText);
+    assert(payload == "early");
+    ::close(fd);
+    
+    fd = connectServer();
+    writeAll(fd, upgradeRequest("/echo", "8"));
+    pending.clear();
+    assert(readHandshake(fd, &pending, &headers) == 426);
+    assert(headers.find("Sec-WebSocket-Version: 13\r\n") != std::string::npos);
+    ::close(fd);
+    
+    fd = connectServer();
+    writeAll(fd, "GET /echo HTTP/1.1\r\nHost: test\r\n\r\n");
+    pending.clear();
+    assert(readHandshake(fd, &pending, &headers) == 400);
+    ::close(fd);
+    std::cout << "  ✓ 握手成功/失败都正确" << std::endl;
+}
+
+// 测试3：消息
+void testMessages() {
+    std::cout << "\n[测试3] 回显、分片、ping/pong" << std::endl;
+    
+    std::string pending, payload;
+    int fd = wsConnect("/echo", &pending);
+    assert(readFrame(fd, &pending, &payload) == WebSocketCodec::kText);  // welcome
+    
+    writeAll(fd, frame(WebSocketCodec::kText, "hello"));
+    assert(readFrame(fd, &pending, &payload) == WebSocketCodec::kText);
+    assert(payload == "hello");
+    
+    std::string bin("\x00\x01\x02\xff", 4);
+    writeAll(fd, frame(WebSocketCodec::kBinary, bin));
+    assert(readFrame(fd, &pending, &payload) == WebSocketCodec::kBinary);
+    assert(payload == bin);
+    
+    // 分片，中间夹一个ping
+    writeAll(fd, frame(WebSocketCodec::kText, "frag", false)
+               + frame(WebSocketCodec::kPing, "are you there")
+               + frame(WebSocketCodec::kContinuation, "men", false)
+               + frame(WebSocketCodec::kContinuation, "ted"));
+    assert(readFrame(fd, &pending, &payload) == WebSocketCodec::kPong);
+    assert(payload == "are you there");
+    assert(readFrame(fd, &pending, &payload) == WebSocketCodec::kText);
+    assert(payload == "fragmented");
+    
+    // 大消息（64位长度），分多次写入
+    std::string big(300000, 'x');
+    for (size_t i = 0; i < big.size(); ++i) {
+        big[i] = static_cast<char>('a' + i % 26);
+    }
+    std::string bigFrame = frame(WebSocketCodec::kText, big);
+    for (size_t off = 0; off < bigFrame.size(); off += 70000) {
+        writeAll(fd, bigFrame.substr(off, 70000));
+    }
+    assert(readFrame(fd, &pending, &payload) == WebSocketCodec::kText);
+    assert(payload == big);
+    
+    // 客户端发起关闭
+    int closed = g_closed;
+    writeAll(fd, frame(WebSocketCodec::kClose, std::string("\x03\xe8" "bye", 5)));
+    assert(readFrame(fd, &pending, &payload) == WebSocketCodec::kClose);
+    assert(closeCode(payload) == 1000);
+    expectEof(fd);
+    ::close(fd);
+    while (g_closed == closed) {
+        usleep(1000);
+    }
+    assert(g_lastCloseCode == 1000);
+    std::cout << "  ✓ 消息和关闭握手正确" << std::endl;
+}
+
+// 测试4：协议错误
+void expectFailure(const std::string& data, int code) {
+    std::string pending, payload;
+    int fd = wsConnect("/echo", &pending);
+    assert(readFrame(fd, &pending, &payload) == WebSocketCodec::kText);  // welcome
+    writeAll(fd, data);
+    assert(readFrame(fd, &pending, &payload) == WebSocketCodec::kClose);
+    assert(closeCode(payload) == code);
+    expectEof(fd);
+    ::close(fd);
+}
+
+void testErrors() {
+    std::cout << "\n[测试4] 协议错误" << std::endl;
+    
+    std::string unmasked;
+    WebSocketCodec::appendFrame(&unmasked, WebSocketCodec::kText, "no mask");
+    expectFailure(unmasked, 1002);
+    expectFailure(frame(WebSocketCodec::kContinuation, "orphan"), 1002);
+    expectFailure(frame(WebSocketCodec::kText, "a", false) + frame(WebSocketCodec::kText, "b"), 1002);
+    expectFailure(frame(WebSocketCodec::kPing, std::string(126, 'p')), 1002);
+    expectFailure(frame(0x3, "reserved"), 1002);
+    expectFailure(frame(WebSocketCodec::kText, "\xC0\xAF"), 1007);
+    
+    // /echo的上限是1MB，帧头一到就拒绝，不用等payload
+    char tooBig[14] = { static_cast<char>(0x82), static_cast<char>(0x80 | 127), 0, 0, 0, 0, 0, 0x20, 0, 0 };
+    memcpy(tooBig + 10, kMask, 4);
+    expectFailure(std::string(tooBig, 14), 1009);
+    std::cout << "  ✓ 协议错误以正确的关闭码断开" << std::endl;
+}
+
+// 测试5：服务器发起关闭
+void testServerClose() {
+    std::cout << "\n[测试5] 服务器发起关闭" << std::endl;
+    
+    std::string pending, payload;
+    int fd = wsConnect("/echo", &pending);
+    assert(readFrame(fd, &pending, &payload) == WebSocketCodec::kText);  // welcome
+    writeAll(fd, frame(WebSocketCodec::kText, "quit"));
+    assert(readFrame(fd, &pending, &payload) == WebSocketCodec::kClose);
+    assert(closeCode(payload) == 1001);
+    assert(payload.substr(2) == "going away");
+    
+    // 关闭帧之后服务器不再发消息；客户端回复关闭帧后连接断开
+    int closed = g_closed;
+    writeAll(fd, frame(WebSocketCodec::kClose, std::string("\x03\xe9", 2)));
+    expectEof(fd);
+    ::close(fd);
+    while (g_closed == closed) {
+        usleep(1000);
+    }
+    assert(g_lastCloseCode == 1001);
+    std::cout << "  ✓ 关闭握手完成" << std::endl;
+}
+
+// 测试6：广播
+void testBroadcast() {
+    std::cout << "\n[测试6] WebSocketGroup广播" << std::endl;
+    
+    const int kClients = 5;
+    int fds[kClients];
+    std::string pending[kClients];
+    std::string payload;
+    for (int i = 0; i < kClients; ++i) {
+        fds[i] = wsConnect("/room", &pending[i]);
+        assert(readFrame(fds[i], &pending[i], &payload) == WebSocketCodec::kText);  // joined
+    }
+    
+    writeAll(fds[0], frame(WebSocketCodec::kText, "hi all"));
+    for (int i = 0; i < kClients; ++i) {
+        assert(readFrame(fds[i], &pending[i], &payload) == WebSocketCodec::kText);
+        assert(payload == "hi all");
+    }
+    
+    // 断开一个之后，广播时顺便移除
+    ::close(fds[kClients - 1]);
+    while (g_room.size() != kClients - 1 || g_closed == 0) {
+        writeAll(fds[0], frame(WebSocketCodec::kText, "ping"));
+        for (int i = 0; i < kClients - 1; ++i) {
+            assert(readFrame(fds[i], &pending[i], &payload) == WebSocketCodec::kText);
+        }
+    }
+    for (int i = 0; i < kClients - 1; ++i) {
+        ::close(fds[i]);
+    }
+    std::cout << "  ✓ " << kClients << "个客户端收到同一条广播" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 测试WebSocket ===" << std::endl;
+    
+    EventLoop loop;
+    HttpServer server(&loop, "TestWebSocket", kPort);
+    
+    WebSocketHandler echo;
+    echo.onOpen = [](const WebSocketConnectionPtr& ws, const HttpRequest& req) {
+        ws->sendText("welcome " + req.path().as_string());
+    };
+    echo.onMessage = [](const WebSocketConnectionPtr& ws, StringPiece message, bool binary) {
+        if (message == "quit") {
+            ws->close(WebSocketConnection::kGoingAway, "going away");
+            ws->sendText("must not be sent");
+        } else if (binary) {
+            ws->sendBinary(message);
+        } else {
+            ws->sendText(message);
+        }
+    };
+    echo.onClose = [](const WebSocketConnectionPtr&, int code) {
+        g_lastCloseCode = code;
+        ++g_closed;
+    };
+    server.websocket("/echo", echo, 1024 * 1024);
+    
+    WebSocketHandler room;
+    room.onOpen = [](const WebSocketConnectionPtr& ws, const HttpRequest&) {
+        g_room.add(ws);
+        ws->sendText("joined");
+    };
+    room.onMessage = [](const WebSocketConnectionPtr&, StringPiece message, bool) {
+        g_room.broadcast(WebSocketMessage::text(message));
+    };
+    room.onClose = [](const WebSocketConnectionPtr&, int) {
+        ++g_closed;
+    };
+    server.websocket("/room", room);
+    server.start();
+    
+    std::thread client([&]() {
+        testCodec();
+        testHandshake();
+        testMessages();
+        testErrors();
+        testServerClose();
+        g_closed = 0;
+        testBroadcast();
+        loop.quit();
+    });
+    
+    loop.loop();
+    client.join();
+    
+    std::cout << "\n=== 所有测试通过 ===" << std::endl;
+    return 0;
+}
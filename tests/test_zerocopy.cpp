@@ -0,0 +1,233 @@
+// 测试零拷贝发送（MSG_ZEROCOPY）
+// 1. send(Buffer*)：大块数据接管Buffer的内存，对端收到的内容正确，完成通知之后释放
+// 2. 和普通数据、sendFile()混在一起时按调用顺序到达
+// 3. 小于阈值的数据和没有开启零拷贝时照常拷贝发送
+// 4. 发送之后马上关闭：连接销毁后数据继续持有，对端收到的内容正确，通知到齐才释放
+
+#include "TcpServer.h"
+#include "TcpConnection.h"
+#include "InetAddress.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "Logger.h"
+#include "TestUtil.h"
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <cassert>
+#include <cstdio>
+#include <sys/socket.h>
+#include <unistd.h>
+
+EventLoop* g_loop = nullptr;
+const uint16_t kPort = 18227;
+
+std::string pattern(size_t len, char seed) {
+    std::string s(len, '\0');
+    for (size_t i = 0; i < len; ++i) {
+        s[i] = static_cast<char>(seed + i % 251);
+    }
+    return s;
+}
+
+// 连接建立后在loop线程调用onConnected，客户端读total字节返回
+std::string receive(const std::function<void(const TcpServer::ConnectionPtr&)>& onConnected,
+                    size_t total, TcpServer::ConnectionPtr* connOut) {
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() {
+        server.reset(new TcpServer(g_loop, "ZeroCopyServer", InetAddress(kPort)));
+        server->setConnectionCallback([&](const TcpServer::ConnectionPtr& conn) {
+            if (conn->connected()) {
+                *connOut = conn;
+                onConnected(conn);
+            }
+        });
+        server->start();
+    });
+    
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    InetAddress addr("127.0.0.1", kPort);
+    int rc = ::connect(fd, addr.getSockAddr(), addr.getSockLen());
+    assert(rc == 0);
+    (void)rc;
+    std::string data;
+    char buf[65536];
+    while (data.size() < total) {
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        assert(n > 0);
+        data.append(buf, n);
+    }
+    
+    // 对端都收到了，完成通知很快就会到达
+    size_t inFlight = 1;
+    for (int i = 0; i < 100 && inFlight > 0; ++i) {
+        runSync([&]() { inFlight = (*connOut)->zeroCopyInFlight(); });
+        if (inFlight > 0) {
+            ::usleep(10 * 1000);
+        }
+    }
+    assert(inFlight == 0);
+    
+    ::close(fd);
+    runSync([&]() {
+        connOut->reset();
+        server.reset();
+    });
+    return data;
+}
+
+void testBuffer() {
+    std::cout << "\n[测试1] send(Buffer*)" << std::endl;
+    const std::string payload = pattern(4 * 1024 * 1024, 'a');
+    TcpServer::ConnectionPtr conn;
+    std::string data = receive([&](const TcpServer::ConnectionPtr& c) {
+        bool on = c->setZeroCopy(true);
+        assert(on && c->zeroCopy());
+        (void)on;
+        Buffer buf;
+        buf.append(payload);
+        c->send(&buf);
+        // Buffer的内存被连接接管了
+        assert(buf.readableBytes() == 0);
+        assert(c->zeroCopyInFlight() > 0);
+    }, payload.size(), &conn);
+    assert(data == payload);
+    std::cout << "  ✓ 收到" << data.size() << "字节，内容正确，完成通知全部到达" << std::endl;
+}
+
+void testOrdering() {
+    std::cout << "\n[测试2] 和普通数据、文件混在一起" << std::endl;
+    const std::string big1 = pattern(300 * 1024, 'A');
+    const std::string big2 = pattern(200 * 1024, 'k');
+    const std::string fileContent = pattern(100 * 1024, '0');
+    FILE* file = tmpfile();
+    size_t rc = fwrite(fileContent.data(), 1, fileContent.size(), file);
+    assert(rc == fileContent.size());
+    (void)rc;
+    fflush(file);
+    int fileFd = ::dup(fileno(file));
+    fclose(file);
+    
+    std::string expected = "head|" + big1 + "|mid|" + fileContent + big2 + "|tail";
+    TcpServer::ConnectionPtr conn;
+    std::string data = receive([&](const TcpServer::ConnectionPtr& c) {
+        c->setZeroCopy(true);
+        c->send("head|");
+        c->sendZeroCopy(std::string(big1));
+        c->send("|mid|");
+        c->sendFile(fileFd, 0, fileContent.size());
+        c->sendZeroCopy(std::string(big2));
+        c->send("|tail");
+    }, expected.size(), &conn);
+    assert(data == expected);
+    std::cout << "  ✓ 按调用顺序到达" << std::endl;
+}
+
+void testCopyPath() {
+    std::cout << "\n[测试3] 小块数据和没有开启零拷贝" << std::endl;
+    const std::string small = pattern(TcpConnection::kZeroCopyThreshold - 1, 's');
+    const std::string big = pattern(256 * 1024, 'b');
+    TcpServer::ConnectionPtr conn;
+    std::string data = receive([&](const TcpServer::ConnectionPtr& c) {
+        c->setZeroCopy(true);
+        c->sendZeroCopy(std::string(small));
+        assert(c->zeroCopyInFlight() == 0);
+        c->setZeroCopy(false);
+        Buffer buf;
+        buf.append(big);
+        c->send(&buf);
+        assert(c->zeroCopyInFlight() == 0);
+    }, small.size() + big.size(), &conn);
+    assert(data == small + big);
+    std::cout << "  ✓ 没有零拷贝发送" << std::endl;
+}
+
+void testCloseInFlight() {
+    std::cout << "\n[测试4] 发送之后马上关闭" << std::endl;
+    const std::string expected = pattern(8 * 1024 * 1024, 'c');
+    std::shared_ptr<const std::string> payload = std::make_shared<const std::string>(expected);
+    std::weak_ptr<const std::string> owner = payload;
+    std::weak_ptr<TcpConnection> weakConn;
+    size_t inFlight = 0;
+    
+    std::unique_ptr<TcpServer> server;
+    runSync([&]() {
+        server.reset(new TcpServer(g_loop, "ZeroCopyServer", InetAddress(kPort)));
+        server->setConnectionCallback([&](const TcpServer::ConnectionPtr& conn) {
+            if (conn->connected()) {
+                weakConn = conn;
+                conn->setZeroCopy(true);
+                conn->sendZeroCopy(payload);
+                inFlight = conn->zeroCopyInFlight();
+                conn->forceClose();
+            }
+        });
+        server->start();
+    });
+    
+    // 客户端先不读，数据留在服务端的发送队列里，内核还在引用
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int rcvbuf = 64 * 1024;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+    InetAddress addr("127.0.0.1", kPort);
+    int rc = ::connect(fd, addr.getSockAddr(), addr.getSockLen());
+    assert(rc == 0);
+    (void)rc;
+    
+    bool destroyed = false;
+    for (int i = 0; i < 100 && !destroyed; ++i) {
+        ::usleep(10 * 1000);
+        runSync([&]() { destroyed = inFlight > 0 && weakConn.expired(); });
+    }
+    assert(destroyed);
+    payload.reset();
+    assert(!owner.expired());
+    std::cout << "  ✓ 连接已经销毁，数据仍然持有" << std::endl;
+    
+    // 读到EOF：收到的是forceClose()之前交给内核的部分，内容正确
+    std::string data;
+    char buf[65536];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof buf)) > 0) {
+        data.append(buf, n);
+    }
+    assert(n == 0);
+    ::close(fd);
+    assert(!data.empty() && data.size() <= expected.size());
+    assert(data == expected.substr(0, data.size()));
+    
+    bool released = false;
+    for (int i = 0; i < 100 && !released; ++i) {
+        runSync([&]() { released = owner.expired(); });
+        if (!released) {
+            ::usleep(10 * 1000);
+        }
+    }
+    assert(released);
+    runSync([&]() { server.reset(); });
+    std::cout << "  ✓ 对端收到" << data.size() << "字节，内容正确，通知到齐后释放" << std::endl;
+}
+
+int main() {
+    std::cout << "=== 零拷贝发送 测试 ===" << std::endl;
+    Logger::setLogLevel(Logger::WARN);
+    
+    EventLoop loop;
+    g_loop = &loop;
+    
+    std::thread driver([&]() {
+        testBuffer();
+        testOrdering();
+        testCopyPath();
+        testCloseInFlight();
+        
+        std::cout << "\n=== 所有测试通过 ===" << std::endl;
+        loop.quit();
+    });
+    
+    loop.loop();
+    driver.join();
+    return 0;
+}